@@ -0,0 +1,120 @@
+#Shader Compute
+
+#version 450 core
+
+// Decides how many paths every 16x16 tile of RayGen.glsl traces next frame. Stage 0 estimates the
+// error of every tile from the accumulation and moments images, stage 1 spreads the frame's sample
+// budget over the tiles that haven't converged yet. CPU reference in CPU/AdaptiveSampling.cpp.
+
+layout(binding = 0, rgba32f) readonly uniform image2D u_AccumulationImage;
+layout(binding = 1, rgba32f) readonly uniform image2D u_MomentsImage;
+layout(std430, binding = 2) buffer TileErrors { float Data[]; } m_TileErrors;
+layout(std430, binding = 3) buffer TileSamples { uint ActiveTileCount; uint Data[]; } m_TileSamples;
+
+layout (push_constant) uniform Uniforms
+{
+	uint Stage;
+	uint FrameIndex;
+	float ErrorThreshold;
+	uint MinFrameIndex;
+	uint SamplesPerFrame;
+	uint MaxSamplesPerFrame;
+} u_Uniforms;
+
+const uint TILE_SIZE = 16;
+const float ERROR_EPSILON = 0.05;
+
+float Luminance(vec3 c)
+{
+	return 0.212671 * c.x + 0.715160 * c.y + 0.072169 * c.z;
+}
+
+// Standard error of the pixel mean relative to its luminance, the epsilon keeps dark pixels from dominating
+float PixelError(vec4 accumulation, float momentSum)
+{
+	float n = accumulation.w;
+	if (n < 2.0)
+		return 1e30;
+
+	float mean = Luminance(accumulation.rgb) / n;
+	float variance = max(momentSum / n - mean * mean, 0.0) * n / (n - 1.0);
+	return sqrt(variance / n) / (mean + ERROR_EPSILON);
+}
+
+bool IsActive(uint tile)
+{
+	return u_Uniforms.FrameIndex <= u_Uniforms.MinFrameIndex || m_TileErrors.Data[tile] > u_Uniforms.ErrorThreshold;
+}
+
+shared float s_ErrorSum[TILE_SIZE * TILE_SIZE];
+shared uint s_PixelCount[TILE_SIZE * TILE_SIZE];
+shared uint s_ActiveTileCount;
+
+void EstimateTileError()
+{
+	ivec2 size = imageSize(u_AccumulationImage);
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+	uint index = gl_LocalInvocationIndex;
+
+	s_ErrorSum[index] = 0.0;
+	s_PixelCount[index] = 0;
+	if (pixel.x < size.x && pixel.y < size.y)
+	{
+		s_ErrorSum[index] = min(PixelError(imageLoad(u_AccumulationImage, pixel), imageLoad(u_MomentsImage, pixel).x), 1e6);
+		s_PixelCount[index] = 1;
+	}
+
+	barrier();
+
+	for (uint stride = TILE_SIZE * TILE_SIZE / 2; stride > 0; stride /= 2)
+	{
+		if (index < stride)
+		{
+			s_ErrorSum[index] += s_ErrorSum[index + stride];
+			s_PixelCount[index] += s_PixelCount[index + stride];
+		}
+		barrier();
+	}
+
+	if (index == 0)
+	{
+		uint tile = gl_WorkGroupID.x + gl_WorkGroupID.y * gl_NumWorkGroups.x;
+		m_TileErrors.Data[tile] = s_ErrorSum[0] / float(max(s_PixelCount[0], 1u));
+
+		if (IsActive(tile))
+			atomicAdd(m_TileSamples.ActiveTileCount, 1);
+	}
+}
+
+void ScheduleTiles()
+{
+	ivec2 size = imageSize(u_AccumulationImage);
+	uint tileCount = ((size.x + TILE_SIZE - 1) / TILE_SIZE) * ((size.y + TILE_SIZE - 1) / TILE_SIZE);
+
+	if (gl_LocalInvocationIndex == 0)
+		s_ActiveTileCount = m_TileSamples.ActiveTileCount;
+	barrier();
+
+	// The frame's budget is what uniform sampling would spend, shared by the unconverged tiles
+	uint activeTileCount = s_ActiveTileCount;
+	uint samples = 0;
+	if (activeTileCount > 0)
+		samples = min((u_Uniforms.SamplesPerFrame * tileCount + activeTileCount - 1) / activeTileCount, u_Uniforms.MaxSamplesPerFrame);
+
+	for (uint tile = gl_LocalInvocationIndex; tile < tileCount; tile += TILE_SIZE * TILE_SIZE)
+		m_TileSamples.Data[tile] = IsActive(tile) ? samples : 0;
+
+	// Stage 0 of the next frame counts from zero again
+	barrier();
+	if (gl_LocalInvocationIndex == 0)
+		m_TileSamples.ActiveTileCount = 0;
+}
+
+layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE, local_size_z = 1) in;
+void main()
+{
+	if (u_Uniforms.Stage == 0)
+		EstimateTileError();
+	else
+		ScheduleTiles();
+}
@@ -0,0 +1,158 @@
+#Shader Compute
+
+#version 450 core
+
+// Edge-avoiding a-trous wavelet filter (Dammertz et al. 2010) with the variance guided luminance
+// weight of SVGF, driven by the first hit AOVs of RayGen.glsl. Stage 0 divides the image by the
+// albedo and estimates the variance of every pixel, stage 1 runs one 5x5 pass with its taps Step
+// pixels apart, ping-ponging between the two filter images. The last pass multiplies the albedo back
+// into u_OutputImage. CPU reference in CPU/Denoiser.cpp.
+
+layout(binding = 0, rgba32f) readonly uniform image2D u_InputImage;
+layout(binding = 1, rgba32f) readonly uniform image2D u_AccumulationImage;
+layout(binding = 2, rgba32f) readonly uniform image2D u_MomentsImage;
+layout(binding = 3, rgba32f) readonly uniform image2D u_AlbedoImage;
+layout(binding = 4, rgba32f) readonly uniform image2D u_NormalDepthImage; // xyz world normal, w first hit distance, 0 for misses
+layout(binding = 5, rgba32f) uniform image2D u_FilterImage0; // rgb demodulated color, a variance
+layout(binding = 6, rgba32f) uniform image2D u_FilterImage1;
+layout(binding = 7, rgba32f) writeonly uniform image2D u_OutputImage;
+
+layout (push_constant) uniform Uniforms
+{
+	uint Stage;
+	uint Step;
+	uint Source; // Filter image read by stage 1, the other one is written
+	uint Final;  // Write the remodulated result to u_OutputImage instead
+	float SigmaLuminance;
+	float SigmaNormal;
+	float SigmaDepth;
+} u_Uniforms;
+
+// B3 spline
+const float KERNEL[5] = float[](1.0 / 16.0, 1.0 / 4.0, 3.0 / 8.0, 1.0 / 4.0, 1.0 / 16.0);
+
+const float MIN_ALBEDO = 0.01;
+const float EPSILON = 1e-4;
+
+float Luminance(vec3 c)
+{
+	return 0.212671 * c.x + 0.715160 * c.y + 0.072169 * c.z;
+}
+
+vec3 Demodulation(ivec2 pixel)
+{
+	return max(imageLoad(u_AlbedoImage, pixel).rgb, vec3(MIN_ALBEDO));
+}
+
+vec4 LoadFilter(ivec2 pixel)
+{
+	return u_Uniforms.Source == 0 ? imageLoad(u_FilterImage0, pixel) : imageLoad(u_FilterImage1, pixel);
+}
+
+void StoreFilter(ivec2 pixel, vec4 value)
+{
+	if (u_Uniforms.Source == 0)
+		imageStore(u_FilterImage1, pixel, value);
+	else
+		imageStore(u_FilterImage0, pixel, value);
+}
+
+void Prepare(ivec2 pixel)
+{
+	vec3 color = imageLoad(u_InputImage, pixel).rgb;
+	if (!(imageLoad(u_NormalDepthImage, pixel).w > 0.0))
+	{
+		imageStore(u_FilterImage0, pixel, vec4(color, 0.0));
+		return;
+	}
+
+	vec3 demodulation = Demodulation(pixel);
+	vec3 irradiance = color / demodulation;
+
+	// Variance of the pixel mean from the moments, same estimate as PixelError in AdaptiveSampling.glsl.
+	// Without two accumulated paths it is unknown, then the luminance weight allows the pixel's own luminance.
+	vec4 accumulation = imageLoad(u_AccumulationImage, pixel);
+	float n = accumulation.w;
+	float variance = Luminance(irradiance) * Luminance(irradiance);
+	if (n >= 2.0)
+	{
+		float mean = Luminance(accumulation.rgb) / n;
+		float sampleVariance = max(imageLoad(u_MomentsImage, pixel).x / n - mean * mean, 0.0) * n / (n - 1.0);
+		float albedoLuminance = Luminance(demodulation);
+		variance = sampleVariance / n / (albedoLuminance * albedoLuminance);
+	}
+
+	imageStore(u_FilterImage0, pixel, vec4(irradiance, variance));
+}
+
+void Filter(ivec2 pixel, ivec2 size)
+{
+	vec4 center = LoadFilter(pixel);
+	vec4 normalDepth = imageLoad(u_NormalDepthImage, pixel);
+	float zp = normalDepth.w;
+
+	vec4 result = center;
+	if (zp > 0.0)
+	{
+		float lp = Luminance(center.rgb);
+		float invSigmaLuminance = 1.0 / (u_Uniforms.SigmaLuminance * sqrt(max(center.a, 0.0)) + EPSILON);
+		float depthScale = u_Uniforms.SigmaDepth * float(u_Uniforms.Step) * zp;
+
+		float centerWeight = KERNEL[2] * KERNEL[2];
+		float sumWeight = centerWeight;
+		vec3 sumColor = center.rgb * centerWeight;
+		float sumVariance = center.a * centerWeight * centerWeight;
+
+		for (int dy = -2; dy <= 2; dy++)
+		{
+			for (int dx = -2; dx <= 2; dx++)
+			{
+				ivec2 q = pixel + ivec2(dx, dy) * int(u_Uniforms.Step);
+				if ((dx == 0 && dy == 0) || any(lessThan(q, ivec2(0))) || any(greaterThanEqual(q, size)))
+					continue;
+
+				vec4 tapNormalDepth = imageLoad(u_NormalDepthImage, q);
+				float zq = tapNormalDepth.w;
+				if (!(zq > 0.0))
+					continue;
+
+				vec4 tap = LoadFilter(q);
+
+				float exponent = abs(lp - Luminance(tap.rgb)) * invSigmaLuminance;
+				exponent += abs(zp - zq) / (depthScale * float(max(abs(dx), abs(dy))) + EPSILON);
+				exponent += u_Uniforms.SigmaNormal * (1.0 - max(dot(normalDepth.xyz, tapNormalDepth.xyz), 0.0));
+
+				float weight = KERNEL[dx + 2] * KERNEL[dy + 2] * exp(-exponent);
+				sumWeight += weight;
+				sumColor += tap.rgb * weight;
+				sumVariance += tap.a * weight * weight;
+			}
+		}
+
+		result = vec4(sumColor / sumWeight, sumVariance / (sumWeight * sumWeight));
+	}
+
+	if (u_Uniforms.Final != 0)
+	{
+		vec3 color = zp > 0.0 ? result.rgb * Demodulation(pixel) : result.rgb;
+		imageStore(u_OutputImage, pixel, vec4(color, 1.0));
+	}
+	else
+	{
+		StoreFilter(pixel, result);
+	}
+}
+
+layout(local_size_x = 16, local_size_y = 16, local_size_z = 1) in;
+void main()
+{
+	ivec2 size = imageSize(u_InputImage);
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+	if (pixel.x >= size.x || pixel.y >= size.y)
+		return;
+
+	if (u_Uniforms.Stage == 0)
+		Prepare(pixel);
+	else
+		Filter(pixel, size);
+}
@@ -11,143 +11,25 @@ hitAttributeEXT vec2 g_HitAttributes;
 layout(std430, binding = 4) buffer Vertices		{ float Data[];	} m_VertexBuffers[];
 layout(std430, binding = 5) buffer Indices		{ uint Data[];	} m_IndexBuffers[];
 layout(std430, binding = 6) buffer SubmeshData	{ uint Data[];	} m_SubmeshData;
+layout(std430, binding = 40) buffer InstanceData	{ uint Data[];	} m_InstanceData;
 layout(std430, binding = 8) buffer Materials	{ float Data[];	} m_Materials;
+layout(std430, binding = 36) buffer MaterialLobes	{ uint Data[];	} m_MaterialLobes;
 layout(binding = 9) uniform sampler2D u_Textures[];
 
-struct Vertex
-{
-	vec3 Position;      // 12
-	vec2 TextureCoords; // 20
-	vec3 Normal;        // 32
-	vec4 Tangent;       // 48
-	vec3 Binormal;      // 60
-};
-
-struct Material
-{
-	vec3 AlbedoValue;				// 12
-	float MetallicValue;			// 16
-	float RoughnessValue;			// 20
-	vec3 EmissiveValue;				// 32
-	float EmissiveStrength;			// 36
-	uint UseNormalMap;				// 40
-
-	int AlbedoMapIndex;				// 44
-	int MetallicRoughnessMapIndex;	// 48
-	int NormalMapIndex;				// 52
-
-	float Anisotropic;              // 56
-	float Subsurface;               // 60
-	float SpecularTint;             // 64
-	float Sheen;                    // 68
-	float SheenTint;                // 72
-	float Clearcoat;                // 76
-	float ClearcoatRoughness;       // 80
-	float SpecTrans;                // 84
-	float ior;                      // 88
-};
-
-Vertex UnpackVertex(uint vertexBufferIndex, uint index, uint vertexOffset)
-{
-	index += vertexOffset;
-
-	Vertex vertex;
-
-	const int stride = 48;
-	const int offset = stride / 4;
-
-	vertex.Position = vec3(
-		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 0],
-		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 1],
-		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 2]
-	);
-
-	vertex.TextureCoords = vec2(
-		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 3],
-		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 4]
-	);
-
-	vertex.Normal = vec3(
-		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 5],
-		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 6],
-		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 7]
-	);
-
-	vertex.Tangent = vec4(
-		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 8],
-		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 9],
-		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 10],
-		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 11]
-	);
-
-	vertex.Binormal = cross(normalize(vertex.Tangent.xyz), normalize(vertex.Normal)) * vertex.Tangent.w;
-
-	return vertex;
-}
-
-Vertex InterpolateVertex(Vertex vertices[3], vec3 barycentrics)
-{
-	Vertex vertex;
-	vertex.Position = vec3(0.0);
-	vertex.TextureCoords = vec2(0.0);
-	vertex.Normal = vec3(0.0);
-	vertex.Tangent = vec4(0.0);
-	vertex.Binormal = vec3(0.0);
-	
-	for (uint i = 0; i < 3; i++)
-	{
-		vertex.Position += vertices[i].Position * barycentrics[i];
-		vertex.TextureCoords += vertices[i].TextureCoords * barycentrics[i];
-		vertex.Normal += vertices[i].Normal * barycentrics[i];
-		vertex.Tangent += vertices[i].Tangent * barycentrics[i];
-		vertex.Binormal += vertices[i].Binormal * barycentrics[i];
-	}
-
-	vertex.Normal = normalize(vertex.Normal);
-	vertex.Tangent = normalize(vertex.Tangent);
-	vertex.Binormal = normalize(vertex.Binormal);
-
-	return vertex;	
-}
-
-Material UnpackMaterial(uint materialIndex)
-{
-	const uint stride = 88;
-	const uint offset = materialIndex * (stride / 4);
-
-	Material material;
-
-	material.AlbedoValue = vec3(m_Materials.Data[offset + 0], m_Materials.Data[offset + 1], m_Materials.Data[offset + 2]);
-	material.MetallicValue = m_Materials.Data[offset + 3];
-	material.RoughnessValue = m_Materials.Data[offset + 4];
-	material.EmissiveValue = vec3(m_Materials.Data[offset + 5], m_Materials.Data[offset + 6], m_Materials.Data[offset + 7]);
-	material.EmissiveStrength = m_Materials.Data[offset + 8];
-	material.UseNormalMap = floatBitsToUint(m_Materials.Data[offset + 9]);
-
-	material.AlbedoMapIndex = floatBitsToInt(m_Materials.Data[offset + 10]);
-	material.MetallicRoughnessMapIndex = floatBitsToInt(m_Materials.Data[offset + 11]);
-	material.NormalMapIndex = floatBitsToInt(m_Materials.Data[offset + 12]);
-
-	material.Anisotropic = m_Materials.Data[offset + 13];
-	material.Subsurface = m_Materials.Data[offset + 14];
-	material.SpecularTint = m_Materials.Data[offset + 15];
-	material.Sheen = m_Materials.Data[offset + 16];
-	material.SheenTint = m_Materials.Data[offset + 17];
-	material.Clearcoat = m_Materials.Data[offset + 18];
-	material.ClearcoatRoughness = m_Materials.Data[offset + 19];
-	material.SpecTrans = m_Materials.Data[offset + 20];
-	material.ior = m_Materials.Data[offset + 21];
-
-	return material;
-}
+#include "assets/shaders/RayTracing/Vertex.glsl"
+#include "assets/shaders/RayTracing/CompactVertex.glsl"
+#include "assets/shaders/RayTracing/Material.glsl"
 
 void main()
 {
+	// Instances of a mesh share its submesh records, only the material can differ
+	uint submeshIndex = m_InstanceData.Data[gl_InstanceCustomIndexEXT * 2 + 0];
+	uint materialIndex = m_InstanceData.Data[gl_InstanceCustomIndexEXT * 2 + 1];
+
 	// Collect the vertex data for the triangle that was hit
-	uint bufferIndex = m_SubmeshData.Data[gl_InstanceCustomIndexEXT * 4 + 0];
-	uint vertexOffset = m_SubmeshData.Data[gl_InstanceCustomIndexEXT * 4 + 1];
-	uint indexOffset = m_SubmeshData.Data[gl_InstanceCustomIndexEXT * 4 + 2];
-	uint materialIndex = m_SubmeshData.Data[gl_InstanceCustomIndexEXT * 4 + 3];
+	uint bufferIndex = m_SubmeshData.Data[submeshIndex * 4 + 0];
+	uint vertexOffset = m_SubmeshData.Data[submeshIndex * 4 + 1];
+	uint indexOffset = m_SubmeshData.Data[submeshIndex * 4 + 2];
 
 	Material material = UnpackMaterial(materialIndex);
 
@@ -155,18 +37,29 @@ void main()
 	uint index1 = m_IndexBuffers[bufferIndex].Data[gl_PrimitiveID * 3 + 1 + indexOffset];
 	uint index2 = m_IndexBuffers[bufferIndex].Data[gl_PrimitiveID * 3 + 2 + indexOffset];
 	
-	Vertex vertices[3] = Vertex[](
-		UnpackVertex(bufferIndex, index0, vertexOffset),
-		UnpackVertex(bufferIndex, index1, vertexOffset),
-		UnpackVertex(bufferIndex, index2, vertexOffset)
-	);
-
 	// Interpolate the vertex using barycentrics 
 	vec3 barycentrics = vec3(1.0 - g_HitAttributes.x - g_HitAttributes.y, g_HitAttributes.x, g_HitAttributes.y);
-	Vertex vertex = InterpolateVertex(vertices, barycentrics);
 
-	// Organize the data
+	Vertex vertex;
+	if (UseCompactVertices())
+	{
+		vertex = InterpolateCompactVertex(submeshIndex, uvec3(index0, index1, index2) + vertexOffset, barycentrics);
+	}
+	else
+	{
+		Vertex vertices[3] = Vertex[](
+			UnpackVertex(bufferIndex, index0, vertexOffset),
+			UnpackVertex(bufferIndex, index1, vertexOffset),
+			UnpackVertex(bufferIndex, index2, vertexOffset)
+		);
+		vertex = InterpolateVertex(vertices, barycentrics);
+	}
+
+	// Organize the data, quantized positions are off the traced triangle by up to half a step,
+	// so the compact path takes the hit point from the ray to keep the ray offsets valid
 	vec3 worldPosition = gl_ObjectToWorldEXT * vec4(vertex.Position, 1.0);
+	if (UseCompactVertices())
+		worldPosition = gl_WorldRayOriginEXT + gl_WorldRayDirectionEXT * gl_HitTEXT;
 	vec3 worldNormal = normalize(mat3(gl_ObjectToWorldEXT) * vertex.Normal);
 	mat3 worldNormalMatrix = mat3(gl_ObjectToWorldEXT) * mat3(vertex.Tangent.xyz, vertex.Binormal, vertex.Normal);
 	worldNormalMatrix =  mat3(normalize(worldNormalMatrix[0]), normalize(worldNormalMatrix[1]), normalize(worldNormalMatrix[2]));
@@ -224,6 +117,10 @@ void main()
     g_RayPayload.ax = max(0.001, g_RayPayload.Roughness / aspect);
     g_RayPayload.ay = max(0.001, g_RayPayload.Roughness * aspect);
 	g_RayPayload.eta = dot(view, worldNormal) < 0.0 ? (1.0 / g_RayPayload.ior ) : g_RayPayload.ior;
+	g_RayPayload.Lobes = m_MaterialLobes.Data[materialIndex];
+
+	g_RayPayload.InstanceIndex = gl_InstanceCustomIndexEXT;
+	g_RayPayload.PrimitiveIndex = gl_PrimitiveID;
 
 	// gl_InstanceCustomIndexEXT: Cornell Box
 	// 0:  Back wall
@@ -0,0 +1,60 @@
+// Optional 20 byte vertex encoding, see CompactVertex.h. Holds every vertex of m_VertexBuffers
+// in one buffer, positions are dequantized with the bounds of the submesh that was hit.
+// Requires Vertex.glsl.
+
+layout(std430, binding = 34) buffer CompactVertices		{ uint Data[];	} m_CompactVertices;
+layout(std430, binding = 35) buffer CompactVertexInfo
+{
+	uint Enabled;
+	uint Padding[3];
+	vec4 Bounds[]; // Min and extent / 65535 per submesh
+} m_CompactVertexInfo;
+
+bool UseCompactVertices()
+{
+	return m_CompactVertexInfo.Enabled != 0;
+}
+
+vec3 OctahedralDecode(vec2 encoded)
+{
+	vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+// Interpolated vertex of the triangle, the binormal is built once from the interpolated basis
+// instead of per corner
+Vertex InterpolateCompactVertex(uint submeshIndex, uvec3 indices, vec3 barycentrics)
+{
+	vec3 boundsMin = m_CompactVertexInfo.Bounds[submeshIndex * 2 + 0].xyz;
+	vec3 boundsScale = m_CompactVertexInfo.Bounds[submeshIndex * 2 + 1].xyz;
+
+	Vertex vertex;
+	vertex.Position = vec3(0.0);
+	vertex.TextureCoords = vec2(0.0);
+	vertex.Normal = vec3(0.0);
+	vertex.Tangent = vec4(0.0);
+
+	uint tangentSign = 0;
+	for (uint i = 0; i < 3; i++)
+	{
+		uint base = indices[i] * 5;
+		uint xy = m_CompactVertices.Data[base + 0];
+		uint zSign = m_CompactVertices.Data[base + 1];
+
+		vec3 quantized = vec3(xy & 0xFFFF, xy >> 16, zSign & 0xFFFF);
+		vertex.Position += (boundsMin + quantized * boundsScale) * barycentrics[i];
+		vertex.TextureCoords += unpackHalf2x16(m_CompactVertices.Data[base + 2]) * barycentrics[i];
+		vertex.Normal += OctahedralDecode(unpackSnorm2x16(m_CompactVertices.Data[base + 3])) * barycentrics[i];
+		vertex.Tangent.xyz += OctahedralDecode(unpackSnorm2x16(m_CompactVertices.Data[base + 4])) * barycentrics[i];
+		tangentSign = zSign >> 16;
+	}
+
+	vertex.Normal = normalize(vertex.Normal);
+	vertex.Tangent = vec4(normalize(vertex.Tangent.xyz), tangentSign != 0 ? -1.0 : 1.0);
+	vertex.Binormal = cross(vertex.Tangent.xyz, vertex.Normal) * vertex.Tangent.w;
+
+	return vertex;
+}
@@ -82,17 +82,27 @@ vec3 EvalDisneyDiffuse(Payload payload, vec3 Csheen, vec3 V, vec3 L, vec3 H, out
     float Fretro = Rr * (FL + FV + FL * FV * (Rr - 1.0));
     float Fd = (1.0 - 0.5 * FL) * (1.0 - 0.5 * FV);
 
-    // Fake subsurface
-    float Fss90 = 0.5 * Rr;
-    float Fss = mix(1.0, Fss90, FL) * mix(1.0, Fss90, FV);
-    float ss = 1.25 * (Fss * (1.0 / (L.z + V.z) - 0.5) + 0.5);
+    pdf = L.z * INV_PI;
+
+    // Fake subsurface, mixing with a zero weight leaves Fd + Fretro as is
+    float diffuse = Fd + Fretro;
+    if ((payload.Lobes & LOBE_SUBSURFACE) != 0)
+    {
+        float Fss90 = 0.5 * Rr;
+        float Fss = mix(1.0, Fss90, FL) * mix(1.0, Fss90, FV);
+        float ss = 1.25 * (Fss * (1.0 / (L.z + V.z) - 0.5) + 0.5);
+        diffuse = mix(Fd + Fretro, ss, payload.Subsurface);
+    }
 
     // Sheen
-    float FH = SchlickWeight(LDotH);
-    vec3 Fsheen = FH * payload.Sheen * Csheen;
+    vec3 Fsheen = vec3(0.0);
+    if ((payload.Lobes & LOBE_SHEEN) != 0)
+    {
+        float FH = SchlickWeight(LDotH);
+        Fsheen = FH * payload.Sheen * Csheen;
+    }
 
-    pdf = L.z * INV_PI;
-    return INV_PI * payload.Albedo * mix(Fd + Fretro, ss, payload.Subsurface) + Fsheen;
+    return INV_PI * payload.Albedo * diffuse + Fsheen;
 }
 
 vec3 EvalMicrofacetReflection(Payload payload, vec3 V, vec3 L, vec3 H, vec3 F, out float pdf)
@@ -147,12 +157,13 @@ vec3 EvalClearcoat(Payload payload, vec3 V, vec3 L, vec3 H, out float pdf)
     return vec3(F) * D * G;
 }
 
-vec3 DisneySample(Payload payload, vec3 V, vec3 N, out vec3 L, out float pdf, inout uint seed)
+// u.xy picks the direction and u.z the lobe
+vec3 DisneySample(Payload payload, vec3 V, vec3 N, out vec3 L, out float pdf, vec3 u)
 {
     pdf = 0.0;
 
-    float r1 = RandomValue(seed);
-    float r2 = RandomValue(seed);
+    float r1 = u.x;
+    float r2 = u.y;
 
     // TODO: Tangent and bitangent should be calculated from mesh (provided, the mesh has proper uvs)
     vec3 T, B;
@@ -166,19 +177,23 @@ vec3 DisneySample(Payload payload, vec3 V, vec3 N, out vec3 L, out float pdf, in
     float F0;
     TintColors(payload, payload.eta, F0, Csheen, Cspec0);
 
-    // Model weights
-    float dielectricWt = (1.0 - payload.Metallic) * (1.0 - payload.SpecTrans);
-    float metalWt = payload.Metallic;
-    float glassWt = (1.0 - payload.Metallic) * payload.SpecTrans;
+    // Model weights, lobes missing from payload.Lobes have a weight of exactly zero
+    bool diffuse = (payload.Lobes & LOBE_DIFFUSE) != 0;
+    bool metal = (payload.Lobes & LOBE_METAL) != 0;
+    bool glass = (payload.Lobes & LOBE_GLASS) != 0;
+
+    float dielectricWt = diffuse ? (1.0 - payload.Metallic) * (1.0 - payload.SpecTrans) : 0.0;
+    float metalWt = metal ? payload.Metallic : 0.0;
+    float glassWt = glass ? (1.0 - payload.Metallic) * payload.SpecTrans : 0.0;
 
     // Lobe probabilities
     float schlickWt = SchlickWeight(V.z);
 
-    float diffPr = dielectricWt * Luminance(payload.Albedo);
-    float dielectricPr = dielectricWt * Luminance(mix(Cspec0, vec3(1.0), schlickWt));
-    float metalPr = metalWt * Luminance(mix(payload.Albedo, vec3(1.0), schlickWt));
+    float diffPr = diffuse ? dielectricWt * Luminance(payload.Albedo) : 0.0;
+    float dielectricPr = diffuse ? dielectricWt * Luminance(mix(Cspec0, vec3(1.0), schlickWt)) : 0.0;
+    float metalPr = metal ? metalWt * Luminance(mix(payload.Albedo, vec3(1.0), schlickWt)) : 0.0;
     float glassPr = glassWt;
-    float clearCtPr = 0.25 * payload.Clearcoat;
+    float clearCtPr = (payload.Lobes & LOBE_CLEARCOAT) != 0 ? 0.25 * payload.Clearcoat : 0.0;
 
     // Normalize probabilities
     float invTotalWt = 1.0 / (diffPr + dielectricPr + metalPr + glassPr + clearCtPr);
@@ -197,7 +212,7 @@ vec3 DisneySample(Payload payload, vec3 V, vec3 N, out vec3 L, out float pdf, in
     cdf[4] = cdf[3] + clearCtPr;
 
     // Sample a lobe based on its importance
-    float r3 = RandomValue(seed);
+    float r3 = u.z;
 
     if (r3 < cdf[0]) // Diffuse
     {
@@ -249,6 +264,14 @@ vec3 DisneySample(Payload payload, vec3 V, vec3 N, out vec3 L, out float pdf, in
     return DisneyEval(payload, V, N, L, pdf);
 }
 
+vec3 DisneySample(Payload payload, vec3 V, vec3 N, out vec3 L, out float pdf, inout uint seed)
+{
+    float r1 = RandomValue(seed);
+    float r2 = RandomValue(seed);
+    float r3 = RandomValue(seed);
+    return DisneySample(payload, V, N, L, pdf, vec3(r1, r2, r3));
+}
+
 vec3 DisneyEval(Payload payload, vec3 V, vec3 N, vec3 L, out float pdf)
 {
     pdf = 0.0;
@@ -276,19 +299,23 @@ vec3 DisneyEval(Payload payload, vec3 V, vec3 N, vec3 L, out float pdf)
     float F0;
     TintColors(payload, payload.eta, F0, Csheen, Cspec0);
 
-    // Model weights
-    float dielectricWt = (1.0 - payload.Metallic) * (1.0 - payload.SpecTrans);
-    float metalWt = payload.Metallic;
-    float glassWt = (1.0 - payload.Metallic) * payload.SpecTrans;
+    // Model weights, lobes missing from payload.Lobes have a weight of exactly zero
+    bool diffuse = (payload.Lobes & LOBE_DIFFUSE) != 0;
+    bool metal = (payload.Lobes & LOBE_METAL) != 0;
+    bool glass = (payload.Lobes & LOBE_GLASS) != 0;
+
+    float dielectricWt = diffuse ? (1.0 - payload.Metallic) * (1.0 - payload.SpecTrans) : 0.0;
+    float metalWt = metal ? payload.Metallic : 0.0;
+    float glassWt = glass ? (1.0 - payload.Metallic) * payload.SpecTrans : 0.0;
 
     // Lobe probabilities
     float schlickWt = SchlickWeight(V.z);
 
-    float diffPr = dielectricWt * Luminance(payload.Albedo);
-    float dielectricPr = dielectricWt * Luminance(mix(Cspec0, vec3(1.0), schlickWt));
-    float metalPr = metalWt * Luminance(mix(payload.Albedo, vec3(1.0), schlickWt));
+    float diffPr = diffuse ? dielectricWt * Luminance(payload.Albedo) : 0.0;
+    float dielectricPr = diffuse ? dielectricWt * Luminance(mix(Cspec0, vec3(1.0), schlickWt)) : 0.0;
+    float metalPr = metal ? metalWt * Luminance(mix(payload.Albedo, vec3(1.0), schlickWt)) : 0.0;
     float glassPr = glassWt;
-    float clearCtPr = 0.25 * payload.Clearcoat;
+    float clearCtPr = (payload.Lobes & LOBE_CLEARCOAT) != 0 ? 0.25 * payload.Clearcoat : 0.0;
 
     // Normalize probabilities
     float invTotalWt = 1.0 / (diffPr + dielectricPr + metalPr + glassPr + clearCtPr);
@@ -0,0 +1,89 @@
+// Environment importance sampling, matches CPU/EnvironmentMap.cpp. Declare u_SceneData before
+// including this file.
+
+// Marginal CDF (Height + 1), conditional CDFs (Height * (Width + 1)), function (Height * Width)
+layout(std430, binding = 33) readonly buffer EnvironmentDistribution { float Data[]; } m_EnvironmentDistribution;
+
+// Continuous sample in [0, 1) from the CDF of count bins starting at cdfOffset, offset is the bin it fell into
+float SampleEnvironmentCDF(uint cdfOffset, uint count, float u, out uint offset)
+{
+	// Last entry <= u, same as upper_bound - 1
+	uint first = 0;
+	uint remaining = count + 1;
+	while (remaining > 0)
+	{
+		uint halfRemaining = remaining / 2;
+		if (m_EnvironmentDistribution.Data[cdfOffset + first + halfRemaining] <= u)
+		{
+			first += halfRemaining + 1;
+			remaining -= halfRemaining + 1;
+		}
+		else
+		{
+			remaining = halfRemaining;
+		}
+	}
+	offset = clamp(first, 1u, count) - 1;
+
+	float cdf0 = m_EnvironmentDistribution.Data[cdfOffset + offset];
+	float cdf1 = m_EnvironmentDistribution.Data[cdfOffset + offset + 1];
+	float du = u - cdf0;
+	if (cdf1 - cdf0 > 0.0)
+		du /= cdf1 - cdf0;
+
+	return min((float(offset) + du) / float(count), 0.99999994);
+}
+
+float EnvironmentFunction(uint x, uint y)
+{
+	uint width = u_SceneData.EnvironmentSize.x;
+	uint height = u_SceneData.EnvironmentSize.y;
+	return m_EnvironmentDistribution.Data[(height + 1) + height * (width + 1) + y * width + x];
+}
+
+// Direction towards the environment with its solid angle pdf, pdf is 0 when nothing can be sampled
+vec3 SampleEnvironment(vec2 u, out float pdf)
+{
+	pdf = 0.0;
+	if (u_SceneData.EnvironmentIntegral <= 0.0)
+		return vec3(0.0, 1.0, 0.0);
+
+	uint width = u_SceneData.EnvironmentSize.x;
+	uint height = u_SceneData.EnvironmentSize.y;
+
+	uint x, y;
+	float v = SampleEnvironmentCDF(0, height, u.y, y);
+	float s = SampleEnvironmentCDF((height + 1) + y * (width + 1), width, u.x, x);
+
+	// Same mapping as EquirectangularToCubeMap.glsl
+	float phi = (s - 0.5) * TWO_PI;
+	float theta = v * PI;
+	float sinTheta = sin(theta);
+	if (sinTheta <= 0.0)
+		return vec3(0.0, 1.0, 0.0);
+
+	pdf = EnvironmentFunction(x, y) / u_SceneData.EnvironmentIntegral / (2.0 * PI * PI * sinTheta);
+	return vec3(sinTheta * cos(phi), cos(theta), sinTheta * sin(phi));
+}
+
+// Solid angle pdf of SampleEnvironment returning direction
+float EnvironmentPdf(vec3 direction)
+{
+	if (u_SceneData.EnvironmentIntegral <= 0.0)
+		return 0.0;
+
+	uint width = u_SceneData.EnvironmentSize.x;
+	uint height = u_SceneData.EnvironmentSize.y;
+	float phi = atan(direction.z, direction.x);
+	float theta = acos(clamp(direction.y, -1.0, 1.0));
+	vec2 uv = vec2(phi / TWO_PI + 0.5, theta / PI);
+
+	uint x = min(uint(uv.x * float(width)), width - 1);
+	uint y = min(uint(uv.y * float(height)), height - 1);
+
+	float sinTheta = sin(theta);
+	if (sinTheta <= 0.0)
+		return 0.0;
+
+	return EnvironmentFunction(x, y) / u_SceneData.EnvironmentIntegral / (2.0 * PI * PI * sinTheta);
+}
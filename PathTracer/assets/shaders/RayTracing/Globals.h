@@ -5,6 +5,15 @@
 #define INV_TWO_PI 0.15915494309189533
 #define INV_4_PI   0.07957747154594766
 
+// Disney BSDF lobes a material can have a nonzero weight in, see m_MaterialLobes
+#define LOBE_DIFFUSE    1  // Diffuse and dielectric reflection
+#define LOBE_SHEEN      2
+#define LOBE_SUBSURFACE 4
+#define LOBE_METAL      8
+#define LOBE_GLASS      16
+#define LOBE_CLEARCOAT  32
+#define LOBE_ALL        63
+
 struct Payload
 {
 	float Distance;
@@ -33,6 +42,10 @@ struct Payload
 	float ax;
 	float ay;
 	float eta;
+	uint Lobes;
+
+	uint InstanceIndex;  // gl_InstanceCustomIndexEXT
+	uint PrimitiveIndex; // gl_PrimitiveID
 };
 
 struct ScatterSampleRec
@@ -63,11 +76,19 @@ float RandomValue(inout uint seed)
 	return PCG_Hash(seed) / 4294967295.0;
 }
 
-vec2 RandomPointInCircle(inout uint seed)
+// Point in the unit disk, u.x picks the angle and u.y the area inside the radius
+vec2 PointInCircle(vec2 u)
 {
-	float angle = RandomValue(seed) * 2 * PI;
+	float angle = u.x * 2 * PI;
 	vec2 pointOnCircle = vec2(cos(angle), sin(angle));
-	return pointOnCircle * sqrt(RandomValue(seed));
+	return pointOnCircle * sqrt(u.y);
+}
+
+vec2 RandomPointInCircle(inout uint seed)
+{
+	float angle = RandomValue(seed);
+	float radius = RandomValue(seed);
+	return PointInCircle(vec2(angle, radius));
 }
 
 // Compute a cosine distributed random direction on the hemisphere about the given (normal) direction.
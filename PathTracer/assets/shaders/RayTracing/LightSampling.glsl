@@ -0,0 +1,201 @@
+// Emissive triangle sampling for next event estimation, matches CPU/LightSampler.cpp. Declare
+// u_SceneData before including this file.
+
+const uint LIGHT_SAMPLING_NONE = 0;
+const uint LIGHT_SAMPLING_ALIAS_TABLE = 1;
+const uint LIGHT_SAMPLING_BVH = 2;
+const uint INVALID_LIGHT = 0xFFFFFFFF;
+
+struct LightTriangle
+{
+	vec3 V0;
+	float Area;
+	vec3 Edge1;
+	float Power;
+	vec3 Edge2;
+	uint LeafNode;
+	vec3 Emission;
+	uint InstanceIndex;
+};
+
+struct AliasEntry
+{
+	float Probability;
+	uint Alias;
+};
+
+struct LightBVHNode
+{
+	vec3 BoundsMin;
+	float Power;
+	vec3 BoundsMax;
+	uint LeftFirst;
+	uint LightCount;
+	uint Parent;
+	uint Padding0;
+	uint Padding1;
+};
+
+layout(std430, binding = 29) readonly buffer Lights			{ LightTriangle Data[];	} m_Lights;
+layout(std430, binding = 30) readonly buffer AliasTable		{ AliasEntry Data[];	} m_AliasTable;
+layout(std430, binding = 31) readonly buffer LightBVH		{ LightBVHNode Data[];	} m_LightBVH;
+layout(std430, binding = 32) readonly buffer LightIndices	{ uint Data[];			} m_LightIndices; // Per instance offset or INVALID_LIGHT, then per triangle light indices
+
+// Power over squared distance to the node, clamped to the node's own size
+float LightBVHImportance(uint nodeIndex, vec3 position)
+{
+	LightBVHNode node = m_LightBVH.Data[nodeIndex];
+	vec3 center = (node.BoundsMin + node.BoundsMax) * 0.5;
+	vec3 extent = node.BoundsMax - node.BoundsMin;
+	vec3 toCenter = center - position;
+
+	float distanceSquared = max(dot(toCenter, toCenter), 0.25 * dot(extent, extent));
+	return node.Power / max(distanceSquared, 1e-12);
+}
+
+// InvalidLight for triangles that don't emit
+uint GetLightIndex(uint instanceIndex, uint primitiveIndex)
+{
+	uint offset = m_LightIndices.Data[instanceIndex];
+	if (offset == INVALID_LIGHT)
+		return INVALID_LIGHT;
+
+	return m_LightIndices.Data[offset + primitiveIndex];
+}
+
+// Probability of SampleLight picking the light at all
+float LightSelectionPdf(vec3 position, uint lightIndex)
+{
+	LightTriangle light = m_Lights.Data[lightIndex];
+	if (u_SceneData.LightSampling == LIGHT_SAMPLING_ALIAS_TABLE)
+		return light.Power / u_SceneData.LightTotalPower;
+
+	uint nodeIndex = light.LeafNode;
+	float pdf = light.Power / m_LightBVH.Data[nodeIndex].Power;
+	while (m_LightBVH.Data[nodeIndex].Parent != INVALID_LIGHT)
+	{
+		uint parentIndex = m_LightBVH.Data[nodeIndex].Parent;
+		uint leftIndex = m_LightBVH.Data[parentIndex].LeftFirst;
+		float left = LightBVHImportance(leftIndex, position);
+		float right = LightBVHImportance(leftIndex + 1, position);
+		if (left + right <= 0.0)
+			return 0.0;
+
+		pdf *= (nodeIndex == leftIndex ? left : right) / (left + right);
+		nodeIndex = parentIndex;
+	}
+
+	return pdf;
+}
+
+// Solid angle pdf of SampleLight picking lightPosition on the given light from position
+float LightPdf(vec3 position, uint lightIndex, vec3 lightPosition)
+{
+	float selectionPdf = LightSelectionPdf(position, lightIndex);
+	if (selectionPdf <= 0.0)
+		return 0.0;
+
+	LightTriangle light = m_Lights.Data[lightIndex];
+	vec3 toLight = lightPosition - position;
+	float distanceSquared = dot(toLight, toLight);
+	vec3 normal = normalize(cross(light.Edge1, light.Edge2));
+	float cosLight = abs(dot(normal, toLight)) / sqrt(distanceSquared);
+	if (cosLight < 1e-6)
+		return 0.0;
+
+	return selectionPdf / light.Area * distanceSquared / cosLight;
+}
+
+// Triangle part of SampleLight, INVALID_LIGHT when there is nothing to pick
+uint SelectLight(vec3 position, float u, out float selectionPdf)
+{
+	selectionPdf = 1.0;
+
+	if (u_SceneData.LightSampling == LIGHT_SAMPLING_ALIAS_TABLE)
+	{
+		uint count = u_SceneData.LightCount;
+		float scaled = u * float(count);
+		uint entry = min(uint(scaled), count - 1);
+		AliasEntry alias = m_AliasTable.Data[entry];
+		uint lightIndex = scaled - float(entry) < alias.Probability ? entry : alias.Alias;
+		selectionPdf = m_Lights.Data[lightIndex].Power / u_SceneData.LightTotalPower;
+		return lightIndex;
+	}
+
+	if (u_SceneData.LightSampling != LIGHT_SAMPLING_BVH)
+		return INVALID_LIGHT;
+
+	// Walk down picking children by importance, reusing the random number at every level
+	uint nodeIndex = 0;
+	while (m_LightBVH.Data[nodeIndex].LightCount == 0)
+	{
+		uint leftIndex = m_LightBVH.Data[nodeIndex].LeftFirst;
+		float left = LightBVHImportance(leftIndex, position);
+		float right = LightBVHImportance(leftIndex + 1, position);
+		if (left + right <= 0.0)
+			return INVALID_LIGHT;
+
+		float leftProbability = left / (left + right);
+		if (u < leftProbability)
+		{
+			u = min(u / leftProbability, 0.99999994);
+			selectionPdf *= leftProbability;
+			nodeIndex = leftIndex;
+		}
+		else
+		{
+			u = min((u - leftProbability) / (1.0 - leftProbability), 0.99999994);
+			selectionPdf *= 1.0 - leftProbability;
+			nodeIndex = leftIndex + 1;
+		}
+	}
+
+	// Triangles within a leaf by power
+	LightBVHNode leaf = m_LightBVH.Data[nodeIndex];
+	float target = u * leaf.Power;
+	uint lightIndex = leaf.LeftFirst + leaf.LightCount - 1;
+	for (uint i = leaf.LeftFirst; i < leaf.LeftFirst + leaf.LightCount; i++)
+	{
+		target -= m_Lights.Data[i].Power;
+		if (target < 0.0)
+		{
+			lightIndex = i;
+			break;
+		}
+	}
+
+	selectionPdf *= m_Lights.Data[lightIndex].Power / leaf.Power;
+	return lightIndex;
+}
+
+// u.x picks the triangle, u.y and u.z the point on it
+bool SampleLight(vec3 position, vec3 u, out LightSampleRec lightSample)
+{
+	float selectionPdf;
+	uint lightIndex = SelectLight(position, u.x, selectionPdf);
+	if (lightIndex == INVALID_LIGHT)
+		return false;
+
+	// Uniform point on the triangle
+	LightTriangle light = m_Lights.Data[lightIndex];
+	float su = sqrt(u.y);
+	vec3 lightPosition = light.V0 + light.Edge1 * (su * (1.0 - u.z)) + light.Edge2 * (su * u.z);
+
+	vec3 toLight = lightPosition - position;
+	float distanceSquared = dot(toLight, toLight);
+	lightSample.dist = sqrt(distanceSquared);
+	if (lightSample.dist < 1e-6)
+		return false;
+
+	lightSample.direction = toLight / lightSample.dist;
+	lightSample.normal = normalize(cross(light.Edge1, light.Edge2));
+	lightSample.emission = light.Emission;
+
+	// Emitters are two sided, same as adding payload.Emission on any hit
+	float cosLight = abs(dot(lightSample.normal, lightSample.direction));
+	if (cosLight < 1e-6)
+		return false;
+
+	lightSample.pdf = selectionPdf / light.Area * distanceSquared / cosLight;
+	return true;
+}
@@ -0,0 +1,56 @@
+// MaterialBuffer layout of m_Materials, declare the buffer before including this file
+
+struct Material
+{
+	vec3 AlbedoValue;				// 12
+	float MetallicValue;			// 16
+	float RoughnessValue;			// 20
+	vec3 EmissiveValue;				// 32
+	float EmissiveStrength;			// 36
+	uint UseNormalMap;				// 40
+
+	int AlbedoMapIndex;				// 44
+	int MetallicRoughnessMapIndex;	// 48
+	int NormalMapIndex;				// 52
+
+	float Anisotropic;              // 56
+	float Subsurface;               // 60
+	float SpecularTint;             // 64
+	float Sheen;                    // 68
+	float SheenTint;                // 72
+	float Clearcoat;                // 76
+	float ClearcoatRoughness;       // 80
+	float SpecTrans;                // 84
+	float ior;                      // 88
+};
+
+Material UnpackMaterial(uint materialIndex)
+{
+	const uint stride = 88;
+	const uint offset = materialIndex * (stride / 4);
+
+	Material material;
+
+	material.AlbedoValue = vec3(m_Materials.Data[offset + 0], m_Materials.Data[offset + 1], m_Materials.Data[offset + 2]);
+	material.MetallicValue = m_Materials.Data[offset + 3];
+	material.RoughnessValue = m_Materials.Data[offset + 4];
+	material.EmissiveValue = vec3(m_Materials.Data[offset + 5], m_Materials.Data[offset + 6], m_Materials.Data[offset + 7]);
+	material.EmissiveStrength = m_Materials.Data[offset + 8];
+	material.UseNormalMap = floatBitsToUint(m_Materials.Data[offset + 9]);
+
+	material.AlbedoMapIndex = floatBitsToInt(m_Materials.Data[offset + 10]);
+	material.MetallicRoughnessMapIndex = floatBitsToInt(m_Materials.Data[offset + 11]);
+	material.NormalMapIndex = floatBitsToInt(m_Materials.Data[offset + 12]);
+
+	material.Anisotropic = m_Materials.Data[offset + 13];
+	material.Subsurface = m_Materials.Data[offset + 14];
+	material.SpecularTint = m_Materials.Data[offset + 15];
+	material.Sheen = m_Materials.Data[offset + 16];
+	material.SheenTint = m_Materials.Data[offset + 17];
+	material.Clearcoat = m_Materials.Data[offset + 18];
+	material.ClearcoatRoughness = m_Materials.Data[offset + 19];
+	material.SpecTrans = m_Materials.Data[offset + 20];
+	material.ior = m_Materials.Data[offset + 21];
+
+	return material;
+}
@@ -9,7 +9,21 @@ layout(binding = 0) uniform accelerationStructureEXT u_TopLevelAS;
 layout (binding = 1, rgba8) uniform image2D o_Image;
 layout (binding = 2, rgba32f) uniform image2D o_AccumulationImage;
 layout (binding = 10) uniform samplerCube u_Skybox;
-layout (binding = 11) uniform sampler3D u_NoiseTexture;
+layout (binding = 11) uniform sampler3D u_BrickAtlas;
+layout(std430, binding = 12) buffer BrickIndices { uint Data[]; } m_BrickIndices;
+layout(std430, binding = 13) buffer Majorants { vec2 Data[]; } m_Majorants;
+
+// Adaptive sampling, see AdaptiveSampling.glsl
+layout (binding = 14, rgba32f) uniform image2D o_MomentsImage; // x = sum of squared sample luminance
+layout(std430, binding = 15) readonly buffer TileSamples { uint ActiveTileCount; uint Data[]; } m_TileSamples;
+const uint ADAPTIVE_TILE_SIZE = 16;
+
+// First hit AOVs of the denoiser and the reprojection, see Denoise.glsl and Reproject.glsl
+layout (binding = 37, rgba32f) uniform image2D o_AlbedoImage;
+layout (binding = 38, rgba32f) uniform image2D o_NormalDepthImage; // xyz world normal, w hit distance, 0 for misses
+
+// 64x64 void and cluster ranks of the blue noise sampler, see Sampler.glsl
+layout(std430, binding = 39) readonly buffer BlueNoise { uint Data[]; } m_BlueNoise;
 
 struct Ray
 {
@@ -31,11 +45,41 @@ layout(binding = 3) uniform CameraBuffer
 layout(binding = 7) uniform SceneBuffer
 {
 	uint FrameIndex;
+	uint AdaptiveSampling;
+	uint LightCount;
+	uint LightSampling;
 	vec3 AbsorptionFactor;
+	float LightTotalPower;
+
+	// Sparse cloud volume, see BrickVolume.h
+	uvec4 VolumeSize;         // xyz voxels, w brick size
+	uvec4 VolumeBrickGrid;    // xyz bricks, w majorant cell size in voxels
+	uvec4 VolumeMajorantGrid; // xyz majorant cells
+	uvec4 VolumeAtlasSlots;   // xyz atlas slots, w padded brick size
+	vec4 VolumeParams;        // x world to texture scale, y non zero renders the mesh as a cloud container
+
+	// Environment importance sampling, see EnvironmentMap.h
+	uvec2 EnvironmentSize;    // Distribution resolution
+	float EnvironmentIntegral;
+	uint EnvironmentSampling; // 0 leaves the environment to BSDF sampling
+
+	uint WriteAOVs;           // Write o_AlbedoImage and o_NormalDepthImage
+	uint Reproject;           // Accumulate only this frame's paths, Reproject.glsl adds the history
+
+	uint Sampler;             // SAMPLER_* of Sampler.glsl
+	uint SampleStride;        // Most samples a pixel gets in a frame, spaces the sample indices of the frames
 } u_SceneData;
 
 layout(location = 0) rayPayloadEXT Payload g_RayPayload;
 
+// Set by the first bounce of TracePath
+vec3 g_FirstHitAlbedo;
+vec4 g_FirstHitNormalDepth;
+
+#include "assets/shaders/RayTracing/LightSampling.glsl"
+#include "assets/shaders/RayTracing/EnvironmentSampling.glsl"
+#include "assets/shaders/RayTracing/Sampler.glsl"
+
 // ----------------------------------------------------------------------------
 // From DirectX Path Tracing thing
 // ----------------------------------------------------------------------------
@@ -103,7 +147,58 @@ vec3 DisneySample2(Payload payload, vec3 V, vec3 N, out vec3 L, out float pdf, i
 	return vec3(0.0);
 }
 
-vec3 TracePath(Ray ray, inout uint seed)
+// Light sample contribution at a surface hit, without the path throughput. Matches PathTracer::DirectLight.
+vec3 DirectLight(Payload payload, vec3 V, vec3 ffNormal, vec3 u)
+{
+	LightSampleRec lightSample;
+	if (!SampleLight(payload.WorldPosition, u, lightSample))
+		return vec3(0.0);
+
+	float bsdfPdf;
+	vec3 f = DisneyEval(payload, V, ffNormal, lightSample.direction, bsdfPdf);
+	if (bsdfPdf <= 0.0)
+		return vec3(0.0);
+
+	// Any hit ends the shadow ray, the miss shader leaves Distance negative
+	const float EPS = 0.0003;
+	g_RayPayload.Distance = 0.0;
+	uint flags = gl_RayFlagsOpaqueEXT | gl_RayFlagsTerminateOnFirstHitEXT | gl_RayFlagsSkipClosestHitShaderEXT;
+	traceRayEXT(u_TopLevelAS, flags, 0xff, 0, 0, 0, payload.WorldPosition + lightSample.direction * EPS, 0.00001, lightSample.direction, lightSample.dist - 2.0 * EPS, 0);
+	if (g_RayPayload.Distance >= 0.0)
+		return vec3(0.0);
+
+	return f * lightSample.emission * PowerHeuristic(lightSample.pdf, bsdfPdf) / lightSample.pdf;
+}
+
+vec3 EnvironmentRadiance(vec3 direction)
+{
+	return texture(u_Skybox, direction).rgb * 10.0;
+}
+
+// Environment sample contribution at a surface hit, without the path throughput. Matches PathTracer::EnvironmentLight.
+vec3 EnvironmentLight(Payload payload, vec3 V, vec3 ffNormal, vec2 u)
+{
+	float lightPdf;
+	vec3 L = SampleEnvironment(u, lightPdf);
+	if (lightPdf <= 0.0)
+		return vec3(0.0);
+
+	float bsdfPdf;
+	vec3 f = DisneyEval(payload, V, ffNormal, L, bsdfPdf);
+	if (bsdfPdf <= 0.0)
+		return vec3(0.0);
+
+	const float EPS = 0.0003;
+	g_RayPayload.Distance = 0.0;
+	uint flags = gl_RayFlagsOpaqueEXT | gl_RayFlagsTerminateOnFirstHitEXT | gl_RayFlagsSkipClosestHitShaderEXT;
+	traceRayEXT(u_TopLevelAS, flags, 0xff, 0, 0, 0, payload.WorldPosition + L * EPS, 0.00001, L, 1e27, 0);
+	if (g_RayPayload.Distance >= 0.0)
+		return vec3(0.0);
+
+	return f * EnvironmentRadiance(L) * PowerHeuristic(lightPdf, bsdfPdf) / lightPdf;
+}
+
+vec3 TracePath(Ray ray, PixelSampler pixelSampler)
 {
 	uint flags = gl_RayFlagsOpaqueEXT;
 	uint mask = 0xff;
@@ -116,36 +211,67 @@ vec3 TracePath(Ray ray, inout uint seed)
 	vec3 specularComponent = vec3(0.0);
 
 	bool surfaceScatter = false;
+	bool nextEventEstimation = u_SceneData.LightSampling != LIGHT_SAMPLING_NONE;
+	bool environmentSampling = u_SceneData.EnvironmentSampling != 0;
 
 	ScatterSampleRec scatterSample;
+	vec3 scatterPosition;
 
 	for (int bounceIndex = 0; bounceIndex < MAX_BOUNCES; bounceIndex++)
 	{
 		traceRayEXT(u_TopLevelAS, flags, mask, 0, 0, 0, ray.Origin, ray.TMin, ray.Direction, ray.TMax, 0);
 		Payload payload = g_RayPayload;
 
+		if (bounceIndex == 0)
+		{
+			g_FirstHitAlbedo = payload.Distance < 0.0 ? vec3(1.0) : payload.Albedo;
+			g_FirstHitNormalDepth = payload.Distance < 0.0 ? vec4(0.0) : vec4(payload.WorldNormal, payload.Distance);
+		}
+
 		// MISS
 		if (payload.Distance < 0.0)
 		{
-			// Miss, hit sky light
-			vec3 skyColor = vec3(0.7, 0.75, 0.95) * 1.0;
-			skyColor = texture(u_Skybox, ray.Direction).rgb * 10.0;
-			radiance += skyColor * throughput;
+			// Miss, hit sky light. The previous bounce's environment sample could have found this direction too.
+			float misWeight = 1.0;
+			if (environmentSampling && bounceIndex > 0)
+				misWeight = PowerHeuristic(scatterSample.pdf, EnvironmentPdf(ray.Direction));
+
+			radiance += EnvironmentRadiance(ray.Direction) * throughput * misWeight;
             break;
         }
 
-		radiance += payload.Emission * throughput;
+		// Emitters reached by BSDF sampling could also have been picked by the previous bounce's light sample
+		float misWeight = 1.0;
+		if (nextEventEstimation && bounceIndex > 0)
+		{
+			uint lightIndex = GetLightIndex(payload.InstanceIndex, payload.PrimitiveIndex);
+			if (lightIndex != INVALID_LIGHT)
+				misWeight = PowerHeuristic(scatterSample.pdf, LightPdf(scatterPosition, lightIndex, payload.WorldPosition));
+		}
+
+		radiance += payload.Emission * throughput * misWeight;
 
 		{
 			surfaceScatter = true;
 
+			vec3 ffNormal = dot(-ray.Direction, payload.WorldNormal) < 0.0 ? -payload.WorldNormal : payload.WorldNormal;
+
 			// Next event estimation
-			// radiance += DirectLight(r, payload, true) * throughput;
+			if (nextEventEstimation)
+			{
+				vec3 u = SampleDimensions(pixelSampler, BounceSampleSet(bounceIndex, BOUNCE_SET_LIGHT)).xyz;
+				radiance += DirectLight(payload, -ray.Direction, ffNormal, u) * throughput;
+			}
 
-			// Sample BSDF for color and outgoing direction
+			if (environmentSampling)
+			{
+				vec2 u = SampleDimensions(pixelSampler, BounceSampleSet(bounceIndex, BOUNCE_SET_ENVIRONMENT)).xy;
+				radiance += EnvironmentLight(payload, -ray.Direction, ffNormal, u) * throughput;
+			}
 
-			vec3 ffNormal = dot(-ray.Direction, payload.WorldNormal) < 0.0 ? -payload.WorldNormal : payload.WorldNormal;
-			scatterSample.f = DisneySample(payload, -ray.Direction, ffNormal, scatterSample.L, scatterSample.pdf, seed);
+			// Sample BSDF for color and outgoing direction
+			vec3 u = SampleDimensions(pixelSampler, BounceSampleSet(bounceIndex, BOUNCE_SET_BSDF)).xyz;
+			scatterSample.f = DisneySample(payload, -ray.Direction, ffNormal, scatterSample.L, scatterSample.pdf, u);
 			if (scatterSample.pdf > 0.0)
 				throughput *= scatterSample.f / scatterSample.pdf;
 			else
@@ -158,6 +284,7 @@ vec3 TracePath(Ray ray, inout uint seed)
         ray.Direction = scatterSample.L;
 		const float EPS = 0.0003;
         ray.Origin = fhp + ray.Direction * EPS;
+		scatterPosition = payload.WorldPosition;
 
 
 // TODO: RR
@@ -185,6 +312,177 @@ Ray CreateRay(vec3 origin, vec3 direction)
 	return ray;
 }
 
+// ----------------------------------------------------------------------------
+// Sparse cloud volume, matches BrickVolume.cpp and VolumeTracking.cpp
+// ----------------------------------------------------------------------------
+
+const uint EMPTY_BRICK = 0xFFFFFFFF;
+const float ROULETTE_THRESHOLD = 0.1;
+
+uvec3 WrapVoxel(ivec3 value, uvec3 size)
+{
+	ivec3 isize = ivec3(size);
+	return uvec3(value - isize * ivec3(floor(vec3(value) / vec3(size))));
+}
+
+// Voxel i is centered on i, the volume repeats
+float VolumeDensity(vec3 voxelPosition)
+{
+	vec3 floorPosition = floor(voxelPosition);
+	vec3 f = voxelPosition - floorPosition;
+
+	uint brickSize = u_SceneData.VolumeSize.w;
+	uvec3 voxel = WrapVoxel(ivec3(floorPosition), u_SceneData.VolumeSize.xyz);
+	uvec3 brick = voxel / brickSize;
+
+	uvec3 grid = u_SceneData.VolumeBrickGrid.xyz;
+	uint slot = m_BrickIndices.Data[brick.x + grid.x * (brick.y + grid.y * brick.z)];
+	if (slot == EMPTY_BRICK)
+		return 0.0;
+
+	uvec3 slots = u_SceneData.VolumeAtlasSlots.xyz;
+	uint paddedSize = u_SceneData.VolumeAtlasSlots.w;
+	uvec3 texel = uvec3(slot % slots.x, (slot / slots.x) % slots.y, slot / (slots.x * slots.y)) * paddedSize + (voxel - brick * brickSize);
+
+	return textureLod(u_BrickAtlas, (vec3(texel) + f + 0.5) / vec3(slots * paddedSize), 0.0).x;
+}
+
+float VolumeMajorant(ivec3 cell)
+{
+	uvec3 grid = u_SceneData.VolumeMajorantGrid.xyz;
+	uvec3 wrapped = WrapVoxel(cell, grid);
+	return m_Majorants.Data[wrapped.x + grid.x * (wrapped.y + grid.y * wrapped.z)].x;
+}
+
+struct MajorantIterator
+{
+	vec3 Origin;    // Voxel space
+	vec3 Direction; // Voxels per world unit
+	ivec3 Cell;
+	ivec3 Step;
+	vec3 NextT;
+	vec3 DeltaT;
+	float T;
+};
+
+MajorantIterator BeginMajorants(vec3 origin, vec3 direction)
+{
+	vec3 scale = u_SceneData.VolumeParams.x * vec3(u_SceneData.VolumeSize.xyz);
+	float cellSize = float(u_SceneData.VolumeBrickGrid.w);
+
+	MajorantIterator it;
+	it.Origin = origin * scale - 0.5;
+	it.Direction = direction * scale;
+	it.Cell = ivec3(floor(it.Origin / cellSize));
+	it.T = 0.0;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (it.Direction[axis] > 0.0)
+		{
+			it.Step[axis] = 1;
+			it.DeltaT[axis] = cellSize / it.Direction[axis];
+			it.NextT[axis] = (float(it.Cell[axis] + 1) * cellSize - it.Origin[axis]) / it.Direction[axis];
+		}
+		else if (it.Direction[axis] < 0.0)
+		{
+			it.Step[axis] = -1;
+			it.DeltaT[axis] = -cellSize / it.Direction[axis];
+			it.NextT[axis] = (float(it.Cell[axis]) * cellSize - it.Origin[axis]) / it.Direction[axis];
+		}
+		else
+		{
+			it.Step[axis] = 0;
+			it.DeltaT[axis] = 1e27f;
+			it.NextT[axis] = 1e27f;
+		}
+	}
+
+	return it;
+}
+
+// Advances to the next majorant cell, returns the cell's extent along the ray and its majorant
+void NextMajorant(inout MajorantIterator it, float tMax, out float t0, out float t1, out float majorant)
+{
+	int axis = it.NextT.x < it.NextT.y ? (it.NextT.x < it.NextT.z ? 0 : 2) : (it.NextT.y < it.NextT.z ? 1 : 2);
+
+	t0 = it.T;
+	t1 = min(it.NextT[axis], tMax);
+	majorant = VolumeMajorant(it.Cell) * u_SceneData.AbsorptionFactor.x;
+
+	it.T = t1;
+	it.Cell[axis] += it.Step[axis];
+	it.NextT[axis] += it.DeltaT[axis];
+}
+
+float RatioTrackingTransmittance(vec3 origin, vec3 direction, float tMax, inout uint seed)
+{
+	MajorantIterator it = BeginMajorants(origin, direction);
+
+	float transmittance = 1.0;
+	while (it.T < tMax)
+	{
+		float t0, t1, majorant;
+		NextMajorant(it, tMax, t0, t1, majorant);
+
+		// Empty space, no lookups at all
+		if (majorant <= 0.0)
+			continue;
+
+		float t = t0;
+		while (true)
+		{
+			t -= log(1.0 - RandomValue(seed)) / majorant;
+			if (t >= t1)
+				break;
+
+			float sigma = VolumeDensity(it.Origin + it.Direction * t) * u_SceneData.AbsorptionFactor.x;
+			transmittance *= 1.0 - sigma / majorant;
+
+			if (transmittance < ROULETTE_THRESHOLD)
+			{
+				if (RandomValue(seed) * ROULETTE_THRESHOLD >= transmittance)
+					return 0.0;
+				transmittance = ROULETTE_THRESHOLD;
+			}
+		}
+	}
+
+	return transmittance;
+}
+
+bool DeltaTracking(vec3 origin, vec3 direction, float tMax, inout uint seed, out float collisionT)
+{
+	MajorantIterator it = BeginMajorants(origin, direction);
+
+	collisionT = tMax;
+	while (it.T < tMax)
+	{
+		float t0, t1, majorant;
+		NextMajorant(it, tMax, t0, t1, majorant);
+
+		if (majorant <= 0.0)
+			continue;
+
+		float t = t0;
+		while (true)
+		{
+			t -= log(1.0 - RandomValue(seed)) / majorant;
+			if (t >= t1)
+				break;
+
+			float sigma = VolumeDensity(it.Origin + it.Direction * t) * u_SceneData.AbsorptionFactor.x;
+			if (RandomValue(seed) * majorant < sigma)
+			{
+				collisionT = t;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
 vec3 TraceCloudPath(Ray ray, inout uint seed)
 {
 	uint flags = gl_RayFlagsOpaqueEXT;
@@ -196,17 +494,11 @@ vec3 TraceCloudPath(Ray ray, inout uint seed)
 	vec3 throughput = vec3(1.0);
 	vec3 lightPos = vec3(5.0, 0.0, 0.0);
 
-	float totalLightDensity = 0.0;
-
 	// Clouds
 	vec3 lightEnergy = vec3(0.0);
 	float genTransmittance = 1.0;
 	vec3 bgColor = vec3(0.0);
 
-	float var = 0.0;
-
-	float newDistance = 0.0;
-
 	for (int bounceIndex = 0; bounceIndex < MAX_BOUNCES; bounceIndex++)
 	{
 		traceRayEXT(u_TopLevelAS, flags, mask, 0, 0, 0, ray.Origin, ray.TMin, ray.Direction, ray.TMax, 0);
@@ -239,65 +531,20 @@ vec3 TraceCloudPath(Ray ray, inout uint seed)
 
 		float distanceInObject = distance(firstHitPoint, secondHitPoint);
 
-		int sampleCount = 100;
-		float totalDensity = 0.0;
-		int lightSampleCount = 5;
-		vec3 totalLight = vec3(1.0);
-		float sampleDistance = distanceInObject / float(sampleCount);
-		var = sampleDistance;
-
-		float sampleScale = 0.01;
-
-		for (int i = 0;i < sampleCount;i++)
+		// One light ray per real collision instead of one per march step
+		float collisionT;
+		if (DeltaTracking(firstHitPoint, firstHitRay.Direction, distanceInObject, seed, collisionT))
 		{
-			vec3 samplePoint = firstHitPoint + firstHitRay.Direction * i * sampleScale;
+			vec3 collisionPoint = firstHitPoint + firstHitRay.Direction * collisionT;
 
-			if (distance(firstHitPoint, samplePoint) > distanceInObject)
-			{
-				break;
-			}
-
-			const float noiseScale = 0.2;
-			float density = texture(u_NoiseTexture, samplePoint * noiseScale).x;
-
-			newDistance += sampleScale * density;
-
-			Ray lightRay = CreateRay(samplePoint, normalize(lightPos - samplePoint));
+			Ray lightRay = CreateRay(collisionPoint, normalize(lightPos - collisionPoint));
 			traceRayEXT(u_TopLevelAS, flags, mask, 0, 0, 0, lightRay.Origin, lightRay.TMin, lightRay.Direction, lightRay.TMax, 0);
-			Payload lightPayload = g_RayPayload;
-
-			float lightSampleDistance = lightPayload.Distance / lightSampleCount;
+			float lightDistance = g_RayPayload.Distance < 0.0 ? distance(collisionPoint, lightPos) : g_RayPayload.Distance;
 
-			float totalDensityL = 0.0;
-			for (int j = 0; j < lightSampleCount;j++)
-			{
-				vec3 lightSamplePoint = samplePoint + lightRay.Direction * lightSampleDistance * j;
-				float densityL = texture(u_NoiseTexture, lightSamplePoint).x;
-				if (densityL < u_SceneData.AbsorptionFactor.y)
-					totalDensityL += densityL * lightSampleDistance;
-			}
-
-
-			const float lightAbsorptionTowardSun = 0.5;
-			const float darknessThreshold = 0.0;
-			float transmittanceL = exp(-totalDensityL * lightAbsorptionTowardSun);
-			transmittanceL = darknessThreshold + transmittanceL * (1.0 - darknessThreshold);
-			// totalLight *= transmittanceL;
-			// radiance *= transmittanceL;
-			// totalLightDensity = transmittanceL.x;
-
-
-			//if (density > u_SceneData.AbsorptionFactor.y)
-			{
-				totalDensity += density * sampleDistance;
-
-				lightEnergy += density * sampleDistance * genTransmittance * transmittanceL;
-				genTransmittance *= exp(-density * sampleDistance * u_SceneData.AbsorptionFactor.x);
-			}
+			lightEnergy += genTransmittance * RatioTrackingTransmittance(collisionPoint, lightRay.Direction, lightDistance, seed);
 		}
 
-		vec3 transmittance = 1.0 - vec3(exp(-totalDensity * u_SceneData.AbsorptionFactor.x));
-		//radiance += (transmittance);
+		genTransmittance *= RatioTrackingTransmittance(firstHitPoint, firstHitRay.Direction, distanceInObject, seed);
 
 		ray.Origin = secondHitPoint + secondHitRay.Direction * 0.0003;
 	}
@@ -305,33 +552,41 @@ vec3 TraceCloudPath(Ray ray, inout uint seed)
 	//radiance = bgColor * (genTransmittance + lightEnergy);
 	radiance = vec3(genTransmittance);
 
-	//return radiance;
-	return vec3(exp(-newDistance * u_SceneData.AbsorptionFactor.x));
+	return radiance;
 }
 
 void main()
 {
-	uint seed = gl_LaunchIDEXT.x + gl_LaunchIDEXT.y * gl_LaunchSizeEXT.x;
-	seed *= u_SceneData.FrameIndex;
-
 	vec3 color = vec3(0.0);
+	float moment = 0.0;
 
 	const uint SAMPLE_COUNT = 5;
-	for (uint i = 0; i < SAMPLE_COUNT; i++)
+	uint sampleCount = SAMPLE_COUNT;
+	if (u_SceneData.AdaptiveSampling != 0)
+	{
+		// Converged tiles get no samples and keep their accumulated result
+		uvec2 tile = gl_LaunchIDEXT.xy / ADAPTIVE_TILE_SIZE;
+		uint tilesX = (gl_LaunchSizeEXT.x + ADAPTIVE_TILE_SIZE - 1) / ADAPTIVE_TILE_SIZE;
+		sampleCount = m_TileSamples.Data[tile.x + tile.y * tilesX];
+		if (sampleCount == 0)
+			return;
+	}
+
+	for (uint i = 0; i < sampleCount; i++)
 	{
+		uint sampleIndex = SampleIndex(u_SceneData.FrameIndex, u_SceneData.SampleStride, i);
+		PixelSampler pixelSampler = BeginPixelSample(u_SceneData.Sampler, gl_LaunchIDEXT.xy, gl_LaunchSizeEXT.x, sampleIndex);
+
 		vec2 pixelCenter = vec2(gl_LaunchIDEXT.xy) + vec2(0.5);
 
 		if (i > 0)
         {
-			pixelCenter += RandomPointInCircle(seed);
+			pixelCenter += PointInCircle(SampleDimensions(pixelSampler, SAMPLE_SET_PIXEL).xy);
         }
 
 		vec2 inUV = pixelCenter / vec2(gl_LaunchSizeEXT.xy);
  		vec2 d = inUV * 2.0 - 1.0;
 
-		//vec3 density = texture(u_NoiseTexture, vec3(u_SceneData.FrameIndex / 10000, inUV)).xyz;
-		//imageStore(o_Image, ivec2(gl_LaunchIDEXT.xy), vec4(density, 1));
-
 		vec4 target = u_CameraBuffer.InverseProjection * vec4(d.x, d.y, 1, 1);
 		vec4 direction = u_CameraBuffer.InverseView * vec4(normalize(target.xyz / target.w), 0);
 
@@ -341,11 +596,38 @@ void main()
 		ray.TMin = 0.00001;
 		ray.TMax = 1e27f;
 
-		color += TracePath(ray, seed);
+		vec3 pathColor;
+		if (u_SceneData.VolumeParams.y != 0.0)
+		{
+			// The mesh surfaces bound the cloud, rays between an entry and an exit hit are tracked through it
+			uint seed = HashUInt(HashCombine(pixelSampler.Seed, sampleIndex));
+			pathColor = TraceCloudPath(ray, seed);
+			g_FirstHitAlbedo = vec3(1.0);
+			g_FirstHitNormalDepth = vec4(0.0);
+		}
+		else
+		{
+			pathColor = TracePath(ray, pixelSampler);
+		}
+		color += pathColor;
+		moment += Luminance(pathColor) * Luminance(pathColor);
+
+		// The first sample goes through the pixel center, so the AOVs don't change between frames
+		if (i == 0 && u_SceneData.WriteAOVs != 0)
+		{
+			imageStore(o_AlbedoImage, ivec2(gl_LaunchIDEXT.xy), vec4(g_FirstHitAlbedo, 1.0));
+			imageStore(o_NormalDepthImage, ivec2(gl_LaunchIDEXT.xy), g_FirstHitNormalDepth);
+		}
 	}
 
-	float numPaths = SAMPLE_COUNT;
-	if (u_SceneData.FrameIndex > 1)
+	float numPaths = sampleCount;
+	if (u_SceneData.Reproject != 0)
+	{
+		// After a camera move, stage 1 of Reproject.glsl adds the history and writes o_Image
+		imageStore(o_AccumulationImage, ivec2(gl_LaunchIDEXT.xy), vec4(color, numPaths));
+		imageStore(o_MomentsImage, ivec2(gl_LaunchIDEXT.xy), vec4(moment, 0.0, 0.0, 0.0));
+	}
+	else if (u_SceneData.FrameIndex > 1)
 	{	
 		// Load the accumulation image, W component is the numPaths.
 		vec4 data = imageLoad(o_AccumulationImage, ivec2(gl_LaunchIDEXT.xy));
@@ -354,14 +636,18 @@ void main()
 
 		// Add previous color to current color.
 		color += previousColor;
-		numPaths = numPreviousPaths + SAMPLE_COUNT;
+		numPaths = numPreviousPaths + sampleCount;
 
 		imageStore(o_AccumulationImage, ivec2(gl_LaunchIDEXT.xy), vec4(color, numPaths));
+
+		moment += imageLoad(o_MomentsImage, ivec2(gl_LaunchIDEXT.xy)).x;
+		imageStore(o_MomentsImage, ivec2(gl_LaunchIDEXT.xy), vec4(moment, 0.0, 0.0, 0.0));
 	}
 	else
 	{
 		// On the first frame, fill the accumulation image with black.
 		imageStore(o_AccumulationImage, ivec2(gl_LaunchIDEXT.xy), vec4(0.0));
+		imageStore(o_MomentsImage, ivec2(gl_LaunchIDEXT.xy), vec4(0.0));
 	}
 
 	color /= numPaths;
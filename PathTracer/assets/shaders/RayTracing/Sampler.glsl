@@ -0,0 +1,149 @@
+// Sample sets of the path tracer, matches CPU/Sampler.cpp. Declare m_BlueNoise before including this file.
+
+const uint SAMPLER_RANDOM = 0;
+const uint SAMPLER_SOBOL = 1;
+const uint SAMPLER_BLUE_NOISE = 2;
+
+// Set 0 jitters the camera ray inside the pixel, each bounce then has one set per decision
+const uint SAMPLE_SET_PIXEL = 0;
+
+const uint BOUNCE_SET_LIGHT = 0;       // xyz
+const uint BOUNCE_SET_ENVIRONMENT = 1; // xy
+const uint BOUNCE_SET_BSDF = 2;        // xy direction, z lobe
+const uint BOUNCE_SET_RR = 3;          // x, reserved for Russian roulette
+const uint BOUNCE_SET_COUNT = 4;
+
+const uint BLUE_NOISE_SIZE = 64;
+const uint BLUE_NOISE_STEP = 1048576u; // 2^32 / 64^2
+
+uint BounceSampleSet(uint bounceIndex, uint dimension)
+{
+	return 1 + bounceIndex * BOUNCE_SET_COUNT + dimension;
+}
+
+uint HashUInt(uint x)
+{
+	x ^= x >> 16;
+	x *= 0x85ebca6bu;
+	x ^= x >> 13;
+	x *= 0xc2b2ae35u;
+	x ^= x >> 16;
+	return x;
+}
+
+uint HashCombine(uint seed, uint value)
+{
+	return seed ^ (value + (seed << 6) + (seed >> 2));
+}
+
+uint NestedUniformScramble(uint x, uint seed)
+{
+	x = bitfieldReverse(x);
+	x += seed;
+	x ^= x * 0x6c50b47cu;
+	x ^= x * 0xb82f1e52u;
+	x ^= x * 0xc7afe638u;
+	x ^= x * 0x8d22f6e6u;
+	return bitfieldReverse(x);
+}
+
+// 32 direction numbers for each of dimensions 1 to 3, dimension 0 is the van der Corput sequence
+const uint SOBOL_DIRECTIONS[96] = uint[](
+	0x80000000u, 0xc0000000u, 0xa0000000u, 0xf0000000u, 0x88000000u, 0xcc000000u, 0xaa000000u, 0xff000000u,
+	0x80800000u, 0xc0c00000u, 0xa0a00000u, 0xf0f00000u, 0x88880000u, 0xcccc0000u, 0xaaaa0000u, 0xffff0000u,
+	0x80008000u, 0xc000c000u, 0xa000a000u, 0xf000f000u, 0x88008800u, 0xcc00cc00u, 0xaa00aa00u, 0xff00ff00u,
+	0x80808080u, 0xc0c0c0c0u, 0xa0a0a0a0u, 0xf0f0f0f0u, 0x88888888u, 0xccccccccu, 0xaaaaaaaau, 0xffffffffu,
+
+	0x80000000u, 0xc0000000u, 0x60000000u, 0x90000000u, 0xe8000000u, 0x5c000000u, 0x8e000000u, 0xc5000000u,
+	0x68800000u, 0x9cc00000u, 0xee600000u, 0x55900000u, 0x80680000u, 0xc09c0000u, 0x60ee0000u, 0x90550000u,
+	0xe8808000u, 0x5cc0c000u, 0x8e606000u, 0xc5909000u, 0x6868e800u, 0x9c9c5c00u, 0xeeee8e00u, 0x5555c500u,
+	0x8000e880u, 0xc0005cc0u, 0x60008e60u, 0x9000c590u, 0xe8006868u, 0x5c009c9cu, 0x8e00eeeeu, 0xc5005555u,
+
+	0x80000000u, 0xc0000000u, 0x20000000u, 0x50000000u, 0xf8000000u, 0x74000000u, 0xa2000000u, 0x93000000u,
+	0xd8800000u, 0x25400000u, 0x59e00000u, 0xe6d00000u, 0x78080000u, 0xb40c0000u, 0x82020000u, 0xc3050000u,
+	0x208f8000u, 0x51474000u, 0xfbea2000u, 0x75d93000u, 0xa0858800u, 0x914e5400u, 0xdbe79e00u, 0x25db6d00u,
+	0x58800080u, 0xe54000c0u, 0x79e00020u, 0xb6d00050u, 0x800800f8u, 0xc00c0074u, 0x200200a2u, 0x50050093u
+);
+
+// All 4 dimensions at once, without branches on the bits of the scrambled index
+uvec4 Sobol(uint index)
+{
+	uvec4 x = uvec4(bitfieldReverse(index), 0, 0, 0);
+	for (uint bit = 0; index != 0; bit++, index >>= 1)
+	{
+		uint mask = 0u - (index & 1u);
+		x.y ^= SOBOL_DIRECTIONS[bit] & mask;
+		x.z ^= SOBOL_DIRECTIONS[32 + bit] & mask;
+		x.w ^= SOBOL_DIRECTIONS[64 + bit] & mask;
+	}
+	return x;
+}
+
+float UIntToUnitFloat(uint x)
+{
+	return float(x >> 8) * 5.96046448e-8;
+}
+
+struct PixelSampler
+{
+	uint Type;
+	uint Index;
+	uint Seed;
+	uvec2 Pixel;
+};
+
+PixelSampler BeginPixelSample(uint type, uvec2 pixel, uint width, uint sampleIndex)
+{
+	PixelSampler pixelSampler;
+	pixelSampler.Type = type;
+	pixelSampler.Index = sampleIndex;
+	pixelSampler.Pixel = pixel;
+
+	// Blue noise shares one sequence between all pixels, the mask decorrelates them
+	if (type == SAMPLER_BLUE_NOISE)
+		pixelSampler.Seed = HashUInt(0u);
+	else
+		pixelSampler.Seed = HashUInt(HashCombine(HashUInt(pixel.x + pixel.y * width), 0u));
+
+	return pixelSampler;
+}
+
+vec4 SampleDimensions(PixelSampler pixelSampler, uint set)
+{
+	uint setSeed = HashUInt(HashCombine(pixelSampler.Seed, set));
+
+	vec4 u;
+	if (pixelSampler.Type == SAMPLER_RANDOM)
+	{
+		uint sampleSeed = HashUInt(HashCombine(setSeed, pixelSampler.Index));
+		for (uint i = 0; i < 4; i++)
+			u[i] = UIntToUnitFloat(HashUInt(HashCombine(sampleSeed, i)));
+		return u;
+	}
+
+	uvec4 sobol = Sobol(NestedUniformScramble(pixelSampler.Index, setSeed));
+	for (uint i = 0; i < 4; i++)
+	{
+		uint dimensionSeed = HashUInt(HashCombine(setSeed, i));
+		uint x = NestedUniformScramble(sobol[i], dimensionSeed);
+
+		if (pixelSampler.Type == SAMPLER_BLUE_NOISE)
+		{
+			// Cranley-Patterson rotation by the mask, shifted differently for every dimension
+			uint shiftX = (pixelSampler.Pixel.x + (dimensionSeed & 0xFFFFu)) % BLUE_NOISE_SIZE;
+			uint shiftY = (pixelSampler.Pixel.y + (dimensionSeed >> 16)) % BLUE_NOISE_SIZE;
+			uint rank = m_BlueNoise.Data[shiftX + shiftY * BLUE_NOISE_SIZE];
+			x += rank * BLUE_NOISE_STEP + BLUE_NOISE_STEP / 2;
+		}
+
+		u[i] = UIntToUnitFloat(x);
+	}
+
+	return u;
+}
+
+// Index of a sample of a pixel over the frames, frame 1's accumulation is thrown away
+uint SampleIndex(uint frameIndex, uint stride, uint sampleIndex)
+{
+	return (max(frameIndex, 2u) - 2u) * stride + sampleIndex;
+}
@@ -0,0 +1,73 @@
+// Vertex layout of m_VertexBuffers, declare the buffer before including this file
+
+struct Vertex
+{
+	vec3 Position;      // 12
+	vec2 TextureCoords; // 20
+	vec3 Normal;        // 32
+	vec4 Tangent;       // 48
+	vec3 Binormal;      // 60
+};
+
+Vertex UnpackVertex(uint vertexBufferIndex, uint index, uint vertexOffset)
+{
+	index += vertexOffset;
+
+	Vertex vertex;
+
+	const int stride = 48;
+	const int offset = stride / 4;
+
+	vertex.Position = vec3(
+		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 0],
+		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 1],
+		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 2]
+	);
+
+	vertex.TextureCoords = vec2(
+		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 3],
+		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 4]
+	);
+
+	vertex.Normal = vec3(
+		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 5],
+		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 6],
+		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 7]
+	);
+
+	vertex.Tangent = vec4(
+		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 8],
+		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 9],
+		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 10],
+		m_VertexBuffers[vertexBufferIndex].Data[offset * index + 11]
+	);
+
+	vertex.Binormal = cross(normalize(vertex.Tangent.xyz), normalize(vertex.Normal)) * vertex.Tangent.w;
+
+	return vertex;
+}
+
+Vertex InterpolateVertex(Vertex vertices[3], vec3 barycentrics)
+{
+	Vertex vertex;
+	vertex.Position = vec3(0.0);
+	vertex.TextureCoords = vec2(0.0);
+	vertex.Normal = vec3(0.0);
+	vertex.Tangent = vec4(0.0);
+	vertex.Binormal = vec3(0.0);
+	
+	for (uint i = 0; i < 3; i++)
+	{
+		vertex.Position += vertices[i].Position * barycentrics[i];
+		vertex.TextureCoords += vertices[i].TextureCoords * barycentrics[i];
+		vertex.Normal += vertices[i].Normal * barycentrics[i];
+		vertex.Tangent += vertices[i].Tangent * barycentrics[i];
+		vertex.Binormal += vertices[i].Binormal * barycentrics[i];
+	}
+
+	vertex.Normal = normalize(vertex.Normal);
+	vertex.Tangent = normalize(vertex.Tangent);
+	vertex.Binormal = normalize(vertex.Binormal);
+
+	return vertex;	
+}
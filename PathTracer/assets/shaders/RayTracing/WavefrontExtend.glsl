@@ -0,0 +1,49 @@
+#Shader RayGen
+#version 460
+#extension GL_EXT_ray_tracing : require
+#include "assets/shaders/RayTracing/WavefrontQueues.glsl"
+
+// Extend stage of the wavefront integrator. Traces the current half of the ray queue, adds the sky to
+// paths that miss and appends a hit record for everything else. Launched with one invocation per
+// pixel, the invocations past the queue's count return straight away.
+
+layout(binding = 0) uniform accelerationStructureEXT u_TopLevelAS;
+layout(binding = 10) uniform samplerCube u_Skybox;
+
+layout(location = 0) rayPayloadEXT WavefrontPayload g_RayPayload;
+
+void main()
+{
+	uint index = gl_LaunchIDEXT.x + gl_LaunchIDEXT.y * gl_LaunchSizeEXT.x;
+	uint pathCount = gl_LaunchSizeEXT.x * gl_LaunchSizeEXT.y;
+
+	uint queueIndex = m_QueueCounters.QueueIndex;
+	if (index >= m_QueueCounters.RayCount[queueIndex])
+		return;
+
+	vec4 origin = m_RayOrigins.Data[queueIndex * pathCount + index];
+	vec3 direction = m_RayDirections.Data[queueIndex * pathCount + index].xyz;
+	uint path = floatBitsToUint(origin.w);
+
+	uint flags = gl_RayFlagsOpaqueEXT;
+	uint mask = 0xff;
+	traceRayEXT(u_TopLevelAS, flags, mask, 0, 0, 0, origin.xyz, 0.00001, direction, 1e27f, 0);
+
+	// MISS, same sky as TracePath in RayGen.glsl
+	if (g_RayPayload.Distance < 0.0)
+	{
+		vec3 skyColor = texture(u_Skybox, direction).rgb * 10.0;
+		m_PathRadiance.Data[path].rgb += skyColor * m_PathThroughput.Data[path].rgb;
+		return;
+	}
+
+	// Hits are appended, so the shade stage only sees live paths
+	uint hit = atomicAdd(m_QueueCounters.HitCount, 1);
+
+	vec3 hitPoint = origin.xyz + direction * g_RayPayload.Distance;
+	m_HitPositions.Data[hit] = vec4(hitPoint, uintBitsToFloat(path));
+	m_HitNormals.Data[hit] = vec4(g_RayPayload.WorldNormal, g_RayPayload.TextureCoords.x);
+	m_HitTangents.Data[hit] = vec4(g_RayPayload.Tangent, g_RayPayload.TextureCoords.y);
+	m_HitBinormals.Data[hit] = vec4(g_RayPayload.Binormal, uintBitsToFloat(g_RayPayload.MaterialIndex));
+	m_HitDirections.Data[hit] = vec4(direction, g_RayPayload.Distance);
+}
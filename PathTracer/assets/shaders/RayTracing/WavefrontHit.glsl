@@ -0,0 +1,61 @@
+#Shader ClosestHit
+#version 460
+#extension GL_EXT_ray_tracing : require
+#extension GL_EXT_nonuniform_qualifier : enable
+#include "assets/shaders/RayTracing/WavefrontQueues.glsl"
+
+// Geometry half of ClosestHit.glsl, the material is fetched by the shade stage once hits are sorted
+
+layout(location = 0) rayPayloadInEXT WavefrontPayload g_RayPayload;
+
+hitAttributeEXT vec2 g_HitAttributes;
+
+layout(std430, binding = 4) buffer Vertices		{ float Data[];	} m_VertexBuffers[];
+layout(std430, binding = 5) buffer Indices		{ uint Data[];	} m_IndexBuffers[];
+layout(std430, binding = 6) buffer SubmeshData	{ uint Data[];	} m_SubmeshData;
+layout(std430, binding = 40) buffer InstanceData	{ uint Data[];	} m_InstanceData;
+
+#include "assets/shaders/RayTracing/Vertex.glsl"
+#include "assets/shaders/RayTracing/CompactVertex.glsl"
+
+void main()
+{
+	// Instances of a mesh share its submesh records, only the material can differ
+	uint submeshIndex = m_InstanceData.Data[gl_InstanceCustomIndexEXT * 2 + 0];
+	uint materialIndex = m_InstanceData.Data[gl_InstanceCustomIndexEXT * 2 + 1];
+
+	uint bufferIndex = m_SubmeshData.Data[submeshIndex * 4 + 0];
+	uint vertexOffset = m_SubmeshData.Data[submeshIndex * 4 + 1];
+	uint indexOffset = m_SubmeshData.Data[submeshIndex * 4 + 2];
+
+	uint index0 = m_IndexBuffers[bufferIndex].Data[gl_PrimitiveID * 3 + 0 + indexOffset];
+	uint index1 = m_IndexBuffers[bufferIndex].Data[gl_PrimitiveID * 3 + 1 + indexOffset];
+	uint index2 = m_IndexBuffers[bufferIndex].Data[gl_PrimitiveID * 3 + 2 + indexOffset];
+
+	vec3 barycentrics = vec3(1.0 - g_HitAttributes.x - g_HitAttributes.y, g_HitAttributes.x, g_HitAttributes.y);
+
+	Vertex vertex;
+	if (UseCompactVertices())
+	{
+		vertex = InterpolateCompactVertex(submeshIndex, uvec3(index0, index1, index2) + vertexOffset, barycentrics);
+	}
+	else
+	{
+		Vertex vertices[3] = Vertex[](
+			UnpackVertex(bufferIndex, index0, vertexOffset),
+			UnpackVertex(bufferIndex, index1, vertexOffset),
+			UnpackVertex(bufferIndex, index2, vertexOffset)
+		);
+		vertex = InterpolateVertex(vertices, barycentrics);
+	}
+
+	// Same basis as WorldNormalMatrix in ClosestHit.glsl
+	mat3 objectToWorld = mat3(gl_ObjectToWorldEXT);
+
+	g_RayPayload.Distance		= gl_HitTEXT;
+	g_RayPayload.WorldNormal	= normalize(objectToWorld * vertex.Normal);
+	g_RayPayload.Tangent		= normalize(objectToWorld * vertex.Tangent.xyz);
+	g_RayPayload.Binormal		= normalize(objectToWorld * vertex.Binormal);
+	g_RayPayload.TextureCoords	= vertex.TextureCoords;
+	g_RayPayload.MaterialIndex	= materialIndex;
+}
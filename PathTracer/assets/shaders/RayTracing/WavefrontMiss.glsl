@@ -0,0 +1,11 @@
+#Shader Miss
+#version 460
+#extension GL_EXT_ray_tracing : require
+#include "assets/shaders/RayTracing/WavefrontQueues.glsl"
+
+layout(location = 0) rayPayloadInEXT WavefrontPayload g_RayPayload;
+
+void main()
+{
+	g_RayPayload.Distance = -1.0;
+}
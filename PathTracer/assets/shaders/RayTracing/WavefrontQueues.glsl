@@ -0,0 +1,34 @@
+// Structure-of-arrays queues of the wavefront integrator, see Wavefront.glsl. One path per pixel is in
+// flight at a time, every array holds one entry per pixel except the ray queue, which holds two halves
+// that the extend and shade stages ping-pong between. CPU implementation in CPU/Wavefront.cpp.
+
+layout(std430, binding = 16) buffer QueueCounters
+{
+	uint RayCount[2];
+	uint HitCount;
+	uint QueueIndex; // Half of the ray queue the next extend stage reads
+} m_QueueCounters;
+
+layout(std430, binding = 17) buffer PathRadiance	{ vec4 Data[]; } m_PathRadiance;	// rgb radiance
+layout(std430, binding = 18) buffer PathThroughput	{ vec4 Data[]; } m_PathThroughput;	// rgb throughput, w seed bits
+layout(std430, binding = 19) buffer RayOrigins		{ vec4 Data[]; } m_RayOrigins;		// xyz origin, w path index bits
+layout(std430, binding = 20) buffer RayDirections	{ vec4 Data[]; } m_RayDirections;	// xyz direction
+layout(std430, binding = 21) buffer HitPositions	{ vec4 Data[]; } m_HitPositions;	// xyz world position, w path index bits
+layout(std430, binding = 22) buffer HitNormals		{ vec4 Data[]; } m_HitNormals;		// xyz world normal, w texture coordinate u
+layout(std430, binding = 23) buffer HitTangents		{ vec4 Data[]; } m_HitTangents;		// xyz world tangent, w texture coordinate v
+layout(std430, binding = 24) buffer HitBinormals	{ vec4 Data[]; } m_HitBinormals;	// xyz world binormal, w material index bits
+layout(std430, binding = 25) buffer HitDirections	{ vec4 Data[]; } m_HitDirections;	// xyz ray direction, w hit distance
+layout(std430, binding = 26) buffer MaterialBins	{ uint Data[]; } m_MaterialBins;	// Hit count per material, then scatter offset per material
+layout(std430, binding = 27) buffer SortedHits		{ uint Data[]; } m_SortedHits;		// Hit queue indices ordered by material
+layout(std430, binding = 28) buffer SampleSums		{ vec4 Data[]; } m_SampleSums;		// Per pixel rgb sum of the frame's samples, w sum of squared luminance
+
+// What the closest hit shader of the extend stage reports, shading happens later in Wavefront.glsl
+struct WavefrontPayload
+{
+	float Distance;
+	vec3 WorldNormal;
+	vec3 Tangent;
+	vec3 Binormal;
+	vec2 TextureCoords;
+	uint MaterialIndex;
+};
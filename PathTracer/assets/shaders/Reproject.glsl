@@ -0,0 +1,160 @@
+#Shader Compute
+
+#version 450 core
+
+// Temporal reprojection of the accumulation after a camera move. Stage 0 runs before the ray tracing
+// pass and copies the accumulation, moments and first hit normal + distance of the previous camera
+// into the history images. RayGen.glsl then writes only the paths of the new frame, and stage 1 adds
+// the history seen by the first hit through every pixel center to them. History pixels whose hit
+// distance or normal don't match are disocclusions and are dropped. CPU reference in CPU/Reprojection.cpp.
+
+layout(binding = 0, rgba32f) uniform image2D u_AccumulationImage; // rgb sum, a path count
+layout(binding = 1, rgba32f) uniform image2D u_MomentsImage;
+layout(binding = 2, rgba32f) uniform image2D u_NormalDepthImage; // xyz world normal, w first hit distance, 0 for misses
+layout(binding = 3, rgba32f) uniform image2D u_HistoryAccumulationImage;
+layout(binding = 4, rgba32f) uniform image2D u_HistoryMomentsImage;
+layout(binding = 5, rgba32f) uniform image2D u_HistoryNormalDepthImage;
+layout(binding = 6, rgba32f) writeonly uniform image2D u_OutputImage;
+
+layout(binding = 7) uniform CameraBuffer
+{
+	mat4 ViewProjection;
+	mat4 InverseViewProjection;
+	mat4 View;
+	mat4 InverseView;
+	mat4 InverseProjection;
+} u_CameraBuffer;
+
+// Camera of the history
+layout(binding = 8) uniform HistoryCameraBuffer
+{
+	mat4 ViewProjection;
+	mat4 InverseViewProjection;
+	mat4 View;
+	mat4 InverseView;
+	mat4 InverseProjection;
+} u_HistoryCameraBuffer;
+
+layout (push_constant) uniform Uniforms
+{
+	uint Stage;
+	float DepthTolerance;
+	float NormalThreshold;
+	float MaxHistorySamples;
+} u_Uniforms;
+
+// History with less bilinear weight than this is a disocclusion
+const float MIN_HISTORY_WEIGHT = 1e-3;
+
+void StoreHistory(ivec2 pixel)
+{
+	imageStore(u_HistoryAccumulationImage, pixel, imageLoad(u_AccumulationImage, pixel));
+	imageStore(u_HistoryMomentsImage, pixel, imageLoad(u_MomentsImage, pixel));
+	imageStore(u_HistoryNormalDepthImage, pixel, imageLoad(u_NormalDepthImage, pixel));
+}
+
+// Bilinear blend of the history pixels around the reprojected first hit that pass the depth and
+// normal tests, as path sum + count and moment sum
+bool FetchHistory(ivec2 pixel, ivec2 size, out vec4 accumulation, out float moment)
+{
+	vec4 normalDepth = imageLoad(u_NormalDepthImage, pixel);
+
+	// Same ray as the first sample of RayGen.glsl, hits are reprojected as points and misses as directions
+	vec2 d = (vec2(pixel) + vec2(0.5)) / vec2(size) * 2.0 - 1.0;
+	vec4 target = u_CameraBuffer.InverseProjection * vec4(d.x, d.y, 1, 1);
+	vec3 direction = normalize((u_CameraBuffer.InverseView * vec4(normalize(target.xyz / target.w), 0)).xyz);
+	vec3 origin = u_CameraBuffer.InverseView[3].xyz;
+
+	bool hit = normalDepth.w > 0.0;
+	vec3 hitPosition = origin + direction * normalDepth.w;
+	vec4 position = hit ? vec4(hitPosition, 1.0) : vec4(direction, 0.0);
+
+	// Where the first hit was seen in the history, the motion vector is the pixel center minus this
+	vec4 clip = u_HistoryCameraBuffer.ViewProjection * position;
+	if (clip.w <= 0.0)
+		return false;
+	vec2 previousPixel = (clip.xy / clip.w * 0.5 + 0.5) * vec2(size);
+
+	float expectedDistance = length(hitPosition - u_HistoryCameraBuffer.InverseView[3].xyz);
+
+	vec2 base = previousPixel - vec2(0.5);
+	ivec2 tapOrigin = ivec2(floor(base));
+	vec2 fraction = base - floor(base);
+
+	float sumWeight = 0.0;
+	vec4 sumAccumulation = vec4(0.0);
+	float sumMoment = 0.0;
+
+	for (int tap = 0; tap < 4; tap++)
+	{
+		ivec2 offset = ivec2(tap & 1, tap >> 1);
+		ivec2 q = tapOrigin + offset;
+		if (any(lessThan(q, ivec2(0))) || any(greaterThanEqual(q, size)))
+			continue;
+
+		vec4 history = imageLoad(u_HistoryNormalDepthImage, q);
+
+		// A hit that lands on a miss or the other way around is always a disocclusion
+		if (hit != (history.w > 0.0))
+			continue;
+
+		if (hit)
+		{
+			if (abs(history.w - expectedDistance) > u_Uniforms.DepthTolerance * expectedDistance)
+				continue;
+
+			if (dot(normalDepth.xyz, history.xyz) < u_Uniforms.NormalThreshold)
+				continue;
+		}
+
+		float weight = (offset.x != 0 ? fraction.x : 1.0 - fraction.x) * (offset.y != 0 ? fraction.y : 1.0 - fraction.y);
+		sumWeight += weight;
+		sumAccumulation += imageLoad(u_HistoryAccumulationImage, q) * weight;
+		sumMoment += imageLoad(u_HistoryMomentsImage, q).x * weight;
+	}
+
+	if (sumWeight < MIN_HISTORY_WEIGHT)
+		return false;
+
+	accumulation = sumAccumulation / sumWeight;
+	moment = sumMoment / sumWeight;
+	return accumulation.w > 0.0;
+}
+
+void Reproject(ivec2 pixel, ivec2 size)
+{
+	vec4 accumulation = imageLoad(u_AccumulationImage, pixel);
+
+	vec4 history;
+	float historyMoment;
+	if (FetchHistory(pixel, size, history, historyMoment))
+	{
+		// Sample count aware blend, the new paths weigh in by their share of the combined count
+		float scale = min(1.0, u_Uniforms.MaxHistorySamples / history.w);
+		accumulation += history * scale;
+		imageStore(u_AccumulationImage, pixel, accumulation);
+
+		float moment = imageLoad(u_MomentsImage, pixel).x + historyMoment * scale;
+		imageStore(u_MomentsImage, pixel, vec4(moment, 0.0, 0.0, 0.0));
+	}
+
+	vec3 color = accumulation.rgb / accumulation.w;
+	if (any(isnan(color)))
+		imageStore(u_OutputImage, pixel, vec4(1, 0, 0, 1));
+	else
+		imageStore(u_OutputImage, pixel, vec4(color, 1));
+}
+
+layout(local_size_x = 16, local_size_y = 16, local_size_z = 1) in;
+void main()
+{
+	ivec2 size = imageSize(u_AccumulationImage);
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+	if (pixel.x >= size.x || pixel.y >= size.y)
+		return;
+
+	if (u_Uniforms.Stage == 0)
+		StoreHistory(pixel);
+	else
+		Reproject(pixel, size);
+}
@@ -0,0 +1,328 @@
+#Shader Compute
+
+#version 460
+#extension GL_EXT_nonuniform_qualifier : enable
+
+// Compute stages of the wavefront integrator, the optional alternative to the TracePath megakernel in
+// RayGen.glsl. Every sample of the frame runs generate, then extend (WavefrontExtend.glsl), sort,
+// shade and continue once per bounce, then accumulate. The stages talk through the queues in
+// WavefrontQueues.glsl. CPU implementation in CPU/Wavefront.cpp.
+
+#include "assets/shaders/RayTracing/Disney.glsl"
+#include "assets/shaders/RayTracing/WavefrontQueues.glsl"
+
+layout (binding = 1, rgba8) uniform image2D o_Image;
+layout (binding = 2, rgba32f) uniform image2D o_AccumulationImage;
+layout (binding = 14, rgba32f) uniform image2D o_MomentsImage; // x = sum of squared sample luminance
+
+layout(binding = 3) uniform CameraBuffer
+{
+	mat4 ViewProjection;
+	mat4 InverseViewProjection;
+	mat4 View;
+	mat4 InverseView;
+	mat4 InverseProjection;
+} u_CameraBuffer;
+
+layout(binding = 7) uniform SceneBuffer
+{
+	uint FrameIndex;
+	uint AdaptiveSampling;
+	uint LightCount;
+	uint LightSampling;
+	vec3 AbsorptionFactor;
+	float LightTotalPower;
+
+	uvec4 VolumeSize;
+	uvec4 VolumeBrickGrid;
+	uvec4 VolumeMajorantGrid;
+	uvec4 VolumeAtlasSlots;
+	vec4 VolumeParams;
+
+	uvec2 EnvironmentSize;
+	float EnvironmentIntegral;
+	uint EnvironmentSampling;
+} u_SceneData;
+
+layout(std430, binding = 8) buffer Materials { float Data[]; } m_Materials;
+layout(std430, binding = 36) buffer MaterialLobes { uint Data[]; } m_MaterialLobes;
+layout(binding = 9) uniform sampler2D u_Textures[];
+
+#include "assets/shaders/RayTracing/Material.glsl"
+
+layout (push_constant) uniform Uniforms
+{
+	uint Stage;
+	uint SampleIndex;
+	uint SampleCount;
+	uint Bounce;
+	uint MaxBounces;
+	uint MaterialCount;
+	uint SortByMaterial;
+} u_Uniforms;
+
+const uint STAGE_GENERATE		= 0;
+const uint STAGE_SORT_COUNT		= 1;
+const uint STAGE_SORT_OFFSETS	= 2;
+const uint STAGE_SORT_SCATTER	= 3;
+const uint STAGE_SHADE			= 4;
+const uint STAGE_CONTINUE		= 5;
+const uint STAGE_ACCUMULATE		= 6;
+
+const uint WORKGROUP_SIZE = 256;
+
+// Dispatches are two dimensional so large images stay under the workgroup count limit
+uint GlobalIndex()
+{
+	return gl_GlobalInvocationID.x + gl_GlobalInvocationID.y * gl_NumWorkGroups.x * WORKGROUP_SIZE;
+}
+
+uint GetPathCount()
+{
+	ivec2 size = imageSize(o_AccumulationImage);
+	return uint(size.x * size.y);
+}
+
+// Camera ray of one sample per pixel into the first half of the ray queue, same rays as main() in RayGen.glsl
+void Generate()
+{
+	ivec2 size = imageSize(o_AccumulationImage);
+	uint pathCount = uint(size.x * size.y);
+	uint index = GlobalIndex();
+
+	if (index == 0)
+	{
+		m_QueueCounters.RayCount[0] = pathCount;
+		m_QueueCounters.RayCount[1] = 0;
+		m_QueueCounters.HitCount = 0;
+		m_QueueCounters.QueueIndex = 0;
+	}
+
+	if (index >= pathCount)
+		return;
+
+	// Samples are traced in separate waves, so every one of them starts from its own seed
+	uint seed = index * u_SceneData.FrameIndex + u_Uniforms.SampleIndex * 0x9E3779B9u;
+	PCG_Hash(seed);
+
+	vec2 pixelCenter = vec2(index % size.x, index / size.x) + vec2(0.5);
+	if (u_Uniforms.SampleIndex > 0)
+		pixelCenter += RandomPointInCircle(seed);
+
+	vec2 inUV = pixelCenter / vec2(size);
+	vec2 d = inUV * 2.0 - 1.0;
+
+	vec4 target = u_CameraBuffer.InverseProjection * vec4(d.x, d.y, 1, 1);
+	vec4 direction = u_CameraBuffer.InverseView * vec4(normalize(target.xyz / target.w), 0);
+
+	m_RayOrigins.Data[index] = vec4(u_CameraBuffer.InverseView[3].xyz, uintBitsToFloat(index));
+	m_RayDirections.Data[index] = vec4(normalize(direction.xyz), 0.0);
+	m_PathRadiance.Data[index] = vec4(0.0);
+	m_PathThroughput.Data[index] = vec4(vec3(1.0), uintBitsToFloat(seed));
+
+	if (u_Uniforms.SampleIndex == 0)
+		m_SampleSums.Data[index] = vec4(0.0);
+}
+
+uint GetHitMaterial(uint hit)
+{
+	return floatBitsToUint(m_HitBinormals.Data[hit].w);
+}
+
+// Counting sort of the hit queue by material, so neighbouring shade invocations run the same material
+void SortCount()
+{
+	uint index = GlobalIndex();
+	if (index >= m_QueueCounters.HitCount)
+		return;
+
+	atomicAdd(m_MaterialBins.Data[GetHitMaterial(index)], 1);
+}
+
+// Scenes have tens of materials, a serial scan on one invocation is cheaper than another dispatch
+void SortOffsets()
+{
+	if (GlobalIndex() != 0)
+		return;
+
+	uint offset = 0;
+	for (uint material = 0; material < u_Uniforms.MaterialCount; material++)
+	{
+		uint count = m_MaterialBins.Data[material];
+		m_MaterialBins.Data[material] = 0;
+		m_MaterialBins.Data[u_Uniforms.MaterialCount + material] = offset;
+		offset += count;
+	}
+}
+
+void SortScatter()
+{
+	uint index = GlobalIndex();
+	if (index >= m_QueueCounters.HitCount)
+		return;
+
+	uint slot = atomicAdd(m_MaterialBins.Data[u_Uniforms.MaterialCount + GetHitMaterial(index)], 1);
+	m_SortedHits.Data[slot] = index;
+}
+
+// Material fetch, textures and DisneySample of the bounce loop in TracePath. Continuation rays are
+// appended to the other half of the ray queue, which compacts away the paths that ended.
+void Shade()
+{
+	uint index = GlobalIndex();
+	if (index >= m_QueueCounters.HitCount)
+		return;
+
+	uint hit = u_Uniforms.SortByMaterial != 0 ? m_SortedHits.Data[index] : index;
+
+	vec4 position = m_HitPositions.Data[hit];
+	vec4 normal = m_HitNormals.Data[hit];
+	vec4 tangent = m_HitTangents.Data[hit];
+	vec4 binormal = m_HitBinormals.Data[hit];
+	vec4 direction = m_HitDirections.Data[hit];
+
+	uint path = floatBitsToUint(position.w);
+	vec2 textureCoords = vec2(normal.w, tangent.w);
+	uint materialIndex = floatBitsToUint(binormal.w);
+	Material material = UnpackMaterial(materialIndex);
+
+	vec3 AlbedoTextureValue = vec3(1.0);
+	if (material.AlbedoMapIndex != -1)
+		AlbedoTextureValue = texture(u_Textures[nonuniformEXT(material.AlbedoMapIndex)], textureCoords).rgb;
+
+	vec2 MetallicRoughnessMapTextureValue = vec2(1.0);
+	if (material.MetallicRoughnessMapIndex != -1)
+		MetallicRoughnessMapTextureValue = texture(u_Textures[nonuniformEXT(material.MetallicRoughnessMapIndex)], textureCoords).bg;
+
+	vec3 view = -direction.xyz;
+
+	// Same payload ClosestHit.glsl fills in
+	Payload payload;
+	payload.Distance			= direction.w;
+	payload.Albedo				= material.AlbedoValue * AlbedoTextureValue;
+	payload.Roughness			= material.RoughnessValue * MetallicRoughnessMapTextureValue.y;
+	payload.Metallic			= material.MetallicValue * MetallicRoughnessMapTextureValue.x;
+	payload.Emission			= material.EmissiveValue * material.EmissiveStrength;
+	payload.WorldPosition		= position.xyz;
+	payload.WorldNormal			= normal.xyz;
+	payload.WorldNormalMatrix	= mat3(tangent.xyz, binormal.xyz, normal.xyz);
+	payload.Binormal			= binormal.xyz;
+	payload.Tangent				= tangent.xyz;
+	payload.View				= view;
+	payload.WorldRayDirection	= direction.xyz;
+
+	payload.Anisotropic = material.Anisotropic;
+	payload.Subsurface = material.Subsurface;
+	payload.SpecularTint = material.SpecularTint;
+	payload.Sheen = material.Sheen;
+	payload.SheenTint = material.SheenTint;
+	payload.Clearcoat = material.Clearcoat;
+	payload.ClearcoatRoughness = material.ClearcoatRoughness;
+	payload.SpecTrans = material.SpecTrans;
+	payload.ior = material.ior;
+
+	float aspect = sqrt(1.0 - payload.Anisotropic * 0.9);
+	payload.ax = max(0.001, payload.Roughness / aspect);
+	payload.ay = max(0.001, payload.Roughness * aspect);
+	payload.eta = dot(view, payload.WorldNormal) < 0.0 ? (1.0 / payload.ior) : payload.ior;
+	payload.Lobes = m_MaterialLobes.Data[materialIndex];
+
+	vec4 throughput = m_PathThroughput.Data[path];
+	uint seed = floatBitsToUint(throughput.w);
+
+	m_PathRadiance.Data[path].rgb += payload.Emission * throughput.rgb;
+
+	ScatterSampleRec scatterSample;
+	vec3 ffNormal = dot(view, payload.WorldNormal) < 0.0 ? -payload.WorldNormal : payload.WorldNormal;
+	scatterSample.f = DisneySample(payload, view, ffNormal, scatterSample.L, scatterSample.pdf, seed);
+
+	if (scatterSample.pdf > 0.0)
+		throughput.rgb *= scatterSample.f / scatterSample.pdf;
+
+	m_PathThroughput.Data[path] = vec4(throughput.rgb, uintBitsToFloat(seed));
+
+	if (scatterSample.pdf <= 0.0 || u_Uniforms.Bounce + 1 >= u_Uniforms.MaxBounces)
+		return;
+
+	uint pathCount = GetPathCount();
+	uint nextQueue = 1 - m_QueueCounters.QueueIndex;
+	uint slot = atomicAdd(m_QueueCounters.RayCount[nextQueue], 1);
+
+	const float EPS = 0.0003;
+	m_RayOrigins.Data[nextQueue * pathCount + slot] = vec4(position.xyz + scatterSample.L * EPS, uintBitsToFloat(path));
+	m_RayDirections.Data[nextQueue * pathCount + slot] = vec4(scatterSample.L, 0.0);
+}
+
+// Swaps the ray queue halves and empties the hit queue for the next bounce
+void Continue()
+{
+	if (GlobalIndex() != 0)
+		return;
+
+	uint queueIndex = m_QueueCounters.QueueIndex;
+	m_QueueCounters.RayCount[queueIndex] = 0;
+	m_QueueCounters.QueueIndex = 1 - queueIndex;
+	m_QueueCounters.HitCount = 0;
+}
+
+// Adds the finished sample to the frame's sums, the last sample resolves them like main() in RayGen.glsl
+void Accumulate()
+{
+	ivec2 size = imageSize(o_AccumulationImage);
+	uint index = GlobalIndex();
+	if (index >= uint(size.x * size.y))
+		return;
+
+	vec3 pathColor = m_PathRadiance.Data[index].rgb;
+	vec4 sums = m_SampleSums.Data[index] + vec4(pathColor, Luminance(pathColor) * Luminance(pathColor));
+	m_SampleSums.Data[index] = sums;
+
+	if (u_Uniforms.SampleIndex + 1 < u_Uniforms.SampleCount)
+		return;
+
+	ivec2 pixel = ivec2(index % size.x, index / size.x);
+	vec3 color = sums.rgb;
+	float moment = sums.w;
+
+	float numPaths = u_Uniforms.SampleCount;
+	if (u_SceneData.FrameIndex > 1)
+	{
+		// W component is the numPaths
+		vec4 data = imageLoad(o_AccumulationImage, pixel);
+		color += data.xyz;
+		numPaths = data.w + u_Uniforms.SampleCount;
+
+		imageStore(o_AccumulationImage, pixel, vec4(color, numPaths));
+
+		moment += imageLoad(o_MomentsImage, pixel).x;
+		imageStore(o_MomentsImage, pixel, vec4(moment, 0.0, 0.0, 0.0));
+	}
+	else
+	{
+		// On the first frame, fill the accumulation image with black
+		imageStore(o_AccumulationImage, pixel, vec4(0.0));
+		imageStore(o_MomentsImage, pixel, vec4(0.0));
+	}
+
+	color /= numPaths;
+
+	if (any(isnan(color)))
+		imageStore(o_Image, pixel, vec4(1, 0, 0, 1));
+	else
+		imageStore(o_Image, pixel, vec4(color, 1));
+}
+
+layout(local_size_x = WORKGROUP_SIZE, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+	switch (u_Uniforms.Stage)
+	{
+		case STAGE_GENERATE:		Generate();		break;
+		case STAGE_SORT_COUNT:		SortCount();	break;
+		case STAGE_SORT_OFFSETS:	SortOffsets();	break;
+		case STAGE_SORT_SCATTER:	SortScatter();	break;
+		case STAGE_SHADE:			Shade();		break;
+		case STAGE_CONTINUE:		Continue();		break;
+		case STAGE_ACCUMULATE:		Accumulate();	break;
+	}
+}
@@ -0,0 +1,278 @@
+#include "Benchmark/BSDFBenchmark.h"
+#include "Benchmark/BenchmarkCommon.h"
+#include "CPU/Disney.h"
+#include "CPU/Sampling.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <string>
+
+using namespace VkLibrary;
+
+static constexpr uint32_t s_DefaultSamples = 1 << 18;
+static constexpr uint32_t s_MaterialCount = 4096;
+static constexpr uint32_t s_DirectionsPerMaterial = 64;
+static constexpr uint32_t s_DirectionCount = 4096;
+
+// Variants run the same operations as the full model, anything above rounding is a bug
+static constexpr float s_Tolerance = 1e-5f;
+
+static std::string LobeNames(uint32_t lobes)
+{
+	static const char* names[] = { "Diffuse", "Sheen", "Subsurface", "Metal", "Glass", "Clearcoat" };
+
+	std::string result;
+	for (uint32_t i = 0; i < 6; i++)
+	{
+		if ((lobes & (1 << i)) == 0)
+			continue;
+		if (!result.empty())
+			result += "+";
+		result += names[i];
+	}
+	return result.empty() ? "None" : result;
+}
+
+// Zero, one or anything in between, so every lobe gets switched off
+static float RandomWeight(uint32_t& seed)
+{
+	float r = CPU::RandomValue(seed);
+	if (r < 0.4f)
+		return 0.0f;
+	if (r < 0.6f)
+		return 1.0f;
+	return CPU::RandomValue(seed);
+}
+
+static MaterialBuffer RandomMaterial(uint32_t& seed)
+{
+	MaterialBuffer material = {};
+	material.data.AlbedoValue = glm::vec3(CPU::RandomValue(seed), CPU::RandomValue(seed), CPU::RandomValue(seed));
+	material.data.MetallicValue = RandomWeight(seed);
+	material.data.RoughnessValue = 0.02f + 0.98f * CPU::RandomValue(seed);
+	material.data.AlbedoMapIndex = -1;
+	material.data.MetallicRoughnessMapIndex = CPU::RandomValue(seed) < 0.25f ? 0 : -1;
+	material.data.NormalMapIndex = -1;
+
+	material.Anisotropic = RandomWeight(seed) * 0.9f;
+	material.Subsurface = RandomWeight(seed);
+	material.SpecularTint = RandomWeight(seed);
+	material.Sheen = RandomWeight(seed);
+	material.SheenTint = RandomWeight(seed);
+	material.Clearcoat = RandomWeight(seed);
+	material.ClearcoatRoughness = 0.02f + 0.98f * CPU::RandomValue(seed);
+	material.SpecTrans = RandomWeight(seed);
+	material.ior = 1.1f + CPU::RandomValue(seed);
+	return material;
+}
+
+// Scene::FillPayload for the BSDF inputs, a metallic roughness texture scales metallic like on the GPU
+static CPU::Payload MakePayload(const MaterialBuffer& material, bool entering, uint32_t& seed)
+{
+	CPU::Payload payload = {};
+	payload.Albedo = material.data.AlbedoValue;
+	payload.Metallic = material.data.MetallicValue;
+	payload.Roughness = material.data.RoughnessValue;
+	if (material.data.MetallicRoughnessMapIndex != -1)
+		payload.Metallic *= CPU::RandomValue(seed) < 0.5f ? CPU::RandomValue(seed) : 1.0f;
+
+	payload.Anisotropic = material.Anisotropic;
+	payload.Subsurface = material.Subsurface;
+	payload.SpecularTint = material.SpecularTint;
+	payload.Sheen = material.Sheen;
+	payload.SheenTint = material.SheenTint;
+	payload.Clearcoat = material.Clearcoat;
+	payload.ClearcoatRoughness = material.ClearcoatRoughness;
+	payload.SpecTrans = material.SpecTrans;
+	payload.ior = material.ior;
+
+	float aspect = glm::sqrt(1.0f - payload.Anisotropic * 0.9f);
+	payload.ax = glm::max(0.001f, payload.Roughness / aspect);
+	payload.ay = glm::max(0.001f, payload.Roughness * aspect);
+	payload.eta = entering ? 1.0f / payload.ior : payload.ior;
+	payload.Lobes = CPU::ClassifyMaterial(material);
+	return payload;
+}
+
+static float RelativeDifference(const glm::vec3& a, const glm::vec3& b)
+{
+	float scale = glm::max(glm::max(glm::abs(a.x), glm::abs(a.y)), glm::max(glm::abs(a.z), 1e-6f));
+	glm::vec3 difference = glm::abs(a - b);
+	return glm::max(glm::max(difference.x, difference.y), difference.z) / scale;
+}
+
+static float RelativeDifference(float a, float b)
+{
+	return glm::abs(a - b) / glm::max(glm::abs(a), 1e-6f);
+}
+
+static bool ValidateVariants()
+{
+	std::map<uint32_t, uint32_t> masks;
+	uint32_t comparisons = 0, mismatches = 0, seedMismatches = 0;
+	float maxDifference = 0.0f;
+
+	uint32_t seed = 1;
+	for (uint32_t m = 0; m < s_MaterialCount; m++)
+	{
+		MaterialBuffer material = RandomMaterial(seed);
+		CPU::Payload payload = MakePayload(material, m % 2 == 0, seed);
+		CPU::Payload fullPayload = payload;
+		fullPayload.Lobes = CPU::LOBE_ALL;
+		masks[payload.Lobes]++;
+
+		for (uint32_t d = 0; d < s_DirectionsPerMaterial; d++)
+		{
+			glm::vec3 N = CPU::UniformSampleSphere(CPU::RandomValue(seed), CPU::RandomValue(seed));
+			glm::vec3 V = CPU::UniformSampleSphere(CPU::RandomValue(seed), CPU::RandomValue(seed));
+			glm::vec3 L = CPU::UniformSampleSphere(CPU::RandomValue(seed), CPU::RandomValue(seed));
+			if (glm::dot(V, N) < 0.0f)
+				V = -V;
+
+			float pdf, fullPdf;
+			glm::vec3 f = CPU::DisneyEval(payload, V, N, L, pdf);
+			glm::vec3 fullF = CPU::DisneyEval(fullPayload, V, N, L, fullPdf);
+
+			uint32_t sampleSeed = seed, fullSampleSeed = seed;
+			glm::vec3 sampleL, fullSampleL;
+			float samplePdf, fullSamplePdf;
+			glm::vec3 sampleF = CPU::DisneySample(payload, V, N, sampleL, samplePdf, sampleSeed);
+			glm::vec3 fullSampleF = CPU::DisneySample(fullPayload, V, N, fullSampleL, fullSamplePdf, fullSampleSeed);
+			seed = sampleSeed;
+
+			float difference = glm::max(glm::max(RelativeDifference(fullF, f), RelativeDifference(fullPdf, pdf)),
+				glm::max(glm::max(RelativeDifference(fullSampleF, sampleF), RelativeDifference(fullSamplePdf, samplePdf)), RelativeDifference(fullSampleL, sampleL)));
+
+			// NaN compares false, count it as a mismatch too
+			if (!(difference <= s_Tolerance))
+				mismatches++;
+			else
+				maxDifference = glm::max(maxDifference, difference);
+
+			if (sampleSeed != fullSampleSeed)
+				seedMismatches++;
+
+			comparisons++;
+		}
+	}
+
+	printf("variants: %zu lobe masks over %u materials, %u comparisons, max relative difference %g, %u mismatches, %u seed mismatches\n",
+		masks.size(), s_MaterialCount, comparisons, maxDifference, mismatches, seedMismatches);
+
+	return mismatches == 0 && seedMismatches == 0;
+}
+
+struct TimedMaterial
+{
+	const char* Name;
+	float Metallic;
+	float SpecTrans;
+	float Sheen;
+	float Subsurface;
+	float Clearcoat;
+};
+
+static void TimeVariants(uint32_t samples)
+{
+	static const TimedMaterial materials[] = {
+		{ "Dielectric",              0.0f, 0.0f, 0.0f, 0.0f, 0.0f },
+		{ "Metal",                   1.0f, 0.0f, 0.0f, 0.0f, 0.0f },
+		{ "Dielectric + Metal",      0.5f, 0.0f, 0.0f, 0.0f, 0.0f },
+		{ "Glass",                   0.0f, 1.0f, 0.0f, 0.0f, 0.0f },
+		{ "Sheen + Clearcoat",       0.0f, 0.0f, 0.5f, 0.0f, 0.5f },
+		{ "Every lobe",              0.3f, 0.3f, 0.5f, 0.5f, 0.5f },
+	};
+
+	uint32_t seed = 5;
+	std::vector<glm::vec3> directions(s_DirectionCount * 2);
+	for (glm::vec3& direction : directions)
+		direction = CPU::UniformSampleSphere(CPU::RandomValue(seed), CPU::RandomValue(seed));
+
+	printf("%-22s %-48s %12s %12s %8s\n", "material", "lobes", "full ns", "variant ns", "speedup");
+	for (const TimedMaterial& timed : materials)
+	{
+		MaterialBuffer material = {};
+		material.data.AlbedoValue = glm::vec3(0.8f, 0.6f, 0.4f);
+		material.data.MetallicValue = timed.Metallic;
+		material.data.RoughnessValue = 0.4f;
+		material.data.MetallicRoughnessMapIndex = -1;
+		material.SpecTrans = timed.SpecTrans;
+		material.Sheen = timed.Sheen;
+		material.Subsurface = timed.Subsurface;
+		material.Clearcoat = timed.Clearcoat;
+		material.ClearcoatRoughness = 0.1f;
+		material.ior = 1.5f;
+
+		uint32_t payloadSeed = 0;
+		CPU::Payload payload = MakePayload(material, true, payloadSeed);
+		CPU::Payload fullPayload = payload;
+		fullPayload.Lobes = CPU::LOBE_ALL;
+
+		// Sample and evaluate, as a bounce with next event estimation does
+		auto run = [&](const CPU::Payload& p)
+		{
+			glm::vec3 N = glm::vec3(0.0f, 0.0f, 1.0f);
+			glm::vec3 sum = glm::vec3(0.0f);
+			uint32_t sampleSeed = 9;
+			Clock::time_point start = Clock::now();
+			for (uint32_t i = 0; i < samples; i++)
+			{
+				glm::vec3 V = directions[(i * 2) % directions.size()];
+				V.z = glm::abs(V.z);
+
+				glm::vec3 L;
+				float pdf, evalPdf;
+				sum += CPU::DisneySample(p, V, N, L, pdf, sampleSeed) * pdf;
+				sum += CPU::DisneyEval(p, V, N, directions[(i * 2 + 1) % directions.size()], evalPdf) * evalPdf;
+			}
+			double seconds = SecondsSince(start);
+
+			// Keeps the loop from being optimized out
+			if (sum.x == -1.0f)
+				printf(" ");
+			return seconds * 1e9 / samples;
+		};
+
+		double fullTime = run(fullPayload);
+		double variantTime = run(payload);
+		printf("%-22s %-48s %12.1f %12.1f %7.2fx\n", timed.Name, LobeNames(payload.Lobes).c_str(), fullTime, variantTime, fullTime / variantTime);
+	}
+}
+
+static void PrintModelLobes(const std::string& model)
+{
+	Ref<MeshSource> meshSource = CreateRef<MeshSource>(model);
+
+	std::map<uint32_t, uint32_t> masks;
+	for (const MaterialBuffer& material : meshSource->GetMaterialBuffers())
+		masks[CPU::ClassifyMaterial(material)]++;
+
+	printf("%s: %zu materials\n", model.c_str(), meshSource->GetMaterialBuffers().size());
+	for (const auto& [lobes, count] : masks)
+		printf("  %-48s %u\n", LobeNames(lobes).c_str(), count);
+}
+
+int RunBSDFBenchmark(int argc, char** argv)
+{
+	std::string model = s_SponzaModel;
+	uint32_t samples = s_DefaultSamples;
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (strcmp(argv[i], "--model") == 0)
+			model = argv[++i];
+		else if (strcmp(argv[i], "--samples") == 0)
+			samples = (uint32_t)strtoul(argv[++i], nullptr, 10);
+	}
+
+	bool passed = ValidateVariants();
+	TimeVariants(samples);
+
+	if (std::filesystem::exists(model))
+		PrintModelLobes(model);
+	else
+		printf("%s: not found\n", model.c_str());
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+// `PathTracer --bench-bsdf [--model file.gltf] [--samples n]` checks that the Disney BSDF variant
+// picked by each material's lobe mask matches the full model: random materials with lobes switched
+// off at random are evaluated and sampled through both, which must agree on f, pdf, the sampled
+// direction and the random numbers used. Then times sample + eval per variant against the full
+// model and prints the lobe masks of the model's materials. Returns 1 if a variant disagrees.
+int RunBSDFBenchmark(int argc, char** argv);
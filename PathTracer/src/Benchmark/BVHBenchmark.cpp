@@ -0,0 +1,238 @@
+#include "Benchmark/BVHBenchmark.h"
+#include "Benchmark/BenchmarkCommon.h"
+#include "CPU/Scene.h"
+#include "CPU/Sampling.h"
+#include "CPU/ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+using namespace VkLibrary;
+
+// Primary rays cover a s_ImageSize x s_ImageSize image, one ray per pixel
+static constexpr uint32_t s_ImageSize = 1024;
+static constexpr uint32_t s_TileWidth = 4;
+static constexpr uint32_t s_TileHeight = CPU::RayPacket::Size / s_TileWidth;
+
+static constexpr uint32_t s_ValidationCount = 1024;
+static constexpr uint32_t s_ChunkSize = 4096;
+
+struct RaySet
+{
+	const char* Name;
+	std::vector<CPU::Ray> Rays;
+	bool Shadow = false;
+};
+
+// Camera rays from outside the scene bounds along -z. Pixels are ordered in small tiles so every
+// packet of consecutive rays covers neighbouring pixels.
+static std::vector<CPU::Ray> GeneratePrimaryRays(const CPU::Scene& scene)
+{
+	glm::vec3 center = (scene.GetBoundsMin() + scene.GetBoundsMax()) * 0.5f;
+	float radius = glm::length(scene.GetBoundsMax() - scene.GetBoundsMin()) * 0.5f;
+	glm::vec3 origin = center + glm::vec3(0.0f, 0.0f, radius * 2.0f);
+
+	std::vector<CPU::Ray> rays(s_ImageSize * s_ImageSize);
+	uint32_t tilesPerRow = s_ImageSize / s_TileWidth;
+	for (uint32_t i = 0; i < (uint32_t)rays.size(); i++)
+	{
+		uint32_t tile = i / CPU::RayPacket::Size;
+		uint32_t lane = i % CPU::RayPacket::Size;
+		uint32_t x = (tile % tilesPerRow) * s_TileWidth + lane % s_TileWidth;
+		uint32_t y = (tile / tilesPerRow) * s_TileHeight + lane / s_TileWidth;
+
+		glm::vec2 uv = (glm::vec2(x, y) + 0.5f) / (float)s_ImageSize * 2.0f - 1.0f;
+		rays[i].Origin = origin;
+		rays[i].Direction = glm::normalize(glm::vec3(uv * 0.5f, -1.0f));
+	}
+
+	return rays;
+}
+
+// Shadow rays towards a point light above the scene and cosine distributed diffuse rays, both from
+// the primary hits. Diffuse rays of neighbouring pixels go in unrelated directions.
+static void GenerateSecondaryRays(const CPU::Scene& scene, const std::vector<CPU::Ray>& primaryRays, std::vector<CPU::Ray>& shadowRays, std::vector<CPU::Ray>& diffuseRays)
+{
+	std::vector<CPU::Hit> hits(primaryRays.size());
+	CPU::ThreadPool::Get().ParallelFor((uint32_t)primaryRays.size() / s_ChunkSize, [&](uint32_t chunk)
+	{
+		for (uint32_t i = chunk * s_ChunkSize; i < (chunk + 1) * s_ChunkSize; i++)
+			scene.Intersect(primaryRays[i], hits[i]);
+	});
+
+	glm::vec3 extent = scene.GetBoundsMax() - scene.GetBoundsMin();
+	glm::vec3 center = (scene.GetBoundsMin() + scene.GetBoundsMax()) * 0.5f;
+	glm::vec3 light = glm::vec3(center.x, scene.GetBoundsMax().y + extent.y * 0.5f, center.z);
+	float offset = glm::length(extent) * 1e-5f;
+
+	for (uint32_t i = 0; i < (uint32_t)primaryRays.size(); i++)
+	{
+		if (hits[i].Distance < 0.0f)
+			continue;
+
+		CPU::Payload payload;
+		scene.FillPayload(primaryRays[i], hits[i], payload);
+
+		glm::vec3 normal = glm::dot(payload.WorldNormal, primaryRays[i].Direction) > 0.0f ? -payload.WorldNormal : payload.WorldNormal;
+		glm::vec3 origin = payload.WorldPosition + normal * offset;
+
+		CPU::Ray& shadowRay = shadowRays.emplace_back();
+		shadowRay.Origin = origin;
+		shadowRay.Direction = glm::normalize(light - origin);
+		shadowRay.TMax = glm::length(light - origin);
+
+		uint32_t seed = i * 7919u + 3u;
+		glm::vec3 tangent, binormal;
+		CPU::Onb(normal, tangent, binormal);
+		glm::vec3 local = CPU::CosineSampleHemisphere(CPU::RandomValue(seed), CPU::RandomValue(seed));
+
+		CPU::Ray& diffuseRay = diffuseRays.emplace_back();
+		diffuseRay.Origin = origin;
+		diffuseRay.Direction = glm::normalize(tangent * local.x + binormal * local.y + normal * local.z);
+	}
+}
+
+// Mrays/s over the whole set, traceChunk(begin, end) returns the rays that hit
+template<typename TraceFunc>
+static double MeasureRaysPerSecond(const RaySet& set, std::atomic<uint32_t>& hits, TraceFunc traceChunk)
+{
+	uint32_t count = (uint32_t)set.Rays.size();
+	hits = 0;
+
+	Clock::time_point start = Clock::now();
+	CPU::ThreadPool::Get().ParallelFor((count + s_ChunkSize - 1) / s_ChunkSize, [&](uint32_t chunk)
+	{
+		uint32_t begin = chunk * s_ChunkSize;
+		hits += traceChunk(begin, std::min(begin + s_ChunkSize, count));
+	});
+
+	return count / SecondsSince(start) * 1e-6;
+}
+
+// Returns false if any validated ray disagrees with the brute force reference
+static bool BenchmarkRays(CPU::Scene& scene, const RaySet& set)
+{
+	if (set.Rays.empty())
+		return true;
+
+	std::atomic<uint32_t> hits = 0;
+	printf("  %-8s %8zu rays |", set.Name, set.Rays.size());
+
+	// Single rays with every node test the CPU supports
+	for (int level = 0; level <= (int)CPU::GetSupportedSIMDLevel(); level++)
+	{
+		scene.SetSIMDLevel((CPU::SIMDLevel)level);
+		double raysPerSecond = MeasureRaysPerSecond(set, hits, [&](uint32_t begin, uint32_t end)
+		{
+			uint32_t chunkHits = 0;
+			for (uint32_t i = begin; i < end; i++)
+			{
+				CPU::Hit hit;
+				chunkHits += (set.Shadow ? scene.Occluded(set.Rays[i]) : scene.Intersect(set.Rays[i], hit)) ? 1 : 0;
+			}
+			return chunkHits;
+		});
+		printf(" %s %7.2f |", CPU::GetSIMDLevelName((CPU::SIMDLevel)level), raysPerSecond);
+	}
+
+	auto tracePackets = [&](uint32_t begin, uint32_t end, CPU::Hit* hits)
+	{
+		uint32_t packetHits = 0;
+		for (uint32_t first = begin; first < end; first += CPU::RayPacket::Size)
+		{
+			CPU::RayPacket packet;
+			packet.Count = std::min(CPU::RayPacket::Size, end - first);
+			for (uint32_t ray = 0; ray < packet.Count; ray++)
+			{
+				packet.Origins[ray] = set.Rays[first + ray].Origin;
+				packet.Directions[ray] = set.Rays[first + ray].Direction;
+				packet.TMin[ray] = set.Rays[first + ray].TMin;
+				packet.TMax[ray] = set.Rays[first + ray].TMax;
+			}
+
+			scene.Intersect(packet, hits + (first - begin));
+			for (uint32_t ray = 0; ray < packet.Count; ray++)
+				packetHits += hits[first - begin + ray].Distance >= 0.0f ? 1 : 0;
+		}
+		return packetHits;
+	};
+
+	// Packets always look for the closest hit, there is no any hit packet query
+	if (!set.Shadow)
+	{
+		double raysPerSecond = MeasureRaysPerSecond(set, hits, [&](uint32_t begin, uint32_t end)
+		{
+			std::vector<CPU::Hit> chunkHits(end - begin);
+			return tracePackets(begin, end, chunkHits.data());
+		});
+		printf(" packets %7.2f |", raysPerSecond);
+	}
+
+	// Compare against the brute force reference on a subset
+	uint32_t validationCount = std::min(s_ValidationCount, (uint32_t)set.Rays.size());
+	std::vector<CPU::Hit> packetHits(validationCount);
+	tracePackets(0, validationCount, packetHits.data());
+
+	std::atomic<uint32_t> mismatches = 0;
+	CPU::ThreadPool::Get().ParallelFor(validationCount, [&](uint32_t i)
+	{
+		CPU::Hit hit, reference;
+		scene.IntersectBruteForce(set.Rays[i], reference);
+		if (set.Shadow)
+		{
+			if (scene.Occluded(set.Rays[i]) != (reference.Distance >= 0.0f))
+				mismatches++;
+			return;
+		}
+
+		scene.Intersect(set.Rays[i], hit);
+		if (hit.Distance != reference.Distance || packetHits[i].Distance != reference.Distance)
+			mismatches++;
+	});
+
+	printf(" Mrays/s (%u threads), %5.1f%% %s, %u/%u mismatches vs brute force\n", CPU::ThreadPool::Get().GetThreadCount(),
+		100.0 * hits / set.Rays.size(), set.Shadow ? "occluded" : "hit", (uint32_t)mismatches, validationCount);
+	return mismatches == 0;
+}
+
+int RunBVHBenchmark(int argc, char** argv)
+{
+	std::vector<std::string> models = GetModelArguments(argc, argv, { s_CornellBoxModel, s_SuzanneModel, s_SponzaModel });
+
+	printf("Node tests up to %s\n", CPU::GetSIMDLevelName(CPU::GetSupportedSIMDLevel()));
+
+	bool passed = true;
+	for (const std::string& model : models)
+	{
+		Clock::time_point start = Clock::now();
+		Ref<MeshSource> meshSource = CreateRef<MeshSource>(model);
+		double loadSeconds = SecondsSince(start);
+
+		start = Clock::now();
+		CPU::Scene scene(meshSource, glm::mat4(1.0f));
+		double buildSeconds = SecondsSince(start);
+
+		if (scene.GetInstances().empty())
+		{
+			printf("%s: no geometry\n", model.c_str());
+			continue;
+		}
+
+		uint32_t triangleCount = (uint32_t)scene.GetIndices().size() / 3;
+		printf("%s: %u triangles, %u submeshes, load %.2f ms, BVH build %.2f ms\n", model.c_str(),
+			triangleCount, (uint32_t)scene.GetInstances().size(), loadSeconds * 1000.0, buildSeconds * 1000.0);
+
+		RaySet primary = { "primary", GeneratePrimaryRays(scene) };
+		RaySet shadow = { "shadow", {}, true };
+		RaySet diffuse = { "diffuse", {}, false };
+		GenerateSecondaryRays(scene, primary.Rays, shadow.Rays, diffuse.Rays);
+
+		passed &= BenchmarkRays(scene, primary);
+		passed &= BenchmarkRays(scene, shadow);
+		passed &= BenchmarkRays(scene, diffuse);
+	}
+
+	return passed ? 0 : 1;
+}
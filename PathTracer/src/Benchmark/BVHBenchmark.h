@@ -0,0 +1,6 @@
+#pragma once
+
+// `PathTracer --bench-bvh [--model path]...` reports CPU BVH build time and rays/sec for primary, shadow and
+// diffuse rays with every node test the CPU supports, single rays and packets. Returns 1 if any ray disagrees
+// with the brute force reference
+int RunBVHBenchmark(int argc, char** argv);
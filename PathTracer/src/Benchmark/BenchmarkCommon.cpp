@@ -0,0 +1,115 @@
+#include "Benchmark/BenchmarkCommon.h"
+#include "Benchmark/RenderBenchmark.h"
+#include "Benchmark/BVHBenchmark.h"
+#include "Benchmark/VolumeBenchmark.h"
+#include "Benchmark/RefitBenchmark.h"
+#include "Benchmark/WavefrontBenchmark.h"
+#include "Benchmark/LightBenchmark.h"
+#include "Benchmark/EnvironmentBenchmark.h"
+#include "Benchmark/TextureBenchmark.h"
+#include "Benchmark/SceneBenchmark.h"
+#include "Benchmark/VertexBenchmark.h"
+#include "Benchmark/BSDFBenchmark.h"
+#include "Benchmark/DenoiseBenchmark.h"
+#include "Benchmark/ReprojectionBenchmark.h"
+#include "Benchmark/DistributedBenchmark.h"
+#include "Benchmark/SkyBenchmark.h"
+#include "Benchmark/SamplerBenchmark.h"
+#include "Benchmark/InstancingBenchmark.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cstring>
+
+struct BenchmarkCommand
+{
+	const char* Flag;
+	BenchmarkFunction Run;
+};
+
+static const BenchmarkCommand s_Benchmarks[] = {
+	{ "--bench-render",      RunRenderBenchmark },
+	{ "--bench-bvh",         RunBVHBenchmark },
+	{ "--bench-volume",      RunVolumeBenchmark },
+	{ "--bench-refit",       RunRefitBenchmark },
+	{ "--bench-wavefront",   RunWavefrontBenchmark },
+	{ "--bench-lights",      RunLightBenchmark },
+	{ "--bench-environment", RunEnvironmentBenchmark },
+	{ "--bench-textures",    RunTextureBenchmark },
+	{ "--bench-scene",       RunSceneBenchmark },
+	{ "--bench-vertices",    RunVertexBenchmark },
+	{ "--bench-bsdf",        RunBSDFBenchmark },
+	{ "--bench-denoise",     RunDenoiseBenchmark },
+	{ "--bench-reproject",   RunReprojectionBenchmark },
+	{ "--bench-distributed", RunDistributedBenchmark },
+	{ "--bench-sky",         RunSkyBenchmark },
+	{ "--bench-samplers",    RunSamplerBenchmark },
+	{ "--bench-instancing",  RunInstancingBenchmark },
+};
+
+const std::vector<BenchmarkScene>& GetBenchmarkScenes()
+{
+	static const std::vector<BenchmarkScene> scenes = {
+		{ "CornellBox", s_CornellBoxModel, { -0.23f, 2.6f, 7.5f }, { -0.23f, 2.6f, -3.0f }, 45.0f },
+		{ "Suzanne",    s_SuzanneModel,    { 0.0f, 0.5f, 4.0f },   { 0.0f, 0.0f, 0.0f },    45.0f },
+		{ "Sponza",     s_SponzaModel,     { -10.0f, 2.0f, -0.5f }, { 10.0f, 4.0f, -0.5f }, 60.0f },
+	};
+	return scenes;
+}
+
+const BenchmarkScene* FindBenchmarkScene(const std::string& name)
+{
+	for (const BenchmarkScene& scene : GetBenchmarkScenes())
+	{
+		if (name == scene.Name)
+			return &scene;
+	}
+	return nullptr;
+}
+
+CameraBuffer CreateCamera(const glm::vec3& eye, const glm::vec3& target, float fov, uint32_t width, uint32_t height, float farPlane)
+{
+	glm::mat4 projection = glm::perspective(glm::radians(fov), (float)width / (float)height, 0.1f, farPlane);
+	glm::mat4 view = glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+
+	CameraBuffer camera;
+	camera.ViewProjection = projection * view;
+	camera.InverseViewProjection = glm::inverse(camera.ViewProjection);
+	camera.View = view;
+	camera.InverseView = glm::inverse(view);
+	camera.InverseProjection = glm::inverse(projection);
+	return camera;
+}
+
+CameraBuffer CreateCamera(const BenchmarkScene& scene, uint32_t width, uint32_t height)
+{
+	return CreateCamera(scene.Eye, scene.Target, scene.FOV, width, height);
+}
+
+Ref<CPU::Scene> LoadScene(const std::string& model)
+{
+	Ref<MeshSource> meshSource = CreateRef<MeshSource>(model);
+	return CreateRef<CPU::Scene>(meshSource, glm::mat4(1.0f));
+}
+
+std::vector<std::string> GetModelArguments(int argc, char** argv, std::initializer_list<const char*> defaults)
+{
+	std::vector<std::string> models;
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (strcmp(argv[i], "--model") == 0)
+			models.push_back(argv[++i]);
+	}
+
+	if (models.empty())
+		models.assign(defaults.begin(), defaults.end());
+	return models;
+}
+
+BenchmarkFunction FindBenchmark(const char* flag)
+{
+	for (const BenchmarkCommand& benchmark : s_Benchmarks)
+	{
+		if (strcmp(flag, benchmark.Flag) == 0)
+			return benchmark.Run;
+	}
+	return nullptr;
+}
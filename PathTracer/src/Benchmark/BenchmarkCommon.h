@@ -0,0 +1,55 @@
+#pragma once
+#include "Core/Base.h"
+#include "CPU/Scene.h"
+#include "ShaderBuffers.h"
+#include <chrono>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+using namespace VkLibrary;
+
+// Models of the benchmark scenes, relative to PathTracer/
+static constexpr const char* s_CornellBoxModel = "assets/models/CornellBox.gltf";
+static constexpr const char* s_SuzanneModel = "assets/models/Suzanne/glTF/Suzanne.gltf";
+static constexpr const char* s_SponzaModel = "assets/models/Sponza/glTF/Sponza.gltf";
+static constexpr const char* s_IntelSponzaModel = "assets/models/IntelSponza/NewSponza_Main_glTF_002.gltf";
+
+// Measured and reference renders use different seeds so the reference noise isn't correlated with the measured render
+static constexpr uint32_t s_BenchmarkSeed = 1;
+static constexpr uint32_t s_ReferenceSeed = 0x5EED;
+
+struct BenchmarkScene
+{
+	const char* Name;
+	const char* ModelPath;
+	glm::vec3 Eye;
+	glm::vec3 Target;
+	float FOV;
+};
+
+// Scenes of the render benchmark, the other benchmarks reuse their cameras. Changing a camera invalidates
+// the stored references
+const std::vector<BenchmarkScene>& GetBenchmarkScenes();
+const BenchmarkScene* FindBenchmarkScene(const std::string& name);
+
+CameraBuffer CreateCamera(const glm::vec3& eye, const glm::vec3& target, float fov, uint32_t width, uint32_t height, float farPlane = 1000.0f);
+CameraBuffer CreateCamera(const BenchmarkScene& scene, uint32_t width, uint32_t height);
+
+// glTF model as a CPU scene with an identity transform
+Ref<CPU::Scene> LoadScene(const std::string& model);
+
+// Every `--model path` argument, or the defaults if there are none
+std::vector<std::string> GetModelArguments(int argc, char** argv, std::initializer_list<const char*> defaults);
+
+using Clock = std::chrono::high_resolution_clock;
+
+inline double SecondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+using BenchmarkFunction = int(*)(int argc, char** argv);
+
+// `--bench-*` modes shared by PathTracer and PathTracerBenchmark, nullptr if the flag selects none
+BenchmarkFunction FindBenchmark(const char* flag);
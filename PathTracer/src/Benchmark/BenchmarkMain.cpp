@@ -0,0 +1,14 @@
+#include "Benchmark/BenchmarkCommon.h"
+#include "Benchmark/RenderBenchmark.h"
+
+// Entry point of the PathTracerBenchmark project, runs the render benchmark unless a micro benchmark is selected
+int main(int argc, char** argv)
+{
+	if (argc > 1)
+	{
+		if (BenchmarkFunction benchmark = FindBenchmark(argv[1]))
+			return benchmark(argc, argv);
+	}
+
+	return RunRenderBenchmark(argc, argv);
+}
@@ -0,0 +1,277 @@
+#include "Benchmark/DenoiseBenchmark.h"
+#include "Benchmark/BenchmarkCommon.h"
+#include "CPU/Denoiser.h"
+#include "CPU/PathTracer.h"
+#include "CPU/ImageIO.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace VkLibrary;
+
+static constexpr uint32_t s_Repetitions = 5;
+
+// The SIMD filters only differ from the scalar one in their exp approximation
+static constexpr float s_Tolerance = 1e-4f;
+
+struct DenoiseInputs
+{
+	uint32_t Width = 640;
+	uint32_t Height = 360;
+	std::vector<glm::vec4> Image;
+	std::vector<glm::vec4> Accumulation;
+	std::vector<glm::vec4> Moments;
+	std::vector<glm::vec4> Albedo;
+	std::vector<glm::vec4> NormalDepth;
+};
+
+static std::vector<glm::vec4> ResolveAccumulation(const std::vector<glm::vec4>& accumulation)
+{
+	std::vector<glm::vec4> image(accumulation.size());
+	for (size_t i = 0; i < accumulation.size(); i++)
+		image[i] = accumulation[i].w > 0.0f ? glm::vec4(glm::vec3(accumulation[i]) / accumulation[i].w, 1.0f) : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	return image;
+}
+
+static bool ReadBuffer(const std::string& filepath, uint32_t width, uint32_t height, std::vector<glm::vec4>& pixels)
+{
+	uint32_t bufferWidth, bufferHeight;
+	if (!CPU::ReadAccumulation(filepath, pixels, bufferWidth, bufferHeight))
+	{
+		printf("Failed to read %s\n", filepath.c_str());
+		return false;
+	}
+
+	if (bufferWidth != width || bufferHeight != height)
+	{
+		printf("%s is %ux%u, expected %ux%u\n", filepath.c_str(), bufferWidth, bufferHeight, width, height);
+		return false;
+	}
+
+	return true;
+}
+
+// Buffers of `--headless --aovs --output name`, the image is resolved from the accumulation
+static bool LoadInputs(const std::string& name, DenoiseInputs& inputs)
+{
+	if (!CPU::ReadAccumulation(name + ".accum", inputs.Accumulation, inputs.Width, inputs.Height))
+	{
+		printf("Failed to read %s.accum\n", name.c_str());
+		return false;
+	}
+
+	if (!ReadBuffer(name + ".moments", inputs.Width, inputs.Height, inputs.Moments) ||
+		!ReadBuffer(name + ".albedo", inputs.Width, inputs.Height, inputs.Albedo) ||
+		!ReadBuffer(name + ".normaldepth", inputs.Width, inputs.Height, inputs.NormalDepth))
+		return false;
+
+	inputs.Image = ResolveAccumulation(inputs.Accumulation);
+	return true;
+}
+
+static void RenderInputs(const Ref<CPU::Scene>& scene, uint32_t frames, DenoiseInputs& inputs)
+{
+	CPU::PathTracerSpecification spec;
+	spec.Width = inputs.Width;
+	spec.Height = inputs.Height;
+	spec.Seed = s_BenchmarkSeed;
+	spec.WriteAOVs = true;
+	CPU::PathTracer pathTracer(spec, scene);
+
+	CameraBuffer camera = CreateCamera(*FindBenchmarkScene("CornellBox"), inputs.Width, inputs.Height);
+	for (uint32_t frameIndex = 1; frameIndex <= frames; frameIndex++)
+		pathTracer.Render(camera, frameIndex);
+
+	inputs.Image = pathTracer.GetImage();
+	inputs.Accumulation = pathTracer.GetAccumulationBuffer();
+	inputs.Moments = pathTracer.GetMomentsBuffer();
+	inputs.Albedo = pathTracer.GetAlbedoBuffer();
+	inputs.NormalDepth = pathTracer.GetNormalDepthBuffer();
+}
+
+static std::vector<glm::vec4> RenderReference(const Ref<CPU::Scene>& scene, uint32_t width, uint32_t height, uint32_t frames)
+{
+	CPU::PathTracerSpecification spec;
+	spec.Width = width;
+	spec.Height = height;
+	spec.Seed = s_ReferenceSeed;
+	CPU::PathTracer pathTracer(spec, scene);
+
+	CameraBuffer camera = CreateCamera(*FindBenchmarkScene("CornellBox"), width, height);
+	for (uint32_t frameIndex = 1; frameIndex <= frames; frameIndex++)
+		pathTracer.Render(camera, frameIndex);
+
+	return ResolveAccumulation(pathTracer.GetAccumulationBuffer());
+}
+
+// RMSE after mapping both images with x / (1 + x), same as the render benchmark
+static double ComputeRMSE(const std::vector<glm::vec4>& image, const std::vector<glm::vec4>& reference)
+{
+	double sum = 0.0;
+	for (size_t i = 0; i < image.size(); i++)
+	{
+		glm::vec3 color = glm::vec3(image[i]);
+		glm::vec3 expected = glm::vec3(reference[i]);
+		glm::vec3 difference = color / (1.0f + color) - expected / (1.0f + expected);
+		sum += glm::dot(difference, difference);
+	}
+
+	return glm::sqrt(sum / (image.size() * 3.0));
+}
+
+static float MaxRelativeDifference(const std::vector<glm::vec4>& a, const std::vector<glm::vec4>& b)
+{
+	float maxDifference = 0.0f;
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		float difference = glm::length(glm::vec3(a[i]) - glm::vec3(b[i])) / (glm::length(glm::vec3(b[i])) + 1e-3f);
+		maxDifference = glm::max(maxDifference, difference);
+	}
+	return maxDifference;
+}
+
+static float MeanSamplesPerPixel(const DenoiseInputs& inputs)
+{
+	double sum = 0.0;
+	for (const glm::vec4& accumulation : inputs.Accumulation)
+		sum += accumulation.w;
+	return (float)(sum / inputs.Accumulation.size());
+}
+
+int RunDenoiseBenchmark(int argc, char** argv)
+{
+	std::string input;
+	std::string referencePath;
+	std::string outputPath;
+	std::string model = s_CornellBoxModel;
+	uint32_t frames = 2;
+	uint32_t referenceFrames = 256;
+
+	DenoiseInputs inputs;
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (strcmp(argv[i], "--input") == 0)
+			input = argv[++i];
+		else if (strcmp(argv[i], "--reference") == 0)
+			referencePath = argv[++i];
+		else if (strcmp(argv[i], "--output") == 0)
+			outputPath = argv[++i];
+		else if (strcmp(argv[i], "--model") == 0)
+			model = argv[++i];
+		else if (strcmp(argv[i], "--frames") == 0)
+			frames = glm::max((uint32_t)strtoul(argv[++i], nullptr, 10), 1u);
+		else if (strcmp(argv[i], "--reference-frames") == 0)
+			referenceFrames = glm::max((uint32_t)strtoul(argv[++i], nullptr, 10), 2u);
+		else if (strcmp(argv[i], "--width") == 0)
+			inputs.Width = glm::max((uint32_t)strtoul(argv[++i], nullptr, 10), 1u);
+		else if (strcmp(argv[i], "--height") == 0)
+			inputs.Height = glm::max((uint32_t)strtoul(argv[++i], nullptr, 10), 1u);
+	}
+
+	Ref<CPU::Scene> scene;
+	if (input.empty())
+	{
+		scene = LoadScene(model);
+
+		Clock::time_point start = Clock::now();
+		RenderInputs(scene, frames, inputs);
+		printf("%s: %ux%u, %u frames with AOVs in %.2f s\n", model.c_str(), inputs.Width, inputs.Height, frames, SecondsSince(start));
+	}
+	else if (!LoadInputs(input, inputs))
+	{
+		return 1;
+	}
+
+	// Frame 1 isn't accumulated, its image is SAMPLE_COUNT paths
+	float samplesPerPixel = MeanSamplesPerPixel(inputs);
+	if (samplesPerPixel == 0.0f)
+		samplesPerPixel = 5.0f;
+
+	std::vector<glm::vec4> reference;
+	if (!referencePath.empty())
+	{
+		std::vector<glm::vec4> accumulation;
+		if (!ReadBuffer(referencePath, inputs.Width, inputs.Height, accumulation))
+			return 1;
+		reference = ResolveAccumulation(accumulation);
+	}
+	else if (scene)
+	{
+		Clock::time_point start = Clock::now();
+		reference = RenderReference(scene, inputs.Width, inputs.Height, referenceFrames);
+		printf("Reference: %u frames in %.2f s\n", referenceFrames, SecondsSince(start));
+	}
+
+	bool passed = true;
+	std::vector<glm::vec4> scalarOutput;
+	std::vector<glm::vec4> denoised;
+	double scalarMilliseconds = 0.0;
+
+	for (int level = (int)CPU::SIMDLevel::Scalar; level <= (int)CPU::GetSupportedSIMDLevel(); level++)
+	{
+		CPU::Denoiser denoiser;
+		denoiser.SetSIMDLevel((CPU::SIMDLevel)level);
+		denoiser.Resize(inputs.Width, inputs.Height);
+
+		// The first run touches the planes
+		denoiser.Denoise(inputs.Image, inputs.Accumulation, inputs.Moments, inputs.Albedo, inputs.NormalDepth);
+
+		std::vector<double> times;
+		for (uint32_t i = 0; i < s_Repetitions; i++)
+		{
+			Clock::time_point start = Clock::now();
+			denoiser.Denoise(inputs.Image, inputs.Accumulation, inputs.Moments, inputs.Albedo, inputs.NormalDepth);
+			times.push_back(SecondsSince(start) * 1000.0);
+		}
+		std::sort(times.begin(), times.end());
+		double milliseconds = times[times.size() / 2];
+
+		if (level == (int)CPU::SIMDLevel::Scalar)
+		{
+			scalarOutput = denoiser.GetOutput();
+			scalarMilliseconds = milliseconds;
+			printf("%-6s %8.2f ms\n", CPU::GetSIMDLevelName(denoiser.GetSIMDLevel()), milliseconds);
+		}
+		else
+		{
+			float difference = MaxRelativeDifference(denoiser.GetOutput(), scalarOutput);
+			bool matches = difference <= s_Tolerance;
+			passed &= matches;
+			printf("%-6s %8.2f ms, %.2fx, max relative difference %g%s\n", CPU::GetSIMDLevelName(denoiser.GetSIMDLevel()), milliseconds,
+				scalarMilliseconds / milliseconds, difference, matches ? "" : " MISMATCH");
+		}
+
+		denoised = denoiser.GetOutput();
+	}
+
+	if (!reference.empty())
+	{
+		double noisyRMSE = ComputeRMSE(inputs.Image, reference);
+		double denoisedRMSE = ComputeRMSE(denoised, reference);
+		printf("RMSE: %.5f noisy (%.1f spp), %.5f denoised\n", noisyRMSE, samplesPerPixel, denoisedRMSE);
+
+		// Noise falls with the square root of the sample count, bias of the filter doesn't
+		if (denoisedRMSE > 0.0)
+			printf("Denoised error matches about %.0f spp without the filter\n", samplesPerPixel * (noisyRMSE / denoisedRMSE) * (noisyRMSE / denoisedRMSE));
+	}
+	else
+	{
+		printf("No reference, pass --reference file.accum to report the error\n");
+	}
+
+	if (!outputPath.empty())
+	{
+		bool written = CPU::WritePFM(outputPath + ".noisy.pfm", inputs.Image, inputs.Width, inputs.Height);
+		written &= CPU::WritePFM(outputPath + ".denoised.pfm", denoised, inputs.Width, inputs.Height);
+		if (!written)
+		{
+			printf("Failed to write %s\n", outputPath.c_str());
+			return 1;
+		}
+	}
+
+	return passed ? 0 : 1;
+}
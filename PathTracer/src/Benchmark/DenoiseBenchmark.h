@@ -0,0 +1,9 @@
+#pragma once
+
+// `PathTracer --bench-denoise [--input name] [--reference file.accum] [--frames n] [--reference-frames n]
+// [--width w] [--height h] [--output name]` runs the CPU denoiser on the buffers written by
+// `--headless --aovs --output name` (name.accum, .moments, .albedo and .normaldepth), or on a low
+// sample count render of the Cornell box without --input. Reports the time per SIMD level and the
+// RMSE of the noisy and denoised images against the reference (an .accum file, or a long render).
+// Returns 1 if a SIMD level disagrees with the scalar filter.
+int RunDenoiseBenchmark(int argc, char** argv);
@@ -0,0 +1,205 @@
+#include "Benchmark/DistributedBenchmark.h"
+#include "Benchmark/BenchmarkCommon.h"
+#include "CPU/Distributed.h"
+#include "CPU/ThreadPool.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace VkLibrary;
+
+// Units are summed in the order they arrive
+static constexpr float s_Tolerance = 1e-4f;
+
+static constexpr float s_ConnectTimeout = 60.0f;
+
+// Starts this executable as a worker in the background
+static bool SpawnWorker(const char* executable, uint16_t port, uint32_t threads, uint32_t maxUnits)
+{
+	std::string arguments = " --bench-distributed --worker " + std::to_string(port) + " --threads " + std::to_string(threads) +
+		" --max-units " + std::to_string(maxUnits);
+#ifdef _WIN32
+	std::string command = "start \"\" /B \"" + std::string(executable) + "\"" + arguments;
+#else
+	std::string command = "\"" + std::string(executable) + "\"" + arguments + " &";
+#endif
+	return std::system(command.c_str()) == 0;
+}
+
+static int RunWorker(uint16_t port, uint32_t threads, uint32_t maxUnits)
+{
+	CPU::ThreadPool::SetDefaultThreadCount(threads);
+
+	CPU::RenderWorkerSpecification spec;
+	spec.Port = port;
+	spec.ConnectTimeout = s_ConnectTimeout;
+	spec.MaxUnits = maxUnits;
+	CPU::RenderWorker worker(spec);
+	if (!worker.Connect())
+		return 1;
+
+	return worker.Run() ? 0 : 1;
+}
+
+static float MaxRelativeDifference(const std::vector<glm::vec4>& accumulation, const std::vector<glm::vec4>& reference)
+{
+	float maxDifference = 0.0f;
+	for (size_t i = 0; i < accumulation.size(); i++)
+	{
+		float difference = glm::length(accumulation[i] - reference[i]) / (glm::length(reference[i]) + 1e-3f);
+		maxDifference = glm::max(maxDifference, difference);
+	}
+	return maxDifference;
+}
+
+static uint64_t TotalSamples(const CPU::RenderCoordinator& coordinator)
+{
+	uint64_t samples = 0;
+	for (const CPU::WorkerStatistics& statistics : coordinator.GetWorkerStatistics())
+		samples += statistics.SampleCount;
+	return samples;
+}
+
+int RunDistributedBenchmark(int argc, char** argv)
+{
+	std::string model = s_CornellBoxModel;
+	uint32_t workers = 4;
+	uint32_t threads = 1;
+	uint32_t width = 320;
+	uint32_t height = 180;
+	uint32_t frames = 8;
+	uint32_t tileSize = 64;
+	uint32_t framesPerUnit = 2;
+
+	int32_t workerPort = -1;
+	uint32_t maxUnits = 0;
+
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (strcmp(argv[i], "--model") == 0)
+			model = argv[++i];
+		else if (strcmp(argv[i], "--workers") == 0)
+			workers = glm::max((uint32_t)strtoul(argv[++i], nullptr, 10), 1u);
+		else if (strcmp(argv[i], "--threads") == 0)
+			threads = glm::max((uint32_t)strtoul(argv[++i], nullptr, 10), 1u);
+		else if (strcmp(argv[i], "--width") == 0)
+			width = glm::max((uint32_t)strtoul(argv[++i], nullptr, 10), 1u);
+		else if (strcmp(argv[i], "--height") == 0)
+			height = glm::max((uint32_t)strtoul(argv[++i], nullptr, 10), 1u);
+		else if (strcmp(argv[i], "--frames") == 0)
+			frames = glm::max((uint32_t)strtoul(argv[++i], nullptr, 10), 1u);
+		else if (strcmp(argv[i], "--tile-size") == 0)
+			tileSize = glm::max((uint32_t)strtoul(argv[++i], nullptr, 10), 1u);
+		else if (strcmp(argv[i], "--unit-frames") == 0)
+			framesPerUnit = glm::max((uint32_t)strtoul(argv[++i], nullptr, 10), 1u);
+		else if (strcmp(argv[i], "--worker") == 0)
+			workerPort = (int32_t)strtol(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--max-units") == 0)
+			maxUnits = (uint32_t)strtoul(argv[++i], nullptr, 10);
+	}
+
+	// Spawned by the benchmark below
+	if (workerPort >= 0)
+		return RunWorker((uint16_t)workerPort, threads, maxUnits);
+
+	CPU::RenderCoordinatorSpecification coordinatorSpec;
+	coordinatorSpec.Port = 0;
+	coordinatorSpec.WorkerTimeout = s_ConnectTimeout;
+	CPU::RenderCoordinator coordinator(coordinatorSpec);
+	if (!coordinator.Listen())
+	{
+		printf("Failed to listen\n");
+		return 1;
+	}
+
+	for (uint32_t i = 0; i < workers; i++)
+	{
+		if (!SpawnWorker(argv[0], coordinator.GetPort(), threads, 0))
+		{
+			printf("Failed to start worker %u\n", i);
+			return 1;
+		}
+	}
+
+	if (!coordinator.WaitForWorkers(workers, s_ConnectTimeout))
+	{
+		printf("Only %u of %u workers connected\n", coordinator.GetConnectedWorkerCount(), workers);
+		return 1;
+	}
+
+	CPU::DistributedJobSpecification job;
+	job.Scene.ModelPath = model;
+	job.Scene.Scale = 1.0f;
+	job.PathTracerSpec.Width = width;
+	job.PathTracerSpec.Height = height;
+	job.PathTracerSpec.Seed = s_BenchmarkSeed;
+	job.Camera = CreateCamera(*FindBenchmarkScene("CornellBox"), width, height);
+	job.Frames = frames;
+	job.TileSize = tileSize;
+	job.FramesPerUnit = framesPerUnit;
+
+	// Every worker loads the scene once, the timed renders reuse it
+	CPU::DistributedJobSpecification warmup = job;
+	warmup.Frames = 1;
+	warmup.TileSize = 8;
+	warmup.PathTracerSpec.Width = 8 * workers;
+	warmup.PathTracerSpec.Height = 8;
+	std::vector<glm::vec4> accumulation;
+	Clock::time_point start = Clock::now();
+	if (!coordinator.Render(warmup, accumulation))
+	{
+		printf("Warm up failed\n");
+		return 1;
+	}
+	printf("%s: %ux%u, %u frames in units of %u frames of %ux%u tiles, %u workers with %u threads, loaded in %.2f s\n", model.c_str(), width, height,
+		frames, framesPerUnit, tileSize, tileSize, workers, threads, SecondsSince(start));
+
+	bool passed = true;
+	std::vector<glm::vec4> reference;
+	double referenceSeconds = 0.0;
+	for (uint32_t workerCount = 1; workerCount <= workers; workerCount++)
+	{
+		start = Clock::now();
+		if (!coordinator.Render(job, accumulation, workerCount))
+		{
+			printf("%u workers: render failed\n", workerCount);
+			return 1;
+		}
+		double seconds = SecondsSince(start);
+
+		if (workerCount == 1)
+		{
+			reference = accumulation;
+			referenceSeconds = seconds;
+		}
+
+		float difference = MaxRelativeDifference(accumulation, reference);
+		bool matches = difference <= s_Tolerance;
+		passed &= matches;
+
+		printf("%u workers: %8.2f s, %8.2f Msamples/s, efficiency %5.1f%%, max relative difference %g%s\n", workerCount, seconds,
+			TotalSamples(coordinator) / seconds * 1e-6, 100.0 * referenceSeconds / (workerCount * seconds), difference, matches ? "" : " MISMATCH");
+	}
+
+	// A worker that leaves halfway, its units go to the others
+	if (!SpawnWorker(argv[0], coordinator.GetPort(), threads, 2) || !coordinator.WaitForWorkers(workers + 1, s_ConnectTimeout))
+	{
+		printf("Failed to start the leaving worker\n");
+		return 1;
+	}
+
+	start = Clock::now();
+	bool rendered = coordinator.Render(job, accumulation);
+	double seconds = SecondsSince(start);
+	float difference = rendered ? MaxRelativeDifference(accumulation, reference) : 1.0f;
+	bool matches = rendered && difference <= s_Tolerance && coordinator.GetReassignedUnitCount() > 0;
+	passed &= matches;
+
+	printf("%u workers, one leaving: %.2f s, %u units reassigned, max relative difference %g%s\n", workers + 1, seconds,
+		coordinator.GetReassignedUnitCount(), difference, matches ? "" : " MISMATCH");
+
+	coordinator.Shutdown();
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+// `PathTracer --bench-distributed [--workers n] [--threads t] [--model path] [--width w] [--height h] [--frames n]
+// [--tile-size n] [--unit-frames n]` starts n local worker processes with t threads each, renders the Cornell
+// box on 1 to n of them and reports the time and scaling efficiency T(1) / (k * T(k)) of every worker
+// count. A last render adds a worker that disconnects after two units. Returns 1 if a render fails or
+// differs from the single worker render by more than the order of the sums.
+int RunDistributedBenchmark(int argc, char** argv);
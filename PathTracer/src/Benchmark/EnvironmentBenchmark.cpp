@@ -0,0 +1,317 @@
+#include "Benchmark/EnvironmentBenchmark.h"
+#include "Benchmark/BenchmarkCommon.h"
+#include "CPU/EnvironmentMap.h"
+#include "CPU/ImageIO.h"
+#include "CPU/Disney.h"
+#include "CPU/Sampling.h"
+#include "CPU/ThreadPool.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+static const char* s_DefaultEnvironment = "assets/hdr/graveyard_pathways_4k.hdr";
+
+static constexpr uint32_t s_DefaultSamples = 1 << 20;
+static constexpr uint32_t s_ChunkSize = 4096;
+static constexpr uint32_t s_NormalCount = 16;
+
+// Histogram bins are this many distribution cells wide and high
+static constexpr uint32_t s_BinSize = 16;
+
+// Bins expected to be hit fewer times than this are left out of the histogram check
+static constexpr float s_MinExpectedCount = 16.0f;
+
+// Failure thresholds, the histogram check is statistical and its largest deviation over a few thousand bins
+// stays well below 6 sigma
+static constexpr double s_MaxIntegralError = 1e-3;
+static constexpr double s_MaxDeviation = 6.0;
+static constexpr double s_MaxPdfMismatchRate = 1e-3;
+
+// Synthetic environment, a sky gradient with a sun that covers a few pixels
+static constexpr uint32_t s_SyntheticWidth = 2048;
+static constexpr uint32_t s_SyntheticHeight = 1024;
+static constexpr float s_SunRadiance = 50000.0f;
+static constexpr float s_SunCosAngle = 0.99996f; // About half a degree across
+
+// Inverse of the EquirectangularToCubeMap.glsl mapping at the center of pixel (x, y)
+static glm::vec3 PixelDirection(uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+	float phi = ((x + 0.5f) / width - 0.5f) * CPU::TWO_PI;
+	float theta = (y + 0.5f) / height * CPU::PI;
+	return glm::vec3(glm::sin(theta) * glm::cos(phi), glm::cos(theta), glm::sin(theta) * glm::sin(phi));
+}
+
+static std::vector<glm::vec3> GenerateSyntheticSky()
+{
+	glm::vec3 sunDirection = glm::normalize(glm::vec3(0.3f, 0.8f, 0.4f));
+
+	std::vector<glm::vec3> pixels((size_t)s_SyntheticWidth * s_SyntheticHeight);
+	for (uint32_t y = 0; y < s_SyntheticHeight; y++)
+	{
+		for (uint32_t x = 0; x < s_SyntheticWidth; x++)
+		{
+			glm::vec3 direction = PixelDirection(x, y, s_SyntheticWidth, s_SyntheticHeight);
+			glm::vec3 color = direction.y > 0.0f ? glm::vec3(0.3f, 0.5f, 0.9f) * (0.2f + 0.8f * direction.y) : glm::vec3(0.1f);
+			if (glm::dot(direction, sunDirection) > s_SunCosAngle)
+				color = glm::vec3(s_SunRadiance);
+
+			pixels[(size_t)y * s_SyntheticWidth + x] = color;
+		}
+	}
+
+	return pixels;
+}
+
+// Returns false if the distribution fails any of the checks
+static bool ValidateDistribution(const CPU::EnvironmentMap& environment, uint32_t sampleCount)
+{
+	uint32_t width = environment.GetWidth();
+	uint32_t height = environment.GetHeight();
+
+	// The pdf is constant over each cell apart from sin(theta), so the midpoint rule per cell is exact up to that
+	double integral = 0.0;
+	for (uint32_t y = 0; y < height; y++)
+	{
+		double sinTheta = glm::sin(CPU::PI * (y + 0.5f) / height);
+		for (uint32_t x = 0; x < width; x++)
+			integral += environment.Pdf(PixelDirection(x, y, width, height)) * 2.0 * CPU::PI * CPU::PI * sinTheta / ((double)width * height);
+	}
+
+	// Expected share of every histogram bin from the per cell pdfs
+	uint32_t binsX = (width + s_BinSize - 1) / s_BinSize;
+	uint32_t binsY = (height + s_BinSize - 1) / s_BinSize;
+	std::vector<double> expected(binsX * binsY, 0.0);
+	for (uint32_t y = 0; y < height; y++)
+	{
+		double sinTheta = glm::sin(CPU::PI * (y + 0.5f) / height);
+		for (uint32_t x = 0; x < width; x++)
+			expected[(y / s_BinSize) * binsX + x / s_BinSize] += environment.Pdf(PixelDirection(x, y, width, height)) * 2.0 * CPU::PI * CPU::PI * sinTheta / ((double)width * height);
+	}
+
+	// Sample agrees with Pdf, and lands in the bins by their share
+	uint32_t chunkCount = (sampleCount + s_ChunkSize - 1) / s_ChunkSize;
+	std::vector<std::vector<uint32_t>> chunkCounts(chunkCount);
+	std::atomic<uint32_t> pdfMismatches = 0;
+	std::atomic<uint32_t> invalidSamples = 0;
+
+	Clock::time_point start = Clock::now();
+	CPU::ThreadPool::Get().ParallelFor(chunkCount, [&](uint32_t chunk)
+	{
+		std::vector<uint32_t>& counts = chunkCounts[chunk];
+		counts.assign(binsX * binsY, 0);
+
+		uint32_t seed = chunk * 7919u + 11u;
+		for (uint32_t i = chunk * s_ChunkSize; i < glm::min((chunk + 1) * s_ChunkSize, sampleCount); i++)
+		{
+			glm::vec2 u = glm::vec2(CPU::RandomValue(seed), CPU::RandomValue(seed));
+			float pdf;
+			glm::vec3 direction = environment.Sample(u, pdf);
+			if (pdf <= 0.0f)
+			{
+				invalidSamples++;
+				continue;
+			}
+
+			if (glm::abs(environment.Pdf(direction) - pdf) > 1e-3f * pdf)
+				pdfMismatches++;
+
+			float phi = std::atan2(direction.z, direction.x);
+			float theta = glm::acos(glm::clamp(direction.y, -1.0f, 1.0f));
+			uint32_t x = glm::min((uint32_t)((phi / CPU::TWO_PI + 0.5f) * width), width - 1);
+			uint32_t y = glm::min((uint32_t)(theta / CPU::PI * height), height - 1);
+			counts[(y / s_BinSize) * binsX + x / s_BinSize]++;
+		}
+	});
+	double samplesPerSecond = sampleCount / SecondsSince(start) * 1e-6;
+
+	double maxDeviation = 0.0;
+	uint32_t checkedBins = 0;
+	for (uint32_t bin = 0; bin < binsX * binsY; bin++)
+	{
+		uint32_t count = 0;
+		for (const std::vector<uint32_t>& counts : chunkCounts)
+			count += counts[bin];
+
+		double p = expected[bin];
+		double expectedCount = p * sampleCount;
+		if (expectedCount < s_MinExpectedCount)
+			continue;
+
+		maxDeviation = glm::max(maxDeviation, glm::abs(count - expectedCount) / glm::sqrt(expectedCount * (1.0 - p)));
+		checkedBins++;
+	}
+
+	printf("  distribution %ux%u: pdf integral %.6f, max deviation %.2f sigma over %u bins, %u/%u pdf mismatches, %u invalid, %.2f Msamples/s\n",
+		width, height, integral, maxDeviation, checkedBins, (uint32_t)pdfMismatches, sampleCount, (uint32_t)invalidSamples, samplesPerSecond);
+
+	bool passed = glm::abs(integral - 1.0) <= s_MaxIntegralError && maxDeviation <= s_MaxDeviation &&
+		pdfMismatches <= sampleCount * s_MaxPdfMismatchRate && invalidSamples == 0;
+	if (!passed)
+		printf("  MISMATCH\n");
+	return passed;
+}
+
+struct EstimatorStats
+{
+	double Sum = 0.0;
+	double SumSquared = 0.0;
+
+	void Add(double value)
+	{
+		Sum += value;
+		SumSquared += value * value;
+	}
+
+	double Mean(uint32_t count) const { return Sum / count; }
+	double Variance(uint32_t count) const { return glm::max(SumSquared / count - Mean(count) * Mean(count), 0.0); }
+};
+
+// Irradiance of a diffuse surface summed over the distribution cells, exact for the filtered map up to
+// the variation of the cosine within a cell
+static double ReferenceIrradiance(const CPU::EnvironmentMap& environment, const glm::vec3& normal)
+{
+	uint32_t width = environment.GetWidth();
+	uint32_t height = environment.GetHeight();
+
+	double irradiance = 0.0;
+	for (uint32_t y = 0; y < height; y++)
+	{
+		double solidAngle = 2.0 * CPU::PI * CPU::PI * glm::sin(CPU::PI * (y + 0.5f) / height) / ((double)width * height);
+		for (uint32_t x = 0; x < width; x++)
+		{
+			glm::vec3 direction = PixelDirection(x, y, width, height);
+			float cosTheta = glm::max(glm::dot(direction, normal), 0.0f);
+			irradiance += CPU::Luminance(environment.Eval(direction)) * cosTheta * CPU::INV_PI * solidAngle;
+		}
+	}
+
+	return irradiance;
+}
+
+// Irradiance of unoccluded diffuse surfaces, which is what the miss path of TracePath integrates
+// after the last bounce. One sample per technique each, same as EnvironmentLight plus a BSDF sample.
+static void CompareVariance(const CPU::EnvironmentMap& environment, uint32_t sampleCount)
+{
+	double bsdfNoise = 0.0, environmentNoise = 0.0, misNoise = 0.0;
+	double maxError = 0.0;
+
+	uint32_t seed = 5;
+	for (uint32_t n = 0; n < s_NormalCount; n++)
+	{
+		glm::vec3 normal = CPU::UniformSampleSphere(CPU::RandomValue(seed), CPU::RandomValue(seed));
+		glm::vec3 tangent, bitangent;
+		CPU::Onb(normal, tangent, bitangent);
+
+		EstimatorStats bsdf, env, mis;
+		for (uint32_t i = 0; i < sampleCount; i++)
+		{
+			// Cosine weighted BSDF sample
+			glm::vec3 local = CPU::CosineSampleHemisphere(CPU::RandomValue(seed), CPU::RandomValue(seed));
+			glm::vec3 bsdfDirection = tangent * local.x + bitangent * local.y + normal * local.z;
+			float bsdfPdf = local.z * CPU::INV_PI;
+			float bsdfValue = bsdfPdf > 0.0f ? CPU::Luminance(environment.Eval(bsdfDirection)) * local.z * CPU::INV_PI : 0.0f;
+
+			// Environment sample
+			float environmentPdf;
+			glm::vec2 u = glm::vec2(CPU::RandomValue(seed), CPU::RandomValue(seed));
+			glm::vec3 environmentDirection = environment.Sample(u, environmentPdf);
+			float cosTheta = glm::max(glm::dot(environmentDirection, normal), 0.0f);
+			float environmentValue = environmentPdf > 0.0f ? CPU::Luminance(environment.Eval(environmentDirection)) * cosTheta * CPU::INV_PI : 0.0f;
+
+			bsdf.Add(bsdfPdf > 0.0f ? bsdfValue / bsdfPdf : 0.0);
+			env.Add(environmentPdf > 0.0f ? environmentValue / environmentPdf : 0.0);
+
+			double combined = 0.0;
+			if (bsdfPdf > 0.0f)
+				combined += bsdfValue * CPU::PowerHeuristic(bsdfPdf, environment.Pdf(bsdfDirection)) / bsdfPdf;
+			if (environmentPdf > 0.0f && cosTheta > 0.0f)
+				combined += environmentValue * CPU::PowerHeuristic(environmentPdf, cosTheta * CPU::INV_PI) / environmentPdf;
+			mis.Add(combined);
+		}
+
+		// Relative noise per sample, and how far the MIS estimate is from the reference in standard errors
+		double reference = ReferenceIrradiance(environment, normal);
+		if (reference <= 0.0)
+			continue;
+
+		bsdfNoise += glm::sqrt(bsdf.Variance(sampleCount)) / reference / s_NormalCount;
+		environmentNoise += glm::sqrt(env.Variance(sampleCount)) / reference / s_NormalCount;
+		misNoise += glm::sqrt(mis.Variance(sampleCount)) / reference / s_NormalCount;
+
+		double standardError = glm::sqrt(mis.Variance(sampleCount) / sampleCount);
+		if (standardError > 0.0)
+			maxError = glm::max(maxError, glm::abs(mis.Mean(sampleCount) - reference) / standardError);
+	}
+
+	printf("  irradiance over %u normals, relative std dev per sample: BSDF %.3f, environment %.3f, MIS %.3f (%.1fx less variance than BSDF) | MIS vs reference %.2f sigma\n",
+		s_NormalCount, bsdfNoise, environmentNoise, misNoise, misNoise > 0.0 ? (bsdfNoise * bsdfNoise) / (misNoise * misNoise) : 0.0, maxError);
+}
+
+int RunEnvironmentBenchmark(int argc, char** argv)
+{
+	std::string path = s_DefaultEnvironment;
+	uint32_t sampleCount = s_DefaultSamples;
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (strcmp(argv[i], "--environment") == 0)
+			path = argv[++i];
+		else if (strcmp(argv[i], "--samples") == 0)
+			sampleCount = (uint32_t)glm::max(1, atoi(argv[++i]));
+	}
+
+	CPU::EnvironmentMapSpecification spec;
+	spec.Path = path;
+
+	std::vector<glm::vec3> pixels;
+	uint32_t width, height;
+	Clock::time_point start = Clock::now();
+	bool synthetic = !std::filesystem::exists(path) || !CPU::ReadHDR(path, pixels, width, height);
+	double decodeSeconds = SecondsSince(start);
+	if (synthetic)
+	{
+		pixels = GenerateSyntheticSky();
+		width = s_SyntheticWidth;
+		height = s_SyntheticHeight;
+		printf("%s: not found, using a %ux%u synthetic sky with a sun\n", path.c_str(), width, height);
+	}
+	else
+	{
+		printf("%s: %ux%u, decoded in %.2f ms\n", path.c_str(), width, height, decodeSeconds * 1000.0);
+	}
+
+	start = Clock::now();
+	CPU::EnvironmentMap built(pixels, width, height, spec);
+	double buildSeconds = SecondsSince(start);
+	printf("  build %8.2f ms (%u threads)\n", buildSeconds * 1000.0, CPU::ThreadPool::Get().GetThreadCount());
+
+	// The first construction may write the cache, the second one always reads it
+	bool passed = true;
+	if (!synthetic)
+	{
+		start = Clock::now();
+		CPU::EnvironmentMap first(spec);
+		double firstSeconds = SecondsSince(start);
+
+		start = Clock::now();
+		CPU::EnvironmentMap cached(spec);
+		double cachedSeconds = SecondsSince(start);
+
+		printf("  cold start %8.2f ms (%s), cache load %8.2f ms from %s\n", firstSeconds * 1000.0, first.WasLoadedFromCache() ? "cache hit" : "decode + build + write",
+			cachedSeconds * 1000.0, cached.GetCachePath().c_str());
+
+		if (!cached.IsValid() || !cached.WasLoadedFromCache() || cached.GetIntegral() != built.GetIntegral()
+			|| memcmp(cached.GetDistribution(), built.GetDistribution(), cached.GetDistributionSize() * sizeof(float)) != 0)
+		{
+			printf("  cached distribution does not match the one built in memory\n");
+			passed = false;
+		}
+	}
+
+	passed &= ValidateDistribution(built, sampleCount);
+	CompareVariance(built, glm::max(sampleCount / s_NormalCount, 1u));
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+// `PathTracer --bench-environment [--environment file.hdr] [--samples n]` times decoding the HDR,
+// building the sampling distribution and loading it from the cache, checks that the pdf integrates
+// to one and that Sample agrees with Pdf and its histogram, and compares the noise of a diffuse
+// surface lit by the environment with BSDF sampling alone, environment sampling alone and MIS.
+// Without the HDR a synthetic sky with a small bright sun is used instead. Returns 1 if the cache or
+// the distribution checks fail.
+int RunEnvironmentBenchmark(int argc, char** argv);
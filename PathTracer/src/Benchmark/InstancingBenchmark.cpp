@@ -0,0 +1,200 @@
+#include "Benchmark/InstancingBenchmark.h"
+#include "Benchmark/BenchmarkCommon.h"
+#include "CPU/Scene.h"
+#include "CPU/ThreadPool.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace VkLibrary;
+
+static constexpr uint32_t s_DefaultMaxInstances = 10000;
+static constexpr uint32_t s_DefaultRays = 100000;
+static constexpr uint32_t s_MaxDuplicatedInstances = 256;
+
+struct SceneMemory
+{
+	uint64_t Geometry = 0;
+	uint64_t BottomLevel = 0;
+	uint64_t TopLevel = 0;
+
+	uint64_t Total() const { return Geometry + BottomLevel + TopLevel; }
+};
+
+static SceneMemory MeasureMemory(const CPU::Scene& scene)
+{
+	SceneMemory memory;
+	memory.Geometry = scene.GetVertices().size() * sizeof(Vertex) + scene.GetIndices().size() * sizeof(uint32_t);
+
+	for (const CPU::BVH& bvh : scene.GetBottomLevelBVHs())
+		memory.BottomLevel += bvh.GetNodes().size() * sizeof(CPU::BVHNode) + bvh.GetPrimitiveIndices().size() * sizeof(uint32_t);
+	for (const CPU::WideBVH& bvh : scene.GetBottomLevelWideBVHs())
+		memory.BottomLevel += bvh.GetNodes().size() * sizeof(CPU::WideBVHNode) + bvh.GetTriangles().size() * sizeof(CPU::WideBVHTriangle);
+
+	const CPU::BVH& topLevel = scene.GetTopLevelBVH();
+	memory.TopLevel = topLevel.GetNodes().size() * sizeof(CPU::BVHNode) + topLevel.GetPrimitiveIndices().size() * sizeof(uint32_t);
+	memory.TopLevel += scene.GetInstances().size() * sizeof(CPU::Instance) + scene.GetMeshInstances().size() * sizeof(CPU::MeshInstance);
+
+	return memory;
+}
+
+// Shared geometry: the mesh is added once and every grid cell is an instance of it
+static double LoadInstanced(const Ref<MeshSource>& meshSource, uint32_t count, CPU::Scene& scene)
+{
+	Clock::time_point start = Clock::now();
+
+	uint32_t meshIndex = scene.AddMesh(meshSource);
+
+	glm::vec3 boundsMin, boundsMax;
+	scene.GetMeshBounds(meshIndex, boundsMin, boundsMax);
+	for (const CPU::MeshInstance& instance : CPU::CreateInstanceGrid(meshIndex, count, boundsMin, boundsMax, glm::mat4(1.0f)))
+		scene.AddInstance(instance);
+	scene.RebuildTopLevel();
+
+	return SecondsSince(start);
+}
+
+// Duplicated geometry: every grid cell adds the mesh again, as a single mesh per scene would have to
+static double LoadDuplicated(const Ref<MeshSource>& meshSource, uint32_t count, CPU::Scene& scene)
+{
+	Clock::time_point start = Clock::now();
+
+	std::vector<CPU::MeshInstance> grid;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t meshIndex = scene.AddMesh(meshSource);
+		if (i == 0)
+		{
+			glm::vec3 boundsMin, boundsMax;
+			scene.GetMeshBounds(meshIndex, boundsMin, boundsMax);
+			grid = CPU::CreateInstanceGrid(meshIndex, count, boundsMin, boundsMax, glm::mat4(1.0f));
+		}
+
+		CPU::MeshInstance instance = grid[i];
+		instance.MeshIndex = meshIndex;
+		scene.AddInstance(instance);
+	}
+	scene.RebuildTopLevel();
+
+	return SecondsSince(start);
+}
+
+// Rays from outside the bounds towards random points inside, so most of them hit something
+static std::vector<CPU::Ray> GenerateRays(const CPU::Scene& scene, uint32_t count)
+{
+	glm::vec3 boundsMin = scene.GetBoundsMin();
+	glm::vec3 extent = scene.GetBoundsMax() - boundsMin;
+	float radius = glm::length(extent);
+	glm::vec3 center = boundsMin + extent * 0.5f;
+
+	std::vector<CPU::Ray> rays(count);
+	uint32_t seed = 1;
+	for (CPU::Ray& ray : rays)
+	{
+		glm::vec3 target = boundsMin + extent * glm::vec3(CPU::RandomValue(seed), CPU::RandomValue(seed), CPU::RandomValue(seed));
+		glm::vec3 direction = glm::normalize(glm::vec3(CPU::RandomValue(seed), CPU::RandomValue(seed), CPU::RandomValue(seed)) * 2.0f - 1.0f);
+
+		ray.Origin = center - direction * radius;
+		ray.Direction = glm::normalize(target - ray.Origin);
+	}
+	return rays;
+}
+
+static double TraceRays(const CPU::Scene& scene, const std::vector<CPU::Ray>& rays, std::vector<CPU::Hit>& hits)
+{
+	hits.resize(rays.size());
+
+	Clock::time_point start = Clock::now();
+	CPU::ThreadPool::Get().ParallelFor((uint32_t)rays.size(), [&](uint32_t i)
+	{
+		scene.Intersect(rays[i], hits[i]);
+	});
+	return SecondsSince(start);
+}
+
+static uint32_t CountMismatches(const std::vector<CPU::Hit>& a, const std::vector<CPU::Hit>& b)
+{
+	uint32_t mismatches = 0;
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		bool hitA = a[i].Distance >= 0.0f;
+		bool hitB = b[i].Distance >= 0.0f;
+		if (hitA != hitB || (hitA && (a[i].Distance != b[i].Distance || a[i].InstanceIndex != b[i].InstanceIndex || a[i].PrimitiveIndex != b[i].PrimitiveIndex)))
+			mismatches++;
+	}
+	return mismatches;
+}
+
+int RunInstancingBenchmark(int argc, char** argv)
+{
+	std::string model = s_SuzanneModel;
+	uint32_t maxInstances = s_DefaultMaxInstances;
+	uint32_t rayCount = s_DefaultRays;
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (strcmp(argv[i], "--model") == 0)
+			model = argv[++i];
+		else if (strcmp(argv[i], "--max-instances") == 0)
+			maxInstances = (uint32_t)glm::max(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--rays") == 0)
+			rayCount = (uint32_t)glm::max(1, atoi(argv[++i]));
+	}
+
+	Ref<MeshSource> meshSource = CreateRef<MeshSource>(model);
+	if (meshSource->GetSubMeshes().empty())
+	{
+		printf("%s: no geometry\n", model.c_str());
+		return 1;
+	}
+
+	// Start the workers before anything is timed, the first load would pay for it otherwise
+	CPU::ThreadPool::Get();
+
+	printf("%s, %zu submeshes, %zu triangles, %u rays\n", model.c_str(), meshSource->GetSubMeshes().size(), meshSource->GetIndices().size() / 3, rayCount);
+	printf("%9s %10s %10s %10s %10s %10s %8s %11s %11s\n", "instances", "load ms", "vs 1", "geom MB", "BLAS MB", "TLAS MB", "Mrays/s", "dup load ms", "dup MB");
+
+	double singleLoad = 0.0;
+	bool matching = true;
+	for (uint32_t count = 1;; count = glm::min(count * 10, maxInstances))
+	{
+		CPU::Scene instanced;
+		double loadSeconds = LoadInstanced(meshSource, count, instanced);
+		if (count == 1)
+			singleLoad = loadSeconds;
+
+		SceneMemory memory = MeasureMemory(instanced);
+
+		std::vector<CPU::Ray> rays = GenerateRays(instanced, rayCount);
+		std::vector<CPU::Hit> hits;
+		double traceSeconds = TraceRays(instanced, rays, hits);
+
+		printf("%9u %10.2f %9.2fx %10.2f %10.2f %10.2f %8.2f", count, loadSeconds * 1000.0, loadSeconds / glm::max(singleLoad, 1e-9),
+			memory.Geometry / (1024.0 * 1024.0), memory.BottomLevel / (1024.0 * 1024.0), memory.TopLevel / (1024.0 * 1024.0), rayCount / traceSeconds * 1e-6);
+
+		// Reference with one copy of the geometry per instance, the hits have to agree exactly
+		if (count <= s_MaxDuplicatedInstances)
+		{
+			CPU::Scene duplicated;
+			double duplicatedSeconds = LoadDuplicated(meshSource, count, duplicated);
+
+			std::vector<CPU::Hit> duplicatedHits;
+			TraceRays(duplicated, rays, duplicatedHits);
+
+			uint32_t mismatches = CountMismatches(hits, duplicatedHits);
+			printf(" %11.2f %11.2f", duplicatedSeconds * 1000.0, MeasureMemory(duplicated).Total() / (1024.0 * 1024.0));
+			if (mismatches > 0)
+			{
+				printf("  %u of %u hits differ", mismatches, rayCount);
+				matching = false;
+			}
+		}
+		printf("\n");
+
+		if (count == maxInstances)
+			break;
+	}
+
+	printf("Instanced and duplicated hits %s\n", matching ? "match" : "DIFFER");
+	return matching ? 0 : 1;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+// `PathTracer --bench-instancing [--model path] [--max-instances n] [--rays n]` places a model on a
+// grid of 1 to n instances (10000 by default, Suzanne) and reports the CPU scene load time, the
+// memory of the geometry, BVHs and instances and the closest hit throughput. Up to 256 instances the
+// same layout is also loaded with duplicated geometry, every instance building its own bottom level
+// BVHs, and both scenes must return the same hits. Returns 1 if they differ.
+int RunInstancingBenchmark(int argc, char** argv);
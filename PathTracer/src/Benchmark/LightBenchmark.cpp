@@ -0,0 +1,224 @@
+#include "Benchmark/LightBenchmark.h"
+#include "Benchmark/BenchmarkCommon.h"
+#include "CPU/LightSampler.h"
+#include "CPU/Disney.h"
+#include "CPU/ThreadPool.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace VkLibrary;
+
+static constexpr uint32_t s_DefaultSamples = 1 << 20;
+static constexpr uint32_t s_PointCount = 16;
+static constexpr uint32_t s_ChunkSize = 4096;
+
+// Lights expected to be picked fewer times than this are left out of the frequency check
+static constexpr float s_MinExpectedCount = 16.0f;
+
+// Failure thresholds. Pdfs only differ by float rounding, the frequency check is statistical and the
+// largest of a few thousand normal deviations stays well below 6 sigma
+static constexpr double s_MaxSumError = 1e-3;
+static constexpr double s_MaxDeviation = 6.0;
+static constexpr float s_MaxPdfError = 1e-3f;
+static constexpr double s_MaxPdfMismatchRate = 1e-3;
+
+static glm::vec3 RandomVector(uint32_t& seed)
+{
+	return glm::vec3(CPU::RandomValue(seed), CPU::RandomValue(seed), CPU::RandomValue(seed));
+}
+
+// Shading points spread through the scene bounds
+static std::vector<glm::vec3> GeneratePoints(const CPU::Scene& scene)
+{
+	glm::vec3 extent = scene.GetBoundsMax() - scene.GetBoundsMin();
+	std::vector<glm::vec3> points(s_PointCount);
+	uint32_t seed = 17;
+	for (glm::vec3& point : points)
+		point = scene.GetBoundsMin() + extent * (0.05f + 0.9f * RandomVector(seed));
+
+	return points;
+}
+
+// Gives every material a different emission so the sampler has many lights of uneven power
+static void MakeEmissive(CPU::Scene& scene)
+{
+	uint32_t seed = 3;
+	for (uint32_t i = 0; i < (uint32_t)scene.GetMaterials().size(); i++)
+	{
+		MaterialBuffer material = scene.GetMaterials()[i];
+		material.data.EmissiveValue = glm::vec3(1.0f);
+		material.data.EmissiveStrength = 0.1f + 10.0f * CPU::RandomValue(seed);
+		scene.SetMaterial(i, material);
+	}
+}
+
+// Returns false if the sampler fails any of the checks
+static bool BenchmarkSampler(const CPU::Scene& scene, const CPU::LightSamplerSpecification& spec, uint32_t sampleCount)
+{
+	CPU::LightSampler sampler(spec);
+	Clock::time_point start = Clock::now();
+	sampler.Build(scene);
+	double buildSeconds = SecondsSince(start);
+
+	uint32_t lightCount = sampler.GetLightCount();
+	std::vector<glm::vec3> points = GeneratePoints(scene);
+
+	// Selection probabilities over all lights sum to one from anywhere
+	double maxSumError = 0.0;
+	for (const glm::vec3& point : points)
+	{
+		double sum = 0.0;
+		for (uint32_t light = 0; light < lightCount; light++)
+			sum += sampler.SelectionPdf(point, light);
+		maxSumError = glm::max(maxSumError, glm::abs(sum - 1.0));
+	}
+
+	// Picked frequencies match the selection pdf, as the largest deviation in standard deviations
+	const glm::vec3& point = points[0];
+	std::vector<uint32_t> counts(lightCount, 0);
+	float maxPdfError = 0.0f;
+	uint32_t seed = 1;
+	for (uint32_t i = 0; i < sampleCount; i++)
+	{
+		float selectionPdf;
+		uint32_t light = sampler.SelectLight(point, CPU::RandomValue(seed), selectionPdf);
+		if (light == CPU::LightSampler::InvalidLight)
+			continue;
+
+		counts[light]++;
+		maxPdfError = glm::max(maxPdfError, glm::abs(selectionPdf - sampler.SelectionPdf(point, light)) / selectionPdf);
+	}
+
+	double maxDeviation = 0.0;
+	uint32_t checkedLights = 0;
+	for (uint32_t light = 0; light < lightCount; light++)
+	{
+		double p = sampler.SelectionPdf(point, light);
+		double expected = p * sampleCount;
+		if (expected < s_MinExpectedCount)
+			continue;
+
+		maxDeviation = glm::max(maxDeviation, glm::abs(counts[light] - expected) / glm::sqrt(expected * (1.0 - p)));
+		checkedLights++;
+	}
+
+	// Sample agrees with Pdf
+	std::atomic<uint32_t> pdfMismatches = 0;
+	uint32_t validationCount = sampleCount / 16;
+	CPU::ThreadPool::Get().ParallelFor((validationCount + s_ChunkSize - 1) / s_ChunkSize, [&](uint32_t chunk)
+	{
+		uint32_t chunkSeed = chunk * 9781u + 5u;
+		for (uint32_t i = chunk * s_ChunkSize; i < glm::min((chunk + 1) * s_ChunkSize, validationCount); i++)
+		{
+			const glm::vec3& position = points[i % s_PointCount];
+			glm::vec3 u = RandomVector(chunkSeed);
+
+			CPU::LightSampleRec lightSample;
+			if (!sampler.Sample(position, u, lightSample))
+				continue;
+
+			float selectionPdf;
+			uint32_t light = sampler.SelectLight(position, u.x, selectionPdf);
+			float pdf = sampler.Pdf(position, light, position + lightSample.direction * lightSample.dist);
+			if (glm::abs(pdf - lightSample.pdf) > 1e-3f * lightSample.pdf)
+				pdfMismatches++;
+		}
+	});
+
+	// Every light is reached from exactly the triangle it was made from, which is how hits find their pdf for MIS
+	uint32_t indexMismatches = 0;
+	std::vector<uint32_t> references(lightCount, 0);
+	for (uint32_t instanceIndex = 0; instanceIndex < (uint32_t)scene.GetInstances().size(); instanceIndex++)
+	{
+		const CPU::Instance& instance = scene.GetInstances()[instanceIndex];
+		for (uint32_t primitive = 0; primitive < instance.IndexCount / 3; primitive++)
+		{
+			uint32_t light = sampler.GetLightIndex(instanceIndex, primitive);
+			if (light == CPU::LightSampler::InvalidLight)
+				continue;
+
+			const CPU::EmissiveTriangle& triangle = sampler.GetLights()[light];
+			const Vertex& vertex = scene.GetVertices()[scene.GetIndices()[instance.IndexOffset + primitive * 3] + instance.VertexOffset];
+			glm::vec3 v0 = glm::vec3(instance.ObjectToWorld * glm::vec4(vertex.Position, 1.0f));
+			if (triangle.InstanceIndex != instanceIndex || v0 != triangle.V0)
+				indexMismatches++;
+
+			references[light]++;
+		}
+	}
+	for (uint32_t count : references)
+		indexMismatches += count != 1 ? 1 : 0;
+
+	// Full samples per second from random points
+	start = Clock::now();
+	std::atomic<uint32_t> validSamples = 0;
+	CPU::ThreadPool::Get().ParallelFor((sampleCount + s_ChunkSize - 1) / s_ChunkSize, [&](uint32_t chunk)
+	{
+		uint32_t chunkSeed = chunk * 7919u + 3u;
+		uint32_t chunkValid = 0;
+		for (uint32_t i = chunk * s_ChunkSize; i < glm::min((chunk + 1) * s_ChunkSize, sampleCount); i++)
+		{
+			CPU::LightSampleRec lightSample;
+			chunkValid += sampler.Sample(points[i % s_PointCount], RandomVector(chunkSeed), lightSample) ? 1 : 0;
+		}
+		validSamples += chunkValid;
+	});
+	double samplesPerSecond = sampleCount / SecondsSince(start) * 1e-6;
+
+	printf("  %-11s build %8.2f ms, %7.2f Msamples/s (%u threads, %.1f%% valid) | pdf sum error %.2e, max deviation %.2f sigma over %u lights, selection pdf error %.2e | %u/%u pdf mismatches, %u light index mismatches\n",
+		sampler.GetMode() == CPU::LightSamplingMode::BVH ? "light BVH" : "alias table", buildSeconds * 1000.0, samplesPerSecond, CPU::ThreadPool::Get().GetThreadCount(), 100.0 * validSamples / sampleCount,
+		maxSumError, maxDeviation, checkedLights, maxPdfError, (uint32_t)pdfMismatches, validationCount, indexMismatches);
+
+	bool passed = maxSumError <= s_MaxSumError && maxDeviation <= s_MaxDeviation && maxPdfError <= s_MaxPdfError &&
+		pdfMismatches <= validationCount * s_MaxPdfMismatchRate && indexMismatches == 0;
+	if (!passed)
+		printf("  MISMATCH\n");
+	return passed;
+}
+
+int RunLightBenchmark(int argc, char** argv)
+{
+	std::vector<std::string> models = GetModelArguments(argc, argv, { s_CornellBoxModel, s_SponzaModel });
+	uint32_t sampleCount = s_DefaultSamples;
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (strcmp(argv[i], "--samples") == 0)
+			sampleCount = (uint32_t)glm::max(1, atoi(argv[++i]));
+	}
+
+	bool passed = true;
+	for (const std::string& model : models)
+	{
+		Ref<MeshSource> meshSource = CreateRef<MeshSource>(model);
+		CPU::Scene scene(meshSource, glm::mat4(1.0f));
+		if (scene.GetInstances().empty())
+		{
+			printf("%s: no geometry\n", model.c_str());
+			continue;
+		}
+
+		CPU::LightSampler probe;
+		probe.Build(scene);
+		bool madeEmissive = probe.GetLightCount() == 0;
+		if (madeEmissive)
+		{
+			MakeEmissive(scene);
+			probe.Build(scene);
+		}
+
+		printf("%s: %u emissive triangles%s\n", model.c_str(), probe.GetLightCount(), madeEmissive ? " (every material made emissive)" : "");
+
+		CPU::LightSamplerSpecification aliasSpec;
+		aliasSpec.BVHThreshold = 0xFFFFFFFF;
+		passed &= BenchmarkSampler(scene, aliasSpec, sampleCount);
+
+		CPU::LightSamplerSpecification bvhSpec;
+		bvhSpec.BVHThreshold = 0;
+		passed &= BenchmarkSampler(scene, bvhSpec, sampleCount);
+	}
+
+	return passed ? 0 : 1;
+}
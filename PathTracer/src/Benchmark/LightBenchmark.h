@@ -0,0 +1,8 @@
+#pragma once
+
+// `PathTracer --bench-lights [--model path] [--samples n]` checks the emissive triangle sampler of each
+// model with the alias table and with the light BVH: selection pdfs sum to one, sampled frequencies
+// match them, Sample agrees with Pdf and every emissive triangle maps to its light, which MIS relies
+// on. Models without emitters are made fully emissive. Reports build times and samples/s and returns 1
+// if a check fails. The noise at equal time is measured by running --bench-render with and without --no-nee.
+int RunLightBenchmark(int argc, char** argv);
@@ -0,0 +1,198 @@
+#include "Benchmark/RefitBenchmark.h"
+#include "Benchmark/BenchmarkCommon.h"
+#include "CPU/Scene.h"
+#include "Core/Application.h"
+#include "InstancedAccelerationStructure.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+
+using namespace VkLibrary;
+
+static constexpr uint32_t s_DefaultIterations = 100;
+static constexpr uint32_t s_GPUInstanceCount = 256;
+
+static glm::vec3 RandomOffset(uint32_t& seed, float magnitude)
+{
+	return (glm::vec3(CPU::RandomValue(seed), CPU::RandomValue(seed), CPU::RandomValue(seed)) * 2.0f - 1.0f) * magnitude;
+}
+
+// Drags one instance per iteration like the transform gizmo, then compares against rebuilding
+static void BenchmarkTopLevel(CPU::Scene& scene, uint32_t iterations)
+{
+	glm::vec3 extent = scene.GetBoundsMax() - scene.GetBoundsMin();
+	float step = glm::length(extent) * 0.01f;
+	uint32_t instanceCount = (uint32_t)scene.GetInstances().size();
+	uint32_t seed = 1;
+
+	float builtCost = scene.GetTopLevelBVH().ComputeSAHCost();
+
+	double refitSeconds = 0.0;
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		uint32_t instanceIndex = i % instanceCount;
+		glm::mat4 transform = glm::translate(glm::mat4(1.0f), RandomOffset(seed, step)) * scene.GetInstances()[instanceIndex].ObjectToWorld;
+
+		Clock::time_point start = Clock::now();
+		scene.SetInstanceTransform(instanceIndex, transform);
+		refitSeconds += SecondsSince(start);
+	}
+	float refitCost = scene.GetTopLevelBVH().ComputeSAHCost();
+
+	double rebuildSeconds = 0.0;
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		Clock::time_point start = Clock::now();
+		scene.RebuildTopLevel();
+		rebuildSeconds += SecondsSince(start);
+	}
+	float rebuiltCost = scene.GetTopLevelBVH().ComputeSAHCost();
+
+	printf("  top level    (%5u instances): refit %8.4f ms, rebuild %8.4f ms (%.1fx), SAH cost built %.2f, after refits %.2f, rebuilt %.2f\n",
+		instanceCount, refitSeconds * 1000.0 / iterations, rebuildSeconds * 1000.0 / iterations, rebuildSeconds / glm::max(refitSeconds, 1e-12),
+		builtCost, refitCost, rebuiltCost);
+}
+
+// Jitters every vertex of the largest submesh, the case a deforming or animated mesh would hit
+static void BenchmarkBottomLevel(const CPU::Scene& scene, uint32_t iterations)
+{
+	uint32_t largest = 0;
+	for (uint32_t i = 0; i < (uint32_t)scene.GetInstances().size(); i++)
+	{
+		if (scene.GetInstances()[i].IndexCount > scene.GetInstances()[largest].IndexCount)
+			largest = i;
+	}
+
+	const CPU::Instance& instance = scene.GetInstances()[largest];
+	uint32_t triangleCount = instance.IndexCount / 3;
+	glm::vec3 extent = instance.ObjectBoundsMax - instance.ObjectBoundsMin;
+	float jitter = glm::length(extent) * 0.001f;
+
+	CPU::BVH bvh = scene.GetBottomLevelBVHs()[instance.BottomLevelIndex];
+	float builtCost = bvh.ComputeSAHCost();
+
+	std::vector<glm::vec3> boundsMin(triangleCount);
+	std::vector<glm::vec3> boundsMax(triangleCount);
+	uint32_t seed = 7;
+	auto deform = [&]()
+	{
+		for (uint32_t primitive = 0; primitive < triangleCount; primitive++)
+		{
+			boundsMin[primitive] = glm::vec3(std::numeric_limits<float>::max());
+			boundsMax[primitive] = glm::vec3(-std::numeric_limits<float>::max());
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				uint32_t index = scene.GetIndices()[instance.IndexOffset + primitive * 3 + corner] + instance.VertexOffset;
+				glm::vec3 position = scene.GetVertices()[index].Position + RandomOffset(seed, jitter);
+				boundsMin[primitive] = glm::min(boundsMin[primitive], position);
+				boundsMax[primitive] = glm::max(boundsMax[primitive], position);
+			}
+		}
+	};
+
+	double refitSeconds = 0.0;
+	double rebuildSeconds = 0.0;
+	float refitCost = 0.0f;
+	float rebuiltCost = 0.0f;
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		deform();
+
+		Clock::time_point start = Clock::now();
+		bvh.Refit(boundsMin, boundsMax);
+		refitSeconds += SecondsSince(start);
+		refitCost = bvh.ComputeSAHCost();
+
+		CPU::BVH rebuilt;
+		start = Clock::now();
+		rebuilt.Build(boundsMin, boundsMax);
+		rebuildSeconds += SecondsSince(start);
+		rebuiltCost = rebuilt.ComputeSAHCost();
+	}
+
+	printf("  bottom level (%5u triangles): refit %8.4f ms, rebuild %8.4f ms (%.1fx), SAH cost built %.2f, after refits %.2f, rebuilt %.2f\n",
+		triangleCount, refitSeconds * 1000.0 / iterations, rebuildSeconds * 1000.0 / iterations, rebuildSeconds / glm::max(refitSeconds, 1e-12),
+		builtCost, refitCost, rebuiltCost);
+}
+
+// Same edit on the GPU top level: an in place update against a full build. Both include writing the
+// instance buffer and waiting for the submit, the latency an edit in RayTracingLayer::ApplySceneChanges sees
+static void BenchmarkGPUTopLevel(const Ref<MeshSource>& meshSource, const CPU::Scene& scene, uint32_t iterations)
+{
+	glm::vec3 boundsMin, boundsMax;
+	scene.GetMeshBounds(0, boundsMin, boundsMax);
+
+	InstancedAccelerationStructureSpecification spec;
+	spec.Meshes = { CreateRef<Mesh>(meshSource) };
+	spec.Instances = CPU::CreateInstanceGrid(0, s_GPUInstanceCount, boundsMin, boundsMax, glm::mat4(1.0f));
+	InstancedAccelerationStructure accelerationStructure(spec);
+
+	std::vector<CPU::MeshInstance> instances = spec.Instances;
+	float step = glm::length(boundsMax - boundsMin) * 0.01f;
+	uint32_t seed = 1;
+
+	double updateSeconds = 0.0;
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		CPU::MeshInstance& instance = instances[i % instances.size()];
+		instance.Transform = glm::translate(glm::mat4(1.0f), RandomOffset(seed, step)) * instance.Transform;
+
+		Clock::time_point start = Clock::now();
+		accelerationStructure.SetInstances(instances);
+		updateSeconds += SecondsSince(start);
+	}
+
+	double rebuildSeconds = 0.0;
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		Clock::time_point start = Clock::now();
+		accelerationStructure.RebuildTopLevel();
+		rebuildSeconds += SecondsSince(start);
+	}
+
+	printf("  GPU top level (%5u entries): update %8.4f ms, rebuild %8.4f ms (%.1fx)\n",
+		accelerationStructure.GetInstanceCount(), updateSeconds * 1000.0 / iterations, rebuildSeconds * 1000.0 / iterations,
+		rebuildSeconds / glm::max(updateSeconds, 1e-12));
+}
+
+int RunRefitBenchmark(int argc, char** argv)
+{
+	std::string model = s_SponzaModel;
+	uint32_t iterations = s_DefaultIterations;
+	bool gpu = true;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--no-gpu") == 0)
+			gpu = false;
+		else if (i + 1 >= argc)
+			break;
+		else if (strcmp(argv[i], "--model") == 0)
+			model = argv[++i];
+		else if (strcmp(argv[i], "--iterations") == 0)
+			iterations = (uint32_t)glm::max(1, atoi(argv[++i]));
+	}
+
+	Ref<MeshSource> meshSource = CreateRef<MeshSource>(model);
+	CPU::Scene scene(meshSource, glm::mat4(1.0f));
+	if (scene.GetInstances().empty())
+	{
+		printf("%s: no geometry\n", model.c_str());
+		return 1;
+	}
+
+	printf("%s, %u iterations\n", model.c_str(), iterations);
+	BenchmarkTopLevel(scene, iterations);
+	BenchmarkBottomLevel(scene, iterations);
+
+	// The device comes from the application, it is only created when the GPU numbers are wanted
+	if (gpu)
+	{
+		Application app = Application("PathTracer Refit Benchmark");
+		BenchmarkGPUTopLevel(meshSource, scene, iterations);
+	}
+
+	return 0;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// `PathTracer --bench-refit [--model path] [--iterations n] [--no-gpu]` compares CPU BVH refit and rebuild
+// latency for moved instances (top level) and deformed geometry (bottom level), then the in place update
+// and full build of the GPU top level over a grid of copies of the model. Sponza by default
+int RunRefitBenchmark(int argc, char** argv);
@@ -0,0 +1,384 @@
+#include "Benchmark/RenderBenchmark.h"
+#include "Benchmark/BenchmarkCommon.h"
+#include "CPU/PathTracer.h"
+#include "CPU/ThreadPool.h"
+#include "CPU/ImageIO.h"
+#include "Util/Memory.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace VkLibrary;
+
+struct RenderBenchmarkOptions
+{
+	std::vector<std::string> Scenes;
+	std::string OutputPath;
+	std::string ReferenceDirectory = "assets/benchmark";
+	uint32_t Width = 640;
+	uint32_t Height = 360;
+	uint32_t Frames = 64;
+	uint32_t ReferenceFrames = 1024;
+	uint32_t Threads = 0;
+	float TargetRMSE = 0.01f;
+	bool WriteReferences = false;
+	bool AdaptiveSampling = false;
+	bool Wavefront = false;
+	bool NextEventEstimation = true;
+
+	// Equirectangular .hdr lighting the scenes instead of the constant sky
+	std::string EnvironmentPath;
+	bool EnvironmentSampling = true;
+};
+
+struct ConvergencePoint
+{
+	float SamplesPerPixel;
+	double Seconds;
+	double RMSE;
+};
+
+static void PrintUsage()
+{
+	fprintf(stderr, "Usage: PathTracerBenchmark [--scene name]... [--output file.json] [--references dir] [--width w] [--height h]\n");
+	fprintf(stderr, "                           [--frames n] [--threads n] [--target-rmse e] [--write-references] [--reference-frames n]\n");
+	fprintf(stderr, "                           [--adaptive] [--wavefront] [--no-nee] [--environment file.hdr] [--no-env-sampling]\n");
+}
+
+static bool ParseOptions(int argc, char** argv, RenderBenchmarkOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (strcmp(arg, "--bench-render") == 0)
+			continue;
+
+		if (strcmp(arg, "--write-references") == 0)
+		{
+			options.WriteReferences = true;
+			continue;
+		}
+
+		if (strcmp(arg, "--adaptive") == 0)
+		{
+			options.AdaptiveSampling = true;
+			continue;
+		}
+
+		if (strcmp(arg, "--wavefront") == 0)
+		{
+			options.Wavefront = true;
+			continue;
+		}
+
+		if (strcmp(arg, "--no-nee") == 0)
+		{
+			options.NextEventEstimation = false;
+			continue;
+		}
+
+		if (strcmp(arg, "--no-env-sampling") == 0)
+		{
+			options.EnvironmentSampling = false;
+			continue;
+		}
+
+		if (!value)
+			return false;
+
+		if (strcmp(arg, "--scene") == 0)
+			options.Scenes.push_back(value);
+		else if (strcmp(arg, "--output") == 0)
+			options.OutputPath = value;
+		else if (strcmp(arg, "--references") == 0)
+			options.ReferenceDirectory = value;
+		else if (strcmp(arg, "--width") == 0)
+			options.Width = (uint32_t)atoi(value);
+		else if (strcmp(arg, "--height") == 0)
+			options.Height = (uint32_t)atoi(value);
+		else if (strcmp(arg, "--frames") == 0)
+			options.Frames = (uint32_t)atoi(value);
+		else if (strcmp(arg, "--reference-frames") == 0)
+			options.ReferenceFrames = (uint32_t)atoi(value);
+		else if (strcmp(arg, "--threads") == 0)
+			options.Threads = (uint32_t)atoi(value);
+		else if (strcmp(arg, "--target-rmse") == 0)
+			options.TargetRMSE = (float)atof(value);
+		else if (strcmp(arg, "--environment") == 0)
+			options.EnvironmentPath = value;
+		else
+			return false;
+
+		i++;
+	}
+
+	if (options.Scenes.empty())
+	{
+		for (const BenchmarkScene& scene : GetBenchmarkScenes())
+			options.Scenes.push_back(scene.Name);
+	}
+
+	return options.Width > 0 && options.Height > 0 && options.Frames > 1 && options.ReferenceFrames > 1;
+}
+
+// Samples per pixel in the image after a frame, the first frame isn't accumulated (same as RayGen.glsl)
+static uint32_t GetAccumulatedSamples(uint32_t frameIndex, uint32_t samplesPerFrame)
+{
+	return frameIndex > 1 ? (frameIndex - 1) * samplesPerFrame : samplesPerFrame;
+}
+
+// Adaptive sampling spends different sample counts per pixel, so this is read back from the path counts
+static float GetMeanSamplesPerPixel(const CPU::PathTracer& pathTracer, uint32_t frameIndex)
+{
+	if (frameIndex == 1)
+		return (float)pathTracer.GetLastSampleCount() / pathTracer.GetImage().size();
+
+	double sum = 0.0;
+	for (const glm::vec4& accumulation : pathTracer.GetAccumulationBuffer())
+		sum += accumulation.w;
+
+	return (float)(sum / pathTracer.GetAccumulationBuffer().size());
+}
+
+// RMSE after mapping both images with x / (1 + x), so a few fireflies in an HDR image don't dominate it
+static double ComputeRMSE(const std::vector<glm::vec4>& image, const std::vector<glm::vec3>& reference)
+{
+	double sum = 0.0;
+	for (size_t i = 0; i < image.size(); i++)
+	{
+		glm::vec3 color = glm::vec3(image[i]);
+		glm::vec3 difference = color / (1.0f + color) - reference[i] / (1.0f + reference[i]);
+		sum += glm::dot(difference, difference);
+	}
+
+	return glm::sqrt(sum / (image.size() * 3.0));
+}
+
+static bool LoadReference(const std::string& filepath, uint32_t width, uint32_t height, std::vector<glm::vec3>& reference)
+{
+	std::vector<glm::vec4> accumulation;
+	uint32_t referenceWidth, referenceHeight;
+	if (!CPU::ReadAccumulation(filepath, accumulation, referenceWidth, referenceHeight))
+		return false;
+
+	if (referenceWidth != width || referenceHeight != height)
+	{
+		fprintf(stderr, "%s is %ux%u, the benchmark renders %ux%u\n", filepath.c_str(), referenceWidth, referenceHeight, width, height);
+		return false;
+	}
+
+	reference.resize(accumulation.size());
+	for (size_t i = 0; i < accumulation.size(); i++)
+		reference[i] = accumulation[i].w > 0.0f ? glm::vec3(accumulation[i]) / accumulation[i].w : glm::vec3(0.0f);
+
+	return true;
+}
+
+// Null without --environment, references have to be written with the same one
+static Ref<CPU::EnvironmentMap> LoadEnvironment(const RenderBenchmarkOptions& options)
+{
+	if (options.EnvironmentPath.empty())
+		return nullptr;
+
+	CPU::EnvironmentMapSpecification spec;
+	spec.Path = options.EnvironmentPath;
+	Ref<CPU::EnvironmentMap> environment = CreateRef<CPU::EnvironmentMap>(spec);
+	if (!environment->IsValid())
+	{
+		fprintf(stderr, "Failed to load environment %s\n", options.EnvironmentPath.c_str());
+		return nullptr;
+	}
+
+	return environment;
+}
+
+static int WriteReferences(const RenderBenchmarkOptions& options)
+{
+	Ref<CPU::EnvironmentMap> environment = LoadEnvironment(options);
+	if (!options.EnvironmentPath.empty() && !environment)
+		return 1;
+
+	std::filesystem::create_directories(options.ReferenceDirectory);
+
+	for (const std::string& name : options.Scenes)
+	{
+		const BenchmarkScene* benchmarkScene = FindBenchmarkScene(name);
+		if (!benchmarkScene)
+		{
+			fprintf(stderr, "Unknown scene %s\n", name.c_str());
+			return 1;
+		}
+
+		Ref<CPU::Scene> scene = LoadScene(benchmarkScene->ModelPath);
+		CameraBuffer camera = CreateCamera(*benchmarkScene, options.Width, options.Height);
+
+		CPU::PathTracerSpecification spec;
+		spec.Width = options.Width;
+		spec.Height = options.Height;
+		spec.Seed = s_ReferenceSeed;
+		spec.Environment = environment;
+		CPU::PathTracer pathTracer(spec, scene);
+
+		Clock::time_point start = Clock::now();
+		for (uint32_t frameIndex = 1; frameIndex <= options.ReferenceFrames; frameIndex++)
+			pathTracer.Render(camera, frameIndex);
+
+		std::string filepath = options.ReferenceDirectory + "/" + name + ".accum";
+		if (!CPU::WriteAccumulation(filepath, pathTracer.GetAccumulationBuffer(), options.Width, options.Height))
+		{
+			fprintf(stderr, "Failed to write %s\n", filepath.c_str());
+			return 1;
+		}
+
+		fprintf(stderr, "%s: %u spp reference in %.1f s\n", filepath.c_str(),
+			GetAccumulatedSamples(options.ReferenceFrames, spec.SamplesPerPixel), SecondsSince(start));
+	}
+
+	return 0;
+}
+
+int RunRenderBenchmark(int argc, char** argv)
+{
+	RenderBenchmarkOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	CPU::ThreadPool::SetDefaultThreadCount(options.Threads);
+
+	if (options.WriteReferences)
+		return WriteReferences(options);
+
+	Ref<CPU::EnvironmentMap> environment = LoadEnvironment(options);
+	if (!options.EnvironmentPath.empty() && !environment)
+		return 1;
+
+	FILE* output = options.OutputPath.empty() ? stdout : fopen(options.OutputPath.c_str(), "w");
+	if (!output)
+	{
+		fprintf(stderr, "Failed to open %s\n", options.OutputPath.c_str());
+		return 1;
+	}
+
+	// Progress goes to stderr, stdout only gets the JSON
+	fprintf(output, "{\n  \"width\": %u,\n  \"height\": %u,\n  \"frames\": %u,\n  \"threads\": %u,\n  \"target_rmse\": %g,\n  \"adaptive_sampling\": %s,\n  \"wavefront\": %s,\n  \"next_event_estimation\": %s,\n  \"environment\": \"%s\",\n  \"environment_sampling\": %s,\n"
+		"  \"convergence_columns\": [\"samples_per_pixel\", \"seconds\", \"rmse\"],\n  \"scenes\": [",
+		options.Width, options.Height, options.Frames, CPU::ThreadPool::Get().GetThreadCount(), options.TargetRMSE,
+		options.AdaptiveSampling ? "true" : "false", options.Wavefront ? "true" : "false",
+		options.NextEventEstimation && !options.Wavefront ? "true" : "false", options.EnvironmentPath.c_str(),
+		environment && options.EnvironmentSampling && !options.Wavefront ? "true" : "false");
+
+	int result = 0;
+	for (size_t sceneIndex = 0; sceneIndex < options.Scenes.size(); sceneIndex++)
+	{
+		const std::string& name = options.Scenes[sceneIndex];
+		const BenchmarkScene* benchmarkScene = FindBenchmarkScene(name);
+		if (!benchmarkScene)
+		{
+			fprintf(stderr, "Unknown scene %s\n", name.c_str());
+			result = 1;
+			continue;
+		}
+
+		Clock::time_point start = Clock::now();
+		Ref<CPU::Scene> scene = LoadScene(benchmarkScene->ModelPath);
+		double loadSeconds = SecondsSince(start);
+
+		std::vector<glm::vec3> reference;
+		std::string referencePath = options.ReferenceDirectory + "/" + name + ".accum";
+		bool hasReference = LoadReference(referencePath, options.Width, options.Height, reference);
+		if (!hasReference)
+			fprintf(stderr, "%s: no usable reference at %s, run with --write-references\n", name.c_str(), referencePath.c_str());
+
+		CameraBuffer camera = CreateCamera(*benchmarkScene, options.Width, options.Height);
+
+		CPU::PathTracerSpecification spec;
+		spec.Width = options.Width;
+		spec.Height = options.Height;
+		spec.Seed = s_BenchmarkSeed;
+		spec.AdaptiveSampling = options.AdaptiveSampling;
+		spec.Wavefront = options.Wavefront;
+		spec.NextEventEstimation = options.NextEventEstimation;
+		spec.Environment = environment;
+		spec.EnvironmentSampling = options.EnvironmentSampling;
+		CPU::PathTracer pathTracer(spec, scene);
+
+		// Only the renders are timed, computing the error is not part of the time to quality
+		double renderSeconds = 0.0;
+		double timeToTarget = -1.0;
+		float samplesToTarget = 0.0f;
+		double samples = 0.0;
+		std::vector<ConvergencePoint> convergence;
+		for (uint32_t frameIndex = 1; frameIndex <= options.Frames; frameIndex++)
+		{
+			start = Clock::now();
+			pathTracer.Render(camera, frameIndex);
+			renderSeconds += SecondsSince(start);
+			samples += (double)pathTracer.GetLastSampleCount();
+
+			if (!hasReference)
+				continue;
+
+			ConvergencePoint& point = convergence.emplace_back();
+			point.SamplesPerPixel = GetMeanSamplesPerPixel(pathTracer, frameIndex);
+			point.Seconds = renderSeconds;
+			point.RMSE = ComputeRMSE(pathTracer.GetImage(), reference);
+
+			if (timeToTarget < 0.0 && point.RMSE <= options.TargetRMSE)
+			{
+				timeToTarget = renderSeconds;
+				samplesToTarget = point.SamplesPerPixel;
+			}
+		}
+
+		uint64_t peakMemory = GetPeakMemoryUsage();
+
+		fprintf(stderr, "%s: %.2f s, %.2f Msamples/s", name.c_str(), renderSeconds, samples / renderSeconds * 1e-6);
+		if (hasReference)
+			fprintf(stderr, ", RMSE %.5f", convergence.back().RMSE);
+		fprintf(stderr, ", peak memory %.1f MB\n", peakMemory / (1024.0 * 1024.0));
+
+		fprintf(output, "%s\n    {\n", sceneIndex > 0 ? "," : "");
+		fprintf(output, "      \"name\": \"%s\",\n", name.c_str());
+		fprintf(output, "      \"model\": \"%s\",\n", benchmarkScene->ModelPath);
+		fprintf(output, "      \"load_seconds\": %.6f,\n", loadSeconds);
+		fprintf(output, "      \"render_seconds\": %.6f,\n", renderSeconds);
+		fprintf(output, "      \"samples_per_pixel\": %.2f,\n", GetMeanSamplesPerPixel(pathTracer, options.Frames));
+		fprintf(output, "      \"samples_per_second\": %.1f,\n", samples / renderSeconds);
+		// Process-wide high-water mark, scenes later in the list include the earlier ones
+		fprintf(output, "      \"peak_memory_bytes\": %llu,\n", (unsigned long long)peakMemory);
+
+		if (hasReference)
+		{
+			fprintf(output, "      \"final_rmse\": %.6f,\n", convergence.back().RMSE);
+			if (timeToTarget >= 0.0)
+				fprintf(output, "      \"time_to_target_seconds\": %.6f,\n      \"samples_to_target\": %.2f,\n", timeToTarget, samplesToTarget);
+			else
+				fprintf(output, "      \"time_to_target_seconds\": null,\n      \"samples_to_target\": null,\n");
+
+			fprintf(output, "      \"convergence\": [");
+			for (size_t i = 0; i < convergence.size(); i++)
+				fprintf(output, "%s[%.2f, %.6f, %.6f]", i > 0 ? ", " : "", convergence[i].SamplesPerPixel, convergence[i].Seconds, convergence[i].RMSE);
+			fprintf(output, "]\n");
+		}
+		else
+		{
+			fprintf(output, "      \"final_rmse\": null,\n      \"time_to_target_seconds\": null,\n      \"samples_to_target\": null,\n      \"convergence\": []\n");
+		}
+
+		fprintf(output, "    }");
+	}
+
+	fprintf(output, "\n  ]\n}\n");
+	if (output != stdout)
+		fclose(output);
+
+	return result;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// `PathTracerBenchmark [--scene name]... [--output results.json]` renders the benchmark scenes with the
+// CPU path tracer from fixed cameras and seeds, and reports samples/sec, time to a target RMSE against
+// the stored reference images and peak memory as JSON. `--write-references` renders the references.
+int RunRenderBenchmark(int argc, char** argv);
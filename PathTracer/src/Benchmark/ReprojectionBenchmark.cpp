@@ -0,0 +1,187 @@
+#include "Benchmark/ReprojectionBenchmark.h"
+#include "Benchmark/BenchmarkCommon.h"
+#include "CPU/PathTracer.h"
+#include "CPU/Reprojection.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace VkLibrary;
+
+// Reprojecting onto the same camera only resamples the history at its own pixel centers
+static constexpr float s_Tolerance = 1e-3f;
+
+struct CameraMove
+{
+	const char* Name;
+	glm::vec3 Eye;
+	glm::vec3 Target;
+};
+
+static glm::vec3 RotateY(const glm::vec3& v, float degrees)
+{
+	float c = glm::cos(glm::radians(degrees));
+	float s = glm::sin(glm::radians(degrees));
+	return glm::vec3(c * v.x + s * v.z, v.y, -s * v.x + c * v.z);
+}
+
+// Small steps of interactive navigation away from the accumulated camera
+static std::vector<CameraMove> CreateMoves(const BenchmarkScene& scene)
+{
+	glm::vec3 eye = scene.Eye;
+	glm::vec3 target = scene.Target;
+	glm::vec3 forward = glm::normalize(target - eye);
+	glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+	return {
+		{ "pan",   eye + right * 0.15f, target + right * 0.15f },
+		{ "dolly", eye + forward * 0.5f, target },
+		{ "orbit", target + RotateY(eye - target, 3.0f), target },
+		{ "turn",  eye, eye + RotateY(target - eye, 2.0f) }
+	};
+}
+
+static CPU::PathTracerSpecification CreateSpecification(uint32_t width, uint32_t height, uint32_t seed)
+{
+	CPU::PathTracerSpecification spec;
+	spec.Width = width;
+	spec.Height = height;
+	spec.Seed = seed;
+	spec.Reprojection = true;
+	return spec;
+}
+
+static std::vector<glm::vec4> RenderReference(const Ref<CPU::Scene>& scene, const CameraBuffer& camera, uint32_t width, uint32_t height, uint32_t frames)
+{
+	CPU::PathTracerSpecification spec = CreateSpecification(width, height, s_ReferenceSeed);
+	spec.Reprojection = false;
+	CPU::PathTracer pathTracer(spec, scene);
+
+	for (uint32_t frameIndex = 1; frameIndex <= frames; frameIndex++)
+		pathTracer.Render(camera, frameIndex);
+
+	const std::vector<glm::vec4>& accumulation = pathTracer.GetAccumulationBuffer();
+	std::vector<glm::vec4> image(accumulation.size());
+	for (size_t i = 0; i < accumulation.size(); i++)
+		image[i] = accumulation[i].w > 0.0f ? glm::vec4(glm::vec3(accumulation[i]) / accumulation[i].w, 1.0f) : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	return image;
+}
+
+// RMSE after mapping both images with x / (1 + x), same as the render benchmark
+static double ComputeRMSE(const std::vector<glm::vec4>& image, const std::vector<glm::vec4>& reference)
+{
+	double sum = 0.0;
+	for (size_t i = 0; i < image.size(); i++)
+	{
+		glm::vec3 color = glm::vec3(image[i]);
+		glm::vec3 expected = glm::vec3(reference[i]);
+		glm::vec3 difference = color / (1.0f + color) - expected / (1.0f + expected);
+		sum += glm::dot(difference, difference);
+	}
+
+	return glm::sqrt(sum / (image.size() * 3.0));
+}
+
+static float MeanSamplesPerPixel(const std::vector<glm::vec4>& accumulation)
+{
+	double sum = 0.0;
+	for (const glm::vec4& pixel : accumulation)
+		sum += pixel.w;
+	return (float)(sum / accumulation.size());
+}
+
+// Reprojects the history onto its own camera and an empty frame, which has to give the history back
+static bool CheckIdentity(const CPU::PathTracer& history, const CameraBuffer& camera, uint32_t width, uint32_t height)
+{
+	CPU::Reprojector reprojector(history.GetSpecification().ReprojectionSpec);
+	reprojector.Resize(width, height);
+	reprojector.StoreHistory(camera, history.GetAccumulationBuffer(), history.GetMomentsBuffer(), history.GetNormalDepthBuffer());
+
+	std::vector<glm::vec4> accumulation(history.GetAccumulationBuffer().size(), glm::vec4(0.0f));
+	std::vector<glm::vec4> moments(accumulation.size(), glm::vec4(0.0f));
+	std::vector<glm::vec4> image(accumulation.size());
+
+	Clock::time_point start = Clock::now();
+	reprojector.Reproject(camera, history.GetNormalDepthBuffer(), accumulation, moments, image);
+	double milliseconds = SecondsSince(start) * 1000.0;
+
+	float maxDifference = 0.0f;
+	for (size_t i = 0; i < accumulation.size(); i++)
+	{
+		const glm::vec4& expected = history.GetAccumulationBuffer()[i];
+		float difference = glm::length(accumulation[i] - expected) / (glm::length(expected) + 1e-3f);
+		maxDifference = glm::max(maxDifference, difference);
+	}
+
+	uint32_t pixelCount = width * height;
+	bool passed = reprojector.GetReprojectedPixelCount() == pixelCount && maxDifference <= s_Tolerance;
+	printf("%-6s %6.2f%% kept, max relative difference %g, reprojection %.2f ms%s\n", "none",
+		100.0 * reprojector.GetReprojectedPixelCount() / pixelCount, maxDifference, milliseconds, passed ? "" : " MISMATCH");
+	return passed;
+}
+
+int RunReprojectionBenchmark(int argc, char** argv)
+{
+	std::string model = s_CornellBoxModel;
+	uint32_t frames = 8;
+	uint32_t referenceFrames = 64;
+	uint32_t width = 320;
+	uint32_t height = 180;
+
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (strcmp(argv[i], "--model") == 0)
+			model = argv[++i];
+		else if (strcmp(argv[i], "--frames") == 0)
+			frames = glm::max((uint32_t)strtoul(argv[++i], nullptr, 10), 2u);
+		else if (strcmp(argv[i], "--reference-frames") == 0)
+			referenceFrames = glm::max((uint32_t)strtoul(argv[++i], nullptr, 10), 2u);
+		else if (strcmp(argv[i], "--width") == 0)
+			width = glm::max((uint32_t)strtoul(argv[++i], nullptr, 10), 1u);
+		else if (strcmp(argv[i], "--height") == 0)
+			height = glm::max((uint32_t)strtoul(argv[++i], nullptr, 10), 1u);
+	}
+
+	Ref<CPU::Scene> scene = LoadScene(model);
+
+	const BenchmarkScene& benchmarkScene = *FindBenchmarkScene("CornellBox");
+	CameraBuffer camera = CreateCamera(benchmarkScene, width, height);
+	CPU::PathTracer history(CreateSpecification(width, height, s_BenchmarkSeed), scene);
+
+	Clock::time_point start = Clock::now();
+	for (uint32_t frameIndex = 1; frameIndex <= frames; frameIndex++)
+		history.Render(camera, frameIndex);
+	printf("%s: %ux%u, %u frames (%.1f spp) in %.2f s\n", model.c_str(), width, height, frames,
+		MeanSamplesPerPixel(history.GetAccumulationBuffer()), SecondsSince(start));
+
+	bool passed = CheckIdentity(history, camera, width, height);
+
+	for (const CameraMove& move : CreateMoves(benchmarkScene))
+	{
+		CameraBuffer movedCamera = CreateCamera(move.Eye, move.Target, benchmarkScene.FOV, width, height);
+
+		// The frame after the move, once on top of the history and once after a restart
+		CPU::PathTracer reprojected = history;
+		reprojected.Render(movedCamera, frames + 1);
+
+		CPU::PathTracer restarted(CreateSpecification(width, height, s_BenchmarkSeed), scene);
+		restarted.Render(movedCamera, 1);
+
+		std::vector<glm::vec4> reference = RenderReference(scene, movedCamera, width, height, referenceFrames);
+
+		double reprojectedRMSE = ComputeRMSE(reprojected.GetImage(), reference);
+		double restartedRMSE = ComputeRMSE(restarted.GetImage(), reference);
+		bool improved = reprojected.HasReprojected() && reprojectedRMSE < restartedRMSE;
+		passed &= improved;
+
+		uint32_t pixelCount = width * height;
+		printf("%-6s %6.2f%% kept, %.1f spp, RMSE %.5f reprojected, %.5f restarted%s\n", move.Name,
+			100.0 * reprojected.GetReprojector().GetReprojectedPixelCount() / pixelCount, MeanSamplesPerPixel(reprojected.GetAccumulationBuffer()),
+			reprojectedRMSE, restartedRMSE, improved ? "" : " WORSE");
+	}
+
+	return passed ? 0 : 1;
+}
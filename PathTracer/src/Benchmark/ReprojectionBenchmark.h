@@ -0,0 +1,9 @@
+#pragma once
+
+// `PathTracer --bench-reproject [--model path] [--frames n] [--reference-frames n] [--width w] [--height h]`
+// accumulates n frames of the Cornell box, then moves the camera by a few synthetic steps (pan, dolly,
+// orbit, turn) and renders one frame after each with reprojection. Reports the share of pixels that kept
+// their history and the RMSE of the result and of a restarted accumulation against a long render from
+// the new camera. Returns 1 if reprojecting onto the unmoved camera changes the accumulation, or if a
+// move ends up with more error than restarting.
+int RunReprojectionBenchmark(int argc, char** argv);
@@ -0,0 +1,349 @@
+#include "Benchmark/SamplerBenchmark.h"
+#include "Benchmark/BenchmarkCommon.h"
+#include "CPU/PathTracer.h"
+#include "CPU/Sampler.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace VkLibrary;
+
+static const CPU::SamplerType s_Samplers[] = { CPU::SamplerType::Random, CPU::SamplerType::Sobol, CPU::SamplerType::BlueNoise };
+
+// Nets are checked up to 2^12 points in these pixels and sets
+static constexpr uint32_t s_MaxNetLog2 = 12;
+static const glm::uvec2 s_NetPixels[] = { { 0, 0 }, { 1, 0 }, { 17, 5 }, { 63, 63 }, { 640, 360 }, { 1279, 719 } };
+static const uint32_t s_NetSets[] = { CPU::SAMPLE_SET_PIXEL, 1, 2, 3, 4, 5, 6, 7, 8, 41, 77 };
+
+// Variance of the 5x5 box filtered mask relative to the same filter on white noise
+static constexpr uint32_t s_MaskFilterRadius = 2;
+static constexpr double s_MaxMaskLowFrequency = 0.25;
+
+static const uint32_t s_IntegrationSampleCounts[] = { 4, 16, 64, 256 };
+static constexpr uint32_t s_IntegrationPixels = 32;
+
+static const uint32_t s_RenderSampleCounts[] = { 5, 20, 80 };
+
+// Every interval [k, k + 1) / 2^m holds exactly one of the first 2^m values
+static bool IsNet1D(const std::vector<glm::vec4>& points, uint32_t dimension, uint32_t log2Count)
+{
+	uint32_t count = 1u << log2Count;
+	std::vector<uint8_t> cells(count, 0);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t cell = (uint32_t)(points[i][dimension] * (float)count);
+		if (cells[cell]++)
+			return false;
+	}
+	return true;
+}
+
+// Every elementary interval of area 2^-m, 2^k by 2^(m - k) cells for every k, holds exactly one of the
+// first 2^m points in xy
+static bool IsNet2D(const std::vector<glm::vec4>& points, uint32_t log2Count)
+{
+	uint32_t count = 1u << log2Count;
+	std::vector<uint8_t> cells(count);
+	for (uint32_t k = 0; k <= log2Count; k++)
+	{
+		std::fill(cells.begin(), cells.end(), (uint8_t)0);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint32_t x = (uint32_t)(points[i].x * (float)(1u << k));
+			uint32_t y = (uint32_t)(points[i].y * (float)(1u << (log2Count - k)));
+			if (cells[x + (y << k)]++)
+				return false;
+		}
+	}
+	return true;
+}
+
+static bool CheckSobolStratification()
+{
+	uint32_t checked = 0;
+	uint32_t failed = 0;
+	std::vector<glm::vec4> points(1u << s_MaxNetLog2);
+	for (const glm::uvec2& pixel : s_NetPixels)
+	{
+		for (uint32_t set : s_NetSets)
+		{
+			for (uint32_t i = 0; i < (uint32_t)points.size(); i++)
+			{
+				CPU::PixelSampler sampler = CPU::BeginPixelSample(CPU::SamplerType::Sobol, pixel.x, pixel.y, 1280, i, s_BenchmarkSeed);
+				points[i] = CPU::SampleDimensions(sampler, set);
+			}
+
+			for (uint32_t m = 0; m <= s_MaxNetLog2; m++)
+			{
+				bool net = IsNet2D(points, m);
+				for (uint32_t dimension = 0; dimension < 4; dimension++)
+					net &= IsNet1D(points, dimension, m);
+
+				checked++;
+				if (!net)
+				{
+					if (failed++ < 8)
+						printf("  pixel (%u, %u), set %u: the first %u points are not stratified\n", pixel.x, pixel.y, set, 1u << m);
+				}
+			}
+		}
+	}
+
+	printf("Sobol stratification: %u of %u prefixes are nets in every dimension and in xy%s\n", checked - failed, checked, failed ? " FAILED" : "");
+	return failed == 0;
+}
+
+// Variance of the mask values after a box filter, the low frequency content
+static double LowFrequencyVariance(const std::vector<uint32_t>& mask, uint32_t size)
+{
+	int32_t radius = (int32_t)s_MaskFilterRadius;
+	double count = (double)mask.size();
+	double sum = 0.0;
+	for (uint32_t y = 0; y < size; y++)
+	{
+		for (uint32_t x = 0; x < size; x++)
+		{
+			double filtered = 0.0;
+			for (int32_t dy = -radius; dy <= radius; dy++)
+			{
+				for (int32_t dx = -radius; dx <= radius; dx++)
+				{
+					uint32_t sx = (x + size + dx) % size;
+					uint32_t sy = (y + size + dy) % size;
+					filtered += mask[sx + sy * size] / count - 0.5;
+				}
+			}
+			filtered /= (double)((2 * radius + 1) * (2 * radius + 1));
+			sum += filtered * filtered;
+		}
+	}
+	return sum / count;
+}
+
+static bool CheckBlueNoiseMask()
+{
+	Clock::time_point start = Clock::now();
+	std::vector<uint32_t> mask = CPU::GenerateBlueNoiseMask(CPU::BLUE_NOISE_SIZE);
+	double milliseconds = SecondsSince(start) * 1000.0;
+
+	std::vector<uint32_t> sorted = mask;
+	std::sort(sorted.begin(), sorted.end());
+	bool permutation = true;
+	for (uint32_t i = 0; i < (uint32_t)sorted.size(); i++)
+		permutation &= sorted[i] == i;
+
+	// Same ranks shuffled, white noise
+	std::vector<uint32_t> white = sorted;
+	uint32_t seed = s_BenchmarkSeed;
+	for (uint32_t i = (uint32_t)white.size() - 1; i > 0; i--)
+		std::swap(white[i], white[CPU::PCG_Hash(seed) % (i + 1)]);
+
+	double ratio = LowFrequencyVariance(mask, CPU::BLUE_NOISE_SIZE) / LowFrequencyVariance(white, CPU::BLUE_NOISE_SIZE);
+	bool matches = mask == CPU::GetBlueNoiseMask();
+	bool passed = permutation && matches && ratio <= s_MaxMaskLowFrequency;
+
+	printf("Blue noise mask: %ux%u in %.2f ms, %s, low frequency energy %.3f of white noise%s\n", CPU::BLUE_NOISE_SIZE, CPU::BLUE_NOISE_SIZE, milliseconds,
+		permutation ? "permutation" : "NOT A PERMUTATION", ratio, passed ? "" : " FAILED");
+	return passed;
+}
+
+static void TimeSamplers()
+{
+	const uint32_t count = 1 << 20;
+	for (CPU::SamplerType type : s_Samplers)
+	{
+		glm::vec4 sum = glm::vec4(0.0f);
+		Clock::time_point start = Clock::now();
+		for (uint32_t i = 0; i < count; i++)
+		{
+			CPU::PixelSampler sampler = CPU::BeginPixelSample(type, i & 255, (i >> 8) & 255, 256, i >> 16, s_BenchmarkSeed);
+			sum += CPU::SampleDimensions(sampler, i & 15);
+		}
+		double nanoseconds = SecondsSince(start) * 1e9 / count;
+		printf("  %-10s %6.1f ns per set (checksum %.1f)\n", CPU::GetSamplerName(type), nanoseconds, sum.x + sum.y + sum.z + sum.w);
+	}
+}
+
+struct Integrand
+{
+	const char* Name;
+	float (*Function)(const glm::vec4& u);
+	double Integral;
+};
+
+static const Integrand s_Integrands[] =
+{
+	// Discontinuous, like a light's silhouette
+	{ "quarter disk", [](const glm::vec4& u) { return u.x * u.x + u.y * u.y < 1.0f ? 1.0f : 0.0f; }, 0.785398163397448 },
+	{ "smooth", [](const glm::vec4& u) { return glm::sin(u.x * CPU::PI) * glm::sin(u.y * CPU::PI); }, 0.405284734569351 },
+	// z picks a branch, the way DisneySample picks a lobe
+	{ "branch", [](const glm::vec4& u) { return u.z < 0.3f ? u.x : u.y * u.y; }, 0.3 * 0.5 + 0.7 / 3.0 }
+};
+
+static void MeasureIntegration()
+{
+	uint32_t set = CPU::BounceSampleSet(0, CPU::BOUNCE_SET_BSDF);
+
+	printf("Integration RMSE over %ux%u pixels:\n", s_IntegrationPixels, s_IntegrationPixels);
+	printf("  %-14s %6s", "Integrand", "spp");
+	for (CPU::SamplerType type : s_Samplers)
+		printf(" %12s", CPU::GetSamplerName(type));
+	printf("\n");
+
+	for (const Integrand& integrand : s_Integrands)
+	{
+		for (uint32_t sampleCount : s_IntegrationSampleCounts)
+		{
+			printf("  %-14s %6u", integrand.Name, sampleCount);
+			for (CPU::SamplerType type : s_Samplers)
+			{
+				double squaredError = 0.0;
+				for (uint32_t y = 0; y < s_IntegrationPixels; y++)
+				{
+					for (uint32_t x = 0; x < s_IntegrationPixels; x++)
+					{
+						double sum = 0.0;
+						for (uint32_t i = 0; i < sampleCount; i++)
+						{
+							CPU::PixelSampler sampler = CPU::BeginPixelSample(type, x, y, s_IntegrationPixels, i, s_BenchmarkSeed);
+							sum += integrand.Function(CPU::SampleDimensions(sampler, set));
+						}
+
+						double error = sum / sampleCount - integrand.Integral;
+						squaredError += error * error;
+					}
+				}
+				printf(" %12.6f", glm::sqrt(squaredError / (s_IntegrationPixels * s_IntegrationPixels)));
+			}
+			printf("\n");
+		}
+	}
+}
+
+// Tone mapped with x / (1 + x) like the render benchmark, so the light doesn't dominate
+static std::vector<glm::vec3> ErrorImage(const std::vector<glm::vec4>& accumulation, const std::vector<glm::vec4>& reference)
+{
+	std::vector<glm::vec3> error(accumulation.size());
+	for (size_t i = 0; i < accumulation.size(); i++)
+	{
+		glm::vec3 color = glm::vec3(accumulation[i]) / glm::max(accumulation[i].w, 1.0f);
+		glm::vec3 expected = glm::vec3(reference[i]) / glm::max(reference[i].w, 1.0f);
+		error[i] = color / (1.0f + color) - expected / (1.0f + expected);
+	}
+	return error;
+}
+
+static double ComputeRMSE(const std::vector<glm::vec3>& error)
+{
+	double sum = 0.0;
+	for (const glm::vec3& e : error)
+		sum += glm::dot(e, e);
+	return glm::sqrt(sum / (error.size() * 3.0));
+}
+
+// 3x3 box filter, what remains is the low frequency part of the error
+static std::vector<glm::vec3> BlurError(const std::vector<glm::vec3>& error, uint32_t width, uint32_t height)
+{
+	std::vector<glm::vec3> blurred(error.size());
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			glm::vec3 sum = glm::vec3(0.0f);
+			float weight = 0.0f;
+			for (uint32_t sy = y > 0 ? y - 1 : 0; sy <= glm::min(y + 1, height - 1); sy++)
+			{
+				for (uint32_t sx = x > 0 ? x - 1 : 0; sx <= glm::min(x + 1, width - 1); sx++)
+				{
+					sum += error[sx + sy * width];
+					weight += 1.0f;
+				}
+			}
+			blurred[x + y * width] = sum / weight;
+		}
+	}
+	return blurred;
+}
+
+// Frame 1 isn't accumulated, every further frame adds SamplesPerPixel paths
+static std::vector<glm::vec4> Render(const Ref<CPU::Scene>& scene, CPU::SamplerType sampler, uint32_t seed, uint32_t width, uint32_t height, uint32_t samplesPerPixel)
+{
+	CPU::PathTracerSpecification spec;
+	spec.Width = width;
+	spec.Height = height;
+	spec.Seed = seed;
+	spec.Sampler = sampler;
+	CPU::PathTracer pathTracer(spec, scene);
+
+	CameraBuffer camera = CreateCamera(*FindBenchmarkScene("CornellBox"), width, height);
+	uint32_t frames = 1 + (samplesPerPixel + spec.SamplesPerPixel - 1) / spec.SamplesPerPixel;
+	for (uint32_t frameIndex = 1; frameIndex <= frames; frameIndex++)
+		pathTracer.Render(camera, frameIndex);
+
+	return pathTracer.GetAccumulationBuffer();
+}
+
+static void MeasureRenders(const std::string& model, uint32_t width, uint32_t height, uint32_t referenceSamples)
+{
+	Ref<CPU::Scene> scene = LoadScene(model);
+
+	Clock::time_point start = Clock::now();
+	std::vector<glm::vec4> reference = Render(scene, CPU::SamplerType::Sobol, s_ReferenceSeed, width, height, referenceSamples);
+	printf("%s: %ux%u, reference of %u spp in %.2f s\n", model.c_str(), width, height, referenceSamples, SecondsSince(start));
+
+	printf("  %6s %-10s %10s %12s %10s\n", "spp", "Sampler", "RMSE", "Blurred RMSE", "Seconds");
+	for (uint32_t sampleCount : s_RenderSampleCounts)
+	{
+		for (CPU::SamplerType type : s_Samplers)
+		{
+			start = Clock::now();
+			std::vector<glm::vec4> accumulation = Render(scene, type, s_BenchmarkSeed, width, height, sampleCount);
+			double seconds = SecondsSince(start);
+
+			std::vector<glm::vec3> error = ErrorImage(accumulation, reference);
+			printf("  %6u %-10s %10.5f %12.5f %10.2f\n", sampleCount, CPU::GetSamplerName(type), ComputeRMSE(error),
+				ComputeRMSE(BlurError(error, width, height)), seconds);
+		}
+	}
+}
+
+int RunSamplerBenchmark(int argc, char** argv)
+{
+	std::string model = s_CornellBoxModel;
+	uint32_t width = 160;
+	uint32_t height = 90;
+	uint32_t referenceSamples = 1280;
+	bool render = true;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--no-render") == 0)
+			render = false;
+		else if (i + 1 >= argc)
+			break;
+		else if (strcmp(argv[i], "--model") == 0)
+			model = argv[++i];
+		else if (strcmp(argv[i], "--width") == 0)
+			width = glm::max((uint32_t)strtoul(argv[++i], nullptr, 10), 1u);
+		else if (strcmp(argv[i], "--height") == 0)
+			height = glm::max((uint32_t)strtoul(argv[++i], nullptr, 10), 1u);
+		else if (strcmp(argv[i], "--reference-spp") == 0)
+			referenceSamples = glm::max((uint32_t)strtoul(argv[++i], nullptr, 10), 5u);
+	}
+
+	bool passed = CheckSobolStratification();
+	passed &= CheckBlueNoiseMask();
+
+	printf("Sample set cost:\n");
+	TimeSamplers();
+
+	MeasureIntegration();
+
+	if (render)
+		MeasureRenders(model, width, height, referenceSamples);
+
+	return passed ? 0 : 1;
+}
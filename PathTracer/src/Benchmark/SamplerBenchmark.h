@@ -0,0 +1,9 @@
+#pragma once
+
+// `PathTracer --bench-samplers [--model path] [--width w] [--height h] [--reference-spp n] [--no-render]`
+// checks that the Sobol points of a pixel are stratified (every dimension alone and the first two
+// together form nets at every power of two) and that the blue noise mask is a permutation without low
+// frequencies. Reports the time per sample set and the RMSE of every sampler on analytic integrands
+// and on Cornell box renders at 5, 20 and 80 spp against a long render, before and after a 3x3 blur
+// which hides the high frequency error of the blue noise sampler. Returns 1 if a check fails.
+int RunSamplerBenchmark(int argc, char** argv);
@@ -0,0 +1,99 @@
+#include "Benchmark/SceneBenchmark.h"
+#include "Benchmark/BenchmarkCommon.h"
+#include "CPU/CompiledScene.h"
+#include "CPU/Scene.h"
+#include "CPU/Sampling.h"
+#include "CPU/ThreadPool.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+using namespace VkLibrary;
+
+// Compiled here instead of next to the model so the cold run does not touch the real cache
+static const char* s_CacheDirectory = "assets/cache/scenes-benchmark";
+
+static constexpr uint32_t s_ValidationCount = 1 << 16;
+
+// Random rays from inside the bounds, the hits have to agree bit for bit
+static uint32_t CountHitMismatches(const CPU::Scene& reference, const CPU::Scene& scene)
+{
+	glm::vec3 extent = reference.GetBoundsMax() - reference.GetBoundsMin();
+
+	uint32_t mismatches = 0;
+	uint32_t seed = 1;
+	for (uint32_t i = 0; i < s_ValidationCount; i++)
+	{
+		CPU::Ray ray;
+		ray.Origin = reference.GetBoundsMin() + extent * glm::vec3(CPU::RandomValue(seed), CPU::RandomValue(seed), CPU::RandomValue(seed));
+		ray.Direction = CPU::UniformSampleSphere(CPU::RandomValue(seed), CPU::RandomValue(seed));
+
+		CPU::Hit expected, hit;
+		bool expectedHit = reference.Intersect(ray, expected);
+		bool found = scene.Intersect(ray, hit);
+		if (expectedHit != found || (found && (hit.Distance != expected.Distance || hit.InstanceIndex != expected.InstanceIndex || hit.PrimitiveIndex != expected.PrimitiveIndex)))
+			mismatches++;
+	}
+
+	return mismatches;
+}
+
+int RunSceneBenchmark(int argc, char** argv)
+{
+	std::vector<std::string> models = GetModelArguments(argc, argv, { s_SponzaModel, s_IntelSponzaModel });
+
+	std::error_code error;
+	std::filesystem::remove_all(s_CacheDirectory, error);
+
+	for (const std::string& model : models)
+	{
+		if (!std::filesystem::exists(model))
+		{
+			printf("%s: not found\n", model.c_str());
+			continue;
+		}
+
+		Clock::time_point start = Clock::now();
+		Ref<MeshSource> meshSource = CreateRef<MeshSource>(model);
+		double loadSeconds = SecondsSince(start);
+
+		start = Clock::now();
+		CPU::Scene reference(meshSource, glm::mat4(1.0f));
+		double buildSeconds = SecondsSince(start);
+
+		CPU::CompiledSceneSpecification spec;
+		spec.SourcePath = model;
+		spec.Path = (std::filesystem::path(s_CacheDirectory) / std::filesystem::path(model).filename()).replace_extension(".scene").string();
+
+		start = Clock::now();
+		CPU::CompiledScene compiled(spec);
+		double compileSeconds = SecondsSince(start);
+
+		start = Clock::now();
+		CPU::CompiledScene loaded(spec);
+		double mapSeconds = SecondsSince(start);
+
+		if (!loaded.IsValid() || !loaded.WasLoadedFromCache())
+		{
+			printf("%s: compiled scene did not load from %s\n", model.c_str(), spec.Path.c_str());
+			continue;
+		}
+
+		start = Clock::now();
+		CPU::Scene scene(loaded, glm::mat4(1.0f));
+		double sceneSeconds = SecondsSince(start);
+
+		printf("%s: %u triangles, %u submeshes, %.1f MB compiled\n", model.c_str(), loaded.GetIndexCount() / 3, loaded.GetSubMeshCount(), loaded.GetFileSize() / (1024.0 * 1024.0));
+		printf("  glTF       %9.2f ms (load %.2f ms, BVH build %.2f ms)\n", (loadSeconds + buildSeconds) * 1000.0, loadSeconds * 1000.0, buildSeconds * 1000.0);
+		printf("  compile    %9.2f ms (load + build + write, done once)\n", compileSeconds * 1000.0);
+		printf("  compiled   %9.2f ms (map %.2f ms, scene %.2f ms), %.1fx faster\n", (mapSeconds + sceneSeconds) * 1000.0, mapSeconds * 1000.0, sceneSeconds * 1000.0,
+			(loadSeconds + buildSeconds) / (mapSeconds + sceneSeconds));
+
+		bool sameGeometry = scene.GetVertices().size() == reference.GetVertices().size() && scene.GetIndices() == reference.GetIndices()
+			&& memcmp(scene.GetVertices().data(), reference.GetVertices().data(), scene.GetVertices().size() * sizeof(Vertex)) == 0;
+		printf("  geometry %s, %u/%u hit mismatches\n", sameGeometry ? "identical" : "DIFFERS", CountHitMismatches(reference, scene), s_ValidationCount);
+	}
+
+	return 0;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// `PathTracer --bench-scene [--model file.gltf ...]` compares getting a traceable CPU::Scene
+// from the glTF (MeshSource load plus BVH builds) with compiling a CompiledScene and with
+// loading it again, and checks that both scenes hold the same geometry and give the same hits.
+int RunSceneBenchmark(int argc, char** argv);
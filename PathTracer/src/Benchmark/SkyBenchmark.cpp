@@ -0,0 +1,146 @@
+#include "Benchmark/SkyBenchmark.h"
+#include "Benchmark/BenchmarkCommon.h"
+#include "CPU/PreethamSky.h"
+#include "CPU/Sampling.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static constexpr uint32_t s_Repetitions = 3;
+static constexpr uint32_t s_DirectionCount = 1 << 18;
+
+// The cube map the GPU used to generate, 2048x2048 RGBA32F faces
+static constexpr double s_OldMemory = 6.0 * 2048 * 2048 * 16;
+
+// Turbidity, azimuth and inclination of skies to pick a resolution for
+static const CPU::PreethamSkySettings s_Skies[] =
+{
+	{ 3.14f, 0.0f, 0.0f },
+	{ 2.0f, 1.0f, 0.8f },
+	{ 6.0f, 2.5f, 1.3f },
+	{ 10.0f, 4.0f, 1.5f }
+};
+
+static double Megabytes(double bytes)
+{
+	return bytes / (1024.0 * 1024.0);
+}
+
+// The model as the shader used to evaluate it, with the exact exp and acos in double
+static void ReferenceSky(const CPU::PreethamSkyCoefficients& c, const glm::vec3& direction, double rgb[3])
+{
+	double cosTheta = std::max((double)direction.y, 1e-3);
+	double cosGamma = std::min(std::max((double)glm::dot(glm::vec3(c.SunDirection), direction), 0.0), 1.0);
+	double gamma = std::acos(cosGamma);
+
+	double Yxy[3];
+	for (int i = 0; i < 3; i++)
+		Yxy[i] = c.Zenith[i] * (1.0 + c.A[i] * std::exp(c.B[i] / cosTheta)) * (1.0 + c.C[i] * std::exp(c.D[i] * gamma) + c.E[i] * cosGamma * cosGamma);
+
+	double X = Yxy[1] * (Yxy[0] / Yxy[2]);
+	double Y = Yxy[0];
+	double Z = (1.0 - Yxy[1] - Yxy[2]) * (Yxy[0] / Yxy[2]);
+	rgb[0] = ( 2.3706743 * X - 0.9000405 * Y - 0.4706338 * Z) * 0.05;
+	rgb[1] = (-0.5138850 * X + 1.4253036 * Y + 0.0885814 * Z) * 0.05;
+	rgb[2] = ( 0.0052982 * X - 0.0146949 * Y + 1.0093968 * Z) * 0.05;
+}
+
+static float MaxApproximationError(const CPU::PreethamSkyCoefficients& coefficients)
+{
+	float maxError = 0.0f;
+	uint32_t seed = 1;
+	for (uint32_t i = 0; i < s_DirectionCount; i++)
+	{
+		glm::vec3 direction = CPU::UniformSampleSphere(CPU::RandomValue(seed), CPU::RandomValue(seed));
+		glm::vec3 color = CPU::EvaluatePreethamSky(coefficients, direction);
+
+		double expected[3];
+		ReferenceSky(coefficients, direction, expected);
+
+		double difference = 0.0;
+		for (int c = 0; c < 3; c++)
+			difference = std::max(difference, std::abs(color[c] - expected[c]));
+		double error = difference / (std::max(expected[0], std::max(expected[1], expected[2])) + 1e-3);
+		maxError = std::max(maxError, (float)error);
+	}
+	return maxError;
+}
+
+static double TimeGeneration(const CPU::PreethamSkyCoefficients& coefficients, uint32_t resolution, bool vectorized, std::vector<uint16_t>& texels)
+{
+	std::vector<double> times;
+	for (uint32_t i = 0; i < s_Repetitions; i++)
+	{
+		Clock::time_point start = Clock::now();
+		CPU::GeneratePreethamSky(coefficients, resolution, texels, vectorized);
+		times.push_back(SecondsSince(start) * 1000.0);
+	}
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+int RunSkyBenchmark(int argc, char** argv)
+{
+	CPU::PreethamSkySettings settings;
+	uint32_t maxResolution = 2048;
+
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (strcmp(argv[i], "--turbidity") == 0)
+			settings.Turbidity = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--azimuth") == 0)
+			settings.Azimuth = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--inclination") == 0)
+			settings.Inclination = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "--max-resolution") == 0)
+			maxResolution = glm::max((uint32_t)strtoul(argv[++i], nullptr, 10), 4u);
+	}
+
+	Clock::time_point start = Clock::now();
+	CPU::PreethamSkyCoefficients coefficients = CPU::ComputePreethamSkyCoefficients(settings);
+	double coefficientMicroseconds = SecondsSince(start) * 1e6;
+
+	printf("Turbidity %.2f, azimuth %.2f, inclination %.2f: coefficients in %.2f us, max approximation error %g\n", settings.Turbidity, settings.Azimuth,
+		settings.Inclination, coefficientMicroseconds, MaxApproximationError(coefficients));
+
+	bool passed = true;
+	printf("%10s %12s %12s %8s %12s %8s\n", "Resolution", "Scalar ms", "SSE ms", "Speedup", "Memory MB", "Saved");
+	for (uint32_t resolution = 64; resolution <= maxResolution; resolution *= 2)
+	{
+		std::vector<uint16_t> scalar;
+		std::vector<uint16_t> vectorized;
+		double scalarMilliseconds = TimeGeneration(coefficients, resolution, false, scalar);
+		double vectorizedMilliseconds = TimeGeneration(coefficients, resolution, true, vectorized);
+
+		bool matches = scalar == vectorized;
+		passed &= matches;
+
+		double memory = (double)vectorized.size() * sizeof(uint16_t);
+		printf("%10u %12.2f %12.2f %7.2fx %12.2f %7.0fx%s\n", resolution, scalarMilliseconds, vectorizedMilliseconds, scalarMilliseconds / vectorizedMilliseconds,
+			Megabytes(memory), s_OldMemory / memory, matches ? "" : " MISMATCH");
+	}
+
+	printf("Picked resolutions (2048 RGBA32F is %.0f MB):\n", Megabytes(s_OldMemory));
+	for (const CPU::PreethamSkySettings& sky : s_Skies)
+	{
+		start = Clock::now();
+		uint32_t resolution = CPU::SelectPreethamSkyResolution(CPU::ComputePreethamSkyCoefficients(sky));
+		printf("  turbidity %5.2f, azimuth %.2f, inclination %.2f: %4u in %6.2f ms, %.2f MB\n", sky.Turbidity, sky.Azimuth, sky.Inclination, resolution,
+			SecondsSince(start) * 1000.0, Megabytes(6.0 * resolution * resolution * 4 * sizeof(uint16_t)));
+	}
+
+	CPU::PreethamSkyCache cache;
+	start = Clock::now();
+	cache.Get(settings);
+	double missMilliseconds = SecondsSince(start) * 1000.0;
+	start = Clock::now();
+	const CPU::PreethamSkyCubeMap& cubeMap = cache.Get(settings);
+	double hitMilliseconds = SecondsSince(start) * 1000.0;
+	printf("Cache: %ux%u in %.2f ms on a miss, %.4f ms on a hit, %.2f MB\n", cubeMap.Resolution, cubeMap.Resolution, missMilliseconds, hitMilliseconds,
+		Megabytes((double)cache.GetMemoryUsage()));
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+// `PathTracer --bench-sky [--turbidity t] [--azimuth a] [--inclination i] [--max-resolution n]` generates
+// the Preetham sky cube map on the CPU at several resolutions and reports the time of the scalar and
+// SSE paths and the memory of the half float texels against the 2048 RGBA32F cube map. Also reports
+// the resolution picked for a few skies, the error of the exp and acos approximations against the
+// exact model and the time of a cache hit. Returns 1 if the paths don't give the same bits.
+int RunSkyBenchmark(int argc, char** argv);
@@ -0,0 +1,151 @@
+#include "Benchmark/TextureBenchmark.h"
+#include "Benchmark/BenchmarkCommon.h"
+#include "Texture/TextureCache.h"
+#include "CPU/ThreadPool.h"
+#include "Util/MappedFile.h"
+#include <stb_image.h>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+// Separate from the streamer's cache so the cold run really starts empty
+static const char* s_CacheDirectory = "assets/cache/textures-benchmark";
+
+struct LoadResult
+{
+	double Seconds = 0.0;
+	uint32_t CacheHits = 0;
+	uint32_t Failures = 0;
+	uint64_t CacheBytes = 0;
+	uint64_t UncompressedBytes = 0; // RGBA8 with the same mip chain
+};
+
+// Cache lookup (or generation) plus expanding the top mip, the work of one streamer job
+static LoadResult LoadAll(const std::vector<std::string>& paths)
+{
+	std::atomic<uint32_t> cacheHits = 0, failures = 0;
+	std::atomic<uint64_t> cacheBytes = 0, uncompressedBytes = 0;
+
+	Clock::time_point start = Clock::now();
+	CPU::ThreadPool::Get().ParallelFor((uint32_t)paths.size(), [&](uint32_t i)
+	{
+		CachedTexture texture(paths[i], s_CacheDirectory);
+		if (!texture.IsValid())
+		{
+			failures++;
+			return;
+		}
+
+		std::vector<uint8_t> rgba;
+		texture.DecodeMip(0, rgba);
+
+		for (uint32_t level = 0; level < texture.GetMipCount(); level++)
+		{
+			cacheBytes += texture.GetMipSize(level);
+			uncompressedBytes += (uint64_t)texture.GetMipWidth(level) * texture.GetMipHeight(level) * 4;
+		}
+
+		if (texture.WasLoadedFromCache())
+			cacheHits++;
+	});
+
+	LoadResult result;
+	result.Seconds = SecondsSince(start);
+	result.CacheHits = cacheHits;
+	result.Failures = failures;
+	result.CacheBytes = cacheBytes;
+	result.UncompressedBytes = uncompressedBytes;
+	return result;
+}
+
+int RunTextureBenchmark(int argc, char** argv)
+{
+	std::string model = s_SponzaModel;
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (strcmp(argv[i], "--model") == 0)
+			model = argv[++i];
+	}
+
+	std::vector<std::string> paths;
+	for (const std::string& path : ReadGLTFTexturePaths(model))
+	{
+		if (!path.empty())
+			paths.push_back(path);
+	}
+
+	if (paths.empty())
+	{
+		printf("%s: no external textures\n", model.c_str());
+		return 1;
+	}
+
+	printf("%s: %zu textures, %u threads\n", model.c_str(), paths.size(), CPU::ThreadPool::Get().GetThreadCount());
+
+	// What startup paid before, every image decoded one after another
+	uint64_t sourceBytes = 0;
+	Clock::time_point start = Clock::now();
+	for (const std::string& path : paths)
+	{
+		MappedFile source;
+		if (!source.Open(path))
+			continue;
+
+		sourceBytes += source.GetSize();
+
+		int width, height, channels;
+		stbi_uc* pixels = stbi_load_from_memory(source.GetData(), (int)source.GetSize(), &width, &height, &channels, 4);
+		stbi_image_free(pixels);
+	}
+	double serialSeconds = SecondsSince(start);
+	printf("  serial decode      %9.2f ms (%.1f MB of images)\n", serialSeconds * 1000.0, sourceBytes / (1024.0 * 1024.0));
+
+	std::error_code error;
+	std::filesystem::remove_all(s_CacheDirectory, error);
+
+	LoadResult cold = LoadAll(paths);
+	printf("  cold cache         %9.2f ms (decode + mips + compress + write, %u failed)\n", cold.Seconds * 1000.0, cold.Failures);
+
+	LoadResult warm = LoadAll(paths);
+	printf("  warm cache         %9.2f ms (%u / %zu hits)\n", warm.Seconds * 1000.0, warm.CacheHits, paths.size());
+
+	printf("  cache size         %9.1f MB, %.1fx smaller than RGBA8 mips\n", warm.CacheBytes / (1024.0 * 1024.0),
+		warm.CacheBytes > 0 ? (double)warm.UncompressedBytes / warm.CacheBytes : 0.0);
+
+	// Block compression error of the top mip
+	double squaredError = 0.0;
+	uint64_t channelCount = 0;
+	for (const std::string& path : paths)
+	{
+		CachedTexture texture(path, s_CacheDirectory);
+		MappedFile source;
+		if (!texture.IsValid() || !source.Open(path))
+			continue;
+
+		int width, height, channels;
+		stbi_uc* pixels = stbi_load_from_memory(source.GetData(), (int)source.GetSize(), &width, &height, &channels, 4);
+		if (!pixels)
+			continue;
+
+		std::vector<uint8_t> rgba;
+		texture.DecodeMip(0, rgba);
+		for (size_t i = 0; i < rgba.size(); i++)
+		{
+			double difference = (double)rgba[i] - pixels[i];
+			squaredError += difference * difference;
+		}
+		channelCount += rgba.size();
+		stbi_image_free(pixels);
+	}
+
+	if (channelCount > 0)
+	{
+		double meanSquaredError = squaredError / channelCount;
+		printf("  top mip PSNR       %9.2f dB\n", meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : INFINITY);
+	}
+
+	return warm.Failures == 0 ? 0 : 1;
+}
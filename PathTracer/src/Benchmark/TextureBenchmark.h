@@ -0,0 +1,7 @@
+#pragma once
+
+// `PathTracer --bench-textures [--model file.gltf]` loads every texture of the model through
+// CachedTexture on the thread pool, first against an empty cache and then against the one that
+// run wrote, and compares both with decoding the source images serially. Also reports the size
+// of the block compressed mip chains and the PSNR of the top mip against the source image.
+int RunTextureBenchmark(int argc, char** argv);
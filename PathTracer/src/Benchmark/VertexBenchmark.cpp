@@ -0,0 +1,147 @@
+#include "Benchmark/VertexBenchmark.h"
+#include "Benchmark/BenchmarkCommon.h"
+#include "CPU/CompactVertex.h"
+#include "CPU/Sampling.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+using namespace VkLibrary;
+
+static constexpr uint32_t s_DirectionCount = 1 << 20;
+
+// snorm16 octahedral directions stay well within this, in degrees
+static constexpr float s_MaxAngleError = 0.01f;
+
+// atan2 instead of acos, which cannot resolve angles this small in float
+static float AngleDegrees(const glm::vec3& a, const glm::vec3& b)
+{
+	glm::vec3 na = glm::normalize(a), nb = glm::normalize(b);
+	return std::atan2(glm::length(glm::cross(na, nb)), glm::dot(na, nb)) * 180.0f / CPU::PI;
+}
+
+static bool ValidateDirections()
+{
+	std::vector<glm::vec3> directions = {
+		{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+		{ 1, 1, -1 }, { -1, -1, -1 }, { 0.5f, -0.5f, -1e-6f }
+	};
+
+	uint32_t seed = 1;
+	for (uint32_t i = 0; i < s_DirectionCount; i++)
+		directions.push_back(CPU::UniformSampleSphere(CPU::RandomValue(seed), CPU::RandomValue(seed)));
+
+	float maxError = 0.0f;
+	double sumError = 0.0;
+	for (const glm::vec3& direction : directions)
+	{
+		Vertex vertex = {};
+		vertex.Normal = glm::normalize(direction);
+		vertex.Tangent = glm::vec4(glm::normalize(direction), -1.0f);
+
+		CPU::CompactVertexBounds bounds = {};
+		Vertex decoded = CPU::DecodeVertex(CPU::EncodeVertex(vertex, bounds), bounds);
+
+		float error = glm::max(AngleDegrees(vertex.Normal, decoded.Normal), AngleDegrees(glm::vec3(vertex.Tangent), glm::vec3(decoded.Tangent)));
+		maxError = glm::max(maxError, error);
+		sumError += error;
+
+		if (decoded.Tangent.w != -1.0f)
+			maxError = 180.0f;
+	}
+
+	bool passed = maxError <= s_MaxAngleError;
+	printf("directions: %zu, octahedral error mean %.5f max %.5f degrees %s\n", directions.size(), sumError / directions.size(), maxError, passed ? "" : "FAILED");
+	return passed;
+}
+
+static bool ValidateModel(const std::string& model)
+{
+	Ref<MeshSource> meshSource = CreateRef<MeshSource>(model);
+	const std::vector<Vertex>& vertices = meshSource->GetVertices();
+	const std::vector<SubMesh>& subMeshes = meshSource->GetSubMeshes();
+
+	std::vector<CPU::CompactVertex> compactVertices;
+	std::vector<CPU::CompactVertexBounds> bounds;
+	Clock::time_point start = Clock::now();
+	CPU::EncodeVertices(vertices, subMeshes, compactVertices, bounds);
+	double encodeSeconds = SecondsSince(start);
+
+	float maxPositionSteps = 0.0f, maxNormalError = 0.0f, maxTangentError = 0.0f, maxUVError = 0.0f;
+	double sumNormalError = 0.0;
+	uint32_t signErrors = 0, checked = 0;
+	for (size_t i = 0; i < subMeshes.size(); i++)
+	{
+		const SubMesh& subMesh = subMeshes[i];
+		for (uint32_t v = subMesh.VertexOffset; v < subMesh.VertexOffset + subMesh.VertexCount && v < vertices.size(); v++)
+		{
+			const Vertex& vertex = vertices[v];
+			Vertex decoded = CPU::DecodeVertex(compactVertices[v], bounds[i]);
+
+			// Position error in quantization steps. Half a step is the best rounding can do, float
+			// dequantization adds a little on top for large coordinates.
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (bounds[i].Scale[axis] > 0.0f)
+					maxPositionSteps = glm::max(maxPositionSteps, glm::abs(decoded.Position[axis] - vertex.Position[axis]) / bounds[i].Scale[axis]);
+			}
+
+			if (glm::length(vertex.Normal) > 0.0f)
+			{
+				float normalError = AngleDegrees(vertex.Normal, decoded.Normal);
+				maxNormalError = glm::max(maxNormalError, normalError);
+				sumNormalError += normalError;
+			}
+
+			if (glm::length(glm::vec3(vertex.Tangent)) > 0.0f)
+				maxTangentError = glm::max(maxTangentError, AngleDegrees(glm::vec3(vertex.Tangent), glm::vec3(decoded.Tangent)));
+
+			if ((vertex.Tangent.w < 0.0f) != (decoded.Tangent.w < 0.0f))
+				signErrors++;
+
+			// Relative to the half spacing at the magnitude of the coordinate
+			for (int axis = 0; axis < 2; axis++)
+			{
+				float spacing = glm::max(std::ldexp(1.0f, std::ilogb(glm::max(glm::abs(vertex.TextureCoords[axis]), 6.1e-5f)) - 10), std::ldexp(1.0f, -24));
+				maxUVError = glm::max(maxUVError, glm::abs(decoded.TextureCoords[axis] - vertex.TextureCoords[axis]) / spacing);
+			}
+
+			checked++;
+		}
+	}
+
+	uint64_t before = vertices.size() * sizeof(Vertex);
+	uint64_t after = compactVertices.size() * sizeof(CPU::CompactVertex) + sizeof(CPU::CompactVertexHeader) + bounds.size() * sizeof(CPU::CompactVertexBounds);
+	printf("%s: %zu vertices, %zu submeshes, encoded in %.2f ms (%.1f Mvertices/s)\n", model.c_str(), vertices.size(), subMeshes.size(), encodeSeconds * 1000.0, vertices.size() / encodeSeconds * 1e-6);
+	printf("  memory     %.2f MB -> %.2f MB, %.2f MB saved (%.1fx)\n", before / (1024.0 * 1024.0), after / (1024.0 * 1024.0), (before - after) / (1024.0 * 1024.0), (double)before / after);
+	printf("  position   max %.3f quantization steps\n", maxPositionSteps);
+	printf("  normal     mean %.5f max %.5f degrees\n", checked > 0 ? sumNormalError / checked : 0.0, maxNormalError);
+	printf("  tangent    max %.5f degrees, %u sign errors\n", maxTangentError, signErrors);
+	printf("  uv         max %.3f half spacings\n", maxUVError);
+
+	bool passed = maxPositionSteps <= 0.55f && maxNormalError <= s_MaxAngleError && maxTangentError <= s_MaxAngleError && signErrors == 0 && maxUVError <= 0.51f;
+	if (!passed)
+		printf("  FAILED\n");
+	return passed;
+}
+
+int RunVertexBenchmark(int argc, char** argv)
+{
+	std::string model = s_SponzaModel;
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (strcmp(argv[i], "--model") == 0)
+			model = argv[++i];
+	}
+
+	bool passed = ValidateDirections();
+
+	if (std::filesystem::exists(model))
+		passed &= ValidateModel(model);
+	else
+		printf("%s: not found\n", model.c_str());
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+// `PathTracer --bench-vertices [--model file.gltf]` encodes the vertices of a model to the compact
+// layout of CompactVertex.glsl and reports the encode time, the memory saved and the round-trip
+// error of every attribute. Random and axis aligned directions are checked on their own first,
+// so the octahedral mapping is covered without any model. Returns 1 if an error is out of bounds.
+int RunVertexBenchmark(int argc, char** argv);
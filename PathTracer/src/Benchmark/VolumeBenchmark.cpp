@@ -0,0 +1,136 @@
+#include "Benchmark/VolumeBenchmark.h"
+#include "Benchmark/BenchmarkCommon.h"
+#include "CPU/VolumeTracking.h"
+#include "CPU/ThreadPool.h"
+#include "Volume/CloudNoise.h"
+#include "Volume/BrickVolume.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static constexpr uint32_t s_DefaultRayCount = 4096;
+static constexpr uint32_t s_EstimatesPerRay = 64;
+static constexpr uint32_t s_FixedStepCount = 100;     // TraceCloudPath used 100 view steps...
+static constexpr uint32_t s_FixedLightStepCount = 5;  // ...and 5 light steps for each of them
+static constexpr float s_ReferenceStepVoxels = 0.25f;
+static constexpr float s_WorldToTexture = 0.2f;
+static constexpr float s_SigmaScale = 0.8f;
+
+struct RayResult
+{
+	float Reference = 0.0f;
+	float FixedStep = 0.0f;
+	float RatioMean = 0.0f;
+	float RatioVariance = 0.0f;
+	CPU::TrackingStats ReferenceStats;
+	CPU::TrackingStats FixedStepStats;
+	CPU::TrackingStats RatioStats;
+};
+
+int RunVolumeBenchmark(int argc, char** argv)
+{
+	uint32_t rayCount = s_DefaultRayCount;
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (strcmp(argv[i], "--rays") == 0)
+			rayCount = (uint32_t)atoi(argv[++i]);
+	}
+
+	Clock::time_point start = Clock::now();
+	CloudNoiseSpecification noiseSpec = GetCloudNoiseSpecification();
+	CloudNoise noise(noiseSpec, "Cloud.noise");
+	if (!noise.IsValid())
+	{
+		printf("Failed to load or generate Cloud.noise\n");
+		return 1;
+	}
+	printf("Cloud noise %ux%ux%u %s in %.2f ms\n", noiseSpec.Width, noiseSpec.Height, noiseSpec.Depth,
+		noise.WasLoadedFromCache() ? "mapped from cache" : "generated", SecondsSince(start) * 1000.0);
+
+	start = Clock::now();
+	BrickVolume volume(noise.GetData(), { noiseSpec.Width, noiseSpec.Height, noiseSpec.Depth });
+	double buildSeconds = SecondsSince(start);
+
+	uint64_t sparseBytes = volume.GetAtlas().size() + volume.GetBrickIndices().size() * sizeof(uint32_t) + volume.GetMajorants().size() * sizeof(glm::vec2);
+	printf("Brick volume built in %.2f ms: %u / %u bricks occupied (%.1f%%), %.1f MB sparse vs %.1f MB dense RGBA8\n",
+		buildSeconds * 1000.0, volume.GetOccupiedBrickCount(), volume.GetBrickCount(), 100.0 * volume.GetOccupiedBrickCount() / volume.GetBrickCount(),
+		sparseBytes / (1024.0 * 1024.0), noise.GetSize() * 4 / (1024.0 * 1024.0));
+
+	CPU::VolumeMedium medium;
+	medium.Volume = &volume;
+	medium.WorldToTexture = s_WorldToTexture;
+	medium.SigmaScale = s_SigmaScale;
+
+	// Segments through one repetition of the volume, about as long as the path through the cloud mesh
+	float period = 1.0f / s_WorldToTexture;
+	float segmentLength = period * 0.5f;
+	float referenceStep = s_ReferenceStepVoxels / (s_WorldToTexture * noiseSpec.Width);
+
+	std::vector<RayResult> results(rayCount);
+	start = Clock::now();
+	CPU::ThreadPool::Get().ParallelFor(rayCount, [&](uint32_t i)
+	{
+		uint32_t seed = i * 9781u + 1u;
+		glm::vec3 origin = glm::vec3(CPU::RandomValue(seed), CPU::RandomValue(seed), CPU::RandomValue(seed)) * period;
+
+		float z = 1.0f - 2.0f * CPU::RandomValue(seed);
+		float r = glm::sqrt(glm::max(0.0f, 1.0f - z * z));
+		float phi = CPU::TWO_PI * CPU::RandomValue(seed);
+		glm::vec3 direction = glm::vec3(r * glm::cos(phi), r * glm::sin(phi), z);
+
+		RayResult& result = results[i];
+		result.Reference = CPU::RayMarchTransmittance(medium, origin, direction, segmentLength, referenceStep, result.ReferenceStats);
+		result.FixedStep = CPU::RayMarchTransmittance(medium, origin, direction, segmentLength, segmentLength / s_FixedStepCount, result.FixedStepStats);
+
+		double sum = 0.0, sumSquared = 0.0;
+		for (uint32_t estimate = 0; estimate < s_EstimatesPerRay; estimate++)
+		{
+			float transmittance = CPU::RatioTrackingTransmittance(medium, origin, direction, segmentLength, seed, result.RatioStats);
+			sum += transmittance;
+			sumSquared += transmittance * transmittance;
+		}
+		result.RatioMean = (float)(sum / s_EstimatesPerRay);
+		result.RatioVariance = (float)glm::max(0.0, sumSquared / s_EstimatesPerRay - (sum / s_EstimatesPerRay) * (sum / s_EstimatesPerRay));
+	});
+	double trackingSeconds = SecondsSince(start);
+
+	double referenceMean = 0.0, fixedError = 0.0, ratioBias = 0.0, ratioVariance = 0.0, ratioError = 0.0;
+	uint64_t fixedLookups = 0, ratioLookups = 0, ratioCells = 0;
+	for (const RayResult& result : results)
+	{
+		referenceMean += result.Reference;
+		fixedError += glm::abs(result.FixedStep - result.Reference);
+		ratioBias += result.RatioMean - result.Reference;
+		ratioError += glm::abs(result.RatioMean - result.Reference);
+		ratioVariance += result.RatioVariance / s_EstimatesPerRay;
+		fixedLookups += result.FixedStepStats.DensityLookups;
+		ratioLookups += result.RatioStats.DensityLookups;
+		ratioCells += result.RatioStats.MajorantCells;
+	}
+
+	referenceMean /= rayCount;
+	fixedError /= rayCount;
+	ratioBias /= rayCount;
+	ratioError /= rayCount;
+	double standardError = glm::sqrt(ratioVariance) / rayCount;
+
+	double fixedLookupsPerRay = (double)fixedLookups / rayCount;
+	double ratioLookupsPerRay = (double)ratioLookups / ((double)rayCount * s_EstimatesPerRay);
+
+	printf("%u rays of length %.2f, mean reference transmittance %.4f (%.2f s)\n", rayCount, segmentLength, referenceMean, trackingSeconds);
+	printf("  fixed step     %7.1f lookups/ray (%u with light steps), mean |error| %.4f\n",
+		fixedLookupsPerRay, s_FixedStepCount * (1 + s_FixedLightStepCount), fixedError);
+	printf("  ratio tracking %7.1f lookups/ray, %.1f majorant cells/ray, mean |error| %.4f over %u estimates, bias %.5f (standard error %.5f)\n",
+		ratioLookupsPerRay, (double)ratioCells / ((double)rayCount * s_EstimatesPerRay), ratioError, s_EstimatesPerRay, ratioBias, standardError);
+
+	// Ratio tracking is unbiased, its mean has to agree with the reference up to noise and the reference's own step error
+	bool unbiased = glm::abs(ratioBias) <= 4.0 * standardError + 1e-3;
+	printf("  transmittance %s\n", unbiased ? "matches reference" : "DOES NOT match reference");
+
+	// The point of the majorant grid is skipping empty space, so tracking has to touch the density less than marching
+	bool fewerLookups = ratioLookupsPerRay < fixedLookupsPerRay;
+	printf("  ratio tracking %s\n", fewerLookups ? "needs fewer density lookups than fixed steps" : "DOES NOT need fewer density lookups than fixed steps");
+
+	return unbiased && fewerLookups ? 0 : 1;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// `PathTracer --bench-volume [--rays n]` compares ratio tracking over the sparse cloud volume
+// against fixed step ray marching: density lookups per ray and transmittance error. Returns 1 if ratio
+// tracking is biased or doesn't need fewer lookups per ray than the fixed steps
+int RunVolumeBenchmark(int argc, char** argv);
@@ -0,0 +1,101 @@
+#include "Benchmark/WavefrontBenchmark.h"
+#include "Benchmark/BenchmarkCommon.h"
+#include "CPU/PathTracer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace VkLibrary;
+
+struct WavefrontMode
+{
+	const char* Name;
+	bool Wavefront;
+	bool SortByMaterial;
+	bool CompactQueues;
+};
+
+static const WavefrontMode s_Modes[] = {
+	{ "megakernel",        false, false, false },
+	{ "wavefront",         true,  false, false },
+	{ "+compact",          true,  false, true  },
+	{ "+sort",             true,  true,  false },
+	{ "+compact +sort",    true,  true,  true  },
+};
+
+// Looks at the scene from outside its bounds along -z, nothing here depends on the exact view
+static CameraBuffer CreateSceneCamera(const CPU::Scene& scene, uint32_t width, uint32_t height)
+{
+	glm::vec3 center = (scene.GetBoundsMin() + scene.GetBoundsMax()) * 0.5f;
+	float radius = glm::length(scene.GetBoundsMax() - scene.GetBoundsMin()) * 0.5f;
+
+	return CreateCamera(center + glm::vec3(0.0f, 0.0f, radius * 1.5f), center, 45.0f, width, height, radius * 4.0f);
+}
+
+int RunWavefrontBenchmark(int argc, char** argv)
+{
+	std::string model = s_SponzaModel;
+	uint32_t width = 320;
+	uint32_t height = 180;
+	uint32_t frames = 4;
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (strcmp(argv[i], "--model") == 0)
+			model = argv[++i];
+		else if (strcmp(argv[i], "--width") == 0)
+			width = (uint32_t)glm::max(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--height") == 0)
+			height = (uint32_t)glm::max(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--frames") == 0)
+			frames = (uint32_t)glm::max(1, atoi(argv[++i]));
+	}
+
+	Ref<CPU::Scene> scene = LoadScene(model);
+	if (scene->GetInstances().empty())
+	{
+		printf("%s: no geometry\n", model.c_str());
+		return 1;
+	}
+
+	CameraBuffer camera = CreateSceneCamera(*scene, width, height);
+
+	printf("%s, %ux%u, %u frames, %zu materials\n", model.c_str(), width, height, frames, scene->GetMaterials().size());
+	for (const WavefrontMode& mode : s_Modes)
+	{
+		CPU::PathTracerSpecification spec;
+		spec.Width = width;
+		spec.Height = height;
+		spec.Wavefront = mode.Wavefront;
+		spec.WavefrontSpec.SortByMaterial = mode.SortByMaterial;
+		spec.WavefrontSpec.CompactQueues = mode.CompactQueues;
+		CPU::PathTracer pathTracer(spec, scene);
+
+		Clock::time_point start = Clock::now();
+		for (uint32_t frameIndex = 1; frameIndex <= frames; frameIndex++)
+			pathTracer.Render(camera, frameIndex);
+		double seconds = SecondsSince(start);
+
+		printf("  %-16s %8.2f ms/frame", mode.Name, seconds * 1000.0 / frames);
+
+		// The megakernel doesn't count its bounces, so rays/s is only known for the wavefront modes
+		const Ref<CPU::WavefrontIntegrator>& integrator = pathTracer.GetWavefrontIntegrator();
+		if (!integrator)
+		{
+			printf("\n");
+			continue;
+		}
+
+		const CPU::WavefrontStats& stats = integrator->GetStats();
+		printf(", %6.2f Mrays/s, %5.1f%% queue slots live, %5.1f%% material switches |",
+			stats.RaysTraced / seconds * 1e-6,
+			100.0 * stats.RaysTraced / glm::max(stats.QueueSlots, (uint64_t)1),
+			100.0 * stats.MaterialSwitches / glm::max(stats.HitsShaded, (uint64_t)1));
+
+		for (uint32_t stage = 0; stage < (uint32_t)CPU::WavefrontStage::Count; stage++)
+			printf(" %s %.2f", CPU::GetWavefrontStageName((CPU::WavefrontStage)stage), stats.StageSeconds[stage] * 1000.0 / frames);
+		printf(" ms\n");
+	}
+
+	return 0;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// `PathTracer --bench-wavefront [--model path] [--width w] [--height h] [--frames n]` renders with the CPU
+// megakernel and the wavefront integrator with and without queue compaction and material sorting,
+// and reports Mrays/s, per stage times and shading coherence. Sponza by default.
+int RunWavefrontBenchmark(int argc, char** argv);
@@ -0,0 +1,101 @@
+#include "CPU/AdaptiveSampling.h"
+#include "CPU/Disney.h"
+#include "CPU/ThreadPool.h"
+#include <algorithm>
+
+namespace CPU {
+
+	static constexpr float s_ErrorEpsilon = 0.05f;
+
+	float PixelError(const glm::vec4& accumulation, float momentSum)
+	{
+		float n = accumulation.w;
+		if (n < 2.0f)
+			return 1e30f;
+
+		float mean = Luminance(glm::vec3(accumulation)) / n;
+		float variance = glm::max(momentSum / n - mean * mean, 0.0f) * n / (n - 1.0f);
+		return glm::sqrt(variance / n) / (mean + s_ErrorEpsilon);
+	}
+
+	AdaptiveSampler::AdaptiveSampler(const AdaptiveSamplingSpecification& specification)
+		: m_Specification(specification)
+	{
+	}
+
+	void AdaptiveSampler::Resize(uint32_t width, uint32_t height)
+	{
+		m_Width = width;
+		m_Height = height;
+		m_TilesX = (width + m_Specification.TileSize - 1) / m_Specification.TileSize;
+		m_TilesY = (height + m_Specification.TileSize - 1) / m_Specification.TileSize;
+
+		m_TileErrors.assign(m_TilesX * m_TilesY, 1e30f);
+		m_TileSamples.assign(m_TilesX * m_TilesY, m_Specification.SamplesPerFrame);
+		m_ActiveTileCount = m_TilesX * m_TilesY;
+	}
+
+	void AdaptiveSampler::EstimateErrors(const std::vector<glm::vec4>& accumulation, const std::vector<glm::vec4>& moments)
+	{
+		uint32_t tileSize = m_Specification.TileSize;
+
+		ThreadPool::Get().ParallelFor(m_TilesX * m_TilesY, [&](uint32_t tile)
+		{
+			uint32_t startX = (tile % m_TilesX) * tileSize;
+			uint32_t startY = (tile / m_TilesX) * tileSize;
+			uint32_t endX = std::min(startX + tileSize, m_Width);
+			uint32_t endY = std::min(startY + tileSize, m_Height);
+
+			// Same clamp as the shader so a single unsampled pixel doesn't overflow the sum
+			float errorSum = 0.0f;
+			for (uint32_t y = startY; y < endY; y++)
+			{
+				for (uint32_t x = startX; x < endX; x++)
+				{
+					size_t pixel = x + (size_t)y * m_Width;
+					errorSum += std::min(PixelError(accumulation[pixel], moments[pixel].x), 1e6f);
+				}
+			}
+
+			m_TileErrors[tile] = errorSum / (float)((endX - startX) * (endY - startY));
+		});
+	}
+
+	bool AdaptiveSampler::IsActive(uint32_t tile, uint32_t frameIndex) const
+	{
+		return frameIndex <= m_Specification.MinFrameIndex || m_TileErrors[tile] > m_Specification.ErrorThreshold;
+	}
+
+	void AdaptiveSampler::Schedule(uint32_t frameIndex)
+	{
+		uint32_t tileCount = GetTileCount();
+
+		m_ActiveTileCount = 0;
+		for (uint32_t tile = 0; tile < tileCount; tile++)
+			m_ActiveTileCount += IsActive(tile, frameIndex) ? 1 : 0;
+
+		uint32_t samples = 0;
+		if (m_ActiveTileCount > 0)
+			samples = std::min((m_Specification.SamplesPerFrame * tileCount + m_ActiveTileCount - 1) / m_ActiveTileCount, m_Specification.MaxSamplesPerFrame);
+
+		for (uint32_t tile = 0; tile < tileCount; tile++)
+			m_TileSamples[tile] = IsActive(tile, frameIndex) ? samples : 0;
+	}
+
+	uint64_t AdaptiveSampler::GetScheduledSampleCount() const
+	{
+		uint32_t tileSize = m_Specification.TileSize;
+
+		uint64_t count = 0;
+		for (uint32_t tile = 0; tile < GetTileCount(); tile++)
+		{
+			uint32_t startX = (tile % m_TilesX) * tileSize;
+			uint32_t startY = (tile / m_TilesX) * tileSize;
+			uint64_t pixels = (uint64_t)(std::min(startX + tileSize, m_Width) - startX) * (std::min(startY + tileSize, m_Height) - startY);
+			count += pixels * m_TileSamples[tile];
+		}
+
+		return count;
+	}
+
+}
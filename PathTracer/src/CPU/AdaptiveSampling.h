@@ -0,0 +1,69 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace CPU {
+
+	struct AdaptiveSamplingSpecification
+	{
+		// Must match TILE_SIZE in AdaptiveSampling.glsl and ADAPTIVE_TILE_SIZE in RayGen.glsl
+		uint32_t TileSize = 16;
+
+		// Relative standard error of the tile mean below which a tile stops receiving samples
+		float ErrorThreshold = 0.02f;
+
+		// Every tile is sampled up to this frame index, the error estimate is unreliable with few samples
+		uint32_t MinFrameIndex = 8;
+
+		// Per frame budget is SamplesPerFrame for every tile, spread over the unconverged ones
+		uint32_t SamplesPerFrame = 5;
+		uint32_t MaxSamplesPerFrame = 40;
+	};
+
+	// Standard error of the pixel mean relative to its luminance, from an accumulation pixel
+	// (RGB sum + path count) and the sum of squared sample luminances
+	float PixelError(const glm::vec4& accumulation, float momentSum);
+
+	// CPU implementation of AdaptiveSampling.glsl. Works on plain accumulation and moments buffers,
+	// so it can be run on buffers written by the headless renderer as well.
+	class AdaptiveSampler
+	{
+	public:
+		AdaptiveSampler(const AdaptiveSamplingSpecification& specification = AdaptiveSamplingSpecification());
+
+		void Resize(uint32_t width, uint32_t height);
+
+		// Stage 0, mean pixel error of every tile. Moments hold the squared luminance sum in x
+		void EstimateErrors(const std::vector<glm::vec4>& accumulation, const std::vector<glm::vec4>& moments);
+
+		// Stage 1, samples every tile gets in the frame with this index
+		void Schedule(uint32_t frameIndex);
+
+		bool IsActive(uint32_t tile, uint32_t frameIndex) const;
+
+		uint32_t GetTileIndex(uint32_t x, uint32_t y) const { return x / m_Specification.TileSize + (y / m_Specification.TileSize) * m_TilesX; }
+		uint32_t GetTileSamples(uint32_t tile) const { return m_TileSamples[tile]; }
+		uint32_t GetTileCount() const { return (uint32_t)m_TileErrors.size(); }
+		uint32_t GetActiveTileCount() const { return m_ActiveTileCount; }
+
+		// Paths traced over the whole image with the current schedule
+		uint64_t GetScheduledSampleCount() const;
+
+		const std::vector<float>& GetTileErrors() const { return m_TileErrors; }
+		const std::vector<uint32_t>& GetTileSampleCounts() const { return m_TileSamples; }
+		const AdaptiveSamplingSpecification& GetSpecification() const { return m_Specification; }
+
+	private:
+		AdaptiveSamplingSpecification m_Specification;
+		uint32_t m_Width = 0;
+		uint32_t m_Height = 0;
+		uint32_t m_TilesX = 0;
+		uint32_t m_TilesY = 0;
+		uint32_t m_ActiveTileCount = 0;
+
+		std::vector<float> m_TileErrors;
+		std::vector<uint32_t> m_TileSamples;
+	};
+
+}
@@ -0,0 +1,356 @@
+#include "CPU/BVH.h"
+#include "CPU/ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+namespace CPU {
+
+	static constexpr uint32_t s_BinCount = 16;
+	static constexpr uint32_t s_MaxLeafSize = 8;
+	static constexpr uint32_t s_ParallelSubtreeThreshold = 4096;
+	static constexpr uint32_t s_ParallelBinningThreshold = 65536;
+	static constexpr uint32_t s_BinningChunkSize = 16384;
+	static constexpr float s_TraversalCost = 1.0f;
+	static constexpr float s_IntersectionCost = 1.0f;
+
+	struct Bounds
+	{
+		glm::vec3 Min = glm::vec3(std::numeric_limits<float>::max());
+		glm::vec3 Max = glm::vec3(-std::numeric_limits<float>::max());
+
+		void Grow(const glm::vec3& point)
+		{
+			Min = glm::min(Min, point);
+			Max = glm::max(Max, point);
+		}
+
+		void Grow(const Bounds& other)
+		{
+			Min = glm::min(Min, other.Min);
+			Max = glm::max(Max, other.Max);
+		}
+
+		float SurfaceArea() const
+		{
+			if (Min.x > Max.x)
+				return 0.0f;
+
+			glm::vec3 extent = Max - Min;
+			return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+		}
+	};
+
+	struct Bin
+	{
+		Bounds Box;
+		uint32_t Count = 0;
+	};
+
+	struct BVH::BuildContext
+	{
+		BuildContext(const std::vector<glm::vec3>& boundsMin, const std::vector<glm::vec3>& boundsMax)
+			: BoundsMin(boundsMin), BoundsMax(boundsMax)
+		{
+		}
+
+		const std::vector<glm::vec3>& BoundsMin;
+		const std::vector<glm::vec3>& BoundsMax;
+		std::vector<glm::vec3> Centroids;
+		std::atomic<uint32_t> NodeCount = 1;
+	};
+
+	// Node bounds and centroid bounds for a range of primitives, chunked across the pool for large ranges
+	static void ComputeRangeBounds(const BVH::BuildContext& context, const uint32_t* indices, uint32_t count, Bounds& nodeBounds, Bounds& centroidBounds);
+
+	void BVH::Build(const std::vector<glm::vec3>& boundsMin, const std::vector<glm::vec3>& boundsMax)
+	{
+		m_Nodes.clear();
+		m_PrimitiveIndices.clear();
+
+		uint32_t primitiveCount = (uint32_t)boundsMin.size();
+		if (primitiveCount == 0)
+			return;
+
+		BuildContext context(boundsMin, boundsMax);
+		context.Centroids.resize(primitiveCount);
+		for (uint32_t i = 0; i < primitiveCount; i++)
+			context.Centroids[i] = (boundsMin[i] + boundsMax[i]) * 0.5f;
+
+		m_PrimitiveIndices.resize(primitiveCount);
+		for (uint32_t i = 0; i < primitiveCount; i++)
+			m_PrimitiveIndices[i] = i;
+
+		// A binary tree with N leaves never has more than 2N - 1 nodes
+		m_Nodes.resize(primitiveCount * 2 - 1);
+
+		BuildRecursive(context, 0, 0, primitiveCount, 0);
+
+		m_Nodes.resize(context.NodeCount);
+		m_Nodes.shrink_to_fit();
+	}
+
+	void BVH::Load(const BVHNode* nodes, uint32_t nodeCount, const uint32_t* primitiveIndices, uint32_t primitiveCount)
+	{
+		m_Nodes.assign(nodes, nodes + nodeCount);
+		m_PrimitiveIndices.assign(primitiveIndices, primitiveIndices + primitiveCount);
+	}
+
+	void BVH::Refit(const std::vector<glm::vec3>& boundsMin, const std::vector<glm::vec3>& boundsMax)
+	{
+		if (m_Nodes.empty() || boundsMin.size() != m_PrimitiveIndices.size())
+		{
+			Build(boundsMin, boundsMax);
+			return;
+		}
+
+		// Children are always allocated after their parent, so walking backwards visits them first
+		for (size_t i = m_Nodes.size(); i-- > 0;)
+		{
+			BVHNode& node = m_Nodes[i];
+			Bounds bounds;
+			if (node.PrimitiveCount > 0)
+			{
+				for (uint32_t j = 0; j < node.PrimitiveCount; j++)
+				{
+					uint32_t primitive = m_PrimitiveIndices[node.LeftFirst + j];
+					bounds.Grow(boundsMin[primitive]);
+					bounds.Grow(boundsMax[primitive]);
+				}
+			}
+			else
+			{
+				const BVHNode& left = m_Nodes[node.LeftFirst];
+				const BVHNode& right = m_Nodes[node.LeftFirst + 1];
+				bounds.Min = glm::min(left.BoundsMin, right.BoundsMin);
+				bounds.Max = glm::max(left.BoundsMax, right.BoundsMax);
+			}
+
+			node.BoundsMin = bounds.Min;
+			node.BoundsMax = bounds.Max;
+		}
+	}
+
+	float BVH::ComputeSAHCost() const
+	{
+		if (m_Nodes.empty())
+			return 0.0f;
+
+		float cost = 0.0f;
+		for (const BVHNode& node : m_Nodes)
+		{
+			Bounds bounds = { node.BoundsMin, node.BoundsMax };
+			cost += bounds.SurfaceArea() * (node.PrimitiveCount > 0 ? s_IntersectionCost * node.PrimitiveCount : s_TraversalCost);
+		}
+
+		Bounds root = { m_Nodes[0].BoundsMin, m_Nodes[0].BoundsMax };
+		return cost / glm::max(root.SurfaceArea(), 1e-20f);
+	}
+
+	static void ComputeRangeBounds(const BVH::BuildContext& context, const uint32_t* indices, uint32_t count, Bounds& nodeBounds, Bounds& centroidBounds)
+	{
+		auto computeChunk = [&](uint32_t begin, uint32_t end, Bounds& outNode, Bounds& outCentroid)
+		{
+			for (uint32_t i = begin; i < end; i++)
+			{
+				uint32_t primitive = indices[i];
+				outNode.Grow(context.BoundsMin[primitive]);
+				outNode.Grow(context.BoundsMax[primitive]);
+				outCentroid.Grow(context.Centroids[primitive]);
+			}
+		};
+
+		if (count < s_ParallelBinningThreshold)
+		{
+			computeChunk(0, count, nodeBounds, centroidBounds);
+			return;
+		}
+
+		uint32_t chunkCount = (count + s_BinningChunkSize - 1) / s_BinningChunkSize;
+		std::vector<Bounds> chunkNodeBounds(chunkCount);
+		std::vector<Bounds> chunkCentroidBounds(chunkCount);
+
+		ThreadPool::Get().ParallelFor(chunkCount, [&](uint32_t chunk)
+		{
+			uint32_t begin = chunk * s_BinningChunkSize;
+			computeChunk(begin, std::min(begin + s_BinningChunkSize, count), chunkNodeBounds[chunk], chunkCentroidBounds[chunk]);
+		});
+
+		for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+		{
+			nodeBounds.Grow(chunkNodeBounds[chunk]);
+			centroidBounds.Grow(chunkCentroidBounds[chunk]);
+		}
+	}
+
+	static void FillBins(const BVH::BuildContext& context, const uint32_t* indices, uint32_t count, const Bounds& centroidBounds, Bin (&bins)[3][s_BinCount])
+	{
+		glm::vec3 extent = centroidBounds.Max - centroidBounds.Min;
+		glm::vec3 scale = glm::vec3(0.0f);
+		for (int axis = 0; axis < 3; axis++)
+			scale[axis] = extent[axis] > 0.0f ? (float)s_BinCount / extent[axis] : 0.0f;
+
+		auto binChunk = [&](uint32_t begin, uint32_t end, Bin (&outBins)[3][s_BinCount])
+		{
+			for (uint32_t i = begin; i < end; i++)
+			{
+				uint32_t primitive = indices[i];
+				Bounds box;
+				box.Grow(context.BoundsMin[primitive]);
+				box.Grow(context.BoundsMax[primitive]);
+
+				for (int axis = 0; axis < 3; axis++)
+				{
+					uint32_t binIndex = std::min(s_BinCount - 1, (uint32_t)((context.Centroids[primitive][axis] - centroidBounds.Min[axis]) * scale[axis]));
+					outBins[axis][binIndex].Count++;
+					outBins[axis][binIndex].Box.Grow(box);
+				}
+			}
+		};
+
+		if (count < s_ParallelBinningThreshold)
+		{
+			binChunk(0, count, bins);
+			return;
+		}
+
+		struct ChunkBins { Bin Bins[3][s_BinCount]; };
+
+		uint32_t chunkCount = (count + s_BinningChunkSize - 1) / s_BinningChunkSize;
+		std::vector<ChunkBins> chunkBins(chunkCount);
+
+		ThreadPool::Get().ParallelFor(chunkCount, [&](uint32_t chunk)
+		{
+			uint32_t begin = chunk * s_BinningChunkSize;
+			binChunk(begin, std::min(begin + s_BinningChunkSize, count), chunkBins[chunk].Bins);
+		});
+
+		for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				for (uint32_t bin = 0; bin < s_BinCount; bin++)
+				{
+					bins[axis][bin].Count += chunkBins[chunk].Bins[axis][bin].Count;
+					bins[axis][bin].Box.Grow(chunkBins[chunk].Bins[axis][bin].Box);
+				}
+			}
+		}
+	}
+
+	void BVH::BuildRecursive(BuildContext& context, uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t depth)
+	{
+		uint32_t* indices = m_PrimitiveIndices.data() + first;
+
+		Bounds nodeBounds, centroidBounds;
+		ComputeRangeBounds(context, indices, count, nodeBounds, centroidBounds);
+
+		BVHNode& node = m_Nodes[nodeIndex];
+		node.BoundsMin = nodeBounds.Min;
+		node.BoundsMax = nodeBounds.Max;
+		node.LeftFirst = first;
+		node.PrimitiveCount = count;
+
+		// The stack in Traverse holds at most one entry per level
+		if (count <= 1 || depth + 1 >= MaxDepth)
+			return;
+
+		// Evaluate the SAH at every bin boundary on every axis
+		Bin bins[3][s_BinCount];
+		FillBins(context, indices, count, centroidBounds, bins);
+
+		float bestCost = std::numeric_limits<float>::max();
+		int bestAxis = -1;
+		uint32_t bestSplit = 0;
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (centroidBounds.Max[axis] <= centroidBounds.Min[axis])
+				continue;
+
+			float leftArea[s_BinCount - 1];
+			uint32_t leftCount[s_BinCount - 1];
+			Bounds leftBox;
+			uint32_t leftSum = 0;
+			for (uint32_t i = 0; i < s_BinCount - 1; i++)
+			{
+				leftBox.Grow(bins[axis][i].Box);
+				leftSum += bins[axis][i].Count;
+				leftArea[i] = leftBox.SurfaceArea();
+				leftCount[i] = leftSum;
+			}
+
+			Bounds rightBox;
+			uint32_t rightSum = 0;
+			for (uint32_t i = s_BinCount - 1; i > 0; i--)
+			{
+				rightBox.Grow(bins[axis][i].Box);
+				rightSum += bins[axis][i].Count;
+
+				if (leftCount[i - 1] == 0 || rightSum == 0)
+					continue;
+
+				float cost = leftArea[i - 1] * leftCount[i - 1] + rightBox.SurfaceArea() * rightSum;
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = i;
+				}
+			}
+		}
+
+		if (bestAxis == -1)
+		{
+			// All centroids coincide, SAH can't separate them
+			if (count <= s_MaxLeafSize)
+				return;
+		}
+		else
+		{
+			float nodeArea = nodeBounds.SurfaceArea();
+			float leafCost = s_IntersectionCost * count;
+			float splitCost = s_TraversalCost + s_IntersectionCost * bestCost / glm::max(nodeArea, 1e-20f);
+			if (splitCost >= leafCost && count <= s_MaxLeafSize)
+				return;
+		}
+
+		uint32_t leftCount = 0;
+		if (bestAxis != -1)
+		{
+			float scale = (float)s_BinCount / (centroidBounds.Max[bestAxis] - centroidBounds.Min[bestAxis]);
+			uint32_t* middle = std::partition(indices, indices + count, [&](uint32_t primitive)
+			{
+				uint32_t binIndex = std::min(s_BinCount - 1, (uint32_t)((context.Centroids[primitive][bestAxis] - centroidBounds.Min[bestAxis]) * scale));
+				return binIndex < bestSplit;
+			});
+			leftCount = (uint32_t)(middle - indices);
+		}
+
+		// Degenerate split, fall back to an object median split
+		if (leftCount == 0 || leftCount == count)
+			leftCount = count / 2;
+
+		uint32_t leftIndex = context.NodeCount.fetch_add(2);
+		node.LeftFirst = leftIndex;
+		node.PrimitiveCount = 0;
+
+		uint32_t rightCount = count - leftCount;
+		if (count >= s_ParallelSubtreeThreshold)
+		{
+			ThreadPool::Get().ParallelFor(2, [&](uint32_t child)
+			{
+				if (child == 0)
+					BuildRecursive(context, leftIndex, first, leftCount, depth + 1);
+				else
+					BuildRecursive(context, leftIndex + 1, first + leftCount, rightCount, depth + 1);
+			});
+		}
+		else
+		{
+			BuildRecursive(context, leftIndex, first, leftCount, depth + 1);
+			BuildRecursive(context, leftIndex + 1, first + leftCount, rightCount, depth + 1);
+		}
+	}
+
+}
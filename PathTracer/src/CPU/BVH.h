@@ -0,0 +1,137 @@
+#pragma once
+#include "CPU/Intersection.h"
+#include <vector>
+
+namespace CPU {
+
+	struct BVHNode
+	{
+		glm::vec3 BoundsMin;
+		uint32_t LeftFirst = 0;      // Left child for interior nodes (right child is LeftFirst + 1), first primitive for leaves
+		glm::vec3 BoundsMax;
+		uint32_t PrimitiveCount = 0; // 0 for interior nodes
+	};
+
+	// Binary BVH over axis aligned primitive bounds, built with binned SAH. Large subtrees
+	// are built in parallel on the shared thread pool. Used both for the triangles of a
+	// submesh and for the submesh instances of a scene.
+	class BVH
+	{
+	public:
+		void Build(const std::vector<glm::vec3>& boundsMin, const std::vector<glm::vec3>& boundsMax);
+
+		// Takes over a tree built earlier, e.g. the one stored in a CompiledScene
+		void Load(const BVHNode* nodes, uint32_t nodeCount, const uint32_t* primitiveIndices, uint32_t primitiveCount);
+
+		// Recomputes node bounds for moved primitives, keeping the tree topology. The primitive
+		// count must match the last Build. Much cheaper than a rebuild, but the tree quality
+		// degrades as primitives drift away from where they were when it was built.
+		void Refit(const std::vector<glm::vec3>& boundsMin, const std::vector<glm::vec3>& boundsMax);
+
+		// Surface area heuristic cost of the tree relative to its root, used to judge refit quality
+		float ComputeSAHCost() const;
+
+		// Calls intersectPrimitive(primitiveIndex, tMax) for every primitive whose leaf the ray
+		// reaches, nearest child first. The callback shrinks tMax when it finds a closer hit.
+		template<typename Func>
+		void Traverse(const glm::vec3& origin, const glm::vec3& direction, float tMin, float& tMax, Func&& intersectPrimitive) const;
+
+		bool IsEmpty() const { return m_Nodes.empty(); }
+		const glm::vec3& GetBoundsMin() const { return m_Nodes[0].BoundsMin; }
+		const glm::vec3& GetBoundsMax() const { return m_Nodes[0].BoundsMax; }
+
+		const std::vector<BVHNode>& GetNodes() const { return m_Nodes; }
+		const std::vector<uint32_t>& GetPrimitiveIndices() const { return m_PrimitiveIndices; }
+
+	public:
+		static constexpr uint32_t MaxDepth = 64;
+
+		struct BuildContext;
+
+	private:
+		void BuildRecursive(BuildContext& context, uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t depth);
+
+	private:
+		std::vector<BVHNode> m_Nodes;
+		std::vector<uint32_t> m_PrimitiveIndices;
+	};
+
+	template<typename Func>
+	void BVH::Traverse(const glm::vec3& origin, const glm::vec3& direction, float tMin, float& tMax, Func&& intersectPrimitive) const
+	{
+		if (m_Nodes.empty())
+			return;
+
+		glm::vec3 inverseDirection = 1.0f / direction;
+
+		if (IntersectAABB(origin, inverseDirection, m_Nodes[0].BoundsMin, m_Nodes[0].BoundsMax, tMin, tMax) < 0.0f)
+			return;
+
+		struct StackEntry
+		{
+			uint32_t NodeIndex;
+			float Distance;
+		};
+
+		StackEntry stack[MaxDepth];
+		uint32_t stackSize = 0;
+		uint32_t nodeIndex = 0;
+
+		while (true)
+		{
+			const BVHNode& node = m_Nodes[nodeIndex];
+
+			if (node.PrimitiveCount > 0)
+			{
+				for (uint32_t i = 0; i < node.PrimitiveCount; i++)
+					intersectPrimitive(m_PrimitiveIndices[node.LeftFirst + i], tMax);
+			}
+			else
+			{
+				uint32_t left = node.LeftFirst;
+				uint32_t right = node.LeftFirst + 1;
+				float leftDistance = IntersectAABB(origin, inverseDirection, m_Nodes[left].BoundsMin, m_Nodes[left].BoundsMax, tMin, tMax);
+				float rightDistance = IntersectAABB(origin, inverseDirection, m_Nodes[right].BoundsMin, m_Nodes[right].BoundsMax, tMin, tMax);
+
+				if (leftDistance >= 0.0f && rightDistance >= 0.0f)
+				{
+					if (rightDistance < leftDistance)
+					{
+						std::swap(left, right);
+						std::swap(leftDistance, rightDistance);
+					}
+
+					stack[stackSize++] = { right, rightDistance };
+					nodeIndex = left;
+					continue;
+				}
+				else if (leftDistance >= 0.0f)
+				{
+					nodeIndex = left;
+					continue;
+				}
+				else if (rightDistance >= 0.0f)
+				{
+					nodeIndex = right;
+					continue;
+				}
+			}
+
+			// Pop the next node that is still in front of the closest hit
+			bool found = false;
+			while (stackSize > 0 && !found)
+			{
+				const StackEntry& entry = stack[--stackSize];
+				if (entry.Distance <= tMax)
+				{
+					nodeIndex = entry.NodeIndex;
+					found = true;
+				}
+			}
+
+			if (!found)
+				break;
+		}
+	}
+
+}
@@ -0,0 +1,136 @@
+#include "CPU/CompactVertex.h"
+#include "Util/Half.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+using namespace VkLibrary;
+
+namespace CPU {
+
+	static uint32_t PackSnorm2x16(const glm::vec2& value)
+	{
+		int32_t x = (int32_t)std::round(glm::clamp(value.x, -1.0f, 1.0f) * 32767.0f);
+		int32_t y = (int32_t)std::round(glm::clamp(value.y, -1.0f, 1.0f) * 32767.0f);
+		return ((uint32_t)x & 0xFFFF) | ((uint32_t)y << 16);
+	}
+
+	static glm::vec2 UnpackSnorm2x16(uint32_t value)
+	{
+		float x = (float)(int16_t)(value & 0xFFFF) / 32767.0f;
+		float y = (float)(int16_t)(value >> 16) / 32767.0f;
+		return glm::vec2(glm::max(x, -1.0f), glm::max(y, -1.0f));
+	}
+
+	static uint32_t Quantize(float value, float boundsMin, float scale)
+	{
+		if (scale <= 0.0f)
+			return 0;
+
+		return (uint32_t)glm::clamp(std::round((value - boundsMin) / scale), 0.0f, 65535.0f);
+	}
+
+	glm::vec2 OctahedralEncode(const glm::vec3& direction)
+	{
+		float sum = glm::abs(direction.x) + glm::abs(direction.y) + glm::abs(direction.z);
+		if (sum <= 0.0f)
+			return glm::vec2(0.0f);
+
+		glm::vec3 n = direction / sum;
+		if (n.z >= 0.0f)
+			return glm::vec2(n.x, n.y);
+
+		// Fold the lower hemisphere over the diagonals
+		return glm::vec2(
+			(1.0f - glm::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+			(1.0f - glm::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+	}
+
+	glm::vec3 OctahedralDecode(const glm::vec2& encoded)
+	{
+		glm::vec3 n = glm::vec3(encoded.x, encoded.y, 1.0f - glm::abs(encoded.x) - glm::abs(encoded.y));
+		float t = glm::max(-n.z, 0.0f);
+		n.x += n.x >= 0.0f ? -t : t;
+		n.y += n.y >= 0.0f ? -t : t;
+		return glm::normalize(n);
+	}
+
+	CompactVertex EncodeVertex(const Vertex& vertex, const CompactVertexBounds& bounds)
+	{
+		uint32_t x = Quantize(vertex.Position.x, bounds.Min.x, bounds.Scale.x);
+		uint32_t y = Quantize(vertex.Position.y, bounds.Min.y, bounds.Scale.y);
+		uint32_t z = Quantize(vertex.Position.z, bounds.Min.z, bounds.Scale.z);
+
+		CompactVertex compact;
+		compact.Data[0] = x | (y << 16);
+		compact.Data[1] = z | (vertex.Tangent.w < 0.0f ? 1u << 16 : 0u);
+		compact.Data[2] = FloatToHalf(vertex.TextureCoords.x) | (FloatToHalf(vertex.TextureCoords.y) << 16);
+		compact.Data[3] = PackSnorm2x16(OctahedralEncode(vertex.Normal));
+		compact.Data[4] = PackSnorm2x16(OctahedralEncode(glm::vec3(vertex.Tangent)));
+		return compact;
+	}
+
+	Vertex DecodeVertex(const CompactVertex& compact, const CompactVertexBounds& bounds)
+	{
+		glm::vec3 quantized = glm::vec3(compact.Data[0] & 0xFFFF, compact.Data[0] >> 16, compact.Data[1] & 0xFFFF);
+
+		Vertex vertex;
+		vertex.Position = glm::vec3(bounds.Min) + quantized * glm::vec3(bounds.Scale);
+		vertex.TextureCoords = glm::vec2(HalfToFloat(compact.Data[2] & 0xFFFF), HalfToFloat(compact.Data[2] >> 16));
+		vertex.Normal = OctahedralDecode(UnpackSnorm2x16(compact.Data[3]));
+		vertex.Tangent = glm::vec4(OctahedralDecode(UnpackSnorm2x16(compact.Data[4])), (compact.Data[1] >> 16) & 1 ? -1.0f : 1.0f);
+		return vertex;
+	}
+
+	void EncodeVertices(const std::vector<Vertex>& vertices, const std::vector<SubMesh>& subMeshes,
+		std::vector<CompactVertex>& compactVertices, std::vector<CompactVertexBounds>& bounds)
+	{
+		compactVertices.assign(vertices.size(), CompactVertex{});
+		bounds.resize(subMeshes.size());
+
+		// Bounds per vertex range, so a vertex is quantized the same way for every submesh using it
+		struct Range
+		{
+			uint32_t Count = 0;
+			glm::vec3 Min = glm::vec3(std::numeric_limits<float>::max());
+			glm::vec3 Max = glm::vec3(-std::numeric_limits<float>::max());
+		};
+
+		std::unordered_map<uint32_t, Range> ranges;
+		for (const SubMesh& subMesh : subMeshes)
+		{
+			Range& range = ranges[subMesh.VertexOffset];
+			range.Count = glm::max(range.Count, subMesh.VertexCount);
+		}
+
+		std::unordered_map<uint32_t, CompactVertexBounds> rangeBounds;
+		for (auto& [offset, range] : ranges)
+		{
+			uint32_t end = glm::min(offset + range.Count, (uint32_t)vertices.size());
+			for (uint32_t i = offset; i < end; i++)
+			{
+				range.Min = glm::min(range.Min, vertices[i].Position);
+				range.Max = glm::max(range.Max, vertices[i].Position);
+			}
+
+			CompactVertexBounds& rangeBound = rangeBounds[offset];
+			if (end <= offset)
+			{
+				rangeBound.Min = glm::vec4(0.0f);
+				rangeBound.Scale = glm::vec4(0.0f);
+				continue;
+			}
+
+			rangeBound.Min = glm::vec4(range.Min, 0.0f);
+			rangeBound.Scale = glm::vec4((range.Max - range.Min) / 65535.0f, 0.0f);
+
+			for (uint32_t i = offset; i < end; i++)
+				compactVertices[i] = EncodeVertex(vertices[i], rangeBound);
+		}
+
+		for (size_t i = 0; i < subMeshes.size(); i++)
+			bounds[i] = rangeBounds[subMeshes[i].VertexOffset];
+	}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "Graphics/Mesh.h"
+#include <vector>
+
+namespace CPU {
+
+	// 20 byte encoding of a Vertex, same layout as CompactVertex.glsl:
+	//   Data[0] position x | y << 16, unorm16 within the bounds of its vertex range
+	//   Data[1] position z | tangent sign << 16 (set for w < 0)
+	//   Data[2] texture coordinates as two halves
+	//   Data[3] octahedral normal, snorm16 x2
+	//   Data[4] octahedral tangent, snorm16 x2
+	struct CompactVertex
+	{
+		uint32_t Data[5];
+	};
+
+	// Dequantization of one submesh, Scale is the bounds extent / 65535
+	struct CompactVertexBounds
+	{
+		glm::vec4 Min;
+		glm::vec4 Scale;
+	};
+
+	// Leading part of the CompactVertexInfo buffer, followed by one CompactVertexBounds per submesh
+	struct CompactVertexHeader
+	{
+		uint32_t Enabled;
+		uint32_t Padding[3];
+	};
+
+	glm::vec2 OctahedralEncode(const glm::vec3& direction);
+	glm::vec3 OctahedralDecode(const glm::vec2& encoded);
+
+	CompactVertex EncodeVertex(const VkLibrary::Vertex& vertex, const CompactVertexBounds& bounds);
+
+	// What InterpolateCompactVertex reads per corner, tangent w comes back as +-1
+	VkLibrary::Vertex DecodeVertex(const CompactVertex& vertex, const CompactVertexBounds& bounds);
+
+	// Encodes every vertex of the mesh, bounds gets one entry per submesh. Submeshes that share a
+	// vertex range (instances of one glTF mesh) share the bounds of that range.
+	void EncodeVertices(const std::vector<VkLibrary::Vertex>& vertices, const std::vector<VkLibrary::SubMesh>& subMeshes,
+		std::vector<CompactVertex>& compactVertices, std::vector<CompactVertexBounds>& bounds);
+
+}
@@ -0,0 +1,320 @@
+#include "CPU/CompiledScene.h"
+#include "CPU/Scene.h"
+#include "Util/Hash.h"
+#include "Util/Json.h"
+#include "Core/Base.h"
+#include <cstring>
+#include <filesystem>
+
+using namespace VkLibrary;
+
+namespace CPU {
+
+	static constexpr char s_Magic[4] = { 'S', 'C', 'N', 'E' };
+	static constexpr uint32_t s_Version = 1;
+
+	// Every array starts on this boundary, enough for any storage buffer offset alignment
+	static constexpr uint64_t s_SectionAlignment = 256;
+
+	enum CompiledSceneSection : uint32_t
+	{
+		Vertices = 0, Indices, SubMeshes, Materials, Nodes, PrimitiveIndices, WideNodes, WideTriangles, SectionCount
+	};
+
+	static constexpr uint32_t s_ElementSizes[SectionCount] = {
+		sizeof(Vertex), sizeof(uint32_t), sizeof(CompiledSubMesh), sizeof(MaterialBuffer),
+		sizeof(BVHNode), sizeof(uint32_t), sizeof(WideBVHNode), sizeof(WideBVHTriangle)
+	};
+
+	struct CompiledSceneHeader
+	{
+		char Magic[4];
+		uint32_t Version;
+		uint64_t Key;
+		uint64_t Offsets[SectionCount];
+		uint32_t Counts[SectionCount];
+	};
+
+	static_assert(sizeof(CompiledSceneHeader) <= s_SectionAlignment, "Header overlaps scene data");
+
+	static uint64_t AlignUp(uint64_t value)
+	{
+		return (value + s_SectionAlignment - 1) / s_SectionAlignment * s_SectionAlignment;
+	}
+
+	CompiledScene::CompiledScene(const CompiledSceneSpecification& specification)
+		: m_Specification(specification)
+	{
+		m_Path = m_Specification.Path.empty() ? std::filesystem::path(m_Specification.SourcePath).replace_extension(".scene").string() : m_Specification.Path;
+
+		if (!std::filesystem::exists(m_Specification.SourcePath))
+		{
+			LOG_ERROR("Scene {} not found", m_Specification.SourcePath);
+			return;
+		}
+
+		m_Key = ComputeKey(m_Specification.SourcePath);
+
+		if (Load())
+		{
+			m_LoadedFromCache = true;
+			return;
+		}
+
+		Ref<MeshSource> meshSource = m_Specification.LoadedSource ? m_Specification.LoadedSource : CreateRef<MeshSource>(m_Specification.SourcePath);
+		if (!Compile(meshSource, m_Specification.SourcePath, m_Path))
+		{
+			LOG_ERROR("Failed to write compiled scene {}", m_Path);
+			return;
+		}
+
+		// Map the file that was just written, so a fresh compile is used exactly like a cache hit
+		if (!Load())
+			LOG_ERROR("Failed to load compiled scene {}", m_Path);
+	}
+
+	uint64_t CompiledScene::ComputeKey(const std::string& sourcePath)
+	{
+		Hasher hasher;
+		hasher.Add(s_Version);
+		hasher.Add(s_ElementSizes);
+
+		MappedFile source;
+		if (source.Open(sourcePath))
+			hasher.Add(source.GetData(), source.GetSize());
+
+		// The binary buffers can be large, their size and write time stand in for their contents
+		JsonValue document;
+		if (std::filesystem::path(sourcePath).extension() == ".gltf" && source.IsOpen()
+			&& ParseJson(std::string((const char*)source.GetData(), source.GetSize()), document))
+		{
+			std::filesystem::path directory = std::filesystem::path(sourcePath).parent_path();
+
+			const JsonValue& buffers = document["buffers"];
+			for (size_t i = 0; i < buffers.Size(); i++)
+			{
+				const std::string& uri = buffers[i]["uri"].String;
+				if (uri.empty() || uri.rfind("data:", 0) == 0)
+					continue;
+
+				std::error_code error;
+				std::filesystem::path bufferPath = directory / uri;
+				uint64_t size = std::filesystem::file_size(bufferPath, error);
+				int64_t writeTime = std::filesystem::last_write_time(bufferPath, error).time_since_epoch().count();
+				hasher.Add(size);
+				hasher.Add(writeTime);
+			}
+		}
+
+		return hasher.Get();
+	}
+
+	bool CompiledScene::Compile(const Ref<MeshSource>& meshSource, const std::string& sourcePath, const std::string& path)
+	{
+		// The bottom level BVHs are in object space, the transform only affects the top level which is not stored
+		Scene scene(meshSource, glm::mat4(1.0f));
+
+		const std::vector<SubMesh>& subMeshes = meshSource->GetSubMeshes();
+		const std::vector<BVH>& bvhs = scene.GetBottomLevelBVHs();
+		const std::vector<WideBVH>& wideBVHs = scene.GetBottomLevelWideBVHs();
+
+		std::vector<CompiledSubMesh> compiledSubMeshes(subMeshes.size());
+		uint32_t nodeCount = 0, primitiveIndexCount = 0, wideNodeCount = 0, wideTriangleCount = 0;
+		for (size_t i = 0; i < subMeshes.size(); i++)
+		{
+			const Geometry& geometry = scene.GetGeometries()[i];
+
+			CompiledSubMesh& compiled = compiledSubMeshes[i];
+			compiled = {};
+			compiled.VertexOffset = subMeshes[i].VertexOffset;
+			compiled.VertexCount = subMeshes[i].VertexCount;
+			compiled.IndexOffset = subMeshes[i].IndexOffset;
+			compiled.IndexCount = subMeshes[i].IndexCount;
+			compiled.MaterialIndex = subMeshes[i].MaterialIndex;
+			compiled.NodeOffset = nodeCount;
+			compiled.NodeCount = (uint32_t)bvhs[i].GetNodes().size();
+			compiled.PrimitiveIndexOffset = primitiveIndexCount;
+			compiled.WideNodeOffset = wideNodeCount;
+			compiled.WideNodeCount = (uint32_t)wideBVHs[i].GetNodes().size();
+			compiled.WideTriangleOffset = wideTriangleCount;
+			compiled.BoundsMin = geometry.BoundsMin;
+			compiled.BoundsMax = geometry.BoundsMax;
+			compiled.WorldTransform = subMeshes[i].WorldTransform;
+
+			nodeCount += compiled.NodeCount;
+			primitiveIndexCount += (uint32_t)bvhs[i].GetPrimitiveIndices().size();
+			wideNodeCount += compiled.WideNodeCount;
+			wideTriangleCount += (uint32_t)wideBVHs[i].GetTriangles().size();
+		}
+
+		CompiledSceneHeader header = {};
+		memcpy(header.Magic, s_Magic, sizeof(s_Magic));
+		header.Version = s_Version;
+		header.Key = ComputeKey(sourcePath);
+		header.Counts[Vertices] = (uint32_t)scene.GetVertices().size();
+		header.Counts[Indices] = (uint32_t)scene.GetIndices().size();
+		header.Counts[SubMeshes] = (uint32_t)compiledSubMeshes.size();
+		header.Counts[Materials] = (uint32_t)scene.GetMaterials().size();
+		header.Counts[Nodes] = nodeCount;
+		header.Counts[PrimitiveIndices] = primitiveIndexCount;
+		header.Counts[WideNodes] = wideNodeCount;
+		header.Counts[WideTriangles] = wideTriangleCount;
+
+		uint64_t size = s_SectionAlignment;
+		for (uint32_t section = 0; section < SectionCount; section++)
+		{
+			header.Offsets[section] = size;
+			size = AlignUp(size + (uint64_t)header.Counts[section] * s_ElementSizes[section]);
+		}
+
+		std::error_code error;
+		std::filesystem::path parent = std::filesystem::path(path).parent_path();
+		if (!parent.empty())
+			std::filesystem::create_directories(parent, error);
+
+		// Write to a temporary file first so an interrupted compile never leaves a valid looking scene behind
+		std::string tempPath = path + ".tmp";
+		{
+			MappedFile file;
+			if (!file.Create(tempPath, size))
+				return false;
+
+			*file.As<CompiledSceneHeader>() = header;
+
+			auto write = [&](CompiledSceneSection section, const void* data)
+			{
+				if (header.Counts[section] > 0)
+					memcpy(file.As<uint8_t>(header.Offsets[section]), data, (size_t)header.Counts[section] * s_ElementSizes[section]);
+			};
+
+			write(Vertices, scene.GetVertices().data());
+			write(Indices, scene.GetIndices().data());
+			write(SubMeshes, compiledSubMeshes.data());
+			write(Materials, scene.GetMaterials().data());
+
+			for (size_t i = 0; i < compiledSubMeshes.size(); i++)
+			{
+				const CompiledSubMesh& compiled = compiledSubMeshes[i];
+				const std::vector<uint32_t>& primitiveIndices = bvhs[i].GetPrimitiveIndices();
+				const std::vector<WideBVHTriangle>& triangles = wideBVHs[i].GetTriangles();
+
+				memcpy(file.As<BVHNode>(header.Offsets[Nodes]) + compiled.NodeOffset, bvhs[i].GetNodes().data(), compiled.NodeCount * sizeof(BVHNode));
+				memcpy(file.As<uint32_t>(header.Offsets[PrimitiveIndices]) + compiled.PrimitiveIndexOffset, primitiveIndices.data(), primitiveIndices.size() * sizeof(uint32_t));
+				memcpy(file.As<WideBVHNode>(header.Offsets[WideNodes]) + compiled.WideNodeOffset, wideBVHs[i].GetNodes().data(), compiled.WideNodeCount * sizeof(WideBVHNode));
+				memcpy(file.As<WideBVHTriangle>(header.Offsets[WideTriangles]) + compiled.WideTriangleOffset, triangles.data(), triangles.size() * sizeof(WideBVHTriangle));
+			}
+		}
+
+		std::filesystem::rename(tempPath, path, error);
+		if (error)
+		{
+			std::filesystem::remove(path, error);
+			std::filesystem::rename(tempPath, path, error);
+		}
+
+		return !error;
+	}
+
+	bool CompiledScene::Load()
+	{
+		if (!m_File.Open(m_Path))
+			return false;
+
+		bool valid = m_File.GetSize() >= s_SectionAlignment;
+		if (valid)
+		{
+			const CompiledSceneHeader& header = *m_File.As<CompiledSceneHeader>();
+			valid = memcmp(header.Magic, s_Magic, sizeof(s_Magic)) == 0
+				&& header.Version == s_Version
+				&& header.Key == m_Key;
+
+			for (uint32_t section = 0; valid && section < SectionCount; section++)
+			{
+				uint64_t end = header.Offsets[section] + (uint64_t)header.Counts[section] * s_ElementSizes[section];
+				valid = header.Offsets[section] % s_SectionAlignment == 0 && header.Offsets[section] >= s_SectionAlignment && end <= m_File.GetSize();
+			}
+
+			// Submesh ranges are trusted by the BVH loaders, check them once here
+			const CompiledSubMesh* subMeshes = m_File.As<CompiledSubMesh>(header.Offsets[SubMeshes]);
+			for (uint32_t i = 0; valid && i < header.Counts[SubMeshes]; i++)
+			{
+				const CompiledSubMesh& subMesh = subMeshes[i];
+				valid = subMesh.IndexOffset + subMesh.IndexCount <= header.Counts[Indices]
+					&& subMesh.VertexOffset + subMesh.VertexCount <= header.Counts[Vertices]
+					&& subMesh.NodeOffset + subMesh.NodeCount <= header.Counts[Nodes]
+					&& subMesh.PrimitiveIndexOffset + subMesh.IndexCount / 3 <= header.Counts[PrimitiveIndices]
+					&& subMesh.WideNodeOffset + subMesh.WideNodeCount <= header.Counts[WideNodes]
+					&& subMesh.WideTriangleOffset + subMesh.IndexCount / 3 <= header.Counts[WideTriangles];
+			}
+		}
+
+		if (!valid)
+		{
+			LOG_WARN("Compiled scene {} is stale, recompiling", m_Path);
+			m_File.Close();
+		}
+
+		return valid;
+	}
+
+	const Vertex* CompiledScene::GetVertices() const
+	{
+		return m_File.As<Vertex>(m_File.As<CompiledSceneHeader>()->Offsets[Vertices]);
+	}
+
+	uint32_t CompiledScene::GetVertexCount() const
+	{
+		return m_File.As<CompiledSceneHeader>()->Counts[Vertices];
+	}
+
+	const uint32_t* CompiledScene::GetIndices() const
+	{
+		return m_File.As<uint32_t>(m_File.As<CompiledSceneHeader>()->Offsets[Indices]);
+	}
+
+	uint32_t CompiledScene::GetIndexCount() const
+	{
+		return m_File.As<CompiledSceneHeader>()->Counts[Indices];
+	}
+
+	const CompiledSubMesh* CompiledScene::GetSubMeshes() const
+	{
+		return m_File.As<CompiledSubMesh>(m_File.As<CompiledSceneHeader>()->Offsets[SubMeshes]);
+	}
+
+	uint32_t CompiledScene::GetSubMeshCount() const
+	{
+		return m_File.As<CompiledSceneHeader>()->Counts[SubMeshes];
+	}
+
+	const MaterialBuffer* CompiledScene::GetMaterials() const
+	{
+		return m_File.As<MaterialBuffer>(m_File.As<CompiledSceneHeader>()->Offsets[Materials]);
+	}
+
+	uint32_t CompiledScene::GetMaterialCount() const
+	{
+		return m_File.As<CompiledSceneHeader>()->Counts[Materials];
+	}
+
+	const BVHNode* CompiledScene::GetNodes() const
+	{
+		return m_File.As<BVHNode>(m_File.As<CompiledSceneHeader>()->Offsets[Nodes]);
+	}
+
+	const uint32_t* CompiledScene::GetPrimitiveIndices() const
+	{
+		return m_File.As<uint32_t>(m_File.As<CompiledSceneHeader>()->Offsets[PrimitiveIndices]);
+	}
+
+	const WideBVHNode* CompiledScene::GetWideNodes() const
+	{
+		return m_File.As<WideBVHNode>(m_File.As<CompiledSceneHeader>()->Offsets[WideNodes]);
+	}
+
+	const WideBVHTriangle* CompiledScene::GetWideTriangles() const
+	{
+		return m_File.As<WideBVHTriangle>(m_File.As<CompiledSceneHeader>()->Offsets[WideTriangles]);
+	}
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "CPU/BVH.h"
+#include "CPU/WideBVH.h"
+#include "Graphics/Mesh.h"
+#include "Util/MappedFile.h"
+#include <string>
+
+namespace CPU {
+
+	// Submesh record of a compiled scene. The BVH ranges index the concatenated node, primitive
+	// index, wide node and wide triangle arrays of all submeshes.
+	struct CompiledSubMesh
+	{
+		uint32_t VertexOffset;
+		uint32_t VertexCount;
+		uint32_t IndexOffset;
+		uint32_t IndexCount;
+		uint32_t MaterialIndex;
+
+		uint32_t NodeOffset;
+		uint32_t NodeCount;
+		uint32_t PrimitiveIndexOffset;
+		uint32_t WideNodeOffset;
+		uint32_t WideNodeCount;
+		uint32_t WideTriangleOffset;
+		uint32_t Padding;
+
+		glm::vec3 BoundsMin;
+		glm::vec3 BoundsMax;
+		glm::mat4 WorldTransform;
+	};
+
+	struct CompiledSceneSpecification
+	{
+		std::string SourcePath;
+
+		// Next to the source with a .scene extension when empty
+		std::string Path;
+
+		// Source the caller already loaded, compiled from on a miss instead of loading the glTF again
+		VkLibrary::Ref<VkLibrary::MeshSource> LoadedSource;
+	};
+
+	// glTF scene flattened into the arrays the CPU renderer consumes: the Vertex and index buffers,
+	// submeshes, MaterialBuffers and the object space BVHs of every submesh. Stored in one
+	// memory-mapped file with every array on a 256 byte boundary, so loading is a map and a header
+	// check. The file is keyed by the contents of the glTF and the size and write time of its
+	// buffers, anything else makes it compile the source again. The GPU path still loads the glTF
+	// through MeshSource, which also provides the textures.
+	class CompiledScene
+	{
+	public:
+		CompiledScene(const CompiledSceneSpecification& specification);
+
+		// Compiles from a mesh that is already loaded and writes the result to path
+		static bool Compile(const VkLibrary::Ref<VkLibrary::MeshSource>& meshSource, const std::string& sourcePath, const std::string& path);
+
+		bool IsValid() const { return m_File.IsOpen(); }
+		bool WasLoadedFromCache() const { return m_LoadedFromCache; }
+
+		const VkLibrary::Vertex* GetVertices() const;
+		uint32_t GetVertexCount() const;
+		const uint32_t* GetIndices() const;
+		uint32_t GetIndexCount() const;
+		const CompiledSubMesh* GetSubMeshes() const;
+		uint32_t GetSubMeshCount() const;
+		const VkLibrary::MaterialBuffer* GetMaterials() const;
+		uint32_t GetMaterialCount() const;
+
+		const BVHNode* GetNodes() const;
+		const uint32_t* GetPrimitiveIndices() const;
+		const WideBVHNode* GetWideNodes() const;
+		const WideBVHTriangle* GetWideTriangles() const;
+
+		uint64_t GetFileSize() const { return m_File.GetSize(); }
+		const std::string& GetPath() const { return m_Path; }
+
+		static uint64_t ComputeKey(const std::string& sourcePath);
+
+	private:
+		bool Load();
+
+	private:
+		CompiledSceneSpecification m_Specification;
+		std::string m_Path;
+		uint64_t m_Key = 0;
+
+		MappedFile m_File;
+		bool m_LoadedFromCache = false;
+	};
+
+}
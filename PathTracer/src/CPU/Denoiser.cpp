@@ -0,0 +1,482 @@
+#include "CPU/Denoiser.h"
+#include "CPU/ThreadPool.h"
+#include <cmath>
+
+#if defined(_M_X64) || defined(__x86_64__)
+	#define DENOISER_X86 1
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#define TARGET_AVX2
+	#else
+		#define TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#else
+	#define DENOISER_X86 0
+#endif
+
+namespace CPU {
+
+	// B3 spline, the same kernel as KERNEL in Denoise.glsl
+	static constexpr float s_Kernel[5] = { 1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f };
+	static constexpr uint32_t s_TapCount = 24;
+
+	// Demodulation divides by at least this, so black albedo doesn't blow the irradiance up
+	static constexpr float s_MinAlbedo = 0.01f;
+
+	// Keeps the luminance and depth weights finite on noiseless or flat pixels
+	static constexpr float s_Epsilon = 1e-4f;
+
+	// Widest vector, the rows are filtered past the image width up to a multiple of it
+	static constexpr uint32_t s_MaxLanes = 8;
+
+	static float Luminance(float r, float g, float b)
+	{
+		return 0.212671f * r + 0.715160f * g + 0.072169f * b;
+	}
+
+	// One a-trous pass over a row of padded pixels, the 24 taps around the center are in the order of Denoise.glsl
+	struct FilterRowArgs
+	{
+		const float* R;
+		const float* G;
+		const float* B;
+		const float* Variance;
+		const float* NormalX;
+		const float* NormalY;
+		const float* NormalZ;
+		const float* Depth;
+
+		float* OutR;
+		float* OutG;
+		float* OutB;
+		float* OutVariance;
+
+		uint32_t Count;
+		int64_t TapOffsets[s_TapCount];
+		float TapWeights[s_TapCount];
+		uint32_t TapRings[s_TapCount]; // 0 for the inner 3x3 taps, 1 for the outer ring
+
+		float SigmaLuminance;
+		float SigmaNormal;
+		float DepthScale; // SigmaDepth * step
+	};
+
+	static void FilterRowScalar(const FilterRowArgs& args)
+	{
+		for (uint32_t x = 0; x < args.Count; x++)
+		{
+			float zp = args.Depth[x];
+			if (zp <= 0.0f)
+			{
+				args.OutR[x] = args.R[x];
+				args.OutG[x] = args.G[x];
+				args.OutB[x] = args.B[x];
+				args.OutVariance[x] = args.Variance[x];
+				continue;
+			}
+
+			float lp = Luminance(args.R[x], args.G[x], args.B[x]);
+			float invSigmaLuminance = 1.0f / (args.SigmaLuminance * std::sqrt(glm::max(args.Variance[x], 0.0f)) + s_Epsilon);
+			float invSigmaDepth[2] = { 1.0f / (args.DepthScale * zp + s_Epsilon), 1.0f / (args.DepthScale * zp * 2.0f + s_Epsilon) };
+
+			float centerWeight = s_Kernel[2] * s_Kernel[2];
+			float sumWeight = centerWeight;
+			float sumR = args.R[x] * centerWeight;
+			float sumG = args.G[x] * centerWeight;
+			float sumB = args.B[x] * centerWeight;
+			float sumVariance = args.Variance[x] * centerWeight * centerWeight;
+
+			for (uint32_t tap = 0; tap < s_TapCount; tap++)
+			{
+				int64_t q = (int64_t)x + args.TapOffsets[tap];
+				float zq = args.Depth[q];
+				if (zq <= 0.0f)
+					continue;
+
+				float lq = Luminance(args.R[q], args.G[q], args.B[q]);
+				float normalDot = args.NormalX[x] * args.NormalX[q] + args.NormalY[x] * args.NormalY[q] + args.NormalZ[x] * args.NormalZ[q];
+
+				float exponent = std::abs(lp - lq) * invSigmaLuminance;
+				exponent += std::abs(zp - zq) * invSigmaDepth[args.TapRings[tap]];
+				exponent += args.SigmaNormal * (1.0f - glm::max(normalDot, 0.0f));
+
+				float weight = args.TapWeights[tap] * std::exp(-exponent);
+				sumWeight += weight;
+				sumR += args.R[q] * weight;
+				sumG += args.G[q] * weight;
+				sumB += args.B[q] * weight;
+				sumVariance += args.Variance[q] * weight * weight;
+			}
+
+			float invWeight = 1.0f / sumWeight;
+			args.OutR[x] = sumR * invWeight;
+			args.OutG[x] = sumG * invWeight;
+			args.OutB[x] = sumB * invWeight;
+			args.OutVariance[x] = sumVariance * invWeight * invWeight;
+		}
+	}
+
+#if DENOISER_X86
+	// Cephes expf, relative error around 1e-7 for the non-positive exponents the weights use
+	static __m128 ExpSSE(__m128 x)
+	{
+		x = _mm_max_ps(x, _mm_set1_ps(-87.0f));
+
+		// floor() without SSE4.1
+		__m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)), _mm_set1_ps(0.5f));
+		__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+		fx = _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, fx), _mm_set1_ps(1.0f)));
+
+		x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(0.693359375f)));
+		x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(-2.12194440e-4f)));
+
+		__m128 y = _mm_set1_ps(1.9875691500e-4f);
+		y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507e-3f));
+		y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073e-3f));
+		y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894e-2f));
+		y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459e-1f));
+		y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201e-1f));
+		y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(y, x), x), x), _mm_set1_ps(1.0f));
+
+		__m128i exponent = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(fx), _mm_set1_epi32(127)), 23);
+		return _mm_mul_ps(y, _mm_castsi128_ps(exponent));
+	}
+
+	static __m128 LuminanceSSE(__m128 r, __m128 g, __m128 b)
+	{
+		return _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(0.212671f)), _mm_mul_ps(g, _mm_set1_ps(0.715160f))), _mm_mul_ps(b, _mm_set1_ps(0.072169f)));
+	}
+
+	static void FilterRowSSE(const FilterRowArgs& args)
+	{
+		const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 epsilon = _mm_set1_ps(s_Epsilon);
+		const __m128 sigmaNormal = _mm_set1_ps(args.SigmaNormal);
+		const __m128 centerWeight = _mm_set1_ps(s_Kernel[2] * s_Kernel[2]);
+
+		for (uint32_t x = 0; x < args.Count; x += 4)
+		{
+			__m128 rp = _mm_loadu_ps(args.R + x);
+			__m128 gp = _mm_loadu_ps(args.G + x);
+			__m128 bp = _mm_loadu_ps(args.B + x);
+			__m128 vp = _mm_loadu_ps(args.Variance + x);
+			__m128 nxp = _mm_loadu_ps(args.NormalX + x);
+			__m128 nyp = _mm_loadu_ps(args.NormalY + x);
+			__m128 nzp = _mm_loadu_ps(args.NormalZ + x);
+			__m128 zp = _mm_loadu_ps(args.Depth + x);
+
+			__m128 lp = LuminanceSSE(rp, gp, bp);
+			__m128 invSigmaLuminance = _mm_div_ps(one, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(args.SigmaLuminance), _mm_sqrt_ps(_mm_max_ps(vp, zero))), epsilon));
+			__m128 depthScale = _mm_mul_ps(_mm_set1_ps(args.DepthScale), zp);
+			__m128 invSigmaDepth[2] = {
+				_mm_div_ps(one, _mm_add_ps(depthScale, epsilon)),
+				_mm_div_ps(one, _mm_add_ps(_mm_mul_ps(depthScale, _mm_set1_ps(2.0f)), epsilon))
+			};
+
+			__m128 sumWeight = centerWeight;
+			__m128 sumR = _mm_mul_ps(rp, centerWeight);
+			__m128 sumG = _mm_mul_ps(gp, centerWeight);
+			__m128 sumB = _mm_mul_ps(bp, centerWeight);
+			__m128 sumVariance = _mm_mul_ps(vp, _mm_mul_ps(centerWeight, centerWeight));
+
+			for (uint32_t tap = 0; tap < s_TapCount; tap++)
+			{
+				int64_t q = (int64_t)x + args.TapOffsets[tap];
+				__m128 rq = _mm_loadu_ps(args.R + q);
+				__m128 gq = _mm_loadu_ps(args.G + q);
+				__m128 bq = _mm_loadu_ps(args.B + q);
+				__m128 zq = _mm_loadu_ps(args.Depth + q);
+
+				__m128 normalDot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nxp, _mm_loadu_ps(args.NormalX + q)), _mm_mul_ps(nyp, _mm_loadu_ps(args.NormalY + q))), _mm_mul_ps(nzp, _mm_loadu_ps(args.NormalZ + q)));
+
+				__m128 exponent = _mm_mul_ps(_mm_and_ps(_mm_sub_ps(lp, LuminanceSSE(rq, gq, bq)), absMask), invSigmaLuminance);
+				exponent = _mm_add_ps(exponent, _mm_mul_ps(_mm_and_ps(_mm_sub_ps(zp, zq), absMask), invSigmaDepth[args.TapRings[tap]]));
+				exponent = _mm_add_ps(exponent, _mm_mul_ps(sigmaNormal, _mm_sub_ps(one, _mm_max_ps(normalDot, zero))));
+
+				__m128 weight = _mm_mul_ps(_mm_set1_ps(args.TapWeights[tap]), ExpSSE(_mm_sub_ps(zero, exponent)));
+				weight = _mm_and_ps(weight, _mm_cmpgt_ps(zq, zero));
+
+				sumWeight = _mm_add_ps(sumWeight, weight);
+				sumR = _mm_add_ps(sumR, _mm_mul_ps(rq, weight));
+				sumG = _mm_add_ps(sumG, _mm_mul_ps(gq, weight));
+				sumB = _mm_add_ps(sumB, _mm_mul_ps(bq, weight));
+				sumVariance = _mm_add_ps(sumVariance, _mm_mul_ps(_mm_loadu_ps(args.Variance + q), _mm_mul_ps(weight, weight)));
+			}
+
+			// Pixels without a hit keep their input
+			__m128 invWeight = _mm_div_ps(one, sumWeight);
+			__m128 hit = _mm_cmpgt_ps(zp, zero);
+			_mm_storeu_ps(args.OutR + x, _mm_or_ps(_mm_and_ps(hit, _mm_mul_ps(sumR, invWeight)), _mm_andnot_ps(hit, rp)));
+			_mm_storeu_ps(args.OutG + x, _mm_or_ps(_mm_and_ps(hit, _mm_mul_ps(sumG, invWeight)), _mm_andnot_ps(hit, gp)));
+			_mm_storeu_ps(args.OutB + x, _mm_or_ps(_mm_and_ps(hit, _mm_mul_ps(sumB, invWeight)), _mm_andnot_ps(hit, bp)));
+			_mm_storeu_ps(args.OutVariance + x, _mm_or_ps(_mm_and_ps(hit, _mm_mul_ps(sumVariance, _mm_mul_ps(invWeight, invWeight))), _mm_andnot_ps(hit, vp)));
+		}
+	}
+
+	TARGET_AVX2 static __m256 ExpAVX2(__m256 x)
+	{
+		x = _mm256_max_ps(x, _mm256_set1_ps(-87.0f));
+
+		__m256 fx = _mm256_floor_ps(_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.44269504088896341f)), _mm256_set1_ps(0.5f)));
+
+		x = _mm256_sub_ps(x, _mm256_mul_ps(fx, _mm256_set1_ps(0.693359375f)));
+		x = _mm256_sub_ps(x, _mm256_mul_ps(fx, _mm256_set1_ps(-2.12194440e-4f)));
+
+		__m256 y = _mm256_set1_ps(1.9875691500e-4f);
+		y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(1.3981999507e-3f));
+		y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(8.3334519073e-3f));
+		y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(4.1665795894e-2f));
+		y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(1.6666665459e-1f));
+		y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(5.0000001201e-1f));
+		y = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(y, x), x), x), _mm256_set1_ps(1.0f));
+
+		__m256i exponent = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvttps_epi32(fx), _mm256_set1_epi32(127)), 23);
+		return _mm256_mul_ps(y, _mm256_castsi256_ps(exponent));
+	}
+
+	TARGET_AVX2 static __m256 LuminanceAVX2(__m256 r, __m256 g, __m256 b)
+	{
+		return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r, _mm256_set1_ps(0.212671f)), _mm256_mul_ps(g, _mm256_set1_ps(0.715160f))), _mm256_mul_ps(b, _mm256_set1_ps(0.072169f)));
+	}
+
+	TARGET_AVX2 static void FilterRowAVX2(const FilterRowArgs& args)
+	{
+		const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 epsilon = _mm256_set1_ps(s_Epsilon);
+		const __m256 sigmaNormal = _mm256_set1_ps(args.SigmaNormal);
+		const __m256 centerWeight = _mm256_set1_ps(s_Kernel[2] * s_Kernel[2]);
+
+		for (uint32_t x = 0; x < args.Count; x += 8)
+		{
+			__m256 rp = _mm256_loadu_ps(args.R + x);
+			__m256 gp = _mm256_loadu_ps(args.G + x);
+			__m256 bp = _mm256_loadu_ps(args.B + x);
+			__m256 vp = _mm256_loadu_ps(args.Variance + x);
+			__m256 nxp = _mm256_loadu_ps(args.NormalX + x);
+			__m256 nyp = _mm256_loadu_ps(args.NormalY + x);
+			__m256 nzp = _mm256_loadu_ps(args.NormalZ + x);
+			__m256 zp = _mm256_loadu_ps(args.Depth + x);
+
+			__m256 lp = LuminanceAVX2(rp, gp, bp);
+			__m256 invSigmaLuminance = _mm256_div_ps(one, _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(args.SigmaLuminance), _mm256_sqrt_ps(_mm256_max_ps(vp, zero))), epsilon));
+			__m256 depthScale = _mm256_mul_ps(_mm256_set1_ps(args.DepthScale), zp);
+			__m256 invSigmaDepth[2] = {
+				_mm256_div_ps(one, _mm256_add_ps(depthScale, epsilon)),
+				_mm256_div_ps(one, _mm256_add_ps(_mm256_mul_ps(depthScale, _mm256_set1_ps(2.0f)), epsilon))
+			};
+
+			__m256 sumWeight = centerWeight;
+			__m256 sumR = _mm256_mul_ps(rp, centerWeight);
+			__m256 sumG = _mm256_mul_ps(gp, centerWeight);
+			__m256 sumB = _mm256_mul_ps(bp, centerWeight);
+			__m256 sumVariance = _mm256_mul_ps(vp, _mm256_mul_ps(centerWeight, centerWeight));
+
+			for (uint32_t tap = 0; tap < s_TapCount; tap++)
+			{
+				int64_t q = (int64_t)x + args.TapOffsets[tap];
+				__m256 rq = _mm256_loadu_ps(args.R + q);
+				__m256 gq = _mm256_loadu_ps(args.G + q);
+				__m256 bq = _mm256_loadu_ps(args.B + q);
+				__m256 zq = _mm256_loadu_ps(args.Depth + q);
+
+				__m256 normalDot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nxp, _mm256_loadu_ps(args.NormalX + q)), _mm256_mul_ps(nyp, _mm256_loadu_ps(args.NormalY + q))), _mm256_mul_ps(nzp, _mm256_loadu_ps(args.NormalZ + q)));
+
+				__m256 exponent = _mm256_mul_ps(_mm256_and_ps(_mm256_sub_ps(lp, LuminanceAVX2(rq, gq, bq)), absMask), invSigmaLuminance);
+				exponent = _mm256_add_ps(exponent, _mm256_mul_ps(_mm256_and_ps(_mm256_sub_ps(zp, zq), absMask), invSigmaDepth[args.TapRings[tap]]));
+				exponent = _mm256_add_ps(exponent, _mm256_mul_ps(sigmaNormal, _mm256_sub_ps(one, _mm256_max_ps(normalDot, zero))));
+
+				__m256 weight = _mm256_mul_ps(_mm256_set1_ps(args.TapWeights[tap]), ExpAVX2(_mm256_sub_ps(zero, exponent)));
+				weight = _mm256_and_ps(weight, _mm256_cmp_ps(zq, zero, _CMP_GT_OQ));
+
+				sumWeight = _mm256_add_ps(sumWeight, weight);
+				sumR = _mm256_add_ps(sumR, _mm256_mul_ps(rq, weight));
+				sumG = _mm256_add_ps(sumG, _mm256_mul_ps(gq, weight));
+				sumB = _mm256_add_ps(sumB, _mm256_mul_ps(bq, weight));
+				sumVariance = _mm256_add_ps(sumVariance, _mm256_mul_ps(_mm256_loadu_ps(args.Variance + q), _mm256_mul_ps(weight, weight)));
+			}
+
+			// Pixels without a hit keep their input
+			__m256 invWeight = _mm256_div_ps(one, sumWeight);
+			__m256 hit = _mm256_cmp_ps(zp, zero, _CMP_GT_OQ);
+			_mm256_storeu_ps(args.OutR + x, _mm256_blendv_ps(rp, _mm256_mul_ps(sumR, invWeight), hit));
+			_mm256_storeu_ps(args.OutG + x, _mm256_blendv_ps(gp, _mm256_mul_ps(sumG, invWeight), hit));
+			_mm256_storeu_ps(args.OutB + x, _mm256_blendv_ps(bp, _mm256_mul_ps(sumB, invWeight), hit));
+			_mm256_storeu_ps(args.OutVariance + x, _mm256_blendv_ps(vp, _mm256_mul_ps(sumVariance, _mm256_mul_ps(invWeight, invWeight)), hit));
+		}
+	}
+#endif
+
+	Denoiser::Denoiser(const DenoiserSpecification& specification)
+		: m_Specification(specification)
+	{
+	}
+
+	void Denoiser::Resize(uint32_t width, uint32_t height)
+	{
+		m_Width = width;
+		m_Height = height;
+
+		uint32_t maxStep = m_Specification.Iterations > 0 ? 1u << (m_Specification.Iterations - 1) : 0;
+		m_Padding = 2 * maxStep + s_MaxLanes;
+		m_Stride = width + 2 * m_Padding;
+
+		size_t paddedSize = (size_t)m_Stride * (height + 2 * m_Padding);
+		for (Planes& planes : m_Planes)
+		{
+			planes.R.assign(paddedSize, 0.0f);
+			planes.G.assign(paddedSize, 0.0f);
+			planes.B.assign(paddedSize, 0.0f);
+			planes.Variance.assign(paddedSize, 0.0f);
+		}
+
+		m_NormalX.assign(paddedSize, 0.0f);
+		m_NormalY.assign(paddedSize, 0.0f);
+		m_NormalZ.assign(paddedSize, 0.0f);
+		m_Depth.assign(paddedSize, 0.0f);
+		m_Albedo.assign((size_t)width * height, glm::vec3(1.0f));
+		m_Output.assign((size_t)width * height, glm::vec4(0.0f));
+	}
+
+	void Denoiser::Prepare(const std::vector<glm::vec4>& image, const std::vector<glm::vec4>& accumulation, const std::vector<glm::vec4>& moments,
+		const std::vector<glm::vec4>& albedo, const std::vector<glm::vec4>& normalDepth)
+	{
+		Planes& planes = m_Planes[0];
+
+		ThreadPool::Get().ParallelFor(m_Height, [&](uint32_t y)
+		{
+			for (uint32_t x = 0; x < m_Width; x++)
+			{
+				size_t pixel = x + (size_t)y * m_Width;
+				size_t padded = (x + m_Padding) + (size_t)(y + m_Padding) * m_Stride;
+
+				glm::vec3 color = glm::vec3(image[pixel]);
+				float depth = normalDepth[pixel].w;
+				if (!(depth > 0.0f))
+				{
+					m_Depth[padded] = 0.0f;
+					planes.R[padded] = color.x;
+					planes.G[padded] = color.y;
+					planes.B[padded] = color.z;
+					planes.Variance[padded] = 0.0f;
+					continue;
+				}
+
+				glm::vec3 demodulation = glm::max(glm::vec3(albedo[pixel]), glm::vec3(s_MinAlbedo));
+				glm::vec3 irradiance = color / demodulation;
+				m_Albedo[pixel] = demodulation;
+
+				// Variance of the pixel mean from the moments (same estimate as PixelError). Without two
+				// accumulated paths it is unknown, then the luminance weight allows the pixel's own luminance.
+				float n = accumulation[pixel].w;
+				float irradianceLuminance = Luminance(irradiance.x, irradiance.y, irradiance.z);
+				float variance = irradianceLuminance * irradianceLuminance;
+				if (n >= 2.0f)
+				{
+					glm::vec3 sum = glm::vec3(accumulation[pixel]);
+					float mean = Luminance(sum.x, sum.y, sum.z) / n;
+					float sampleVariance = glm::max(moments[pixel].x / n - mean * mean, 0.0f) * n / (n - 1.0f);
+					float albedoLuminance = Luminance(demodulation.x, demodulation.y, demodulation.z);
+					variance = sampleVariance / n / (albedoLuminance * albedoLuminance);
+				}
+
+				planes.R[padded] = irradiance.x;
+				planes.G[padded] = irradiance.y;
+				planes.B[padded] = irradiance.z;
+				planes.Variance[padded] = variance;
+
+				glm::vec3 normal = glm::vec3(normalDepth[pixel]);
+				m_NormalX[padded] = normal.x;
+				m_NormalY[padded] = normal.y;
+				m_NormalZ[padded] = normal.z;
+				m_Depth[padded] = depth;
+			}
+		});
+	}
+
+	void Denoiser::FilterRow(uint32_t y, uint32_t step, uint32_t source)
+	{
+		const Planes& input = m_Planes[source];
+		Planes& output = m_Planes[1 - source];
+
+		size_t rowStart = m_Padding + (size_t)(y + m_Padding) * m_Stride;
+
+		FilterRowArgs args;
+		args.R = input.R.data() + rowStart;
+		args.G = input.G.data() + rowStart;
+		args.B = input.B.data() + rowStart;
+		args.Variance = input.Variance.data() + rowStart;
+		args.NormalX = m_NormalX.data() + rowStart;
+		args.NormalY = m_NormalY.data() + rowStart;
+		args.NormalZ = m_NormalZ.data() + rowStart;
+		args.Depth = m_Depth.data() + rowStart;
+		args.OutR = output.R.data() + rowStart;
+		args.OutG = output.G.data() + rowStart;
+		args.OutB = output.B.data() + rowStart;
+		args.OutVariance = output.Variance.data() + rowStart;
+		args.Count = m_Width;
+		args.SigmaLuminance = m_Specification.SigmaLuminance;
+		args.SigmaNormal = m_Specification.SigmaNormal;
+		args.DepthScale = m_Specification.SigmaDepth * (float)step;
+
+		uint32_t tap = 0;
+		for (int32_t dy = -2; dy <= 2; dy++)
+		{
+			for (int32_t dx = -2; dx <= 2; dx++)
+			{
+				if (dx == 0 && dy == 0)
+					continue;
+
+				args.TapOffsets[tap] = ((int64_t)dy * m_Stride + dx) * step;
+				args.TapWeights[tap] = s_Kernel[dx + 2] * s_Kernel[dy + 2];
+				args.TapRings[tap] = glm::max(glm::abs(dx), glm::abs(dy)) - 1;
+				tap++;
+			}
+		}
+
+#if DENOISER_X86
+		if (m_SIMDLevel == SIMDLevel::AVX2)
+			return FilterRowAVX2(args);
+		if (m_SIMDLevel == SIMDLevel::SSE)
+			return FilterRowSSE(args);
+#endif
+		FilterRowScalar(args);
+	}
+
+	void Denoiser::Denoise(const std::vector<glm::vec4>& image, const std::vector<glm::vec4>& accumulation, const std::vector<glm::vec4>& moments,
+		const std::vector<glm::vec4>& albedo, const std::vector<glm::vec4>& normalDepth)
+	{
+		Prepare(image, accumulation, moments, albedo, normalDepth);
+
+		uint32_t source = 0;
+		for (uint32_t iteration = 0; iteration < m_Specification.Iterations; iteration++)
+		{
+			uint32_t step = 1u << iteration;
+			ThreadPool::Get().ParallelFor(m_Height, [&](uint32_t y)
+			{
+				FilterRow(y, step, source);
+			});
+			source = 1 - source;
+		}
+
+		const Planes& result = m_Planes[source];
+		ThreadPool::Get().ParallelFor(m_Height, [&](uint32_t y)
+		{
+			for (uint32_t x = 0; x < m_Width; x++)
+			{
+				size_t pixel = x + (size_t)y * m_Width;
+				size_t padded = (x + m_Padding) + (size_t)(y + m_Padding) * m_Stride;
+
+				glm::vec3 color = glm::vec3(result.R[padded], result.G[padded], result.B[padded]);
+				if (m_Depth[padded] > 0.0f)
+					color *= m_Albedo[pixel];
+
+				m_Output[pixel] = glm::vec4(color, 1.0f);
+			}
+		});
+	}
+
+}
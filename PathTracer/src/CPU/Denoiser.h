@@ -0,0 +1,77 @@
+#pragma once
+#include "CPU/WideBVH.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace CPU {
+
+	struct DenoiserSpecification
+	{
+		// A-trous passes, pass i spaces the 5x5 taps 2^i pixels apart. Five passes cover 125 pixels.
+		uint32_t Iterations = 5;
+
+		// Luminance differences are measured in standard deviations of the pixel's noise
+		float SigmaLuminance = 4.0f;
+
+		// Weight falls off as exp(-SigmaNormal * (1 - dot(n_p, n_q))), close to SVGF's pow(dot, 128)
+		float SigmaNormal = 128.0f;
+
+		// Relative depth change allowed per pixel of tap distance
+		float SigmaDepth = 0.02f;
+	};
+
+	// CPU implementation of Denoise.glsl, an edge-avoiding a-trous wavelet filter (Dammertz et al.
+	// 2010) with the variance guided luminance weight of SVGF (Schied et al. 2017). The image is
+	// divided by the first hit albedo, filtered and multiplied back, so texture detail survives.
+	// Pixels without a first hit (depth 0) are passed through and never used as taps.
+	class Denoiser
+	{
+	public:
+		Denoiser(const DenoiserSpecification& specification = DenoiserSpecification());
+
+		void Resize(uint32_t width, uint32_t height);
+
+		// Inputs in the layouts of o_Image, o_AccumulationImage, o_MomentsImage, o_AlbedoImage and
+		// o_NormalDepthImage (world normal in xyz, first hit distance in w)
+		void Denoise(const std::vector<glm::vec4>& image, const std::vector<glm::vec4>& accumulation, const std::vector<glm::vec4>& moments,
+			const std::vector<glm::vec4>& albedo, const std::vector<glm::vec4>& normalDepth);
+
+		const std::vector<glm::vec4>& GetOutput() const { return m_Output; }
+
+		// Clamped to what the CPU supports, the filter runs 4 (SSE) or 8 (AVX2) pixels of a row at once
+		void SetSIMDLevel(SIMDLevel level) { m_SIMDLevel = (SIMDLevel)glm::min((int)level, (int)GetSupportedSIMDLevel()); }
+		SIMDLevel GetSIMDLevel() const { return m_SIMDLevel; }
+
+		const DenoiserSpecification& GetSpecification() const { return m_Specification; }
+
+	private:
+		void Prepare(const std::vector<glm::vec4>& image, const std::vector<glm::vec4>& accumulation, const std::vector<glm::vec4>& moments,
+			const std::vector<glm::vec4>& albedo, const std::vector<glm::vec4>& normalDepth);
+		void FilterRow(uint32_t y, uint32_t step, uint32_t source);
+
+	private:
+		// Demodulated color and its variance, indexed by padded pixel
+		struct Planes
+		{
+			std::vector<float> R, G, B, Variance;
+		};
+
+		DenoiserSpecification m_Specification;
+		SIMDLevel m_SIMDLevel = GetSupportedSIMDLevel();
+
+		uint32_t m_Width = 0;
+		uint32_t m_Height = 0;
+
+		// Every plane has a border of depth 0 wide enough for the largest step, so taps never need clamping
+		uint32_t m_Padding = 0;
+		uint32_t m_Stride = 0;
+
+		Planes m_Planes[2];
+		std::vector<float> m_NormalX, m_NormalY, m_NormalZ, m_Depth;
+		std::vector<glm::vec3> m_Albedo;
+
+		std::vector<glm::vec4> m_Output;
+	};
+
+}
@@ -0,0 +1,448 @@
+/*
+ * MIT License
+ *
+ * Copyright(c) 2019 Asif Ali
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "CPU/Disney.h"
+#include "CPU/Sampling.h"
+#include <array>
+#include <utility>
+
+namespace CPU {
+
+	static glm::vec3 ToWorld(const glm::vec3& X, const glm::vec3& Y, const glm::vec3& Z, const glm::vec3& V)
+	{
+		return V.x * X + V.y * Y + V.z * Z;
+	}
+
+	static glm::vec3 ToLocal(const glm::vec3& X, const glm::vec3& Y, const glm::vec3& Z, const glm::vec3& V)
+	{
+		return glm::vec3(glm::dot(V, X), glm::dot(V, Y), glm::dot(V, Z));
+	}
+
+	float Luminance(const glm::vec3& c)
+	{
+		return 0.212671f * c.x + 0.715160f * c.y + 0.072169f * c.z;
+	}
+
+	static void TintColors(const Payload& payload, float eta, float& F0, glm::vec3& Csheen, glm::vec3& Cspec0)
+	{
+		float lum = Luminance(payload.Albedo);
+		glm::vec3 ctint = lum > 0.0f ? payload.Albedo / lum : glm::vec3(1.0f);
+
+		F0 = (1.0f - eta) / (1.0f + eta);
+		F0 *= F0;
+
+		Cspec0 = F0 * glm::mix(glm::vec3(1.0f), ctint, payload.SpecularTint);
+		Csheen = glm::mix(glm::vec3(1.0f), ctint, payload.SheenTint);
+	}
+
+	template<uint32_t Lobes>
+	static glm::vec3 EvalDisneyDiffuse(const Payload& payload, const glm::vec3& Csheen, const glm::vec3& V, const glm::vec3& L, const glm::vec3& H, float& pdf)
+	{
+		pdf = 0.0f;
+		if (L.z <= 0.0f)
+			return glm::vec3(0.0f);
+
+		float LDotH = glm::dot(L, H);
+
+		float Rr = 2.0f * payload.Roughness * LDotH * LDotH;
+
+		// Diffuse
+		float FL = SchlickWeight(L.z);
+		float FV = SchlickWeight(V.z);
+		float Fretro = Rr * (FL + FV + FL * FV * (Rr - 1.0f));
+		float Fd = (1.0f - 0.5f * FL) * (1.0f - 0.5f * FV);
+
+		pdf = L.z * INV_PI;
+
+		// Fake subsurface, mixing with a zero weight leaves Fd + Fretro as is
+		float diffuse = Fd + Fretro;
+		if constexpr ((Lobes & LOBE_SUBSURFACE) != 0)
+		{
+			float Fss90 = 0.5f * Rr;
+			float Fss = glm::mix(1.0f, Fss90, FL) * glm::mix(1.0f, Fss90, FV);
+			float ss = 1.25f * (Fss * (1.0f / (L.z + V.z) - 0.5f) + 0.5f);
+			diffuse = glm::mix(Fd + Fretro, ss, payload.Subsurface);
+		}
+
+		// Sheen
+		glm::vec3 Fsheen = glm::vec3(0.0f);
+		if constexpr ((Lobes & LOBE_SHEEN) != 0)
+		{
+			float FH = SchlickWeight(LDotH);
+			Fsheen = FH * payload.Sheen * Csheen;
+		}
+
+		return INV_PI * payload.Albedo * diffuse + Fsheen;
+	}
+
+	static glm::vec3 EvalMicrofacetReflection(const Payload& payload, const glm::vec3& V, const glm::vec3& L, const glm::vec3& H, const glm::vec3& F, float& pdf)
+	{
+		pdf = 0.0f;
+		if (L.z <= 0.0f)
+			return glm::vec3(0.0f);
+
+		float D = GTR2Aniso(H.z, H.x, H.y, payload.ax, payload.ay);
+		float G1 = SmithGAniso(glm::abs(V.z), V.x, V.y, payload.ax, payload.ay);
+		float G2 = G1 * SmithGAniso(glm::abs(L.z), L.x, L.y, payload.ax, payload.ay);
+
+		pdf = G1 * D / (4.0f * V.z);
+		return F * D * G2 / (4.0f * L.z * V.z);
+	}
+
+	static glm::vec3 EvalMicrofacetRefraction(const Payload& payload, float eta, const glm::vec3& V, const glm::vec3& L, const glm::vec3& H, const glm::vec3& F, float& pdf)
+	{
+		pdf = 0.0f;
+		if (L.z >= 0.0f)
+			return glm::vec3(0.0f);
+
+		float LDotH = glm::dot(L, H);
+		float VDotH = glm::dot(V, H);
+
+		float D = GTR2Aniso(H.z, H.x, H.y, payload.ax, payload.ay);
+		float G1 = SmithGAniso(glm::abs(V.z), V.x, V.y, payload.ax, payload.ay);
+		float G2 = G1 * SmithGAniso(glm::abs(L.z), L.x, L.y, payload.ax, payload.ay);
+		float denom = LDotH + VDotH * eta;
+		denom *= denom;
+		float eta2 = eta * eta;
+		float jacobian = glm::abs(LDotH) / denom;
+
+		pdf = G1 * glm::max(0.0f, VDotH) * D * jacobian / V.z;
+		return glm::pow(payload.Albedo, glm::vec3(0.5f)) * (1.0f - F) * D * G2 * glm::abs(VDotH) * jacobian * eta2 / glm::abs(L.z * V.z);
+	}
+
+	static glm::vec3 EvalClearcoat(const Payload& payload, const glm::vec3& V, const glm::vec3& L, const glm::vec3& H, float& pdf)
+	{
+		pdf = 0.0f;
+		if (L.z <= 0.0f)
+			return glm::vec3(0.0f);
+
+		float VDotH = glm::dot(V, H);
+
+		float F = glm::mix(0.04f, 1.0f, SchlickWeight(VDotH));
+		float D = GTR1(H.z, payload.ClearcoatRoughness);
+		float G = SmithG(L.z, 0.25f) * SmithG(V.z, 0.25f);
+		float jacobian = 1.0f / (4.0f * VDotH);
+
+		pdf = D * H.z * jacobian;
+		return glm::vec3(F) * D * G;
+	}
+
+	struct LobeProbabilities
+	{
+		float DielectricWt, MetalWt, GlassWt;
+		float DiffPr, DielectricPr, MetalPr, GlassPr, ClearCtPr;
+	};
+
+	// Lobes missing from the mask have a weight of exactly zero for the material, so leaving them
+	// at zero here gives the same sums as the full model
+	template<uint32_t Lobes>
+	static LobeProbabilities ComputeLobeProbabilities(const Payload& payload, const glm::vec3& Cspec0, float VDotN)
+	{
+		LobeProbabilities p = {};
+
+		// Model weights
+		if constexpr ((Lobes & LOBE_DIFFUSE) != 0)
+			p.DielectricWt = (1.0f - payload.Metallic) * (1.0f - payload.SpecTrans);
+		if constexpr ((Lobes & LOBE_METAL) != 0)
+			p.MetalWt = payload.Metallic;
+		if constexpr ((Lobes & LOBE_GLASS) != 0)
+			p.GlassWt = (1.0f - payload.Metallic) * payload.SpecTrans;
+
+		// Lobe probabilities
+		float schlickWt = SchlickWeight(VDotN);
+
+		if constexpr ((Lobes & LOBE_DIFFUSE) != 0)
+		{
+			p.DiffPr = p.DielectricWt * Luminance(payload.Albedo);
+			p.DielectricPr = p.DielectricWt * Luminance(glm::mix(Cspec0, glm::vec3(1.0f), schlickWt));
+		}
+		if constexpr ((Lobes & LOBE_METAL) != 0)
+			p.MetalPr = p.MetalWt * Luminance(glm::mix(payload.Albedo, glm::vec3(1.0f), schlickWt));
+		if constexpr ((Lobes & LOBE_GLASS) != 0)
+			p.GlassPr = p.GlassWt;
+		if constexpr ((Lobes & LOBE_CLEARCOAT) != 0)
+			p.ClearCtPr = 0.25f * payload.Clearcoat;
+
+		// Normalize probabilities
+		float invTotalWt = 1.0f / (p.DiffPr + p.DielectricPr + p.MetalPr + p.GlassPr + p.ClearCtPr);
+		p.DiffPr *= invTotalWt;
+		p.DielectricPr *= invTotalWt;
+		p.MetalPr *= invTotalWt;
+		p.GlassPr *= invTotalWt;
+		p.ClearCtPr *= invTotalWt;
+
+		return p;
+	}
+
+	template<uint32_t Lobes>
+	static glm::vec3 DisneyEvalLobes(const Payload& payload, glm::vec3 V, const glm::vec3& N, glm::vec3 L, float& pdf)
+	{
+		pdf = 0.0f;
+		glm::vec3 f = glm::vec3(0.0f);
+
+		glm::vec3 T, B;
+		Onb(N, T, B);
+
+		// Transform to shading space to simplify operations (NDotL = L.z; NDotV = V.z; NDotH = H.z)
+		V = ToLocal(T, B, N, V);
+		L = ToLocal(T, B, N, L);
+
+		glm::vec3 H;
+		if (L.z > 0.0f)
+			H = glm::normalize(L + V);
+		else
+			H = glm::normalize(L + V * payload.eta);
+
+		if (H.z < 0.0f)
+			H = -H;
+
+		// Tint colors
+		glm::vec3 Csheen, Cspec0;
+		float F0;
+		TintColors(payload, payload.eta, F0, Csheen, Cspec0);
+
+		LobeProbabilities p = ComputeLobeProbabilities<Lobes>(payload, Cspec0, V.z);
+
+		bool reflect = L.z * V.z > 0.0f;
+
+		float tmpPdf = 0.0f;
+		float VDotH = glm::abs(glm::dot(V, H));
+
+		if constexpr ((Lobes & LOBE_DIFFUSE) != 0)
+		{
+			// Diffuse
+			if (p.DiffPr > 0.0f && reflect)
+			{
+				f += EvalDisneyDiffuse<Lobes>(payload, Csheen, V, L, H, tmpPdf) * p.DielectricWt;
+				pdf += tmpPdf * p.DiffPr;
+			}
+
+			// Dielectric Reflection
+			if (p.DielectricPr > 0.0f && reflect)
+			{
+				// Normalize for interpolating based on Cspec0
+				float F = (DielectricFresnel(VDotH, 1.0f / payload.ior) - F0) / (1.0f - F0);
+
+				f += EvalMicrofacetReflection(payload, V, L, H, glm::mix(Cspec0, glm::vec3(1.0f), F), tmpPdf) * p.DielectricWt;
+				pdf += tmpPdf * p.DielectricPr;
+			}
+		}
+
+		// Metallic Reflection
+		if constexpr ((Lobes & LOBE_METAL) != 0)
+		{
+			if (p.MetalPr > 0.0f && reflect)
+			{
+				// Tinted to base color
+				glm::vec3 F = glm::mix(payload.Albedo, glm::vec3(1.0f), SchlickWeight(VDotH));
+
+				f += EvalMicrofacetReflection(payload, V, L, H, F, tmpPdf) * p.MetalWt;
+				pdf += tmpPdf * p.MetalPr;
+			}
+		}
+
+		// Glass/Specular BSDF
+		if constexpr ((Lobes & LOBE_GLASS) != 0)
+		{
+			if (p.GlassPr > 0.0f)
+			{
+				// Dielectric fresnel (achromatic)
+				float F = DielectricFresnel(VDotH, payload.eta);
+
+				if (reflect)
+				{
+					f += EvalMicrofacetReflection(payload, V, L, H, glm::vec3(F), tmpPdf) * p.GlassWt;
+					pdf += tmpPdf * p.GlassPr * F;
+				}
+				else
+				{
+					f += EvalMicrofacetRefraction(payload, payload.eta, V, L, H, glm::vec3(F), tmpPdf) * p.GlassWt;
+					pdf += tmpPdf * p.GlassPr * (1.0f - F);
+				}
+			}
+		}
+
+		// Clearcoat
+		if constexpr ((Lobes & LOBE_CLEARCOAT) != 0)
+		{
+			if (p.ClearCtPr > 0.0f && reflect)
+			{
+				f += EvalClearcoat(payload, V, L, H, tmpPdf) * 0.25f * payload.Clearcoat;
+				pdf += tmpPdf * p.ClearCtPr;
+			}
+		}
+
+		return f * glm::abs(L.z);
+	}
+
+	template<uint32_t Lobes>
+	static glm::vec3 DisneySampleLobes(const Payload& payload, glm::vec3 V, const glm::vec3& N, glm::vec3& L, float& pdf, const glm::vec3& u)
+	{
+		pdf = 0.0f;
+
+		float r1 = u.x;
+		float r2 = u.y;
+
+		glm::vec3 T, B;
+		Onb(N, T, B);
+
+		// Transform to shading space to simplify operations (NDotL = L.z; NDotV = V.z; NDotH = H.z)
+		V = ToLocal(T, B, N, V);
+
+		// Tint colors
+		glm::vec3 Csheen, Cspec0;
+		float F0;
+		TintColors(payload, payload.eta, F0, Csheen, Cspec0);
+
+		LobeProbabilities p = ComputeLobeProbabilities<Lobes>(payload, Cspec0, V.z);
+
+		// CDF of the sampling probabilities
+		float cdf[5];
+		cdf[0] = p.DiffPr;
+		cdf[1] = cdf[0] + p.DielectricPr;
+		cdf[2] = cdf[1] + p.MetalPr;
+		cdf[3] = cdf[2] + p.GlassPr;
+		cdf[4] = cdf[3] + p.ClearCtPr;
+
+		// Sample a lobe based on its importance. The intervals of missing lobes are empty, so their
+		// branches are dropped. Clearcoat stays as the fallback for r3 rounding past cdf[3].
+		float r3 = u.z;
+
+		constexpr bool diffuse = (Lobes & LOBE_DIFFUSE) != 0;
+		constexpr bool reflection = (Lobes & (LOBE_DIFFUSE | LOBE_METAL)) != 0;
+		constexpr bool glass = (Lobes & LOBE_GLASS) != 0;
+
+		if (diffuse && r3 < cdf[0]) // Diffuse
+		{
+			L = CosineSampleHemisphere(r1, r2);
+		}
+		else if (reflection && r3 < cdf[2]) // Dielectric + Metallic reflection
+		{
+			glm::vec3 H = SampleGGXVNDF(V, payload.ax, payload.ay, r1, r2);
+
+			if (H.z < 0.0f)
+				H = -H;
+
+			L = glm::normalize(glm::reflect(-V, H));
+		}
+		else if (glass && r3 < cdf[3]) // Glass
+		{
+			glm::vec3 H = SampleGGXVNDF(V, payload.ax, payload.ay, r1, r2);
+			float F = DielectricFresnel(glm::abs(glm::dot(V, H)), payload.eta);
+
+			if (H.z < 0.0f)
+				H = -H;
+
+			// Rescale random number for reuse
+			r3 = (r3 - cdf[2]) / (cdf[3] - cdf[2]);
+
+			// Reflection
+			if (r3 < F)
+				L = glm::normalize(glm::reflect(-V, H));
+			else // Transmission
+				L = glm::normalize(glm::refract(-V, H, payload.eta));
+		}
+		else // Clearcoat
+		{
+			glm::vec3 H = SampleGTR1(payload.ClearcoatRoughness, r1, r2);
+
+			if (H.z < 0.0f)
+				H = -H;
+
+			L = glm::normalize(glm::reflect(-V, H));
+		}
+
+		L = ToWorld(T, B, N, L);
+		V = ToWorld(T, B, N, V);
+
+		return DisneyEvalLobes<Lobes>(payload, V, N, L, pdf);
+	}
+
+	using SampleFunction = glm::vec3(*)(const Payload&, glm::vec3, const glm::vec3&, glm::vec3&, float&, const glm::vec3&);
+	using EvalFunction = glm::vec3(*)(const Payload&, glm::vec3, const glm::vec3&, glm::vec3, float&);
+
+	// One instantiation per lobe mask, indexed by Payload::Lobes
+	template<uint32_t... Masks>
+	static constexpr std::array<SampleFunction, sizeof...(Masks)> MakeSampleVariants(std::integer_sequence<uint32_t, Masks...>)
+	{
+		return { &DisneySampleLobes<Masks>... };
+	}
+
+	template<uint32_t... Masks>
+	static constexpr std::array<EvalFunction, sizeof...(Masks)> MakeEvalVariants(std::integer_sequence<uint32_t, Masks...>)
+	{
+		return { &DisneyEvalLobes<Masks>... };
+	}
+
+	static constexpr std::array<SampleFunction, LOBE_ALL + 1> s_SampleVariants = MakeSampleVariants(std::make_integer_sequence<uint32_t, LOBE_ALL + 1>());
+	static constexpr std::array<EvalFunction, LOBE_ALL + 1> s_EvalVariants = MakeEvalVariants(std::make_integer_sequence<uint32_t, LOBE_ALL + 1>());
+
+	uint32_t ClassifyMaterial(const VkLibrary::MaterialBuffer& material)
+	{
+		// Metallic is the value times the metallic roughness texture on the GPU, so a texture can
+		// only bring it down from the value
+		float metallic = material.data.MetallicValue;
+		bool metal = metallic != 0.0f;
+		bool nonMetal = metallic != 1.0f || material.data.MetallicRoughnessMapIndex != -1;
+
+		uint32_t lobes = 0;
+		if (nonMetal && material.SpecTrans != 1.0f)
+		{
+			lobes |= LOBE_DIFFUSE;
+			if (material.Sheen != 0.0f)
+				lobes |= LOBE_SHEEN;
+			if (material.Subsurface != 0.0f)
+				lobes |= LOBE_SUBSURFACE;
+		}
+
+		if (metal)
+			lobes |= LOBE_METAL;
+		if (nonMetal && material.SpecTrans != 0.0f)
+			lobes |= LOBE_GLASS;
+		if (material.Clearcoat != 0.0f)
+			lobes |= LOBE_CLEARCOAT;
+
+		return lobes;
+	}
+
+	glm::vec3 DisneySample(const Payload& payload, glm::vec3 V, const glm::vec3& N, glm::vec3& L, float& pdf, const glm::vec3& u)
+	{
+		return s_SampleVariants[payload.Lobes & LOBE_ALL](payload, V, N, L, pdf, u);
+	}
+
+	glm::vec3 DisneySample(const Payload& payload, glm::vec3 V, const glm::vec3& N, glm::vec3& L, float& pdf, uint32_t& seed)
+	{
+		glm::vec3 u;
+		u.x = RandomValue(seed);
+		u.y = RandomValue(seed);
+		u.z = RandomValue(seed);
+		return DisneySample(payload, V, N, L, pdf, u);
+	}
+
+	glm::vec3 DisneyEval(const Payload& payload, glm::vec3 V, const glm::vec3& N, glm::vec3 L, float& pdf)
+	{
+		return s_EvalVariants[payload.Lobes & LOBE_ALL](payload, V, N, L, pdf);
+	}
+
+}
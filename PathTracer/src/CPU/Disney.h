@@ -0,0 +1,23 @@
+#pragma once
+#include "CPU/Globals.h"
+#include "Graphics/Mesh.h"
+
+// CPU mirror of assets/shaders/RayTracing/Disney.glsl, kept line-for-line comparable
+// so that CPU and GPU renders of the same scene converge to the same image.
+
+namespace CPU {
+
+	float Luminance(const glm::vec3& c);
+
+	// Lobes with a nonzero weight anywhere on the material, textures included. Conservative, a
+	// lobe is only left out when the full model would give it a weight of exactly zero.
+	uint32_t ClassifyMaterial(const VkLibrary::MaterialBuffer& material);
+
+	// Both run the variant compiled for payload.Lobes, which matches the full model (LOBE_ALL)
+	// for any material whose ClassifyMaterial mask it covers. u.xy picks the direction and u.z the
+	// lobe, the seed overload draws them in that order.
+	glm::vec3 DisneySample(const Payload& payload, glm::vec3 V, const glm::vec3& N, glm::vec3& L, float& pdf, const glm::vec3& u);
+	glm::vec3 DisneySample(const Payload& payload, glm::vec3 V, const glm::vec3& N, glm::vec3& L, float& pdf, uint32_t& seed);
+	glm::vec3 DisneyEval(const Payload& payload, glm::vec3 V, const glm::vec3& N, glm::vec3 L, float& pdf);
+
+}
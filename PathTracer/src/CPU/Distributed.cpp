@@ -0,0 +1,662 @@
+#include "CPU/Distributed.h"
+#include "CPU/CompiledScene.h"
+#include "CPU/ThreadPool.h"
+#include "CPU/TiledRenderer.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+using namespace VkLibrary;
+
+namespace CPU {
+
+	// Messages are a header followed by Size bytes of payload. Both sides are assumed to be little endian
+	// builds of the same source, the payload structs are sent as they are.
+	static constexpr uint32_t s_Magic = 0x52445450; // "PTDR"
+	static constexpr uint32_t s_ProtocolVersion = 2;
+	static constexpr size_t s_MaxPathLength = 260;
+
+	enum class MessageType : uint32_t
+	{
+		Hello, Job, Unit, Result, Shutdown
+	};
+
+	struct MessageHeader
+	{
+		uint32_t Magic = s_Magic;
+		MessageType Type = MessageType::Hello;
+		uint64_t Size = 0;
+	};
+
+	// Worker -> coordinator after connecting
+	struct HelloMessage
+	{
+		uint32_t Version = s_ProtocolVersion;
+		uint32_t ThreadCount = 0;
+	};
+
+	// Coordinator -> worker before the units of a job
+	struct JobMessage
+	{
+		uint32_t JobIndex = 0;
+		char ModelPath[s_MaxPathLength] = {};
+		char EnvironmentPath[s_MaxPathLength] = {};
+		float Scale = 1.0f;
+		uint32_t CompiledScene = 0;
+
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t Seed = 0;
+		uint32_t SamplesPerPixel = 0;
+		uint32_t MaxBounces = 0;
+		uint32_t NextEventEstimation = 0;
+		uint32_t EnvironmentSampling = 0;
+		uint32_t Sampler = 0;
+		glm::vec3 SkyColor = glm::vec3(0.0f);
+
+		uint32_t TileSize = 0;
+		CameraBuffer Camera;
+	};
+
+	struct UnitMessage
+	{
+		uint32_t JobIndex = 0;
+		uint32_t Unit = 0;
+		uint32_t Tile = 0;
+		uint32_t FirstFrame = 0;
+		uint32_t FrameCount = 0;
+	};
+
+	// Followed by the tile's sum + path count pixels
+	struct ResultMessage
+	{
+		uint32_t JobIndex = 0;
+		uint32_t Unit = 0;
+		uint64_t SampleCount = 0;
+	};
+
+	static bool WriteMessage(Socket& socket, MessageType type, const void* data, size_t size, const void* payload = nullptr, size_t payloadSize = 0)
+	{
+		MessageHeader header;
+		header.Type = type;
+		header.Size = size + payloadSize;
+		return socket.Send(&header, sizeof(MessageHeader)) && socket.Send(data, size) && (payloadSize == 0 || socket.Send(payload, payloadSize));
+	}
+
+	static bool ReadHeader(Socket& socket, MessageHeader& header)
+	{
+		return socket.Receive(&header, sizeof(MessageHeader)) && header.Magic == s_Magic;
+	}
+
+	static bool SkipPayload(Socket& socket, uint64_t size)
+	{
+		char buffer[4096];
+		while (size > 0)
+		{
+			size_t chunk = (size_t)std::min<uint64_t>(size, sizeof(buffer));
+			if (!socket.Receive(buffer, chunk))
+				return false;
+			size -= chunk;
+		}
+		return true;
+	}
+
+	// Only the leading struct, for messages whose payload continues with data the caller reads itself
+	template<typename T>
+	static bool ReadLeadingPayload(Socket& socket, const MessageHeader& header, T& message)
+	{
+		return header.Size >= sizeof(T) && socket.Receive(&message, sizeof(T));
+	}
+
+	// The whole payload, anything past T is skipped so the next header is read from the right place
+	template<typename T>
+	static bool ReadPayload(Socket& socket, const MessageHeader& header, T& message)
+	{
+		return ReadLeadingPayload(socket, header, message) && SkipPayload(socket, header.Size - sizeof(T));
+	}
+
+	static void CopyPath(char* destination, const std::string& path)
+	{
+		strncpy(destination, path.c_str(), s_MaxPathLength - 1);
+		destination[s_MaxPathLength - 1] = '\0';
+	}
+
+	// Same tiling as RenderCheckpoint
+	static uint32_t GetTileCount(uint32_t width, uint32_t height, uint32_t tileSize)
+	{
+		return ((width + tileSize - 1) / tileSize) * ((height + tileSize - 1) / tileSize);
+	}
+
+	static void GetTileRect(uint32_t tile, uint32_t width, uint32_t height, uint32_t tileSize, glm::uvec2& offset, glm::uvec2& size)
+	{
+		uint32_t tilesX = (width + tileSize - 1) / tileSize;
+		offset = glm::uvec2(tile % tilesX, tile / tilesX) * tileSize;
+		size = glm::uvec2(glm::min(tileSize, width - offset.x), glm::min(tileSize, height - offset.y));
+	}
+
+	static double SecondsBetween(std::chrono::high_resolution_clock::time_point start, std::chrono::high_resolution_clock::time_point end)
+	{
+		return std::chrono::duration<double>(end - start).count();
+	}
+
+	RenderCoordinator::RenderCoordinator(const RenderCoordinatorSpecification& specification)
+		: m_Specification(specification)
+	{
+	}
+
+	RenderCoordinator::~RenderCoordinator()
+	{
+		Shutdown();
+	}
+
+	bool RenderCoordinator::Listen()
+	{
+		return m_Listener.Listen(m_Specification.Port);
+	}
+
+	bool RenderCoordinator::Accept()
+	{
+		Worker worker;
+		if (!m_Listener.Accept(worker.Connection))
+			return false;
+
+		// A worker that connects but never says hello shouldn't block the coordinator
+		worker.Connection.SetReceiveTimeout(m_Specification.WorkerTimeout);
+
+		MessageHeader header;
+		HelloMessage hello;
+		if (!ReadHeader(worker.Connection, header) || header.Type != MessageType::Hello || !ReadPayload(worker.Connection, header, hello) ||
+			hello.Version != s_ProtocolVersion)
+			return false;
+
+		WorkerStatistics statistics;
+		statistics.ThreadCount = hello.ThreadCount;
+		statistics.Connected = true;
+
+		worker.LastMessage = Clock::now();
+		m_Workers.push_back(std::move(worker));
+		m_Statistics.push_back(statistics);
+		return true;
+	}
+
+	bool RenderCoordinator::WaitForWorkers(uint32_t count, float timeout)
+	{
+		Clock::time_point start = Clock::now();
+		while (GetConnectedWorkerCount() < count)
+		{
+			float remaining = timeout - (float)SecondsBetween(start, Clock::now());
+			if (remaining <= 0.0f)
+				return false;
+
+			std::vector<bool> readable;
+			if (Socket::Poll({ &m_Listener }, remaining, readable) && readable[0])
+				Accept();
+		}
+		return true;
+	}
+
+	uint32_t RenderCoordinator::GetConnectedWorkerCount() const
+	{
+		uint32_t count = 0;
+		for (const Worker& worker : m_Workers)
+			count += worker.Connection.IsOpen() ? 1 : 0;
+		return count;
+	}
+
+	void RenderCoordinator::Assign(Worker& worker, uint32_t unitIndex, uint32_t jobIndex)
+	{
+		Unit& unit = m_Units[unitIndex];
+
+		UnitMessage message;
+		message.JobIndex = jobIndex;
+		message.Unit = unitIndex;
+		message.Tile = unit.Tile;
+		message.FirstFrame = unit.FirstFrame;
+		message.FrameCount = unit.FrameCount;
+
+		// The timeout counts from when the worker has something to return
+		if (worker.Units.empty())
+			worker.LastMessage = Clock::now();
+		if (unit.Assignments == 0)
+			unit.StartTime = Clock::now();
+
+		worker.Units.push_back(unitIndex);
+		unit.Assignments++;
+
+		// A failed send leaves the unit with the worker, it's handed out again when the worker is dropped
+		if (!WriteMessage(worker.Connection, MessageType::Unit, &message, sizeof(UnitMessage)))
+			worker.Connection.Close();
+	}
+
+	void RenderCoordinator::Drop(uint32_t workerIndex)
+	{
+		Worker& worker = m_Workers[workerIndex];
+		worker.Connection.Close();
+		m_Statistics[workerIndex].Connected = false;
+
+		for (uint32_t unitIndex : worker.Units)
+		{
+			Unit& unit = m_Units[unitIndex];
+			unit.Assignments--;
+			if (unit.Assignments == 0 && !unit.Done)
+			{
+				m_Pending.push_front(unitIndex);
+				m_ReassignedUnitCount++;
+			}
+		}
+		worker.Units.clear();
+	}
+
+	bool RenderCoordinator::Render(const DistributedJobSpecification& job, std::vector<glm::vec4>& accumulation, uint32_t maxWorkers)
+	{
+		const PathTracerSpecification& spec = job.PathTracerSpec;
+		uint32_t jobIndex = ++m_JobIndex;
+		m_ReassignedUnitCount = 0;
+
+		JobMessage jobMessage;
+		jobMessage.JobIndex = jobIndex;
+		CopyPath(jobMessage.ModelPath, job.Scene.ModelPath);
+		CopyPath(jobMessage.EnvironmentPath, job.Scene.EnvironmentPath);
+		jobMessage.Scale = job.Scene.Scale;
+		jobMessage.CompiledScene = job.Scene.CompiledScene ? 1 : 0;
+		jobMessage.Width = spec.Width;
+		jobMessage.Height = spec.Height;
+		jobMessage.Seed = spec.Seed;
+		jobMessage.SamplesPerPixel = spec.SamplesPerPixel;
+		jobMessage.MaxBounces = spec.MaxBounces;
+		jobMessage.NextEventEstimation = spec.NextEventEstimation ? 1 : 0;
+		jobMessage.EnvironmentSampling = spec.EnvironmentSampling ? 1 : 0;
+		jobMessage.Sampler = (uint32_t)spec.Sampler;
+		jobMessage.SkyColor = spec.SkyColor;
+		jobMessage.TileSize = job.TileSize;
+		jobMessage.Camera = job.Camera;
+
+		uint32_t tileCount = ((spec.Width + job.TileSize - 1) / job.TileSize) * ((spec.Height + job.TileSize - 1) / job.TileSize);
+		m_Units.clear();
+		m_Pending.clear();
+		for (uint32_t tile = 0; tile < tileCount; tile++)
+		{
+			for (uint32_t firstFrame = 0; firstFrame < job.Frames; firstFrame += job.FramesPerUnit)
+			{
+				Unit unit;
+				unit.Tile = tile;
+				unit.FirstFrame = firstFrame;
+				unit.FrameCount = glm::min(job.FramesPerUnit, job.Frames - firstFrame);
+				m_Pending.push_back((uint32_t)m_Units.size());
+				m_Units.push_back(unit);
+			}
+		}
+
+		accumulation.assign((size_t)spec.Width * spec.Height, glm::vec4(0.0f));
+
+		// Workers of earlier jobs can still be busy with units nobody waits for anymore, their results are skipped
+		std::vector<uint32_t> participants;
+		auto join = [&](uint32_t workerIndex)
+		{
+			Worker& worker = m_Workers[workerIndex];
+			worker.Units.clear();
+			m_Statistics[workerIndex].UnitCount = 0;
+			m_Statistics[workerIndex].SampleCount = 0;
+			if (WriteMessage(worker.Connection, MessageType::Job, &jobMessage, sizeof(JobMessage)))
+				participants.push_back(workerIndex);
+			else
+				Drop(workerIndex);
+		};
+
+		for (uint32_t i = 0; i < (uint32_t)m_Workers.size(); i++)
+		{
+			if (m_Workers[i].Connection.IsOpen() && (maxWorkers == 0 || participants.size() < maxWorkers))
+				join(i);
+		}
+
+		size_t remaining = m_Units.size();
+		Clock::time_point lastConnected = Clock::now();
+		double unitSeconds = 0.0;
+		uint32_t finishedUnits = 0;
+
+		std::vector<glm::vec4> pixels;
+		std::vector<Socket*> sockets;
+		std::vector<bool> readable;
+		while (remaining > 0)
+		{
+			Clock::time_point now = Clock::now();
+			double averageUnitSeconds = finishedUnits > 0 ? unitSeconds / finishedUnits : 0.0;
+
+			// Keep every worker UnitsInFlight units deep
+			bool anyConnected = false;
+			for (uint32_t workerIndex : participants)
+			{
+				Worker& worker = m_Workers[workerIndex];
+				while (worker.Connection.IsOpen() && worker.Units.size() < m_Specification.UnitsInFlight)
+				{
+					if (!m_Pending.empty())
+					{
+						uint32_t unit = m_Pending.front();
+						m_Pending.pop_front();
+						Assign(worker, unit, jobIndex);
+						continue;
+					}
+
+					// Nothing left to hand out, give the slowest running unit to this worker as well
+					uint32_t straggler = ~0u;
+					double longestSeconds = averageUnitSeconds * m_Specification.StragglerFactor;
+					for (uint32_t i = 0; i < (uint32_t)m_Units.size() && finishedUnits > 0; i++)
+					{
+						const Unit& unit = m_Units[i];
+						if (unit.Done || unit.Assignments != 1 || std::find(worker.Units.begin(), worker.Units.end(), i) != worker.Units.end())
+							continue;
+
+						double seconds = SecondsBetween(unit.StartTime, now);
+						if (seconds > longestSeconds)
+						{
+							longestSeconds = seconds;
+							straggler = i;
+						}
+					}
+
+					if (straggler == ~0u)
+						break;
+
+					Assign(worker, straggler, jobIndex);
+					m_ReassignedUnitCount++;
+				}
+
+				if (!worker.Connection.IsOpen())
+					Drop(workerIndex);
+				anyConnected |= worker.Connection.IsOpen();
+			}
+
+			// Lost every worker and no one took over
+			if (anyConnected)
+				lastConnected = now;
+			else if (SecondsBetween(lastConnected, now) > m_Specification.WorkerTimeout)
+				return false;
+
+			// Workers can also join while the job is running
+			sockets.clear();
+			sockets.push_back(&m_Listener);
+			for (uint32_t workerIndex : participants)
+				sockets.push_back(&m_Workers[workerIndex].Connection);
+
+			if (!Socket::Poll(sockets, 0.1f, readable))
+				readable.assign(sockets.size(), false);
+
+			// Hung workers keep their connection open, only their silence gives them away. Workers with a
+			// message waiting were only held up by the coordinator.
+			now = Clock::now();
+			for (size_t i = 1; i < readable.size(); i++)
+			{
+				uint32_t workerIndex = participants[i - 1];
+				Worker& worker = m_Workers[workerIndex];
+				if (!readable[i] && worker.Connection.IsOpen() && !worker.Units.empty() && SecondsBetween(worker.LastMessage, now) > m_Specification.WorkerTimeout)
+					Drop(workerIndex);
+			}
+
+			if (readable[0] && Accept() && (maxWorkers == 0 || participants.size() < maxWorkers))
+				join((uint32_t)m_Workers.size() - 1);
+
+			for (size_t i = 1; i < readable.size(); i++)
+			{
+				uint32_t workerIndex = participants[i - 1];
+				Worker& worker = m_Workers[workerIndex];
+				if (!readable[i])
+					continue;
+
+				MessageHeader header;
+				ResultMessage result;
+				if (!ReadHeader(worker.Connection, header) || header.Type != MessageType::Result || !ReadLeadingPayload(worker.Connection, header, result))
+				{
+					Drop(workerIndex);
+					continue;
+				}
+
+				uint64_t pixelBytes = header.Size - sizeof(ResultMessage);
+				worker.LastMessage = Clock::now();
+
+				if (result.JobIndex != jobIndex || result.Unit >= m_Units.size())
+				{
+					if (!SkipPayload(worker.Connection, pixelBytes))
+						Drop(workerIndex);
+					continue;
+				}
+
+				Unit& unit = m_Units[result.Unit];
+				glm::uvec2 offset, size;
+				GetTileRect(unit.Tile, spec.Width, spec.Height, job.TileSize, offset, size);
+
+				pixels.resize((size_t)size.x * size.y);
+				if (pixelBytes != pixels.size() * sizeof(glm::vec4) || !worker.Connection.Receive(pixels.data(), pixelBytes))
+				{
+					Drop(workerIndex);
+					continue;
+				}
+
+				auto it = std::find(worker.Units.begin(), worker.Units.end(), result.Unit);
+				if (it != worker.Units.end())
+				{
+					worker.Units.erase(it);
+					unit.Assignments--;
+				}
+
+				m_Statistics[workerIndex].UnitCount++;
+				m_Statistics[workerIndex].SampleCount += result.SampleCount;
+
+				// The other copy of a reassigned unit rendered the same paths
+				if (unit.Done)
+					continue;
+
+				for (uint32_t y = 0; y < size.y; y++)
+				{
+					glm::vec4* row = accumulation.data() + (size_t)(offset.y + y) * spec.Width + offset.x;
+					for (uint32_t x = 0; x < size.x; x++)
+						row[x] += pixels[(size_t)y * size.x + x];
+				}
+
+				unit.Done = true;
+				unitSeconds += SecondsBetween(unit.StartTime, worker.LastMessage);
+				finishedUnits++;
+				remaining--;
+			}
+
+		}
+
+		return true;
+	}
+
+	void RenderCoordinator::Shutdown()
+	{
+		for (uint32_t i = 0; i < (uint32_t)m_Workers.size(); i++)
+		{
+			Worker& worker = m_Workers[i];
+			if (worker.Connection.IsOpen())
+				WriteMessage(worker.Connection, MessageType::Shutdown, nullptr, 0);
+
+			worker.Connection.Close();
+			m_Statistics[i].Connected = false;
+		}
+	}
+
+	RenderWorker::RenderWorker(const RenderWorkerSpecification& specification)
+		: m_Specification(specification)
+	{
+	}
+
+	bool RenderWorker::Connect()
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		while (!m_Connection.Connect(m_Specification.Host, m_Specification.Port))
+		{
+			if (SecondsBetween(start, std::chrono::high_resolution_clock::now()) > m_Specification.ConnectTimeout)
+				return false;
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(250));
+		}
+
+		HelloMessage hello;
+		hello.ThreadCount = ThreadPool::Get().GetThreadCount();
+		return WriteMessage(m_Connection, MessageType::Hello, &hello, sizeof(HelloMessage));
+	}
+
+	bool RenderWorker::LoadJob(const DistributedJobSpecification& job)
+	{
+		const DistributedSceneSpecification& scene = job.Scene;
+		bool sceneChanged = !m_Scene || scene.ModelPath != m_SceneSpec.ModelPath || scene.Scale != m_SceneSpec.Scale || scene.CompiledScene != m_SceneSpec.CompiledScene;
+		bool environmentChanged = !m_Scene || scene.EnvironmentPath != m_SceneSpec.EnvironmentPath;
+
+		if (sceneChanged)
+		{
+			m_Scene = nullptr;
+			glm::mat4 transform = glm::scale(glm::mat4(1.0f), glm::vec3(scene.Scale));
+			if (scene.CompiledScene)
+			{
+				CompiledSceneSpecification compiledSpec;
+				compiledSpec.SourcePath = scene.ModelPath;
+				CompiledScene compiledScene(compiledSpec);
+				if (!compiledScene.IsValid())
+					return false;
+
+				m_Scene = CreateRef<Scene>(compiledScene, transform);
+			}
+			else
+			{
+				Ref<MeshSource> meshSource = CreateRef<MeshSource>(scene.ModelPath);
+				m_Scene = CreateRef<Scene>(meshSource, transform);
+			}
+			m_SceneLoadCount++;
+		}
+
+		if (environmentChanged)
+		{
+			m_Environment = nullptr;
+			if (!scene.EnvironmentPath.empty())
+			{
+				EnvironmentMapSpecification environmentSpec;
+				environmentSpec.Path = scene.EnvironmentPath;
+				m_Environment = CreateRef<EnvironmentMap>(environmentSpec);
+				if (!m_Environment->IsValid())
+				{
+					m_Scene = nullptr;
+					return false;
+				}
+			}
+		}
+		m_SceneSpec = scene;
+
+		// Rebuilding the path tracer is cheap next to the scene, it's resized to every unit's tile anyway
+		PathTracerSpecification spec;
+		spec.Width = job.TileSize;
+		spec.Height = job.TileSize;
+		spec.Seed = job.PathTracerSpec.Seed;
+		spec.SamplesPerPixel = job.PathTracerSpec.SamplesPerPixel;
+		spec.MaxBounces = job.PathTracerSpec.MaxBounces;
+		spec.NextEventEstimation = job.PathTracerSpec.NextEventEstimation;
+		spec.EnvironmentSampling = job.PathTracerSpec.EnvironmentSampling;
+		spec.Sampler = job.PathTracerSpec.Sampler;
+		spec.SkyColor = job.PathTracerSpec.SkyColor;
+		spec.Environment = m_Environment;
+		m_PathTracer = CreateRef<PathTracer>(spec, m_Scene);
+
+		m_Job = job;
+		return true;
+	}
+
+	bool RenderWorker::Run()
+	{
+		while (true)
+		{
+			MessageHeader header;
+			if (!ReadHeader(m_Connection, header))
+				return false;
+
+			if (header.Type == MessageType::Shutdown)
+			{
+				m_Connection.Close();
+				return true;
+			}
+
+			if (header.Type == MessageType::Job)
+			{
+				JobMessage message;
+				if (!ReadPayload(m_Connection, header, message))
+					return false;
+
+				// Every tile is at least one pixel, a zero tile size would divide by zero in GetTileRect
+				if (message.TileSize == 0)
+					return false;
+
+				// Paths at the maximum length arrive without a terminator
+				message.ModelPath[s_MaxPathLength - 1] = '\0';
+				message.EnvironmentPath[s_MaxPathLength - 1] = '\0';
+
+				DistributedJobSpecification job;
+				job.Scene.ModelPath = message.ModelPath;
+				job.Scene.EnvironmentPath = message.EnvironmentPath;
+				job.Scene.Scale = message.Scale;
+				job.Scene.CompiledScene = message.CompiledScene != 0;
+				job.PathTracerSpec.Width = message.Width;
+				job.PathTracerSpec.Height = message.Height;
+				job.PathTracerSpec.Seed = message.Seed;
+				job.PathTracerSpec.SamplesPerPixel = message.SamplesPerPixel;
+				job.PathTracerSpec.MaxBounces = message.MaxBounces;
+				job.PathTracerSpec.NextEventEstimation = message.NextEventEstimation != 0;
+				job.PathTracerSpec.EnvironmentSampling = message.EnvironmentSampling != 0;
+				job.PathTracerSpec.Sampler = (SamplerType)message.Sampler;
+				job.PathTracerSpec.SkyColor = message.SkyColor;
+				job.TileSize = message.TileSize;
+				job.Camera = message.Camera;
+
+				// The coordinator hands the units to the other workers when this one disconnects
+				if (!LoadJob(job))
+				{
+					m_Connection.Close();
+					return false;
+				}
+
+				m_JobIndex = message.JobIndex;
+				continue;
+			}
+
+			if (header.Type != MessageType::Unit)
+				return false;
+
+			UnitMessage unit;
+			if (!ReadPayload(m_Connection, header, unit) || unit.JobIndex != m_JobIndex || !m_PathTracer)
+				return false;
+
+			// A tile past the image would underflow the tile size and resize the path tracer to billions of pixels
+			const PathTracerSpecification& spec = m_Job.PathTracerSpec;
+			if (unit.Tile >= GetTileCount(spec.Width, spec.Height, m_Job.TileSize))
+				return false;
+
+			glm::uvec2 offset, size;
+			GetTileRect(unit.Tile, spec.Width, spec.Height, m_Job.TileSize, offset, size);
+			CameraBuffer tileCamera = CropCamera(m_Job.Camera, offset, size, spec.Width, spec.Height);
+
+			// Resizing clears the accumulation, frame indices start at 2 so the first frame's paths are kept
+			m_PathTracer->Resize(size.x, size.y);
+			m_PathTracer->SetSeed(TileSeed(spec.Seed, unit.Tile));
+
+			ResultMessage result;
+			result.JobIndex = unit.JobIndex;
+			result.Unit = unit.Unit;
+			for (uint32_t frame = 0; frame < unit.FrameCount; frame++)
+			{
+				m_PathTracer->Render(tileCamera, unit.FirstFrame + frame + 2);
+				result.SampleCount += m_PathTracer->GetLastSampleCount();
+			}
+
+			const std::vector<glm::vec4>& pixels = m_PathTracer->GetAccumulationBuffer();
+			if (!WriteMessage(m_Connection, MessageType::Result, &result, sizeof(ResultMessage), pixels.data(), pixels.size() * sizeof(glm::vec4)))
+				return false;
+
+			m_UnitCount++;
+			if (m_Specification.MaxUnits > 0 && m_UnitCount >= m_Specification.MaxUnits)
+			{
+				m_Connection.Close();
+				return true;
+			}
+		}
+	}
+
+}
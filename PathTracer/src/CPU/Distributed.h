@@ -0,0 +1,173 @@
+#pragma once
+#include "CPU/PathTracer.h"
+#include "Util/Socket.h"
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace CPU {
+
+	// Scene every worker loads from its own copy of the assets, the paths are sent as they are
+	struct DistributedSceneSpecification
+	{
+		std::string ModelPath = "assets/models/CornellBox.gltf";
+		std::string EnvironmentPath;
+		float Scale = 0.1f;
+		bool CompiledScene = false;
+	};
+
+	struct DistributedJobSpecification
+	{
+		DistributedSceneSpecification Scene;
+
+		// Width and Height are of the whole frame. Seed, SamplesPerPixel, MaxBounces, NextEventEstimation,
+		// EnvironmentSampling and SkyColor are sent to the workers, the rest is left at their defaults.
+		PathTracerSpecification PathTracerSpec;
+		CameraBuffer Camera;
+
+		uint32_t Frames = 16;
+
+		// Work is handed out in units of FramesPerUnit frames of one tile
+		uint32_t TileSize = 128;
+		uint32_t FramesPerUnit = 4;
+	};
+
+	struct RenderCoordinatorSpecification
+	{
+		uint16_t Port = 7878;
+
+		// Units queued on every worker, so the next one is there when a result is sent back
+		uint32_t UnitsInFlight = 2;
+
+		// A worker that has work but hasn't returned anything for this long is dropped and its units
+		// are handed out again
+		float WorkerTimeout = 60.0f;
+
+		// Once every unit has been handed out, units that have been running StragglerFactor times the
+		// average unit time are handed to idle workers as well and the first result is kept
+		float StragglerFactor = 3.0f;
+	};
+
+	struct WorkerStatistics
+	{
+		uint32_t ThreadCount = 0;
+		uint32_t UnitCount = 0;
+		uint64_t SampleCount = 0;
+		bool Connected = false;
+	};
+
+	// Renders a frame on worker processes connected over TCP, see RenderWorker. The frame is split into
+	// units of FramesPerUnit frames of one tile. A unit renders frame indices first + 2 onwards on a cleared
+	// buffer with the TileSeed of the tile, so its result only depends on the unit, not on the worker or on
+	// the units rendered before it. The accumulation buffers returned for the units are summed into the
+	// full frame and equal the --render-tiled render of the same seed, up to the order of the sums.
+	class RenderCoordinator
+	{
+	public:
+		RenderCoordinator(const RenderCoordinatorSpecification& specification);
+		~RenderCoordinator();
+
+		bool Listen();
+		uint16_t GetPort() const { return m_Listener.GetPort(); }
+
+		// Accepts workers until count are connected, false after timeout seconds
+		bool WaitForWorkers(uint32_t count, float timeout);
+
+		// Renders the job on the first maxWorkers connected workers, or all of them for 0. Workers that
+		// connect while it runs join in. Returns the full frame sum + path count buffer, fails when no
+		// worker has been connected for WorkerTimeout seconds.
+		bool Render(const DistributedJobSpecification& job, std::vector<glm::vec4>& accumulation, uint32_t maxWorkers = 0);
+
+		// Tells the workers to exit
+		void Shutdown();
+
+		uint32_t GetConnectedWorkerCount() const;
+
+		// Statistics of every worker that connected, for the last Render
+		const std::vector<WorkerStatistics>& GetWorkerStatistics() const { return m_Statistics; }
+
+		// Units of the last Render that were given to another worker because theirs was lost or slow
+		uint32_t GetReassignedUnitCount() const { return m_ReassignedUnitCount; }
+
+	private:
+		using Clock = std::chrono::high_resolution_clock;
+
+		struct Unit
+		{
+			uint32_t Tile = 0;
+			uint32_t FirstFrame = 0;
+			uint32_t FrameCount = 0;
+			uint32_t Assignments = 0;
+			bool Done = false;
+			Clock::time_point StartTime;
+		};
+
+		struct Worker
+		{
+			Socket Connection;
+			std::vector<uint32_t> Units;
+			Clock::time_point LastMessage;
+		};
+
+		bool Accept();
+		void Assign(Worker& worker, uint32_t unit, uint32_t jobIndex);
+		void Drop(uint32_t worker);
+
+	private:
+		RenderCoordinatorSpecification m_Specification;
+		Socket m_Listener;
+		std::vector<Worker> m_Workers;
+		std::vector<Unit> m_Units;
+		std::deque<uint32_t> m_Pending;
+		std::vector<WorkerStatistics> m_Statistics;
+		uint32_t m_JobIndex = 0;
+		uint32_t m_ReassignedUnitCount = 0;
+	};
+
+	struct RenderWorkerSpecification
+	{
+		std::string Host = "localhost";
+		uint16_t Port = 7878;
+
+		// Seconds to keep retrying while the coordinator isn't up yet
+		float ConnectTimeout = 30.0f;
+
+		// Disconnect after this many units, 0 renders until the coordinator shuts down
+		uint32_t MaxUnits = 0;
+	};
+
+	// Renders the units a RenderCoordinator sends. The loaded scene and environment are kept for the
+	// following jobs as long as they use the same ones.
+	class RenderWorker
+	{
+	public:
+		RenderWorker(const RenderWorkerSpecification& specification);
+
+		bool Connect();
+
+		// Renders units until the coordinator shuts down (true) or the connection is lost (false)
+		bool Run();
+
+		uint32_t GetUnitCount() const { return m_UnitCount; }
+		uint32_t GetSceneLoadCount() const { return m_SceneLoadCount; }
+
+	private:
+		bool LoadJob(const DistributedJobSpecification& job);
+
+	private:
+		RenderWorkerSpecification m_Specification;
+		Socket m_Connection;
+
+		DistributedSceneSpecification m_SceneSpec;
+		VkLibrary::Ref<Scene> m_Scene;
+		VkLibrary::Ref<EnvironmentMap> m_Environment;
+		VkLibrary::Ref<PathTracer> m_PathTracer;
+		DistributedJobSpecification m_Job;
+		uint32_t m_JobIndex = ~0u;
+
+		uint32_t m_UnitCount = 0;
+		uint32_t m_SceneLoadCount = 0;
+	};
+
+}
@@ -0,0 +1,159 @@
+#include "CPU/EXRWriter.h"
+#include <cstring>
+
+namespace CPU {
+
+	// OpenEXR file layout constants, see "Technical Introduction to OpenEXR" and "OpenEXR File Layout"
+	static constexpr int32_t s_EXRMagic = 20000630;
+	static constexpr int32_t s_EXRVersion = 2;
+	static constexpr int32_t s_EXRTiledFlag = 0x200;
+	static constexpr int32_t s_EXRFloat = 2;
+	static constexpr uint8_t s_EXRNoCompression = 0;
+	static constexpr uint8_t s_EXRRandomY = 2;
+	static constexpr uint8_t s_EXROneLevel = 0;
+
+	// Channels are stored in alphabetical order, index into glm::vec4
+	static const char* s_ChannelNames[] = { "B", "G", "R" };
+	static constexpr int s_ChannelComponents[] = { 2, 1, 0 };
+
+	template<typename T>
+	static void Append(std::vector<uint8_t>& bytes, const T& value)
+	{
+		const uint8_t* data = (const uint8_t*)&value;
+		bytes.insert(bytes.end(), data, data + sizeof(T));
+	}
+
+	static void AppendString(std::vector<uint8_t>& bytes, const char* string)
+	{
+		bytes.insert(bytes.end(), string, string + strlen(string) + 1);
+	}
+
+	static void AppendAttribute(std::vector<uint8_t>& bytes, const char* name, const char* type, const std::vector<uint8_t>& value)
+	{
+		AppendString(bytes, name);
+		AppendString(bytes, type);
+		Append(bytes, (int32_t)value.size());
+		bytes.insert(bytes.end(), value.begin(), value.end());
+	}
+
+	static std::vector<uint8_t> Box2i(int32_t xMin, int32_t yMin, int32_t xMax, int32_t yMax)
+	{
+		std::vector<uint8_t> value;
+		Append(value, xMin);
+		Append(value, yMin);
+		Append(value, xMax);
+		Append(value, yMax);
+		return value;
+	}
+
+	TiledEXRWriter::~TiledEXRWriter()
+	{
+		if (m_Stream.is_open())
+			m_Stream.close();
+	}
+
+	bool TiledEXRWriter::Open(const std::string& filepath, uint32_t width, uint32_t height, uint32_t tileSize)
+	{
+		m_Stream.open(filepath, std::ios::binary | std::ios::trunc);
+		if (!m_Stream)
+			return false;
+
+		m_Width = width;
+		m_Height = height;
+		m_TileSize = tileSize;
+		m_TilesX = (width + tileSize - 1) / tileSize;
+		m_TilesY = (height + tileSize - 1) / tileSize;
+		m_TileOffsets.assign((size_t)m_TilesX * m_TilesY, 0);
+
+		std::vector<uint8_t> header;
+		Append(header, s_EXRMagic);
+		Append(header, s_EXRVersion | s_EXRTiledFlag);
+
+		std::vector<uint8_t> channels;
+		for (const char* name : s_ChannelNames)
+		{
+			AppendString(channels, name);
+			Append(channels, s_EXRFloat);
+			Append(channels, (uint32_t)0); // pLinear and reserved
+			Append(channels, (int32_t)1);  // xSampling
+			Append(channels, (int32_t)1);  // ySampling
+		}
+		channels.push_back(0);
+		AppendAttribute(header, "channels", "chlist", channels);
+
+		AppendAttribute(header, "compression", "compression", { s_EXRNoCompression });
+		AppendAttribute(header, "dataWindow", "box2i", Box2i(0, 0, (int32_t)width - 1, (int32_t)height - 1));
+		AppendAttribute(header, "displayWindow", "box2i", Box2i(0, 0, (int32_t)width - 1, (int32_t)height - 1));
+		AppendAttribute(header, "lineOrder", "lineOrder", { s_EXRRandomY });
+
+		std::vector<uint8_t> one;
+		Append(one, 1.0f);
+		AppendAttribute(header, "pixelAspectRatio", "float", one);
+		AppendAttribute(header, "screenWindowWidth", "float", one);
+
+		std::vector<uint8_t> center;
+		Append(center, glm::vec2(0.0f));
+		AppendAttribute(header, "screenWindowCenter", "v2f", center);
+
+		std::vector<uint8_t> tiles;
+		Append(tiles, tileSize);
+		Append(tiles, tileSize);
+		tiles.push_back(s_EXROneLevel);
+		AppendAttribute(header, "tiles", "tiledesc", tiles);
+
+		header.push_back(0);
+		m_Stream.write((const char*)header.data(), header.size());
+
+		// Reserved, filled in by WriteTile
+		m_OffsetTablePosition = header.size();
+		m_Stream.write((const char*)m_TileOffsets.data(), m_TileOffsets.size() * sizeof(uint64_t));
+
+		return m_Stream.good();
+	}
+
+	bool TiledEXRWriter::WriteTile(uint32_t tileX, uint32_t tileY, const std::vector<glm::vec4>& pixels)
+	{
+		uint32_t tileWidth = glm::min(m_TileSize, m_Width - tileX * m_TileSize);
+		uint32_t tileHeight = glm::min(m_TileSize, m_Height - tileY * m_TileSize);
+		if (tileX >= m_TilesX || tileY >= m_TilesY || pixels.size() != (size_t)tileWidth * tileHeight)
+			return false;
+
+		// Every scanline holds the channels one after another
+		m_Scratch.resize((size_t)tileWidth * tileHeight * 3);
+		float* destination = m_Scratch.data();
+		for (uint32_t y = 0; y < tileHeight; y++)
+		{
+			for (int channel = 0; channel < 3; channel++)
+			{
+				for (uint32_t x = 0; x < tileWidth; x++)
+					*destination++ = pixels[x + y * tileWidth][s_ChannelComponents[channel]];
+			}
+		}
+
+		m_Stream.seekp(0, std::ios::end);
+		uint64_t offset = (uint64_t)m_Stream.tellp();
+
+		int32_t chunk[5] = { (int32_t)tileX, (int32_t)tileY, 0, 0, (int32_t)(m_Scratch.size() * sizeof(float)) };
+		m_Stream.write((const char*)chunk, sizeof(chunk));
+		m_Stream.write((const char*)m_Scratch.data(), m_Scratch.size() * sizeof(float));
+
+		size_t tileIndex = tileX + (size_t)tileY * m_TilesX;
+		m_TileOffsets[tileIndex] = offset;
+		m_Stream.seekp(m_OffsetTablePosition + tileIndex * sizeof(uint64_t));
+		m_Stream.write((const char*)&offset, sizeof(uint64_t));
+
+		return m_Stream.good();
+	}
+
+	bool TiledEXRWriter::Close()
+	{
+		bool complete = true;
+		for (uint64_t offset : m_TileOffsets)
+			complete &= offset != 0;
+
+		bool good = m_Stream.good();
+		m_Stream.close();
+		return complete && good;
+	}
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace CPU {
+
+	// Streams an uncompressed, single level tiled OpenEXR file with 32-bit float R, G and B channels.
+	// Tiles can be written in any order as they finish (RANDOM_Y line order): the offset table is
+	// reserved after the header and patched after every tile, so only one tile is ever in memory.
+	class TiledEXRWriter
+	{
+	public:
+		TiledEXRWriter() = default;
+		~TiledEXRWriter();
+
+		TiledEXRWriter(const TiledEXRWriter&) = delete;
+		TiledEXRWriter& operator=(const TiledEXRWriter&) = delete;
+
+		bool Open(const std::string& filepath, uint32_t width, uint32_t height, uint32_t tileSize);
+
+		// RGB of tileWidth x tileHeight pixels, top row first. Tiles on the right and bottom edge are
+		// clipped to the image.
+		bool WriteTile(uint32_t tileX, uint32_t tileY, const std::vector<glm::vec4>& pixels);
+
+		// Fails if a tile is missing, the file isn't a valid EXR without all of them
+		bool Close();
+
+		bool IsOpen() const { return m_Stream.is_open(); }
+		uint32_t GetTilesX() const { return m_TilesX; }
+		uint32_t GetTilesY() const { return m_TilesY; }
+
+	private:
+		std::ofstream m_Stream;
+		uint32_t m_Width = 0;
+		uint32_t m_Height = 0;
+		uint32_t m_TileSize = 0;
+		uint32_t m_TilesX = 0;
+		uint32_t m_TilesY = 0;
+
+		uint64_t m_OffsetTablePosition = 0;
+		std::vector<uint64_t> m_TileOffsets;
+		std::vector<float> m_Scratch;
+	};
+
+}
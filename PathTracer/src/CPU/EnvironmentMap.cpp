@@ -0,0 +1,298 @@
+#include "CPU/EnvironmentMap.h"
+#include "CPU/Disney.h"
+#include "CPU/ImageIO.h"
+#include "CPU/ThreadPool.h"
+#include "Util/Hash.h"
+#include "Core/Base.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+
+namespace CPU {
+
+	static constexpr char s_Magic[4] = { 'E', 'N', 'V', 'M' };
+	static constexpr uint32_t s_Version = 1;
+
+	struct EnvironmentMapHeader
+	{
+		char Magic[4];
+		uint32_t Version;
+		uint64_t Key;
+		uint32_t Width;
+		uint32_t Height;
+		float Integral;
+		uint32_t Padding;
+		uint64_t DataOffset;
+	};
+
+	static constexpr uint64_t s_DataOffset = 64;
+	static_assert(sizeof(EnvironmentMapHeader) <= s_DataOffset, "Header overlaps environment data");
+
+	// Turns function values into a normalized CDF of count + 1 entries and returns their integral
+	// over [0, 1]. An all zero function gets a uniform CDF.
+	static float BuildCDF(const float* function, uint32_t count, float* cdf)
+	{
+		cdf[0] = 0.0f;
+		for (uint32_t i = 0; i < count; i++)
+			cdf[i + 1] = cdf[i] + function[i] / count;
+
+		float integral = cdf[count];
+		for (uint32_t i = 1; i <= count; i++)
+			cdf[i] = integral > 0.0f ? cdf[i] / integral : (float)i / count;
+
+		return integral;
+	}
+
+	// Continuous sample in [0, 1) from a CDF, offset is the bin it fell into
+	static float SampleCDF(const float* cdf, uint32_t count, float u, uint32_t& offset)
+	{
+		offset = (uint32_t)std::clamp<ptrdiff_t>(std::upper_bound(cdf, cdf + count + 1, u) - cdf - 1, 0, count - 1);
+
+		float du = u - cdf[offset];
+		float width = cdf[offset + 1] - cdf[offset];
+		if (width > 0.0f)
+			du /= width;
+
+		return glm::min((offset + du) / count, 0.99999994f);
+	}
+
+	EnvironmentMap::EnvironmentMap(const EnvironmentMapSpecification& specification)
+		: m_Specification(specification)
+	{
+		std::error_code error;
+		uint64_t fileSize = std::filesystem::file_size(m_Specification.Path, error);
+		if (error)
+		{
+			LOG_ERROR("Environment map {} not found", m_Specification.Path);
+			return;
+		}
+		int64_t writeTime = std::filesystem::last_write_time(m_Specification.Path, error).time_since_epoch().count();
+
+		m_CachePath = std::filesystem::path(m_Specification.Path).replace_extension(".envmap").string();
+
+		Hasher hasher;
+		hasher.Add(s_Version);
+		hasher.Add(m_Specification.Width);
+		hasher.Add(m_Specification.Height);
+		hasher.Add(fileSize);
+		hasher.Add(writeTime);
+		m_Key = hasher.Get();
+
+		if (Load())
+		{
+			m_LoadedFromCache = true;
+			return;
+		}
+
+		if (!Generate())
+		{
+			LOG_ERROR("Failed to generate environment map cache {}", m_CachePath);
+			return;
+		}
+
+		// Reopen read-only so the generated file is used exactly like a cache hit
+		if (!Load())
+			LOG_ERROR("Failed to load generated environment map cache {}", m_CachePath);
+	}
+
+	EnvironmentMap::EnvironmentMap(const std::vector<glm::vec3>& pixels, uint32_t width, uint32_t height, const EnvironmentMapSpecification& specification)
+		: m_Specification(specification)
+	{
+		if (width == 0 || height == 0 || pixels.size() < (size_t)width * height)
+			return;
+
+		m_Storage.resize(GetRadianceSize() + GetDistributionSize());
+		m_Integral = Build(pixels, width, height, m_Storage.data());
+		m_Data = m_Storage.data();
+	}
+
+	uint64_t EnvironmentMap::GetDistributionSize() const
+	{
+		uint64_t width = m_Specification.Width;
+		uint64_t height = m_Specification.Height;
+		return (height + 1) + height * (width + 1) + height * width;
+	}
+
+	bool EnvironmentMap::Load()
+	{
+		if (!m_File.Open(m_CachePath))
+			return false;
+
+		uint64_t expectedSize = s_DataOffset + (GetRadianceSize() + GetDistributionSize()) * sizeof(float);
+		bool valid = m_File.GetSize() >= s_DataOffset;
+		if (valid)
+		{
+			const EnvironmentMapHeader& header = *m_File.As<EnvironmentMapHeader>();
+			valid = memcmp(header.Magic, s_Magic, sizeof(s_Magic)) == 0
+				&& header.Version == s_Version
+				&& header.Key == m_Key
+				&& header.Width == m_Specification.Width
+				&& header.Height == m_Specification.Height
+				&& header.DataOffset == s_DataOffset
+				&& m_File.GetSize() == expectedSize;
+		}
+
+		if (!valid)
+		{
+			LOG_WARN("Environment map cache {} is stale, regenerating", m_CachePath);
+			m_File.Close();
+			return false;
+		}
+
+		m_Integral = m_File.As<EnvironmentMapHeader>()->Integral;
+		m_Data = m_File.As<float>(s_DataOffset);
+		return true;
+	}
+
+	bool EnvironmentMap::Generate()
+	{
+		std::vector<glm::vec3> pixels;
+		uint32_t width, height;
+		if (!ReadHDR(m_Specification.Path, pixels, width, height))
+		{
+			LOG_ERROR("Failed to read {}", m_Specification.Path);
+			return false;
+		}
+
+		// Write to a temporary file first so an interrupted run never leaves a valid looking cache behind
+		std::string tempPath = m_CachePath + ".tmp";
+		MappedFile file;
+		if (!file.Create(tempPath, s_DataOffset + (GetRadianceSize() + GetDistributionSize()) * sizeof(float)))
+			return false;
+
+		EnvironmentMapHeader& header = *file.As<EnvironmentMapHeader>();
+		memcpy(header.Magic, s_Magic, sizeof(s_Magic));
+		header.Version = s_Version;
+		header.Key = m_Key;
+		header.Width = m_Specification.Width;
+		header.Height = m_Specification.Height;
+		header.Integral = Build(pixels, width, height, file.As<float>(s_DataOffset));
+		header.Padding = 0;
+		header.DataOffset = s_DataOffset;
+
+		file.Close();
+
+		std::error_code error;
+		std::filesystem::rename(tempPath, m_CachePath, error);
+		if (error)
+		{
+			std::filesystem::remove(m_CachePath, error);
+			std::filesystem::rename(tempPath, m_CachePath, error);
+		}
+
+		return !error;
+	}
+
+	float EnvironmentMap::Build(const std::vector<glm::vec3>& pixels, uint32_t width, uint32_t height, float* data) const
+	{
+		uint32_t targetWidth = m_Specification.Width;
+		uint32_t targetHeight = m_Specification.Height;
+
+		glm::vec3* radiance = (glm::vec3*)data;
+		float* marginalCDF = data + GetRadianceSize();
+		float* conditionalCDFs = marginalCDF + targetHeight + 1;
+		float* function = conditionalCDFs + (uint64_t)targetHeight * (targetWidth + 1);
+
+		// Rows are independent up to the marginal, which is only targetHeight entries
+		std::vector<float> rowIntegrals(targetHeight);
+		ThreadPool::Get().ParallelFor(targetHeight, [&](uint32_t y)
+		{
+			// Box filter over the source pixels covering the target pixel, at least one of them
+			uint32_t y0 = (uint32_t)((uint64_t)y * height / targetHeight);
+			uint32_t y1 = glm::max(y0 + 1, (uint32_t)((uint64_t)(y + 1) * height / targetHeight));
+
+			float sinTheta = glm::sin(PI * (y + 0.5f) / targetHeight);
+			float* rowFunction = function + (uint64_t)y * targetWidth;
+			for (uint32_t x = 0; x < targetWidth; x++)
+			{
+				uint32_t x0 = (uint32_t)((uint64_t)x * width / targetWidth);
+				uint32_t x1 = glm::max(x0 + 1, (uint32_t)((uint64_t)(x + 1) * width / targetWidth));
+
+				glm::vec3 sum = glm::vec3(0.0f);
+				for (uint32_t sy = y0; sy < y1; sy++)
+				{
+					for (uint32_t sx = x0; sx < x1; sx++)
+						sum += pixels[(size_t)sy * width + sx];
+				}
+
+				glm::vec3 value = sum / (float)((y1 - y0) * (x1 - x0));
+				radiance[(uint64_t)y * targetWidth + x] = value;
+
+				// Equirectangular pixels shrink towards the poles
+				rowFunction[x] = glm::max(Luminance(value), 0.0f) * sinTheta;
+			}
+
+			rowIntegrals[y] = BuildCDF(rowFunction, targetWidth, conditionalCDFs + (uint64_t)y * (targetWidth + 1));
+		});
+
+		return BuildCDF(rowIntegrals.data(), targetHeight, marginalCDF);
+	}
+
+	glm::vec2 EnvironmentMap::DirectionToUV(const glm::vec3& direction) const
+	{
+		// Same mapping as EquirectangularToCubeMap.glsl
+		float phi = std::atan2(direction.z, direction.x);
+		float theta = glm::acos(glm::clamp(direction.y, -1.0f, 1.0f));
+		return glm::vec2(phi / TWO_PI + 0.5f, theta / PI);
+	}
+
+	glm::vec3 EnvironmentMap::Sample(const glm::vec2& u, float& pdf) const
+	{
+		pdf = 0.0f;
+		if (m_Integral <= 0.0f)
+			return glm::vec3(0.0f, 1.0f, 0.0f);
+
+		uint32_t width = m_Specification.Width;
+		uint32_t height = m_Specification.Height;
+		const float* marginalCDF = GetDistribution();
+		const float* conditionalCDFs = marginalCDF + height + 1;
+		const float* function = conditionalCDFs + (uint64_t)height * (width + 1);
+
+		uint32_t y, x;
+		float v = SampleCDF(marginalCDF, height, u.y, y);
+		float s = SampleCDF(conditionalCDFs + (uint64_t)y * (width + 1), width, u.x, x);
+
+		float phi = (s - 0.5f) * TWO_PI;
+		float theta = v * PI;
+		float sinTheta = glm::sin(theta);
+		if (sinTheta <= 0.0f)
+			return glm::vec3(0.0f, 1.0f, 0.0f);
+
+		// Pdf over [0, 1]^2, then to solid angle through d(omega) = 2 pi^2 sin(theta) du dv
+		pdf = function[(uint64_t)y * width + x] / m_Integral / (2.0f * PI * PI * sinTheta);
+		return glm::vec3(sinTheta * glm::cos(phi), glm::cos(theta), sinTheta * glm::sin(phi));
+	}
+
+	float EnvironmentMap::Pdf(const glm::vec3& direction) const
+	{
+		if (m_Integral <= 0.0f)
+			return 0.0f;
+
+		uint32_t width = m_Specification.Width;
+		uint32_t height = m_Specification.Height;
+		glm::vec2 uv = DirectionToUV(direction);
+		uint32_t x = glm::min((uint32_t)(uv.x * width), width - 1);
+		uint32_t y = glm::min((uint32_t)(uv.y * height), height - 1);
+
+		float sinTheta = glm::sin(uv.y * PI);
+		if (sinTheta <= 0.0f)
+			return 0.0f;
+
+		const float* function = GetDistribution() + (height + 1) + (uint64_t)height * (width + 1);
+		return function[(uint64_t)y * width + x] / m_Integral / (2.0f * PI * PI * sinTheta);
+	}
+
+	glm::vec3 EnvironmentMap::Eval(const glm::vec3& direction) const
+	{
+		uint32_t width = m_Specification.Width;
+		uint32_t height = m_Specification.Height;
+		glm::vec2 uv = DirectionToUV(direction);
+		uint32_t x = glm::min((uint32_t)(uv.x * width), width - 1);
+		uint32_t y = glm::min((uint32_t)(uv.y * height), height - 1);
+
+		const glm::vec3* radiance = (const glm::vec3*)m_Data;
+		return radiance[(uint64_t)y * width + x] * m_Specification.Intensity;
+	}
+
+}
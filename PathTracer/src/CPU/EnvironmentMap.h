@@ -0,0 +1,85 @@
+#pragma once
+#include "Util/MappedFile.h"
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+namespace CPU {
+
+	struct EnvironmentMapSpecification
+	{
+		// Equirectangular Radiance .hdr, the same file the u_Skybox cube map is made from
+		std::string Path;
+
+		// Resolution of the sampling distribution, the HDR is box filtered down to it
+		uint32_t Width = 1024;
+		uint32_t Height = 512;
+
+		// Scale applied to the radiance, matches the factor on u_Skybox in RayGen.glsl
+		float Intensity = 10.0f;
+	};
+
+	// Piecewise constant 2D distribution over an equirectangular environment, proportional to
+	// luminance times sin(theta) so directions are picked by the radiance they carry. The filtered
+	// radiance and the distribution are built in parallel rows and cached next to the HDR, keyed
+	// by the resolution and the HDR's size and modification time.
+	//
+	// Distribution layout, same as EnvironmentDistribution in EnvironmentSampling.glsl:
+	// marginal CDF (Height + 1), conditional CDFs (Height * (Width + 1)), function (Height * Width)
+	class EnvironmentMap
+	{
+	public:
+		EnvironmentMap(const EnvironmentMapSpecification& specification);
+
+		// Builds from top row first pixels in memory, without a cache
+		EnvironmentMap(const std::vector<glm::vec3>& pixels, uint32_t width, uint32_t height, const EnvironmentMapSpecification& specification);
+
+		bool IsValid() const { return m_Data != nullptr; }
+		bool WasLoadedFromCache() const { return m_LoadedFromCache; }
+
+		// Direction towards the environment with its solid angle pdf, 0 when nothing can be sampled
+		glm::vec3 Sample(const glm::vec2& u, float& pdf) const;
+
+		// Solid angle pdf of Sample returning direction
+		float Pdf(const glm::vec3& direction) const;
+
+		// Filtered radiance seen along direction, including Intensity
+		glm::vec3 Eval(const glm::vec3& direction) const;
+
+		const float* GetDistribution() const { return m_Data + GetRadianceSize(); }
+		uint64_t GetDistributionSize() const;
+
+		uint32_t GetWidth() const { return m_Specification.Width; }
+		uint32_t GetHeight() const { return m_Specification.Height; }
+
+		// Mean of the distribution function, normalizes it to a pdf over [0, 1]^2
+		float GetIntegral() const { return m_Integral; }
+
+		const std::string& GetCachePath() const { return m_CachePath; }
+		const EnvironmentMapSpecification& GetSpecification() const { return m_Specification; }
+
+	private:
+		bool Load();
+		bool Generate();
+
+		// Fills radiance and distribution (both sized for the specification) from the source pixels
+		float Build(const std::vector<glm::vec3>& pixels, uint32_t width, uint32_t height, float* data) const;
+
+		uint64_t GetRadianceSize() const { return (uint64_t)m_Specification.Width * m_Specification.Height * 3; }
+		glm::vec2 DirectionToUV(const glm::vec3& direction) const;
+
+	private:
+		EnvironmentMapSpecification m_Specification;
+		std::string m_CachePath;
+		uint64_t m_Key = 0;
+
+		// Points into the mapped cache, or into m_Storage for maps built in memory
+		const float* m_Data = nullptr;
+		MappedFile m_File;
+		std::vector<float> m_Storage;
+
+		float m_Integral = 0.0f;
+		bool m_LoadedFromCache = false;
+	};
+
+}
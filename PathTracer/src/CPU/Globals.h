@@ -0,0 +1,110 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+
+// CPU mirror of assets/shaders/RayTracing/Globals.h
+
+namespace CPU {
+
+	constexpr float PI         = 3.14159265358979323f;
+	constexpr float INV_PI     = 0.31830988618379067f;
+	constexpr float TWO_PI     = 6.28318530717958648f;
+	constexpr float INV_TWO_PI = 0.15915494309189533f;
+	constexpr float INV_4_PI   = 0.07957747154594766f;
+
+	// Disney BSDF lobes a material can have a nonzero weight in, see ClassifyMaterial
+	constexpr uint32_t LOBE_DIFFUSE    = 1 << 0; // Diffuse and dielectric reflection
+	constexpr uint32_t LOBE_SHEEN      = 1 << 1;
+	constexpr uint32_t LOBE_SUBSURFACE = 1 << 2;
+	constexpr uint32_t LOBE_METAL      = 1 << 3;
+	constexpr uint32_t LOBE_GLASS      = 1 << 4;
+	constexpr uint32_t LOBE_CLEARCOAT  = 1 << 5;
+	constexpr uint32_t LOBE_ALL        = (1 << 6) - 1;
+
+	struct Ray
+	{
+		glm::vec3 Origin;
+		glm::vec3 Direction;
+		float TMin = 0.00001f;
+		float TMax = 1e27f;
+	};
+
+	struct Payload
+	{
+		float Distance;
+		glm::vec3 Albedo;
+		float Metallic;
+		float Roughness;
+		glm::vec3 Emission;
+		glm::vec3 WorldPosition;
+		glm::vec3 WorldNormal;
+		glm::mat3 WorldNormalMatrix;
+		glm::vec3 Binormal;
+		glm::vec3 Tangent;
+		glm::vec3 View;
+		glm::vec3 WorldRayDirection;
+
+		float Anisotropic;
+		float Subsurface;
+		float SpecularTint;
+		float Sheen;
+		float SheenTint;
+		float Clearcoat;
+		float ClearcoatRoughness;
+		float SpecTrans;
+		float ior;
+
+		float ax;
+		float ay;
+		float eta;
+		uint32_t Lobes;
+
+		uint32_t InstanceIndex;
+		uint32_t PrimitiveIndex;
+	};
+
+	struct ScatterSampleRec
+	{
+		glm::vec3 L;
+		glm::vec3 f;
+		float pdf;
+	};
+
+	struct LightSampleRec
+	{
+		glm::vec3 normal;
+		glm::vec3 emission;
+		glm::vec3 direction;
+		float dist;
+		float pdf;
+	};
+
+	inline uint32_t PCG_Hash(uint32_t& seed)
+	{
+		seed = seed * 747796405u + 2891336453u;
+		uint32_t result = ((seed >> ((seed >> 28) + 4)) ^ seed) * 277803737u;
+		return (result >> 22) ^ result;
+	}
+
+	inline float RandomValue(uint32_t& seed)
+	{
+		return (float)PCG_Hash(seed) / 4294967295.0f;
+	}
+
+	// Point in the unit disk, u.x picks the angle and u.y the area inside the radius
+	inline glm::vec2 PointInCircle(const glm::vec2& u)
+	{
+		float angle = u.x * 2.0f * PI;
+		glm::vec2 pointOnCircle = glm::vec2(glm::cos(angle), glm::sin(angle));
+		return pointOnCircle * glm::sqrt(u.y);
+	}
+
+	inline glm::vec2 RandomPointInCircle(uint32_t& seed)
+	{
+		glm::vec2 u;
+		u.x = RandomValue(seed);
+		u.y = RandomValue(seed);
+		return PointInCircle(u);
+	}
+
+}
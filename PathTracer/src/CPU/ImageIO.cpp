@@ -0,0 +1,186 @@
+#include "CPU/ImageIO.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace CPU {
+
+	struct AccumulationHeader
+	{
+		char Magic[4] = { 'A', 'C', 'C', 'M' };
+		uint32_t Version = 1;
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+	};
+
+	bool WritePFM(const std::string& filepath, const std::vector<glm::vec4>& pixels, uint32_t width, uint32_t height)
+	{
+		std::ofstream stream(filepath, std::ios::binary);
+		if (!stream)
+			return false;
+
+		// Negative scale marks little endian data
+		std::string header = "PF\n" + std::to_string(width) + " " + std::to_string(height) + "\n-1.0\n";
+		stream.write(header.data(), header.size());
+
+		std::vector<float> row(width * 3);
+		for (uint32_t y = 0; y < height; y++)
+		{
+			const glm::vec4* source = pixels.data() + (size_t)(height - 1 - y) * width;
+			for (uint32_t x = 0; x < width; x++)
+			{
+				row[x * 3 + 0] = source[x].x;
+				row[x * 3 + 1] = source[x].y;
+				row[x * 3 + 2] = source[x].z;
+			}
+			stream.write((const char*)row.data(), row.size() * sizeof(float));
+		}
+
+		return stream.good();
+	}
+
+	bool WriteAccumulation(const std::string& filepath, const std::vector<glm::vec4>& pixels, uint32_t width, uint32_t height)
+	{
+		std::ofstream stream(filepath, std::ios::binary);
+		if (!stream)
+			return false;
+
+		AccumulationHeader header;
+		header.Width = width;
+		header.Height = height;
+
+		stream.write((const char*)&header, sizeof(AccumulationHeader));
+		stream.write((const char*)pixels.data(), (size_t)width * height * sizeof(glm::vec4));
+
+		return stream.good();
+	}
+
+	bool ReadAccumulation(const std::string& filepath, std::vector<glm::vec4>& pixels, uint32_t& width, uint32_t& height)
+	{
+		std::ifstream stream(filepath, std::ios::binary);
+		if (!stream)
+			return false;
+
+		AccumulationHeader header;
+		AccumulationHeader expected;
+		stream.read((char*)&header, sizeof(AccumulationHeader));
+		if (!stream || memcmp(header.Magic, expected.Magic, 4) != 0 || header.Version != expected.Version)
+			return false;
+
+		width = header.Width;
+		height = header.Height;
+		pixels.resize((size_t)width * height);
+		stream.read((char*)pixels.data(), pixels.size() * sizeof(glm::vec4));
+
+		return stream.good();
+	}
+
+	static glm::vec3 DecodeRGBE(const uint8_t* rgbe)
+	{
+		if (rgbe[3] == 0)
+			return glm::vec3(0.0f);
+
+		float scale = std::ldexp(1.0f, (int)rgbe[3] - (128 + 8));
+		return glm::vec3(rgbe[0], rgbe[1], rgbe[2]) * scale;
+	}
+
+	// New style run length encoded scanline, channels stored one after another
+	static bool ReadRLEScanline(std::istream& stream, std::vector<uint8_t>& scanline, uint32_t width)
+	{
+		for (uint32_t channel = 0; channel < 4; channel++)
+		{
+			uint32_t x = 0;
+			while (x < width)
+			{
+				int count = stream.get();
+				if (count == EOF)
+					return false;
+
+				if (count > 128)
+				{
+					// Run of one value
+					count -= 128;
+					int value = stream.get();
+					if (value == EOF || x + count > width)
+						return false;
+
+					for (int i = 0; i < count; i++)
+						scanline[(x++) * 4 + channel] = (uint8_t)value;
+				}
+				else
+				{
+					if (count == 0 || x + count > width)
+						return false;
+
+					for (int i = 0; i < count; i++)
+					{
+						int value = stream.get();
+						if (value == EOF)
+							return false;
+						scanline[(x++) * 4 + channel] = (uint8_t)value;
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+
+	bool ReadHDR(const std::string& filepath, std::vector<glm::vec3>& pixels, uint32_t& width, uint32_t& height)
+	{
+		std::ifstream stream(filepath, std::ios::binary);
+		if (!stream)
+			return false;
+
+		std::string line;
+		std::getline(stream, line);
+		if (line != "#?RADIANCE" && line != "#?RGBE")
+			return false;
+
+		// Header lines up to an empty one, then the resolution
+		bool rgbe = false;
+		while (std::getline(stream, line) && !line.empty())
+		{
+			if (line == "FORMAT=32-bit_rle_rgbe")
+				rgbe = true;
+		}
+
+		int w = 0, h = 0;
+		if (!rgbe || !std::getline(stream, line) || sscanf(line.c_str(), "-Y %d +X %d", &h, &w) != 2 || w <= 0 || h <= 0)
+			return false;
+
+		width = (uint32_t)w;
+		height = (uint32_t)h;
+		pixels.resize((size_t)width * height);
+
+		std::vector<uint8_t> scanline(width * 4);
+		for (uint32_t y = 0; y < height; y++)
+		{
+			stream.read((char*)scanline.data(), 4);
+			if (!stream)
+				return false;
+
+			bool rle = width >= 8 && width < 0x8000 && scanline[0] == 2 && scanline[1] == 2 && ((scanline[2] << 8) | scanline[3]) == (int)width;
+			if (rle)
+			{
+				if (!ReadRLEScanline(stream, scanline, width))
+					return false;
+			}
+			else
+			{
+				// Flat scanline, the four bytes already read are its first pixel
+				stream.read((char*)scanline.data() + 4, (width - 1) * 4);
+				if (!stream)
+					return false;
+			}
+
+			glm::vec3* row = pixels.data() + (size_t)y * width;
+			for (uint32_t x = 0; x < width; x++)
+				row[x] = DecodeRGBE(scanline.data() + x * 4);
+		}
+
+		return true;
+	}
+
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+namespace CPU {
+
+	// Writes the RGB channels of an RGBA32F image as a little endian PFM, bottom row first
+	bool WritePFM(const std::string& filepath, const std::vector<glm::vec4>& pixels, uint32_t width, uint32_t height);
+
+	// Raw dump of an accumulation buffer (RGB sum + path count in W), same layout as o_AccumulationImage
+	bool WriteAccumulation(const std::string& filepath, const std::vector<glm::vec4>& pixels, uint32_t width, uint32_t height);
+	bool ReadAccumulation(const std::string& filepath, std::vector<glm::vec4>& pixels, uint32_t& width, uint32_t& height);
+
+	// Radiance RGBE (.hdr) with flat or run length encoded scanlines, top row first. Only the
+	// standard -Y +X orientation is supported.
+	bool ReadHDR(const std::string& filepath, std::vector<glm::vec3>& pixels, uint32_t& width, uint32_t& height);
+
+}
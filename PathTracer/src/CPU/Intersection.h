@@ -0,0 +1,106 @@
+#pragma once
+#include "CPU/Globals.h"
+#include <utility>
+
+namespace CPU {
+
+	struct Hit
+	{
+		float Distance = -1.0f;
+		uint32_t InstanceIndex = 0;
+		uint32_t PrimitiveIndex = 0;
+		glm::vec2 Barycentrics = glm::vec2(0.0f); // Same convention as hitAttributeEXT
+	};
+
+	// Per ray setup of the watertight intersector (Woop, Benthin and Wald 2013). Triangles are
+	// sheared into a space where the ray points down +z and tested with 2D edge functions, so a ray
+	// through a shared edge or vertex always hits one of the triangles instead of slipping between them.
+	struct WatertightRay
+	{
+		glm::vec3 Origin;
+		glm::vec3 Shear;
+		uint32_t AxisX, AxisY, AxisZ;
+
+		WatertightRay() = default;
+		WatertightRay(const glm::vec3& origin, const glm::vec3& direction)
+			: Origin(origin)
+		{
+			glm::vec3 absDirection = glm::abs(direction);
+			AxisZ = absDirection.x > absDirection.y ? (absDirection.x > absDirection.z ? 0 : 2) : (absDirection.y > absDirection.z ? 1 : 2);
+			AxisX = (AxisZ + 1) % 3;
+			AxisY = (AxisX + 1) % 3;
+
+			// Keep the winding of the sheared triangles independent of the ray direction
+			if (direction[AxisZ] < 0.0f)
+				std::swap(AxisX, AxisY);
+
+			Shear = glm::vec3(direction[AxisX] / direction[AxisZ], direction[AxisY] / direction[AxisZ], 1.0f / direction[AxisZ]);
+		}
+	};
+
+	// Two sided to match gl_RayFlagsOpaqueEXT without culling
+	inline bool IntersectTriangle(const WatertightRay& ray, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2,
+		float tMin, float tMax, float& t, glm::vec2& barycentrics)
+	{
+		glm::vec3 a = v0 - ray.Origin;
+		glm::vec3 b = v1 - ray.Origin;
+		glm::vec3 c = v2 - ray.Origin;
+
+		float ax = a[ray.AxisX] - ray.Shear.x * a[ray.AxisZ];
+		float ay = a[ray.AxisY] - ray.Shear.y * a[ray.AxisZ];
+		float bx = b[ray.AxisX] - ray.Shear.x * b[ray.AxisZ];
+		float by = b[ray.AxisY] - ray.Shear.y * b[ray.AxisZ];
+		float cx = c[ray.AxisX] - ray.Shear.x * c[ray.AxisZ];
+		float cy = c[ray.AxisY] - ray.Shear.y * c[ray.AxisZ];
+
+		float u = cx * by - cy * bx;
+		float v = ax * cy - ay * cx;
+		float w = bx * ay - by * ax;
+
+		// Exactly on an edge in single precision, only double precision gives a consistent answer
+		if (u == 0.0f || v == 0.0f || w == 0.0f)
+		{
+			u = (float)((double)cx * by - (double)cy * bx);
+			v = (float)((double)ax * cy - (double)ay * cx);
+			w = (float)((double)bx * ay - (double)by * ax);
+		}
+
+		if ((u < 0.0f || v < 0.0f || w < 0.0f) && (u > 0.0f || v > 0.0f || w > 0.0f))
+			return false;
+
+		float det = u + v + w;
+		if (det == 0.0f)
+			return false;
+
+		float scaledDistance = u * ray.Shear.z * a[ray.AxisZ] + v * ray.Shear.z * b[ray.AxisZ] + w * ray.Shear.z * c[ray.AxisZ];
+		float invDet = 1.0f / det;
+		float distance = scaledDistance * invDet;
+		if (distance <= tMin || distance >= tMax)
+			return false;
+
+		t = distance;
+		barycentrics = glm::vec2(v, w) * invDet;
+		return true;
+	}
+
+	inline bool IntersectTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2,
+		float tMin, float tMax, float& t, glm::vec2& barycentrics)
+	{
+		return IntersectTriangle(WatertightRay(origin, direction), v0, v1, v2, tMin, tMax, t, barycentrics);
+	}
+
+	// Slab test, returns the entry distance or -1 when the box is missed
+	inline float IntersectAABB(const glm::vec3& origin, const glm::vec3& inverseDirection, const glm::vec3& boundsMin, const glm::vec3& boundsMax, float tMin, float tMax)
+	{
+		glm::vec3 t0 = (boundsMin - origin) * inverseDirection;
+		glm::vec3 t1 = (boundsMax - origin) * inverseDirection;
+		glm::vec3 tNear = glm::min(t0, t1);
+		glm::vec3 tFar = glm::max(t0, t1);
+
+		float entry = glm::max(tMin, glm::max(tNear.x, glm::max(tNear.y, tNear.z)));
+		float exit = glm::min(tMax, glm::min(tFar.x, glm::min(tFar.y, tFar.z)));
+
+		return entry <= exit ? entry : -1.0f;
+	}
+
+}
@@ -0,0 +1,345 @@
+#include "CPU/LightSampler.h"
+#include "CPU/Disney.h"
+
+using namespace VkLibrary;
+
+namespace CPU {
+
+	// Power over squared distance to the node, clamped to the node's own size so points inside or
+	// right next to it don't blow up. Must match LightBVHImportance in LightSampling.glsl.
+	static float Importance(const LightBVHNode& node, const glm::vec3& position)
+	{
+		glm::vec3 center = (node.BoundsMin + node.BoundsMax) * 0.5f;
+		glm::vec3 extent = node.BoundsMax - node.BoundsMin;
+		glm::vec3 toCenter = center - position;
+
+		float distanceSquared = glm::max(glm::dot(toCenter, toCenter), 0.25f * glm::dot(extent, extent));
+		return node.Power / glm::max(distanceSquared, 1e-12f);
+	}
+
+	LightSampler::LightSampler(const LightSamplerSpecification& specification)
+		: m_Specification(specification)
+	{
+	}
+
+	void LightSampler::Build(const Scene& scene)
+	{
+		m_Lights.clear();
+		m_AliasTable.clear();
+		m_BVHNodes.clear();
+		m_TotalPower = 0.0f;
+
+		const std::vector<Instance>& instances = scene.GetInstances();
+		const std::vector<Vertex>& vertices = scene.GetVertices();
+		const std::vector<uint32_t>& indices = scene.GetIndices();
+
+		m_LightIndices.assign(instances.size(), InvalidLight);
+
+		for (uint32_t instanceIndex = 0; instanceIndex < (uint32_t)instances.size(); instanceIndex++)
+		{
+			const Instance& instance = instances[instanceIndex];
+			const MaterialBuffer& material = scene.GetMaterials()[instance.MaterialIndex];
+
+			glm::vec3 emission = material.data.EmissiveValue * material.data.EmissiveStrength;
+			if (Luminance(emission) <= 0.0f)
+				continue;
+
+			uint32_t triangleCount = instance.IndexCount / 3;
+			uint32_t offset = (uint32_t)m_LightIndices.size();
+			m_LightIndices[instanceIndex] = offset;
+			m_LightIndices.resize(offset + triangleCount, InvalidLight);
+
+			for (uint32_t primitive = 0; primitive < triangleCount; primitive++)
+			{
+				glm::vec3 positions[3];
+				for (uint32_t corner = 0; corner < 3; corner++)
+				{
+					const Vertex& vertex = vertices[indices[instance.IndexOffset + primitive * 3 + corner] + instance.VertexOffset];
+					positions[corner] = glm::vec3(instance.ObjectToWorld * glm::vec4(vertex.Position, 1.0f));
+				}
+
+				EmissiveTriangle light;
+				light.V0 = positions[0];
+				light.Edge1 = positions[1] - positions[0];
+				light.Edge2 = positions[2] - positions[0];
+				light.Area = 0.5f * glm::length(glm::cross(light.Edge1, light.Edge2));
+				light.Emission = emission;
+				light.Power = Luminance(emission) * light.Area;
+				light.LeafNode = InvalidLight;
+				light.InstanceIndex = instanceIndex;
+
+				// Degenerate triangles can't be hit and can't be sampled
+				if (light.Power <= 0.0f)
+					continue;
+
+				m_LightIndices[offset + primitive] = (uint32_t)m_Lights.size();
+				m_Lights.push_back(light);
+				m_TotalPower += light.Power;
+			}
+		}
+
+		if (m_Lights.empty())
+		{
+			m_Mode = LightSamplingMode::None;
+			return;
+		}
+
+		if (m_Lights.size() <= m_Specification.BVHThreshold)
+		{
+			m_Mode = LightSamplingMode::AliasTable;
+			BuildAliasTable();
+		}
+		else
+		{
+			m_Mode = LightSamplingMode::BVH;
+			BuildBVH((uint32_t)instances.size());
+		}
+	}
+
+	void LightSampler::BuildAliasTable()
+	{
+		uint32_t count = (uint32_t)m_Lights.size();
+		m_AliasTable.resize(count);
+
+		// Vose's method, every entry is split between itself and one overfull entry
+		std::vector<float> scaled(count);
+		std::vector<uint32_t> small, large;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			scaled[i] = m_Lights[i].Power / m_TotalPower * count;
+			(scaled[i] < 1.0f ? small : large).push_back(i);
+		}
+
+		while (!small.empty() && !large.empty())
+		{
+			uint32_t less = small.back();
+			small.pop_back();
+			uint32_t more = large.back();
+			large.pop_back();
+
+			m_AliasTable[less] = { scaled[less], more };
+			scaled[more] = (scaled[more] + scaled[less]) - 1.0f;
+			(scaled[more] < 1.0f ? small : large).push_back(more);
+		}
+
+		// What is left is 1 up to rounding
+		for (uint32_t i : small)
+			m_AliasTable[i] = { 1.0f, i };
+		for (uint32_t i : large)
+			m_AliasTable[i] = { 1.0f, i };
+	}
+
+	void LightSampler::BuildBVH(uint32_t instanceCount)
+	{
+		uint32_t count = (uint32_t)m_Lights.size();
+
+		std::vector<glm::vec3> boundsMin(count), boundsMax(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const EmissiveTriangle& light = m_Lights[i];
+			glm::vec3 v1 = light.V0 + light.Edge1;
+			glm::vec3 v2 = light.V0 + light.Edge2;
+			boundsMin[i] = glm::min(light.V0, glm::min(v1, v2));
+			boundsMax[i] = glm::max(light.V0, glm::max(v1, v2));
+		}
+
+		BVH bvh;
+		bvh.Build(boundsMin, boundsMax);
+
+		// Lights are reordered so every leaf is a contiguous range
+		const std::vector<uint32_t>& order = bvh.GetPrimitiveIndices();
+		std::vector<EmissiveTriangle> lights(count);
+		std::vector<uint32_t> remap(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			lights[i] = m_Lights[order[i]];
+			remap[order[i]] = i;
+		}
+		m_Lights = std::move(lights);
+
+		// Only the per triangle entries after the instance offsets refer to lights
+		for (uint32_t i = instanceCount; i < (uint32_t)m_LightIndices.size(); i++)
+		{
+			if (m_LightIndices[i] != InvalidLight)
+				m_LightIndices[i] = remap[m_LightIndices[i]];
+		}
+
+		const std::vector<BVHNode>& nodes = bvh.GetNodes();
+		m_BVHNodes.resize(nodes.size());
+		for (uint32_t i = 0; i < (uint32_t)nodes.size(); i++)
+		{
+			LightBVHNode& node = m_BVHNodes[i];
+			node.BoundsMin = nodes[i].BoundsMin;
+			node.BoundsMax = nodes[i].BoundsMax;
+			node.LeftFirst = nodes[i].LeftFirst;
+			node.LightCount = nodes[i].PrimitiveCount;
+			node.Parent = InvalidLight;
+			node.Power = 0.0f;
+			node.Padding[0] = node.Padding[1] = 0;
+		}
+
+		// Children are always allocated after their parent, so walking backwards sums them first
+		for (uint32_t i = (uint32_t)m_BVHNodes.size(); i-- > 0;)
+		{
+			LightBVHNode& node = m_BVHNodes[i];
+			if (node.LightCount > 0)
+			{
+				for (uint32_t j = node.LeftFirst; j < node.LeftFirst + node.LightCount; j++)
+				{
+					m_Lights[j].LeafNode = i;
+					node.Power += m_Lights[j].Power;
+				}
+			}
+			else
+			{
+				m_BVHNodes[node.LeftFirst].Parent = i;
+				m_BVHNodes[node.LeftFirst + 1].Parent = i;
+				node.Power = m_BVHNodes[node.LeftFirst].Power + m_BVHNodes[node.LeftFirst + 1].Power;
+			}
+		}
+	}
+
+	uint32_t LightSampler::SelectLight(const glm::vec3& position, float u, float& selectionPdf) const
+	{
+		selectionPdf = 1.0f;
+
+		if (m_Mode == LightSamplingMode::AliasTable)
+		{
+			uint32_t count = (uint32_t)m_AliasTable.size();
+			float scaled = u * count;
+			uint32_t entry = glm::min((uint32_t)scaled, count - 1);
+			uint32_t lightIndex = scaled - entry < m_AliasTable[entry].Probability ? entry : m_AliasTable[entry].Alias;
+			selectionPdf = m_Lights[lightIndex].Power / m_TotalPower;
+			return lightIndex;
+		}
+
+		if (m_Mode != LightSamplingMode::BVH)
+			return InvalidLight;
+
+		// Walk down picking children by importance, reusing the random number at every level
+		uint32_t nodeIndex = 0;
+		while (m_BVHNodes[nodeIndex].LightCount == 0)
+		{
+			const LightBVHNode& node = m_BVHNodes[nodeIndex];
+			float left = Importance(m_BVHNodes[node.LeftFirst], position);
+			float right = Importance(m_BVHNodes[node.LeftFirst + 1], position);
+			if (left + right <= 0.0f)
+				return InvalidLight;
+
+			float leftProbability = left / (left + right);
+			if (u < leftProbability)
+			{
+				u = glm::min(u / leftProbability, 0.99999994f);
+				selectionPdf *= leftProbability;
+				nodeIndex = node.LeftFirst;
+			}
+			else
+			{
+				u = glm::min((u - leftProbability) / (1.0f - leftProbability), 0.99999994f);
+				selectionPdf *= 1.0f - leftProbability;
+				nodeIndex = node.LeftFirst + 1;
+			}
+		}
+
+		// Triangles within a leaf by power
+		const LightBVHNode& leaf = m_BVHNodes[nodeIndex];
+		float target = u * leaf.Power;
+		uint32_t lightIndex = leaf.LeftFirst + leaf.LightCount - 1;
+		for (uint32_t i = leaf.LeftFirst; i < leaf.LeftFirst + leaf.LightCount; i++)
+		{
+			target -= m_Lights[i].Power;
+			if (target < 0.0f)
+			{
+				lightIndex = i;
+				break;
+			}
+		}
+
+		selectionPdf *= m_Lights[lightIndex].Power / leaf.Power;
+		return lightIndex;
+	}
+
+	bool LightSampler::Sample(const glm::vec3& position, const glm::vec3& u, LightSampleRec& lightSample) const
+	{
+		float selectionPdf;
+		uint32_t lightIndex = SelectLight(position, u.x, selectionPdf);
+		if (lightIndex == InvalidLight)
+			return false;
+
+		// Uniform point on the triangle
+		const EmissiveTriangle& light = m_Lights[lightIndex];
+		float su = glm::sqrt(u.y);
+		glm::vec3 lightPosition = light.V0 + light.Edge1 * (su * (1.0f - u.z)) + light.Edge2 * (su * u.z);
+
+		glm::vec3 toLight = lightPosition - position;
+		float distanceSquared = glm::dot(toLight, toLight);
+		lightSample.dist = glm::sqrt(distanceSquared);
+		if (lightSample.dist < 1e-6f)
+			return false;
+
+		lightSample.direction = toLight / lightSample.dist;
+		lightSample.normal = glm::normalize(glm::cross(light.Edge1, light.Edge2));
+		lightSample.emission = light.Emission;
+
+		// Emitters are two sided, same as adding payload.Emission on any hit
+		float cosLight = glm::abs(glm::dot(lightSample.normal, lightSample.direction));
+		if (cosLight < 1e-6f)
+			return false;
+
+		lightSample.pdf = selectionPdf / light.Area * distanceSquared / cosLight;
+		return true;
+	}
+
+	float LightSampler::SelectionPdf(const glm::vec3& position, uint32_t lightIndex) const
+	{
+		if (lightIndex == InvalidLight || m_Mode == LightSamplingMode::None)
+			return 0.0f;
+
+		const EmissiveTriangle& light = m_Lights[lightIndex];
+		if (m_Mode == LightSamplingMode::AliasTable)
+			return light.Power / m_TotalPower;
+
+		// Product of the child probabilities on the way up to the root
+		uint32_t nodeIndex = light.LeafNode;
+		float pdf = light.Power / m_BVHNodes[nodeIndex].Power;
+		while (m_BVHNodes[nodeIndex].Parent != InvalidLight)
+		{
+			const LightBVHNode& parent = m_BVHNodes[m_BVHNodes[nodeIndex].Parent];
+			float left = Importance(m_BVHNodes[parent.LeftFirst], position);
+			float right = Importance(m_BVHNodes[parent.LeftFirst + 1], position);
+			if (left + right <= 0.0f)
+				return 0.0f;
+
+			pdf *= (nodeIndex == parent.LeftFirst ? left : right) / (left + right);
+			nodeIndex = m_BVHNodes[nodeIndex].Parent;
+		}
+
+		return pdf;
+	}
+
+	float LightSampler::Pdf(const glm::vec3& position, uint32_t lightIndex, const glm::vec3& lightPosition) const
+	{
+		float selectionPdf = SelectionPdf(position, lightIndex);
+		if (selectionPdf <= 0.0f)
+			return 0.0f;
+
+		const EmissiveTriangle& light = m_Lights[lightIndex];
+		glm::vec3 toLight = lightPosition - position;
+		float distanceSquared = glm::dot(toLight, toLight);
+		glm::vec3 normal = glm::normalize(glm::cross(light.Edge1, light.Edge2));
+		float cosLight = glm::abs(glm::dot(normal, toLight)) / glm::sqrt(distanceSquared);
+		if (cosLight < 1e-6f)
+			return 0.0f;
+
+		return selectionPdf / light.Area * distanceSquared / cosLight;
+	}
+
+	uint32_t LightSampler::GetLightIndex(uint32_t instanceIndex, uint32_t primitiveIndex) const
+	{
+		if (instanceIndex >= m_LightIndices.size() || m_LightIndices[instanceIndex] == InvalidLight)
+			return InvalidLight;
+
+		return m_LightIndices[m_LightIndices[instanceIndex] + primitiveIndex];
+	}
+
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include "CPU/Scene.h"
+#include <vector>
+
+namespace CPU {
+
+	struct LightSamplerSpecification
+	{
+		// Up to this many emissive triangles are picked from an alias table by power alone, more
+		// than that go into a light BVH that also accounts for distance to the shading point
+		uint32_t BVHThreshold = 64;
+	};
+
+	enum class LightSamplingMode : uint32_t
+	{
+		None = 0, AliasTable, BVH
+	};
+
+	// World space emissive triangle. Same layout as LightTriangle in LightSampling.glsl.
+	struct EmissiveTriangle
+	{
+		glm::vec3 V0;
+		float Area;
+		glm::vec3 Edge1;
+		float Power;
+		glm::vec3 Edge2;
+		uint32_t LeafNode; // Light BVH leaf holding the triangle, unused with the alias table
+		glm::vec3 Emission;
+		uint32_t InstanceIndex;
+	};
+
+	// Vose alias table entry, same layout as AliasEntry in LightSampling.glsl
+	struct AliasEntry
+	{
+		float Probability;
+		uint32_t Alias;
+	};
+
+	// Same layout as LightBVHNode in LightSampling.glsl. Children of interior nodes are LeftFirst and
+	// LeftFirst + 1, leaves hold LightCount triangles from LeftFirst on.
+	struct LightBVHNode
+	{
+		glm::vec3 BoundsMin;
+		float Power;
+		glm::vec3 BoundsMax;
+		uint32_t LeftFirst;
+		uint32_t LightCount; // 0 for interior nodes
+		uint32_t Parent;
+		uint32_t Padding[2];
+	};
+
+	// Picks a point on an emissive triangle for next event estimation, the CPU side of
+	// LightSampling.glsl. Triangles of every material with a nonzero emission are collected in
+	// world space, so the sampler has to be rebuilt when emissive materials or instances change.
+	class LightSampler
+	{
+	public:
+		static constexpr uint32_t InvalidLight = 0xFFFFFFFF;
+
+		LightSampler(const LightSamplerSpecification& specification = LightSamplerSpecification());
+
+		void Build(const Scene& scene);
+
+		// u.x picks the triangle, u.y and u.z the point on it. The pdf of the sample is per solid angle
+		// from position. Returns false when there is nothing to sample.
+		bool Sample(const glm::vec3& position, const glm::vec3& u, LightSampleRec& lightSample) const;
+
+		// Triangle part of Sample, InvalidLight when there is nothing to pick
+		uint32_t SelectLight(const glm::vec3& position, float u, float& selectionPdf) const;
+
+		// Solid angle pdf of Sample picking lightPosition on the given light from position
+		float Pdf(const glm::vec3& position, uint32_t lightIndex, const glm::vec3& lightPosition) const;
+
+		// Probability of Sample picking the light at all
+		float SelectionPdf(const glm::vec3& position, uint32_t lightIndex) const;
+
+		// InvalidLight for triangles that don't emit
+		uint32_t GetLightIndex(uint32_t instanceIndex, uint32_t primitiveIndex) const;
+
+		LightSamplingMode GetMode() const { return m_Mode; }
+		uint32_t GetLightCount() const { return (uint32_t)m_Lights.size(); }
+		float GetTotalPower() const { return m_TotalPower; }
+
+		const std::vector<EmissiveTriangle>& GetLights() const { return m_Lights; }
+		const std::vector<AliasEntry>& GetAliasTable() const { return m_AliasTable; }
+		const std::vector<LightBVHNode>& GetBVHNodes() const { return m_BVHNodes; }
+
+		// One entry per instance with InvalidLight or the offset of its table, then per triangle light indices
+		const std::vector<uint32_t>& GetLightIndices() const { return m_LightIndices; }
+
+	private:
+		void BuildAliasTable();
+		void BuildBVH(uint32_t instanceCount);
+
+	private:
+		LightSamplerSpecification m_Specification;
+		LightSamplingMode m_Mode = LightSamplingMode::None;
+
+		std::vector<EmissiveTriangle> m_Lights;
+		std::vector<AliasEntry> m_AliasTable;
+		std::vector<LightBVHNode> m_BVHNodes;
+		std::vector<uint32_t> m_LightIndices;
+		float m_TotalPower = 0.0f;
+	};
+
+}
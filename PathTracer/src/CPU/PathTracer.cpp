@@ -0,0 +1,355 @@
+#include "CPU/PathTracer.h"
+#include "CPU/Disney.h"
+#include "CPU/Sampling.h"
+#include "CPU/ThreadPool.h"
+
+using namespace VkLibrary;
+
+namespace CPU {
+
+	Ray GenerateCameraRay(const CameraBuffer& camera, const glm::vec2& pixelCenter, uint32_t width, uint32_t height)
+	{
+		glm::vec2 inUV = pixelCenter / glm::vec2((float)width, (float)height);
+		glm::vec2 d = inUV * 2.0f - 1.0f;
+
+		glm::vec4 target = camera.InverseProjection * glm::vec4(d.x, d.y, 1.0f, 1.0f);
+		glm::vec4 direction = camera.InverseView * glm::vec4(glm::normalize(glm::vec3(target) / target.w), 0.0f);
+
+		Ray ray;
+		ray.Origin = glm::vec3(camera.InverseView[3]);
+		ray.Direction = glm::normalize(glm::vec3(direction));
+		return ray;
+	}
+
+	PathTracer::PathTracer(const PathTracerSpecification& specification, const Ref<Scene>& scene)
+		: m_Specification(specification), m_Scene(scene), m_AdaptiveSampler(specification.AdaptiveSamplingSpec),
+		m_LightSampler(specification.LightSamplerSpec), m_Reprojector(specification.ReprojectionSpec)
+	{
+		Resize(specification.Width, specification.Height);
+		RebuildLights();
+
+		if (specification.Wavefront)
+			m_WavefrontIntegrator = CreateRef<WavefrontIntegrator>(scene, specification.WavefrontSpec);
+	}
+
+	void PathTracer::Resize(uint32_t width, uint32_t height)
+	{
+		m_Specification.Width = width;
+		m_Specification.Height = height;
+
+		m_AccumulationBuffer.assign((size_t)width * height, glm::vec4(0.0f));
+		m_Image.assign((size_t)width * height, glm::vec4(0.0f));
+		m_MomentsBuffer.assign((size_t)width * height, glm::vec4(0.0f));
+
+		if (WritesAOVs())
+		{
+			m_AlbedoBuffer.assign((size_t)width * height, glm::vec4(1.0f));
+			m_NormalDepthBuffer.assign((size_t)width * height, glm::vec4(0.0f));
+		}
+
+		m_AdaptiveSampler.Resize(width, height);
+		if (m_Specification.Reprojection)
+			m_Reprojector.Resize(width, height);
+	}
+
+	void PathTracer::SetAccumulation(const std::vector<glm::vec4>& accumulation)
+	{
+		m_AccumulationBuffer = accumulation;
+		m_MomentsBuffer.assign(accumulation.size(), glm::vec4(0.0f));
+	}
+
+	void PathTracer::RebuildLights()
+	{
+		m_LightSampler.Build(*m_Scene);
+	}
+
+	void PathTracer::Render(const CameraBuffer& camera, uint32_t frameIndex)
+	{
+		// The history has to be kept before the AOVs of the new camera replace the previous ones
+		m_Reprojected = m_Specification.Reprojection && !m_WavefrontIntegrator && frameIndex > 1 &&
+			(camera.ViewProjection != m_LastCamera.ViewProjection || camera.InverseView != m_LastCamera.InverseView);
+		if (m_Reprojected)
+			m_Reprojector.StoreHistory(m_LastCamera, m_AccumulationBuffer, m_MomentsBuffer, m_NormalDepthBuffer);
+		m_LastCamera = camera;
+
+		if (WritesAOVs())
+			RenderAOVs(camera);
+
+		if (m_WavefrontIntegrator)
+		{
+			m_WavefrontIntegrator->Render(m_Specification, camera, frameIndex, m_AccumulationBuffer, m_MomentsBuffer, m_Image);
+			m_LastSampleCount = (uint64_t)m_Specification.Width * m_Specification.Height * m_Specification.SamplesPerPixel;
+			return;
+		}
+
+		uint32_t tileSize = m_Specification.TileSize;
+		uint32_t tilesX = (m_Specification.Width + tileSize - 1) / tileSize;
+		uint32_t tilesY = (m_Specification.Height + tileSize - 1) / tileSize;
+
+		// Every pixel needs new paths after a move, the tile errors are of the previous camera
+		if (m_Specification.AdaptiveSampling && !m_Reprojected)
+		{
+			m_AdaptiveSampler.EstimateErrors(m_AccumulationBuffer, m_MomentsBuffer);
+			m_AdaptiveSampler.Schedule(frameIndex);
+			m_LastSampleCount = m_AdaptiveSampler.GetScheduledSampleCount();
+		}
+		else
+		{
+			m_LastSampleCount = (uint64_t)m_Specification.Width * m_Specification.Height * m_Specification.SamplesPerPixel;
+		}
+
+		ThreadPool::Get().ParallelFor(tilesX * tilesY, [&](uint32_t tileIndex)
+		{
+			RenderTile(tileIndex, camera, frameIndex);
+		});
+
+		if (m_Reprojected)
+			m_Reprojector.Reproject(camera, m_NormalDepthBuffer, m_AccumulationBuffer, m_MomentsBuffer, m_Image);
+	}
+
+	void PathTracer::RenderTile(uint32_t tileIndex, const CameraBuffer& camera, uint32_t frameIndex)
+	{
+		uint32_t tileSize = m_Specification.TileSize;
+		uint32_t tilesX = (m_Specification.Width + tileSize - 1) / tileSize;
+
+		uint32_t startX = (tileIndex % tilesX) * tileSize;
+		uint32_t startY = (tileIndex / tilesX) * tileSize;
+		uint32_t endX = glm::min(startX + tileSize, m_Specification.Width);
+		uint32_t endY = glm::min(startY + tileSize, m_Specification.Height);
+
+		for (uint32_t y = startY; y < endY; y++)
+		{
+			for (uint32_t x = startX; x < endX; x++)
+			{
+				uint32_t sampleCount = m_Specification.SamplesPerPixel;
+				if (m_Specification.AdaptiveSampling && !m_Reprojected)
+				{
+					// Converged tiles get no samples and keep their accumulated result
+					sampleCount = m_AdaptiveSampler.GetTileSamples(m_AdaptiveSampler.GetTileIndex(x, y));
+					if (sampleCount == 0)
+						continue;
+				}
+
+				RenderPixel(x, y, camera, frameIndex, sampleCount);
+			}
+		}
+	}
+
+	void PathTracer::RenderPixel(uint32_t x, uint32_t y, const CameraBuffer& camera, uint32_t frameIndex, uint32_t sampleCount)
+	{
+		uint32_t width = m_Specification.Width;
+		uint32_t height = m_Specification.Height;
+		uint32_t pixelIndex = x + y * width;
+
+		// Adaptive sampling can give a pixel up to MaxSamplesPerFrame, every frame keeps room for that many
+		uint32_t stride = m_Specification.SamplesPerPixel;
+		if (m_Specification.AdaptiveSampling)
+			stride = glm::max(stride, m_Specification.AdaptiveSamplingSpec.MaxSamplesPerFrame);
+
+		glm::vec3 color = glm::vec3(0.0f);
+		float moment = 0.0f;
+
+		for (uint32_t i = 0; i < sampleCount; i++)
+		{
+			PixelSampler sampler = BeginPixelSample(m_Specification.Sampler, x, y, width, SampleIndex(frameIndex, stride, i), m_Specification.Seed);
+
+			glm::vec2 pixelCenter = glm::vec2((float)x, (float)y) + glm::vec2(0.5f);
+
+			// The first sample goes through the pixel center, same as the AOVs
+			if (i > 0)
+				pixelCenter += PointInCircle(glm::vec2(SampleDimensions(sampler, SAMPLE_SET_PIXEL)));
+
+			glm::vec3 pathColor = TracePath(GenerateCameraRay(camera, pixelCenter, width, height), sampler);
+			color += pathColor;
+			moment += Luminance(pathColor) * Luminance(pathColor);
+		}
+
+		float numPaths = (float)sampleCount;
+		glm::vec4& accumulation = m_AccumulationBuffer[pixelIndex];
+		if (m_Reprojected)
+		{
+			// Only the paths of this frame, the Reprojector adds the history
+			accumulation = glm::vec4(color, numPaths);
+			m_MomentsBuffer[pixelIndex] = glm::vec4(moment, 0.0f, 0.0f, 0.0f);
+		}
+		else if (frameIndex > 1)
+		{
+			// W component is the numPaths
+			color += glm::vec3(accumulation);
+			numPaths = accumulation.w + (float)sampleCount;
+
+			accumulation = glm::vec4(color, numPaths);
+			m_MomentsBuffer[pixelIndex].x += moment;
+		}
+		else
+		{
+			// On the first frame, fill the accumulation image with black (same as RayGen.glsl)
+			accumulation = glm::vec4(0.0f);
+			m_MomentsBuffer[pixelIndex] = glm::vec4(0.0f);
+		}
+
+		color /= numPaths;
+
+		if (glm::any(glm::isnan(color)))
+			m_Image[pixelIndex] = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+		else
+			m_Image[pixelIndex] = glm::vec4(color, 1.0f);
+	}
+
+	void PathTracer::RenderAOVs(const CameraBuffer& camera)
+	{
+		uint32_t width = m_Specification.Width;
+		uint32_t height = m_Specification.Height;
+
+		// Same ray as the first sample of RenderPixel, so the buffers match what the first bounce of TracePath sees
+		ThreadPool::Get().ParallelFor(height, [&](uint32_t y)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				uint32_t pixelIndex = x + y * width;
+				Ray ray = GenerateCameraRay(camera, glm::vec2((float)x, (float)y) + glm::vec2(0.5f), width, height);
+
+				Hit hit;
+				if (!m_Scene->Intersect(ray, hit))
+				{
+					m_AlbedoBuffer[pixelIndex] = glm::vec4(1.0f);
+					m_NormalDepthBuffer[pixelIndex] = glm::vec4(0.0f);
+					continue;
+				}
+
+				Payload payload;
+				m_Scene->FillPayload(ray, hit, payload);
+				m_AlbedoBuffer[pixelIndex] = glm::vec4(payload.Albedo, 1.0f);
+				m_NormalDepthBuffer[pixelIndex] = glm::vec4(payload.WorldNormal, payload.Distance);
+			}
+		});
+	}
+
+	glm::vec3 PathTracer::DirectLight(const Payload& payload, const glm::vec3& V, const glm::vec3& ffNormal, const glm::vec3& u) const
+	{
+		LightSampleRec lightSample;
+		if (!m_LightSampler.Sample(payload.WorldPosition, u, lightSample))
+			return glm::vec3(0.0f);
+
+		float bsdfPdf;
+		glm::vec3 f = DisneyEval(payload, V, ffNormal, lightSample.direction, bsdfPdf);
+		if (bsdfPdf <= 0.0f)
+			return glm::vec3(0.0f);
+
+		const float EPS = 0.0003f;
+		Ray shadowRay;
+		shadowRay.Origin = payload.WorldPosition + lightSample.direction * EPS;
+		shadowRay.Direction = lightSample.direction;
+		shadowRay.TMax = lightSample.dist - 2.0f * EPS;
+		if (m_Scene->Occluded(shadowRay))
+			return glm::vec3(0.0f);
+
+		return f * lightSample.emission * PowerHeuristic(lightSample.pdf, bsdfPdf) / lightSample.pdf;
+	}
+
+	glm::vec3 PathTracer::EnvironmentLight(const Payload& payload, const glm::vec3& V, const glm::vec3& ffNormal, const glm::vec2& u) const
+	{
+		const EnvironmentMap& environment = *m_Specification.Environment;
+		float lightPdf;
+		glm::vec3 L = environment.Sample(u, lightPdf);
+		if (lightPdf <= 0.0f)
+			return glm::vec3(0.0f);
+
+		float bsdfPdf;
+		glm::vec3 f = DisneyEval(payload, V, ffNormal, L, bsdfPdf);
+		if (bsdfPdf <= 0.0f)
+			return glm::vec3(0.0f);
+
+		const float EPS = 0.0003f;
+		Ray shadowRay;
+		shadowRay.Origin = payload.WorldPosition + L * EPS;
+		shadowRay.Direction = L;
+		if (m_Scene->Occluded(shadowRay))
+			return glm::vec3(0.0f);
+
+		return f * environment.Eval(L) * PowerHeuristic(lightPdf, bsdfPdf) / lightPdf;
+	}
+
+	glm::vec3 PathTracer::TracePath(Ray ray, const PixelSampler& sampler) const
+	{
+		glm::vec3 radiance = glm::vec3(0.0f);
+		glm::vec3 throughput = glm::vec3(1.0f);
+
+		bool nextEventEstimation = m_Specification.NextEventEstimation && m_LightSampler.GetMode() != LightSamplingMode::None;
+		const EnvironmentMap* environment = m_Specification.Environment && m_Specification.Environment->IsValid() ? m_Specification.Environment.get() : nullptr;
+		bool environmentSampling = environment && m_Specification.EnvironmentSampling;
+
+		ScatterSampleRec scatterSample;
+		Payload payload;
+		Hit hit;
+		glm::vec3 scatterPosition;
+
+		for (uint32_t bounceIndex = 0; bounceIndex < m_Specification.MaxBounces; bounceIndex++)
+		{
+			// MISS
+			if (!m_Scene->Intersect(ray, hit))
+			{
+				if (!environment)
+				{
+					radiance += m_Specification.SkyColor * throughput;
+					break;
+				}
+
+				// Same as emitters, the previous bounce's environment sample could have found this direction too
+				float misWeight = 1.0f;
+				if (environmentSampling && bounceIndex > 0)
+					misWeight = PowerHeuristic(scatterSample.pdf, environment->Pdf(ray.Direction));
+
+				radiance += environment->Eval(ray.Direction) * throughput * misWeight;
+				break;
+			}
+
+			m_Scene->FillPayload(ray, hit, payload);
+
+			// Emitters reached by BSDF sampling could also have been picked by the previous bounce's light sample
+			float misWeight = 1.0f;
+			if (nextEventEstimation && bounceIndex > 0)
+			{
+				uint32_t lightIndex = m_LightSampler.GetLightIndex(payload.InstanceIndex, payload.PrimitiveIndex);
+				if (lightIndex != LightSampler::InvalidLight)
+					misWeight = PowerHeuristic(scatterSample.pdf, m_LightSampler.Pdf(scatterPosition, lightIndex, payload.WorldPosition));
+			}
+
+			radiance += payload.Emission * throughput * misWeight;
+
+			// Sample BSDF for color and outgoing direction
+			glm::vec3 ffNormal = glm::dot(-ray.Direction, payload.WorldNormal) < 0.0f ? -payload.WorldNormal : payload.WorldNormal;
+
+			// Next event estimation
+			if (nextEventEstimation)
+			{
+				glm::vec3 u = glm::vec3(SampleDimensions(sampler, BounceSampleSet(bounceIndex, BOUNCE_SET_LIGHT)));
+				radiance += DirectLight(payload, -ray.Direction, ffNormal, u) * throughput;
+			}
+
+			if (environmentSampling)
+			{
+				glm::vec2 u = glm::vec2(SampleDimensions(sampler, BounceSampleSet(bounceIndex, BOUNCE_SET_ENVIRONMENT)));
+				radiance += EnvironmentLight(payload, -ray.Direction, ffNormal, u) * throughput;
+			}
+
+			glm::vec3 u = glm::vec3(SampleDimensions(sampler, BounceSampleSet(bounceIndex, BOUNCE_SET_BSDF)));
+			scatterSample.f = DisneySample(payload, -ray.Direction, ffNormal, scatterSample.L, scatterSample.pdf, u);
+			if (scatterSample.pdf > 0.0f)
+				throughput *= scatterSample.f / scatterSample.pdf;
+			else
+				break;
+
+			// Move ray origin to hit point and set direction for next bounce
+			glm::vec3 fhp = ray.Origin + ray.Direction * payload.Distance;
+
+			ray.Direction = scatterSample.L;
+			const float EPS = 0.0003f;
+			ray.Origin = fhp + ray.Direction * EPS;
+			scatterPosition = payload.WorldPosition;
+		}
+
+		return radiance;
+	}
+
+}
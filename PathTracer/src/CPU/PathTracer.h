@@ -0,0 +1,148 @@
+#pragma once
+#include "CPU/Scene.h"
+#include "CPU/AdaptiveSampling.h"
+#include "CPU/Wavefront.h"
+#include "CPU/LightSampler.h"
+#include "CPU/EnvironmentMap.h"
+#include "CPU/Reprojection.h"
+#include "CPU/Sampler.h"
+#include "ShaderBuffers.h"
+
+namespace CPU {
+
+	struct PathTracerSpecification
+	{
+		uint32_t Width = 1;
+		uint32_t Height = 1;
+		uint32_t TileSize = 32;
+
+		// Must match SAMPLE_COUNT and MAX_BOUNCES in RayGen.glsl for side by side comparisons
+		uint32_t SamplesPerPixel = 5;
+		uint32_t MaxBounces = 20;
+
+		// Decorrelates renders of the same frame indices, 0 matches RayGen.glsl
+		uint32_t Seed = 0;
+
+		// Sequence the camera jitter, light, environment and BSDF samples are drawn from, see Sampler.h.
+		// Not used by the WavefrontIntegrator.
+		SamplerType Sampler = SamplerType::Sobol;
+
+		// Per tile sample counts from the variance of the accumulated result, see AdaptiveSampling.h
+		bool AdaptiveSampling = false;
+		AdaptiveSamplingSpecification AdaptiveSamplingSpec;
+
+		// Render with the stage by stage WavefrontIntegrator instead of one TracePath per sample,
+		// samples every pixel uniformly so AdaptiveSampling is ignored
+		bool Wavefront = false;
+		WavefrontSpecification WavefrontSpec;
+
+		// Sample an emissive triangle at every bounce and combine it with BSDF sampling by multiple
+		// importance sampling. Not supported by the WavefrontIntegrator.
+		bool NextEventEstimation = true;
+		LightSamplerSpecification LightSamplerSpec;
+
+		// Misses return the environment's radiance when set, SkyColor otherwise
+		VkLibrary::Ref<EnvironmentMap> Environment;
+		glm::vec3 SkyColor = { 0.7f, 0.75f, 0.95f };
+
+		// Sample a direction from the environment at every bounce and combine it with BSDF sampling
+		// by multiple importance sampling. Not supported by the WavefrontIntegrator.
+		bool EnvironmentSampling = true;
+
+		// Fill the albedo and normal + depth buffers of the first hit through every pixel center for the Denoiser
+		bool WriteAOVs = false;
+
+		// Keep the accumulated paths when the camera moves between frames by reprojecting them through the
+		// first hits, see Reprojection.h. Fills the AOV buffers as well. Not supported by the WavefrontIntegrator.
+		bool Reprojection = false;
+		ReprojectionSpecification ReprojectionSpec;
+	};
+
+	// Primary ray through pixelCenter (in pixels), same as main() in RayGen.glsl
+	Ray GenerateCameraRay(const CameraBuffer& camera, const glm::vec2& pixelCenter, uint32_t width, uint32_t height);
+
+	// CPU implementation of RayGen.glsl. Renders the image in tiles on the work-stealing
+	// thread pool and keeps the same sum + path count layout as o_AccumulationImage.
+	class PathTracer
+	{
+	public:
+		PathTracer(const PathTracerSpecification& specification, const VkLibrary::Ref<Scene>& scene);
+
+		void Resize(uint32_t width, uint32_t height);
+
+		// Continues from a saved accumulation buffer of the current size, such as a RenderCheckpoint tile.
+		// The moments start over.
+		void SetAccumulation(const std::vector<glm::vec4>& accumulation);
+
+		// Decorrelates the next frames from earlier renders of the same frame indices
+		void SetSeed(uint32_t seed) { m_Specification.Seed = seed; }
+
+		// Equivalent of one vkCmdTraceRaysKHR dispatch with u_SceneData.FrameIndex == frameIndex. With
+		// Reprojection a camera that differs from the last frame's is followed by the Reproject.glsl passes.
+		void Render(const CameraBuffer& camera, uint32_t frameIndex);
+
+		glm::vec3 TracePath(Ray ray, const PixelSampler& sampler) const;
+
+		// Collects the emissive triangles again, call after emissive materials or instance transforms changed
+		void RebuildLights();
+
+		const std::vector<glm::vec4>& GetAccumulationBuffer() const { return m_AccumulationBuffer; }
+		const std::vector<glm::vec4>& GetImage() const { return m_Image; }
+
+		// Sum of squared sample luminances in x, same layout as o_MomentsImage
+		const std::vector<glm::vec4>& GetMomentsBuffer() const { return m_MomentsBuffer; }
+
+		// First hit albedo and world normal + hit distance (0 for misses), same layout as o_AlbedoImage
+		// and o_NormalDepthImage. Only filled when the specification enables WriteAOVs or Reprojection.
+		const std::vector<glm::vec4>& GetAlbedoBuffer() const { return m_AlbedoBuffer; }
+		const std::vector<glm::vec4>& GetNormalDepthBuffer() const { return m_NormalDepthBuffer; }
+
+		const AdaptiveSampler& GetAdaptiveSampler() const { return m_AdaptiveSampler; }
+		const LightSampler& GetLightSampler() const { return m_LightSampler; }
+		const Reprojector& GetReprojector() const { return m_Reprojector; }
+
+		// Whether the last Render reprojected the history of a different camera
+		bool HasReprojected() const { return m_Reprojected; }
+
+		// Null unless the specification enables Wavefront
+		const VkLibrary::Ref<WavefrontIntegrator>& GetWavefrontIntegrator() const { return m_WavefrontIntegrator; }
+
+		// Paths traced by the last Render
+		uint64_t GetLastSampleCount() const { return m_LastSampleCount; }
+
+		const PathTracerSpecification& GetSpecification() const { return m_Specification; }
+		const VkLibrary::Ref<Scene>& GetScene() const { return m_Scene; }
+
+	private:
+		void RenderTile(uint32_t tileIndex, const CameraBuffer& camera, uint32_t frameIndex);
+		void RenderPixel(uint32_t x, uint32_t y, const CameraBuffer& camera, uint32_t frameIndex, uint32_t sampleCount);
+		bool WritesAOVs() const { return m_Specification.WriteAOVs || m_Specification.Reprojection; }
+		void RenderAOVs(const CameraBuffer& camera);
+
+		// Light sample contribution at a surface hit, without the path throughput
+		glm::vec3 DirectLight(const Payload& payload, const glm::vec3& V, const glm::vec3& ffNormal, const glm::vec3& u) const;
+
+		// Environment sample contribution at a surface hit, without the path throughput
+		glm::vec3 EnvironmentLight(const Payload& payload, const glm::vec3& V, const glm::vec3& ffNormal, const glm::vec2& u) const;
+
+	private:
+		PathTracerSpecification m_Specification;
+		VkLibrary::Ref<Scene> m_Scene;
+
+		std::vector<glm::vec4> m_AccumulationBuffer;
+		std::vector<glm::vec4> m_Image;
+		std::vector<glm::vec4> m_MomentsBuffer;
+		std::vector<glm::vec4> m_AlbedoBuffer;
+		std::vector<glm::vec4> m_NormalDepthBuffer;
+
+		AdaptiveSampler m_AdaptiveSampler;
+		LightSampler m_LightSampler;
+		VkLibrary::Ref<WavefrontIntegrator> m_WavefrontIntegrator;
+
+		Reprojector m_Reprojector;
+		CameraBuffer m_LastCamera = {};
+		bool m_Reprojected = false;
+		uint64_t m_LastSampleCount = 0;
+	};
+
+}
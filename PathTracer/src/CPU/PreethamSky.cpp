@@ -0,0 +1,498 @@
+#include "CPU/PreethamSky.h"
+#include "CPU/ThreadPool.h"
+#include "CPU/Globals.h"
+#include "Util/Half.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+	#define PREETHAM_X86 1
+	#include <immintrin.h>
+#else
+	#define PREETHAM_X86 0
+#endif
+
+namespace CPU {
+
+	// Below the horizon the sky keeps its horizon color, cos(theta) of 0 would divide by zero
+	static constexpr float s_MinCosTheta = 1e-3f;
+
+	// Same scale as the old shader applied to the luminance
+	static constexpr float s_Scale = 0.05f;
+
+	// Texel quads tested per face axis when picking the resolution, plus this many around the sun
+	static constexpr uint32_t s_ErrorSamples = 32;
+	static constexpr uint32_t s_SunErrorSamples = 8;
+
+	// CIE XYZ to linear RGB, the rows of XYZ * M in PreethamSky.glsl
+	static constexpr float s_XYZToRGB[3][3] =
+	{
+		{  2.3706743f, -0.9000405f, -0.4706338f },
+		{ -0.5138850f,  1.4253036f,  0.0885814f },
+		{  0.0052982f, -0.0146949f,  1.0093968f }
+	};
+
+	// Abramowitz and Stegun 4.4.46, acos on [0, 1] within 2e-8
+	static constexpr float s_AcosCoefficients[8] =
+	{
+		1.5707963050f, -0.2145988016f, 0.0889789874f, -0.0501743046f, 0.0308918810f, -0.0170881256f, 0.0066700901f, -0.0012624911f
+	};
+
+	// Cephes expf, the same as the denoiser's with an upper clamp
+	static float ExpApprox(float x)
+	{
+		x = std::min(std::max(x, -87.0f), 88.0f);
+
+		float fx = std::floor(x * 1.44269504088896341f + 0.5f);
+
+		x = x - fx * 0.693359375f;
+		x = x - fx * -2.12194440e-4f;
+
+		float y = 1.9875691500e-4f;
+		y = y * x + 1.3981999507e-3f;
+		y = y * x + 8.3334519073e-3f;
+		y = y * x + 4.1665795894e-2f;
+		y = y * x + 1.6666665459e-1f;
+		y = y * x + 5.0000001201e-1f;
+		y = y * x * x + x + 1.0f;
+
+		uint32_t bits = (uint32_t)((int32_t)fx + 127) << 23;
+		float exponent;
+		memcpy(&exponent, &bits, sizeof(float));
+		return y * exponent;
+	}
+
+	static float AcosApprox(float x)
+	{
+		float p = s_AcosCoefficients[7];
+		for (int i = 6; i >= 0; i--)
+			p = p * x + s_AcosCoefficients[i];
+		return std::sqrt(1.0f - x) * p;
+	}
+
+	static glm::vec3 Perez(float theta, float gamma, const glm::vec3& A, const glm::vec3& B, const glm::vec3& C, const glm::vec3& D, const glm::vec3& E)
+	{
+		float cosGamma = std::cos(gamma);
+		return (1.0f + A * glm::exp(B / std::cos(theta))) * (1.0f + C * glm::exp(D * gamma) + E * cosGamma * cosGamma);
+	}
+
+	PreethamSkyCoefficients ComputePreethamSkyCoefficients(const PreethamSkySettings& settings)
+	{
+		float t = settings.Turbidity;
+
+		glm::vec3 A = {  0.1787f * t - 1.4630f, -0.0193f * t - 0.2592f, -0.0167f * t - 0.2608f };
+		glm::vec3 B = { -0.3554f * t + 0.4275f, -0.0665f * t + 0.0008f, -0.0950f * t + 0.0092f };
+		glm::vec3 C = { -0.0227f * t + 5.3251f, -0.0004f * t + 0.2125f, -0.0079f * t + 0.2102f };
+		glm::vec3 D = {  0.1206f * t - 2.5771f, -0.0641f * t - 0.8989f, -0.0441f * t - 1.6537f };
+		glm::vec3 E = { -0.0670f * t + 0.3703f, -0.0033f * t + 0.0452f, -0.0109f * t + 0.0529f };
+
+		glm::vec3 sun = glm::normalize(glm::vec3(std::sin(settings.Inclination) * std::cos(settings.Azimuth), std::cos(settings.Inclination),
+			std::sin(settings.Inclination) * std::sin(settings.Azimuth)));
+		float thetaS = std::acos(std::max(sun.y, 0.0f));
+
+		// Zenith luminance and chromaticity
+		float chi = (4.0f / 9.0f - t / 120.0f) * (PI - 2.0f * thetaS);
+		float Yz = (4.0453f * t - 4.9710f) * std::tan(chi) - 0.2155f * t + 2.4192f;
+
+		float theta2 = thetaS * thetaS;
+		float theta3 = theta2 * thetaS;
+		float t2 = t * t;
+
+		float xz =
+			( 0.00165f * theta3 - 0.00375f * theta2 + 0.00209f * thetaS + 0.0f)     * t2 +
+			(-0.02903f * theta3 + 0.06377f * theta2 - 0.03202f * thetaS + 0.00394f) * t +
+			( 0.11693f * theta3 - 0.21196f * theta2 + 0.06052f * thetaS + 0.25886f);
+
+		float yz =
+			( 0.00275f * theta3 - 0.00610f * theta2 + 0.00317f * thetaS + 0.0f)     * t2 +
+			(-0.04214f * theta3 + 0.08970f * theta2 - 0.04153f * thetaS + 0.00516f) * t +
+			( 0.15346f * theta3 - 0.26756f * theta2 + 0.06670f * thetaS + 0.26688f);
+
+		glm::vec3 zenith = glm::vec3(Yz, xz, yz) / Perez(0.0f, thetaS, A, B, C, D, E);
+
+		PreethamSkyCoefficients coefficients;
+		coefficients.A = glm::vec4(A, 0.0f);
+		coefficients.B = glm::vec4(B, 0.0f);
+		coefficients.C = glm::vec4(C, 0.0f);
+		coefficients.D = glm::vec4(D, 0.0f);
+		coefficients.E = glm::vec4(E, 0.0f);
+		coefficients.Zenith = glm::vec4(zenith, 0.0f);
+		coefficients.SunDirection = glm::vec4(sun, 0.0f);
+		return coefficients;
+	}
+
+	glm::vec3 EvaluatePreethamSky(const PreethamSkyCoefficients& c, const glm::vec3& direction)
+	{
+		float cosTheta = std::max(direction.y, s_MinCosTheta);
+		float cosGamma = std::min(std::max(c.SunDirection.x * direction.x + c.SunDirection.y * direction.y + c.SunDirection.z * direction.z, 0.0f), 1.0f);
+		float gamma = AcosApprox(cosGamma);
+		float cosGamma2 = cosGamma * cosGamma;
+
+		// Y, x and y of the sky
+		float Yxy[3];
+		for (int i = 0; i < 3; i++)
+		{
+			float f = (1.0f + c.A[i] * ExpApprox(c.B[i] / cosTheta)) * (1.0f + c.C[i] * ExpApprox(c.D[i] * gamma) + c.E[i] * cosGamma2);
+			Yxy[i] = c.Zenith[i] * f;
+		}
+
+		float Yy = Yxy[0] / Yxy[2];
+		float XYZ[3] = { Yxy[1] * Yy, Yxy[0], (1.0f - Yxy[1] - Yxy[2]) * Yy };
+
+		glm::vec3 rgb;
+		for (int i = 0; i < 3; i++)
+			rgb[i] = (XYZ[0] * s_XYZToRGB[i][0] + XYZ[1] * s_XYZToRGB[i][1] + XYZ[2] * s_XYZToRGB[i][2]) * s_Scale;
+		return rgb;
+	}
+
+	// u and v in [-1, 1], v up
+	static glm::vec3 FaceDirection(uint32_t face, float u, float v)
+	{
+		glm::vec3 d;
+		switch (face)
+		{
+			case 0:  d = {  1.0f,  v,    -u    }; break;
+			case 1:  d = { -1.0f,  v,     u    }; break;
+			case 2:  d = {  u,     1.0f, -v    }; break;
+			case 3:  d = {  u,    -1.0f,  v    }; break;
+			case 4:  d = {  u,     v,     1.0f }; break;
+			default: d = { -u,     v,    -1.0f }; break;
+		}
+
+		float length = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+		return { d.x / length, d.y / length, d.z / length };
+	}
+
+	glm::vec3 CubeMapDirection(uint32_t face, uint32_t x, uint32_t y, uint32_t resolution)
+	{
+		float s = ((float)x + 0.5f) / (float)resolution;
+		float t = ((float)y + 0.5f) / (float)resolution;
+		return FaceDirection(face, 2.0f * s - 1.0f, 2.0f * (1.0f - t) - 1.0f);
+	}
+
+	// Inverse of FaceDirection, s and t in [0, 1] with t down like the texel rows
+	static uint32_t DirectionToFace(const glm::vec3& d, float& s, float& t)
+	{
+		glm::vec3 a = glm::abs(d);
+		uint32_t face;
+		float u, v;
+		if (a.x >= a.y && a.x >= a.z)
+		{
+			face = d.x > 0.0f ? 0 : 1;
+			u = (d.x > 0.0f ? -d.z : d.z) / a.x;
+			v = d.y / a.x;
+		}
+		else if (a.y >= a.z)
+		{
+			face = d.y > 0.0f ? 2 : 3;
+			u = d.x / a.y;
+			v = (d.y > 0.0f ? -d.z : d.z) / a.y;
+		}
+		else
+		{
+			face = d.z > 0.0f ? 4 : 5;
+			u = (d.z > 0.0f ? d.x : -d.x) / a.z;
+			v = d.y / a.z;
+		}
+
+		s = (u + 1.0f) * 0.5f;
+		t = 1.0f - (v + 1.0f) * 0.5f;
+		return face;
+	}
+
+	// Relative error of bilinear filtering at a point of a face, the texels are evaluated exactly. Stays inside
+	// the face like the clamped lookups within a face, seams are no worse than the rest.
+	static float BilinearError(const PreethamSkyCoefficients& coefficients, uint32_t face, float s, float t, uint32_t resolution)
+	{
+		float px = glm::clamp(s * resolution - 0.5f, 0.0f, resolution - 1.0f);
+		float py = glm::clamp(t * resolution - 0.5f, 0.0f, resolution - 1.0f);
+		uint32_t x0 = std::min((uint32_t)px, resolution - 2);
+		uint32_t y0 = std::min((uint32_t)py, resolution - 2);
+		float fx = px - x0;
+		float fy = py - y0;
+
+		glm::vec3 c00 = EvaluatePreethamSky(coefficients, CubeMapDirection(face, x0, y0, resolution));
+		glm::vec3 c10 = EvaluatePreethamSky(coefficients, CubeMapDirection(face, x0 + 1, y0, resolution));
+		glm::vec3 c01 = EvaluatePreethamSky(coefficients, CubeMapDirection(face, x0, y0 + 1, resolution));
+		glm::vec3 c11 = EvaluatePreethamSky(coefficients, CubeMapDirection(face, x0 + 1, y0 + 1, resolution));
+		glm::vec3 filtered = glm::mix(glm::mix(c00, c10, fx), glm::mix(c01, c11, fx), fy);
+
+		glm::vec3 exact = EvaluatePreethamSky(coefficients, FaceDirection(face, 2.0f * s - 1.0f, 2.0f * (1.0f - t) - 1.0f));
+		float luminance = glm::max(0.2126f * exact.x + 0.7152f * exact.y + 0.0722f * exact.z, 0.0f);
+		glm::vec3 difference = glm::abs(filtered - exact);
+		return glm::max(difference.x, glm::max(difference.y, difference.z)) / (luminance + 1e-3f);
+	}
+
+	static float MaxBilinearError(const PreethamSkyCoefficients& coefficients, uint32_t resolution)
+	{
+		float maxError = 0.0f;
+
+		// The middle of quads spread over every face, the smooth part of the sky
+		for (uint32_t face = 0; face < 6; face++)
+		{
+			for (uint32_t j = 0; j < s_ErrorSamples; j++)
+			{
+				for (uint32_t i = 0; i < s_ErrorSamples; i++)
+				{
+					uint32_t x = (uint32_t)((i + 0.5f) / s_ErrorSamples * (resolution - 1));
+					uint32_t y = (uint32_t)((j + 0.5f) / s_ErrorSamples * (resolution - 1));
+					maxError = glm::max(maxError, BilinearError(coefficients, face, (x + 1.0f) / resolution, (y + 1.0f) / resolution, resolution));
+				}
+			}
+		}
+
+		// The circumsolar peak has a kink at the sun, tested over the texels around it
+		float s, t;
+		uint32_t face = DirectionToFace(glm::vec3(coefficients.SunDirection), s, t);
+		for (uint32_t j = 0; j < s_SunErrorSamples; j++)
+		{
+			for (uint32_t i = 0; i < s_SunErrorSamples; i++)
+			{
+				float offsetS = ((float)i - 0.5f * (s_SunErrorSamples - 1)) * 0.5f / resolution;
+				float offsetT = ((float)j - 0.5f * (s_SunErrorSamples - 1)) * 0.5f / resolution;
+				maxError = glm::max(maxError, BilinearError(coefficients, face, glm::clamp(s + offsetS, 0.0f, 1.0f), glm::clamp(t + offsetT, 0.0f, 1.0f), resolution));
+			}
+		}
+
+		return maxError;
+	}
+
+	uint32_t SelectPreethamSkyResolution(const PreethamSkyCoefficients& coefficients, float tolerance, uint32_t minResolution, uint32_t maxResolution)
+	{
+		uint32_t resolution = 2;
+		while (resolution < minResolution)
+			resolution *= 2;
+
+		for (; resolution < maxResolution; resolution *= 2)
+		{
+			if (MaxBilinearError(coefficients, resolution) <= tolerance)
+				return resolution;
+		}
+
+		return maxResolution;
+	}
+
+	static void GenerateRowScalar(const PreethamSkyCoefficients& coefficients, uint32_t face, uint32_t y, uint32_t resolution, uint32_t begin, float* rgb)
+	{
+		for (uint32_t x = begin; x < resolution; x++)
+		{
+			glm::vec3 color = EvaluatePreethamSky(coefficients, CubeMapDirection(face, x, y, resolution));
+			rgb[x * 3 + 0] = color.x;
+			rgb[x * 3 + 1] = color.y;
+			rgb[x * 3 + 2] = color.z;
+		}
+	}
+
+#if PREETHAM_X86
+	static __m128 ExpSSE(__m128 x)
+	{
+		x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-87.0f)), _mm_set1_ps(88.0f));
+
+		// floor() without SSE4.1
+		__m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)), _mm_set1_ps(0.5f));
+		__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+		fx = _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, fx), _mm_set1_ps(1.0f)));
+
+		x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(0.693359375f)));
+		x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(-2.12194440e-4f)));
+
+		__m128 y = _mm_set1_ps(1.9875691500e-4f);
+		y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507e-3f));
+		y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073e-3f));
+		y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894e-2f));
+		y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459e-1f));
+		y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201e-1f));
+		y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(y, x), x), x), _mm_set1_ps(1.0f));
+
+		__m128i exponent = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(fx), _mm_set1_epi32(127)), 23);
+		return _mm_mul_ps(y, _mm_castsi128_ps(exponent));
+	}
+
+	static __m128 AcosSSE(__m128 x)
+	{
+		__m128 p = _mm_set1_ps(s_AcosCoefficients[7]);
+		for (int i = 6; i >= 0; i--)
+			p = _mm_add_ps(_mm_mul_ps(p, x), _mm_set1_ps(s_AcosCoefficients[i]));
+		return _mm_mul_ps(_mm_sqrt_ps(_mm_sub_ps(_mm_set1_ps(1.0f), x)), p);
+	}
+
+	// 4 texels of a row at a time, the operations of the scalar path in the same order
+	static void GenerateRowSSE(const PreethamSkyCoefficients& c, uint32_t face, uint32_t y, uint32_t resolution, float* rgb)
+	{
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 two = _mm_set1_ps(2.0f);
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 minusOne = _mm_set1_ps(-1.0f);
+		const __m128 signMask = _mm_set1_ps(-0.0f);
+		const __m128 size = _mm_set1_ps((float)resolution);
+
+		float t = ((float)y + 0.5f) / (float)resolution;
+		__m128 v = _mm_set1_ps(2.0f * (1.0f - t) - 1.0f);
+		__m128 minusV = _mm_xor_ps(v, signMask);
+
+		uint32_t x = 0;
+		for (; x + 4 <= resolution; x += 4)
+		{
+			__m128 s = _mm_div_ps(_mm_add_ps(_mm_cvtepi32_ps(_mm_setr_epi32(x, x + 1, x + 2, x + 3)), half), size);
+			__m128 u = _mm_sub_ps(_mm_mul_ps(two, s), one);
+			__m128 minusU = _mm_xor_ps(u, signMask);
+
+			__m128 dx, dy, dz;
+			switch (face)
+			{
+				case 0:  dx = one;      dy = v;        dz = minusU;   break;
+				case 1:  dx = minusOne; dy = v;        dz = u;        break;
+				case 2:  dx = u;        dy = one;      dz = minusV;   break;
+				case 3:  dx = u;        dy = minusOne; dz = v;        break;
+				case 4:  dx = u;        dy = v;        dz = one;      break;
+				default: dx = minusU;   dy = v;        dz = minusOne; break;
+			}
+
+			__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+			dx = _mm_div_ps(dx, length);
+			dy = _mm_div_ps(dy, length);
+			dz = _mm_div_ps(dz, length);
+
+			__m128 cosTheta = _mm_max_ps(dy, _mm_set1_ps(s_MinCosTheta));
+			__m128 cosGamma = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(c.SunDirection.x), dx), _mm_mul_ps(_mm_set1_ps(c.SunDirection.y), dy)),
+				_mm_mul_ps(_mm_set1_ps(c.SunDirection.z), dz));
+			cosGamma = _mm_min_ps(_mm_max_ps(cosGamma, _mm_setzero_ps()), one);
+			__m128 gamma = AcosSSE(cosGamma);
+			__m128 cosGamma2 = _mm_mul_ps(cosGamma, cosGamma);
+
+			__m128 Yxy[3];
+			for (int i = 0; i < 3; i++)
+			{
+				__m128 thetaTerm = _mm_add_ps(one, _mm_mul_ps(_mm_set1_ps(c.A[i]), ExpSSE(_mm_div_ps(_mm_set1_ps(c.B[i]), cosTheta))));
+				__m128 gammaTerm = _mm_add_ps(_mm_add_ps(one, _mm_mul_ps(_mm_set1_ps(c.C[i]), ExpSSE(_mm_mul_ps(_mm_set1_ps(c.D[i]), gamma)))),
+					_mm_mul_ps(_mm_set1_ps(c.E[i]), cosGamma2));
+				Yxy[i] = _mm_mul_ps(_mm_set1_ps(c.Zenith[i]), _mm_mul_ps(thetaTerm, gammaTerm));
+			}
+
+			__m128 Yy = _mm_div_ps(Yxy[0], Yxy[2]);
+			__m128 XYZ[3] = { _mm_mul_ps(Yxy[1], Yy), Yxy[0], _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(one, Yxy[1]), Yxy[2]), Yy) };
+
+			alignas(16) float channels[3][4];
+			for (int i = 0; i < 3; i++)
+			{
+				__m128 value = _mm_add_ps(_mm_add_ps(_mm_mul_ps(XYZ[0], _mm_set1_ps(s_XYZToRGB[i][0])), _mm_mul_ps(XYZ[1], _mm_set1_ps(s_XYZToRGB[i][1]))),
+					_mm_mul_ps(XYZ[2], _mm_set1_ps(s_XYZToRGB[i][2])));
+				_mm_store_ps(channels[i], _mm_mul_ps(value, _mm_set1_ps(s_Scale)));
+			}
+
+			for (uint32_t lane = 0; lane < 4; lane++)
+			{
+				rgb[(x + lane) * 3 + 0] = channels[0][lane];
+				rgb[(x + lane) * 3 + 1] = channels[1][lane];
+				rgb[(x + lane) * 3 + 2] = channels[2][lane];
+			}
+		}
+
+		GenerateRowScalar(c, face, y, resolution, x, rgb);
+	}
+#endif
+
+	void GeneratePreethamSky(const PreethamSkyCoefficients& coefficients, uint32_t resolution, std::vector<uint16_t>& texels, bool vectorized)
+	{
+		texels.resize((size_t)6 * resolution * resolution * 4);
+
+		uint16_t one = (uint16_t)FloatToHalf(1.0f);
+		ThreadPool::Get().ParallelFor(6 * resolution, [&](uint32_t row)
+		{
+			uint32_t face = row / resolution;
+			uint32_t y = row % resolution;
+
+			std::vector<float> rgb(resolution * 3);
+#if PREETHAM_X86
+			if (vectorized)
+				GenerateRowSSE(coefficients, face, y, resolution, rgb.data());
+			else
+#endif
+				GenerateRowScalar(coefficients, face, y, resolution, 0, rgb.data());
+
+			uint16_t* out = texels.data() + (size_t)row * resolution * 4;
+			for (uint32_t x = 0; x < resolution; x++)
+			{
+				out[x * 4 + 0] = (uint16_t)FloatToHalf(rgb[x * 3 + 0]);
+				out[x * 4 + 1] = (uint16_t)FloatToHalf(rgb[x * 3 + 1]);
+				out[x * 4 + 2] = (uint16_t)FloatToHalf(rgb[x * 3 + 2]);
+				out[x * 4 + 3] = one;
+			}
+		});
+	}
+
+	void GeneratePreethamSkyEquirectangular(const PreethamSkyCoefficients& coefficients, uint32_t width, uint32_t height, std::vector<glm::vec3>& pixels)
+	{
+		pixels.resize((size_t)width * height);
+		ThreadPool::Get().ParallelFor(height, [&](uint32_t y)
+		{
+			float theta = ((float)y + 0.5f) / (float)height * PI;
+			for (uint32_t x = 0; x < width; x++)
+			{
+				float phi = (((float)x + 0.5f) / (float)width - 0.5f) * TWO_PI;
+				glm::vec3 direction = glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+				pixels[(size_t)y * width + x] = EvaluatePreethamSky(coefficients, direction);
+			}
+		});
+	}
+
+	PreethamSkyCache::PreethamSkyCache(uint32_t capacity, float tolerance)
+		: m_Capacity(std::max(capacity, 1u)), m_Tolerance(tolerance)
+	{
+		m_Entries.reserve(m_Capacity);
+	}
+
+	const PreethamSkyCubeMap& PreethamSkyCache::Get(const PreethamSkySettings& settings)
+	{
+		m_UseCounter++;
+		for (Entry& entry : m_Entries)
+		{
+			if (entry.CubeMap.Settings == settings)
+			{
+				entry.LastUse = m_UseCounter;
+				m_HitCount++;
+				return entry.CubeMap;
+			}
+		}
+
+		m_MissCount++;
+
+		Entry* entry;
+		if (m_Entries.size() < m_Capacity)
+		{
+			m_Entries.emplace_back();
+			entry = &m_Entries.back();
+		}
+		else
+		{
+			entry = &*std::min_element(m_Entries.begin(), m_Entries.end(), [](const Entry& a, const Entry& b) { return a.LastUse < b.LastUse; });
+		}
+
+		PreethamSkyCoefficients coefficients = ComputePreethamSkyCoefficients(settings);
+		entry->CubeMap.Settings = settings;
+		entry->CubeMap.Resolution = SelectPreethamSkyResolution(coefficients, m_Tolerance);
+		GeneratePreethamSky(coefficients, entry->CubeMap.Resolution, entry->CubeMap.Texels);
+		entry->LastUse = m_UseCounter;
+		return entry->CubeMap;
+	}
+
+	bool PreethamSkyCache::Contains(const PreethamSkySettings& settings) const
+	{
+		for (const Entry& entry : m_Entries)
+		{
+			if (entry.CubeMap.Settings == settings)
+				return true;
+		}
+		return false;
+	}
+
+	uint64_t PreethamSkyCache::GetMemoryUsage() const
+	{
+		uint64_t bytes = 0;
+		for (const Entry& entry : m_Entries)
+			bytes += entry.CubeMap.Texels.size() * sizeof(uint16_t);
+		return bytes;
+	}
+
+}
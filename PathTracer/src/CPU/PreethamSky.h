@@ -0,0 +1,98 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace CPU {
+
+	struct PreethamSkySettings
+	{
+		float Turbidity = 3.14f;
+		float Azimuth = 0.0f;
+		float Inclination = 0.0f;
+
+		bool operator==(const PreethamSkySettings& other) const
+		{
+			return Turbidity == other.Turbidity && Azimuth == other.Azimuth && Inclination == other.Inclination;
+		}
+	};
+
+	// Everything of the Preetham model that only depends on the settings, computed once per change instead
+	// of per texel. Same layout as the push constants of PreethamSky.glsl.
+	struct PreethamSkyCoefficients
+	{
+		// Perez distribution, xyz for the Y, x and y channels
+		glm::vec4 A;
+		glm::vec4 B;
+		glm::vec4 C;
+		glm::vec4 D;
+		glm::vec4 E;
+
+		// Zenith Yxy divided by the Perez function at the zenith, the per texel Perez function scales it
+		glm::vec4 Zenith;
+
+		glm::vec4 SunDirection;
+	};
+
+	PreethamSkyCoefficients ComputePreethamSkyCoefficients(const PreethamSkySettings& settings);
+
+	// Linear RGB of the sky along a unit direction, the same operations in the same order as PreethamSky.glsl.
+	// exp and acos are polynomial approximations both sides evaluate identically.
+	glm::vec3 EvaluatePreethamSky(const PreethamSkyCoefficients& coefficients, const glm::vec3& direction);
+
+	// Direction through the center of a cube map texel, same as GetCubeMapTexCoord in PreethamSky.glsl.
+	// Faces are ordered +X, -X, +Y, -Y, +Z, -Z.
+	glm::vec3 CubeMapDirection(uint32_t face, uint32_t x, uint32_t y, uint32_t resolution);
+
+	// Smallest power of two face resolution at which bilinear filtering stays within tolerance of the exact
+	// sky, estimated from the curvature of the Perez function. The sky has no sun disk and varies slowly,
+	// far less than the 2048 the cube map used to have.
+	uint32_t SelectPreethamSkyResolution(const PreethamSkyCoefficients& coefficients, float tolerance = 0.01f, uint32_t minResolution = 32, uint32_t maxResolution = 2048);
+
+	// Fills 6 faces of resolution^2 RGBA half texels (alpha 1), the layout of an RGBA16F cube map. Rows are
+	// generated on the thread pool, 4 texels at a time with SSE2 when vectorized is set. Both paths give the
+	// same bits.
+	void GeneratePreethamSky(const PreethamSkyCoefficients& coefficients, uint32_t resolution, std::vector<uint16_t>& texels, bool vectorized = true);
+
+	// Top row first equirectangular pixels in the mapping of EnvironmentMap, for the CPU backend without a GPU
+	void GeneratePreethamSkyEquirectangular(const PreethamSkyCoefficients& coefficients, uint32_t width, uint32_t height, std::vector<glm::vec3>& pixels);
+
+	struct PreethamSkyCubeMap
+	{
+		PreethamSkySettings Settings;
+		uint32_t Resolution = 0;
+		std::vector<uint16_t> Texels;
+	};
+
+	// Keeps the cube maps of the most recently used settings, so going back to a sky doesn't generate it again
+	class PreethamSkyCache
+	{
+	public:
+		PreethamSkyCache(uint32_t capacity = 4, float tolerance = 0.01f);
+
+		// Generates on a miss, evicting the least recently used cube map when full. The reference stays valid
+		// until the next call.
+		const PreethamSkyCubeMap& Get(const PreethamSkySettings& settings);
+
+		bool Contains(const PreethamSkySettings& settings) const;
+
+		uint32_t GetHitCount() const { return m_HitCount; }
+		uint32_t GetMissCount() const { return m_MissCount; }
+		uint64_t GetMemoryUsage() const;
+
+	private:
+		struct Entry
+		{
+			PreethamSkyCubeMap CubeMap;
+			uint64_t LastUse = 0;
+		};
+
+		uint32_t m_Capacity;
+		float m_Tolerance;
+		std::vector<Entry> m_Entries;
+		uint64_t m_UseCounter = 0;
+		uint32_t m_HitCount = 0;
+		uint32_t m_MissCount = 0;
+	};
+
+}
@@ -0,0 +1,196 @@
+#include "CPU/RenderCheckpoint.h"
+#include "Util/Hash.h"
+#include <cstring>
+#include <memory>
+
+namespace CPU {
+
+	struct CheckpointHeader
+	{
+		char Magic[4] = { 'C', 'K', 'P', 'T' };
+		uint32_t Version = 1;
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t TileSize = 0;
+		uint32_t Seed = 0;
+		uint32_t TileCount = 0;
+		uint32_t Padding = 0;
+	};
+
+	bool RenderCheckpoint::Create(const std::string& filepath, uint32_t width, uint32_t height, uint32_t tileSize, uint32_t seed)
+	{
+		m_Stream.open(filepath, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+		if (!m_Stream)
+			return false;
+
+		m_Width = width;
+		m_Height = height;
+		m_TileSize = tileSize;
+		m_TilesX = (width + tileSize - 1) / tileSize;
+		m_Seed = seed;
+
+		uint32_t tilesY = (height + tileSize - 1) / tileSize;
+		m_TileFrames.assign((size_t)m_TilesX * tilesY, 0);
+
+		if (!WriteHeader())
+			return false;
+
+		// Tile blocks are written as the tiles get rendered, the file only has to be long enough for the last one
+		std::vector<glm::vec4> empty((size_t)tileSize * tileSize, glm::vec4(0.0f));
+		m_Stream.seekp(GetTilePosition(GetTileCount() - 1));
+		m_Stream.write((const char*)empty.data(), empty.size() * sizeof(glm::vec4));
+		m_Stream.flush();
+
+		return m_Stream.good();
+	}
+
+	bool RenderCheckpoint::Open(const std::string& filepath)
+	{
+		m_Stream.open(filepath, std::ios::binary | std::ios::in | std::ios::out);
+		if (!m_Stream)
+			return false;
+
+		CheckpointHeader header;
+		CheckpointHeader expected;
+		m_Stream.read((char*)&header, sizeof(CheckpointHeader));
+		if (!m_Stream || memcmp(header.Magic, expected.Magic, 4) != 0 || header.Version != expected.Version || header.TileSize == 0)
+			return false;
+
+		m_Width = header.Width;
+		m_Height = header.Height;
+		m_TileSize = header.TileSize;
+		m_TilesX = (header.Width + header.TileSize - 1) / header.TileSize;
+		m_Seed = header.Seed;
+
+		uint32_t tilesY = (header.Height + header.TileSize - 1) / header.TileSize;
+		if (header.TileCount != m_TilesX * tilesY)
+			return false;
+
+		m_TileFrames.resize(header.TileCount);
+		m_Stream.read((char*)m_TileFrames.data(), m_TileFrames.size() * sizeof(uint32_t));
+		return m_Stream.good();
+	}
+
+	bool RenderCheckpoint::WriteHeader()
+	{
+		CheckpointHeader header;
+		header.Width = m_Width;
+		header.Height = m_Height;
+		header.TileSize = m_TileSize;
+		header.Seed = m_Seed;
+		header.TileCount = GetTileCount();
+
+		m_Stream.seekp(0);
+		m_Stream.write((const char*)&header, sizeof(CheckpointHeader));
+		m_Stream.write((const char*)m_TileFrames.data(), m_TileFrames.size() * sizeof(uint32_t));
+		m_Stream.flush();
+		return m_Stream.good();
+	}
+
+	uint64_t RenderCheckpoint::GetTilePosition(uint32_t tile) const
+	{
+		// Blocks start 16 byte aligned and all have room for a full tile
+		uint64_t dataStart = (sizeof(CheckpointHeader) + m_TileFrames.size() * sizeof(uint32_t) + 15) & ~15ull;
+		return dataStart + (uint64_t)tile * m_TileSize * m_TileSize * sizeof(glm::vec4);
+	}
+
+	void RenderCheckpoint::GetTileRect(uint32_t tile, glm::uvec2& offset, glm::uvec2& size) const
+	{
+		offset = glm::uvec2(tile % m_TilesX, tile / m_TilesX) * m_TileSize;
+		size = glm::uvec2(glm::min(m_TileSize, m_Width - offset.x), glm::min(m_TileSize, m_Height - offset.y));
+	}
+
+	bool RenderCheckpoint::WriteTile(uint32_t tile, const std::vector<glm::vec4>& accumulation, uint32_t frames)
+	{
+		glm::uvec2 offset, size;
+		GetTileRect(tile, offset, size);
+		if (accumulation.size() != (size_t)size.x * size.y)
+			return false;
+
+		m_Stream.seekp(GetTilePosition(tile));
+		m_Stream.write((const char*)accumulation.data(), accumulation.size() * sizeof(glm::vec4));
+		m_Stream.flush();
+
+		m_TileFrames[tile] = frames;
+		m_Stream.seekp(sizeof(CheckpointHeader) + tile * sizeof(uint32_t));
+		m_Stream.write((const char*)&frames, sizeof(uint32_t));
+		m_Stream.flush();
+
+		return m_Stream.good();
+	}
+
+	bool RenderCheckpoint::ReadTile(uint32_t tile, std::vector<glm::vec4>& accumulation)
+	{
+		glm::uvec2 offset, size;
+		GetTileRect(tile, offset, size);
+		accumulation.resize((size_t)size.x * size.y);
+
+		m_Stream.seekg(GetTilePosition(tile));
+		m_Stream.read((char*)accumulation.data(), accumulation.size() * sizeof(glm::vec4));
+		return m_Stream.good();
+	}
+
+	bool RenderCheckpoint::Merge(const std::vector<std::string>& inputs, const std::string& output)
+	{
+		if (inputs.empty())
+			return false;
+
+		std::vector<std::unique_ptr<RenderCheckpoint>> checkpoints;
+		Hasher seedHasher;
+		for (const std::string& input : inputs)
+		{
+			checkpoints.push_back(std::make_unique<RenderCheckpoint>());
+			RenderCheckpoint& checkpoint = *checkpoints.back();
+			if (!checkpoint.Open(input))
+				return false;
+
+			const RenderCheckpoint& first = *checkpoints.front();
+			if (checkpoint.m_Width != first.m_Width || checkpoint.m_Height != first.m_Height || checkpoint.m_TileSize != first.m_TileSize)
+				return false;
+
+			// The same seed renders the same paths, adding them up would count them twice
+			for (size_t i = 0; i + 1 < checkpoints.size(); i++)
+			{
+				if (checkpoints[i]->m_Seed == checkpoint.m_Seed)
+					return false;
+			}
+
+			seedHasher.Add(checkpoint.m_Seed);
+		}
+
+		const RenderCheckpoint& first = *checkpoints.front();
+		RenderCheckpoint merged;
+		if (!merged.Create(output, first.m_Width, first.m_Height, first.m_TileSize, (uint32_t)seedHasher.Get()))
+			return false;
+
+		std::vector<glm::vec4> sum, accumulation;
+		for (uint32_t tile = 0; tile < merged.GetTileCount(); tile++)
+		{
+			uint32_t frames = 0;
+			sum.clear();
+			for (const std::unique_ptr<RenderCheckpoint>& checkpoint : checkpoints)
+			{
+				if (checkpoint->m_TileFrames[tile] == 0)
+					continue;
+
+				if (!checkpoint->ReadTile(tile, accumulation))
+					return false;
+
+				if (sum.empty())
+					sum = accumulation;
+				else
+				{
+					for (size_t i = 0; i < sum.size(); i++)
+						sum[i] += accumulation[i];
+				}
+				frames += checkpoint->m_TileFrames[tile];
+			}
+
+			if (frames > 0 && !merged.WriteTile(tile, sum, frames))
+				return false;
+		}
+
+		return true;
+	}
+
+}
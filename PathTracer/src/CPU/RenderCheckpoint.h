@@ -0,0 +1,62 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace CPU {
+
+	// On-disk accumulation of a tiled render: a header with the frames every tile has accumulated,
+	// followed by one fixed size block per tile with its RGB sum + path count pixels (same layout as
+	// o_AccumulationImage). Tiles are read and written one at a time, so a frame of any size can be
+	// checkpointed with the memory of a single tile.
+	class RenderCheckpoint
+	{
+	public:
+		RenderCheckpoint() = default;
+
+		RenderCheckpoint(const RenderCheckpoint&) = delete;
+		RenderCheckpoint& operator=(const RenderCheckpoint&) = delete;
+
+		// New checkpoint with no frames in any tile, truncates an existing file
+		bool Create(const std::string& filepath, uint32_t width, uint32_t height, uint32_t tileSize, uint32_t seed);
+		bool Open(const std::string& filepath);
+
+		// Writes the tile's pixels first and its frame count after them, a job killed in between
+		// resumes from the previous count
+		bool WriteTile(uint32_t tile, const std::vector<glm::vec4>& accumulation, uint32_t frames);
+		bool ReadTile(uint32_t tile, std::vector<glm::vec4>& accumulation);
+
+		uint32_t GetTileFrames(uint32_t tile) const { return m_TileFrames[tile]; }
+
+		// Pixels [offset, offset + size) of the frame covered by a tile
+		void GetTileRect(uint32_t tile, glm::uvec2& offset, glm::uvec2& size) const;
+
+		uint32_t GetWidth() const { return m_Width; }
+		uint32_t GetHeight() const { return m_Height; }
+		uint32_t GetTileSize() const { return m_TileSize; }
+		uint32_t GetTilesX() const { return m_TilesX; }
+		uint32_t GetTileCount() const { return (uint32_t)m_TileFrames.size(); }
+		uint32_t GetSeed() const { return m_Seed; }
+		bool IsOpen() const { return m_Stream.is_open(); }
+
+		// Adds up the sums and path counts of checkpoints rendered with independent seeds into a new
+		// one, tile by tile. They must have the same frame and tile size.
+		static bool Merge(const std::vector<std::string>& inputs, const std::string& output);
+
+	private:
+		bool WriteHeader();
+		uint64_t GetTilePosition(uint32_t tile) const;
+
+	private:
+		std::fstream m_Stream;
+		uint32_t m_Width = 0;
+		uint32_t m_Height = 0;
+		uint32_t m_TileSize = 0;
+		uint32_t m_TilesX = 0;
+		uint32_t m_Seed = 0;
+		std::vector<uint32_t> m_TileFrames;
+	};
+
+}
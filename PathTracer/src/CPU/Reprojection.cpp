@@ -0,0 +1,143 @@
+#include "CPU/Reprojection.h"
+#include "CPU/PathTracer.h"
+#include "CPU/ThreadPool.h"
+
+namespace CPU {
+
+	// History with less bilinear weight than this is a disocclusion, same as Reproject.glsl
+	static constexpr float s_MinHistoryWeight = 1e-3f;
+
+	bool ProjectToPixel(const CameraBuffer& camera, const glm::vec4& position, uint32_t width, uint32_t height, glm::vec2& pixel)
+	{
+		glm::vec4 clip = camera.ViewProjection * position;
+		if (clip.w <= 0.0f)
+			return false;
+
+		glm::vec2 ndc = glm::vec2(clip.x, clip.y) / clip.w;
+		pixel = (ndc * 0.5f + 0.5f) * glm::vec2((float)width, (float)height);
+		return true;
+	}
+
+	Reprojector::Reprojector(const ReprojectionSpecification& specification)
+		: m_Specification(specification)
+	{
+	}
+
+	void Reprojector::Resize(uint32_t width, uint32_t height)
+	{
+		m_Width = width;
+		m_Height = height;
+
+		m_HistoryAccumulation.assign((size_t)width * height, glm::vec4(0.0f));
+		m_HistoryMoments.assign((size_t)width * height, glm::vec4(0.0f));
+		m_HistoryNormalDepth.assign((size_t)width * height, glm::vec4(0.0f));
+	}
+
+	void Reprojector::StoreHistory(const CameraBuffer& camera, const std::vector<glm::vec4>& accumulation, const std::vector<glm::vec4>& moments,
+		const std::vector<glm::vec4>& normalDepth)
+	{
+		m_HistoryCamera = camera;
+		m_HistoryAccumulation = accumulation;
+		m_HistoryMoments = moments;
+		m_HistoryNormalDepth = normalDepth;
+	}
+
+	bool Reprojector::FetchHistory(const CameraBuffer& camera, uint32_t x, uint32_t y, const glm::vec4& normalDepth, glm::vec4& accumulation, float& moment) const
+	{
+		// Same ray as the AOVs, hits are reprojected as points and misses as directions
+		Ray ray = GenerateCameraRay(camera, glm::vec2((float)x, (float)y) + glm::vec2(0.5f), m_Width, m_Height);
+		bool hit = normalDepth.w > 0.0f;
+		glm::vec3 hitPosition = ray.Origin + ray.Direction * normalDepth.w;
+		glm::vec4 position = hit ? glm::vec4(hitPosition, 1.0f) : glm::vec4(ray.Direction, 0.0f);
+
+		// Where the first hit was seen in the history, the motion vector is the pixel center minus this
+		glm::vec2 previousPixel;
+		if (!ProjectToPixel(m_HistoryCamera, position, m_Width, m_Height, previousPixel))
+			return false;
+
+		glm::vec3 normal = glm::vec3(normalDepth);
+		float expectedDistance = glm::length(hitPosition - glm::vec3(m_HistoryCamera.InverseView[3]));
+
+		glm::vec2 base = previousPixel - glm::vec2(0.5f);
+		glm::vec2 origin = glm::floor(base);
+		glm::vec2 fraction = base - origin;
+
+		float sumWeight = 0.0f;
+		glm::vec4 sumAccumulation = glm::vec4(0.0f);
+		float sumMoment = 0.0f;
+
+		for (int tap = 0; tap < 4; tap++)
+		{
+			int dx = tap & 1;
+			int dy = tap >> 1;
+			int tx = (int)origin.x + dx;
+			int ty = (int)origin.y + dy;
+			if (tx < 0 || ty < 0 || tx >= (int)m_Width || ty >= (int)m_Height)
+				continue;
+
+			size_t index = (size_t)tx + (size_t)ty * m_Width;
+			const glm::vec4& history = m_HistoryNormalDepth[index];
+
+			// A hit that lands on a miss or the other way around is always a disocclusion
+			if (hit != (history.w > 0.0f))
+				continue;
+
+			if (hit)
+			{
+				if (glm::abs(history.w - expectedDistance) > m_Specification.DepthTolerance * expectedDistance)
+					continue;
+
+				if (glm::dot(normal, glm::vec3(history)) < m_Specification.NormalThreshold)
+					continue;
+			}
+
+			float weight = (dx ? fraction.x : 1.0f - fraction.x) * (dy ? fraction.y : 1.0f - fraction.y);
+			sumWeight += weight;
+			sumAccumulation += m_HistoryAccumulation[index] * weight;
+			sumMoment += m_HistoryMoments[index].x * weight;
+		}
+
+		if (sumWeight < s_MinHistoryWeight)
+			return false;
+
+		accumulation = sumAccumulation / sumWeight;
+		moment = sumMoment / sumWeight;
+		return accumulation.w > 0.0f;
+	}
+
+	void Reprojector::Reproject(const CameraBuffer& camera, const std::vector<glm::vec4>& normalDepth, std::vector<glm::vec4>& accumulation,
+		std::vector<glm::vec4>& moments, std::vector<glm::vec4>& image)
+	{
+		std::vector<uint32_t> rowCounts(m_Height, 0);
+
+		ThreadPool::Get().ParallelFor(m_Height, [&](uint32_t y)
+		{
+			for (uint32_t x = 0; x < m_Width; x++)
+			{
+				size_t pixelIndex = (size_t)x + (size_t)y * m_Width;
+
+				glm::vec4 history;
+				float historyMoment;
+				if (FetchHistory(camera, x, y, normalDepth[pixelIndex], history, historyMoment))
+				{
+					// Sample count aware blend, the new paths weigh in by their share of the combined count
+					float scale = glm::min(1.0f, m_Specification.MaxHistorySamples / history.w);
+					accumulation[pixelIndex] += history * scale;
+					moments[pixelIndex].x += historyMoment * scale;
+					rowCounts[y]++;
+				}
+
+				glm::vec3 color = glm::vec3(accumulation[pixelIndex]) / accumulation[pixelIndex].w;
+				if (glm::any(glm::isnan(color)))
+					image[pixelIndex] = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+				else
+					image[pixelIndex] = glm::vec4(color, 1.0f);
+			}
+		});
+
+		m_ReprojectedPixelCount = 0;
+		for (uint32_t count : rowCounts)
+			m_ReprojectedPixelCount += count;
+	}
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "ShaderBuffers.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace CPU {
+
+	struct ReprojectionSpecification
+	{
+		// History pixels whose hit distance differs from the reprojected one by more than this fraction are disocclusions
+		float DepthTolerance = 0.05f;
+
+		// Minimum cosine between the current and the history normal
+		float NormalThreshold = 0.9f;
+
+		// History is scaled down to at most this many paths, so the new samples of a frame keep a weight of
+		// at least SAMPLE_COUNT / (SAMPLE_COUNT + MaxHistorySamples) and the resampling blur of old moves fades out
+		float MaxHistorySamples = 256.0f;
+	};
+
+	// Position in pixels (centers at .5) where camera sees a world space point (w = 1) or direction (w = 0),
+	// inverse of GenerateCameraRay. False if it is behind the camera.
+	bool ProjectToPixel(const CameraBuffer& camera, const glm::vec4& position, uint32_t width, uint32_t height, glm::vec2& pixel);
+
+	// CPU implementation of Reproject.glsl. Keeps the accumulation of the last frame before a camera move
+	// and adds it to the first frame after it, following the first hit through every pixel center back
+	// into the previous camera. History pixels that fail the depth or normal test are dropped.
+	class Reprojector
+	{
+	public:
+		Reprojector(const ReprojectionSpecification& specification = ReprojectionSpecification());
+
+		void Resize(uint32_t width, uint32_t height);
+
+		// Stage 0, copies the buffers rendered with camera before they are overwritten
+		void StoreHistory(const CameraBuffer& camera, const std::vector<glm::vec4>& accumulation, const std::vector<glm::vec4>& moments,
+			const std::vector<glm::vec4>& normalDepth);
+
+		// Stage 1, accumulation and moments only hold the paths of the frame rendered with camera. Adds the
+		// reprojected history to them and writes the resolved image.
+		void Reproject(const CameraBuffer& camera, const std::vector<glm::vec4>& normalDepth, std::vector<glm::vec4>& accumulation,
+			std::vector<glm::vec4>& moments, std::vector<glm::vec4>& image);
+
+		// Pixels that kept some history in the last Reproject
+		uint32_t GetReprojectedPixelCount() const { return m_ReprojectedPixelCount; }
+
+		const ReprojectionSpecification& GetSpecification() const { return m_Specification; }
+		void SetSpecification(const ReprojectionSpecification& specification) { m_Specification = specification; }
+
+	private:
+		// Bilinear blend of the history pixels around the reprojected first hit that pass the disocclusion
+		// tests, as path sum + count and moment sum. False if none of them does.
+		bool FetchHistory(const CameraBuffer& camera, uint32_t x, uint32_t y, const glm::vec4& normalDepth, glm::vec4& accumulation, float& moment) const;
+
+	private:
+		ReprojectionSpecification m_Specification;
+		uint32_t m_Width = 0;
+		uint32_t m_Height = 0;
+
+		CameraBuffer m_HistoryCamera;
+		std::vector<glm::vec4> m_HistoryAccumulation;
+		std::vector<glm::vec4> m_HistoryMoments;
+		std::vector<glm::vec4> m_HistoryNormalDepth;
+
+		uint32_t m_ReprojectedPixelCount = 0;
+	};
+
+}
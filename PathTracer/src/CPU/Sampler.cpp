@@ -0,0 +1,192 @@
+#include "CPU/Sampler.h"
+#include "CPU/Globals.h"
+#include <cmath>
+
+namespace CPU {
+
+	// Offset of one rank of the blue noise mask in 32 bit fixed point
+	static constexpr uint32_t s_BlueNoiseStep = (uint32_t)((1ull << 32) / (BLUE_NOISE_SIZE * BLUE_NOISE_SIZE));
+
+	const char* GetSamplerName(SamplerType type)
+	{
+		switch (type)
+		{
+			case SamplerType::Random:	 return "random";
+			case SamplerType::Sobol:	 return "sobol";
+			case SamplerType::BlueNoise: return "bluenoise";
+		}
+
+		return "unknown";
+	}
+
+	std::vector<uint32_t> GenerateBlueNoiseMask(uint32_t size, float sigma, uint32_t seed)
+	{
+		uint32_t count = size * size;
+
+		// Energy a point adds at a toroidal offset
+		std::vector<float> kernel(count);
+		for (uint32_t y = 0; y < size; y++)
+		{
+			for (uint32_t x = 0; x < size; x++)
+			{
+				float dx = (float)glm::min(x, size - x);
+				float dy = (float)glm::min(y, size - y);
+				kernel[x + y * size] = std::exp(-(dx * dx + dy * dy) / (2.0f * sigma * sigma));
+			}
+		}
+
+		std::vector<uint8_t> pattern(count, 0);
+		std::vector<float> energy(count, 0.0f);
+
+		auto addPoint = [&](uint32_t index, float sign)
+		{
+			pattern[index] = sign > 0.0f ? 1 : 0;
+
+			uint32_t px = index % size;
+			uint32_t py = index / size;
+			for (uint32_t y = 0; y < size; y++)
+			{
+				const float* row = &kernel[((y + size - py) % size) * size];
+				for (uint32_t x = 0; x < size; x++)
+					energy[x + y * size] += sign * row[x >= px ? x - px : x + size - px];
+			}
+		};
+
+		auto tightestCluster = [&]()
+		{
+			uint32_t best = 0;
+			float bestEnergy = -1.0f;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				if (pattern[i] && energy[i] > bestEnergy)
+				{
+					best = i;
+					bestEnergy = energy[i];
+				}
+			}
+			return best;
+		};
+
+		auto largestVoid = [&]()
+		{
+			uint32_t best = 0;
+			float bestEnergy = 1e27f;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				if (!pattern[i] && energy[i] < bestEnergy)
+				{
+					best = i;
+					bestEnergy = energy[i];
+				}
+			}
+			return best;
+		};
+
+		// Initial pattern, a tenth of the pixels at random
+		uint32_t initialCount = glm::max(count / 10, 1u);
+		for (uint32_t placed = 0; placed < initialCount;)
+		{
+			uint32_t index = PCG_Hash(seed) % count;
+			if (pattern[index])
+				continue;
+
+			addPoint(index, 1.0f);
+			placed++;
+		}
+
+		// Move the tightest cluster into the largest void until it would land where it was
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint32_t cluster = tightestCluster();
+			addPoint(cluster, -1.0f);
+
+			uint32_t hole = largestVoid();
+			addPoint(hole, 1.0f);
+			if (hole == cluster)
+				break;
+		}
+
+		std::vector<uint32_t> ranks(count);
+
+		// Points of the initial pattern get the ranks below its size, tightest clusters highest
+		std::vector<uint8_t> initialPattern = pattern;
+		std::vector<float> initialEnergy = energy;
+		for (uint32_t rank = initialCount; rank-- > 0;)
+		{
+			uint32_t cluster = tightestCluster();
+			addPoint(cluster, -1.0f);
+			ranks[cluster] = rank;
+		}
+		pattern = initialPattern;
+		energy = initialEnergy;
+
+		// The rest fill the largest voids. Past half the pixels Ulichney takes the tightest cluster of the
+		// empty pixels instead, which is the same pixel, as the energies of both add up to the kernel sum.
+		for (uint32_t rank = initialCount; rank < count; rank++)
+		{
+			uint32_t hole = largestVoid();
+			addPoint(hole, 1.0f);
+			ranks[hole] = rank;
+		}
+
+		return ranks;
+	}
+
+	const std::vector<uint32_t>& GetBlueNoiseMask()
+	{
+		static const std::vector<uint32_t> mask = GenerateBlueNoiseMask(BLUE_NOISE_SIZE);
+		return mask;
+	}
+
+	PixelSampler BeginPixelSample(SamplerType type, uint32_t x, uint32_t y, uint32_t width, uint32_t sampleIndex, uint32_t seed)
+	{
+		PixelSampler sampler;
+		sampler.Type = type;
+		sampler.Index = sampleIndex;
+		sampler.PixelX = x;
+		sampler.PixelY = y;
+
+		// Blue noise shares one sequence between all pixels, the mask decorrelates them
+		if (type == SamplerType::BlueNoise)
+			sampler.Seed = HashUInt(seed);
+		else
+			sampler.Seed = HashUInt(HashCombine(HashUInt(x + y * width), seed));
+
+		return sampler;
+	}
+
+	glm::vec4 SampleDimensions(const PixelSampler& sampler, uint32_t set)
+	{
+		uint32_t setSeed = HashUInt(HashCombine(sampler.Seed, set));
+
+		glm::vec4 u;
+		if (sampler.Type == SamplerType::Random)
+		{
+			uint32_t sampleSeed = HashUInt(HashCombine(setSeed, sampler.Index));
+			for (uint32_t i = 0; i < 4; i++)
+				u[i] = UIntToUnitFloat(HashUInt(HashCombine(sampleSeed, i)));
+			return u;
+		}
+
+		glm::uvec4 sobol = Sobol(NestedUniformScramble(sampler.Index, setSeed));
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			uint32_t dimensionSeed = HashUInt(HashCombine(setSeed, i));
+			uint32_t x = NestedUniformScramble(sobol[i], dimensionSeed);
+
+			if (sampler.Type == SamplerType::BlueNoise)
+			{
+				// Cranley-Patterson rotation by the mask, shifted differently for every dimension
+				uint32_t shiftX = (sampler.PixelX + (dimensionSeed & 0xFFFF)) % BLUE_NOISE_SIZE;
+				uint32_t shiftY = (sampler.PixelY + (dimensionSeed >> 16)) % BLUE_NOISE_SIZE;
+				uint32_t rank = GetBlueNoiseMask()[shiftX + shiftY * BLUE_NOISE_SIZE];
+				x += rank * s_BlueNoiseStep + s_BlueNoiseStep / 2;
+			}
+
+			u[i] = UIntToUnitFloat(x);
+		}
+
+		return u;
+	}
+
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+// CPU mirror of assets/shaders/RayTracing/Sampler.glsl
+
+namespace CPU {
+
+	enum class SamplerType : uint32_t
+	{
+		Random = 0, Sobol, BlueNoise
+	};
+
+	// Every sample draws its numbers from fixed sets of 4 dimensions, so the same decision of two paths
+	// always sees the same dimensions of the sequence. Set 0 jitters the camera ray inside the pixel, each
+	// bounce then has one set per decision.
+	constexpr uint32_t SAMPLE_SET_PIXEL = 0;
+
+	constexpr uint32_t BOUNCE_SET_LIGHT       = 0; // xyz, see LightSampler::Sample
+	constexpr uint32_t BOUNCE_SET_ENVIRONMENT = 1; // xy, see EnvironmentMap::Sample
+	constexpr uint32_t BOUNCE_SET_BSDF        = 2; // xy direction, z lobe, see DisneySample
+	constexpr uint32_t BOUNCE_SET_RR          = 3; // x, reserved for Russian roulette
+	constexpr uint32_t BOUNCE_SET_COUNT       = 4;
+
+	inline uint32_t BounceSampleSet(uint32_t bounceIndex, uint32_t dimension)
+	{
+		return 1 + bounceIndex * BOUNCE_SET_COUNT + dimension;
+	}
+
+	// Murmur3 finalizer and the combine of Burley, "Practical Hash-based Owen Scrambling" (2020)
+	inline uint32_t HashUInt(uint32_t x)
+	{
+		x ^= x >> 16;
+		x *= 0x85ebca6bu;
+		x ^= x >> 13;
+		x *= 0xc2b2ae35u;
+		x ^= x >> 16;
+		return x;
+	}
+
+	inline uint32_t HashCombine(uint32_t seed, uint32_t value)
+	{
+		return seed ^ (value + (seed << 6) + (seed >> 2));
+	}
+
+	inline uint32_t ReverseBits(uint32_t x)
+	{
+		x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+		x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+		x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+		x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+		return (x >> 16) | (x << 16);
+	}
+
+	// Owen scrambling of the bits of x, high bits first. Every bit is flipped depending only on the bits
+	// above it, so points stay in the same elementary intervals and a net stays a net.
+	inline uint32_t NestedUniformScramble(uint32_t x, uint32_t seed)
+	{
+		x = ReverseBits(x);
+		x += seed;
+		x ^= x * 0x6c50b47cu;
+		x ^= x * 0xb82f1e52u;
+		x ^= x * 0xc7afe638u;
+		x ^= x * 0x8d22f6e6u;
+		return ReverseBits(x);
+	}
+
+	// Dimensions 1 to 3 of the Sobol sequence (Joe and Kuo direction numbers), bit i of the index xors in
+	// entry i. Dimension 0 is the van der Corput sequence.
+	constexpr uint32_t SOBOL_DIRECTIONS[3][32] =
+	{
+		{
+			0x80000000, 0xc0000000, 0xa0000000, 0xf0000000, 0x88000000, 0xcc000000, 0xaa000000, 0xff000000,
+			0x80800000, 0xc0c00000, 0xa0a00000, 0xf0f00000, 0x88880000, 0xcccc0000, 0xaaaa0000, 0xffff0000,
+			0x80008000, 0xc000c000, 0xa000a000, 0xf000f000, 0x88008800, 0xcc00cc00, 0xaa00aa00, 0xff00ff00,
+			0x80808080, 0xc0c0c0c0, 0xa0a0a0a0, 0xf0f0f0f0, 0x88888888, 0xcccccccc, 0xaaaaaaaa, 0xffffffff
+		},
+		{
+			0x80000000, 0xc0000000, 0x60000000, 0x90000000, 0xe8000000, 0x5c000000, 0x8e000000, 0xc5000000,
+			0x68800000, 0x9cc00000, 0xee600000, 0x55900000, 0x80680000, 0xc09c0000, 0x60ee0000, 0x90550000,
+			0xe8808000, 0x5cc0c000, 0x8e606000, 0xc5909000, 0x6868e800, 0x9c9c5c00, 0xeeee8e00, 0x5555c500,
+			0x8000e880, 0xc0005cc0, 0x60008e60, 0x9000c590, 0xe8006868, 0x5c009c9c, 0x8e00eeee, 0xc5005555
+		},
+		{
+			0x80000000, 0xc0000000, 0x20000000, 0x50000000, 0xf8000000, 0x74000000, 0xa2000000, 0x93000000,
+			0xd8800000, 0x25400000, 0x59e00000, 0xe6d00000, 0x78080000, 0xb40c0000, 0x82020000, 0xc3050000,
+			0x208f8000, 0x51474000, 0xfbea2000, 0x75d93000, 0xa0858800, 0x914e5400, 0xdbe79e00, 0x25db6d00,
+			0x58800080, 0xe54000c0, 0x79e00020, 0xb6d00050, 0x800800f8, 0xc00c0074, 0x200200a2, 0x50050093
+		}
+	};
+
+	// All 4 dimensions at once, without branches on the bits of the scrambled index
+	inline glm::uvec4 Sobol(uint32_t index)
+	{
+		glm::uvec4 x = glm::uvec4(ReverseBits(index), 0u, 0u, 0u);
+		for (uint32_t bit = 0; index != 0; bit++, index >>= 1)
+		{
+			uint32_t mask = 0u - (index & 1);
+			x.y ^= SOBOL_DIRECTIONS[0][bit] & mask;
+			x.z ^= SOBOL_DIRECTIONS[1][bit] & mask;
+			x.w ^= SOBOL_DIRECTIONS[2][bit] & mask;
+		}
+		return x;
+	}
+
+	// Top 24 bits, so the result stays below 1
+	inline float UIntToUnitFloat(uint32_t x)
+	{
+		return (float)(x >> 8) * 5.96046448e-8f;
+	}
+
+	// 64x64 void and cluster ranks (Ulichney 1993), every value in [0, 4096) once. Generated on first use,
+	// the same buffer is uploaded for Sampler.glsl.
+	constexpr uint32_t BLUE_NOISE_SIZE = 64;
+	const std::vector<uint32_t>& GetBlueNoiseMask();
+	std::vector<uint32_t> GenerateBlueNoiseMask(uint32_t size, float sigma = 1.5f, uint32_t seed = 1);
+
+	// Numbers of one sample of one pixel
+	struct PixelSampler
+	{
+		SamplerType Type = SamplerType::Sobol;
+		uint32_t Index = 0;
+		uint32_t Seed = 0;
+		uint32_t PixelX = 0;
+		uint32_t PixelY = 0;
+	};
+
+	// sampleIndex counts the samples of the pixel over all frames. Seed decorrelates renders, 0 matches RayGen.glsl.
+	PixelSampler BeginPixelSample(SamplerType type, uint32_t x, uint32_t y, uint32_t width, uint32_t sampleIndex, uint32_t seed);
+
+	// The 4 dimensions of a set, in [0, 1).
+	// Random: independent hashes of the pixel, sample, set and dimension.
+	// Sobol: shuffled and Owen scrambled Sobol points (Burley 2020), scrambled per pixel and set. The
+	//        samples of a pixel are stratified in every dimension and jointly in xy.
+	// BlueNoise: one Owen scrambled sequence for the whole image, rotated per pixel by the blue noise mask
+	//            (Georgiev and Fajardo 2016). Neighbouring pixels get distant offsets, which pushes the
+	//            error of low sample counts into high frequencies.
+	glm::vec4 SampleDimensions(const PixelSampler& sampler, uint32_t set);
+
+	// Index of a sample of a pixel over the frames. The accumulation of frame 1 is thrown away, so frame 2
+	// starts at the beginning of the sequence. Stride is the most samples a pixel gets in a frame.
+	inline uint32_t SampleIndex(uint32_t frameIndex, uint32_t stride, uint32_t sample)
+	{
+		return (glm::max(frameIndex, 2u) - 2) * stride + sample;
+	}
+
+	const char* GetSamplerName(SamplerType type);
+
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include "CPU/Globals.h"
+
+// CPU mirror of assets/shaders/RayTracing/Sampling.glsl
+
+namespace CPU {
+
+	inline float GTR1(float NDotH, float a)
+	{
+		if (a >= 1.0f)
+			return INV_PI;
+		float a2 = a * a;
+		float t = 1.0f + (a2 - 1.0f) * NDotH * NDotH;
+		return (a2 - 1.0f) / (PI * glm::log(a2) * t);
+	}
+
+	inline glm::vec3 SampleGTR1(float rgh, float r1, float r2)
+	{
+		float a = glm::max(0.001f, rgh);
+		float a2 = a * a;
+
+		float phi = r1 * TWO_PI;
+
+		float cosTheta = glm::sqrt((1.0f - glm::pow(a2, 1.0f - r2)) / (1.0f - a2));
+		float sinTheta = glm::clamp(glm::sqrt(1.0f - (cosTheta * cosTheta)), 0.0f, 1.0f);
+		float sinPhi = glm::sin(phi);
+		float cosPhi = glm::cos(phi);
+
+		return glm::vec3(sinTheta * cosPhi, sinTheta * sinPhi, cosTheta);
+	}
+
+	inline float GTR2(float NDotH, float a)
+	{
+		float a2 = a * a;
+		float t = 1.0f + (a2 - 1.0f) * NDotH * NDotH;
+		return a2 / (PI * t * t);
+	}
+
+	inline glm::vec3 SampleGGXVNDF(const glm::vec3& V, float ax, float ay, float r1, float r2)
+	{
+		glm::vec3 Vh = glm::normalize(glm::vec3(ax * V.x, ay * V.y, V.z));
+
+		float lensq = Vh.x * Vh.x + Vh.y * Vh.y;
+		glm::vec3 T1 = lensq > 0.0f ? glm::vec3(-Vh.y, Vh.x, 0.0f) / glm::sqrt(lensq) : glm::vec3(1.0f, 0.0f, 0.0f);
+		glm::vec3 T2 = glm::cross(Vh, T1);
+
+		float r = glm::sqrt(r1);
+		float phi = 2.0f * PI * r2;
+		float t1 = r * glm::cos(phi);
+		float t2 = r * glm::sin(phi);
+		float s = 0.5f * (1.0f + Vh.z);
+		t2 = (1.0f - s) * glm::sqrt(1.0f - t1 * t1) + s * t2;
+
+		glm::vec3 Nh = t1 * T1 + t2 * T2 + glm::sqrt(glm::max(0.0f, 1.0f - t1 * t1 - t2 * t2)) * Vh;
+
+		return glm::normalize(glm::vec3(ax * Nh.x, ay * Nh.y, glm::max(0.0f, Nh.z)));
+	}
+
+	inline float GTR2Aniso(float NDotH, float HDotX, float HDotY, float ax, float ay)
+	{
+		float a = HDotX / ax;
+		float b = HDotY / ay;
+		float c = a * a + b * b + NDotH * NDotH;
+		return 1.0f / (PI * ax * ay * c * c);
+	}
+
+	inline float SmithG(float NDotV, float alphaG)
+	{
+		float a = alphaG * alphaG;
+		float b = NDotV * NDotV;
+		return (2.0f * NDotV) / (NDotV + glm::sqrt(a + b - a * b));
+	}
+
+	inline float SmithGAniso(float NDotV, float VDotX, float VDotY, float ax, float ay)
+	{
+		float a = VDotX * ax;
+		float b = VDotY * ay;
+		float c = NDotV;
+		return (2.0f * NDotV) / (NDotV + glm::sqrt(a * a + b * b + c * c));
+	}
+
+	inline float SchlickWeight(float u)
+	{
+		float m = glm::clamp(1.0f - u, 0.0f, 1.0f);
+		float m2 = m * m;
+		return m2 * m2 * m;
+	}
+
+	inline float DielectricFresnel(float cosThetaI, float eta)
+	{
+		float sinThetaTSq = eta * eta * (1.0f - cosThetaI * cosThetaI);
+
+		// Total internal reflection
+		if (sinThetaTSq > 1.0f)
+			return 1.0f;
+
+		float cosThetaT = glm::sqrt(glm::max(1.0f - sinThetaTSq, 0.0f));
+
+		float rs = (eta * cosThetaT - cosThetaI) / (eta * cosThetaT + cosThetaI);
+		float rp = (eta * cosThetaI - cosThetaT) / (eta * cosThetaI + cosThetaT);
+
+		return 0.5f * (rs * rs + rp * rp);
+	}
+
+	inline glm::vec3 CosineSampleHemisphere(float r1, float r2)
+	{
+		glm::vec3 dir;
+		float r = glm::sqrt(r1);
+		float phi = TWO_PI * r2;
+		dir.x = r * glm::cos(phi);
+		dir.y = r * glm::sin(phi);
+		dir.z = glm::sqrt(glm::max(0.0f, 1.0f - dir.x * dir.x - dir.y * dir.y));
+		return dir;
+	}
+
+	inline glm::vec3 UniformSampleHemisphere(float r1, float r2)
+	{
+		float r = glm::sqrt(glm::max(0.0f, 1.0f - r1 * r1));
+		float phi = TWO_PI * r2;
+		return glm::vec3(r * glm::cos(phi), r * glm::sin(phi), r1);
+	}
+
+	inline glm::vec3 UniformSampleSphere(float r1, float r2)
+	{
+		float z = 1.0f - 2.0f * r1;
+		float r = glm::sqrt(glm::max(0.0f, 1.0f - z * z));
+		float phi = TWO_PI * r2;
+		return glm::vec3(r * glm::cos(phi), r * glm::sin(phi), z);
+	}
+
+	inline float PowerHeuristic(float a, float b)
+	{
+		float t = a * a;
+		return t / (b * b + t);
+	}
+
+	inline void Onb(const glm::vec3& N, glm::vec3& T, glm::vec3& B)
+	{
+		glm::vec3 up = glm::abs(N.z) < 0.9999999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+		T = glm::normalize(glm::cross(up, N));
+		B = glm::cross(N, T);
+	}
+
+}
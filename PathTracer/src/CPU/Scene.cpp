@@ -0,0 +1,519 @@
+#include "CPU/Scene.h"
+#include "CPU/CompiledScene.h"
+#include "CPU/Disney.h"
+#include "CPU/ThreadPool.h"
+#include <limits>
+
+using namespace VkLibrary;
+
+namespace CPU {
+
+	static void TransformBounds(const glm::mat4& transform, const glm::vec3& boundsMin, const glm::vec3& boundsMax, glm::vec3& outMin, glm::vec3& outMax)
+	{
+		outMin = glm::vec3(std::numeric_limits<float>::max());
+		outMax = glm::vec3(-std::numeric_limits<float>::max());
+
+		for (uint32_t corner = 0; corner < 8; corner++)
+		{
+			glm::vec3 point = glm::vec3(
+				corner & 1 ? boundsMax.x : boundsMin.x,
+				corner & 2 ? boundsMax.y : boundsMin.y,
+				corner & 4 ? boundsMax.z : boundsMin.z);
+
+			glm::vec3 transformed = glm::vec3(transform * glm::vec4(point, 1.0f));
+			outMin = glm::min(outMin, transformed);
+			outMax = glm::max(outMax, transformed);
+		}
+	}
+
+	Scene::Scene(const Ref<MeshSource>& meshSource, const glm::mat4& transform)
+	{
+		MeshInstance meshInstance;
+		meshInstance.MeshIndex = AddMesh(meshSource);
+		meshInstance.Transform = transform;
+		AddInstance(meshInstance);
+
+		RebuildTopLevel();
+	}
+
+	Scene::Scene(const CompiledScene& compiledScene, const glm::mat4& transform)
+	{
+		MeshInstance meshInstance;
+		meshInstance.MeshIndex = AddMesh(compiledScene);
+		meshInstance.Transform = transform;
+		AddInstance(meshInstance);
+
+		RebuildTopLevel();
+	}
+
+	uint32_t Scene::AddMesh(const Ref<MeshSource>& meshSource)
+	{
+		SceneMesh mesh;
+		mesh.FirstGeometry = (uint32_t)m_Geometries.size();
+		mesh.GeometryCount = (uint32_t)meshSource->GetSubMeshes().size();
+		mesh.FirstMaterial = (uint32_t)m_Materials.size();
+		mesh.MaterialCount = (uint32_t)meshSource->GetMaterialBuffers().size();
+
+		uint32_t firstVertex = (uint32_t)m_Vertices.size();
+		uint32_t firstIndex = (uint32_t)m_Indices.size();
+		m_Vertices.insert(m_Vertices.end(), meshSource->GetVertices().begin(), meshSource->GetVertices().end());
+		m_Indices.insert(m_Indices.end(), meshSource->GetIndices().begin(), meshSource->GetIndices().end());
+
+		for (const MaterialBuffer& material : meshSource->GetMaterialBuffers())
+		{
+			m_Materials.push_back(material);
+			m_MaterialLobes.push_back(ClassifyMaterial(material));
+		}
+
+		const std::vector<SubMesh>& subMeshes = meshSource->GetSubMeshes();
+		m_Geometries.resize(mesh.FirstGeometry + mesh.GeometryCount);
+		m_BottomLevelBVHs.resize(mesh.FirstGeometry + mesh.GeometryCount);
+		m_BottomLevelWideBVHs.resize(mesh.FirstGeometry + mesh.GeometryCount);
+
+		// Bottom level BVHs are independent, build them all at once
+		ThreadPool::Get().ParallelFor(mesh.GeometryCount, [&](uint32_t i)
+		{
+			const SubMesh& subMesh = subMeshes[i];
+			uint32_t geometryIndex = mesh.FirstGeometry + i;
+
+			Geometry& geometry = m_Geometries[geometryIndex];
+			geometry.VertexOffset = firstVertex + subMesh.VertexOffset;
+			geometry.IndexOffset = firstIndex + subMesh.IndexOffset;
+			geometry.IndexCount = subMesh.IndexCount;
+			geometry.MaterialIndex = mesh.FirstMaterial + subMesh.MaterialIndex;
+			geometry.SubMeshTransform = subMesh.WorldTransform;
+
+			uint32_t triangleCount = subMesh.IndexCount / 3;
+			std::vector<glm::vec3> boundsMin(triangleCount);
+			std::vector<glm::vec3> boundsMax(triangleCount);
+
+			geometry.BoundsMin = glm::vec3(std::numeric_limits<float>::max());
+			geometry.BoundsMax = glm::vec3(-std::numeric_limits<float>::max());
+			for (uint32_t primitive = 0; primitive < triangleCount; primitive++)
+			{
+				boundsMin[primitive] = glm::vec3(std::numeric_limits<float>::max());
+				boundsMax[primitive] = glm::vec3(-std::numeric_limits<float>::max());
+				for (uint32_t corner = 0; corner < 3; corner++)
+				{
+					const glm::vec3& position = m_Vertices[m_Indices[geometry.IndexOffset + primitive * 3 + corner] + geometry.VertexOffset].Position;
+					boundsMin[primitive] = glm::min(boundsMin[primitive], position);
+					boundsMax[primitive] = glm::max(boundsMax[primitive], position);
+				}
+
+				geometry.BoundsMin = glm::min(geometry.BoundsMin, boundsMin[primitive]);
+				geometry.BoundsMax = glm::max(geometry.BoundsMax, boundsMax[primitive]);
+			}
+
+			m_BottomLevelBVHs[geometryIndex].Build(boundsMin, boundsMax);
+			m_BottomLevelWideBVHs[geometryIndex].Build(m_BottomLevelBVHs[geometryIndex], m_Vertices, m_Indices, geometry.VertexOffset, geometry.IndexOffset);
+		});
+
+		m_Meshes.push_back(mesh);
+		return (uint32_t)m_Meshes.size() - 1;
+	}
+
+	uint32_t Scene::AddMesh(const CompiledScene& compiledScene)
+	{
+		SceneMesh mesh;
+		mesh.FirstGeometry = (uint32_t)m_Geometries.size();
+		mesh.GeometryCount = compiledScene.GetSubMeshCount();
+		mesh.FirstMaterial = (uint32_t)m_Materials.size();
+		mesh.MaterialCount = compiledScene.GetMaterialCount();
+
+		uint32_t firstVertex = (uint32_t)m_Vertices.size();
+		uint32_t firstIndex = (uint32_t)m_Indices.size();
+		m_Vertices.insert(m_Vertices.end(), compiledScene.GetVertices(), compiledScene.GetVertices() + compiledScene.GetVertexCount());
+		m_Indices.insert(m_Indices.end(), compiledScene.GetIndices(), compiledScene.GetIndices() + compiledScene.GetIndexCount());
+
+		for (uint32_t i = 0; i < mesh.MaterialCount; i++)
+		{
+			m_Materials.push_back(compiledScene.GetMaterials()[i]);
+			m_MaterialLobes.push_back(ClassifyMaterial(m_Materials.back()));
+		}
+
+		m_Geometries.resize(mesh.FirstGeometry + mesh.GeometryCount);
+		m_BottomLevelBVHs.resize(mesh.FirstGeometry + mesh.GeometryCount);
+		m_BottomLevelWideBVHs.resize(mesh.FirstGeometry + mesh.GeometryCount);
+
+		for (uint32_t i = 0; i < mesh.GeometryCount; i++)
+		{
+			const CompiledSubMesh& subMesh = compiledScene.GetSubMeshes()[i];
+			uint32_t geometryIndex = mesh.FirstGeometry + i;
+			uint32_t triangleCount = subMesh.IndexCount / 3;
+
+			Geometry& geometry = m_Geometries[geometryIndex];
+			geometry.VertexOffset = firstVertex + subMesh.VertexOffset;
+			geometry.IndexOffset = firstIndex + subMesh.IndexOffset;
+			geometry.IndexCount = subMesh.IndexCount;
+			geometry.MaterialIndex = mesh.FirstMaterial + subMesh.MaterialIndex;
+			geometry.SubMeshTransform = subMesh.WorldTransform;
+			geometry.BoundsMin = subMesh.BoundsMin;
+			geometry.BoundsMax = subMesh.BoundsMax;
+
+			m_BottomLevelBVHs[geometryIndex].Load(compiledScene.GetNodes() + subMesh.NodeOffset, subMesh.NodeCount, compiledScene.GetPrimitiveIndices() + subMesh.PrimitiveIndexOffset, triangleCount);
+			m_BottomLevelWideBVHs[geometryIndex].Load(compiledScene.GetWideNodes() + subMesh.WideNodeOffset, subMesh.WideNodeCount, compiledScene.GetWideTriangles() + subMesh.WideTriangleOffset, triangleCount);
+		}
+
+		m_Meshes.push_back(mesh);
+		return (uint32_t)m_Meshes.size() - 1;
+	}
+
+	uint32_t Scene::AddInstance(const MeshInstance& meshInstance)
+	{
+		const SceneMesh& mesh = m_Meshes[meshInstance.MeshIndex];
+		uint32_t firstInstance = (uint32_t)m_Instances.size();
+		uint32_t meshInstanceIndex = (uint32_t)m_MeshInstances.size();
+		m_MeshInstances.push_back(meshInstance);
+
+		for (uint32_t geometryIndex = mesh.FirstGeometry; geometryIndex < mesh.FirstGeometry + mesh.GeometryCount; geometryIndex++)
+		{
+			const Geometry& geometry = m_Geometries[geometryIndex];
+
+			Instance instance;
+			instance.VertexOffset = geometry.VertexOffset;
+			instance.IndexOffset = geometry.IndexOffset;
+			instance.IndexCount = geometry.IndexCount;
+			instance.MaterialIndex = meshInstance.MaterialOverride >= 0 ? (uint32_t)meshInstance.MaterialOverride : geometry.MaterialIndex;
+			instance.BottomLevelIndex = geometryIndex;
+			instance.MeshInstanceIndex = meshInstanceIndex;
+			instance.ObjectBoundsMin = geometry.BoundsMin;
+			instance.ObjectBoundsMax = geometry.BoundsMax;
+
+			// Same instance transform the acceleration structure is built with
+			UpdateInstanceTransform(instance, meshInstance.Transform * geometry.SubMeshTransform);
+			m_Instances.push_back(instance);
+		}
+
+		return firstInstance;
+	}
+
+	void Scene::ClearInstances()
+	{
+		m_Instances.clear();
+		m_MeshInstances.clear();
+	}
+
+	void Scene::GetMeshBounds(uint32_t meshIndex, glm::vec3& boundsMin, glm::vec3& boundsMax) const
+	{
+		const SceneMesh& mesh = m_Meshes[meshIndex];
+
+		boundsMin = glm::vec3(std::numeric_limits<float>::max());
+		boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+		for (uint32_t geometryIndex = mesh.FirstGeometry; geometryIndex < mesh.FirstGeometry + mesh.GeometryCount; geometryIndex++)
+		{
+			const Geometry& geometry = m_Geometries[geometryIndex];
+
+			glm::vec3 geometryMin, geometryMax;
+			TransformBounds(geometry.SubMeshTransform, geometry.BoundsMin, geometry.BoundsMax, geometryMin, geometryMax);
+			boundsMin = glm::min(boundsMin, geometryMin);
+			boundsMax = glm::max(boundsMax, geometryMax);
+		}
+	}
+
+	std::vector<MeshInstance> CreateInstanceGrid(uint32_t meshIndex, uint32_t count, const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& transform)
+	{
+		uint32_t side = (uint32_t)glm::ceil(glm::sqrt((float)count));
+		glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(1e-3f));
+		float stepX = extent.x * 1.25f;
+		float stepZ = extent.z * 1.25f;
+
+		std::vector<MeshInstance> instances(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			float x = ((float)(i % side) - (float)(side - 1) * 0.5f) * stepX;
+			float z = ((float)(i / side) - (float)(side - 1) * 0.5f) * stepZ;
+
+			glm::mat4 offset = glm::mat4(1.0f);
+			offset[3] = glm::vec4(x, 0.0f, z, 1.0f);
+
+			instances[i].MeshIndex = meshIndex;
+			instances[i].Transform = transform * offset;
+		}
+
+		return instances;
+	}
+
+	void Scene::UpdateInstanceTransform(Instance& instance, const glm::mat4& objectToWorld)
+	{
+		instance.ObjectToWorld = objectToWorld;
+		instance.WorldToObject = glm::inverse(objectToWorld);
+		TransformBounds(instance.ObjectToWorld, instance.ObjectBoundsMin, instance.ObjectBoundsMax, instance.WorldBoundsMin, instance.WorldBoundsMax);
+	}
+
+	void Scene::SetInstanceTransform(uint32_t instanceIndex, const glm::mat4& objectToWorld)
+	{
+		UpdateInstanceTransform(m_Instances[instanceIndex], objectToWorld);
+
+		std::vector<glm::vec3> boundsMin, boundsMax;
+		GatherInstanceBounds(boundsMin, boundsMax);
+		m_TopLevelBVH.Refit(boundsMin, boundsMax);
+	}
+
+	void Scene::SetSubMeshTransform(uint32_t geometryIndex, const glm::mat4& subMeshTransform)
+	{
+		m_Geometries[geometryIndex].SubMeshTransform = subMeshTransform;
+		for (Instance& instance : m_Instances)
+		{
+			if (instance.BottomLevelIndex == geometryIndex)
+				UpdateInstanceTransform(instance, m_MeshInstances[instance.MeshInstanceIndex].Transform * subMeshTransform);
+		}
+
+		std::vector<glm::vec3> boundsMin, boundsMax;
+		GatherInstanceBounds(boundsMin, boundsMax);
+		m_TopLevelBVH.Refit(boundsMin, boundsMax);
+	}
+
+	void Scene::RebuildTopLevel()
+	{
+		std::vector<glm::vec3> boundsMin, boundsMax;
+		GatherInstanceBounds(boundsMin, boundsMax);
+		m_TopLevelBVH.Build(boundsMin, boundsMax);
+	}
+
+	void Scene::SetMaterial(uint32_t materialIndex, const MaterialBuffer& material)
+	{
+		m_Materials[materialIndex] = material;
+		m_MaterialLobes[materialIndex] = ClassifyMaterial(material);
+	}
+
+	void Scene::SetSIMDLevel(SIMDLevel level)
+	{
+		for (WideBVH& bvh : m_BottomLevelWideBVHs)
+			bvh.SetSIMDLevel(level);
+	}
+
+	void Scene::GatherInstanceBounds(std::vector<glm::vec3>& boundsMin, std::vector<glm::vec3>& boundsMax) const
+	{
+		boundsMin.resize(m_Instances.size());
+		boundsMax.resize(m_Instances.size());
+		for (size_t i = 0; i < m_Instances.size(); i++)
+		{
+			boundsMin[i] = m_Instances[i].WorldBoundsMin;
+			boundsMax[i] = m_Instances[i].WorldBoundsMax;
+		}
+	}
+
+	bool Scene::Intersect(const Ray& ray, Hit& hit) const
+	{
+		hit.Distance = -1.0f;
+		float tMax = ray.TMax;
+
+		m_TopLevelBVH.Traverse(ray.Origin, ray.Direction, ray.TMin, tMax, [&](uint32_t instanceIndex, float& tMax)
+		{
+			const Instance& instance = m_Instances[instanceIndex];
+
+			// Object space ray, the direction is left unnormalized so distances stay in world units
+			glm::vec3 origin = glm::vec3(instance.WorldToObject * glm::vec4(ray.Origin, 1.0f));
+			glm::vec3 direction = glm::vec3(instance.WorldToObject * glm::vec4(ray.Direction, 0.0f));
+
+			if (m_BottomLevelWideBVHs[instance.BottomLevelIndex].Intersect(origin, direction, ray.TMin, tMax, hit))
+				hit.InstanceIndex = instanceIndex;
+		});
+
+		return hit.Distance >= 0.0f;
+	}
+
+	bool Scene::Occluded(const Ray& ray) const
+	{
+		bool occluded = false;
+		float tMax = ray.TMax;
+
+		m_TopLevelBVH.Traverse(ray.Origin, ray.Direction, ray.TMin, tMax, [&](uint32_t instanceIndex, float& tMax)
+		{
+			if (occluded)
+				return;
+
+			const Instance& instance = m_Instances[instanceIndex];
+			glm::vec3 origin = glm::vec3(instance.WorldToObject * glm::vec4(ray.Origin, 1.0f));
+			glm::vec3 direction = glm::vec3(instance.WorldToObject * glm::vec4(ray.Direction, 0.0f));
+
+			if (m_BottomLevelWideBVHs[instance.BottomLevelIndex].Occluded(origin, direction, ray.TMin, tMax))
+			{
+				// Nothing is in front of a negative distance, which ends the traversal
+				occluded = true;
+				tMax = -1.0f;
+			}
+		});
+
+		return occluded;
+	}
+
+	void Scene::Intersect(const RayPacket& packet, Hit* hits) const
+	{
+		for (uint32_t ray = 0; ray < packet.Count; ray++)
+			hits[ray].Distance = -1.0f;
+
+		const std::vector<BVHNode>& nodes = m_TopLevelBVH.GetNodes();
+		const std::vector<uint32_t>& instanceIndices = m_TopLevelBVH.GetPrimitiveIndices();
+		if (nodes.empty() || packet.Count == 0)
+			return;
+
+		glm::vec3 inverseDirections[RayPacket::Size];
+		for (uint32_t ray = 0; ray < packet.Count; ray++)
+			inverseDirections[ray] = 1.0f / packet.Directions[ray];
+
+		// The top level is small, so it is walked without ordering and only the rays that reach
+		// a node are carried down to its children
+		struct StackEntry
+		{
+			uint32_t NodeIndex;
+			uint32_t RayMask;
+		};
+
+		StackEntry stack[BVH::MaxDepth * 2];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = { 0, (1u << packet.Count) - 1 };
+
+		RayPacket objectPacket = packet;
+		while (stackSize > 0)
+		{
+			StackEntry entry = stack[--stackSize];
+			const BVHNode& node = nodes[entry.NodeIndex];
+
+			uint32_t rayMask = 0;
+			for (uint32_t ray = 0; ray < packet.Count; ray++)
+			{
+				if ((entry.RayMask & (1u << ray)) && IntersectAABB(packet.Origins[ray], inverseDirections[ray], node.BoundsMin, node.BoundsMax, packet.TMin[ray], objectPacket.TMax[ray]) >= 0.0f)
+					rayMask |= 1u << ray;
+			}
+
+			if (rayMask == 0)
+				continue;
+
+			if (node.PrimitiveCount == 0)
+			{
+				stack[stackSize++] = { node.LeftFirst + 1, rayMask };
+				stack[stackSize++] = { node.LeftFirst, rayMask };
+				continue;
+			}
+
+			for (uint32_t i = 0; i < node.PrimitiveCount; i++)
+			{
+				uint32_t instanceIndex = instanceIndices[node.LeftFirst + i];
+				const Instance& instance = m_Instances[instanceIndex];
+
+				for (uint32_t ray = 0; ray < packet.Count; ray++)
+				{
+					objectPacket.Origins[ray] = glm::vec3(instance.WorldToObject * glm::vec4(packet.Origins[ray], 1.0f));
+					objectPacket.Directions[ray] = glm::vec3(instance.WorldToObject * glm::vec4(packet.Directions[ray], 0.0f));
+				}
+
+				uint32_t hitMask = m_BottomLevelWideBVHs[instance.BottomLevelIndex].IntersectPacket(objectPacket, hits, rayMask);
+				for (uint32_t ray = 0; ray < packet.Count; ray++)
+				{
+					if (hitMask & (1u << ray))
+						hits[ray].InstanceIndex = instanceIndex;
+				}
+			}
+		}
+	}
+
+	bool Scene::IntersectBruteForce(const Ray& ray, Hit& hit) const
+	{
+		hit.Distance = -1.0f;
+		float tMax = ray.TMax;
+
+		for (uint32_t instanceIndex = 0; instanceIndex < (uint32_t)m_Instances.size(); instanceIndex++)
+		{
+			const Instance& instance = m_Instances[instanceIndex];
+			glm::vec3 origin = glm::vec3(instance.WorldToObject * glm::vec4(ray.Origin, 1.0f));
+			glm::vec3 direction = glm::vec3(instance.WorldToObject * glm::vec4(ray.Direction, 0.0f));
+
+			for (uint32_t primitive = 0; primitive < instance.IndexCount / 3; primitive++)
+			{
+				float t;
+				glm::vec2 barycentrics;
+				if (IntersectPrimitive(instance, primitive, origin, direction, ray.TMin, tMax, t, barycentrics))
+				{
+					tMax = t;
+					hit.Distance = t;
+					hit.InstanceIndex = instanceIndex;
+					hit.PrimitiveIndex = primitive;
+					hit.Barycentrics = barycentrics;
+				}
+			}
+		}
+
+		return hit.Distance >= 0.0f;
+	}
+
+	bool Scene::IntersectPrimitive(const Instance& instance, uint32_t primitive, const glm::vec3& origin, const glm::vec3& direction, float tMin, float tMax, float& t, glm::vec2& barycentrics) const
+	{
+		const uint32_t* indices = m_Indices.data() + instance.IndexOffset + primitive * 3;
+		const Vertex* vertices = m_Vertices.data() + instance.VertexOffset;
+
+		return IntersectTriangle(origin, direction, vertices[indices[0]].Position, vertices[indices[1]].Position, vertices[indices[2]].Position, tMin, tMax, t, barycentrics);
+	}
+
+	void Scene::FillPayload(const Ray& ray, const Hit& hit, Payload& payload) const
+	{
+		const Instance& instance = m_Instances[hit.InstanceIndex];
+		const MaterialBuffer& material = m_Materials[instance.MaterialIndex];
+
+		// UnpackVertex + InterpolateVertex
+		glm::vec3 barycentrics = glm::vec3(1.0f - hit.Barycentrics.x - hit.Barycentrics.y, hit.Barycentrics.x, hit.Barycentrics.y);
+
+		glm::vec3 position = glm::vec3(0.0f);
+		glm::vec3 normal = glm::vec3(0.0f);
+		glm::vec4 tangent = glm::vec4(0.0f);
+		glm::vec3 binormal = glm::vec3(0.0f);
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			uint32_t index = m_Indices[hit.PrimitiveIndex * 3 + i + instance.IndexOffset] + instance.VertexOffset;
+			const Vertex& vertex = m_Vertices[index];
+
+			glm::vec3 vertexBinormal = glm::cross(glm::normalize(glm::vec3(vertex.Tangent)), glm::normalize(vertex.Normal)) * vertex.Tangent.w;
+
+			position += vertex.Position * barycentrics[i];
+			normal += vertex.Normal * barycentrics[i];
+			tangent += vertex.Tangent * barycentrics[i];
+			binormal += vertexBinormal * barycentrics[i];
+		}
+
+		normal = glm::normalize(normal);
+		tangent = glm::normalize(tangent);
+		binormal = glm::normalize(binormal);
+
+		// Organize the data
+		glm::mat3 objectToWorld = glm::mat3(instance.ObjectToWorld);
+		glm::vec3 worldPosition = glm::vec3(instance.ObjectToWorld * glm::vec4(position, 1.0f));
+		glm::vec3 worldNormal = glm::normalize(objectToWorld * normal);
+		glm::mat3 worldNormalMatrix = objectToWorld * glm::mat3(glm::vec3(tangent), binormal, normal);
+		worldNormalMatrix = glm::mat3(glm::normalize(worldNormalMatrix[0]), glm::normalize(worldNormalMatrix[1]), glm::normalize(worldNormalMatrix[2]));
+		glm::vec3 view = -ray.Direction;
+
+		// Fill the payload
+		payload.Distance			= hit.Distance;
+		payload.Albedo				= material.data.AlbedoValue;
+		payload.Roughness			= material.data.RoughnessValue;
+		payload.Metallic			= material.data.MetallicValue;
+		payload.Emission			= material.data.EmissiveValue * material.data.EmissiveStrength;
+		payload.WorldPosition		= worldPosition;
+		payload.WorldNormal			= worldNormal;
+		payload.WorldNormalMatrix	= worldNormalMatrix;
+		payload.Binormal			= glm::normalize(objectToWorld * binormal);
+		payload.Tangent				= glm::normalize(objectToWorld * glm::vec3(tangent));
+		payload.View				= view;
+		payload.WorldRayDirection	= ray.Direction;
+
+		payload.Anisotropic = material.Anisotropic;
+		payload.Subsurface = material.Subsurface;
+		payload.SpecularTint = material.SpecularTint;
+		payload.Sheen = material.Sheen;
+		payload.SheenTint = material.SheenTint;
+		payload.Clearcoat = material.Clearcoat;
+		payload.ClearcoatRoughness = material.ClearcoatRoughness;
+		payload.SpecTrans = material.SpecTrans;
+		payload.ior = material.ior;
+
+		float aspect = glm::sqrt(1.0f - payload.Anisotropic * 0.9f);
+		payload.ax = glm::max(0.001f, payload.Roughness / aspect);
+		payload.ay = glm::max(0.001f, payload.Roughness * aspect);
+		payload.eta = glm::dot(view, worldNormal) < 0.0f ? (1.0f / payload.ior) : payload.ior;
+		payload.Lobes = m_MaterialLobes[instance.MaterialIndex];
+
+		payload.InstanceIndex = hit.InstanceIndex;
+		payload.PrimitiveIndex = hit.PrimitiveIndex;
+	}
+
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include "CPU/Globals.h"
+#include "CPU/Intersection.h"
+#include "CPU/BVH.h"
+#include "CPU/WideBVH.h"
+#include "Graphics/Mesh.h"
+
+namespace CPU {
+
+	class CompiledScene;
+
+	// Submesh of a unique mesh with its own bottom level BVH, shared by every instance of the mesh
+	struct Geometry
+	{
+		uint32_t VertexOffset = 0;
+		uint32_t IndexOffset = 0;
+		uint32_t IndexCount = 0;
+		uint32_t MaterialIndex = 0;
+
+		// Placement of the submesh inside its mesh, applied before the instance transform
+		glm::mat4 SubMeshTransform = glm::mat4(1.0f);
+
+		glm::vec3 BoundsMin;
+		glm::vec3 BoundsMax;
+	};
+
+	// Mesh added once with AddMesh, its submeshes are the geometries [FirstGeometry, FirstGeometry + GeometryCount)
+	// and its materials start at FirstMaterial
+	struct SceneMesh
+	{
+		uint32_t FirstGeometry = 0;
+		uint32_t GeometryCount = 0;
+		uint32_t FirstMaterial = 0;
+		uint32_t MaterialCount = 0;
+	};
+
+	// Placement of a whole mesh. MaterialOverride indexes the materials of the scene and replaces the
+	// material of every submesh, -1 keeps them.
+	struct MeshInstance
+	{
+		uint32_t MeshIndex = 0;
+		glm::mat4 Transform = glm::mat4(1.0f);
+		int32_t MaterialOverride = -1;
+	};
+
+	// One per submesh of every mesh instance, the CPU equivalent of a top level acceleration structure
+	// instance. The geometry fields are copied from the Geometry so hit shading reads a single record.
+	struct Instance
+	{
+		uint32_t VertexOffset = 0;
+		uint32_t IndexOffset = 0;
+		uint32_t IndexCount = 0;
+		uint32_t MaterialIndex = 0;
+		uint32_t BottomLevelIndex = 0;
+		uint32_t MeshInstanceIndex = 0;
+
+		glm::mat4 ObjectToWorld;
+		glm::mat4 WorldToObject;
+
+		glm::vec3 ObjectBoundsMin;
+		glm::vec3 ObjectBoundsMax;
+		glm::vec3 WorldBoundsMin;
+		glm::vec3 WorldBoundsMax;
+	};
+
+	// count instances of a mesh on a square grid in the xz plane of the mesh, a quarter of the mesh
+	// size apart and centered on where the mesh is, then placed by transform. A single instance is
+	// the mesh itself.
+	std::vector<MeshInstance> CreateInstanceGrid(uint32_t meshIndex, uint32_t count, const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& transform);
+
+	// CPU copy of the geometry and materials the GPU sees through m_VertexBuffers,
+	// m_IndexBuffers, m_SubmeshData, m_InstanceData and m_Materials in ClosestHit.glsl. Mirrors
+	// InstancedAccelerationStructure: one triangle BVH per submesh of every unique mesh and a
+	// top level BVH over the transformed bounds of every instance, so memory and build time grow
+	// with the unique geometry and an instance only costs its top level entry. Rays are traced
+	// through an 8-wide copy of each triangle BVH, the binary ones are kept for refitting.
+	class Scene
+	{
+	public:
+		Scene() = default;
+
+		// One instance of the mesh
+		Scene(const VkLibrary::Ref<VkLibrary::MeshSource>& meshSource, const glm::mat4& transform);
+
+		// Copies the geometry and BVHs out of the mapped file, only the top level is built
+		Scene(const CompiledScene& compiledScene, const glm::mat4& transform);
+
+		// Builds the bottom level BVHs of every submesh and returns the mesh index for AddInstance.
+		// Material indices of the mesh are offset by the materials already in the scene.
+		uint32_t AddMesh(const VkLibrary::Ref<VkLibrary::MeshSource>& meshSource);
+		uint32_t AddMesh(const CompiledScene& compiledScene);
+
+		// Adds one instance per submesh of the mesh, in submesh order, and returns the index of the
+		// first. Call RebuildTopLevel once every instance is added.
+		uint32_t AddInstance(const MeshInstance& meshInstance);
+		void ClearInstances();
+
+		// Object space bounds of a mesh with its submesh transforms applied
+		void GetMeshBounds(uint32_t meshIndex, glm::vec3& boundsMin, glm::vec3& boundsMax) const;
+
+		bool Intersect(const Ray& ray, Hit& hit) const;
+
+		// Any hit before ray.TMax, for shadow rays
+		bool Occluded(const Ray& ray) const;
+
+		// Closest hits of a packet of coherent rays, hits[i] belongs to packet ray i
+		void Intersect(const RayPacket& packet, Hit* hits) const;
+
+		// Reference intersection without the BVH, used to validate it
+		bool IntersectBruteForce(const Ray& ray, Hit& hit) const;
+
+		// Refits the top level BVH, call RebuildTopLevel once instances have moved far from where they started
+		void SetInstanceTransform(uint32_t instanceIndex, const glm::mat4& objectToWorld);
+		void RebuildTopLevel();
+
+		// Moves a submesh inside its mesh in every instance of the mesh, with a single refit
+		void SetSubMeshTransform(uint32_t geometryIndex, const glm::mat4& subMeshTransform);
+
+		// Also classifies the material again, see ClassifyMaterial
+		void SetMaterial(uint32_t materialIndex, const VkLibrary::MaterialBuffer& material);
+
+		// Node test of every wide BVH, see WideBVH::SetSIMDLevel
+		void SetSIMDLevel(SIMDLevel level);
+
+		// Equivalent of ClosestHit.glsl main(), texture lookups are not available on the CPU
+		void FillPayload(const Ray& ray, const Hit& hit, Payload& payload) const;
+
+		const std::vector<VkLibrary::Vertex>& GetVertices() const { return m_Vertices; }
+		const std::vector<uint32_t>& GetIndices() const { return m_Indices; }
+		const std::vector<VkLibrary::MaterialBuffer>& GetMaterials() const { return m_Materials; }
+		const std::vector<uint32_t>& GetMaterialLobes() const { return m_MaterialLobes; }
+		const std::vector<Instance>& GetInstances() const { return m_Instances; }
+		const std::vector<Geometry>& GetGeometries() const { return m_Geometries; }
+		const std::vector<SceneMesh>& GetMeshes() const { return m_Meshes; }
+		const std::vector<MeshInstance>& GetMeshInstances() const { return m_MeshInstances; }
+		const std::vector<BVH>& GetBottomLevelBVHs() const { return m_BottomLevelBVHs; }
+		const std::vector<WideBVH>& GetBottomLevelWideBVHs() const { return m_BottomLevelWideBVHs; }
+		const BVH& GetTopLevelBVH() const { return m_TopLevelBVH; }
+
+		const glm::vec3& GetBoundsMin() const { return m_TopLevelBVH.GetBoundsMin(); }
+		const glm::vec3& GetBoundsMax() const { return m_TopLevelBVH.GetBoundsMax(); }
+
+	private:
+		void UpdateInstanceTransform(Instance& instance, const glm::mat4& objectToWorld);
+		void GatherInstanceBounds(std::vector<glm::vec3>& boundsMin, std::vector<glm::vec3>& boundsMax) const;
+		bool IntersectPrimitive(const Instance& instance, uint32_t primitive, const glm::vec3& origin, const glm::vec3& direction, float tMin, float tMax, float& t, glm::vec2& barycentrics) const;
+
+	private:
+		std::vector<VkLibrary::Vertex> m_Vertices;
+		std::vector<uint32_t> m_Indices;
+		std::vector<VkLibrary::MaterialBuffer> m_Materials;
+		std::vector<uint32_t> m_MaterialLobes;
+		std::vector<Instance> m_Instances;
+		std::vector<Geometry> m_Geometries;
+		std::vector<SceneMesh> m_Meshes;
+		std::vector<MeshInstance> m_MeshInstances;
+
+		std::vector<BVH> m_BottomLevelBVHs;
+		std::vector<WideBVH> m_BottomLevelWideBVHs;
+		BVH m_TopLevelBVH;
+	};
+
+}
@@ -0,0 +1,143 @@
+#include "CPU/ThreadPool.h"
+#include <algorithm>
+
+namespace CPU {
+
+	static thread_local int s_WorkerIndex = -1;
+	static uint32_t s_DefaultThreadCount = 0;
+
+	ThreadPool::ThreadPool(uint32_t threadCount)
+	{
+		if (threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+		for (uint32_t i = 0; i < threadCount; i++)
+			m_Queues.push_back(std::make_unique<WorkQueue>());
+
+		for (uint32_t i = 0; i < threadCount; i++)
+			m_Threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_WakeMutex);
+			m_Running = false;
+		}
+		m_WakeCondition.notify_all();
+
+		for (std::thread& thread : m_Threads)
+			thread.join();
+	}
+
+	void ThreadPool::Submit(Job job)
+	{
+		// Workers push onto their own queue to keep nested work local, everyone else round-robins
+		uint32_t queueIndex = s_WorkerIndex >= 0 ? (uint32_t)s_WorkerIndex : m_NextQueue++ % (uint32_t)m_Queues.size();
+
+		{
+			std::lock_guard<std::mutex> lock(m_Queues[queueIndex]->Mutex);
+			m_Queues[queueIndex]->Jobs.push_back(std::move(job));
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_WakeMutex);
+			m_QueuedJobs++;
+		}
+		m_WakeCondition.notify_one();
+	}
+
+	void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func)
+	{
+		if (count == 0)
+			return;
+
+		std::atomic<uint32_t> remaining = count;
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			Submit([&func, &remaining, i]()
+			{
+				func(i);
+				remaining--;
+			});
+		}
+
+		// Help out instead of blocking, this also keeps nested ParallelFor calls from deadlocking
+		while (remaining > 0)
+		{
+			if (!TryRunJob(s_WorkerIndex))
+				std::this_thread::yield();
+		}
+	}
+
+	ThreadPool& ThreadPool::Get()
+	{
+		static ThreadPool s_ThreadPool(s_DefaultThreadCount);
+		return s_ThreadPool;
+	}
+
+	void ThreadPool::SetDefaultThreadCount(uint32_t threadCount)
+	{
+		s_DefaultThreadCount = threadCount;
+	}
+
+	void ThreadPool::WorkerLoop(uint32_t workerIndex)
+	{
+		s_WorkerIndex = (int)workerIndex;
+
+		while (true)
+		{
+			if (TryRunJob(s_WorkerIndex))
+				continue;
+
+			std::unique_lock<std::mutex> lock(m_WakeMutex);
+			m_WakeCondition.wait(lock, [this]() { return !m_Running || m_QueuedJobs > 0; });
+
+			if (!m_Running && m_QueuedJobs == 0)
+				return;
+		}
+	}
+
+	bool ThreadPool::TryRunJob(int workerIndex)
+	{
+		Job job;
+		uint32_t queueCount = (uint32_t)m_Queues.size();
+
+		// Own queue first (LIFO for cache locality), then steal (FIFO) from the others
+		bool found = workerIndex >= 0 && PopJob((uint32_t)workerIndex, true, job);
+		uint32_t start = workerIndex >= 0 ? (uint32_t)workerIndex + 1 : 0;
+		for (uint32_t i = 0; i < queueCount && !found; i++)
+			found = PopJob((start + i) % queueCount, false, job);
+
+		if (!found)
+			return false;
+
+		m_QueuedJobs--;
+		job();
+		return true;
+	}
+
+	bool ThreadPool::PopJob(uint32_t queueIndex, bool back, Job& job)
+	{
+		WorkQueue& queue = *m_Queues[queueIndex];
+
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		if (queue.Jobs.empty())
+			return false;
+
+		if (back)
+		{
+			job = std::move(queue.Jobs.back());
+			queue.Jobs.pop_back();
+		}
+		else
+		{
+			job = std::move(queue.Jobs.front());
+			queue.Jobs.pop_front();
+		}
+
+		return true;
+	}
+
+}
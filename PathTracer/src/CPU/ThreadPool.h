@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace CPU {
+
+	// Work-stealing thread pool. Every worker owns a queue that it pops from the back,
+	// idle workers steal from the front of the other queues.
+	class ThreadPool
+	{
+	public:
+		using Job = std::function<void()>;
+
+		// threadCount == 0 uses every hardware thread
+		ThreadPool(uint32_t threadCount = 0);
+		~ThreadPool();
+
+		void Submit(Job job);
+
+		// Runs func(i) for i in [0, count) and blocks until all of them finished.
+		// The calling thread helps with the work, so it is safe to nest.
+		void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func);
+
+		uint32_t GetThreadCount() const { return (uint32_t)m_Threads.size(); }
+
+		// Shared pool used by the renderer, SetDefaultThreadCount must be called before the first Get()
+		static ThreadPool& Get();
+		static void SetDefaultThreadCount(uint32_t threadCount);
+
+	private:
+		struct WorkQueue
+		{
+			std::mutex Mutex;
+			std::deque<Job> Jobs;
+		};
+
+		void WorkerLoop(uint32_t workerIndex);
+		bool TryRunJob(int workerIndex);
+		bool PopJob(uint32_t queueIndex, bool back, Job& job);
+
+	private:
+		std::vector<std::unique_ptr<WorkQueue>> m_Queues;
+		std::vector<std::thread> m_Threads;
+
+		std::mutex m_WakeMutex;
+		std::condition_variable m_WakeCondition;
+		std::atomic<uint32_t> m_QueuedJobs = 0;
+		std::atomic<uint32_t> m_NextQueue = 0;
+		bool m_Running = true;
+	};
+
+}
@@ -0,0 +1,179 @@
+#include "CPU/TiledRenderer.h"
+#include "Util/Hash.h"
+#include <chrono>
+
+using namespace VkLibrary;
+
+namespace CPU {
+
+	static PathTracerSpecification TileSpecification(const TiledRenderSpecification& specification)
+	{
+		PathTracerSpecification spec = specification.PathTracerSpec;
+		spec.Width = glm::min(specification.TileSize, spec.Width);
+		spec.Height = glm::min(specification.TileSize, spec.Height);
+
+		// Every tile has a camera of its own, there is nothing to reproject between them
+		spec.Reprojection = false;
+		return spec;
+	}
+
+	uint32_t TileSeed(uint32_t seed, uint32_t tile)
+	{
+		return (uint32_t)Hasher().Add(seed).Add(tile).Get();
+	}
+
+	CameraBuffer CropCamera(const CameraBuffer& camera, const glm::uvec2& offset, const glm::uvec2& size, uint32_t width, uint32_t height)
+	{
+		// Maps the tile's normalized device coordinates onto the part of the frame's it covers
+		glm::vec2 scale = glm::vec2(size) / glm::vec2((float)width, (float)height);
+		glm::vec2 translation = (2.0f * glm::vec2(offset) + glm::vec2(size)) / glm::vec2((float)width, (float)height) - 1.0f;
+
+		glm::mat4 crop = glm::mat4(1.0f);
+		crop[0][0] = scale.x;
+		crop[1][1] = scale.y;
+		crop[3][0] = translation.x;
+		crop[3][1] = translation.y;
+		glm::mat4 inverseCrop = glm::inverse(crop);
+
+		CameraBuffer tileCamera = camera;
+		tileCamera.ViewProjection = inverseCrop * camera.ViewProjection;
+		tileCamera.InverseViewProjection = camera.InverseViewProjection * crop;
+		tileCamera.InverseProjection = camera.InverseProjection * crop;
+		return tileCamera;
+	}
+
+	void ResolveTile(const std::vector<glm::vec4>& accumulation, std::vector<glm::vec4>& pixels)
+	{
+		pixels.resize(accumulation.size());
+		for (size_t i = 0; i < accumulation.size(); i++)
+			pixels[i] = accumulation[i].w > 0.0f ? glm::vec4(glm::vec3(accumulation[i]) / accumulation[i].w, 1.0f) : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	bool WriteEXR(RenderCheckpoint& checkpoint, const std::string& filepath)
+	{
+		TiledEXRWriter writer;
+		if (!writer.Open(filepath, checkpoint.GetWidth(), checkpoint.GetHeight(), checkpoint.GetTileSize()))
+			return false;
+
+		std::vector<glm::vec4> accumulation, pixels;
+		for (uint32_t tile = 0; tile < checkpoint.GetTileCount(); tile++)
+		{
+			glm::uvec2 offset, size;
+			checkpoint.GetTileRect(tile, offset, size);
+
+			if (checkpoint.GetTileFrames(tile) > 0)
+			{
+				if (!checkpoint.ReadTile(tile, accumulation))
+					return false;
+			}
+			else
+			{
+				accumulation.assign((size_t)size.x * size.y, glm::vec4(0.0f));
+			}
+
+			ResolveTile(accumulation, pixels);
+			if (!writer.WriteTile(tile % checkpoint.GetTilesX(), tile / checkpoint.GetTilesX(), pixels))
+				return false;
+		}
+
+		return writer.Close();
+	}
+
+	TiledRenderer::TiledRenderer(const TiledRenderSpecification& specification, const Ref<Scene>& scene)
+		: m_Specification(specification), m_Scene(scene), m_PathTracer(TileSpecification(specification), scene)
+	{
+	}
+
+	bool TiledRenderer::Open(const std::string& name)
+	{
+		const PathTracerSpecification& spec = m_Specification.PathTracerSpec;
+		std::string checkpointPath = name + ".checkpoint";
+
+		// Without a matching checkpoint the render starts over
+		m_ResumedTileCount = 0;
+		if (m_Checkpoint.Open(checkpointPath))
+		{
+			if (m_Checkpoint.GetWidth() != spec.Width || m_Checkpoint.GetHeight() != spec.Height ||
+				m_Checkpoint.GetTileSize() != m_Specification.TileSize || m_Checkpoint.GetSeed() != spec.Seed)
+				return false;
+		}
+		else if (!m_Checkpoint.Create(checkpointPath, spec.Width, spec.Height, m_Specification.TileSize, spec.Seed))
+		{
+			return false;
+		}
+
+		if (!m_Writer.Open(name + ".exr", spec.Width, spec.Height, m_Specification.TileSize))
+			return false;
+
+		std::vector<glm::vec4> accumulation;
+		for (uint32_t tile = 0; tile < m_Checkpoint.GetTileCount(); tile++)
+		{
+			if (!IsTileComplete(tile))
+				continue;
+
+			if (!m_Checkpoint.ReadTile(tile, accumulation))
+				return false;
+
+			ResolveTile(accumulation, m_TilePixels);
+			if (!m_Writer.WriteTile(tile % m_Checkpoint.GetTilesX(), tile / m_Checkpoint.GetTilesX(), m_TilePixels))
+				return false;
+
+			m_ResumedTileCount++;
+		}
+
+		return true;
+	}
+
+	bool TiledRenderer::RenderTile(const CameraBuffer& camera, uint32_t tile)
+	{
+		const PathTracerSpecification& spec = m_Specification.PathTracerSpec;
+		m_LastSampleCount = 0;
+		if (IsTileComplete(tile))
+			return true;
+
+		glm::uvec2 offset, size;
+		m_Checkpoint.GetTileRect(tile, offset, size);
+		CameraBuffer tileCamera = CropCamera(camera, offset, size, spec.Width, spec.Height);
+
+		m_PathTracer.Resize(size.x, size.y);
+		m_PathTracer.SetSeed(TileSeed(spec.Seed, tile));
+
+		uint32_t frames = m_Checkpoint.GetTileFrames(tile);
+		if (frames > 0)
+		{
+			std::vector<glm::vec4> accumulation;
+			if (!m_Checkpoint.ReadTile(tile, accumulation))
+				return false;
+			m_PathTracer.SetAccumulation(accumulation);
+		}
+
+		auto lastCheckpoint = std::chrono::high_resolution_clock::now();
+		while (frames < m_Specification.FramesPerTile)
+		{
+			// Frame 1 doesn't keep its paths (same as RayGen.glsl), the buffer starts out cleared instead
+			m_PathTracer.Render(tileCamera, frames + 2);
+			m_LastSampleCount += m_PathTracer.GetLastSampleCount();
+			frames++;
+
+			auto now = std::chrono::high_resolution_clock::now();
+			if (frames < m_Specification.FramesPerTile && std::chrono::duration<float>(now - lastCheckpoint).count() >= m_Specification.CheckpointInterval)
+			{
+				if (!m_Checkpoint.WriteTile(tile, m_PathTracer.GetAccumulationBuffer(), frames))
+					return false;
+				lastCheckpoint = now;
+			}
+		}
+
+		if (!m_Checkpoint.WriteTile(tile, m_PathTracer.GetAccumulationBuffer(), frames))
+			return false;
+
+		ResolveTile(m_PathTracer.GetAccumulationBuffer(), m_TilePixels);
+		return m_Writer.WriteTile(tile % m_Checkpoint.GetTilesX(), tile / m_Checkpoint.GetTilesX(), m_TilePixels);
+	}
+
+	bool TiledRenderer::Close()
+	{
+		return m_Writer.Close();
+	}
+
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "CPU/PathTracer.h"
+#include "CPU/RenderCheckpoint.h"
+#include "CPU/EXRWriter.h"
+
+namespace CPU {
+
+	struct TiledRenderSpecification
+	{
+		// Width and Height are of the whole frame, Seed of the whole render. Every tile is rendered with
+		// these settings at the tile's size.
+		PathTracerSpecification PathTracerSpec;
+
+		uint32_t TileSize = 256;
+		uint32_t FramesPerTile = 16;
+
+		// Seconds between checkpoints of the tile in flight, finished tiles are always checkpointed
+		float CheckpointInterval = 60.0f;
+	};
+
+	// Seed of a tile's PathTracer. Pixel indices restart in every tile, the seed keeps the tiles from
+	// repeating each other's noise.
+	uint32_t TileSeed(uint32_t seed, uint32_t tile);
+
+	// Camera whose rays through the pixels of a size.x x size.y image are the rays through the pixels
+	// [offset, offset + size) of camera's width x height frame
+	CameraBuffer CropCamera(const CameraBuffer& camera, const glm::uvec2& offset, const glm::uvec2& size, uint32_t width, uint32_t height);
+
+	// RGB of a tile from its sum + path count pixels, black where no path was accumulated
+	void ResolveTile(const std::vector<glm::vec4>& accumulation, std::vector<glm::vec4>& pixels);
+
+	// Writes every tile of a checkpoint to a tiled EXR
+	bool WriteEXR(RenderCheckpoint& checkpoint, const std::string& filepath);
+
+	// Renders frames too large for full frame buffers one tile at a time with a PathTracer of the tile's
+	// size, so memory only depends on TileSize. The accumulation of the tile in flight is checkpointed
+	// to name.checkpoint and finished tiles are streamed to name.exr. Opening an existing checkpoint of
+	// the same frame resumes it: finished tiles are copied to the EXR and the rest continue from their
+	// last checkpointed frame.
+	class TiledRenderer
+	{
+	public:
+		TiledRenderer(const TiledRenderSpecification& specification, const VkLibrary::Ref<Scene>& scene);
+
+		// False if the files can't be written, or an existing checkpoint is of another frame or seed
+		bool Open(const std::string& name);
+
+		// Accumulates the tile's remaining frames and streams it to the EXR
+		bool RenderTile(const CameraBuffer& camera, uint32_t tile);
+
+		// Fails if a tile wasn't rendered
+		bool Close();
+
+		bool IsTileComplete(uint32_t tile) const { return m_Checkpoint.GetTileFrames(tile) >= m_Specification.FramesPerTile; }
+		uint32_t GetTileCount() const { return m_Checkpoint.GetTileCount(); }
+
+		// Tiles that were complete in the checkpoint when it was opened
+		uint32_t GetResumedTileCount() const { return m_ResumedTileCount; }
+
+		// Paths traced by the last RenderTile
+		uint64_t GetLastSampleCount() const { return m_LastSampleCount; }
+
+		const RenderCheckpoint& GetCheckpoint() const { return m_Checkpoint; }
+		const TiledRenderSpecification& GetSpecification() const { return m_Specification; }
+
+	private:
+		TiledRenderSpecification m_Specification;
+		VkLibrary::Ref<Scene> m_Scene;
+		PathTracer m_PathTracer;
+
+		RenderCheckpoint m_Checkpoint;
+		TiledEXRWriter m_Writer;
+
+		std::vector<glm::vec4> m_TilePixels;
+		uint32_t m_ResumedTileCount = 0;
+		uint64_t m_LastSampleCount = 0;
+	};
+
+}
@@ -0,0 +1,156 @@
+#include "CPU/VolumeTracking.h"
+#include <limits>
+
+namespace CPU {
+
+	static constexpr float s_RouletteThreshold = 0.1f;
+
+	struct VoxelRay
+	{
+		glm::vec3 Origin;
+		glm::vec3 Direction; // Voxels per world unit, so ray distances stay in world units
+	};
+
+	static VoxelRay ToVoxelSpace(const VolumeMedium& medium, const glm::vec3& origin, const glm::vec3& direction)
+	{
+		glm::vec3 scale = medium.WorldToTexture * glm::vec3(medium.Volume->GetSize());
+		return { origin * scale - 0.5f, direction * scale };
+	}
+
+	// 3D DDA over the majorant grid, calls cellFunc(t0, t1, maxDensity) for every cell the ray
+	// crosses until it returns false or tMax is reached
+	template<typename Func>
+	static void TraverseMajorants(const VolumeMedium& medium, const VoxelRay& ray, float tMax, TrackingStats& stats, Func&& cellFunc)
+	{
+		float cellSize = (float)medium.Volume->GetMajorantCellSize();
+
+		glm::ivec3 cell = glm::ivec3(glm::floor(ray.Origin / cellSize));
+		glm::ivec3 step;
+		glm::vec3 tNext;
+		glm::vec3 tDelta;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (ray.Direction[axis] > 0.0f)
+			{
+				step[axis] = 1;
+				tDelta[axis] = cellSize / ray.Direction[axis];
+				tNext[axis] = ((cell[axis] + 1) * cellSize - ray.Origin[axis]) / ray.Direction[axis];
+			}
+			else if (ray.Direction[axis] < 0.0f)
+			{
+				step[axis] = -1;
+				tDelta[axis] = -cellSize / ray.Direction[axis];
+				tNext[axis] = (cell[axis] * cellSize - ray.Origin[axis]) / ray.Direction[axis];
+			}
+			else
+			{
+				step[axis] = 0;
+				tDelta[axis] = std::numeric_limits<float>::max();
+				tNext[axis] = std::numeric_limits<float>::max();
+			}
+		}
+
+		float t = 0.0f;
+		while (t < tMax)
+		{
+			int axis = tNext.x < tNext.y ? (tNext.x < tNext.z ? 0 : 2) : (tNext.y < tNext.z ? 1 : 2);
+			float cellEnd = glm::min(tNext[axis], tMax);
+
+			stats.MajorantCells++;
+			if (!cellFunc(t, cellEnd, medium.Volume->GetMajorant(cell).x))
+				return;
+
+			t = cellEnd;
+			cell[axis] += step[axis];
+			tNext[axis] += tDelta[axis];
+		}
+	}
+
+	static float SigmaAt(const VolumeMedium& medium, const VoxelRay& ray, float t, TrackingStats& stats)
+	{
+		stats.DensityLookups++;
+		return medium.Volume->Density(ray.Origin + ray.Direction * t) * medium.SigmaScale;
+	}
+
+	float RayMarchTransmittance(const VolumeMedium& medium, const glm::vec3& origin, const glm::vec3& direction, float tMax, float stepSize, TrackingStats& stats)
+	{
+		VoxelRay ray = ToVoxelSpace(medium, origin, direction);
+
+		float opticalDepth = 0.0f;
+		for (float t = 0.0f; t < tMax; t += stepSize)
+		{
+			float segment = glm::min(stepSize, tMax - t);
+			opticalDepth += SigmaAt(medium, ray, t + segment * 0.5f, stats) * segment;
+		}
+
+		return glm::exp(-opticalDepth);
+	}
+
+	float RatioTrackingTransmittance(const VolumeMedium& medium, const glm::vec3& origin, const glm::vec3& direction, float tMax, uint32_t& seed, TrackingStats& stats)
+	{
+		VoxelRay ray = ToVoxelSpace(medium, origin, direction);
+
+		float transmittance = 1.0f;
+		TraverseMajorants(medium, ray, tMax, stats, [&](float t0, float t1, float maxDensity)
+		{
+			float majorant = maxDensity * medium.SigmaScale;
+			if (majorant <= 0.0f)
+				return true;
+
+			float t = t0;
+			while (true)
+			{
+				t -= glm::log(1.0f - RandomValue(seed)) / majorant;
+				if (t >= t1)
+					return true;
+
+				transmittance *= 1.0f - SigmaAt(medium, ray, t, stats) / majorant;
+
+				// Russian roulette keeps long rays through dense regions cheap without adding bias
+				if (transmittance < s_RouletteThreshold)
+				{
+					if (RandomValue(seed) * s_RouletteThreshold >= transmittance)
+					{
+						transmittance = 0.0f;
+						return false;
+					}
+					transmittance = s_RouletteThreshold;
+				}
+			}
+		});
+
+		return transmittance;
+	}
+
+	bool DeltaTracking(const VolumeMedium& medium, const glm::vec3& origin, const glm::vec3& direction, float tMax, uint32_t& seed, float& t, TrackingStats& stats)
+	{
+		VoxelRay ray = ToVoxelSpace(medium, origin, direction);
+
+		bool collided = false;
+		TraverseMajorants(medium, ray, tMax, stats, [&](float t0, float t1, float maxDensity)
+		{
+			float majorant = maxDensity * medium.SigmaScale;
+			if (majorant <= 0.0f)
+				return true;
+
+			float sampleT = t0;
+			while (true)
+			{
+				sampleT -= glm::log(1.0f - RandomValue(seed)) / majorant;
+				if (sampleT >= t1)
+					return true;
+
+				// Real collision with probability sigma / majorant, otherwise a null collision
+				if (RandomValue(seed) * majorant < SigmaAt(medium, ray, sampleT, stats))
+				{
+					t = sampleT;
+					collided = true;
+					return false;
+				}
+			}
+		});
+
+		return collided;
+	}
+
+}
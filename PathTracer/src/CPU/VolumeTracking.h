@@ -0,0 +1,30 @@
+#pragma once
+#include "CPU/Globals.h"
+#include "Volume/BrickVolume.h"
+
+namespace CPU {
+
+	// How the brick volume is placed in the world, mirrors TraceCloudPath in RayGen.glsl
+	struct VolumeMedium
+	{
+		const BrickVolume* Volume = nullptr;
+		float WorldToTexture = 0.2f; // Texture coordinate = world position * WorldToTexture
+		float SigmaScale = 0.8f;     // Extinction = density * SigmaScale (AbsorptionFactor.x)
+	};
+
+	struct TrackingStats
+	{
+		uint64_t DensityLookups = 0;
+		uint64_t MajorantCells = 0;
+	};
+
+	// Deterministic reference, exp(-sum(sigma * step)) with midpoint samples every stepSize
+	float RayMarchTransmittance(const VolumeMedium& medium, const glm::vec3& origin, const glm::vec3& direction, float tMax, float stepSize, TrackingStats& stats);
+
+	// Unbiased transmittance estimate between 0 and tMax, majorant cells with no density cost no lookups
+	float RatioTrackingTransmittance(const VolumeMedium& medium, const glm::vec3& origin, const glm::vec3& direction, float tMax, uint32_t& seed, TrackingStats& stats);
+
+	// Samples a free flight distance, returns false if the ray leaves [0, tMax] without a real collision
+	bool DeltaTracking(const VolumeMedium& medium, const glm::vec3& origin, const glm::vec3& direction, float tMax, uint32_t& seed, float& t, TrackingStats& stats);
+
+}
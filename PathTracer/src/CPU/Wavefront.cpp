@@ -0,0 +1,462 @@
+#include "CPU/Wavefront.h"
+#include "CPU/PathTracer.h"
+#include "CPU/Disney.h"
+#include "CPU/ThreadPool.h"
+#include <atomic>
+#include <chrono>
+
+using namespace VkLibrary;
+
+namespace CPU {
+
+	// Queue entries per thread pool job, also the granularity of the compaction prefix sums
+	static constexpr uint32_t s_ChunkSize = 4096;
+
+	// Material of hit queue entries without a hit, only used when the queues are not compacted
+	static constexpr uint32_t s_NoMaterial = 0xFFFFFFFF;
+
+	using Clock = std::chrono::high_resolution_clock;
+
+	static uint32_t GetChunkCount(uint32_t count)
+	{
+		return (count + s_ChunkSize - 1) / s_ChunkSize;
+	}
+
+	// Runs func(begin, end, chunk) for every chunk of [0, count)
+	template<typename Func>
+	static void ParallelForChunks(uint32_t count, const Func& func)
+	{
+		ThreadPool::Get().ParallelFor(GetChunkCount(count), [&](uint32_t chunk)
+		{
+			uint32_t begin = chunk * s_ChunkSize;
+			func(begin, glm::min(begin + s_ChunkSize, count), chunk);
+		});
+	}
+
+	const char* GetWavefrontStageName(WavefrontStage stage)
+	{
+		switch (stage)
+		{
+			case WavefrontStage::Generate:   return "Generate";
+			case WavefrontStage::Extend:     return "Extend";
+			case WavefrontStage::Sort:       return "Sort";
+			case WavefrontStage::Shade:      return "Shade";
+			case WavefrontStage::Continue:   return "Continue";
+			case WavefrontStage::Accumulate: return "Accumulate";
+			default:                         return "Unknown";
+		}
+	}
+
+	void RayQueue::Resize(uint32_t capacity)
+	{
+		Origins.resize(capacity);
+		Directions.resize(capacity);
+		Paths.resize(capacity);
+		Alive.resize(capacity);
+		Count = 0;
+	}
+
+	void HitQueue::Resize(uint32_t capacity)
+	{
+		Rays.resize(capacity);
+		Distances.resize(capacity);
+		Instances.resize(capacity);
+		Primitives.resize(capacity);
+		Barycentrics.resize(capacity);
+		Materials.resize(capacity);
+		Count = 0;
+	}
+
+	WavefrontIntegrator::WavefrontIntegrator(const Ref<Scene>& scene, const WavefrontSpecification& specification)
+		: m_Specification(specification), m_Scene(scene)
+	{
+	}
+
+	void WavefrontIntegrator::Resize(uint32_t pathCount)
+	{
+		m_PathCount = pathCount;
+
+		m_PathRadiance.resize(pathCount);
+		m_PathThroughput.resize(pathCount);
+		m_PathSeeds.resize(pathCount);
+		m_SampleSums.resize(pathCount);
+
+		m_RayQueues[0].Resize(pathCount);
+		m_RayQueues[1].Resize(pathCount);
+		m_RayHits.resize(pathCount);
+
+		m_HitQueue.Resize(pathCount);
+		m_SortedHits.resize(pathCount);
+
+		m_ChunkCounts.resize(GetChunkCount(pathCount));
+	}
+
+	void WavefrontIntegrator::Render(const PathTracerSpecification& specification, const CameraBuffer& camera, uint32_t frameIndex,
+		std::vector<glm::vec4>& accumulation, std::vector<glm::vec4>& moments, std::vector<glm::vec4>& image)
+	{
+		uint32_t pathCount = specification.Width * specification.Height;
+		if (pathCount != m_PathCount)
+			Resize(pathCount);
+
+		Clock::time_point start = Clock::now();
+		auto endStage = [&](WavefrontStage stage)
+		{
+			Clock::time_point end = Clock::now();
+			m_Stats.StageSeconds[(uint32_t)stage] += std::chrono::duration<double>(end - start).count();
+			start = end;
+		};
+
+		for (uint32_t sampleIndex = 0; sampleIndex < specification.SamplesPerPixel; sampleIndex++)
+		{
+			Generate(specification, camera, frameIndex, sampleIndex);
+			endStage(WavefrontStage::Generate);
+
+			// Unlike the GPU the queue length is known here, so the bounce loop stops once every path ended
+			for (uint32_t bounce = 0; bounce < specification.MaxBounces && m_RayQueues[m_QueueIndex].Count > 0; bounce++)
+			{
+				Extend(specification);
+				endStage(WavefrontStage::Extend);
+
+				if (m_Specification.SortByMaterial)
+				{
+					Sort();
+					endStage(WavefrontStage::Sort);
+				}
+
+				Shade(bounce, specification.MaxBounces);
+				endStage(WavefrontStage::Shade);
+
+				Continue();
+				endStage(WavefrontStage::Continue);
+			}
+
+			Accumulate(frameIndex, sampleIndex, specification.SamplesPerPixel, accumulation, moments, image);
+			endStage(WavefrontStage::Accumulate);
+		}
+	}
+
+	void WavefrontIntegrator::Generate(const PathTracerSpecification& specification, const CameraBuffer& camera, uint32_t frameIndex, uint32_t sampleIndex)
+	{
+		uint32_t width = specification.Width;
+		uint32_t height = specification.Height;
+
+		m_QueueIndex = 0;
+		RayQueue& queue = m_RayQueues[0];
+		queue.Count = m_PathCount;
+
+		ParallelForChunks(m_PathCount, [&](uint32_t begin, uint32_t end, uint32_t /*chunk*/)
+		{
+			for (uint32_t path = begin; path < end; path++)
+			{
+				// Samples are traced in separate waves, so every one of them starts from its own seed (same as Wavefront.glsl)
+				uint32_t seed = path * frameIndex;
+				seed ^= specification.Seed * 0x9E3779B9u;
+				seed += sampleIndex * 0x9E3779B9u;
+				PCG_Hash(seed);
+
+				glm::vec2 pixelCenter = glm::vec2((float)(path % width), (float)(path / width)) + glm::vec2(0.5f);
+				if (sampleIndex > 0)
+					pixelCenter += RandomPointInCircle(seed);
+
+				Ray ray = GenerateCameraRay(camera, pixelCenter, width, height);
+
+				queue.Origins[path] = ray.Origin;
+				queue.Directions[path] = ray.Direction;
+				queue.Paths[path] = path;
+				queue.Alive[path] = 1;
+
+				m_PathRadiance[path] = glm::vec3(0.0f);
+				m_PathThroughput[path] = glm::vec3(1.0f);
+				m_PathSeeds[path] = seed;
+
+				if (sampleIndex == 0)
+					m_SampleSums[path] = glm::vec4(0.0f);
+			}
+		});
+	}
+
+	void WavefrontIntegrator::Extend(const PathTracerSpecification& specification)
+	{
+		RayQueue& queue = m_RayQueues[m_QueueIndex];
+		const std::vector<Instance>& instances = m_Scene->GetInstances();
+		const EnvironmentMap* environment = specification.Environment && specification.Environment->IsValid() ? specification.Environment.get() : nullptr;
+
+		std::atomic<uint64_t> raysTraced = 0;
+		ParallelForChunks(queue.Count, [&](uint32_t begin, uint32_t end, uint32_t chunk)
+		{
+			uint32_t hitCount = 0;
+			uint32_t rayCount = 0;
+			for (uint32_t i = begin; i < end; i++)
+			{
+				if (!queue.Alive[i])
+					continue;
+
+				Ray ray;
+				ray.Origin = queue.Origins[i];
+				ray.Direction = queue.Directions[i];
+				rayCount++;
+
+				// MISS
+				if (!m_Scene->Intersect(ray, m_RayHits[i]))
+				{
+					// The environment is only reached by BSDF sampling here, so it needs no MIS weight
+					uint32_t path = queue.Paths[i];
+					glm::vec3 sky = environment ? environment->Eval(ray.Direction) : specification.SkyColor;
+					m_PathRadiance[path] += sky * m_PathThroughput[path];
+					queue.Alive[i] = 0;
+					continue;
+				}
+
+				hitCount++;
+			}
+
+			m_ChunkCounts[chunk] = hitCount;
+			raysTraced += rayCount;
+		});
+
+		m_Stats.QueueSlots += queue.Count;
+		m_Stats.RaysTraced += raysTraced;
+
+		// Compacted, the hit queue only holds hits. Otherwise it mirrors the ray queue slot for slot.
+		bool compact = m_Specification.CompactQueues;
+		m_HitQueue.Count = compact ? ScanChunks(queue.Count) : queue.Count;
+
+		ParallelForChunks(queue.Count, [&](uint32_t begin, uint32_t end, uint32_t chunk)
+		{
+			uint32_t hitIndex = compact ? m_ChunkCounts[chunk] : begin;
+			for (uint32_t i = begin; i < end; i++)
+			{
+				if (!queue.Alive[i])
+				{
+					if (!compact)
+						m_HitQueue.Materials[hitIndex++] = s_NoMaterial;
+					continue;
+				}
+
+				const Hit& hit = m_RayHits[i];
+				m_HitQueue.Rays[hitIndex] = i;
+				m_HitQueue.Distances[hitIndex] = hit.Distance;
+				m_HitQueue.Instances[hitIndex] = hit.InstanceIndex;
+				m_HitQueue.Primitives[hitIndex] = hit.PrimitiveIndex;
+				m_HitQueue.Barycentrics[hitIndex] = hit.Barycentrics;
+				m_HitQueue.Materials[hitIndex] = instances[hit.InstanceIndex].MaterialIndex;
+				hitIndex++;
+			}
+		});
+	}
+
+	void WavefrontIntegrator::Sort()
+	{
+		// Stable counting sort, every chunk histograms its hits, the (bin, chunk) offsets come from one
+		// serial scan and every chunk scatters its hits back in order. The last bin holds the empty entries.
+		uint32_t binCount = (uint32_t)m_Scene->GetMaterials().size() + 1;
+		uint32_t chunkCount = GetChunkCount(m_HitQueue.Count);
+		m_BinCounts.assign((size_t)chunkCount * binCount, 0);
+
+		auto getBin = [&](uint32_t hit)
+		{
+			uint32_t material = m_HitQueue.Materials[hit];
+			return material == s_NoMaterial ? binCount - 1 : material;
+		};
+
+		ParallelForChunks(m_HitQueue.Count, [&](uint32_t begin, uint32_t end, uint32_t chunk)
+		{
+			uint32_t* counts = &m_BinCounts[(size_t)chunk * binCount];
+			for (uint32_t i = begin; i < end; i++)
+				counts[getBin(i)]++;
+		});
+
+		uint32_t offset = 0;
+		for (uint32_t bin = 0; bin < binCount; bin++)
+		{
+			for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+			{
+				uint32_t count = m_BinCounts[(size_t)chunk * binCount + bin];
+				m_BinCounts[(size_t)chunk * binCount + bin] = offset;
+				offset += count;
+			}
+		}
+
+		ParallelForChunks(m_HitQueue.Count, [&](uint32_t begin, uint32_t end, uint32_t chunk)
+		{
+			uint32_t* offsets = &m_BinCounts[(size_t)chunk * binCount];
+			for (uint32_t i = begin; i < end; i++)
+				m_SortedHits[offsets[getBin(i)]++] = i;
+		});
+	}
+
+	void WavefrontIntegrator::Shade(uint32_t bounce, uint32_t maxBounces)
+	{
+		RayQueue& queue = m_RayQueues[m_QueueIndex];
+		bool sorted = m_Specification.SortByMaterial;
+
+		std::atomic<uint64_t> hitsShaded = 0;
+		std::atomic<uint64_t> materialSwitches = 0;
+		ParallelForChunks(m_HitQueue.Count, [&](uint32_t begin, uint32_t end, uint32_t /*chunk*/)
+		{
+			ScatterSampleRec scatterSample;
+			Payload payload;
+
+			uint32_t shadeCount = 0;
+			uint32_t switchCount = 0;
+			uint32_t previousMaterial = s_NoMaterial;
+
+			for (uint32_t i = begin; i < end; i++)
+			{
+				uint32_t hitIndex = sorted ? m_SortedHits[i] : i;
+				uint32_t material = m_HitQueue.Materials[hitIndex];
+				if (material == s_NoMaterial)
+					continue;
+
+				if (previousMaterial != s_NoMaterial && material != previousMaterial)
+					switchCount++;
+				previousMaterial = material;
+				shadeCount++;
+
+				uint32_t rayIndex = m_HitQueue.Rays[hitIndex];
+				uint32_t path = queue.Paths[rayIndex];
+
+				Ray ray;
+				ray.Origin = queue.Origins[rayIndex];
+				ray.Direction = queue.Directions[rayIndex];
+
+				Hit hit;
+				hit.Distance = m_HitQueue.Distances[hitIndex];
+				hit.InstanceIndex = m_HitQueue.Instances[hitIndex];
+				hit.PrimitiveIndex = m_HitQueue.Primitives[hitIndex];
+				hit.Barycentrics = m_HitQueue.Barycentrics[hitIndex];
+
+				m_Scene->FillPayload(ray, hit, payload);
+
+				glm::vec3& throughput = m_PathThroughput[path];
+				m_PathRadiance[path] += payload.Emission * throughput;
+
+				// Sample BSDF for color and outgoing direction
+				glm::vec3 ffNormal = glm::dot(-ray.Direction, payload.WorldNormal) < 0.0f ? -payload.WorldNormal : payload.WorldNormal;
+				scatterSample.f = DisneySample(payload, -ray.Direction, ffNormal, scatterSample.L, scatterSample.pdf, m_PathSeeds[path]);
+				if (scatterSample.pdf <= 0.0f || bounce + 1 >= maxBounces)
+				{
+					queue.Alive[rayIndex] = 0;
+					continue;
+				}
+
+				throughput *= scatterSample.f / scatterSample.pdf;
+
+				// The continuation ray reuses the slot, the continue stage compacts the queue
+				glm::vec3 fhp = ray.Origin + ray.Direction * payload.Distance;
+
+				const float EPS = 0.0003f;
+				queue.Directions[rayIndex] = scatterSample.L;
+				queue.Origins[rayIndex] = fhp + scatterSample.L * EPS;
+			}
+
+			hitsShaded += shadeCount;
+			materialSwitches += switchCount;
+		});
+
+		m_Stats.HitsShaded += hitsShaded;
+		m_Stats.MaterialSwitches += materialSwitches;
+	}
+
+	void WavefrontIntegrator::Continue()
+	{
+		RayQueue& queue = m_RayQueues[m_QueueIndex];
+
+		ParallelForChunks(queue.Count, [&](uint32_t begin, uint32_t end, uint32_t chunk)
+		{
+			uint32_t aliveCount = 0;
+			for (uint32_t i = begin; i < end; i++)
+				aliveCount += queue.Alive[i];
+
+			m_ChunkCounts[chunk] = aliveCount;
+		});
+
+		uint32_t aliveCount = ScanChunks(queue.Count);
+
+		// Uncompacted, dead paths keep their slots and only an empty queue ends the bounce loop
+		if (!m_Specification.CompactQueues)
+		{
+			if (aliveCount == 0)
+				queue.Count = 0;
+			return;
+		}
+
+		RayQueue& next = m_RayQueues[m_QueueIndex ^ 1];
+		ParallelForChunks(queue.Count, [&](uint32_t begin, uint32_t end, uint32_t chunk)
+		{
+			uint32_t slot = m_ChunkCounts[chunk];
+			for (uint32_t i = begin; i < end; i++)
+			{
+				if (!queue.Alive[i])
+					continue;
+
+				next.Origins[slot] = queue.Origins[i];
+				next.Directions[slot] = queue.Directions[i];
+				next.Paths[slot] = queue.Paths[i];
+				next.Alive[slot] = 1;
+				slot++;
+			}
+		});
+
+		next.Count = aliveCount;
+		queue.Count = 0;
+		m_QueueIndex ^= 1;
+	}
+
+	void WavefrontIntegrator::Accumulate(uint32_t frameIndex, uint32_t sampleIndex, uint32_t sampleCount,
+		std::vector<glm::vec4>& accumulation, std::vector<glm::vec4>& moments, std::vector<glm::vec4>& image)
+	{
+		bool resolve = sampleIndex + 1 == sampleCount;
+
+		ParallelForChunks(m_PathCount, [&](uint32_t begin, uint32_t end, uint32_t /*chunk*/)
+		{
+			for (uint32_t pixel = begin; pixel < end; pixel++)
+			{
+				glm::vec3 pathColor = m_PathRadiance[pixel];
+				glm::vec4& sums = m_SampleSums[pixel];
+				sums += glm::vec4(pathColor, Luminance(pathColor) * Luminance(pathColor));
+
+				if (!resolve)
+					continue;
+
+				// Same as the end of PathTracer::RenderPixel
+				glm::vec3 color = glm::vec3(sums);
+				float numPaths = (float)sampleCount;
+				if (frameIndex > 1)
+				{
+					color += glm::vec3(accumulation[pixel]);
+					numPaths = accumulation[pixel].w + (float)sampleCount;
+
+					accumulation[pixel] = glm::vec4(color, numPaths);
+					moments[pixel].x += sums.w;
+				}
+				else
+				{
+					accumulation[pixel] = glm::vec4(0.0f);
+					moments[pixel] = glm::vec4(0.0f);
+				}
+
+				color /= numPaths;
+
+				if (glm::any(glm::isnan(color)))
+					image[pixel] = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+				else
+					image[pixel] = glm::vec4(color, 1.0f);
+			}
+		});
+	}
+
+	uint32_t WavefrontIntegrator::ScanChunks(uint32_t count)
+	{
+		uint32_t total = 0;
+		for (uint32_t chunk = 0; chunk < GetChunkCount(count); chunk++)
+		{
+			uint32_t chunkCount = m_ChunkCounts[chunk];
+			m_ChunkCounts[chunk] = total;
+			total += chunkCount;
+		}
+
+		return total;
+	}
+
+}
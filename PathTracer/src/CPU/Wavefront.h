@@ -0,0 +1,120 @@
+#pragma once
+#include "CPU/Scene.h"
+#include "ShaderBuffers.h"
+#include <vector>
+
+namespace CPU {
+
+	struct PathTracerSpecification;
+
+	struct WavefrontSpecification
+	{
+		// Shade the hit queue in material order instead of ray order
+		bool SortByMaterial = true;
+
+		// Compact the ray queue after every bounce. Without it every path keeps its slot and the
+		// extend stage steps over the ones that ended.
+		bool CompactQueues = true;
+	};
+
+	enum class WavefrontStage
+	{
+		Generate = 0, Extend, Sort, Shade, Continue, Accumulate, Count
+	};
+
+	const char* GetWavefrontStageName(WavefrontStage stage);
+
+	struct WavefrontStats
+	{
+		double StageSeconds[(uint32_t)WavefrontStage::Count] = {};
+
+		uint64_t QueueSlots = 0;   // Ray queue entries the extend stage visited
+		uint64_t RaysTraced = 0;
+		uint64_t HitsShaded = 0;
+
+		// Neighbouring hits in shading order with different materials, how often a SIMD group would diverge
+		uint64_t MaterialSwitches = 0;
+	};
+
+	// Structure-of-arrays ray queue, Paths maps an entry back to its pixel
+	struct RayQueue
+	{
+		std::vector<glm::vec3> Origins;
+		std::vector<glm::vec3> Directions;
+		std::vector<uint32_t> Paths;
+		std::vector<uint8_t> Alive;
+		uint32_t Count = 0;
+
+		void Resize(uint32_t capacity);
+	};
+
+	// Structure-of-arrays hit queue, Rays indexes the ray queue the hits were traced from
+	struct HitQueue
+	{
+		std::vector<uint32_t> Rays;
+		std::vector<float> Distances;
+		std::vector<uint32_t> Instances;
+		std::vector<uint32_t> Primitives;
+		std::vector<glm::vec2> Barycentrics;
+		std::vector<uint32_t> Materials;
+		uint32_t Count = 0;
+
+		void Resize(uint32_t capacity);
+	};
+
+	// CPU implementation of Wavefront.glsl. Renders one sample per pixel at a time through separate
+	// generate, extend, sort, shade, continue and accumulate stages, each a parallel loop over a queue.
+	// Same stage structure as the GPU version so compaction and sorting can be measured without one.
+	class WavefrontIntegrator
+	{
+	public:
+		WavefrontIntegrator(const VkLibrary::Ref<Scene>& scene, const WavefrontSpecification& specification = WavefrontSpecification());
+
+		// Equivalent of PathTracer::Render, samples every pixel uniformly
+		void Render(const PathTracerSpecification& specification, const CameraBuffer& camera, uint32_t frameIndex,
+			std::vector<glm::vec4>& accumulation, std::vector<glm::vec4>& moments, std::vector<glm::vec4>& image);
+
+		const WavefrontStats& GetStats() const { return m_Stats; }
+		void ResetStats() { m_Stats = WavefrontStats(); }
+
+		const WavefrontSpecification& GetSpecification() const { return m_Specification; }
+
+	private:
+		void Resize(uint32_t pathCount);
+
+		void Generate(const PathTracerSpecification& specification, const CameraBuffer& camera, uint32_t frameIndex, uint32_t sampleIndex);
+		void Extend(const PathTracerSpecification& specification);
+		void Sort();
+		void Shade(uint32_t bounce, uint32_t maxBounces);
+		void Continue();
+		void Accumulate(uint32_t frameIndex, uint32_t sampleIndex, uint32_t sampleCount,
+			std::vector<glm::vec4>& accumulation, std::vector<glm::vec4>& moments, std::vector<glm::vec4>& image);
+
+		// Exclusive prefix sum of the per chunk counts of a queue with count entries, returns the total
+		uint32_t ScanChunks(uint32_t count);
+
+	private:
+		WavefrontSpecification m_Specification;
+		VkLibrary::Ref<Scene> m_Scene;
+		uint32_t m_PathCount = 0;
+
+		// Path state, one entry per pixel
+		std::vector<glm::vec3> m_PathRadiance;
+		std::vector<glm::vec3> m_PathThroughput;
+		std::vector<uint32_t> m_PathSeeds;
+		std::vector<glm::vec4> m_SampleSums; // rgb sum of the frame's samples, w sum of squared luminance
+
+		RayQueue m_RayQueues[2];
+		uint32_t m_QueueIndex = 0;
+		std::vector<Hit> m_RayHits; // Extend results before they are compacted into the hit queue
+
+		HitQueue m_HitQueue;
+		std::vector<uint32_t> m_SortedHits;
+
+		std::vector<uint32_t> m_ChunkCounts;
+		std::vector<uint32_t> m_BinCounts; // Per chunk material histograms of the sort
+
+		WavefrontStats m_Stats;
+	};
+
+}
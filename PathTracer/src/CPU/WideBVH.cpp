@@ -0,0 +1,518 @@
+#include "CPU/WideBVH.h"
+#include <limits>
+
+#if defined(_M_X64) || defined(__x86_64__)
+	#define WIDE_BVH_X86 1
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+		#define TARGET_AVX2
+	#else
+		#define TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#else
+	#define WIDE_BVH_X86 0
+#endif
+
+using namespace VkLibrary;
+
+namespace CPU {
+
+	static constexpr uint32_t s_Width = WideBVHNode::Width;
+
+	// Entries pushed by one node never exceed its width, and the tree is no deeper than the binary one
+	static constexpr uint32_t s_StackSize = BVH::MaxDepth * s_Width;
+
+	// Far plane distances are pushed out by two ulps so rounding in the slab test can't cull a box
+	// the ray grazes (Ize 2013)
+	static constexpr float s_FarScale = 1.0f + 2.0f * std::numeric_limits<float>::epsilon();
+
+	static SIMDLevel DetectSIMDLevel()
+	{
+#if WIDE_BVH_X86
+	#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return SIMDLevel::SSE;
+
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+
+		__cpuidex(info, 7, 0);
+		bool avx2 = (info[1] & (1 << 5)) != 0;
+
+		// The OS has to save the upper halves of the ymm registers too
+		bool osSupport = osxsave && (_xgetbv(0) & 6) == 6;
+		return avx && avx2 && osSupport ? SIMDLevel::AVX2 : SIMDLevel::SSE;
+	#else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") ? SIMDLevel::AVX2 : SIMDLevel::SSE;
+	#endif
+#else
+		return SIMDLevel::Scalar;
+#endif
+	}
+
+	SIMDLevel GetSupportedSIMDLevel()
+	{
+		static const SIMDLevel level = DetectSIMDLevel();
+		return level;
+	}
+
+	const char* GetSIMDLevelName(SIMDLevel level)
+	{
+		switch (level)
+		{
+			case SIMDLevel::Scalar: return "scalar";
+			case SIMDLevel::SSE:	return "sse";
+			case SIMDLevel::AVX2:	return "avx2";
+		}
+
+		return "unknown";
+	}
+
+	static uint32_t CountTrailingZeros(uint32_t mask)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return (uint32_t)index;
+#else
+		return (uint32_t)__builtin_ctz(mask);
+#endif
+	}
+
+	// Slab test setup shared by every node a ray visits. Near and Far pick the Bounds row of each
+	// axis that is entered and left first for the ray's octant, so no min/max is needed per child.
+	struct NodeRay
+	{
+		glm::vec3 Origin;
+		glm::vec3 InverseDirection;
+		uint32_t Near[3];
+		uint32_t Far[3];
+		float TMin;
+	};
+
+	static NodeRay CreateNodeRay(const glm::vec3& origin, const glm::vec3& direction, float tMin)
+	{
+		NodeRay ray;
+		ray.Origin = origin;
+		ray.TMin = tMin;
+
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			// Keep the inverse finite so an empty child slot never produces 0 * inf
+			float component = glm::abs(direction[axis]) > 1e-20f ? direction[axis] : (direction[axis] < 0.0f ? -1e-20f : 1e-20f);
+			ray.InverseDirection[axis] = 1.0f / component;
+
+			uint32_t negative = ray.InverseDirection[axis] < 0.0f ? 1 : 0;
+			ray.Near[axis] = axis * 2 + negative;
+			ray.Far[axis] = axis * 2 + 1 - negative;
+		}
+
+		return ray;
+	}
+
+	// Each returns a bit per child the ray enters before tMax and writes the entry distances
+
+	static uint32_t IntersectChildrenScalar(const WideBVHNode& node, const NodeRay& ray, float tMax, float* distances)
+	{
+		uint32_t mask = 0;
+		for (uint32_t i = 0; i < s_Width; i++)
+		{
+			float entry = ray.TMin;
+			float exit = tMax;
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				entry = glm::max(entry, (node.Bounds[ray.Near[axis]][i] - ray.Origin[axis]) * ray.InverseDirection[axis]);
+				exit = glm::min(exit, (node.Bounds[ray.Far[axis]][i] - ray.Origin[axis]) * ray.InverseDirection[axis] * s_FarScale);
+			}
+
+			distances[i] = entry;
+			mask |= (entry <= exit ? 1u : 0u) << i;
+		}
+
+		return mask;
+	}
+
+#if WIDE_BVH_X86
+	static uint32_t IntersectChildrenSSE(const WideBVHNode& node, const NodeRay& ray, float tMax, float* distances)
+	{
+		uint32_t mask = 0;
+		for (uint32_t half = 0; half < s_Width; half += 4)
+		{
+			__m128 entry = _mm_set1_ps(ray.TMin);
+			__m128 exit = _mm_set1_ps(tMax);
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				__m128 origin = _mm_set1_ps(ray.Origin[axis]);
+				__m128 inverseDirection = _mm_set1_ps(ray.InverseDirection[axis]);
+				__m128 tNear = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.Bounds[ray.Near[axis]] + half), origin), inverseDirection);
+				__m128 tFar = _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.Bounds[ray.Far[axis]] + half), origin), inverseDirection), _mm_set1_ps(s_FarScale));
+				entry = _mm_max_ps(entry, tNear);
+				exit = _mm_min_ps(exit, tFar);
+			}
+
+			_mm_storeu_ps(distances + half, entry);
+			mask |= (uint32_t)_mm_movemask_ps(_mm_cmple_ps(entry, exit)) << half;
+		}
+
+		return mask;
+	}
+
+	TARGET_AVX2 static uint32_t IntersectChildrenAVX2(const WideBVHNode& node, const NodeRay& ray, float tMax, float* distances)
+	{
+		__m256 entry = _mm256_set1_ps(ray.TMin);
+		__m256 exit = _mm256_set1_ps(tMax);
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			__m256 origin = _mm256_set1_ps(ray.Origin[axis]);
+			__m256 inverseDirection = _mm256_set1_ps(ray.InverseDirection[axis]);
+			__m256 tNear = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.Bounds[ray.Near[axis]]), origin), inverseDirection);
+			__m256 tFar = _mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.Bounds[ray.Far[axis]]), origin), inverseDirection), _mm256_set1_ps(s_FarScale));
+			entry = _mm256_max_ps(entry, tNear);
+			exit = _mm256_min_ps(exit, tFar);
+		}
+
+		_mm256_storeu_ps(distances, entry);
+		return (uint32_t)_mm256_movemask_ps(_mm256_cmp_ps(entry, exit, _CMP_LE_OQ));
+	}
+#endif
+
+	static uint32_t IntersectChildren(SIMDLevel level, const WideBVHNode& node, const NodeRay& ray, float tMax, float* distances)
+	{
+#if WIDE_BVH_X86
+		if (level == SIMDLevel::AVX2)
+			return IntersectChildrenAVX2(node, ray, tMax, distances);
+		if (level == SIMDLevel::SSE)
+			return IntersectChildrenSSE(node, ray, tMax, distances);
+#endif
+		return IntersectChildrenScalar(node, ray, tMax, distances);
+	}
+
+	static float SurfaceArea(const BVHNode& node)
+	{
+		glm::vec3 extent = node.BoundsMax - node.BoundsMin;
+		return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+	}
+
+	void WideBVH::Build(const BVH& bvh, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t vertexOffset, uint32_t indexOffset)
+	{
+		m_Nodes.clear();
+		m_Triangles.clear();
+
+		if (bvh.IsEmpty())
+			return;
+
+		const std::vector<BVHNode>& binaryNodes = bvh.GetNodes();
+		const std::vector<uint32_t>& primitiveIndices = bvh.GetPrimitiveIndices();
+
+		m_Triangles.reserve(primitiveIndices.size());
+		m_Nodes.reserve(binaryNodes.size() / 4 + 1);
+
+		struct PendingNode
+		{
+			uint32_t WideIndex;
+			uint32_t BinaryIndex;
+		};
+
+		std::vector<PendingNode> pending = { { 0, 0 } };
+		m_Nodes.emplace_back();
+
+		while (!pending.empty())
+		{
+			PendingNode current = pending.back();
+			pending.pop_back();
+
+			const BVHNode& binaryNode = binaryNodes[current.BinaryIndex];
+
+			uint32_t children[s_Width];
+			uint32_t childCount = 0;
+			if (binaryNode.PrimitiveCount > 0)
+			{
+				// Only happens at the root of a tree that is a single leaf
+				children[childCount++] = current.BinaryIndex;
+			}
+			else
+			{
+				children[childCount++] = binaryNode.LeftFirst;
+				children[childCount++] = binaryNode.LeftFirst + 1;
+			}
+
+			// Replace the largest interior child by its two children until the node is full, which
+			// pulls the nodes most rays reach up into this one
+			while (childCount < s_Width)
+			{
+				int largest = -1;
+				float largestArea = -1.0f;
+				for (uint32_t i = 0; i < childCount; i++)
+				{
+					const BVHNode& child = binaryNodes[children[i]];
+					if (child.PrimitiveCount == 0 && SurfaceArea(child) > largestArea)
+					{
+						largest = (int)i;
+						largestArea = SurfaceArea(child);
+					}
+				}
+
+				if (largest == -1)
+					break;
+
+				uint32_t first = binaryNodes[children[largest]].LeftFirst;
+				children[largest] = first;
+				children[childCount++] = first + 1;
+			}
+
+			// Empty slots get inverted bounds so every ray misses them
+			WideBVHNode node;
+			for (uint32_t i = 0; i < s_Width; i++)
+			{
+				for (uint32_t axis = 0; axis < 3; axis++)
+				{
+					node.Bounds[axis * 2][i] = std::numeric_limits<float>::max();
+					node.Bounds[axis * 2 + 1][i] = -std::numeric_limits<float>::max();
+				}
+				node.Children[i] = 0;
+				node.PrimitiveCounts[i] = 0;
+			}
+
+			for (uint32_t i = 0; i < childCount; i++)
+			{
+				const BVHNode& child = binaryNodes[children[i]];
+				for (uint32_t axis = 0; axis < 3; axis++)
+				{
+					node.Bounds[axis * 2][i] = child.BoundsMin[axis];
+					node.Bounds[axis * 2 + 1][i] = child.BoundsMax[axis];
+				}
+
+				if (child.PrimitiveCount > 0)
+				{
+					node.Children[i] = (uint32_t)m_Triangles.size();
+					node.PrimitiveCounts[i] = child.PrimitiveCount;
+
+					for (uint32_t j = 0; j < child.PrimitiveCount; j++)
+					{
+						uint32_t primitive = primitiveIndices[child.LeftFirst + j];
+						const uint32_t* triangle = indices.data() + indexOffset + primitive * 3;
+
+						WideBVHTriangle& wideTriangle = m_Triangles.emplace_back();
+						wideTriangle.V0 = vertices[triangle[0] + vertexOffset].Position;
+						wideTriangle.V1 = vertices[triangle[1] + vertexOffset].Position;
+						wideTriangle.V2 = vertices[triangle[2] + vertexOffset].Position;
+						wideTriangle.PrimitiveIndex = primitive;
+					}
+				}
+				else
+				{
+					node.Children[i] = (uint32_t)m_Nodes.size();
+					m_Nodes.emplace_back();
+					pending.push_back({ node.Children[i], children[i] });
+				}
+			}
+
+			m_Nodes[current.WideIndex] = node;
+		}
+
+		m_Nodes.shrink_to_fit();
+	}
+
+	void WideBVH::Load(const WideBVHNode* nodes, uint32_t nodeCount, const WideBVHTriangle* triangles, uint32_t triangleCount)
+	{
+		m_Nodes.assign(nodes, nodes + nodeCount);
+		m_Triangles.assign(triangles, triangles + triangleCount);
+	}
+
+	template<bool AnyHit>
+	bool WideBVH::Traverse(const glm::vec3& origin, const glm::vec3& direction, float tMin, float& tMax, Hit& hit) const
+	{
+		if (m_Nodes.empty())
+			return false;
+
+		NodeRay nodeRay = CreateNodeRay(origin, direction, tMin);
+		WatertightRay triangleRay(origin, direction);
+
+		// Leaves go on the stack too, so they are intersected in distance order along with the nodes
+		struct StackEntry
+		{
+			uint32_t Index;
+			uint32_t PrimitiveCount;
+			float Distance;
+		};
+
+		StackEntry stack[s_StackSize];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = { 0, 0, tMin };
+
+		bool found = false;
+		while (stackSize > 0)
+		{
+			StackEntry entry = stack[--stackSize];
+			if (entry.Distance > tMax)
+				continue;
+
+			if (entry.PrimitiveCount > 0)
+			{
+				for (uint32_t i = 0; i < entry.PrimitiveCount; i++)
+				{
+					const WideBVHTriangle& triangle = m_Triangles[entry.Index + i];
+
+					float t;
+					glm::vec2 barycentrics;
+					if (IntersectTriangle(triangleRay, triangle.V0, triangle.V1, triangle.V2, tMin, tMax, t, barycentrics))
+					{
+						if (AnyHit)
+							return true;
+
+						tMax = t;
+						hit.Distance = t;
+						hit.PrimitiveIndex = triangle.PrimitiveIndex;
+						hit.Barycentrics = barycentrics;
+						found = true;
+					}
+				}
+
+				continue;
+			}
+
+			const WideBVHNode& node = m_Nodes[entry.Index];
+
+			float distances[s_Width];
+			uint32_t mask = IntersectChildren(m_SIMDLevel, node, nodeRay, tMax, distances);
+
+			// Insert the children nearest last, so the nearest one is popped first
+			uint32_t first = stackSize;
+			while (mask != 0)
+			{
+				uint32_t i = CountTrailingZeros(mask);
+				mask &= mask - 1;
+
+				StackEntry child = { node.Children[i], node.PrimitiveCounts[i], distances[i] };
+				uint32_t j = stackSize++;
+				while (j > first && stack[j - 1].Distance < child.Distance)
+				{
+					stack[j] = stack[j - 1];
+					j--;
+				}
+				stack[j] = child;
+			}
+		}
+
+		return found;
+	}
+
+	bool WideBVH::Intersect(const glm::vec3& origin, const glm::vec3& direction, float tMin, float& tMax, Hit& hit) const
+	{
+		return Traverse<false>(origin, direction, tMin, tMax, hit);
+	}
+
+	bool WideBVH::Occluded(const glm::vec3& origin, const glm::vec3& direction, float tMin, float tMax) const
+	{
+		Hit hit;
+		return Traverse<true>(origin, direction, tMin, tMax, hit);
+	}
+
+	uint32_t WideBVH::IntersectPacket(RayPacket& packet, Hit* hits, uint32_t rayMask) const
+	{
+		rayMask &= (1u << packet.Count) - 1;
+		if (m_Nodes.empty() || rayMask == 0)
+			return 0;
+
+		NodeRay nodeRays[RayPacket::Size];
+		WatertightRay triangleRays[RayPacket::Size];
+		float tMin = std::numeric_limits<float>::max();
+		for (uint32_t ray = 0; ray < packet.Count; ray++)
+		{
+			nodeRays[ray] = CreateNodeRay(packet.Origins[ray], packet.Directions[ray], packet.TMin[ray]);
+			triangleRays[ray] = WatertightRay(packet.Origins[ray], packet.Directions[ray]);
+			tMin = glm::min(tMin, packet.TMin[ray]);
+		}
+
+		// Every entry carries the rays that reached it, its distance is the nearest entry of any of them
+		struct StackEntry
+		{
+			uint32_t Index;
+			uint32_t PrimitiveCount;
+			uint32_t RayMask;
+			float Distance;
+		};
+
+		StackEntry stack[s_StackSize];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = { 0, 0, rayMask, tMin };
+
+		uint32_t hitMask = 0;
+		while (stackSize > 0)
+		{
+			StackEntry entry = stack[--stackSize];
+
+			if (entry.PrimitiveCount > 0)
+			{
+				for (uint32_t i = 0; i < entry.PrimitiveCount; i++)
+				{
+					const WideBVHTriangle& triangle = m_Triangles[entry.Index + i];
+					for (uint32_t rays = entry.RayMask; rays != 0; rays &= rays - 1)
+					{
+						uint32_t ray = CountTrailingZeros(rays);
+
+						float t;
+						glm::vec2 barycentrics;
+						if (IntersectTriangle(triangleRays[ray], triangle.V0, triangle.V1, triangle.V2, packet.TMin[ray], packet.TMax[ray], t, barycentrics))
+						{
+							packet.TMax[ray] = t;
+							hits[ray].Distance = t;
+							hits[ray].PrimitiveIndex = triangle.PrimitiveIndex;
+							hits[ray].Barycentrics = barycentrics;
+							hitMask |= 1u << ray;
+						}
+					}
+				}
+
+				continue;
+			}
+
+			const WideBVHNode& node = m_Nodes[entry.Index];
+
+			// The node is fetched once and tested against every ray that reached it
+			uint32_t childRays[s_Width] = {};
+			float childDistances[s_Width];
+			for (uint32_t i = 0; i < s_Width; i++)
+				childDistances[i] = std::numeric_limits<float>::max();
+
+			for (uint32_t rays = entry.RayMask; rays != 0; rays &= rays - 1)
+			{
+				uint32_t ray = CountTrailingZeros(rays);
+				if (entry.Distance > packet.TMax[ray])
+					continue;
+
+				float distances[s_Width];
+				for (uint32_t children = IntersectChildren(m_SIMDLevel, node, nodeRays[ray], packet.TMax[ray], distances); children != 0; children &= children - 1)
+				{
+					uint32_t i = CountTrailingZeros(children);
+					childRays[i] |= 1u << ray;
+					childDistances[i] = glm::min(childDistances[i], distances[i]);
+				}
+			}
+
+			uint32_t first = stackSize;
+			for (uint32_t i = 0; i < s_Width; i++)
+			{
+				if (childRays[i] == 0)
+					continue;
+
+				StackEntry child = { node.Children[i], node.PrimitiveCounts[i], childRays[i], childDistances[i] };
+				uint32_t j = stackSize++;
+				while (j > first && stack[j - 1].Distance < child.Distance)
+				{
+					stack[j] = stack[j - 1];
+					j--;
+				}
+				stack[j] = child;
+			}
+		}
+
+		return hitMask;
+	}
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include "CPU/BVH.h"
+#include "Graphics/Mesh.h"
+#include <vector>
+
+namespace CPU {
+
+	enum class SIMDLevel
+	{
+		Scalar = 0, SSE, AVX2
+	};
+
+	// Widest node test the CPU supports, detected once
+	SIMDLevel GetSupportedSIMDLevel();
+	const char* GetSIMDLevelName(SIMDLevel level);
+
+	// Eight children with their bounds in structure-of-arrays form so one ray is tested against all
+	// of them at once. Bounds[axis * 2] holds the minimum and Bounds[axis * 2 + 1] the maximum.
+	struct alignas(32) WideBVHNode
+	{
+		static constexpr uint32_t Width = 8;
+
+		float Bounds[6][Width];
+		uint32_t Children[Width];        // Child node for interior children, first triangle for leaves
+		uint32_t PrimitiveCounts[Width]; // 0 for interior children and empty slots
+	};
+
+	// Triangle positions copied into leaf order so a leaf is one contiguous read
+	struct WideBVHTriangle
+	{
+		glm::vec3 V0;
+		glm::vec3 V1;
+		glm::vec3 V2;
+		uint32_t PrimitiveIndex;
+	};
+
+	// Up to Size rays traced through the tree together. Coherent rays visit mostly the same nodes,
+	// so each node is fetched once for the whole packet instead of once per ray.
+	struct RayPacket
+	{
+		static constexpr uint32_t Size = 8;
+
+		glm::vec3 Origins[Size];
+		glm::vec3 Directions[Size];
+		float TMin[Size];
+		float TMax[Size];
+		uint32_t Count = 0;
+	};
+
+	// 8-wide BVH over the triangles of one submesh, collapsed from the binary SAH BVH. Node tests
+	// use AVX2 or SSE when the CPU has them and a scalar loop otherwise, triangles are tested with
+	// the watertight intersector. Hits report the PrimitiveIndex and Barycentrics of Hit, the
+	// caller fills in the instance.
+	class WideBVH
+	{
+	public:
+		void Build(const BVH& bvh, const std::vector<VkLibrary::Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t vertexOffset, uint32_t indexOffset);
+
+		// Takes over nodes and triangles built earlier, e.g. the ones stored in a CompiledScene
+		void Load(const WideBVHNode* nodes, uint32_t nodeCount, const WideBVHTriangle* triangles, uint32_t triangleCount);
+
+		// Closest hit between tMin and tMax, tMax is shrunk to the hit distance
+		bool Intersect(const glm::vec3& origin, const glm::vec3& direction, float tMin, float& tMax, Hit& hit) const;
+
+		// Any hit between tMin and tMax, for shadow rays
+		bool Occluded(const glm::vec3& origin, const glm::vec3& direction, float tMin, float tMax) const;
+
+		// Closest hits of the packet rays in rayMask, packet.TMax is shrunk like tMax above. Returns the
+		// rays that found a closer hit, hits of the other rays are left untouched.
+		uint32_t IntersectPacket(RayPacket& packet, Hit* hits, uint32_t rayMask = ~0u) const;
+
+		// Forces a narrower node test than the CPU supports, used to compare them
+		void SetSIMDLevel(SIMDLevel level) { m_SIMDLevel = (SIMDLevel)glm::min((int)level, (int)GetSupportedSIMDLevel()); }
+		SIMDLevel GetSIMDLevel() const { return m_SIMDLevel; }
+
+		bool IsEmpty() const { return m_Nodes.empty(); }
+		const std::vector<WideBVHNode>& GetNodes() const { return m_Nodes; }
+		const std::vector<WideBVHTriangle>& GetTriangles() const { return m_Triangles; }
+
+	private:
+		template<bool AnyHit>
+		bool Traverse(const glm::vec3& origin, const glm::vec3& direction, float tMin, float& tMax, Hit& hit) const;
+
+	private:
+		std::vector<WideBVHNode> m_Nodes;
+		std::vector<WideBVHTriangle> m_Triangles;
+		SIMDLevel m_SIMDLevel = GetSupportedSIMDLevel();
+	};
+
+}
@@ -0,0 +1,239 @@
+#include "DistributedRender.h"
+#include "CPU/Distributed.h"
+#include "CPU/ThreadPool.h"
+#include "CPU/TiledRenderer.h"
+#include "CPU/ImageIO.h"
+#include "Graphics/Camera.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace VkLibrary;
+
+struct CoordinatorOptions
+{
+	CPU::DistributedSceneSpecification Scene;
+	std::string OutputPath = "Distributed";
+	uint32_t Width = 1280;
+	uint32_t Height = 720;
+	uint32_t Frames = 16;
+	uint32_t TileSize = 128;
+	uint32_t FramesPerUnit = 4;
+	uint32_t Seed = 0;
+	uint32_t Workers = 1;
+	uint16_t Port = 7878;
+	float Timeout = 60.0f;
+	bool NextEventEstimation = true;
+};
+
+struct WorkerOptions
+{
+	std::string Host = "localhost";
+	uint16_t Port = 7878;
+	uint32_t Threads = 0;
+};
+
+static void PrintCoordinatorUsage()
+{
+	printf("Usage: PathTracer --render-coordinator [--port p] [--workers n] [--timeout seconds] [--model path] [--output name]\n");
+	printf("                                       [--width w] [--height h] [--frames n] [--tile-size n] [--unit-frames n]\n");
+	printf("                                       [--seed n] [--scale s] [--no-nee] [--environment file.hdr] [--compiled]\n");
+}
+
+static void PrintWorkerUsage()
+{
+	printf("Usage: PathTracer --render-worker [--host address] [--port p] [--threads n]\n");
+}
+
+static bool ParseCoordinatorOptions(int argc, char** argv, CoordinatorOptions& options)
+{
+	for (int i = 2; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (strcmp(arg, "--no-nee") == 0)
+		{
+			options.NextEventEstimation = false;
+			continue;
+		}
+
+		if (strcmp(arg, "--compiled") == 0)
+		{
+			options.Scene.CompiledScene = true;
+			continue;
+		}
+
+		if (!value)
+			return false;
+
+		if (strcmp(arg, "--port") == 0)
+			options.Port = (uint16_t)atoi(value);
+		else if (strcmp(arg, "--workers") == 0)
+			options.Workers = (uint32_t)atoi(value);
+		else if (strcmp(arg, "--timeout") == 0)
+			options.Timeout = (float)atof(value);
+		else if (strcmp(arg, "--model") == 0)
+			options.Scene.ModelPath = value;
+		else if (strcmp(arg, "--output") == 0)
+			options.OutputPath = value;
+		else if (strcmp(arg, "--width") == 0)
+			options.Width = (uint32_t)atoi(value);
+		else if (strcmp(arg, "--height") == 0)
+			options.Height = (uint32_t)atoi(value);
+		else if (strcmp(arg, "--frames") == 0)
+			options.Frames = (uint32_t)atoi(value);
+		else if (strcmp(arg, "--tile-size") == 0)
+			options.TileSize = (uint32_t)atoi(value);
+		else if (strcmp(arg, "--unit-frames") == 0)
+			options.FramesPerUnit = (uint32_t)atoi(value);
+		else if (strcmp(arg, "--seed") == 0)
+			options.Seed = (uint32_t)strtoul(value, nullptr, 10);
+		else if (strcmp(arg, "--scale") == 0)
+			options.Scene.Scale = (float)atof(value);
+		else if (strcmp(arg, "--environment") == 0)
+			options.Scene.EnvironmentPath = value;
+		else
+			return false;
+
+		i++;
+	}
+
+	return options.Width > 0 && options.Height > 0 && options.Frames > 0 && options.TileSize > 0 && options.FramesPerUnit > 0 && options.Workers > 0;
+}
+
+static bool ParseWorkerOptions(int argc, char** argv, WorkerOptions& options)
+{
+	for (int i = 2; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!value)
+			return false;
+
+		if (strcmp(arg, "--host") == 0)
+			options.Host = value;
+		else if (strcmp(arg, "--port") == 0)
+			options.Port = (uint16_t)atoi(value);
+		else if (strcmp(arg, "--threads") == 0)
+			options.Threads = (uint32_t)atoi(value);
+		else
+			return false;
+
+		i++;
+	}
+
+	return true;
+}
+
+int RunRenderCoordinator(int argc, char** argv)
+{
+	CoordinatorOptions options;
+	if (!ParseCoordinatorOptions(argc, argv, options))
+	{
+		PrintCoordinatorUsage();
+		return 1;
+	}
+
+	// Same default camera as the headless renderer
+	CameraSpecification cameraSpec;
+	Camera camera(cameraSpec);
+	camera.Resize((float)options.Width, (float)options.Height);
+
+	CPU::DistributedJobSpecification job;
+	job.Scene = options.Scene;
+	job.PathTracerSpec.Width = options.Width;
+	job.PathTracerSpec.Height = options.Height;
+	job.PathTracerSpec.Seed = options.Seed;
+	job.PathTracerSpec.NextEventEstimation = options.NextEventEstimation;
+	job.Camera.ViewProjection = camera.GetViewProjection();
+	job.Camera.InverseViewProjection = camera.GetInverseViewProjection();
+	job.Camera.View = camera.GetView();
+	job.Camera.InverseView = camera.GetInverseView();
+	job.Camera.InverseProjection = camera.GetInverseProjection();
+	job.Frames = options.Frames;
+	job.TileSize = options.TileSize;
+	job.FramesPerUnit = options.FramesPerUnit;
+
+	CPU::RenderCoordinatorSpecification coordinatorSpec;
+	coordinatorSpec.Port = options.Port;
+	coordinatorSpec.WorkerTimeout = options.Timeout;
+	CPU::RenderCoordinator coordinator(coordinatorSpec);
+	if (!coordinator.Listen())
+	{
+		printf("Failed to listen on port %u\n", options.Port);
+		return 1;
+	}
+
+	printf("Waiting for %u workers on port %u\n", options.Workers, coordinator.GetPort());
+	if (!coordinator.WaitForWorkers(options.Workers, options.Timeout))
+	{
+		printf("Only %u workers connected\n", coordinator.GetConnectedWorkerCount());
+		return 1;
+	}
+
+	printf("Rendering %s at %ux%u, %u frames in units of %u frames of %ux%u tiles\n", options.Scene.ModelPath.c_str(), options.Width, options.Height,
+		options.Frames, options.FramesPerUnit, options.TileSize, options.TileSize);
+
+	std::vector<glm::vec4> accumulation;
+	auto start = std::chrono::high_resolution_clock::now();
+	if (!coordinator.Render(job, accumulation))
+	{
+		printf("Lost every worker\n");
+		return 1;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	uint64_t totalSamples = 0;
+	const std::vector<CPU::WorkerStatistics>& statistics = coordinator.GetWorkerStatistics();
+	for (size_t i = 0; i < statistics.size(); i++)
+	{
+		printf("Worker %zu: %u threads, %u units, %.2f Msamples%s\n", i, statistics[i].ThreadCount, statistics[i].UnitCount,
+			statistics[i].SampleCount * 1e-6, statistics[i].Connected ? "" : " (lost)");
+		totalSamples += statistics[i].SampleCount;
+	}
+	printf("Total: %.2f s, %.2f Msamples/s, %u units reassigned\n", seconds, totalSamples / seconds * 1e-6, coordinator.GetReassignedUnitCount());
+
+	coordinator.Shutdown();
+
+	std::vector<glm::vec4> image;
+	CPU::ResolveTile(accumulation, image);
+	bool written = CPU::WritePFM(options.OutputPath + ".pfm", image, options.Width, options.Height);
+	written &= CPU::WriteAccumulation(options.OutputPath + ".accum", accumulation, options.Width, options.Height);
+	if (!written)
+	{
+		printf("Failed to write %s\n", options.OutputPath.c_str());
+		return 1;
+	}
+
+	return 0;
+}
+
+int RunRenderWorker(int argc, char** argv)
+{
+	WorkerOptions options;
+	if (!ParseWorkerOptions(argc, argv, options))
+	{
+		PrintWorkerUsage();
+		return 1;
+	}
+
+	CPU::ThreadPool::SetDefaultThreadCount(options.Threads);
+
+	CPU::RenderWorkerSpecification spec;
+	spec.Host = options.Host;
+	spec.Port = options.Port;
+	CPU::RenderWorker worker(spec);
+	if (!worker.Connect())
+	{
+		printf("Failed to connect to %s:%u\n", options.Host.c_str(), options.Port);
+		return 1;
+	}
+
+	printf("Connected to %s:%u with %u threads\n", options.Host.c_str(), options.Port, CPU::ThreadPool::Get().GetThreadCount());
+	bool shutdown = worker.Run();
+	printf("Rendered %u units, loaded %u scenes\n", worker.GetUnitCount(), worker.GetSceneLoadCount());
+	return shutdown ? 0 : 1;
+}
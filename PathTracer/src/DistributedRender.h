@@ -0,0 +1,7 @@
+#pragma once
+
+// Entry points for `PathTracer --render-coordinator ...` and `PathTracer --render-worker ...`, render one
+// frame on the CPU backend of several processes or machines over TCP, see CPU/Distributed.h. Every
+// worker loads the scene from its own copy of the assets. Return the process exit code.
+int RunRenderCoordinator(int argc, char** argv);
+int RunRenderWorker(int argc, char** argv);
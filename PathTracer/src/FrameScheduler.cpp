@@ -0,0 +1,130 @@
+#include "FrameScheduler.h"
+#include "Core/Application.h"
+#include "Profiling/Profiler.h"
+
+static uint32_t FindQueueFamily(VkPhysicalDevice physicalDevice)
+{
+	uint32_t count = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &count, nullptr);
+	std::vector<VkQueueFamilyProperties> families(count);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &count, families.data());
+
+	// Same family the device's graphics queue comes from, ray tracing and compute both run on it
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if ((families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) && (families[i].queueFlags & VK_QUEUE_COMPUTE_BIT))
+			return i;
+	}
+
+	return 0;
+}
+
+FrameScheduler::FrameScheduler(const FrameSchedulerSpecification& specification)
+	: m_Specification(specification)
+{
+	Ref<VulkanDevice> device = Application::GetApp().GetVulkanDevice();
+	VkDevice logicalDevice = device->GetLogicalDevice();
+
+	uint32_t queueFamily = FindQueueFamily(device->GetPhysicalDevice());
+	vkGetDeviceQueue(logicalDevice, queueFamily, 0, &m_Queue);
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = queueFamily;
+	vkCreateCommandPool(logicalDevice, &poolInfo, nullptr, &m_CommandPool);
+
+	m_CommandBuffers.resize(m_Specification.FramesInFlight);
+	VkCommandBufferAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocateInfo.commandPool = m_CommandPool;
+	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocateInfo.commandBufferCount = m_Specification.FramesInFlight;
+	vkAllocateCommandBuffers(logicalDevice, &allocateInfo, m_CommandBuffers.data());
+
+	// Fences start signaled so the first use of every slot doesn't wait
+	m_Fences.resize(m_Specification.FramesInFlight);
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+	for (VkFence& fence : m_Fences)
+		vkCreateFence(logicalDevice, &fenceInfo, nullptr, &fence);
+
+	m_LastFrameStart = std::chrono::high_resolution_clock::now();
+}
+
+FrameScheduler::~FrameScheduler()
+{
+	WaitIdle();
+
+	VkDevice logicalDevice = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+	for (VkFence fence : m_Fences)
+		vkDestroyFence(logicalDevice, fence, nullptr);
+
+	vkFreeCommandBuffers(logicalDevice, m_CommandPool, (uint32_t)m_CommandBuffers.size(), m_CommandBuffers.data());
+	vkDestroyCommandPool(logicalDevice, m_CommandPool, nullptr);
+}
+
+VkCommandBuffer FrameScheduler::BeginFrame()
+{
+	using Clock = std::chrono::high_resolution_clock;
+
+	VkDevice logicalDevice = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+
+	Clock::time_point frameStart = Clock::now();
+	m_FrameTime = std::chrono::duration<float, std::milli>(frameStart - m_LastFrameStart).count();
+	m_LastFrameStart = frameStart;
+
+	{
+		PROFILE_SCOPE("FrameScheduler::WaitForFrame");
+		vkWaitForFences(logicalDevice, 1, &m_Fences[m_FrameIndex], VK_TRUE, UINT64_MAX);
+	}
+	m_CPUWaitTime = std::chrono::duration<float, std::milli>(Clock::now() - frameStart).count();
+
+	vkResetFences(logicalDevice, 1, &m_Fences[m_FrameIndex]);
+
+	VkCommandBuffer commandBuffer = m_CommandBuffers[m_FrameIndex];
+	vkResetCommandBuffer(commandBuffer, 0);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	m_FrameStarted = true;
+	return commandBuffer;
+}
+
+void FrameScheduler::EndFrame()
+{
+	if (!m_FrameStarted)
+		return;
+
+	VkCommandBuffer commandBuffer = m_CommandBuffers[m_FrameIndex];
+	vkEndCommandBuffer(commandBuffer);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	vkQueueSubmit(m_Queue, 1, &submitInfo, m_Fences[m_FrameIndex]);
+
+	m_FrameStarted = false;
+	m_FrameIndex = (m_FrameIndex + 1) % m_Specification.FramesInFlight;
+}
+
+void FrameScheduler::WaitIdle()
+{
+	VkDevice logicalDevice = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+
+	// The fence of a frame that is still being recorded was reset and won't signal until it is submitted
+	std::vector<VkFence> fences;
+	for (uint32_t i = 0; i < (uint32_t)m_Fences.size(); i++)
+	{
+		if (!m_FrameStarted || i != m_FrameIndex)
+			fences.push_back(m_Fences[i]);
+	}
+
+	if (!fences.empty())
+		vkWaitForFences(logicalDevice, (uint32_t)fences.size(), fences.data(), VK_TRUE, UINT64_MAX);
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "Core/Base.h"
+#include <vulkan/vulkan.h>
+#include <chrono>
+#include <vector>
+
+using namespace VkLibrary;
+
+struct FrameSchedulerSpecification
+{
+	uint32_t FramesInFlight = 2;
+};
+
+// Owns one command buffer and fence per frame in flight. BeginFrame only blocks when the GPU
+// is still working on the frame that last used the same slot, so the CPU can record frame N + 1
+// while frame N executes. Everything a frame records goes into a single submission.
+class FrameScheduler
+{
+public:
+	FrameScheduler(const FrameSchedulerSpecification& specification);
+	~FrameScheduler();
+
+	VkCommandBuffer BeginFrame();
+	void EndFrame();
+
+	// Waits for every frame in flight, needed before touching resources that are not per frame
+	void WaitIdle();
+
+	VkCommandBuffer GetCommandBuffer() const { return m_CommandBuffers[m_FrameIndex]; }
+	uint32_t GetFrameIndex() const { return m_FrameIndex; }
+	uint32_t GetFramesInFlight() const { return m_Specification.FramesInFlight; }
+
+	// Timings of the last BeginFrame in milliseconds
+	float GetFrameTime() const { return m_FrameTime; }
+	float GetCPUWaitTime() const { return m_CPUWaitTime; }
+
+private:
+	FrameSchedulerSpecification m_Specification;
+
+	VkQueue m_Queue = VK_NULL_HANDLE;
+	VkCommandPool m_CommandPool = VK_NULL_HANDLE;
+	std::vector<VkCommandBuffer> m_CommandBuffers;
+	std::vector<VkFence> m_Fences;
+
+	uint32_t m_FrameIndex = 0;
+	bool m_FrameStarted = false;
+
+	std::chrono::high_resolution_clock::time_point m_LastFrameStart;
+	float m_FrameTime = 0.0f;
+	float m_CPUWaitTime = 0.0f;
+};
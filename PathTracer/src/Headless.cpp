@@ -0,0 +1,277 @@
+#include "Headless.h"
+#include "CPU/PathTracer.h"
+#include "CPU/CompiledScene.h"
+#include "CPU/ThreadPool.h"
+#include "CPU/ImageIO.h"
+#include "CPU/PreethamSky.h"
+#include "Graphics/Camera.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace VkLibrary;
+
+struct HeadlessOptions
+{
+	std::string ModelPath = "assets/models/CornellBox.gltf";
+	std::string OutputPath = "Headless";
+	uint32_t Width = 1280;
+	uint32_t Height = 720;
+	uint32_t Frames = 16;
+	uint32_t Threads = 0;
+	float Scale = 0.1f;
+	uint32_t Instances = 1;
+	bool AdaptiveSampling = false;
+	bool Wavefront = false;
+	bool NextEventEstimation = true;
+	std::string EnvironmentPath;
+	std::string Sky;
+	bool EnvironmentSampling = true;
+	bool CompiledScene = false;
+	bool WriteAOVs = false;
+	CPU::SamplerType Sampler = CPU::SamplerType::Sobol;
+};
+
+static void PrintUsage()
+{
+	printf("Usage: PathTracer --headless [--model path] [--output name] [--width w] [--height h]\n");
+	printf("                             [--frames n] [--threads n] [--scale s] [--adaptive] [--wavefront] [--no-nee]\n");
+	printf("                             [--environment file.hdr] [--sky turbidity,azimuth,inclination] [--no-env-sampling]\n");
+	printf("                             [--compiled] [--aovs] [--sampler random|sobol|bluenoise] [--instances n]\n");
+}
+
+static bool ParseSampler(const char* name, CPU::SamplerType& sampler)
+{
+	for (CPU::SamplerType type : { CPU::SamplerType::Random, CPU::SamplerType::Sobol, CPU::SamplerType::BlueNoise })
+	{
+		if (strcmp(name, CPU::GetSamplerName(type)) == 0)
+		{
+			sampler = type;
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool ParseOptions(int argc, char** argv, HeadlessOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (strcmp(arg, "--headless") == 0)
+			continue;
+
+		if (strcmp(arg, "--adaptive") == 0)
+		{
+			options.AdaptiveSampling = true;
+			continue;
+		}
+
+		if (strcmp(arg, "--wavefront") == 0)
+		{
+			options.Wavefront = true;
+			continue;
+		}
+
+		if (strcmp(arg, "--no-nee") == 0)
+		{
+			options.NextEventEstimation = false;
+			continue;
+		}
+
+		if (strcmp(arg, "--no-env-sampling") == 0)
+		{
+			options.EnvironmentSampling = false;
+			continue;
+		}
+
+		if (strcmp(arg, "--compiled") == 0)
+		{
+			options.CompiledScene = true;
+			continue;
+		}
+
+		if (strcmp(arg, "--aovs") == 0)
+		{
+			options.WriteAOVs = true;
+			continue;
+		}
+
+		if (!value)
+			return false;
+
+		if (strcmp(arg, "--model") == 0)
+			options.ModelPath = value;
+		else if (strcmp(arg, "--output") == 0)
+			options.OutputPath = value;
+		else if (strcmp(arg, "--width") == 0)
+			options.Width = (uint32_t)atoi(value);
+		else if (strcmp(arg, "--height") == 0)
+			options.Height = (uint32_t)atoi(value);
+		else if (strcmp(arg, "--frames") == 0)
+			options.Frames = (uint32_t)atoi(value);
+		else if (strcmp(arg, "--threads") == 0)
+			options.Threads = (uint32_t)atoi(value);
+		else if (strcmp(arg, "--scale") == 0)
+			options.Scale = (float)atof(value);
+		else if (strcmp(arg, "--instances") == 0)
+			options.Instances = (uint32_t)atoi(value);
+		else if (strcmp(arg, "--environment") == 0)
+			options.EnvironmentPath = value;
+		else if (strcmp(arg, "--sky") == 0)
+			options.Sky = value;
+		else if (strcmp(arg, "--sampler") == 0)
+		{
+			if (!ParseSampler(value, options.Sampler))
+				return false;
+		}
+		else
+			return false;
+
+		i++;
+	}
+
+	return options.Width > 0 && options.Height > 0 && options.Frames > 0 && options.Instances > 0;
+}
+
+int RunHeadless(int argc, char** argv)
+{
+	HeadlessOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	CPU::ThreadPool::SetDefaultThreadCount(options.Threads);
+
+	glm::mat4 transform = glm::scale(glm::mat4(1.0f), glm::vec3(options.Scale));
+
+	// The compiled scene skips glTF parsing and the BVH builds once it has been written
+	Ref<CPU::Scene> scene = CreateRef<CPU::Scene>();
+	if (options.CompiledScene)
+	{
+		CPU::CompiledSceneSpecification compiledSpec;
+		compiledSpec.SourcePath = options.ModelPath;
+		CPU::CompiledScene compiledScene(compiledSpec);
+		if (!compiledScene.IsValid())
+		{
+			printf("Failed to load compiled scene for %s\n", options.ModelPath.c_str());
+			return 1;
+		}
+
+		scene->AddMesh(compiledScene);
+	}
+	else
+	{
+		Ref<MeshSource> meshSource = CreateRef<MeshSource>(options.ModelPath);
+		scene->AddMesh(meshSource);
+	}
+
+	// Copies of the model share its bottom level BVHs, see RayTracingLayer::SetInstanceCount
+	glm::vec3 boundsMin, boundsMax;
+	scene->GetMeshBounds(0, boundsMin, boundsMax);
+	for (const CPU::MeshInstance& instance : CPU::CreateInstanceGrid(0, options.Instances, boundsMin, boundsMax, transform))
+		scene->AddInstance(instance);
+	scene->RebuildTopLevel();
+
+	// Same default camera as RayTracingLayer so the output lines up with the GPU render
+	CameraSpecification cameraSpec;
+	Camera camera(cameraSpec);
+	camera.Resize((float)options.Width, (float)options.Height);
+
+	CameraBuffer cameraBuffer;
+	cameraBuffer.ViewProjection = camera.GetViewProjection();
+	cameraBuffer.InverseViewProjection = camera.GetInverseViewProjection();
+	cameraBuffer.View = camera.GetView();
+	cameraBuffer.InverseView = camera.GetInverseView();
+	cameraBuffer.InverseProjection = camera.GetInverseProjection();
+
+	CPU::PathTracerSpecification spec;
+	spec.Width = options.Width;
+	spec.Height = options.Height;
+	spec.AdaptiveSampling = options.AdaptiveSampling;
+	spec.Wavefront = options.Wavefront;
+	spec.NextEventEstimation = options.NextEventEstimation;
+	spec.EnvironmentSampling = options.EnvironmentSampling;
+	spec.WriteAOVs = options.WriteAOVs;
+	spec.Sampler = options.Sampler;
+	if (!options.EnvironmentPath.empty())
+	{
+		CPU::EnvironmentMapSpecification environmentSpec;
+		environmentSpec.Path = options.EnvironmentPath;
+		spec.Environment = CreateRef<CPU::EnvironmentMap>(environmentSpec);
+		if (!spec.Environment->IsValid())
+		{
+			printf("Failed to load environment %s\n", options.EnvironmentPath.c_str());
+			return 1;
+		}
+	}
+	else if (!options.Sky.empty())
+	{
+		CPU::PreethamSkySettings sky;
+		if (sscanf(options.Sky.c_str(), "%f,%f,%f", &sky.Turbidity, &sky.Azimuth, &sky.Inclination) != 3)
+		{
+			PrintUsage();
+			return 1;
+		}
+
+		// Generated in memory, the same sky the GPU renders into its cube map
+		CPU::EnvironmentMapSpecification environmentSpec;
+		std::vector<glm::vec3> pixels;
+		CPU::GeneratePreethamSkyEquirectangular(CPU::ComputePreethamSkyCoefficients(sky), environmentSpec.Width, environmentSpec.Height, pixels);
+		spec.Environment = CreateRef<CPU::EnvironmentMap>(pixels, environmentSpec.Width, environmentSpec.Height, environmentSpec);
+	}
+	CPU::PathTracer pathTracer(spec, scene);
+
+	printf("Rendering %s at %ux%u on %u threads\n", options.ModelPath.c_str(), options.Width, options.Height, CPU::ThreadPool::Get().GetThreadCount());
+
+	double totalSeconds = 0.0;
+	double totalSamples = 0.0;
+	for (uint32_t frameIndex = 1; frameIndex <= options.Frames; frameIndex++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		pathTracer.Render(cameraBuffer, frameIndex);
+		double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		totalSeconds += seconds;
+
+		double samples = (double)pathTracer.GetLastSampleCount();
+		totalSamples += samples;
+
+		if (options.AdaptiveSampling)
+		{
+			const CPU::AdaptiveSampler& sampler = pathTracer.GetAdaptiveSampler();
+			printf("Frame %u: %.2f ms, %.2f Msamples/s, %u/%u tiles active\n", frameIndex, seconds * 1000.0, samples / seconds * 1e-6,
+				sampler.GetActiveTileCount(), sampler.GetTileCount());
+		}
+		else
+		{
+			printf("Frame %u: %.2f ms, %.2f Msamples/s\n", frameIndex, seconds * 1000.0, samples / seconds * 1e-6);
+		}
+	}
+
+	printf("Total: %.2f s, %.2f Msamples/s\n", totalSeconds, totalSamples / totalSeconds * 1e-6);
+
+	bool written = CPU::WritePFM(options.OutputPath + ".pfm", pathTracer.GetImage(), options.Width, options.Height);
+	written &= CPU::WriteAccumulation(options.OutputPath + ".accum", pathTracer.GetAccumulationBuffer(), options.Width, options.Height);
+	written &= CPU::WriteAccumulation(options.OutputPath + ".moments", pathTracer.GetMomentsBuffer(), options.Width, options.Height);
+
+	// Denoiser inputs, see --bench-denoise
+	if (options.WriteAOVs)
+	{
+		written &= CPU::WriteAccumulation(options.OutputPath + ".albedo", pathTracer.GetAlbedoBuffer(), options.Width, options.Height);
+		written &= CPU::WriteAccumulation(options.OutputPath + ".normaldepth", pathTracer.GetNormalDepthBuffer(), options.Width, options.Height);
+	}
+	if (!written)
+	{
+		printf("Failed to write %s\n", options.OutputPath.c_str());
+		return 1;
+	}
+
+	return 0;
+}
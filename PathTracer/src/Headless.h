@@ -0,0 +1,5 @@
+#pragma once
+
+// Entry point for `PathTracer --headless ...`, renders on the CPU backend without creating
+// a window or Vulkan device. Returns the process exit code.
+int RunHeadless(int argc, char** argv);
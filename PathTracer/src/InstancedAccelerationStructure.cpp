@@ -0,0 +1,528 @@
+#include "InstancedAccelerationStructure.h"
+#include "Core/Application.h"
+#include "Profiling/Profiler.h"
+#include <cstring>
+
+static uint32_t FindQueueFamily(VkPhysicalDevice physicalDevice)
+{
+	uint32_t count = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &count, nullptr);
+	std::vector<VkQueueFamilyProperties> families(count);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &count, families.data());
+
+	// Same family FrameScheduler submits to
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if ((families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) && (families[i].queueFlags & VK_QUEUE_COMPUTE_BIT))
+			return i;
+	}
+
+	return 0;
+}
+
+static uint32_t FindMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeBits, VkMemoryPropertyFlags properties)
+{
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+	{
+		if ((typeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+			return i;
+	}
+
+	return 0;
+}
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+InstancedAccelerationStructure::InstancedAccelerationStructure(const InstancedAccelerationStructureSpecification& specification)
+	: m_Specification(specification)
+{
+	PROFILE_FUNCTION();
+
+	Ref<VulkanDevice> device = Application::GetApp().GetVulkanDevice();
+	VkDevice logicalDevice = device->GetLogicalDevice();
+
+	uint32_t queueFamily = FindQueueFamily(device->GetPhysicalDevice());
+	vkGetDeviceQueue(logicalDevice, queueFamily, 0, &m_Queue);
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = queueFamily;
+	vkCreateCommandPool(logicalDevice, &poolInfo, nullptr, &m_CommandPool);
+
+	VkPhysicalDeviceAccelerationStructurePropertiesKHR accelerationStructureProperties{};
+	accelerationStructureProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR;
+	VkPhysicalDeviceProperties2 properties{};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &accelerationStructureProperties;
+	vkGetPhysicalDeviceProperties2(device->GetPhysicalDevice(), &properties);
+	m_ScratchAlignment = glm::max(accelerationStructureProperties.minAccelerationStructureScratchOffsetAlignment, 1u);
+
+	LoadFunctions();
+	BuildGeometryData();
+	BuildBottomLevels();
+	RebuildTopLevel();
+}
+
+InstancedAccelerationStructure::~InstancedAccelerationStructure()
+{
+	VkDevice logicalDevice = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+
+	DestroyStructure(m_TopLevel);
+	DestroyBuffer(m_TopLevelScratch);
+	DestroyBuffer(m_InstanceBuffer);
+	for (Structure& structure : m_BottomLevels)
+		DestroyStructure(structure);
+
+	vkDestroyCommandPool(logicalDevice, m_CommandPool, nullptr);
+}
+
+void InstancedAccelerationStructure::LoadFunctions()
+{
+	VkDevice logicalDevice = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+
+	m_CreateAccelerationStructure = (PFN_vkCreateAccelerationStructureKHR)vkGetDeviceProcAddr(logicalDevice, "vkCreateAccelerationStructureKHR");
+	m_DestroyAccelerationStructure = (PFN_vkDestroyAccelerationStructureKHR)vkGetDeviceProcAddr(logicalDevice, "vkDestroyAccelerationStructureKHR");
+	m_GetBuildSizes = (PFN_vkGetAccelerationStructureBuildSizesKHR)vkGetDeviceProcAddr(logicalDevice, "vkGetAccelerationStructureBuildSizesKHR");
+	m_CmdBuildAccelerationStructures = (PFN_vkCmdBuildAccelerationStructuresKHR)vkGetDeviceProcAddr(logicalDevice, "vkCmdBuildAccelerationStructuresKHR");
+	m_GetAccelerationStructureAddress = (PFN_vkGetAccelerationStructureDeviceAddressKHR)vkGetDeviceProcAddr(logicalDevice, "vkGetAccelerationStructureDeviceAddressKHR");
+	m_GetBufferDeviceAddress = (PFN_vkGetBufferDeviceAddressKHR)vkGetDeviceProcAddr(logicalDevice, "vkGetBufferDeviceAddressKHR");
+}
+
+void InstancedAccelerationStructure::BuildGeometryData()
+{
+	std::vector<uint32_t> submeshData;
+	std::vector<MaterialBuffer> materials;
+
+	for (uint32_t meshIndex = 0; meshIndex < (uint32_t)m_Specification.Meshes.size(); meshIndex++)
+	{
+		const Ref<Mesh>& mesh = m_Specification.Meshes[meshIndex];
+
+		m_FirstGeometry.push_back((uint32_t)submeshData.size() / 4);
+		m_FirstMaterial.push_back((uint32_t)materials.size());
+
+		// Material indices of the submesh records are already offset, they are the defaults of the instances
+		for (const SubMesh& subMesh : mesh->GetSubMeshes())
+		{
+			submeshData.push_back(meshIndex);
+			submeshData.push_back(subMesh.VertexOffset);
+			submeshData.push_back(subMesh.IndexOffset);
+			submeshData.push_back(m_FirstMaterial.back() + subMesh.MaterialIndex);
+		}
+
+		// Textures follow the same concatenation, every map index moves past the textures of the earlier meshes
+		int textureOffset = (int)m_Textures.size();
+		for (MaterialBuffer material : mesh->GetMaterialBuffers())
+		{
+			if (material.data.AlbedoMapIndex >= 0)
+				material.data.AlbedoMapIndex += textureOffset;
+			if (material.data.MetallicRoughnessMapIndex >= 0)
+				material.data.MetallicRoughnessMapIndex += textureOffset;
+			if (material.data.NormalMapIndex >= 0)
+				material.data.NormalMapIndex += textureOffset;
+			materials.push_back(material);
+		}
+
+		const std::vector<Ref<Texture2D>>& textures = mesh->GetMeshSource()->GetTextures();
+		m_Textures.insert(m_Textures.end(), textures.begin(), textures.end());
+	}
+	m_FirstGeometry.push_back((uint32_t)submeshData.size() / 4);
+
+	// Storage buffers can't be empty
+	if (submeshData.empty())
+		submeshData.resize(4, 0);
+	if (materials.empty())
+		materials.resize(1, MaterialBuffer{});
+
+	m_SubmeshDataBuffer = CreateRef<StorageBuffer>(submeshData.data(), (uint32_t)(submeshData.size() * sizeof(uint32_t)));
+	m_MaterialBuffer = CreateRef<StorageBuffer>(materials.data(), (uint32_t)(materials.size() * sizeof(MaterialBuffer)));
+}
+
+void InstancedAccelerationStructure::BuildBottomLevels()
+{
+	PROFILE_FUNCTION();
+
+	VkDevice logicalDevice = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+	VkDeviceSize scratchAlignment = m_ScratchAlignment;
+
+	uint32_t geometryCount = m_FirstGeometry.back();
+	m_BottomLevels.resize(geometryCount);
+
+	std::vector<VkAccelerationStructureGeometryKHR> geometries(geometryCount);
+	std::vector<VkAccelerationStructureBuildGeometryInfoKHR> buildInfos(geometryCount);
+	std::vector<VkAccelerationStructureBuildRangeInfoKHR> ranges(geometryCount);
+	std::vector<VkDeviceSize> scratchOffsets(geometryCount);
+	VkDeviceSize scratchSize = 0;
+
+	for (uint32_t meshIndex = 0; meshIndex < (uint32_t)m_Specification.Meshes.size(); meshIndex++)
+	{
+		const Ref<Mesh>& mesh = m_Specification.Meshes[meshIndex];
+		VkDeviceAddress vertexAddress = GetBufferAddress(mesh->GetVertexBuffer()->GetBuffer());
+		VkDeviceAddress indexAddress = GetBufferAddress(mesh->GetIndexBuffer()->GetBuffer());
+
+		const std::vector<SubMesh>& subMeshes = mesh->GetSubMeshes();
+		for (uint32_t i = 0; i < (uint32_t)subMeshes.size(); i++)
+		{
+			const SubMesh& subMesh = subMeshes[i];
+			uint32_t geometryIndex = m_FirstGeometry[meshIndex] + i;
+
+			// Object space of the submesh, its transform goes into every top level entry that places it
+			VkAccelerationStructureGeometryKHR& geometry = geometries[geometryIndex];
+			geometry = {};
+			geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+			geometry.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
+			geometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
+			geometry.geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
+			geometry.geometry.triangles.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
+			geometry.geometry.triangles.vertexData.deviceAddress = vertexAddress + (VkDeviceAddress)subMesh.VertexOffset * sizeof(Vertex);
+			geometry.geometry.triangles.vertexStride = sizeof(Vertex);
+			geometry.geometry.triangles.maxVertex = subMesh.VertexCount > 0 ? subMesh.VertexCount - 1 : 0;
+			geometry.geometry.triangles.indexType = VK_INDEX_TYPE_UINT32;
+			geometry.geometry.triangles.indexData.deviceAddress = indexAddress + (VkDeviceAddress)subMesh.IndexOffset * sizeof(uint32_t);
+
+			VkAccelerationStructureBuildGeometryInfoKHR& buildInfo = buildInfos[geometryIndex];
+			buildInfo = {};
+			buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+			buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+			buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+			buildInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+			buildInfo.geometryCount = 1;
+			buildInfo.pGeometries = &geometry;
+
+			uint32_t triangleCount = subMesh.IndexCount / 3;
+			VkAccelerationStructureBuildSizesInfoKHR sizes{};
+			sizes.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
+			m_GetBuildSizes(logicalDevice, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &buildInfo, &triangleCount, &sizes);
+
+			Structure& structure = m_BottomLevels[geometryIndex];
+			structure.Storage = CreateBuffer(sizes.accelerationStructureSize, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			m_BottomLevelMemory += sizes.accelerationStructureSize;
+
+			VkAccelerationStructureCreateInfoKHR createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
+			createInfo.buffer = structure.Storage.Handle;
+			createInfo.size = sizes.accelerationStructureSize;
+			createInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+			m_CreateAccelerationStructure(logicalDevice, &createInfo, nullptr, &structure.Handle);
+
+			VkAccelerationStructureDeviceAddressInfoKHR addressInfo{};
+			addressInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
+			addressInfo.accelerationStructure = structure.Handle;
+			structure.Address = m_GetAccelerationStructureAddress(logicalDevice, &addressInfo);
+
+			buildInfo.dstAccelerationStructure = structure.Handle;
+			ranges[geometryIndex] = { triangleCount, 0, 0, 0 };
+
+			scratchOffsets[geometryIndex] = scratchSize;
+			scratchSize = AlignUp(scratchSize + sizes.buildScratchSize, scratchAlignment);
+		}
+	}
+
+	if (geometryCount == 0)
+		return;
+
+	// Every bottom level gets its own slice of one scratch buffer, so they all build in a single call
+	DeviceBuffer scratch = CreateBuffer(scratchSize + scratchAlignment, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	VkDeviceAddress scratchAddress = AlignUp(scratch.Address, scratchAlignment);
+
+	std::vector<const VkAccelerationStructureBuildRangeInfoKHR*> rangePointers(geometryCount);
+	for (uint32_t i = 0; i < geometryCount; i++)
+	{
+		buildInfos[i].pGeometries = &geometries[i];
+		buildInfos[i].scratchData.deviceAddress = scratchAddress + scratchOffsets[i];
+		rangePointers[i] = &ranges[i];
+	}
+
+	VkCommandBuffer commandBuffer = BeginCommands();
+	m_CmdBuildAccelerationStructures(commandBuffer, geometryCount, buildInfos.data(), rangePointers.data());
+	SubmitCommands(commandBuffer);
+
+	DestroyBuffer(scratch);
+}
+
+void InstancedAccelerationStructure::WriteInstanceData()
+{
+	// Same order as CPU::Scene::AddInstance: every instance, then every submesh of its mesh
+	std::vector<VkAccelerationStructureInstanceKHR> instances;
+	std::vector<uint32_t> instanceData;
+
+	for (const CPU::MeshInstance& meshInstance : m_Specification.Instances)
+	{
+		const Ref<Mesh>& mesh = m_Specification.Meshes[meshInstance.MeshIndex];
+		const std::vector<SubMesh>& subMeshes = mesh->GetSubMeshes();
+
+		for (uint32_t i = 0; i < (uint32_t)subMeshes.size(); i++)
+		{
+			uint32_t geometryIndex = m_FirstGeometry[meshInstance.MeshIndex] + i;
+			uint32_t materialIndex = meshInstance.MaterialOverride >= 0 ? (uint32_t)meshInstance.MaterialOverride : m_FirstMaterial[meshInstance.MeshIndex] + subMeshes[i].MaterialIndex;
+
+			// VkTransformMatrixKHR is the top 3 rows, row major
+			glm::mat4 objectToWorld = meshInstance.Transform * subMeshes[i].WorldTransform;
+
+			VkAccelerationStructureInstanceKHR instance{};
+			for (uint32_t row = 0; row < 3; row++)
+			{
+				for (uint32_t column = 0; column < 4; column++)
+					instance.transform.matrix[row][column] = objectToWorld[column][row];
+			}
+			instance.instanceCustomIndex = (uint32_t)instances.size();
+			instance.mask = 0xFF;
+			instance.instanceShaderBindingTableRecordOffset = 0;
+			instance.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
+			instance.accelerationStructureReference = m_BottomLevels[geometryIndex].Address;
+			instances.push_back(instance);
+
+			instanceData.push_back(geometryIndex);
+			instanceData.push_back(materialIndex);
+		}
+	}
+
+	bool countChanged = !m_InstanceDataBuffer || m_InstanceCount != (uint32_t)instances.size();
+	m_InstanceCount = (uint32_t)instances.size();
+	if (instanceData.empty())
+		instanceData.resize(2, 0);
+
+	// Descriptors are written every frame, so a buffer of a different size can simply replace the old one
+	if (countChanged)
+		m_InstanceDataBuffer = CreateRef<StorageBuffer>(instanceData.data(), (uint32_t)(instanceData.size() * sizeof(uint32_t)));
+	else
+		m_InstanceDataBuffer->SetData(instanceData.data(), (uint32_t)(instanceData.size() * sizeof(uint32_t)));
+
+	VkDeviceSize instanceBufferSize = glm::max<VkDeviceSize>(instances.size(), 1) * sizeof(VkAccelerationStructureInstanceKHR);
+	if (m_InstanceBuffer.Size < instanceBufferSize)
+	{
+		DestroyBuffer(m_InstanceBuffer);
+		m_InstanceBuffer = CreateBuffer(instanceBufferSize,
+			VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	}
+
+	if (!instances.empty())
+	{
+		VkDevice logicalDevice = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+
+		void* data;
+		vkMapMemory(logicalDevice, m_InstanceBuffer.Memory, 0, instances.size() * sizeof(VkAccelerationStructureInstanceKHR), 0, &data);
+		memcpy(data, instances.data(), instances.size() * sizeof(VkAccelerationStructureInstanceKHR));
+		vkUnmapMemory(logicalDevice, m_InstanceBuffer.Memory);
+	}
+}
+
+void InstancedAccelerationStructure::SetInstances(const std::vector<CPU::MeshInstance>& instances)
+{
+	m_Specification.Instances = instances;
+	UpdateTopLevel();
+}
+
+void InstancedAccelerationStructure::UpdateTopLevel()
+{
+	PROFILE_FUNCTION();
+
+	WriteInstanceData();
+
+	// An update keeps the entry count of the build it refits, adding or removing entries needs a build
+	bool canUpdate = m_TopLevel.Handle != VK_NULL_HANDLE && m_InstanceCount == m_BuiltInstanceCount;
+	BuildTopLevel(canUpdate ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR : VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR);
+}
+
+void InstancedAccelerationStructure::RebuildTopLevel()
+{
+	PROFILE_FUNCTION();
+
+	WriteInstanceData();
+	BuildTopLevel(VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR);
+}
+
+void InstancedAccelerationStructure::BuildTopLevel(VkBuildAccelerationStructureModeKHR mode)
+{
+	VkDevice logicalDevice = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+
+	VkAccelerationStructureGeometryKHR geometry{};
+	geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+	geometry.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
+	geometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
+	geometry.geometry.instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
+	geometry.geometry.instances.arrayOfPointers = VK_FALSE;
+	geometry.geometry.instances.data.deviceAddress = m_InstanceBuffer.Address;
+
+	// Updates must use the flags of the build they refit, so every build allows them
+	VkAccelerationStructureBuildGeometryInfoKHR buildInfo{};
+	buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+	buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
+	buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+	buildInfo.mode = mode;
+	buildInfo.geometryCount = 1;
+	buildInfo.pGeometries = &geometry;
+
+	if (mode == VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR)
+	{
+		VkAccelerationStructureBuildSizesInfoKHR sizes{};
+		sizes.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
+		m_GetBuildSizes(logicalDevice, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &buildInfo, &m_InstanceCount, &sizes);
+
+		// The structure is only replaced when it outgrows its storage, the caller has waited for the frames that trace it
+		if (m_TopLevel.Storage.Size < sizes.accelerationStructureSize)
+		{
+			DestroyStructure(m_TopLevel);
+			m_TopLevel.Storage = CreateBuffer(sizes.accelerationStructureSize, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+			VkAccelerationStructureCreateInfoKHR createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
+			createInfo.buffer = m_TopLevel.Storage.Handle;
+			createInfo.size = sizes.accelerationStructureSize;
+			createInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
+			m_CreateAccelerationStructure(logicalDevice, &createInfo, nullptr, &m_TopLevel.Handle);
+		}
+
+		// One scratch buffer serves the build and every update after it
+		VkDeviceSize scratchSize = glm::max<VkDeviceSize>(glm::max(sizes.buildScratchSize, sizes.updateScratchSize), 1) + m_ScratchAlignment;
+		if (m_TopLevelScratch.Size < scratchSize)
+		{
+			DestroyBuffer(m_TopLevelScratch);
+			m_TopLevelScratch = CreateBuffer(scratchSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		}
+
+		m_BuiltInstanceCount = m_InstanceCount;
+	}
+	else
+	{
+		buildInfo.srcAccelerationStructure = m_TopLevel.Handle;
+	}
+
+	buildInfo.dstAccelerationStructure = m_TopLevel.Handle;
+	buildInfo.scratchData.deviceAddress = AlignUp(m_TopLevelScratch.Address, m_ScratchAlignment);
+
+	VkAccelerationStructureBuildRangeInfoKHR range = { m_InstanceCount, 0, 0, 0 };
+	const VkAccelerationStructureBuildRangeInfoKHR* rangePointer = &range;
+
+	VkCommandBuffer commandBuffer = BeginCommands();
+	m_CmdBuildAccelerationStructures(commandBuffer, 1, &buildInfo, &rangePointer);
+	SubmitCommands(commandBuffer);
+}
+
+std::vector<VkDescriptorBufferInfo> InstancedAccelerationStructure::GetVertexBufferInfos() const
+{
+	std::vector<VkDescriptorBufferInfo> infos;
+	for (const Ref<Mesh>& mesh : m_Specification.Meshes)
+		infos.push_back({ mesh->GetVertexBuffer()->GetBuffer(), 0, VK_WHOLE_SIZE });
+	return infos;
+}
+
+std::vector<VkDescriptorBufferInfo> InstancedAccelerationStructure::GetIndexBufferInfos() const
+{
+	std::vector<VkDescriptorBufferInfo> infos;
+	for (const Ref<Mesh>& mesh : m_Specification.Meshes)
+		infos.push_back({ mesh->GetIndexBuffer()->GetBuffer(), 0, VK_WHOLE_SIZE });
+	return infos;
+}
+
+InstancedAccelerationStructure::DeviceBuffer InstancedAccelerationStructure::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+{
+	Ref<VulkanDevice> device = Application::GetApp().GetVulkanDevice();
+	VkDevice logicalDevice = device->GetLogicalDevice();
+
+	DeviceBuffer buffer;
+	buffer.Size = size;
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	vkCreateBuffer(logicalDevice, &bufferInfo, nullptr, &buffer.Handle);
+
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(logicalDevice, buffer.Handle, &requirements);
+
+	VkMemoryAllocateFlagsInfo flagsInfo{};
+	flagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+	flagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+
+	VkMemoryAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocateInfo.pNext = &flagsInfo;
+	allocateInfo.allocationSize = requirements.size;
+	allocateInfo.memoryTypeIndex = FindMemoryType(device->GetPhysicalDevice(), requirements.memoryTypeBits, properties);
+	vkAllocateMemory(logicalDevice, &allocateInfo, nullptr, &buffer.Memory);
+	vkBindBufferMemory(logicalDevice, buffer.Handle, buffer.Memory, 0);
+
+	buffer.Address = GetBufferAddress(buffer.Handle);
+	return buffer;
+}
+
+void InstancedAccelerationStructure::DestroyBuffer(DeviceBuffer& buffer)
+{
+	VkDevice logicalDevice = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+
+	if (buffer.Handle != VK_NULL_HANDLE)
+		vkDestroyBuffer(logicalDevice, buffer.Handle, nullptr);
+	if (buffer.Memory != VK_NULL_HANDLE)
+		vkFreeMemory(logicalDevice, buffer.Memory, nullptr);
+
+	buffer = {};
+}
+
+void InstancedAccelerationStructure::DestroyStructure(Structure& structure)
+{
+	if (structure.Handle != VK_NULL_HANDLE)
+		m_DestroyAccelerationStructure(Application::GetApp().GetVulkanDevice()->GetLogicalDevice(), structure.Handle, nullptr);
+
+	DestroyBuffer(structure.Storage);
+	structure = {};
+}
+
+VkDeviceAddress InstancedAccelerationStructure::GetBufferAddress(VkBuffer buffer)
+{
+	VkBufferDeviceAddressInfo addressInfo{};
+	addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+	addressInfo.buffer = buffer;
+	return m_GetBufferDeviceAddress(Application::GetApp().GetVulkanDevice()->GetLogicalDevice(), &addressInfo);
+}
+
+VkCommandBuffer InstancedAccelerationStructure::BeginCommands()
+{
+	VkCommandBufferAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocateInfo.commandPool = m_CommandPool;
+	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocateInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	vkAllocateCommandBuffers(Application::GetApp().GetVulkanDevice()->GetLogicalDevice(), &allocateInfo, &commandBuffer);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	return commandBuffer;
+}
+
+void InstancedAccelerationStructure::SubmitCommands(VkCommandBuffer commandBuffer)
+{
+	VkDevice logicalDevice = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+
+	vkEndCommandBuffer(commandBuffer);
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	VkFence fence;
+	vkCreateFence(logicalDevice, &fenceInfo, nullptr, &fence);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	vkQueueSubmit(m_Queue, 1, &submitInfo, fence);
+
+	// Builds happen at load and on edits, where the caller has already waited for the frames in flight
+	vkWaitForFences(logicalDevice, 1, &fence, VK_TRUE, UINT64_MAX);
+	vkDestroyFence(logicalDevice, fence, nullptr);
+	vkFreeCommandBuffers(logicalDevice, m_CommandPool, 1, &commandBuffer);
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include "Core/Base.h"
+#include "Graphics/Mesh.h"
+#include "Graphics/VulkanBuffers.h"
+#include "Graphics/Texture.h"
+#include "CPU/Scene.h"
+#include <vulkan/vulkan.h>
+#include <vector>
+
+using namespace VkLibrary;
+
+struct InstancedAccelerationStructureSpecification
+{
+	// Unique meshes, each builds its bottom level structures once
+	std::vector<Ref<Mesh>> Meshes;
+
+	// MeshIndex indexes Meshes, MaterialOverride the materials of all meshes in order
+	std::vector<CPU::MeshInstance> Instances;
+};
+
+// Two level acceleration structure where every submesh of every unique mesh builds one bottom
+// level structure and each instance adds a top level entry per submesh of its mesh, in the same
+// order as CPU::Scene::AddInstance so instance indices agree between the two. The custom index of
+// a top level entry selects its record in the instance data buffer (binding 40: submesh index,
+// material index), which selects the submesh record in the submesh data buffer (binding 6: vertex
+// buffer index, vertex offset, index offset, material index). Vertex buffer index i is the vertex
+// and index buffer of mesh i. Materials and textures of all meshes are concatenated, the texture
+// indices of later meshes are offset to match.
+class InstancedAccelerationStructure
+{
+public:
+	InstancedAccelerationStructure(const InstancedAccelerationStructureSpecification& specification);
+	~InstancedAccelerationStructure();
+
+	// Replaces the instances and updates only the top level, the bottom level structures are kept
+	void SetInstances(const std::vector<CPU::MeshInstance>& instances);
+
+	// Picks up edited transforms (Mesh::GetSubMeshes(), instance transforms) by refitting the top level
+	// in place. Falls back to RebuildTopLevel when the entry count changed, an update can't add entries
+	void UpdateTopLevel();
+
+	// Builds the top level from scratch, restores trace quality once updates have moved entries far
+	void RebuildTopLevel();
+
+	const VkAccelerationStructureKHR& GetAccelerationStructure() const { return m_TopLevel.Handle; }
+	const InstancedAccelerationStructureSpecification& GetSpecification() const { return m_Specification; }
+
+	Ref<StorageBuffer> GetSubmeshDataStorageBuffer() const { return m_SubmeshDataBuffer; }
+	Ref<StorageBuffer> GetInstanceDataStorageBuffer() const { return m_InstanceDataBuffer; }
+	Ref<StorageBuffer> GetMaterialBuffer() const { return m_MaterialBuffer; }
+	const std::vector<Ref<Texture2D>>& GetTextures() const { return m_Textures; }
+
+	// One vertex and index buffer per mesh, in mesh order
+	std::vector<VkDescriptorBufferInfo> GetVertexBufferInfos() const;
+	std::vector<VkDescriptorBufferInfo> GetIndexBufferInfos() const;
+
+	// Top level entries, one per submesh of every instance
+	uint32_t GetInstanceCount() const { return m_InstanceCount; }
+	uint32_t GetBottomLevelCount() const { return (uint32_t)m_BottomLevels.size(); }
+	uint64_t GetBottomLevelMemory() const { return m_BottomLevelMemory; }
+
+private:
+	struct DeviceBuffer
+	{
+		VkBuffer Handle = VK_NULL_HANDLE;
+		VkDeviceMemory Memory = VK_NULL_HANDLE;
+		VkDeviceSize Size = 0;
+		VkDeviceAddress Address = 0;
+	};
+
+	struct Structure
+	{
+		VkAccelerationStructureKHR Handle = VK_NULL_HANDLE;
+		DeviceBuffer Storage;
+		VkDeviceAddress Address = 0;
+	};
+
+	void LoadFunctions();
+	void BuildBottomLevels();
+	void BuildGeometryData();
+	void WriteInstanceData();
+	void BuildTopLevel(VkBuildAccelerationStructureModeKHR mode);
+
+	DeviceBuffer CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+	void DestroyBuffer(DeviceBuffer& buffer);
+	void DestroyStructure(Structure& structure);
+	VkDeviceAddress GetBufferAddress(VkBuffer buffer);
+
+	VkCommandBuffer BeginCommands();
+	void SubmitCommands(VkCommandBuffer commandBuffer);
+
+private:
+	InstancedAccelerationStructureSpecification m_Specification;
+
+	// Submeshes of mesh i are the bottom levels [m_FirstGeometry[i], m_FirstGeometry[i + 1])
+	std::vector<uint32_t> m_FirstGeometry;
+	std::vector<uint32_t> m_FirstMaterial;
+	std::vector<Structure> m_BottomLevels;
+	uint64_t m_BottomLevelMemory = 0;
+
+	// Kept across edits so updates reuse the storage and scratch of the last build
+	Structure m_TopLevel;
+	DeviceBuffer m_TopLevelScratch;
+	DeviceBuffer m_InstanceBuffer;
+	uint32_t m_InstanceCount = 0;
+	uint32_t m_BuiltInstanceCount = 0;
+	VkDeviceSize m_ScratchAlignment = 1;
+
+	Ref<StorageBuffer> m_SubmeshDataBuffer;
+	Ref<StorageBuffer> m_InstanceDataBuffer;
+	Ref<StorageBuffer> m_MaterialBuffer;
+	std::vector<Ref<Texture2D>> m_Textures;
+
+	VkQueue m_Queue = VK_NULL_HANDLE;
+	VkCommandPool m_CommandPool = VK_NULL_HANDLE;
+
+	PFN_vkCreateAccelerationStructureKHR m_CreateAccelerationStructure = nullptr;
+	PFN_vkDestroyAccelerationStructureKHR m_DestroyAccelerationStructure = nullptr;
+	PFN_vkGetAccelerationStructureBuildSizesKHR m_GetBuildSizes = nullptr;
+	PFN_vkCmdBuildAccelerationStructuresKHR m_CmdBuildAccelerationStructures = nullptr;
+	PFN_vkGetAccelerationStructureDeviceAddressKHR m_GetAccelerationStructureAddress = nullptr;
+	PFN_vkGetBufferDeviceAddressKHR m_GetBufferDeviceAddress = nullptr;
+};
@@ -1,15 +1,51 @@
 #include "Core/Application.h"
 #include "RayTracingLayer.h"
+#include "Headless.h"
+#include "SceneCompiler.h"
+#include "TiledRender.h"
+#include "DistributedRender.h"
+#include "Benchmark/BenchmarkCommon.h"
+#include <cstring>
+#include <cstdlib>
 
 using namespace VkLibrary;
 
-int main()
+int main(int argc, char** argv)
 {
+	if (argc > 1 && strcmp(argv[1], "--headless") == 0)
+		return RunHeadless(argc, argv);
+
+	if (argc > 1 && strcmp(argv[1], "--compile-scene") == 0)
+		return RunSceneCompiler(argc, argv);
+
+	if (argc > 1 && strcmp(argv[1], "--render-tiled") == 0)
+		return RunTiledRender(argc, argv);
+
+	if (argc > 1 && strcmp(argv[1], "--render-coordinator") == 0)
+		return RunRenderCoordinator(argc, argv);
+
+	if (argc > 1 && strcmp(argv[1], "--render-worker") == 0)
+		return RunRenderWorker(argc, argv);
+
+	if (argc > 1)
+	{
+		if (BenchmarkFunction benchmark = FindBenchmark(argv[1]))
+			return benchmark(argc, argv);
+	}
+
 	Application app = Application("VulkanLibrary Template");
 
 	Ref<RayTracingLayer> layer = CreateRef<RayTracingLayer>("RayTracingLayer");
 	app.AddLayer(layer);
 
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (strcmp(argv[i], "--frames") == 0)
+			layer->SetFrameLimit((uint32_t)atoi(argv[i + 1]));
+		else if (strcmp(argv[i], "--trace") == 0)
+			layer->SetTracePath(argv[i + 1]);
+	}
+
 	app.Run();
 
 	return 0;
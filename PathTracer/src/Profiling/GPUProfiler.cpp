@@ -0,0 +1,110 @@
+#include "Profiling/GPUProfiler.h"
+#include "Profiling/Profiler.h"
+#include "Core/Application.h"
+
+static constexpr uint32_t s_InvalidZone = 0xFFFFFFFF;
+
+GPUProfiler::GPUProfiler(const GPUProfilerSpecification& specification)
+	: m_Specification(specification)
+{
+	Ref<VulkanDevice> device = Application::GetApp().GetVulkanDevice();
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(device->GetPhysicalDevice(), &properties);
+
+	// timestampComputeAndGraphics guarantees timestamps on every graphics and compute queue
+	m_Supported = properties.limits.timestampComputeAndGraphics && properties.limits.timestampPeriod > 0.0f;
+	m_TimestampPeriod = properties.limits.timestampPeriod;
+	if (!m_Supported)
+	{
+		LOG_WARN("Device doesn't support timestamp queries, GPU profiling is disabled");
+		return;
+	}
+
+	VkQueryPoolCreateInfo queryPoolInfo{};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = m_Specification.MaxZonesPerFrame * 2;
+
+	m_Frames.resize(m_Specification.FramesInFlight);
+	for (FrameQueries& frame : m_Frames)
+		vkCreateQueryPool(device->GetLogicalDevice(), &queryPoolInfo, nullptr, &frame.QueryPool);
+
+	m_Timestamps.resize(m_Specification.MaxZonesPerFrame * 2);
+}
+
+GPUProfiler::~GPUProfiler()
+{
+	VkDevice logicalDevice = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+	for (FrameQueries& frame : m_Frames)
+		vkDestroyQueryPool(logicalDevice, frame.QueryPool, nullptr);
+}
+
+void GPUProfiler::BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+	if (!m_Supported)
+		return;
+
+	m_FrameIndex = frameIndex;
+	FrameQueries& frame = m_Frames[m_FrameIndex];
+
+	ResolveFrame(frame);
+
+	vkCmdResetQueryPool(commandBuffer, frame.QueryPool, 0, m_Specification.MaxZonesPerFrame * 2);
+	frame.Zones.clear();
+}
+
+void GPUProfiler::EndFrame()
+{
+	if (!m_Supported)
+		return;
+
+	m_Frames[m_FrameIndex].SubmitTime = Profiler::Get().GetTime();
+}
+
+uint32_t GPUProfiler::BeginZone(VkCommandBuffer commandBuffer, const char* name)
+{
+	if (!m_Supported)
+		return s_InvalidZone;
+
+	FrameQueries& frame = m_Frames[m_FrameIndex];
+	if (frame.Zones.size() == m_Specification.MaxZonesPerFrame)
+		return s_InvalidZone;
+
+	uint32_t zone = (uint32_t)frame.Zones.size();
+	frame.Zones.push_back(name);
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.QueryPool, zone * 2);
+	return zone;
+}
+
+void GPUProfiler::EndZone(VkCommandBuffer commandBuffer, uint32_t zone)
+{
+	if (zone == s_InvalidZone)
+		return;
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_Frames[m_FrameIndex].QueryPool, zone * 2 + 1);
+}
+
+void GPUProfiler::ResolveFrame(FrameQueries& frame)
+{
+	if (frame.Zones.empty())
+		return;
+
+	VkDevice logicalDevice = Application::GetApp().GetVulkanDevice()->GetLogicalDevice();
+
+	uint32_t queryCount = (uint32_t)frame.Zones.size() * 2;
+	VkResult result = vkGetQueryPoolResults(logicalDevice, frame.QueryPool, 0, queryCount, queryCount * sizeof(uint64_t),
+		m_Timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if (result != VK_SUCCESS)
+		return;
+
+	Profiler& profiler = Profiler::Get();
+	uint64_t frameStart = m_Timestamps[0];
+	for (uint32_t zone = 0; zone < (uint32_t)frame.Zones.size(); zone++)
+	{
+		double start = (double)(m_Timestamps[zone * 2] - frameStart) * m_TimestampPeriod / 1000.0;
+		double duration = (double)(m_Timestamps[zone * 2 + 1] - m_Timestamps[zone * 2]) * m_TimestampPeriod / 1000.0;
+		profiler.AddEvent(frame.Zones[zone], ProfileTrack::GPU, frame.SubmitTime + start, duration);
+	}
+}
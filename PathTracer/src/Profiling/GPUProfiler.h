@@ -0,0 +1,72 @@
+#pragma once
+#include "Core/Base.h"
+#include <vulkan/vulkan.h>
+#include <vector>
+
+using namespace VkLibrary;
+
+struct GPUProfilerSpecification
+{
+	uint32_t FramesInFlight = 2;
+	uint32_t MaxZonesPerFrame = 32;
+};
+
+// Timestamp queries around command buffer regions. Every frame in flight has its own query pool,
+// BeginFrame reads back what the slot recorded last time (its fence has signaled by then, so
+// nothing stalls) and forwards the zones to the Profiler on the GPU track.
+//
+// GPU timestamps are not in the CPU clock domain, the first timestamp of a frame is placed at the
+// CPU time the frame was submitted. Good enough to line passes up against the CPU in a trace.
+class GPUProfiler
+{
+public:
+	GPUProfiler(const GPUProfilerSpecification& specification);
+	~GPUProfiler();
+
+	// Call after FrameScheduler::BeginFrame with the command buffer and slot it returned
+	void BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+	void EndFrame();
+
+	uint32_t BeginZone(VkCommandBuffer commandBuffer, const char* name);
+	void EndZone(VkCommandBuffer commandBuffer, uint32_t zone);
+
+	bool IsSupported() const { return m_Supported; }
+
+private:
+	struct FrameQueries
+	{
+		VkQueryPool QueryPool = VK_NULL_HANDLE;
+		std::vector<const char*> Zones;
+		double SubmitTime = 0.0;
+	};
+
+	void ResolveFrame(FrameQueries& frame);
+
+private:
+	GPUProfilerSpecification m_Specification;
+	bool m_Supported = false;
+	double m_TimestampPeriod = 1.0; // Nanoseconds per tick
+
+	std::vector<FrameQueries> m_Frames;
+	uint32_t m_FrameIndex = 0;
+	std::vector<uint64_t> m_Timestamps;
+};
+
+class GPUProfileScope
+{
+public:
+	GPUProfileScope(GPUProfiler& profiler, VkCommandBuffer commandBuffer, const char* name)
+		: m_Profiler(profiler), m_CommandBuffer(commandBuffer), m_Zone(profiler.BeginZone(commandBuffer, name))
+	{
+	}
+
+	~GPUProfileScope()
+	{
+		m_Profiler.EndZone(m_CommandBuffer, m_Zone);
+	}
+
+private:
+	GPUProfiler& m_Profiler;
+	VkCommandBuffer m_CommandBuffer;
+	uint32_t m_Zone;
+};
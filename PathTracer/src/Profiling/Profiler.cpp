@@ -0,0 +1,181 @@
+#include "Profiling/Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+
+Profiler::Profiler()
+	: m_Epoch(std::chrono::steady_clock::now())
+{
+}
+
+Profiler& Profiler::Get()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+double Profiler::GetTime() const
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_Epoch).count();
+}
+
+uint32_t Profiler::GetThreadIndex()
+{
+	// Small stable ids read better in the trace viewer than hashed std::thread::ids
+	static std::atomic<uint32_t> s_NextThreadIndex = 0;
+	thread_local uint32_t threadIndex = s_NextThreadIndex++;
+	return threadIndex;
+}
+
+Profiler::Timeline& Profiler::FindTimeline(const char* name, ProfileTrack track)
+{
+	for (Timeline& timeline : m_Timelines)
+	{
+		if (timeline.Track == track && (timeline.Name == name || strcmp(timeline.Name, name) == 0))
+			return timeline;
+	}
+
+	Timeline& timeline = m_Timelines.emplace_back();
+	timeline.Name = name;
+	timeline.Track = track;
+	return timeline;
+}
+
+void Profiler::AddEvent(const char* name, ProfileTrack track, double start, double duration)
+{
+	if (!m_Enabled)
+		return;
+
+	uint32_t threadIndex = track == ProfileTrack::CPU ? GetThreadIndex() : 0;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	Timeline& timeline = FindTimeline(name, track);
+	timeline.FrameTotal += duration;
+	timeline.HitThisFrame = true;
+
+	if (m_Events.size() < MaxEvents)
+		m_Events.emplace_back();
+
+	ProfileEvent& event = m_Events[m_EventCount % MaxEvents];
+	event.Name = name;
+	event.Track = track;
+	event.ThreadIndex = threadIndex;
+	event.Start = start;
+	event.Duration = duration;
+	m_EventCount++;
+}
+
+void Profiler::EndFrame()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	// Zones that didn't run this frame keep their history, the sky pass only runs when the sky changes
+	for (Timeline& timeline : m_Timelines)
+	{
+		if (!timeline.HitThisFrame)
+			continue;
+
+		timeline.History[timeline.HistoryHead] = (float)(timeline.FrameTotal / 1000.0);
+		timeline.HistoryHead = (timeline.HistoryHead + 1) % HistorySize;
+		timeline.HistoryCount = std::min(timeline.HistoryCount + 1, HistorySize);
+
+		timeline.FrameTotal = 0.0;
+		timeline.HitThisFrame = false;
+	}
+}
+
+static ProfileStats ComputeStats(const char* name, ProfileTrack track, const float* history, uint32_t count)
+{
+	ProfileStats stats;
+	stats.Name = name;
+	stats.Track = track;
+	if (count == 0)
+		return stats;
+
+	float sum = 0.0f;
+	stats.Min = history[0];
+	stats.Max = history[0];
+	for (uint32_t i = 0; i < count; i++)
+	{
+		sum += history[i];
+		stats.Min = std::min(stats.Min, history[i]);
+		stats.Max = std::max(stats.Max, history[i]);
+	}
+
+	stats.Average = sum / count;
+	return stats;
+}
+
+std::vector<ProfileStats> Profiler::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	std::vector<ProfileStats> result;
+	result.reserve(m_Timelines.size());
+	for (const Timeline& timeline : m_Timelines)
+	{
+		if (timeline.HistoryCount > 0)
+			result.push_back(ComputeStats(timeline.Name, timeline.Track, timeline.History.data(), timeline.HistoryCount));
+	}
+
+	return result;
+}
+
+bool Profiler::GetStats(const char* name, ProfileTrack track, ProfileStats& stats) const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	for (const Timeline& timeline : m_Timelines)
+	{
+		if (timeline.Track == track && strcmp(timeline.Name, name) == 0 && timeline.HistoryCount > 0)
+		{
+			stats = ComputeStats(timeline.Name, timeline.Track, timeline.History.data(), timeline.HistoryCount);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void WriteJSONString(std::ofstream& stream, const char* string)
+{
+	stream << '"';
+	for (const char* c = string; *c; c++)
+	{
+		if (*c == '"' || *c == '\\')
+			stream << '\\';
+		stream << *c;
+	}
+	stream << '"';
+}
+
+bool Profiler::WriteChromeTrace(const std::string& filepath) const
+{
+	std::ofstream stream(filepath);
+	if (!stream)
+		return false;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	// Complete ("X") events, CPU threads are process 0 and the GPU queue is process 1
+	stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	stream << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+	stream << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"GPU\"}}";
+
+	uint64_t count = std::min<uint64_t>(m_EventCount, MaxEvents);
+	uint64_t first = m_EventCount - count;
+	for (uint64_t i = first; i < m_EventCount; i++)
+	{
+		const ProfileEvent& event = m_Events[i % MaxEvents];
+
+		stream << ",\n{\"name\":";
+		WriteJSONString(stream, event.Name);
+		stream << ",\"ph\":\"X\",\"pid\":" << (event.Track == ProfileTrack::GPU ? 1 : 0) << ",\"tid\":" << event.ThreadIndex;
+		stream << ",\"ts\":" << std::fixed << event.Start << ",\"dur\":" << event.Duration << "}";
+	}
+
+	stream << "\n]}\n";
+	return stream.good();
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class ProfileTrack
+{
+	CPU, GPU
+};
+
+struct ProfileEvent
+{
+	const char* Name = nullptr;
+	ProfileTrack Track = ProfileTrack::CPU;
+	uint32_t ThreadIndex = 0;
+
+	// Microseconds since the profiler was created
+	double Start = 0.0;
+	double Duration = 0.0;
+};
+
+// Rolling per-frame totals in milliseconds
+struct ProfileStats
+{
+	const char* Name = nullptr;
+	ProfileTrack Track = ProfileTrack::CPU;
+	float Average = 0.0f;
+	float Min = 0.0f;
+	float Max = 0.0f;
+};
+
+// Collects CPU and GPU timing events. Every zone's time is summed per frame and kept in a
+// rolling window for the stats panel, the raw events go into a ring buffer that can be written
+// out as a Chrome trace (chrome://tracing or ui.perfetto.dev).
+// Names are not copied, they have to be string literals or otherwise outlive the profiler.
+class Profiler
+{
+public:
+	static constexpr uint32_t HistorySize = 120;
+	static constexpr uint32_t MaxEvents = 1 << 16;
+
+public:
+	static Profiler& Get();
+
+	double GetTime() const;
+
+	void AddEvent(const char* name, ProfileTrack track, double start, double duration);
+
+	// Closes the current frame for the rolling stats
+	void EndFrame();
+
+	std::vector<ProfileStats> GetStats() const;
+	bool GetStats(const char* name, ProfileTrack track, ProfileStats& stats) const;
+
+	bool WriteChromeTrace(const std::string& filepath) const;
+
+	void SetEnabled(bool enabled) { m_Enabled = enabled; }
+	bool IsEnabled() const { return m_Enabled; }
+
+private:
+	Profiler();
+
+	struct Timeline
+	{
+		const char* Name = nullptr;
+		ProfileTrack Track = ProfileTrack::CPU;
+		double FrameTotal = 0.0;
+		bool HitThisFrame = false;
+
+		std::array<float, HistorySize> History = {};
+		uint32_t HistoryCount = 0;
+		uint32_t HistoryHead = 0;
+	};
+
+	Timeline& FindTimeline(const char* name, ProfileTrack track);
+	static uint32_t GetThreadIndex();
+
+private:
+	std::chrono::steady_clock::time_point m_Epoch;
+	bool m_Enabled = true;
+
+	mutable std::mutex m_Mutex;
+	std::vector<Timeline> m_Timelines;
+	std::vector<ProfileEvent> m_Events;
+	uint64_t m_EventCount = 0;
+};
+
+class ScopedTimer
+{
+public:
+	ScopedTimer(const char* name)
+		: m_Name(name), m_Start(Profiler::Get().GetTime())
+	{
+	}
+
+	~ScopedTimer()
+	{
+		Profiler& profiler = Profiler::Get();
+		profiler.AddEvent(m_Name, ProfileTrack::CPU, m_Start, profiler.GetTime() - m_Start);
+	}
+
+private:
+	const char* m_Name;
+	double m_Start;
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_SCOPE(name) ScopedTimer PROFILE_CONCAT(scopedTimer, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
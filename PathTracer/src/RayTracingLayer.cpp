@@ -6,17 +6,32 @@
 #include "Graphics/TextureImporter.h"
 #include "ImGui/imgui.h"
 #include "ImGui/imgui_impl_vulkan.h"
-#include <FastNoise/FastNoise.h>
+#include "Volume/CloudNoise.h"
+#include "Volume/BrickVolume.h"
+#include "CPU/CompiledScene.h"
+#include "SceneChangeTracker.h"
+#include "Profiling/Profiler.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Global memory barrier, the storage images stay in VK_IMAGE_LAYOUT_GENERAL for their whole lifetime
+static void InsertMemoryBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = dstAccess;
+	vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
 
 RayTracingLayer::RayTracingLayer(const std::string& name)
 	: Layer("RayTracingLayer")
 {
-	Ref<VulkanDevice> device = Application::GetApp().GetVulkanDevice();
-
 	Texture2DSpecification spec;
 	spec.path = "assets/textures/Brdf_Lut.png";
 
@@ -29,11 +44,39 @@ RayTracingLayer::RayTracingLayer(const std::string& name)
 	//m_Mesh = CreateRef<Mesh>(CreateRef<MeshSource>("assets/models/IntelSponza/NewSponza_Main_glTF_002.gltf"));
 	//m_Mesh = CreateRef<Mesh>(CreateRef<MeshSource>("assets/models/Rotation.gltf"));
 	//m_Mesh = CreateRef<Mesh>(CreateRef<MeshSource>("assets/models/Cube.gltf"));
-	m_Mesh = CreateRef<Mesh>(CreateRef<MeshSource>("assets/models/CornellBox.gltf"));
+	std::string modelPath = "assets/models/CornellBox.gltf";
+	m_Mesh = CreateRef<Mesh>(CreateRef<MeshSource>(modelPath));
 	//m_Transform = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f));
 	m_Transform = glm::scale(glm::mat4(1.0f), glm::vec3(0.1f));
 
-	m_RenderCommandBuffer = CreateRef<RenderCommandBuffer>(1);
+	// BVH for picking and other CPU ray queries. Warm launches map the prebuilt BVHs of the compiled
+	// scene instead of building them, the GPU buffers and textures still come from MeshSource
+	m_CPUScene = CreateRef<CPU::Scene>();
+	{
+		CPU::CompiledSceneSpecification compiledSpec;
+		compiledSpec.SourcePath = modelPath;
+		compiledSpec.LoadedSource = m_Mesh->GetMeshSource();
+		CPU::CompiledScene compiledScene(compiledSpec);
+		if (compiledScene.IsValid())
+			m_CPUScene->AddMesh(compiledScene);
+		else
+			m_CPUScene->AddMesh(m_Mesh->GetMeshSource());
+	}
+
+	CPU::MeshInstance instance;
+	instance.Transform = m_Transform;
+	m_Instances.push_back(instance);
+	m_CPUScene->AddInstance(instance);
+	m_CPUScene->RebuildTopLevel();
+	m_SceneChangeTracker = CreateRef<SceneChangeTracker>(m_Mesh);
+
+	FrameSchedulerSpecification frameSpec;
+	frameSpec.FramesInFlight = s_FramesInFlight;
+	m_FrameScheduler = CreateRef<FrameScheduler>(frameSpec);
+
+	GPUProfilerSpecification profilerSpec;
+	profilerSpec.FramesInFlight = s_FramesInFlight;
+	m_GPUProfiler = CreateRef<GPUProfiler>(profilerSpec);
 
 	CameraSpecification cameraSpec;
 //	cameraSpec.pitch = 0.208f;
@@ -41,40 +84,47 @@ RayTracingLayer::RayTracingLayer(const std::string& name)
 	m_Camera = CreateRef<Camera>(cameraSpec);
 //	m_Camera->SetPosition({ -12.5f, 6.7f, -1.85f });
 
-	m_CameraUniformBuffer = CreateRef<UniformBuffer>(&m_CameraBuffer, sizeof(CameraBuffer));
+	for (uint32_t i = 0; i < s_FramesInFlight; i++)
+		m_CameraUniformBuffers.push_back(CreateRef<UniformBuffer>(&m_CameraBuffer, sizeof(CameraBuffer)));
 
 	m_DescriptorPool = VkTools::CreateDescriptorPool();
 
 	m_ViewportPanel = CreateRef<ViewportPanel>();
 
+	// Compiled once up front, one stage after another, the pipelines below take them from the cache
+	m_ShaderCache.LoadAll({
+		"assets/shaders/PreethamSky.glsl",
+		"assets/shaders/PostProcessing.glsl",
+		"assets/shaders/AdaptiveSampling.glsl",
+		"assets/shaders/Denoise.glsl",
+		"assets/shaders/Reproject.glsl",
+		"assets/shaders/RayTracing/RayGen.glsl",
+		"assets/shaders/RayTracing/Miss.glsl",
+		"assets/shaders/RayTracing/ClosestHit.glsl",
+		"assets/shaders/RayTracing/WavefrontExtend.glsl",
+		"assets/shaders/RayTracing/WavefrontMiss.glsl",
+		"assets/shaders/RayTracing/WavefrontHit.glsl",
+		"assets/shaders/Wavefront.glsl"
+	});
+
 	{
 		TextureCubeSpecification spec;
 		spec.path = "assets/hdr/graveyard_pathways_4k.hdr";
 		m_RadianceMap = CreateRef<TextureCube>(spec);
+
+		// Sampling distribution of the same HDR, cached next to it
+		CPU::EnvironmentMapSpecification environmentSpec;
+		environmentSpec.Path = spec.path;
+		m_EnvironmentMap = CreateRef<CPU::EnvironmentMap>(environmentSpec);
 	}
 	
-	// Preetham Sky
+	// Preetham Sky, the cube maps are created by SelectPreethamSky at the resolution each sky needs
 	{
-		ImageSpecification skyboxSpec;
-		skyboxSpec.Width = 2048;
-		skyboxSpec.Height = 2048;
-		skyboxSpec.Format = ImageFormat::RGBA32F;
-		skyboxSpec.Usage = ImageUsage::STORAGE_IMAGE_CUBE;
-		m_PreethamSkybox = CreateRef<Image>(skyboxSpec);
-
-		m_PreethamSkyComputeShader = CreateRef<Shader>("assets/shaders/PreethamSky.glsl");
+		m_PreethamSkyComputeShader = m_ShaderCache.Load("assets/shaders/PreethamSky.glsl");
 
 		ComputePipelineSpecification spec;
 		spec.Shader = m_PreethamSkyComputeShader;
 		m_PreethamSkyComputePipeline = CreateRef<ComputePipeline>(spec);
-
-		m_PreethamSkyComputeDescriptorSet = m_PreethamSkyComputeShader->AllocateDescriptorSet(m_DescriptorPool, 0);
-
-		VkWriteDescriptorSet writeDescriptor = m_PreethamSkyComputeShader->FindWriteDescriptorSet("u_CubeMap");
-		writeDescriptor.dstSet = m_PreethamSkyComputeDescriptorSet;
-		writeDescriptor.pImageInfo = &m_PreethamSkybox->GetDescriptorImageInfo();
-
-		vkUpdateDescriptorSets(device->GetLogicalDevice(), 1, &writeDescriptor, 0, NULL);
 	}
 
 	{
@@ -87,10 +137,11 @@ RayTracingLayer::RayTracingLayer(const std::string& name)
 		m_PostProcessingImage = CreateRef<Image>(imageSpec);
 
 		ComputePipelineSpecification pipelineSpec;
-		pipelineSpec.Shader = CreateRef<Shader>("assets/shaders/PostProcessing.glsl");;
+		pipelineSpec.Shader = m_ShaderCache.Load("assets/shaders/PostProcessing.glsl");
 		m_PostProcessingComputePipeline = CreateRef<ComputePipeline>(pipelineSpec);
 
-		m_PostProcessingComputeDescriptorSet = pipelineSpec.Shader->AllocateDescriptorSet(m_DescriptorPool, 0);
+		for (uint32_t i = 0; i < s_FramesInFlight; i++)
+			m_PostProcessingComputeDescriptorSets.push_back(pipelineSpec.Shader->AllocateDescriptorSet(m_DescriptorPool, 0));
 	}
 
 	CreateAccelerationStructure();
@@ -115,78 +166,104 @@ RayTracingLayer::RayTracingLayer(const std::string& name)
 		m_AccumulationImage = CreateRef<Image>(spec);
 	}
 
-	CreateRayTracingPipeline();
+	// Adaptive sampling
+	{
+		ImageSpecification spec;
+		spec.DebugName = "RT-MomentsImage";
+		spec.Format = ImageFormat::RGBA32F;
+		spec.Usage = ImageUsage::STORAGE_IMAGE_2D;
+		spec.Width = 1;
+		spec.Height = 1;
+		m_MomentsImage = CreateRef<Image>(spec);
 
-	m_SceneBuffer.FrameIndex = 1;
-	m_SceneBuffer.AbsorptionFactor = glm::vec3(1.0);
-	m_SceneUniformBuffer = CreateRef<UniformBuffer>(&m_SceneBuffer, sizeof(SceneBuffer));
+		ComputePipelineSpecification pipelineSpec;
+		pipelineSpec.Shader = m_ShaderCache.Load("assets/shaders/AdaptiveSampling.glsl");
+		m_AdaptiveSamplingComputePipeline = CreateRef<ComputePipeline>(pipelineSpec);
 
-	{
-		uint32_t width = 512;
-		uint32_t height = 512;
-		uint32_t depth = 512;
-		uint64_t noiseSize = width * height * depth * 4;
+		for (uint32_t i = 0; i < s_FramesInFlight; i++)
+			m_AdaptiveSamplingDescriptorSets.push_back(pipelineSpec.Shader->AllocateDescriptorSet(m_DescriptorPool, 0));
 
-		Buffer buffer;
-		buffer.Allocate(noiseSize);
+		CreateAdaptiveSamplingBuffers();
+	}
 
-		const char* filepath = "Cloud.noise";
-		if (std::filesystem::exists(filepath))
-		{
-			std::ifstream stream(filepath, std::ios::binary);
-			stream.read((char*)buffer.Data, noiseSize);
-			stream.close();
-		}
-		else
-		{
-			//FastNoise::SmartNode<> gen = FastNoise::New<FastNoise::Checkerboard>();
-			FastNoise::SmartNode<> gen = FastNoise::NewFromEncodedNodeTree("FwDsUTg+rkdhPwAAAAAAAIA/GQAbABkAGQAbABcAAAAAAAAAgD8AAIA/KVyPvxMACtcjPQsAAQAAAAAAAAABAAAAAAAAAAAAAIA/AAAAAD4BGwAXAAAAAAAAAIA/AACAPylcj78TAI/CdbwLAAEAAAAAAAAAAQAAAAAAAAAAAACAPwAAAIA+ARsAFwAAAAAAAACAPwAAgD97FK6+FQBxPapAj8K1QDMzc0ATAI/CdTwLAAEAAAAAAAAAAQAAAAAAAAAAAACAPwAAACA/AJqZGT8BGwAZAA0ABAAAAAAAAEATAArXozwHAAAAAAA/AI/C9T0AzczMPgDNzMw+");
+	// Denoiser
+	{
+		ImageSpecification spec;
+		spec.Format = ImageFormat::RGBA32F;
+		spec.Usage = ImageUsage::STORAGE_IMAGE_2D;
+		spec.Width = 1;
+		spec.Height = 1;
 
-			std::vector<float> noiseOutput(width * height * depth);
-			FastNoise::OutputMinMax o = gen->GenUniformGrid3D(noiseOutput.data(), 0, 0, 0, width, height, depth, 1.0f, 1337);
-			//FastNoise::OutputMinMax bounds = gen->GenUniformGrid2D(noiseOutput.data(), 0, 0, width, height, 0.02f, 1337);
+		spec.DebugName = "RT-AlbedoImage";
+		m_AlbedoImage = CreateRef<Image>(spec);
+		spec.DebugName = "RT-NormalDepthImage";
+		m_NormalDepthImage = CreateRef<Image>(spec);
+		spec.DebugName = "Denoise-FilterImage0";
+		m_DenoiseFilterImages[0] = CreateRef<Image>(spec);
+		spec.DebugName = "Denoise-FilterImage1";
+		m_DenoiseFilterImages[1] = CreateRef<Image>(spec);
+		spec.DebugName = "Denoise-OutputImage";
+		m_DenoisedImage = CreateRef<Image>(spec);
 
-			int index = 0;
+		ComputePipelineSpecification pipelineSpec;
+		pipelineSpec.Shader = m_ShaderCache.Load("assets/shaders/Denoise.glsl");
+		m_DenoiseComputePipeline = CreateRef<ComputePipeline>(pipelineSpec);
 
-			float input_start = o.min;
-			float input_end = o.max;
-			float output_start = 0.0;
-			float output_end = 1.0;
+		for (uint32_t i = 0; i < s_FramesInFlight; i++)
+			m_DenoiseDescriptorSets.push_back(pipelineSpec.Shader->AllocateDescriptorSet(m_DescriptorPool, 0));
+	}
 
-			uint8_t* pixelData = buffer.As<uint8_t>();
+	// Reprojection
+	{
+		ImageSpecification spec;
+		spec.Format = ImageFormat::RGBA32F;
+		spec.Usage = ImageUsage::STORAGE_IMAGE_2D;
+		spec.Width = 1;
+		spec.Height = 1;
 
-			for (int i = 0; i < width * height * depth; i++)
-			{
-				float input = noiseOutput[i];
-				float output = output_start + ((output_end - output_start) / (input_end - input_start)) * (input - input_start);
-				pixelData[i * 4 + 0] = output * 255;
-				pixelData[i * 4 + 1] = output * 255;
-				pixelData[i * 4 + 2] = output * 255;
-				pixelData[i * 4 + 3] = 255;
-			}
+		spec.DebugName = "Reproject-HistoryAccumulationImage";
+		m_HistoryAccumulationImage = CreateRef<Image>(spec);
+		spec.DebugName = "Reproject-HistoryMomentsImage";
+		m_HistoryMomentsImage = CreateRef<Image>(spec);
+		spec.DebugName = "Reproject-HistoryNormalDepthImage";
+		m_HistoryNormalDepthImage = CreateRef<Image>(spec);
 
+		ComputePipelineSpecification pipelineSpec;
+		pipelineSpec.Shader = m_ShaderCache.Load("assets/shaders/Reproject.glsl");
+		m_ReprojectComputePipeline = CreateRef<ComputePipeline>(pipelineSpec);
 
-			std::ofstream stream(filepath, std::ios::binary);
-			stream.write((const char*)buffer.Data, noiseSize);
-			stream.close();
+		for (uint32_t i = 0; i < s_FramesInFlight; i++)
+		{
+			m_ReprojectDescriptorSets.push_back(pipelineSpec.Shader->AllocateDescriptorSet(m_DescriptorPool, 0));
+			m_HistoryCameraUniformBuffers.push_back(CreateRef<UniformBuffer>(&m_HistoryCameraBuffer, sizeof(CameraBuffer)));
 		}
+	}
 
-		ImageSpecification spec;
-		spec.DebugName = "NoiseTexture";
-		spec.Format = ImageFormat::RGBA8;
-		spec.Usage = ImageUsage::TEXTURE_2D;
-		spec.Width = width;
-		spec.Height = height;
-		spec.Depth = depth;
-		m_NoiseTexture = CreateRef<Image>(spec, buffer);
+	CreateRayTracingPipeline();
+	CreateWavefrontPipelines();
+	CreateWavefrontBuffers();
+	CreateLightBuffers();
+	CreateEnvironmentBuffer();
+	CreateCompactVertexBuffers();
+	CreateMaterialLobeBuffer();
 
-		m_SceneBuffer.AbsorptionFactor.x = 0.8;
-		m_SceneBuffer.AbsorptionFactor.y = 0.025;
-	}
+	const std::vector<uint32_t>& blueNoise = CPU::GetBlueNoiseMask();
+	m_BlueNoiseBuffer = CreateRef<StorageBuffer>((void*)blueNoise.data(), (uint32_t)(blueNoise.size() * sizeof(uint32_t)));
+
+	m_SceneBuffer.FrameIndex = 1;
+	m_SceneBuffer.AbsorptionFactor = glm::vec3(1.0);
+	for (uint32_t i = 0; i < s_FramesInFlight; i++)
+		m_SceneUniformBuffers.push_back(CreateRef<UniformBuffer>(&m_SceneBuffer, sizeof(SceneBuffer)));
+
+	m_SceneBuffer.AbsorptionFactor.x = 0.8;
+	m_SceneBuffer.AbsorptionFactor.y = 0.025;
+
+	CreateCloudVolume();
 }
 
 RayTracingLayer::~RayTracingLayer()
 {
+	m_FrameScheduler->WaitIdle();
 }
 
 void RayTracingLayer::OnAttach()
@@ -198,16 +275,24 @@ void RayTracingLayer::OnDetach()
 {
 }
 
-void RayTracingLayer::RayTracingPass()
+void RayTracingLayer::RayTracingPass(VkCommandBuffer commandBuffer)
 {
+	PROFILE_FUNCTION();
+
 	Ref<VulkanDevice> device = Application::GetVulkanDevice();
 
-	VkCommandBuffer commandBuffer = m_RenderCommandBuffer->GetCommandBuffer();
+	uint32_t frameIndex = m_FrameScheduler->GetFrameIndex();
 
 	Ref<StorageBuffer> submeshDataStorageBuffer = m_AccelerationStructure->GetSubmeshDataStorageBuffer();
 
-	if (m_RayTracingDescriptorSet == VK_NULL_HANDLE)
-		m_RayTracingDescriptorSet = VkTools::AllocateDescriptorSet(m_DescriptorPool, &m_RayTracingPipeline->GetDescriptorSetLayout());
+	// One set per frame in flight, the previous frame's set may still be in use by the GPU
+	if (m_RayTracingDescriptorSets.empty())
+	{
+		for (uint32_t i = 0; i < s_FramesInFlight; i++)
+			m_RayTracingDescriptorSets.push_back(VkTools::AllocateDescriptorSet(m_DescriptorPool, &m_RayTracingPipeline->GetDescriptorSetLayout()));
+	}
+
+	VkDescriptorSet descriptorSet = m_RayTracingDescriptorSets[frameIndex];
 
 	VkWriteDescriptorSetAccelerationStructureKHR asDescriptorWrite{};
 	asDescriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR;
@@ -217,55 +302,56 @@ void RayTracingLayer::RayTracingPass()
 	VkWriteDescriptorSet accelerationStructureWrite{};
 	accelerationStructureWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 	accelerationStructureWrite.pNext = &asDescriptorWrite;
-	accelerationStructureWrite.dstSet = m_RayTracingDescriptorSet;
+	accelerationStructureWrite.dstSet = descriptorSet;
 	accelerationStructureWrite.dstBinding = 0;
 	accelerationStructureWrite.descriptorCount = 1;
 	accelerationStructureWrite.descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
 
-	const auto& asSpec = m_AccelerationStructure->GetSpecification();
+	std::vector<VkDescriptorBufferInfo> vertexBufferInfos = m_AccelerationStructure->GetVertexBufferInfos();
+	std::vector<VkDescriptorBufferInfo> indexBufferInfos = m_AccelerationStructure->GetIndexBufferInfos();
 
-	std::vector<VkDescriptorBufferInfo> vertexBufferInfos;
-	{
-		VkBuffer vb = asSpec.Mesh->GetVertexBuffer()->GetBuffer();
-		vertexBufferInfos.push_back({ vb, 0, VK_WHOLE_SIZE });
-	}
-
-	std::vector<VkDescriptorBufferInfo> indexBufferInfos;
-	{
-		VkBuffer ib = asSpec.Mesh->GetIndexBuffer()->GetBuffer();
-		indexBufferInfos.push_back({ ib, 0, VK_WHOLE_SIZE });
-	}
-
-	std::vector<VkDescriptorImageInfo> textureImageInfos;
-	{
-		const auto& textures = m_AccelerationStructure->GetTextures();
-		for (auto texture : textures)
-		{
-			textureImageInfos.push_back(texture->GetDescriptorImageInfo());
-		}
-	}
+	std::vector<VkDescriptorImageInfo> textureImageInfos = GetTextureImageInfos();
 
 	std::vector<VkWriteDescriptorSet> rayTracingWriteDescriptors = {
 		accelerationStructureWrite,
-		VkTools::WriteDescriptorSet(m_RayTracingDescriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1,  &m_Image->GetDescriptorImageInfo()),
-		VkTools::WriteDescriptorSet(m_RayTracingDescriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2,  &m_AccumulationImage->GetDescriptorImageInfo()),
-		VkTools::WriteDescriptorSet(m_RayTracingDescriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3, &m_CameraUniformBuffer->GetDescriptorBufferInfo()),
-		VkTools::WriteDescriptorSet(m_RayTracingDescriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, vertexBufferInfos.data(), (uint32_t)vertexBufferInfos.size()),
-		VkTools::WriteDescriptorSet(m_RayTracingDescriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5, indexBufferInfos.data(), (uint32_t)indexBufferInfos.size()),
-		VkTools::WriteDescriptorSet(m_RayTracingDescriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 6, &submeshDataStorageBuffer->GetDescriptorBufferInfo()),
-		VkTools::WriteDescriptorSet(m_RayTracingDescriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 7, &m_SceneUniformBuffer->GetDescriptorBufferInfo()),
-		VkTools::WriteDescriptorSet(m_RayTracingDescriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 8, &m_AccelerationStructure->GetMaterialBuffer()->GetDescriptorBufferInfo()),
-		VkTools::WriteDescriptorSet(m_RayTracingDescriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 10, &m_RadianceMap->GetDescriptorImageInfo()),
-		VkTools::WriteDescriptorSet(m_RayTracingDescriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 11, &m_NoiseTexture->GetDescriptorImageInfo())
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1,  &m_Image->GetDescriptorImageInfo()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2,  &m_AccumulationImage->GetDescriptorImageInfo()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3, &m_CameraUniformBuffers[frameIndex]->GetDescriptorBufferInfo()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, vertexBufferInfos.data(), (uint32_t)vertexBufferInfos.size()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5, indexBufferInfos.data(), (uint32_t)indexBufferInfos.size()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 6, &submeshDataStorageBuffer->GetDescriptorBufferInfo()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 7, &m_SceneUniformBuffers[frameIndex]->GetDescriptorBufferInfo()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 8, &m_AccelerationStructure->GetMaterialBuffer()->GetDescriptorBufferInfo()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 10, &m_RadianceMap->GetDescriptorImageInfo()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 11, &m_BrickAtlas->GetDescriptorImageInfo()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 12, &m_BrickIndexBuffer->GetDescriptorBufferInfo()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 13, &m_MajorantBuffer->GetDescriptorBufferInfo()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 14, &m_MomentsImage->GetDescriptorImageInfo()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 15, &m_TileSampleBuffer->GetDescriptorBufferInfo()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 29, &m_LightBuffer->GetDescriptorBufferInfo()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 30, &m_AliasTableBuffer->GetDescriptorBufferInfo()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 31, &m_LightBVHBuffer->GetDescriptorBufferInfo()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 32, &m_LightIndexBuffer->GetDescriptorBufferInfo()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 33, &m_EnvironmentBuffer->GetDescriptorBufferInfo()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 34, &m_CompactVertexBuffer->GetDescriptorBufferInfo()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 35, &m_CompactVertexInfoBuffer->GetDescriptorBufferInfo()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 36, &m_MaterialLobeBuffer->GetDescriptorBufferInfo()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 37, &m_AlbedoImage->GetDescriptorImageInfo()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 38, &m_NormalDepthImage->GetDescriptorImageInfo()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 39, &m_BlueNoiseBuffer->GetDescriptorBufferInfo()),
+		VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 40, &m_AccelerationStructure->GetInstanceDataStorageBuffer()->GetDescriptorBufferInfo())
 	};
 
 	if (textureImageInfos.size() > 0)
-		rayTracingWriteDescriptors.push_back(VkTools::WriteDescriptorSet(m_RayTracingDescriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 9, textureImageInfos.data(), (uint32_t)textureImageInfos.size()));
+		rayTracingWriteDescriptors.push_back(VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 9, textureImageInfos.data(), (uint32_t)textureImageInfos.size()));
 
-	vkUpdateDescriptorSets(device->GetLogicalDevice(), rayTracingWriteDescriptors.size(), rayTracingWriteDescriptors.data(), 0, NULL);
+	{
+		PROFILE_SCOPE("RayTracingPass::UpdateDescriptorSets");
+		vkUpdateDescriptorSets(device->GetLogicalDevice(), rayTracingWriteDescriptors.size(), rayTracingWriteDescriptors.data(), 0, NULL);
+	}
 
 	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_RayTracingPipeline->GetPipeline());
-	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_RayTracingPipeline->GetPipelineLayout(), 0, 1, &m_RayTracingDescriptorSet, 0, 0);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_RayTracingPipeline->GetPipelineLayout(), 0, 1, &descriptorSet, 0, 0);
 
 	const auto& shaderBindingTable = m_RayTracingPipeline->GetShaderBindingTable();
 
@@ -283,27 +369,31 @@ void RayTracingLayer::RayTracingPass()
 	m_SceneBuffer.FrameIndex++;
 }
 
-void RayTracingLayer::PostProcessingPass()
+void RayTracingLayer::PostProcessingPass(VkCommandBuffer commandBuffer)
 {
+	PROFILE_FUNCTION();
+
 	Ref<VulkanDevice> device = Application::GetApp().GetVulkanDevice();
 
+	VkDescriptorSet descriptorSet = m_PostProcessingComputeDescriptorSets[m_FrameScheduler->GetFrameIndex()];
+
 	{
+		PROFILE_SCOPE("PostProcessingPass::UpdateDescriptorSets");
+
 		std::array<VkWriteDescriptorSet, 2> writeDescriptors;
 		writeDescriptors[0] = m_PostProcessingComputePipeline->GetShader()->FindWriteDescriptorSet("u_OutputImage");
-		writeDescriptors[0].dstSet = m_PostProcessingComputeDescriptorSet;
+		writeDescriptors[0].dstSet = descriptorSet;
 		writeDescriptors[0].pImageInfo = &m_PostProcessingImage->GetDescriptorImageInfo();
 
 		writeDescriptors[1] = m_PostProcessingComputePipeline->GetShader()->FindWriteDescriptorSet("u_InputImage");
-		writeDescriptors[1].dstSet = m_PostProcessingComputeDescriptorSet;
-		writeDescriptors[1].pImageInfo = &m_Image->GetDescriptorImageInfo();
+		writeDescriptors[1].dstSet = descriptorSet;
+		writeDescriptors[1].pImageInfo = IsDenoising() ? &m_DenoisedImage->GetDescriptorImageInfo() : &m_Image->GetDescriptorImageInfo();
 
 		vkUpdateDescriptorSets(device->GetLogicalDevice(), writeDescriptors.size(), writeDescriptors.data(), 0, NULL);
 	}
 
-	VkCommandBuffer commandBuffer = device->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
 	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PostProcessingComputePipeline->GetPipeline());
-	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PostProcessingComputePipeline->GetPipelineLayout(), 0, 1, &m_PostProcessingComputeDescriptorSet, 0, nullptr);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PostProcessingComputePipeline->GetPipelineLayout(), 0, 1, &descriptorSet, 0, nullptr);
 	vkCmdPushConstants(commandBuffer, m_PostProcessingComputePipeline->GetPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(float), &m_Exposure);
 
 	glm::ivec3 workGroups = {
@@ -313,25 +403,606 @@ void RayTracingLayer::PostProcessingPass()
 	};
 
 	vkCmdDispatch(commandBuffer, workGroups.x, workGroups.y, workGroups.z);
+}
+
+// Swaps in the cube map of the current settings if it was generated before, returns true if PreethamSkyPass has to generate it
+bool RayTracingLayer::SelectPreethamSky()
+{
+	m_PreethamSkyUseCounter++;
+	for (uint32_t i = 0; i < (uint32_t)m_PreethamSkies.size(); i++)
+	{
+		if (m_PreethamSkies[i].Settings == m_SkySettings)
+		{
+			m_PreethamSkies[i].LastUse = m_PreethamSkyUseCounter;
+			m_PreethamSkyIndex = i;
+			m_PreethamSkybox = m_PreethamSkies[i].Skybox;
+			return false;
+		}
+	}
+
+	if (m_PreethamSkies.size() < s_MaxPreethamSkies)
+	{
+		PreethamSkyEntry entry;
+		entry.DescriptorSet = m_PreethamSkyComputeShader->AllocateDescriptorSet(m_DescriptorPool, 0);
+		m_PreethamSkies.push_back(entry);
+		m_PreethamSkyIndex = (uint32_t)m_PreethamSkies.size() - 1;
+	}
+	else
+	{
+		// The least recently used cube map may still be written by a frame in flight
+		m_FrameScheduler->WaitIdle();
+
+		m_PreethamSkyIndex = 0;
+		for (uint32_t i = 1; i < (uint32_t)m_PreethamSkies.size(); i++)
+		{
+			if (m_PreethamSkies[i].LastUse < m_PreethamSkies[m_PreethamSkyIndex].LastUse)
+				m_PreethamSkyIndex = i;
+		}
+	}
+
+	// Everything that only depends on the settings is computed here once instead of for every texel
+	PreethamSkyEntry& entry = m_PreethamSkies[m_PreethamSkyIndex];
+	entry.Settings = m_SkySettings;
+	entry.Coefficients = CPU::ComputePreethamSkyCoefficients(m_SkySettings);
+	entry.LastUse = m_PreethamSkyUseCounter;
+
+	uint32_t resolution = CPU::SelectPreethamSkyResolution(entry.Coefficients);
+	if (!entry.Skybox || entry.Skybox->GetWidth() != resolution)
+	{
+		ImageSpecification skyboxSpec;
+		skyboxSpec.DebugName = "PreethamSky";
+		skyboxSpec.Width = resolution;
+		skyboxSpec.Height = resolution;
+		skyboxSpec.Format = ImageFormat::RGBA16F;
+		skyboxSpec.Usage = ImageUsage::STORAGE_IMAGE_CUBE;
+		entry.Skybox = CreateRef<Image>(skyboxSpec);
+
+		VkWriteDescriptorSet writeDescriptor = m_PreethamSkyComputeShader->FindWriteDescriptorSet("u_CubeMap");
+		writeDescriptor.dstSet = entry.DescriptorSet;
+		writeDescriptor.pImageInfo = &entry.Skybox->GetDescriptorImageInfo();
+
+		vkUpdateDescriptorSets(Application::GetApp().GetVulkanDevice()->GetLogicalDevice(), 1, &writeDescriptor, 0, NULL);
+	}
 
-	device->FlushCommandBuffer(commandBuffer, true);
+	m_PreethamSkybox = entry.Skybox;
+	return true;
 }
 
-bool RayTracingLayer::CreateRayTracingPipeline()
+void RayTracingLayer::PreethamSkyPass(VkCommandBuffer commandBuffer)
 {
-	RayTracingPipelineSpecification spec;
+	PROFILE_FUNCTION();
 
-	spec.RayGenShader = CreateRef<Shader>("assets/shaders/RayTracing/RayGen.glsl");
-	if (!spec.RayGenShader->CompiledSuccessfully())
-		return false;
+	const PreethamSkyEntry& entry = m_PreethamSkies[m_PreethamSkyIndex];
 
-	spec.MissShader = CreateRef<Shader>("assets/shaders/RayTracing/Miss.glsl");
-	if (!spec.MissShader->CompiledSuccessfully())
-		return false;
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PreethamSkyComputePipeline->GetPipeline());
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PreethamSkyComputePipeline->GetPipelineLayout(), 0, 1, &entry.DescriptorSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, m_PreethamSkyComputePipeline->GetPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CPU::PreethamSkyCoefficients), &entry.Coefficients);
 
-	spec.ClosestHitShader = CreateRef<Shader>("assets/shaders/RayTracing/ClosestHit.glsl");
-	if (!spec.ClosestHitShader->CompiledSuccessfully())
-		return false;
+	uint32_t workGroups = (entry.Skybox->GetWidth() + 31) / 32;
+	vkCmdDispatch(commandBuffer, workGroups, workGroups, 6);
+}
+
+// Must match the push constants in AdaptiveSampling.glsl
+struct AdaptiveSamplingConstants
+{
+	uint32_t Stage;
+	uint32_t FrameIndex;
+	float ErrorThreshold;
+	uint32_t MinFrameIndex;
+	uint32_t SamplesPerFrame;
+	uint32_t MaxSamplesPerFrame;
+};
+
+void RayTracingLayer::AdaptiveSamplingPass(VkCommandBuffer commandBuffer)
+{
+	PROFILE_FUNCTION();
+
+	Ref<VulkanDevice> device = Application::GetApp().GetVulkanDevice();
+
+	VkDescriptorSet descriptorSet = m_AdaptiveSamplingDescriptorSets[m_FrameScheduler->GetFrameIndex()];
+
+	{
+		PROFILE_SCOPE("AdaptiveSamplingPass::UpdateDescriptorSets");
+
+		std::array<VkWriteDescriptorSet, 4> writeDescriptors = {
+			VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0, &m_AccumulationImage->GetDescriptorImageInfo()),
+			VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, &m_MomentsImage->GetDescriptorImageInfo()),
+			VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, &m_TileErrorBuffer->GetDescriptorBufferInfo()),
+			VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3, &m_TileSampleBuffer->GetDescriptorBufferInfo())
+		};
+
+		vkUpdateDescriptorSets(device->GetLogicalDevice(), writeDescriptors.size(), writeDescriptors.data(), 0, NULL);
+	}
+
+	AdaptiveSamplingConstants constants;
+	constants.Stage = 0;
+	constants.FrameIndex = m_SceneBuffer.FrameIndex;
+	constants.ErrorThreshold = m_AdaptiveSamplingSpec.ErrorThreshold;
+	constants.MinFrameIndex = m_AdaptiveSamplingSpec.MinFrameIndex;
+	constants.SamplesPerFrame = m_AdaptiveSamplingSpec.SamplesPerFrame;
+	constants.MaxSamplesPerFrame = m_AdaptiveSamplingSpec.MaxSamplesPerFrame;
+
+	VkPipelineLayout pipelineLayout = m_AdaptiveSamplingComputePipeline->GetPipelineLayout();
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_AdaptiveSamplingComputePipeline->GetPipeline());
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+
+	// Stage 0, one workgroup per tile estimates its error and counts the unconverged tiles
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(AdaptiveSamplingConstants), &constants);
+	vkCmdDispatch(commandBuffer, m_AdaptiveTileGrid.x, m_AdaptiveTileGrid.y, 1);
+
+	InsertMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+	// Stage 1, a single workgroup shares the frame's samples between those tiles
+	constants.Stage = 1;
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(AdaptiveSamplingConstants), &constants);
+	vkCmdDispatch(commandBuffer, 1, 1, 1);
+}
+
+// Must match the push constants and STAGE_ constants in Wavefront.glsl
+struct WavefrontConstants
+{
+	uint32_t Stage;
+	uint32_t SampleIndex;
+	uint32_t SampleCount;
+	uint32_t Bounce;
+	uint32_t MaxBounces;
+	uint32_t MaterialCount;
+	uint32_t SortByMaterial;
+};
+
+enum WavefrontComputeStage : uint32_t
+{
+	WavefrontGenerate = 0, WavefrontSortCount, WavefrontSortOffsets, WavefrontSortScatter, WavefrontShade, WavefrontContinue, WavefrontAccumulate
+};
+
+static constexpr uint32_t s_WavefrontWorkGroupSize = 256;   // WORKGROUP_SIZE in Wavefront.glsl
+static constexpr uint32_t s_WavefrontFirstQueueBinding = 16; // m_QueueCounters in WavefrontQueues.glsl
+
+// Must match the push constants in Denoise.glsl
+struct DenoiseConstants
+{
+	uint32_t Stage;
+	uint32_t Step;
+	uint32_t Source;
+	uint32_t Final;
+	float SigmaLuminance;
+	float SigmaNormal;
+	float SigmaDepth;
+};
+
+void RayTracingLayer::DenoisePass(VkCommandBuffer commandBuffer)
+{
+	PROFILE_FUNCTION();
+
+	Ref<VulkanDevice> device = Application::GetApp().GetVulkanDevice();
+
+	VkDescriptorSet descriptorSet = m_DenoiseDescriptorSets[m_FrameScheduler->GetFrameIndex()];
+
+	{
+		PROFILE_SCOPE("DenoisePass::UpdateDescriptorSets");
+
+		std::array<VkWriteDescriptorSet, 8> writeDescriptors = {
+			VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0, &m_Image->GetDescriptorImageInfo()),
+			VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, &m_AccumulationImage->GetDescriptorImageInfo()),
+			VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2, &m_MomentsImage->GetDescriptorImageInfo()),
+			VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 3, &m_AlbedoImage->GetDescriptorImageInfo()),
+			VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 4, &m_NormalDepthImage->GetDescriptorImageInfo()),
+			VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 5, &m_DenoiseFilterImages[0]->GetDescriptorImageInfo()),
+			VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 6, &m_DenoiseFilterImages[1]->GetDescriptorImageInfo()),
+			VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 7, &m_DenoisedImage->GetDescriptorImageInfo())
+		};
+
+		vkUpdateDescriptorSets(device->GetLogicalDevice(), writeDescriptors.size(), writeDescriptors.data(), 0, NULL);
+	}
+
+	DenoiseConstants constants;
+	constants.Stage = 0;
+	constants.Step = 1;
+	constants.Source = 0;
+	constants.Final = 0;
+	constants.SigmaLuminance = m_DenoiserSpec.SigmaLuminance;
+	constants.SigmaNormal = m_DenoiserSpec.SigmaNormal;
+	constants.SigmaDepth = m_DenoiserSpec.SigmaDepth;
+
+	VkPipelineLayout pipelineLayout = m_DenoiseComputePipeline->GetPipelineLayout();
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_DenoiseComputePipeline->GetPipeline());
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+
+	glm::uvec2 workGroups = {
+		(m_Image->GetWidth() + 15) / 16,
+		(m_Image->GetHeight() + 15) / 16
+	};
+
+	// Stage 0, demodulated color and variance into the first filter image
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DenoiseConstants), &constants);
+	vkCmdDispatch(commandBuffer, workGroups.x, workGroups.y, 1);
+
+	// Stage 1, one a-trous pass per iteration, the last one writes the output image
+	uint32_t iterations = glm::max(m_DenoiserSpec.Iterations, 1u);
+	constants.Stage = 1;
+	for (uint32_t iteration = 0; iteration < iterations; iteration++)
+	{
+		InsertMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+		constants.Step = 1u << iteration;
+		constants.Source = iteration % 2;
+		constants.Final = iteration + 1 == iterations ? 1 : 0;
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DenoiseConstants), &constants);
+		vkCmdDispatch(commandBuffer, workGroups.x, workGroups.y, 1);
+	}
+}
+
+// Must match the push constants in Reproject.glsl
+struct ReprojectConstants
+{
+	uint32_t Stage;
+	float DepthTolerance;
+	float NormalThreshold;
+	float MaxHistorySamples;
+};
+
+void RayTracingLayer::ReprojectPass(VkCommandBuffer commandBuffer, uint32_t stage)
+{
+	PROFILE_FUNCTION();
+
+	Ref<VulkanDevice> device = Application::GetApp().GetVulkanDevice();
+
+	uint32_t frameIndex = m_FrameScheduler->GetFrameIndex();
+	VkDescriptorSet descriptorSet = m_ReprojectDescriptorSets[frameIndex];
+
+	// Both stages of a frame use the same set
+	if (stage == 0)
+	{
+		PROFILE_SCOPE("ReprojectPass::UpdateDescriptorSets");
+
+		std::array<VkWriteDescriptorSet, 9> writeDescriptors = {
+			VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0, &m_AccumulationImage->GetDescriptorImageInfo()),
+			VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, &m_MomentsImage->GetDescriptorImageInfo()),
+			VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2, &m_NormalDepthImage->GetDescriptorImageInfo()),
+			VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 3, &m_HistoryAccumulationImage->GetDescriptorImageInfo()),
+			VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 4, &m_HistoryMomentsImage->GetDescriptorImageInfo()),
+			VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 5, &m_HistoryNormalDepthImage->GetDescriptorImageInfo()),
+			VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 6, &m_Image->GetDescriptorImageInfo()),
+			VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 7, &m_CameraUniformBuffers[frameIndex]->GetDescriptorBufferInfo()),
+			VkTools::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 8, &m_HistoryCameraUniformBuffers[frameIndex]->GetDescriptorBufferInfo())
+		};
+
+		vkUpdateDescriptorSets(device->GetLogicalDevice(), writeDescriptors.size(), writeDescriptors.data(), 0, NULL);
+	}
+
+	ReprojectConstants constants;
+	constants.Stage = stage;
+	constants.DepthTolerance = m_ReprojectionSpec.DepthTolerance;
+	constants.NormalThreshold = m_ReprojectionSpec.NormalThreshold;
+	constants.MaxHistorySamples = m_ReprojectionSpec.MaxHistorySamples;
+
+	VkPipelineLayout pipelineLayout = m_ReprojectComputePipeline->GetPipelineLayout();
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_ReprojectComputePipeline->GetPipeline());
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ReprojectConstants), &constants);
+
+	vkCmdDispatch(commandBuffer, (m_Image->GetWidth() + 15) / 16, (m_Image->GetHeight() + 15) / 16, 1);
+}
+
+void RayTracingLayer::WavefrontPass(VkCommandBuffer commandBuffer)
+{
+	PROFILE_FUNCTION();
+
+	Ref<VulkanDevice> device = Application::GetVulkanDevice();
+
+	uint32_t frameIndex = m_FrameScheduler->GetFrameIndex();
+
+	if (m_WavefrontExtendDescriptorSets.empty())
+	{
+		for (uint32_t i = 0; i < s_FramesInFlight; i++)
+		{
+			m_WavefrontExtendDescriptorSets.push_back(VkTools::AllocateDescriptorSet(m_DescriptorPool, &m_WavefrontExtendPipeline->GetDescriptorSetLayout()));
+			m_WavefrontComputeDescriptorSets.push_back(m_WavefrontComputePipeline->GetShader()->AllocateDescriptorSet(m_DescriptorPool, 0));
+		}
+	}
+
+	VkDescriptorSet extendSet = m_WavefrontExtendDescriptorSets[frameIndex];
+	VkDescriptorSet computeSet = m_WavefrontComputeDescriptorSets[frameIndex];
+
+	{
+		PROFILE_SCOPE("WavefrontPass::UpdateDescriptorSets");
+
+		VkWriteDescriptorSetAccelerationStructureKHR asDescriptorWrite{};
+		asDescriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR;
+		asDescriptorWrite.accelerationStructureCount = 1;
+		asDescriptorWrite.pAccelerationStructures = &m_AccelerationStructure->GetAccelerationStructure();
+
+		VkWriteDescriptorSet accelerationStructureWrite{};
+		accelerationStructureWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		accelerationStructureWrite.pNext = &asDescriptorWrite;
+		accelerationStructureWrite.dstSet = extendSet;
+		accelerationStructureWrite.dstBinding = 0;
+		accelerationStructureWrite.descriptorCount = 1;
+		accelerationStructureWrite.descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+
+		std::vector<VkDescriptorBufferInfo> vertexBufferInfos = m_AccelerationStructure->GetVertexBufferInfos();
+		std::vector<VkDescriptorBufferInfo> indexBufferInfos = m_AccelerationStructure->GetIndexBufferInfos();
+
+		std::vector<VkDescriptorImageInfo> textureImageInfos = GetTextureImageInfos();
+
+		// Extend traces and writes hits, shading and accumulation happen in the compute stages
+		std::vector<VkWriteDescriptorSet> writeDescriptors = {
+			accelerationStructureWrite,
+			VkTools::WriteDescriptorSet(extendSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, vertexBufferInfos.data(), (uint32_t)vertexBufferInfos.size()),
+			VkTools::WriteDescriptorSet(extendSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5, indexBufferInfos.data(), (uint32_t)indexBufferInfos.size()),
+			VkTools::WriteDescriptorSet(extendSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 6, &m_AccelerationStructure->GetSubmeshDataStorageBuffer()->GetDescriptorBufferInfo()),
+			VkTools::WriteDescriptorSet(extendSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 40, &m_AccelerationStructure->GetInstanceDataStorageBuffer()->GetDescriptorBufferInfo()),
+			VkTools::WriteDescriptorSet(extendSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 34, &m_CompactVertexBuffer->GetDescriptorBufferInfo()),
+			VkTools::WriteDescriptorSet(extendSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 35, &m_CompactVertexInfoBuffer->GetDescriptorBufferInfo()),
+			VkTools::WriteDescriptorSet(extendSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 10, &m_RadianceMap->GetDescriptorImageInfo()),
+
+			VkTools::WriteDescriptorSet(computeSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, &m_Image->GetDescriptorImageInfo()),
+			VkTools::WriteDescriptorSet(computeSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2, &m_AccumulationImage->GetDescriptorImageInfo()),
+			VkTools::WriteDescriptorSet(computeSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3, &m_CameraUniformBuffers[frameIndex]->GetDescriptorBufferInfo()),
+			VkTools::WriteDescriptorSet(computeSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 7, &m_SceneUniformBuffers[frameIndex]->GetDescriptorBufferInfo()),
+			VkTools::WriteDescriptorSet(computeSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 8, &m_AccelerationStructure->GetMaterialBuffer()->GetDescriptorBufferInfo()),
+			VkTools::WriteDescriptorSet(computeSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 36, &m_MaterialLobeBuffer->GetDescriptorBufferInfo()),
+			VkTools::WriteDescriptorSet(computeSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 14, &m_MomentsImage->GetDescriptorImageInfo())
+		};
+
+		if (textureImageInfos.size() > 0)
+			writeDescriptors.push_back(VkTools::WriteDescriptorSet(computeSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 9, textureImageInfos.data(), (uint32_t)textureImageInfos.size()));
+
+		// Both stages see every queue
+		for (uint32_t i = 0; i < m_WavefrontQueueBuffers.size(); i++)
+		{
+			const VkDescriptorBufferInfo* bufferInfo = &m_WavefrontQueueBuffers[i]->GetDescriptorBufferInfo();
+			writeDescriptors.push_back(VkTools::WriteDescriptorSet(extendSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, s_WavefrontFirstQueueBinding + i, bufferInfo));
+			writeDescriptors.push_back(VkTools::WriteDescriptorSet(computeSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, s_WavefrontFirstQueueBinding + i, bufferInfo));
+		}
+
+		vkUpdateDescriptorSets(device->GetLogicalDevice(), writeDescriptors.size(), writeDescriptors.data(), 0, NULL);
+	}
+
+	VkPipelineLayout computeLayout = m_WavefrontComputePipeline->GetPipelineLayout();
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_WavefrontComputePipeline->GetPipeline());
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computeLayout, 0, 1, &computeSet, 0, nullptr);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_WavefrontExtendPipeline->GetPipeline());
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_WavefrontExtendPipeline->GetPipelineLayout(), 0, 1, &extendSet, 0, nullptr);
+
+	const auto& shaderBindingTable = m_WavefrontExtendPipeline->GetShaderBindingTable();
+	VkStridedDeviceAddressRegionKHR empty{};
+
+	uint32_t width = m_ViewportPanel->GetSize().x;
+	uint32_t height = m_ViewportPanel->GetSize().y;
+	uint32_t pathCount = width * height;
+
+	WavefrontConstants constants{};
+	constants.SampleCount = s_SamplesPerFrame;
+	constants.MaxBounces = s_MaxBounces;
+	constants.MaterialCount = (uint32_t)m_Mesh->GetMaterialBuffers().size();
+	constants.SortByMaterial = m_WavefrontSortByMaterial ? 1 : 0;
+
+	// Queue lengths stay on the GPU, so every stage is dispatched for the full queue capacity and the
+	// invocations past the current count return straight away
+	auto dispatch = [&](uint32_t stage, uint32_t invocations)
+	{
+		constants.Stage = stage;
+		vkCmdPushConstants(commandBuffer, computeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(WavefrontConstants), &constants);
+
+		uint32_t workGroups = (invocations + s_WavefrontWorkGroupSize - 1) / s_WavefrontWorkGroupSize;
+		uint32_t workGroupsX = glm::min(workGroups, 65535u);
+		vkCmdDispatch(commandBuffer, workGroupsX, (workGroups + workGroupsX - 1) / workGroupsX, 1);
+	};
+
+	auto computeToCompute = [&]()
+	{
+		InsertMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+	};
+
+	for (uint32_t sampleIndex = 0; sampleIndex < s_SamplesPerFrame; sampleIndex++)
+	{
+		constants.SampleIndex = sampleIndex;
+
+		dispatch(WavefrontGenerate, pathCount);
+
+		for (uint32_t bounce = 0; bounce < s_MaxBounces; bounce++)
+		{
+			constants.Bounce = bounce;
+
+			InsertMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+			vkCmdTraceRaysKHR(commandBuffer,
+				&shaderBindingTable[0].StridedDeviceAddressRegion,
+				&shaderBindingTable[1].StridedDeviceAddressRegion,
+				&shaderBindingTable[2].StridedDeviceAddressRegion,
+				&empty,
+				width,
+				height,
+				1);
+
+			InsertMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+			if (m_WavefrontSortByMaterial)
+			{
+				dispatch(WavefrontSortCount, pathCount);
+				computeToCompute();
+				dispatch(WavefrontSortOffsets, 1);
+				computeToCompute();
+				dispatch(WavefrontSortScatter, pathCount);
+				computeToCompute();
+			}
+
+			dispatch(WavefrontShade, pathCount);
+			computeToCompute();
+			dispatch(WavefrontContinue, 1);
+		}
+
+		computeToCompute();
+		dispatch(WavefrontAccumulate, pathCount);
+		computeToCompute();
+	}
+
+	m_SceneBuffer.FrameIndex++;
+}
+
+void RayTracingLayer::CreateAdaptiveSamplingBuffers()
+{
+	uint32_t tileSize = m_AdaptiveSamplingSpec.TileSize;
+	m_AdaptiveTileGrid.x = (m_MomentsImage->GetWidth() + tileSize - 1) / tileSize;
+	m_AdaptiveTileGrid.y = (m_MomentsImage->GetHeight() + tileSize - 1) / tileSize;
+	uint32_t tileCount = m_AdaptiveTileGrid.x * m_AdaptiveTileGrid.y;
+
+	std::vector<float> errors(tileCount, 0.0f);
+	m_TileErrorBuffer = CreateRef<StorageBuffer>(errors.data(), (uint32_t)(errors.size() * sizeof(float)));
+
+	// Active tile counter followed by the per tile sample counts
+	std::vector<uint32_t> samples(1 + tileCount, m_AdaptiveSamplingSpec.SamplesPerFrame);
+	samples[0] = 0;
+	m_TileSampleBuffer = CreateRef<StorageBuffer>(samples.data(), (uint32_t)(samples.size() * sizeof(uint32_t)));
+}
+
+void RayTracingLayer::CreateWavefrontBuffers()
+{
+	uint64_t pathCount = (uint64_t)m_Image->GetWidth() * m_Image->GetHeight();
+	uint64_t materialCount = m_Mesh->GetMaterialBuffers().size();
+
+	// Sizes in binding order of WavefrontQueues.glsl, one path per pixel and a ray queue with two halves
+	uint64_t sizes[] = {
+		4 * sizeof(uint32_t),                // QueueCounters
+		pathCount * sizeof(glm::vec4),       // PathRadiance
+		pathCount * sizeof(glm::vec4),       // PathThroughput
+		2 * pathCount * sizeof(glm::vec4),   // RayOrigins
+		2 * pathCount * sizeof(glm::vec4),   // RayDirections
+		pathCount * sizeof(glm::vec4),       // HitPositions
+		pathCount * sizeof(glm::vec4),       // HitNormals
+		pathCount * sizeof(glm::vec4),       // HitTangents
+		pathCount * sizeof(glm::vec4),       // HitBinormals
+		pathCount * sizeof(glm::vec4),       // HitDirections
+		2 * materialCount * sizeof(uint32_t), // MaterialBins
+		pathCount * sizeof(uint32_t),        // SortedHits
+		pathCount * sizeof(glm::vec4)        // SampleSums
+	};
+
+	// The material bins have to start out empty, everything else is written before it is read
+	std::vector<uint8_t> zeros(2 * pathCount * sizeof(glm::vec4));
+
+	m_WavefrontQueueBuffers.clear();
+	m_WavefrontQueueMemory = 0;
+	for (uint64_t size : sizes)
+	{
+		m_WavefrontQueueBuffers.push_back(CreateRef<StorageBuffer>(zeros.data(), (uint32_t)size));
+		m_WavefrontQueueMemory += size;
+	}
+}
+
+void RayTracingLayer::CreateLightBuffers()
+{
+	PROFILE_FUNCTION();
+
+	m_LightSampler.Build(*m_CPUScene);
+
+	// Storage buffers can't be empty, unused ones get a single zeroed element
+	auto createBuffer = [](const void* data, size_t size, size_t elementSize)
+	{
+		std::vector<uint8_t> zeros(elementSize);
+		return size > 0 ? CreateRef<StorageBuffer>((void*)data, (uint32_t)size) : CreateRef<StorageBuffer>(zeros.data(), (uint32_t)elementSize);
+	};
+
+	const auto& lights = m_LightSampler.GetLights();
+	const auto& aliasTable = m_LightSampler.GetAliasTable();
+	const auto& nodes = m_LightSampler.GetBVHNodes();
+	const auto& indices = m_LightSampler.GetLightIndices();
+	m_LightBuffer = createBuffer(lights.data(), lights.size() * sizeof(CPU::EmissiveTriangle), sizeof(CPU::EmissiveTriangle));
+	m_AliasTableBuffer = createBuffer(aliasTable.data(), aliasTable.size() * sizeof(CPU::AliasEntry), sizeof(CPU::AliasEntry));
+	m_LightBVHBuffer = createBuffer(nodes.data(), nodes.size() * sizeof(CPU::LightBVHNode), sizeof(CPU::LightBVHNode));
+	m_LightIndexBuffer = createBuffer(indices.data(), indices.size() * sizeof(uint32_t), sizeof(uint32_t));
+
+	m_SceneBuffer.LightCount = m_LightSampler.GetLightCount();
+	m_SceneBuffer.LightTotalPower = m_LightSampler.GetTotalPower();
+}
+
+void RayTracingLayer::CreateEnvironmentBuffer()
+{
+	PROFILE_FUNCTION();
+
+	if (!m_EnvironmentMap->IsValid())
+	{
+		// Nothing to sample, the environment is only reached by BSDF sampling
+		float zero = 0.0f;
+		m_EnvironmentBuffer = CreateRef<StorageBuffer>(&zero, (uint32_t)sizeof(float));
+		m_SceneBuffer.EnvironmentSize = glm::uvec2(0);
+		m_SceneBuffer.EnvironmentIntegral = 0.0f;
+		return;
+	}
+
+	LOG_INFO("Environment map distribution {}x{} {}", m_EnvironmentMap->GetWidth(), m_EnvironmentMap->GetHeight(), m_EnvironmentMap->WasLoadedFromCache() ? "loaded from cache" : "built");
+
+	m_EnvironmentBuffer = CreateRef<StorageBuffer>((void*)m_EnvironmentMap->GetDistribution(), (uint32_t)(m_EnvironmentMap->GetDistributionSize() * sizeof(float)));
+	m_SceneBuffer.EnvironmentSize = glm::uvec2(m_EnvironmentMap->GetWidth(), m_EnvironmentMap->GetHeight());
+	m_SceneBuffer.EnvironmentIntegral = m_EnvironmentMap->GetIntegral();
+}
+
+void RayTracingLayer::CreateCompactVertexBuffers()
+{
+	PROFILE_FUNCTION();
+
+	CPU::CompactVertexHeader header = {};
+	header.Enabled = m_CompactVertices ? 1 : 0;
+
+	if (!m_CompactVertices)
+	{
+		// Bound but never read, keep them as small as storage buffers get
+		CPU::CompactVertex vertex = {};
+		m_CompactVertexBuffer = CreateRef<StorageBuffer>(&vertex, (uint32_t)sizeof(CPU::CompactVertex));
+		m_CompactVertexInfoBuffer = CreateRef<StorageBuffer>(&header, (uint32_t)sizeof(CPU::CompactVertexHeader));
+		m_CompactVertexMemory = 0;
+		return;
+	}
+
+	Ref<MeshSource> meshSource = m_Mesh->GetMeshSource();
+	std::vector<CPU::CompactVertex> vertices;
+	std::vector<CPU::CompactVertexBounds> bounds;
+	CPU::EncodeVertices(meshSource->GetVertices(), meshSource->GetSubMeshes(), vertices, bounds);
+
+	std::vector<uint8_t> info(sizeof(CPU::CompactVertexHeader) + bounds.size() * sizeof(CPU::CompactVertexBounds));
+	memcpy(info.data(), &header, sizeof(CPU::CompactVertexHeader));
+	if (!bounds.empty())
+		memcpy(info.data() + sizeof(CPU::CompactVertexHeader), bounds.data(), bounds.size() * sizeof(CPU::CompactVertexBounds));
+
+	m_CompactVertexBuffer = CreateRef<StorageBuffer>(vertices.data(), (uint32_t)(vertices.size() * sizeof(CPU::CompactVertex)));
+	m_CompactVertexInfoBuffer = CreateRef<StorageBuffer>(info.data(), (uint32_t)info.size());
+	m_CompactVertexMemory = vertices.size() * sizeof(CPU::CompactVertex);
+}
+
+void RayTracingLayer::CreateMaterialLobeBuffer()
+{
+	PROFILE_FUNCTION();
+
+	const std::vector<uint32_t>& lobes = m_CPUScene->GetMaterialLobes();
+	if (lobes.empty())
+	{
+		uint32_t allLobes = CPU::LOBE_ALL;
+		m_MaterialLobeBuffer = CreateRef<StorageBuffer>(&allLobes, (uint32_t)sizeof(uint32_t));
+		return;
+	}
+
+	m_MaterialLobeBuffer = CreateRef<StorageBuffer>((void*)lobes.data(), (uint32_t)(lobes.size() * sizeof(uint32_t)));
+}
+
+bool RayTracingLayer::CreateRayTracingPipeline()
+{
+	std::vector<Ref<Shader>> shaders = m_ShaderCache.LoadAll({
+		"assets/shaders/RayTracing/RayGen.glsl",
+		"assets/shaders/RayTracing/Miss.glsl",
+		"assets/shaders/RayTracing/ClosestHit.glsl"
+	});
+
+	for (const Ref<Shader>& shader : shaders)
+	{
+		if (!shader->CompiledSuccessfully())
+			return false;
+	}
+
+	RayTracingPipelineSpecification spec;
+	spec.RayGenShader = shaders[0];
+	spec.MissShader = shaders[1];
+	spec.ClosestHitShader = shaders[2];
 
 	m_SceneBuffer.FrameIndex = 1;
 
@@ -339,89 +1010,374 @@ bool RayTracingLayer::CreateRayTracingPipeline()
 	return true;
 }
 
+bool RayTracingLayer::CreateWavefrontPipelines()
+{
+	std::vector<Ref<Shader>> shaders = m_ShaderCache.LoadAll({
+		"assets/shaders/RayTracing/WavefrontExtend.glsl",
+		"assets/shaders/RayTracing/WavefrontMiss.glsl",
+		"assets/shaders/RayTracing/WavefrontHit.glsl",
+		"assets/shaders/Wavefront.glsl"
+	});
+
+	for (const Ref<Shader>& shader : shaders)
+	{
+		if (!shader->CompiledSuccessfully())
+			return false;
+	}
+
+	RayTracingPipelineSpecification spec;
+	spec.RayGenShader = shaders[0];
+	spec.MissShader = shaders[1];
+	spec.ClosestHitShader = shaders[2];
+
+	ComputePipelineSpecification computeSpec;
+	computeSpec.Shader = shaders[3];
+
+	m_WavefrontExtendPipeline = CreateRef<RayTracingPipeline>(spec);
+	m_WavefrontComputePipeline = CreateRef<ComputePipeline>(computeSpec);
+
+	// Allocated again from the new layouts on the next WavefrontPass
+	m_WavefrontExtendDescriptorSets.clear();
+	m_WavefrontComputeDescriptorSets.clear();
+
+	m_SceneBuffer.FrameIndex = 1;
+	return true;
+}
+
+// Voxels at or below the cutoff (AbsorptionFactor.y) are dropped while building the bricks, so changing it
+// rebuilds the atlas and the majorant grid
+void RayTracingLayer::CreateCloudVolume()
+{
+	CloudNoiseSpecification noiseSpec = GetCloudNoiseSpecification();
+	CloudNoise noise(noiseSpec, "Cloud.noise");
+
+	glm::uvec3 size = { noiseSpec.Width, noiseSpec.Height, noiseSpec.Depth };
+	std::vector<uint8_t> empty;
+	if (!noise.IsValid())
+		empty.resize((uint64_t)size.x * size.y * size.z);
+
+	BrickVolumeSpecification volumeSpec;
+	volumeSpec.Cutoff = m_SceneBuffer.AbsorptionFactor.y;
+	BrickVolume volume(noise.IsValid() ? noise.GetData() : empty.data(), size, volumeSpec);
+
+	m_CloudBrickCount = volume.GetBrickCount();
+	m_CloudOccupiedBrickCount = volume.GetOccupiedBrickCount();
+
+	glm::uvec3 atlasSize = volume.GetAtlasSize();
+
+	ImageSpecification spec;
+	spec.DebugName = "BrickAtlas";
+	spec.Format = ImageFormat::R8;
+	spec.Usage = ImageUsage::TEXTURE_2D;
+	spec.Width = atlasSize.x;
+	spec.Height = atlasSize.y;
+	spec.Depth = atlasSize.z;
+	m_BrickAtlas = CreateRef<Image>(spec, Buffer(volume.GetAtlas().data(), volume.GetAtlas().size()));
+
+	m_BrickIndexBuffer = CreateRef<StorageBuffer>((void*)volume.GetBrickIndices().data(), (uint32_t)(volume.GetBrickIndices().size() * sizeof(uint32_t)));
+	m_MajorantBuffer = CreateRef<StorageBuffer>((void*)volume.GetMajorants().data(), (uint32_t)(volume.GetMajorants().size() * sizeof(glm::vec2)));
+
+	m_SceneBuffer.VolumeSize = glm::uvec4(volume.GetSize(), volumeSpec.BrickSize);
+	m_SceneBuffer.VolumeBrickGrid = glm::uvec4(volume.GetBrickGridSize(), volume.GetMajorantCellSize());
+	m_SceneBuffer.VolumeMajorantGrid = glm::uvec4(volume.GetMajorantGridSize(), 0);
+	m_SceneBuffer.VolumeAtlasSlots = glm::uvec4(volume.GetAtlasSlots(), volume.GetPaddedBrickSize());
+	m_SceneBuffer.VolumeParams = glm::vec4(0.2f, m_RenderCloud ? 1.0f : 0.0f, 0.0f, 0.0f);
+}
+
 void RayTracingLayer::CreateAccelerationStructure()
 {
-	AccelerationStructureSpecification spec;
-	spec.Mesh = m_Mesh;
-	spec.Transform = m_Transform;
-	m_AccelerationStructure = CreateRef<AccelerationStructure>(spec);
+	InstancedAccelerationStructureSpecification spec;
+	spec.Meshes = { m_Mesh };
+	spec.Instances = m_Instances;
+	m_AccelerationStructure = CreateRef<InstancedAccelerationStructure>(spec);
 }
 
-void RayTracingLayer::OnUpdate()
+void RayTracingLayer::SetInstanceCount(uint32_t count)
 {
-	Ref<VulkanDevice> device = Application::GetApp().GetVulkanDevice();
+	glm::vec3 boundsMin, boundsMax;
+	m_CPUScene->GetMeshBounds(0, boundsMin, boundsMax);
+	m_Instances = CPU::CreateInstanceGrid(0, count, boundsMin, boundsMax, m_Transform);
+
+	// Only the top levels are rebuilt, every copy shares the bottom levels of m_Mesh
+	m_FrameScheduler->WaitIdle();
+	m_CPUScene->ClearInstances();
+	for (const CPU::MeshInstance& instance : m_Instances)
+		m_CPUScene->AddInstance(instance);
+	m_CPUScene->RebuildTopLevel();
+	m_AccelerationStructure->SetInstances(m_Instances);
+
+	// Emissive triangles are per instance
+	CreateLightBuffers();
+
+	m_SelectedSubMeshIndex = -1;
+	m_SceneBuffer.FrameIndex = 1;
+}
 
-	bool moved = m_Camera->Update();
+std::vector<VkDescriptorImageInfo> RayTracingLayer::GetTextureImageInfos() const
+{
+	std::vector<VkDescriptorImageInfo> imageInfos;
+	for (auto texture : m_AccelerationStructure->GetTextures())
+		imageInfos.push_back(texture->GetDescriptorImageInfo());
+	return imageInfos;
+}
 
-	if (!m_Accumulate || moved || m_UpdateSkyBox)
-		m_SceneBuffer.FrameIndex = 1;
+void RayTracingLayer::ApplySceneChanges()
+{
+	PROFILE_FUNCTION();
 
-	m_SceneUniformBuffer->SetData(&m_SceneBuffer);
+	SceneChanges changes = m_SceneChangeTracker->Collect();
+	if (!changes.IsEmpty())
+	{
+		// Material and acceleration structure data is shared by every frame in flight
+		m_FrameScheduler->WaitIdle();
+
+		// The tracker reports submeshes, each moves in every instance of the mesh
+		const std::vector<SubMesh>& subMeshes = m_Mesh->GetSubMeshes();
+		for (uint32_t subMesh : changes.Instances)
+			m_CPUScene->SetSubMeshTransform(subMesh, subMeshes[subMesh].WorldTransform);
+
+		// Only the edited materials are uploaded, the GPU buffer is the MaterialBuffer array as is
+		const std::vector<MaterialBuffer>& materials = m_Mesh->GetMaterialBuffers();
+		Ref<StorageBuffer> materialBuffer = m_AccelerationStructure->GetMaterialBuffer();
+		for (const IndexRange& range : changes.Materials)
+		{
+			for (uint32_t i = range.First; i < range.First + range.Count; i++)
+				m_CPUScene->SetMaterial(i, materials[i]);
 
-	if (Input::IsMouseButtonPressed(MOUSE_BUTTON_LEFT) && m_ViewportPanel->IsHovered())
+			materialBuffer->SetData((void*)&materials[range.First], range.Count * sizeof(MaterialBuffer), range.First * sizeof(MaterialBuffer));
+			m_MaterialLobeBuffer->SetData((void*)&m_CPUScene->GetMaterialLobes()[range.First], range.Count * sizeof(uint32_t), range.First * sizeof(uint32_t));
+		}
+
+		if (!changes.Instances.empty())
+			m_AccelerationStructureDirty = true;
+
+		// Emissive triangles are collected in world space from the materials and transforms
+		CreateLightBuffers();
+
+		m_SceneBuffer.FrameIndex = 1;
+	}
+
+	// Transforms only live in the top level, so every transform edit since the last update is
+	// folded into a single in place update of it
+	if (m_AccelerationStructureDirty && m_AutoUpdateAccelerationStructure)
 	{
-		m_SelectedSubMeshIndex = m_Mesh->RayIntersection(m_ViewportPanel->CastMouseRay(m_Camera), m_Transform);
+		m_FrameScheduler->WaitIdle();
+		m_AccelerationStructure->UpdateTopLevel();
+		m_AccelerationStructureDirty = false;
+		m_SceneBuffer.FrameIndex = 1;
 	}
+}
+
+void RayTracingLayer::WriteTrace(const std::string& filepath)
+{
+	if (Profiler::Get().WriteChromeTrace(filepath))
+		LOG_INFO("Wrote trace to {}", filepath);
+	else
+		LOG_ERROR("Failed to write trace to {}", filepath);
+}
+
+void RayTracingLayer::OnUpdate()
+{
+	PROFILE_FUNCTION();
 
-	// Dispatch PreethamSky compute shader 
-	if (m_UpdateSkyBox) 
+	ApplySceneChanges();
+
+	bool moved;
 	{
-		VkCommandBuffer commandBuffer = device->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		PROFILE_SCOPE("Camera::Update");
+		moved = m_Camera->Update();
+	}
 
-		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PreethamSkyComputePipeline->GetPipeline());
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PreethamSkyComputePipeline->GetPipelineLayout(), 0, 1, &m_PreethamSkyComputeDescriptorSet, 0, nullptr);
-		vkCmdPushConstants(commandBuffer, m_PreethamSkyComputePipeline->GetPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(glm::vec3), &m_SkyboxSettings);
+	// With reprojection a move keeps the accumulation, OnRender adds the history to the next frame
+	m_CameraMoved = moved;
+	if (!m_Accumulate || (moved && !IsReprojecting()) || m_UpdateSkyBox)
+		m_SceneBuffer.FrameIndex = 1;
 
-		vkCmdDispatch(commandBuffer, 64, 64, 6);
+	if (Input::IsMouseButtonPressed(MOUSE_BUTTON_LEFT) && m_ViewportPanel->IsHovered())
+	{
+		auto mouseRay = m_ViewportPanel->CastMouseRay(m_Camera);
 
-		device->FlushCommandBuffer(commandBuffer, true);
+		CPU::Ray ray;
+		ray.Origin = mouseRay.Origin;
+		ray.Direction = mouseRay.Direction;
 
-		m_UpdateSkyBox = false;
+		CPU::Hit hit;
+		m_SelectedSubMeshIndex = m_CPUScene->Intersect(ray, hit) ? (int)m_CPUScene->GetInstances()[hit.InstanceIndex].BottomLevelIndex : -1;
+		m_SelectedHitDistance = hit.Distance;
 	}
 }
 
 void RayTracingLayer::OnRender()
 {
+	PROFILE_FUNCTION();
+
 	/////////////////////////////////////////////
 	// 1. Update data
 	/////////////////////////////////////////////
 
-	// Handle resize
+	// Handle resize, the images are shared by all frames in flight
 	if (m_ViewportPanel->HasResized())
 	{
+		m_FrameScheduler->WaitIdle();
+
 		m_Image->Resize(m_ViewportPanel->GetSize().x, m_ViewportPanel->GetSize().y);
 		m_AccumulationImage->Resize(m_ViewportPanel->GetSize().x, m_ViewportPanel->GetSize().y);
 		m_PostProcessingImage->Resize(m_ViewportPanel->GetSize().x, m_ViewportPanel->GetSize().y);
+		m_MomentsImage->Resize(m_ViewportPanel->GetSize().x, m_ViewportPanel->GetSize().y);
+		m_AlbedoImage->Resize(m_ViewportPanel->GetSize().x, m_ViewportPanel->GetSize().y);
+		m_NormalDepthImage->Resize(m_ViewportPanel->GetSize().x, m_ViewportPanel->GetSize().y);
+		m_DenoiseFilterImages[0]->Resize(m_ViewportPanel->GetSize().x, m_ViewportPanel->GetSize().y);
+		m_DenoiseFilterImages[1]->Resize(m_ViewportPanel->GetSize().x, m_ViewportPanel->GetSize().y);
+		m_DenoisedImage->Resize(m_ViewportPanel->GetSize().x, m_ViewportPanel->GetSize().y);
+		m_HistoryAccumulationImage->Resize(m_ViewportPanel->GetSize().x, m_ViewportPanel->GetSize().y);
+		m_HistoryMomentsImage->Resize(m_ViewportPanel->GetSize().x, m_ViewportPanel->GetSize().y);
+		m_HistoryNormalDepthImage->Resize(m_ViewportPanel->GetSize().x, m_ViewportPanel->GetSize().y);
+		CreateAdaptiveSamplingBuffers();
+		CreateWavefrontBuffers();
 
 		m_SceneBuffer.FrameIndex = 1;
 	}
 
-	m_SceneUniformBuffer->SetData(&m_SceneBuffer);
+	// A sky generated before is only swapped in, a new one is generated at the resolution it needs
+	bool generateSky = false;
+	if (m_UpdateSkyBox)
+	{
+		generateSky = SelectPreethamSky();
+		m_UpdateSkyBox = false;
+	}
+
+	// Only blocks if the GPU is still on the frame that last used this slot
+	VkCommandBuffer commandBuffer = m_FrameScheduler->BeginFrame();
+	uint32_t frameIndex = m_FrameScheduler->GetFrameIndex();
+	m_GPUProfiler->BeginFrame(commandBuffer, frameIndex);
+
+	// Anything else that restarted accumulation since the move leaves nothing to reproject
+	bool reproject = m_CameraMoved && IsReprojecting() && m_SceneBuffer.FrameIndex > 1;
+	m_CameraMoved = false;
+
+	// The wavefront integrator samples every pixel uniformly, and so does the first frame after a move
+	bool adaptiveSampling = m_AdaptiveSampling && !m_Wavefront && !reproject;
+	m_SceneBuffer.AdaptiveSampling = adaptiveSampling ? 1 : 0;
+	m_SceneBuffer.LightSampling = m_NextEventEstimation ? (uint32_t)m_LightSampler.GetMode() : 0;
+	m_SceneBuffer.EnvironmentSampling = m_EnvironmentSampling && m_EnvironmentMap->IsValid() ? 1 : 0;
+	m_SceneBuffer.WriteAOVs = IsDenoising() || IsReprojecting() ? 1 : 0;
+	m_SceneBuffer.Reproject = reproject ? 1 : 0;
+	m_SceneBuffer.Sampler = (uint32_t)m_Sampler;
+
+	// Stays the same while samples accumulate, also for the frames reprojection leaves uniformly sampled
+	m_SceneBuffer.SampleStride = m_AdaptiveSampling && !m_Wavefront ? glm::max(s_SamplesPerFrame, m_AdaptiveSamplingSpec.MaxSamplesPerFrame) : s_SamplesPerFrame;
+	m_SceneUniformBuffers[frameIndex]->SetData(&m_SceneBuffer);
 
 	// Update camera uniform buffer
 	{
 		m_Camera->Resize(m_ViewportPanel->GetSize().x, m_ViewportPanel->GetSize().y);
 
+		// The camera the accumulation was rendered with
+		m_HistoryCameraBuffer = m_CameraBuffer;
+		if (reproject)
+			m_HistoryCameraUniformBuffers[frameIndex]->SetData(&m_HistoryCameraBuffer);
+
 		m_CameraBuffer.ViewProjection = m_Camera->GetViewProjection();
 		m_CameraBuffer.InverseViewProjection = m_Camera->GetInverseViewProjection();
 		m_CameraBuffer.View = m_Camera->GetView();
 		m_CameraBuffer.InverseView = m_Camera->GetInverseView();
 		m_CameraBuffer.InverseProjection = m_Camera->GetInverseProjection();
 
-		m_CameraUniformBuffer->SetData(&m_CameraBuffer);
+		m_CameraUniformBuffers[frameIndex]->SetData(&m_CameraBuffer);
 	}
 
 	/////////////////////////////////////////////
-	// 2. Record command buffers
+	// 2. Record the frame
 	/////////////////////////////////////////////
 
-	m_RenderCommandBuffer->Begin();
+	// The previous frame's ray tracing, post-processing and ImGui reads of the images are done before they are written again
+	InsertMemoryBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
 
-	RayTracingPass();
-	PostProcessingPass();
+	if (generateSky)
+	{
+		{
+			GPUProfileScope zone(*m_GPUProfiler, commandBuffer, "PreethamSkyPass");
+			PreethamSkyPass(commandBuffer);
+		}
+		InsertMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_SHADER_READ_BIT);
+	}
 
-	m_RenderCommandBuffer->End();
-	m_RenderCommandBuffer->Submit();
+	if (adaptiveSampling)
+	{
+		{
+			GPUProfileScope zone(*m_GPUProfiler, commandBuffer, "AdaptiveSamplingPass");
+			AdaptiveSamplingPass(commandBuffer);
+		}
+		InsertMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_SHADER_READ_BIT);
+	}
+
+	// Keep the accumulation of the previous camera before the ray tracing pass replaces it
+	if (reproject)
+	{
+		{
+			GPUProfileScope zone(*m_GPUProfiler, commandBuffer, "ReprojectHistoryPass");
+			ReprojectPass(commandBuffer, 0);
+		}
+		InsertMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+	}
+
+	{
+		// Same zone for both integrators so the Mrays/s readout compares them
+		GPUProfileScope zone(*m_GPUProfiler, commandBuffer, "RayTracingPass");
+		if (m_Wavefront)
+			WavefrontPass(commandBuffer);
+		else
+			RayTracingPass(commandBuffer);
+	}
+	InsertMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+	if (reproject)
+	{
+		{
+			GPUProfileScope zone(*m_GPUProfiler, commandBuffer, "ReprojectPass");
+			ReprojectPass(commandBuffer, 1);
+		}
+		InsertMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	}
+
+	if (IsDenoising())
+	{
+		{
+			GPUProfileScope zone(*m_GPUProfiler, commandBuffer, "DenoisePass");
+			DenoisePass(commandBuffer);
+		}
+		InsertMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	}
+
+	{
+		GPUProfileScope zone(*m_GPUProfiler, commandBuffer, "PostProcessingPass");
+		PostProcessingPass(commandBuffer);
+	}
+
+	// The viewport samples the result in the ImGui pass, submitted after this one on the same queue
+	InsertMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+	m_GPUProfiler->EndFrame();
+	m_FrameScheduler->EndFrame();
+	Profiler::Get().EndFrame();
+
+	if (m_FrameLimit > 0)
+	{
+		m_FrameTimeSum += m_FrameScheduler->GetFrameTime();
+		m_CPUWaitTimeSum += m_FrameScheduler->GetCPUWaitTime();
+
+		if (++m_FrameCount == m_FrameLimit)
+		{
+			m_FrameScheduler->WaitIdle();
+			printf("%u frames, %u in flight: %.3f ms/frame, %.3f ms/frame CPU wait\n", m_FrameCount, m_FrameScheduler->GetFramesInFlight(),
+				m_FrameTimeSum / m_FrameCount, m_CPUWaitTimeSum / m_FrameCount);
+			if (!m_TracePath.empty())
+				WriteTrace(m_TracePath);
+			exit(0);
+		}
+	}
 }
 
 glm::vec3 Scale(const glm::vec3& v, float desiredLength)
@@ -506,73 +1462,182 @@ bool DecomposeTransform(const glm::mat4& transform, glm::vec3& translation, glm:
 static float factor = 1.0f;
 void RayTracingLayer::OnImGUIRender()
 {
+	PROFILE_FUNCTION();
+
 	if (m_DoPostProcessing)
 		m_ViewportPanel->Render(m_PostProcessingImage);
 	else
-		m_ViewportPanel->Render(m_Image);
+		m_ViewportPanel->Render(IsDenoising() ? m_DenoisedImage : m_Image);
 
 	ImGui::Begin("Settings");
 
+	// Only shaders whose files changed are compiled again
 	if (ImGui::Button("Reload Pipeline"))
 	{
+		m_FrameScheduler->WaitIdle();
 		if (!CreateRayTracingPipeline())
 			LOG_CRITICAL("Failed to create Ray Tracing pipeline!");
+		if (!CreateWavefrontPipelines())
+			LOG_CRITICAL("Failed to create wavefront pipelines!");
+	}
+	ImGui::SameLine();
+	ImGui::Text("%u compiled, %u reused", m_ShaderCache.GetCompileCount(), m_ShaderCache.GetReuseCount());
+
+	ImGui::Text("Frame: %.2f ms, CPU wait: %.2f ms (%u in flight)", m_FrameScheduler->GetFrameTime(), m_FrameScheduler->GetCPUWaitTime(), m_FrameScheduler->GetFramesInFlight());
+
+	if (ImGui::CollapsingHeader("Profiler"))
+	{
+		if (m_FrameScheduler->GetFrameTime() > 0.0f)
+			ImGui::Text("%.1f samples/pixel/s", s_SamplesPerFrame * 1000.0f / m_FrameScheduler->GetFrameTime());
+
+		// Counts one camera ray per sample over the GPU time of the ray tracing pass, bounces and shadow rays come on top
+		ProfileStats rayTracingStats;
+		if (Profiler::Get().GetStats("RayTracingPass", ProfileTrack::GPU, rayTracingStats) && rayTracingStats.Average > 0.0f)
+		{
+			double pixelCount = (double)m_ViewportPanel->GetSize().x * m_ViewportPanel->GetSize().y;
+			ImGui::Text("%.1f Mrays/s", pixelCount * s_SamplesPerFrame / (rayTracingStats.Average * 1000.0));
+		}
+
+		ImGui::Text("%-40s %8s %8s %8s", "ms/frame", "avg", "min", "max");
+		for (const ProfileStats& stats : Profiler::Get().GetStats())
+			ImGui::Text("%s %-36s %8.3f %8.3f %8.3f", stats.Track == ProfileTrack::GPU ? "GPU" : "CPU", stats.Name, stats.Average, stats.Min, stats.Max);
+
+		if (ImGui::Button("Save Trace"))
+			WriteTrace("PathTracer.trace.json");
 	}
 
 	ImGui::SliderFloat("Exposure", &m_Exposure, 0.0f, 10.0f);
 
+	// Applied when a slider is released, every sky in between would be generated and evict the cached ones
+	if (ImGui::CollapsingHeader("Sky"))
+	{
+		ImGui::SliderFloat("Turbidity", &m_SkySettings.Turbidity, 1.7f, 10.0f);
+		m_UpdateSkyBox |= ImGui::IsItemDeactivatedAfterEdit();
+		ImGui::SliderAngle("Sun Azimuth", &m_SkySettings.Azimuth, 0.0f, 360.0f);
+		m_UpdateSkyBox |= ImGui::IsItemDeactivatedAfterEdit();
+		ImGui::SliderAngle("Sun Inclination", &m_SkySettings.Inclination, 0.0f, 90.0f);
+		m_UpdateSkyBox |= ImGui::IsItemDeactivatedAfterEdit();
+
+		if (m_PreethamSkybox)
+			ImGui::Text("%ux%u RGBA16F, %zu of %u skies cached", m_PreethamSkybox->GetWidth(), m_PreethamSkybox->GetHeight(), m_PreethamSkies.size(), s_MaxPreethamSkies);
+	}
+
 	ImGui::Checkbox("Post-Processing", &m_DoPostProcessing);
 	ImGui::Checkbox("Accumulate", &m_Accumulate);
 
+	// Sequences of the camera jitter, light, environment and BSDF samples, see Sampler.glsl
+	const char* samplers[] = { "Random", "Sobol", "Blue Noise" };
+	int sampler = (int)m_Sampler;
+	if (ImGui::Combo("Sampler", &sampler, samplers, IM_ARRAYSIZE(samplers)))
+	{
+		m_Sampler = (CPU::SamplerType)sampler;
+		m_SceneBuffer.FrameIndex = 1;
+	}
+
+	// Restart accumulation so every tile goes through the minimum frames again
+	if (ImGui::Checkbox("Adaptive Sampling", &m_AdaptiveSampling))
+		m_SceneBuffer.FrameIndex = 1;
+	if (m_AdaptiveSampling)
+		ImGui::SliderFloat("Error Threshold", &m_AdaptiveSamplingSpec.ErrorThreshold, 0.001f, 0.1f, "%.3f");
+
+	// Light samples at every bounce, combined with BSDF samples by MIS
+	if (ImGui::Checkbox("Next Event Estimation", &m_NextEventEstimation))
+		m_SceneBuffer.FrameIndex = 1;
+	if (m_NextEventEstimation)
+		ImGui::Text("Emissive triangles: %u (%s)", m_LightSampler.GetLightCount(), m_LightSampler.GetMode() == CPU::LightSamplingMode::BVH ? "light BVH" : "alias table");
+
+	// Environment directions picked by luminance at every bounce, combined with BSDF samples by MIS
+	if (ImGui::Checkbox("Environment Importance Sampling", &m_EnvironmentSampling))
+		m_SceneBuffer.FrameIndex = 1;
+
+	// Quantized positions, octahedral normals and half UVs in the hit shaders
+	if (ImGui::Checkbox("Compact Vertices", &m_CompactVertices))
+	{
+		m_FrameScheduler->WaitIdle();
+		CreateCompactVertexBuffers();
+		m_SceneBuffer.FrameIndex = 1;
+	}
+	if (m_CompactVertices)
+		ImGui::Text("Vertices: %.1f MB, %.1f MB uncompressed", m_CompactVertexMemory / (1024.0 * 1024.0), m_Mesh->GetMeshSource()->GetVertices().size() * sizeof(Vertex) / (1024.0 * 1024.0));
+
+	// Copies of the model on a grid, all tracing the same bottom level structures
+	ImGui::SliderInt("Instances", &m_InstanceCount, 1, 4096);
+	if (ImGui::IsItemDeactivatedAfterEdit())
+		SetInstanceCount((uint32_t)m_InstanceCount);
+	ImGui::Text("Top level: %u entries, %u bottom levels (%.1f MB)", m_AccelerationStructure->GetInstanceCount(), m_AccelerationStructure->GetBottomLevelCount(),
+		m_AccelerationStructure->GetBottomLevelMemory() / (1024.0 * 1024.0));
+
+	// Separate generate, extend, shade and continue stages instead of the TracePath megakernel
+	if (ImGui::Checkbox("Wavefront", &m_Wavefront))
+		m_SceneBuffer.FrameIndex = 1;
+	if (m_Wavefront)
+	{
+		ImGui::Checkbox("Sort Hits By Material", &m_WavefrontSortByMaterial);
+		ImGui::Text("Queues: %.1f MB", m_WavefrontQueueMemory / (1024.0 * 1024.0));
+	}
+
+	// Edge-avoiding a-trous filter between ray tracing and post-processing, restarts so every pixel gets its AOVs
+	if (ImGui::Checkbox("Denoise", &m_Denoise))
+		m_SceneBuffer.FrameIndex = 1;
+	if (m_Denoise && m_Wavefront)
+		ImGui::Text("Not available with the wavefront integrator");
+	else if (m_Denoise)
+	{
+		int iterations = (int)m_DenoiserSpec.Iterations;
+		if (ImGui::SliderInt("Denoise Iterations", &iterations, 1, 5))
+			m_DenoiserSpec.Iterations = (uint32_t)iterations;
+		ImGui::SliderFloat("Luminance Sigma", &m_DenoiserSpec.SigmaLuminance, 0.5f, 16.0f);
+		ImGui::SliderFloat("Normal Sigma", &m_DenoiserSpec.SigmaNormal, 1.0f, 256.0f);
+		ImGui::SliderFloat("Depth Sigma", &m_DenoiserSpec.SigmaDepth, 0.001f, 0.1f, "%.3f");
+	}
+
+	// Keeps the accumulation through camera moves, restarts so every pixel has its first hit
+	if (ImGui::Checkbox("Reproject On Camera Moves", &m_Reproject))
+		m_SceneBuffer.FrameIndex = 1;
+	if (m_Reproject && m_Wavefront)
+		ImGui::Text("Not available with the wavefront integrator");
+	else if (m_Reproject)
+	{
+		ImGui::SliderFloat("Depth Tolerance", &m_ReprojectionSpec.DepthTolerance, 0.005f, 0.2f, "%.3f");
+		ImGui::SliderFloat("Normal Threshold", &m_ReprojectionSpec.NormalThreshold, 0.0f, 1.0f);
+		ImGui::SliderFloat("Max History Samples", &m_ReprojectionSpec.MaxHistorySamples, 16.0f, 4096.0f, "%.0f");
+	}
+
 	if (m_SelectedSubMeshIndex > -1)
 	{
 		ImGui::Separator();
 
 		ImGui::Text("%s", m_Mesh->GetSubMeshes()[m_SelectedSubMeshIndex].Name.c_str());
+		ImGui::Text("Hit distance: %.3f", m_SelectedHitDistance);
 		uint32_t materialIndex = m_Mesh->GetSubMeshes()[m_SelectedSubMeshIndex].MaterialIndex;
 		MaterialBuffer& materialBuffer = m_Mesh->GetMaterialBuffers()[materialIndex];
-		bool updated = false;
-
-		if (ImGui::ColorEdit3("Albdeo", glm::value_ptr(materialBuffer.data.AlbedoValue)))
-			updated = true;
-		if (ImGui::DragFloat("Metallic", &materialBuffer.data.MetallicValue, 0.01f, 0.0f, 1.0f))
-			updated = true;
-		if (ImGui::DragFloat("Roughness", &materialBuffer.data.RoughnessValue, 0.01f, 0.0f, 1.0f))
-			updated = true;
-		if (ImGui::ColorEdit3("Emissive Color", glm::value_ptr(materialBuffer.data.EmissiveValue)))
-			updated = true;
-		if (ImGui::DragFloat("Emissive Strength", &materialBuffer.data.EmissiveStrength, 0.1f, 0.0f, 10.0f))
-			updated = true;
-
-		if (ImGui::DragFloat("Anisotropic", &materialBuffer.Anisotropic, 0.01f, 0.0f, 1.0f))
-			updated = true;
-		if (ImGui::DragFloat("Subsurface", &materialBuffer.Subsurface, 0.01f, 0.0f, 1.0f))
-			updated = true;
-		if (ImGui::DragFloat("SpecularTint", &materialBuffer.SpecularTint, 0.01f, 0.0f, 1.0f))
-			updated = true;
-		if (ImGui::DragFloat("Sheen", &materialBuffer.Sheen, 0.01f, 0.0f, 1.0f))
-			updated = true;
-		if (ImGui::DragFloat("SheenTint", &materialBuffer.SheenTint, 0.01f, 0.0f, 1.0f))
-			updated = true;
-		if (ImGui::DragFloat("Clearcoat", &materialBuffer.Clearcoat, 0.01f, 0.0f, 1.0f))
-			updated = true;
-		if (ImGui::DragFloat("ClearcoatRoughness", &materialBuffer.ClearcoatRoughness, 0.01f, 0.0f, 1.0f))
-			updated = true;
-		if (ImGui::DragFloat("SpecTrans", &materialBuffer.SpecTrans, 0.01f, 0.0f, 1.0f))
-			updated = true;
-		if (ImGui::DragFloat("ior", &materialBuffer.ior, 0.01f, 0.0f, 2.0f))
-			updated = true;
+
+		// Edits are picked up by the change tracker on the next update
+		ImGui::ColorEdit3("Albdeo", glm::value_ptr(materialBuffer.data.AlbedoValue));
+		ImGui::DragFloat("Metallic", &materialBuffer.data.MetallicValue, 0.01f, 0.0f, 1.0f);
+		ImGui::DragFloat("Roughness", &materialBuffer.data.RoughnessValue, 0.01f, 0.0f, 1.0f);
+		ImGui::ColorEdit3("Emissive Color", glm::value_ptr(materialBuffer.data.EmissiveValue));
+		ImGui::DragFloat("Emissive Strength", &materialBuffer.data.EmissiveStrength, 0.1f, 0.0f, 10.0f);
+
+		ImGui::DragFloat("Anisotropic", &materialBuffer.Anisotropic, 0.01f, 0.0f, 1.0f);
+		ImGui::DragFloat("Subsurface", &materialBuffer.Subsurface, 0.01f, 0.0f, 1.0f);
+		ImGui::DragFloat("SpecularTint", &materialBuffer.SpecularTint, 0.01f, 0.0f, 1.0f);
+		ImGui::DragFloat("Sheen", &materialBuffer.Sheen, 0.01f, 0.0f, 1.0f);
+		ImGui::DragFloat("SheenTint", &materialBuffer.SheenTint, 0.01f, 0.0f, 1.0f);
+		ImGui::DragFloat("Clearcoat", &materialBuffer.Clearcoat, 0.01f, 0.0f, 1.0f);
+		ImGui::DragFloat("ClearcoatRoughness", &materialBuffer.ClearcoatRoughness, 0.01f, 0.0f, 1.0f);
+		ImGui::DragFloat("SpecTrans", &materialBuffer.SpecTrans, 0.01f, 0.0f, 1.0f);
+		ImGui::DragFloat("ior", &materialBuffer.ior, 0.01f, 0.0f, 2.0f);
+
+		uint32_t lobes = m_CPUScene->GetMaterialLobes()[materialIndex];
+		ImGui::Text("Lobes:%s%s%s%s%s%s", lobes & CPU::LOBE_DIFFUSE ? " Diffuse" : "", lobes & CPU::LOBE_SHEEN ? " Sheen" : "", lobes & CPU::LOBE_SUBSURFACE ? " Subsurface" : "",
+			lobes & CPU::LOBE_METAL ? " Metal" : "", lobes & CPU::LOBE_GLASS ? " Glass" : "", lobes & CPU::LOBE_CLEARCOAT ? " Clearcoat" : "");
 
 		ImGui::Separator();
 
-		static bool recreateAS = false;
-		ImGui::Checkbox("Automatically update AS", &recreateAS);
+		ImGui::Checkbox("Automatically update AS", &m_AutoUpdateAccelerationStructure);
 
-		if (ImGui::DragFloat3("Translation", &m_Mesh->GetSubMeshes()[m_SelectedSubMeshIndex].WorldTransform[3][0]))
-		{
-			if (recreateAS)
-				CreateAccelerationStructure();
-		}
+		ImGui::DragFloat3("Translation", &m_Mesh->GetSubMeshes()[m_SelectedSubMeshIndex].WorldTransform[3][0]);
 	
 		auto& submeshWorldTransform = m_Mesh->GetSubMeshes()[m_SelectedSubMeshIndex].WorldTransform;
 		glm::vec3 translation, scale;
@@ -598,9 +1663,6 @@ void RayTracingLayer::OnImGUIRender()
 		{
 			submeshWorldTransform = glm::translate(glm::mat4(1.0f), translation)
 				* glm::toMat4(rotation) * glm::scale(glm::mat4(1.0f), scale);
-
-			if (recreateAS)
-				CreateAccelerationStructure();
 		}
 
 		ImGui::Separator();
@@ -614,18 +1676,24 @@ void RayTracingLayer::OnImGUIRender()
 		ImGui::Text("%.2f %.2f %.2f %.2f", b.x, b.y, b.z, b.w);
 		ImGui::Text("%.2f %.2f %.2f %.2f", c.x, c.y, c.z, c.w);
 		ImGui::Text("%.2f %.2f %.2f %.2f", d.x, d.y, d.z, d.w);
-
-		if (updated)
-		{
-			m_SceneBuffer.FrameIndex = 1;
-			m_AccelerationStructure->UpdateMaterialData();
-		}
 	}
 	
 	ImGui::Separator();
+	if (ImGui::Checkbox("Render as cloud", &m_RenderCloud))
+	{
+		m_SceneBuffer.VolumeParams.y = m_RenderCloud ? 1.0f : 0.0f;
+		m_SceneBuffer.FrameIndex = 1;
+	}
 	ImGui::DragFloat("x", &m_SceneBuffer.AbsorptionFactor.x, 0.1f);
-	ImGui::DragFloat("y", &m_SceneBuffer.AbsorptionFactor.y, 0.001f);
+	ImGui::DragFloat("y", &m_SceneBuffer.AbsorptionFactor.y, 0.001f, 0.0f, 1.0f);
+	if (ImGui::IsItemDeactivatedAfterEdit())
+	{
+		m_FrameScheduler->WaitIdle();
+		CreateCloudVolume();
+		m_SceneBuffer.FrameIndex = 1;
+	}
 	ImGui::DragFloat("z", &m_SceneBuffer.AbsorptionFactor.z, 0.1f);
+	ImGui::Text("Cloud bricks: %u / %u", m_CloudOccupiedBrickCount, m_CloudBrickCount);
 
 	ImGui::Separator();
 	ImGui::Text("Camera");
@@ -5,33 +5,28 @@
 #include "Graphics/Image.h"
 #include "Graphics/Texture.h"
 #include "Graphics/VulkanBuffers.h"
-#include "Graphics/RenderCommandBuffer.h"
-#include "Graphics/AccelerationStructure.h"
 #include "Graphics/RayTracingPipeline.h"
 #include "Graphics/ComputePipeline.h"
 #include "ImGui/Panels/ViewportPanel.h"
+#include "ShaderBuffers.h"
+#include "CPU/Scene.h"
+#include "CPU/AdaptiveSampling.h"
+#include "CPU/LightSampler.h"
+#include "CPU/EnvironmentMap.h"
+#include "CPU/CompactVertex.h"
+#include "CPU/Denoiser.h"
+#include "CPU/Reprojection.h"
+#include "CPU/PreethamSky.h"
+#include "CPU/Sampler.h"
+#include "SceneChangeTracker.h"
+#include "FrameScheduler.h"
+#include "InstancedAccelerationStructure.h"
+#include "ShaderCache.h"
+#include "Profiling/GPUProfiler.h"
 #include <vulkan/vulkan.h>
 
 using namespace VkLibrary;
 
-struct CameraBuffer
-{
-	glm::mat4 ViewProjection;
-	glm::mat4 InverseViewProjection;
-	glm::mat4 View;
-	glm::mat4 InverseView;
-	glm::mat4 InverseProjection;
-};
-
-struct SceneBuffer
-{
-	uint32_t FrameIndex;
-	float padding0;
-	float padding1;
-	float padding2;
-	glm::vec3 AbsorptionFactor;
-};
-
 class RayTracingLayer : public Layer
 {
 	public:
@@ -47,45 +42,102 @@ class RayTracingLayer : public Layer
 
 		void OnImGUIRender();
 
+		// Exits after this many frames and prints the average frame time, 0 runs forever
+		void SetFrameLimit(uint32_t frameLimit) { m_FrameLimit = frameLimit; }
+
+		// Chrome trace written when the frame limit is reached
+		void SetTracePath(const std::string& tracePath) { m_TracePath = tracePath; }
+
 	private:
-		void RayTracingPass();
-		void PostProcessingPass();
+		void RayTracingPass(VkCommandBuffer commandBuffer);
+		void PostProcessingPass(VkCommandBuffer commandBuffer);
+		void PreethamSkyPass(VkCommandBuffer commandBuffer);
+		bool SelectPreethamSky();
+		void AdaptiveSamplingPass(VkCommandBuffer commandBuffer);
+		void WavefrontPass(VkCommandBuffer commandBuffer);
+		void DenoisePass(VkCommandBuffer commandBuffer);
+		bool IsDenoising() const { return m_Denoise && !m_Wavefront; }
+		void ReprojectPass(VkCommandBuffer commandBuffer, uint32_t stage);
+		bool IsReprojecting() const { return m_Reproject && m_Accumulate && !m_Wavefront; }
+		void CreateAdaptiveSamplingBuffers();
+		void CreateWavefrontBuffers();
+		void CreateLightBuffers();
+		void CreateEnvironmentBuffer();
+		void CreateCompactVertexBuffers();
+		void CreateMaterialLobeBuffer();
+		void CreateCloudVolume();
 		bool CreateRayTracingPipeline();
+		bool CreateWavefrontPipelines();
 		void CreateAccelerationStructure();
+		void SetInstanceCount(uint32_t count);
+		void ApplySceneChanges();
+		std::vector<VkDescriptorImageInfo> GetTextureImageInfos() const;
+		void WriteTrace(const std::string& filepath);
 	private:
+		static constexpr uint32_t s_FramesInFlight = 2;
+		static constexpr uint32_t s_SamplesPerFrame = 5; // SAMPLE_COUNT in RayGen.glsl
+		static constexpr uint32_t s_MaxBounces = 20; // MAX_BOUNCES in RayGen.glsl
+
 		Ref<Mesh> m_Mesh;
 		glm::mat4 m_Transform;
+		Ref<CPU::Scene> m_CPUScene;
+
+		// Copies of m_Mesh laid out by CPU::CreateInstanceGrid, they share its bottom level structures
+		std::vector<CPU::MeshInstance> m_Instances;
+		int m_InstanceCount = 1;
+		Ref<SceneChangeTracker> m_SceneChangeTracker;
 
 		Ref<Camera> m_Camera;
 		CameraBuffer m_CameraBuffer;
-		Ref<UniformBuffer> m_CameraUniformBuffer;
-		
-		Ref<RenderCommandBuffer> m_RenderCommandBuffer;
+		std::vector<Ref<UniformBuffer>> m_CameraUniformBuffers;
+
+		Ref<FrameScheduler> m_FrameScheduler;
+
+		// Shaders are only compiled again when they or one of their includes changed
+		ShaderCache m_ShaderCache;
+		Ref<GPUProfiler> m_GPUProfiler;
 		std::vector<VkWriteDescriptorSet> m_WriteDescriptors;
 		VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;
 
 		Ref<RayTracingPipeline> m_RayTracingPipeline;
-		Ref<AccelerationStructure> m_AccelerationStructure;
-		VkDescriptorSet m_RayTracingDescriptorSet = VK_NULL_HANDLE;
+		Ref<InstancedAccelerationStructure> m_AccelerationStructure;
+		bool m_AutoUpdateAccelerationStructure = false;
+		bool m_AccelerationStructureDirty = false;
+		std::vector<VkDescriptorSet> m_RayTracingDescriptorSets;
 		Ref<Image> m_Image;
 		Ref<Image> m_AccumulationImage;
 		Ref<Image> m_PostProcessingImage;
+		Ref<Image> m_MomentsImage;
 		bool m_Accumulate = true;
 
 		SceneBuffer m_SceneBuffer;
-		Ref<UniformBuffer> m_SceneUniformBuffer;
+		std::vector<Ref<UniformBuffer>> m_SceneUniformBuffers;
 
 		Ref<TextureCube> m_RadianceMap;
 
+		// Cube maps of the most recently used sky settings, RGBA16F at the resolution each one needs
+		struct PreethamSkyEntry
+		{
+			CPU::PreethamSkySettings Settings;
+			CPU::PreethamSkyCoefficients Coefficients;
+			Ref<Image> Skybox;
+			VkDescriptorSet DescriptorSet = VK_NULL_HANDLE;
+			uint64_t LastUse = 0;
+		};
+
+		static constexpr uint32_t s_MaxPreethamSkies = 4;
+
 		Ref<Image> m_PreethamSkybox;
 		Ref<Shader> m_PreethamSkyComputeShader;
 		Ref<ComputePipeline> m_PreethamSkyComputePipeline;
-		VkDescriptorSet m_PreethamSkyComputeDescriptorSet = VK_NULL_HANDLE;
+		std::vector<PreethamSkyEntry> m_PreethamSkies;
+		uint32_t m_PreethamSkyIndex = 0;
+		uint64_t m_PreethamSkyUseCounter = 0;
 
 		Ref<ComputePipeline> m_PostProcessingComputePipeline;
-		VkDescriptorSet m_PostProcessingComputeDescriptorSet = VK_NULL_HANDLE;
+		std::vector<VkDescriptorSet> m_PostProcessingComputeDescriptorSets;
 
-		glm::vec3 m_SkyboxSettings = { 3.14f, 0.0f, 0.0f };
+		CPU::PreethamSkySettings m_SkySettings;
 		bool m_UpdateSkyBox = true;
 		bool m_DoPostProcessing = true;
 
@@ -94,6 +146,86 @@ class RayTracingLayer : public Layer
 		Ref<ViewportPanel> m_ViewportPanel;
 
 		int m_SelectedSubMeshIndex = -1;
-
-		Ref<Image> m_NoiseTexture;
+		float m_SelectedHitDistance = -1.0f;
+
+		Ref<Image> m_BrickAtlas;
+		Ref<StorageBuffer> m_BrickIndexBuffer;
+		Ref<StorageBuffer> m_MajorantBuffer;
+		uint32_t m_CloudBrickCount = 0;
+		uint32_t m_CloudOccupiedBrickCount = 0;
+		bool m_RenderCloud = false;
+
+		bool m_AdaptiveSampling = false;
+		CPU::AdaptiveSamplingSpecification m_AdaptiveSamplingSpec;
+		Ref<ComputePipeline> m_AdaptiveSamplingComputePipeline;
+		std::vector<VkDescriptorSet> m_AdaptiveSamplingDescriptorSets;
+		Ref<StorageBuffer> m_TileErrorBuffer;
+		Ref<StorageBuffer> m_TileSampleBuffer;
+		glm::uvec2 m_AdaptiveTileGrid = glm::uvec2(0);
+
+		// Wavefront integrator, see Wavefront.glsl
+		bool m_Wavefront = false;
+		bool m_WavefrontSortByMaterial = true;
+		Ref<RayTracingPipeline> m_WavefrontExtendPipeline;
+		Ref<ComputePipeline> m_WavefrontComputePipeline;
+		std::vector<VkDescriptorSet> m_WavefrontExtendDescriptorSets;
+		std::vector<VkDescriptorSet> m_WavefrontComputeDescriptorSets;
+		std::vector<Ref<StorageBuffer>> m_WavefrontQueueBuffers; // Binding order of WavefrontQueues.glsl
+		uint64_t m_WavefrontQueueMemory = 0;
+
+		// Next event estimation, see LightSampling.glsl
+		bool m_NextEventEstimation = true;
+		CPU::LightSampler m_LightSampler;
+		Ref<StorageBuffer> m_LightBuffer;
+		Ref<StorageBuffer> m_AliasTableBuffer;
+		Ref<StorageBuffer> m_LightBVHBuffer;
+		Ref<StorageBuffer> m_LightIndexBuffer;
+
+		// Environment importance sampling, see EnvironmentSampling.glsl
+		bool m_EnvironmentSampling = true;
+		Ref<CPU::EnvironmentMap> m_EnvironmentMap;
+		Ref<StorageBuffer> m_EnvironmentBuffer;
+
+		// 20 byte vertices for hit shading, see CompactVertex.glsl
+		bool m_CompactVertices = false;
+		Ref<StorageBuffer> m_CompactVertexBuffer;
+		Ref<StorageBuffer> m_CompactVertexInfoBuffer;
+		uint64_t m_CompactVertexMemory = 0;
+
+		// A-trous denoiser on the first hit AOVs of RayGen.glsl, see Denoise.glsl. The wavefront
+		// integrator doesn't write the AOVs.
+		bool m_Denoise = false;
+		CPU::DenoiserSpecification m_DenoiserSpec;
+		Ref<ComputePipeline> m_DenoiseComputePipeline;
+		std::vector<VkDescriptorSet> m_DenoiseDescriptorSets;
+		Ref<Image> m_AlbedoImage;
+		Ref<Image> m_NormalDepthImage;
+		Ref<Image> m_DenoiseFilterImages[2];
+		Ref<Image> m_DenoisedImage;
+
+		// Temporal reprojection of the accumulation when the camera moves, see Reproject.glsl. Needs the
+		// AOVs as well, the wavefront integrator restarts accumulation instead.
+		bool m_Reproject = false;
+		bool m_CameraMoved = false;
+		CPU::ReprojectionSpecification m_ReprojectionSpec;
+		Ref<ComputePipeline> m_ReprojectComputePipeline;
+		std::vector<VkDescriptorSet> m_ReprojectDescriptorSets;
+		Ref<Image> m_HistoryAccumulationImage;
+		Ref<Image> m_HistoryMomentsImage;
+		Ref<Image> m_HistoryNormalDepthImage;
+		CameraBuffer m_HistoryCameraBuffer;
+		std::vector<Ref<UniformBuffer>> m_HistoryCameraUniformBuffers;
+
+		// Sample sequences of RayGen.glsl, see Sampler.glsl. The wavefront integrator keeps its PCG streams.
+		CPU::SamplerType m_Sampler = CPU::SamplerType::Sobol;
+		Ref<StorageBuffer> m_BlueNoiseBuffer;
+
+		// Disney BSDF lobe mask of every material, kept in sync with m_CPUScene
+		Ref<StorageBuffer> m_MaterialLobeBuffer;
+
+		uint32_t m_FrameLimit = 0;
+		uint32_t m_FrameCount = 0;
+		float m_FrameTimeSum = 0.0f;
+		float m_CPUWaitTimeSum = 0.0f;
+		std::string m_TracePath;
 };
\ No newline at end of file
@@ -0,0 +1,40 @@
+#include "SceneChangeTracker.h"
+#include <cstring>
+
+SceneChangeTracker::SceneChangeTracker(const Ref<Mesh>& mesh)
+	: m_Mesh(mesh), m_Materials(mesh->GetMaterialBuffers())
+{
+	for (const SubMesh& subMesh : mesh->GetSubMeshes())
+		m_Transforms.push_back(subMesh.WorldTransform);
+}
+
+SceneChanges SceneChangeTracker::Collect()
+{
+	SceneChanges changes;
+
+	const std::vector<SubMesh>& subMeshes = m_Mesh->GetSubMeshes();
+	for (uint32_t i = 0; i < (uint32_t)subMeshes.size(); i++)
+	{
+		if (memcmp(&subMeshes[i].WorldTransform, &m_Transforms[i], sizeof(glm::mat4)) != 0)
+		{
+			m_Transforms[i] = subMeshes[i].WorldTransform;
+			changes.Instances.push_back(i);
+		}
+	}
+
+	const std::vector<MaterialBuffer>& materials = m_Mesh->GetMaterialBuffers();
+	for (uint32_t i = 0; i < (uint32_t)materials.size(); i++)
+	{
+		if (memcmp(&materials[i], &m_Materials[i], sizeof(MaterialBuffer)) == 0)
+			continue;
+
+		m_Materials[i] = materials[i];
+
+		if (!changes.Materials.empty() && changes.Materials.back().First + changes.Materials.back().Count == i)
+			changes.Materials.back().Count++;
+		else
+			changes.Materials.push_back({ i, 1 });
+	}
+
+	return changes;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "Graphics/Mesh.h"
+#include <vector>
+
+using namespace VkLibrary;
+
+struct IndexRange
+{
+	uint32_t First = 0;
+	uint32_t Count = 0;
+};
+
+struct SceneChanges
+{
+	std::vector<uint32_t> Instances;  // Submeshes whose WorldTransform changed
+	std::vector<IndexRange> Materials; // Contiguous runs of changed material buffers
+
+	bool IsEmpty() const { return Instances.empty() && Materials.empty(); }
+};
+
+// Records which submesh transforms and materials of a mesh changed since the last Collect().
+// Edits go straight into Mesh::GetSubMeshes() and Mesh::GetMaterialBuffers() (ImGui, scripts),
+// so changes are found by comparing against a snapshot instead of requiring every writer to report them.
+class SceneChangeTracker
+{
+public:
+	SceneChangeTracker(const Ref<Mesh>& mesh);
+
+	SceneChanges Collect();
+
+private:
+	Ref<Mesh> m_Mesh;
+	std::vector<glm::mat4> m_Transforms;
+	std::vector<MaterialBuffer> m_Materials;
+};
@@ -0,0 +1,43 @@
+#include "SceneCompiler.h"
+#include "CPU/CompiledScene.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+using namespace VkLibrary;
+
+int RunSceneCompiler(int argc, char** argv)
+{
+	std::string sourcePath, outputPath;
+	for (int i = 2; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+			outputPath = argv[++i];
+		else
+			sourcePath = argv[i];
+	}
+
+	if (sourcePath.empty())
+	{
+		printf("Usage: PathTracer --compile-scene model.gltf [--output file.scene]\n");
+		return 1;
+	}
+
+	if (outputPath.empty())
+		outputPath = std::filesystem::path(sourcePath).replace_extension(".scene").string();
+
+	auto start = std::chrono::high_resolution_clock::now();
+	Ref<MeshSource> meshSource = CreateRef<MeshSource>(sourcePath);
+	if (!CPU::CompiledScene::Compile(meshSource, sourcePath, outputPath))
+	{
+		printf("Failed to write %s\n", outputPath.c_str());
+		return 1;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	std::error_code error;
+	printf("%s -> %s: %.1f MB in %.2f s\n", sourcePath.c_str(), outputPath.c_str(), std::filesystem::file_size(outputPath, error) / (1024.0 * 1024.0), seconds);
+	return 0;
+}
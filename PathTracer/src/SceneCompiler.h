@@ -0,0 +1,6 @@
+#pragma once
+
+// Entry point for `PathTracer --compile-scene model.gltf [--output file.scene]`, writes the
+// CompiledScene of a glTF ahead of time. Without --output it goes next to the model, where
+// CompiledScene looks for it. Returns the process exit code.
+int RunSceneCompiler(int argc, char** argv);
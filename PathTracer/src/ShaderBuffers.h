@@ -0,0 +1,42 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+
+// Uniform buffer layouts shared by the ray tracing shaders and the CPU backend
+
+struct CameraBuffer
+{
+	glm::mat4 ViewProjection;
+	glm::mat4 InverseViewProjection;
+	glm::mat4 View;
+	glm::mat4 InverseView;
+	glm::mat4 InverseProjection;
+};
+
+struct SceneBuffer
+{
+	uint32_t FrameIndex;
+	uint32_t AdaptiveSampling; // Read per tile sample counts, see AdaptiveSampling.glsl
+	uint32_t LightCount;       // Emissive triangles, see LightSampler.h
+	uint32_t LightSampling;    // LightSamplingMode, 0 disables next event estimation
+	glm::vec3 AbsorptionFactor;
+	float LightTotalPower;
+
+	// Sparse cloud volume, see BrickVolume.h
+	glm::uvec4 VolumeSize;         // xyz voxels, w brick size
+	glm::uvec4 VolumeBrickGrid;    // xyz bricks, w majorant cell size in voxels
+	glm::uvec4 VolumeMajorantGrid; // xyz majorant cells
+	glm::uvec4 VolumeAtlasSlots;   // xyz atlas slots, w padded brick size
+	glm::vec4 VolumeParams;        // x world to texture scale, y non zero renders the mesh as a cloud container
+
+	// Environment importance sampling, see EnvironmentMap.h
+	glm::uvec2 EnvironmentSize;    // Distribution resolution
+	float EnvironmentIntegral;
+	uint32_t EnvironmentSampling;  // 0 leaves the environment to BSDF sampling
+
+	uint32_t WriteAOVs;            // Write the first hit AOVs of Denoise.glsl and Reproject.glsl
+	uint32_t Reproject;            // Accumulate only this frame's paths, Reproject.glsl adds the history
+
+	uint32_t Sampler;              // SamplerType, see Sampler.h
+	uint32_t SampleStride;         // Most samples a pixel gets in a frame, spaces the sample indices of the frames
+};
@@ -0,0 +1,132 @@
+#include "ShaderCache.h"
+#include "Util/Hash.h"
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+
+using Clock = std::chrono::high_resolution_clock;
+
+static bool ReadFile(const std::string& path, std::string& contents)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	std::stringstream stream;
+	stream << file.rdbuf();
+	contents = stream.str();
+	return true;
+}
+
+// Quoted path of an #include line, empty for any other line
+static std::string ParseInclude(const std::string& line)
+{
+	size_t start = line.find_first_not_of(" \t");
+	if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+		return "";
+
+	size_t open = line.find('"', start + 8);
+	size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+	if (close == std::string::npos)
+		return "";
+
+	return line.substr(open + 1, close - open - 1);
+}
+
+// Depth first in include order, every file is hashed once even if it is included again
+static void HashFile(const std::string& path, Hasher& hasher, std::unordered_set<std::string>& visited)
+{
+	if (!visited.insert(path).second)
+		return;
+
+	hasher.Add(path);
+
+	std::string contents;
+	if (!ReadFile(path, contents))
+	{
+		// The compiler reports the missing file, the key only has to change once it exists
+		hasher.Add((uint8_t)0);
+		return;
+	}
+
+	hasher.Add(contents);
+
+	std::istringstream stream(contents);
+	std::string line;
+	while (std::getline(stream, line))
+	{
+		std::string include = ParseInclude(line);
+		if (!include.empty())
+			HashFile(include, hasher, visited);
+	}
+}
+
+uint64_t ShaderCache::ComputeKey(const std::string& path)
+{
+	Hasher hasher;
+	std::unordered_set<std::string> visited;
+	HashFile(path, hasher, visited);
+	return hasher.Get();
+}
+
+std::vector<Ref<Shader>> ShaderCache::LoadAll(const std::vector<std::string>& paths)
+{
+	std::vector<Ref<Shader>> shaders(paths.size());
+	std::vector<uint64_t> keys(paths.size());
+	std::vector<uint32_t> misses;
+
+	for (uint32_t i = 0; i < (uint32_t)paths.size(); i++)
+	{
+		keys[i] = ComputeKey(paths[i]);
+
+		auto it = m_Entries.find(paths[i]);
+		if (it != m_Entries.end() && it->second.Key == keys[i])
+		{
+			shaders[i] = it->second.CompiledShader;
+			m_ReuseCount++;
+		}
+		else
+		{
+			misses.push_back(i);
+		}
+	}
+
+	if (misses.empty())
+		return shaders;
+
+	// One stage at a time, VkLibrary::Shader sets up its GLSL compiler and logs from the constructor
+	// and neither is known to be safe to run from several threads at once
+	std::vector<double> milliseconds(misses.size());
+	Clock::time_point start = Clock::now();
+	for (uint32_t i = 0; i < (uint32_t)misses.size(); i++)
+	{
+		Clock::time_point stageStart = Clock::now();
+		shaders[misses[i]] = CreateRef<Shader>(paths[misses[i]]);
+		milliseconds[i] = std::chrono::duration<double, std::milli>(Clock::now() - stageStart).count();
+	}
+	double totalMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	for (uint32_t i = 0; i < (uint32_t)misses.size(); i++)
+	{
+		uint32_t index = misses[i];
+		if (!shaders[index]->CompiledSuccessfully())
+		{
+			LOG_ERROR("Failed to compile {} ({:.1f} ms)", paths[index], milliseconds[i]);
+			m_Entries.erase(paths[index]);
+			continue;
+		}
+
+		LOG_INFO("Compiled {} in {:.1f} ms", paths[index], milliseconds[i]);
+		m_Entries[paths[index]] = { keys[index], shaders[index] };
+		m_CompileCount++;
+	}
+
+	LOG_INFO("Compiled {} of {} shaders in {:.1f} ms", misses.size(), paths.size(), totalMilliseconds);
+	return shaders;
+}
+
+Ref<Shader> ShaderCache::Load(const std::string& path)
+{
+	return LoadAll({ path })[0];
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "Graphics/Shader.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace VkLibrary;
+
+// Compiled shaders keyed by their source and every file it includes. VkLibrary::Shader compiles the
+// GLSL of a path, so a shader is reused for as long as none of its files change: Load after an edit
+// compiles again only the stages that include the edited file and hands back the others as they were.
+// The cache lives for the run only. Shader and the pipelines take GLSL paths and no VkPipelineCache,
+// so keeping SPIR-V or pipeline data on disk needs entry points VulkanLibrary doesn't have yet.
+class ShaderCache
+{
+public:
+	// Shaders in the order of paths. A stage that failed to compile is returned but not kept, so the
+	// next Load tries it again.
+	std::vector<Ref<Shader>> LoadAll(const std::vector<std::string>& paths);
+	Ref<Shader> Load(const std::string& path);
+
+	// Hash of the file and everything it #includes, transitively. Include paths are relative to the
+	// working directory, like the shaders write them.
+	static uint64_t ComputeKey(const std::string& path);
+
+	uint32_t GetCompileCount() const { return m_CompileCount; }
+	uint32_t GetReuseCount() const { return m_ReuseCount; }
+
+private:
+	struct Entry
+	{
+		uint64_t Key = 0;
+		Ref<Shader> CompiledShader;
+	};
+
+	std::unordered_map<std::string, Entry> m_Entries;
+	uint32_t m_CompileCount = 0;
+	uint32_t m_ReuseCount = 0;
+};
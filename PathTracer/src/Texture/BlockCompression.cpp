@@ -0,0 +1,262 @@
+#include "Texture/BlockCompression.h"
+#include <glm/glm.hpp>
+#include <cstring>
+
+uint32_t GetBlockSize(BlockFormat format)
+{
+	return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+uint64_t GetCompressedSize(BlockFormat format, uint32_t width, uint32_t height)
+{
+	return (uint64_t)((width + 3) / 4) * ((height + 3) / 4) * GetBlockSize(format);
+}
+
+static uint16_t PackRGB565(const glm::vec3& color)
+{
+	glm::vec3 c = glm::clamp(color, 0.0f, 255.0f);
+	uint32_t r = (uint32_t)(c.x * 31.0f / 255.0f + 0.5f);
+	uint32_t g = (uint32_t)(c.y * 63.0f / 255.0f + 0.5f);
+	uint32_t b = (uint32_t)(c.z * 31.0f / 255.0f + 0.5f);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static glm::ivec3 UnpackRGB565(uint16_t color)
+{
+	uint32_t r = (color >> 11) & 31;
+	uint32_t g = (color >> 5) & 63;
+	uint32_t b = color & 31;
+	return glm::ivec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+}
+
+// Four entry palette of a color block, the 3 color + black mode only exists for BC1
+static void ColorPalette(uint16_t color0, uint16_t color1, bool allowThreeColor, glm::ivec4 palette[4])
+{
+	glm::ivec3 c0 = UnpackRGB565(color0);
+	glm::ivec3 c1 = UnpackRGB565(color1);
+	palette[0] = glm::ivec4(c0, 255);
+	palette[1] = glm::ivec4(c1, 255);
+
+	if (color0 > color1 || !allowThreeColor)
+	{
+		palette[2] = glm::ivec4((2 * c0 + c1) / 3, 255);
+		palette[3] = glm::ivec4((c0 + 2 * c1) / 3, 255);
+	}
+	else
+	{
+		palette[2] = glm::ivec4((c0 + c1) / 2, 255);
+		palette[3] = glm::ivec4(0);
+	}
+}
+
+static void EncodeColorBlock(const uint8_t pixels[64], uint8_t* block)
+{
+	glm::vec3 colors[16];
+	glm::vec3 mean = glm::vec3(0.0f);
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		colors[i] = glm::vec3(pixels[i * 4 + 0], pixels[i * 4 + 1], pixels[i * 4 + 2]);
+		mean += colors[i] / 16.0f;
+	}
+
+	// Principal axis by power iteration on the covariance
+	float covariance[6] = {};
+	for (const glm::vec3& color : colors)
+	{
+		glm::vec3 d = color - mean;
+		covariance[0] += d.x * d.x; covariance[1] += d.x * d.y; covariance[2] += d.x * d.z;
+		covariance[3] += d.y * d.y; covariance[4] += d.y * d.z; covariance[5] += d.z * d.z;
+	}
+
+	glm::vec3 axis = glm::vec3(1.0f);
+	for (uint32_t iteration = 0; iteration < 4; iteration++)
+	{
+		glm::vec3 next;
+		next.x = covariance[0] * axis.x + covariance[1] * axis.y + covariance[2] * axis.z;
+		next.y = covariance[1] * axis.x + covariance[3] * axis.y + covariance[4] * axis.z;
+		next.z = covariance[2] * axis.x + covariance[4] * axis.y + covariance[5] * axis.z;
+
+		float length = glm::max(glm::max(glm::abs(next.x), glm::abs(next.y)), glm::abs(next.z));
+		if (length <= 0.0f)
+			break;
+		axis = next / length;
+	}
+
+	float minProjection = 1e30f, maxProjection = -1e30f;
+	for (const glm::vec3& color : colors)
+	{
+		float projection = glm::dot(color - mean, axis);
+		minProjection = glm::min(minProjection, projection);
+		maxProjection = glm::max(maxProjection, projection);
+	}
+
+	float axisLengthSquared = glm::dot(axis, axis);
+	if (axisLengthSquared > 0.0f)
+	{
+		minProjection /= axisLengthSquared;
+		maxProjection /= axisLengthSquared;
+	}
+
+	uint16_t color0 = PackRGB565(mean + axis * maxProjection);
+	uint16_t color1 = PackRGB565(mean + axis * minProjection);
+
+	// color0 > color1 selects the four color mode
+	if (color0 < color1)
+		std::swap(color0, color1);
+
+	glm::ivec4 palette[4];
+	ColorPalette(color0, color1, false, palette);
+
+	uint32_t indices = 0;
+	if (color0 != color1)
+	{
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			glm::ivec3 color = glm::ivec3(colors[i]);
+			uint32_t best = 0;
+			int bestDistance = 0x7FFFFFFF;
+			for (uint32_t entry = 0; entry < 4; entry++)
+			{
+				glm::ivec3 d = color - glm::ivec3(palette[entry]);
+				int distance = d.x * d.x + d.y * d.y + d.z * d.z;
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					best = entry;
+				}
+			}
+			indices |= best << (i * 2);
+		}
+	}
+
+	memcpy(block + 0, &color0, 2);
+	memcpy(block + 2, &color1, 2);
+	memcpy(block + 4, &indices, 4);
+}
+
+static void EncodeAlphaBlock(const uint8_t pixels[64], uint8_t* block)
+{
+	uint8_t alpha0 = 0, alpha1 = 255;
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		alpha0 = glm::max(alpha0, pixels[i * 4 + 3]);
+		alpha1 = glm::min(alpha1, pixels[i * 4 + 3]);
+	}
+
+	// alpha0 > alpha1 selects eight interpolated values
+	uint64_t indices = 0;
+	if (alpha0 > alpha1)
+	{
+		int palette[8] = { alpha0, alpha1 };
+		for (int i = 1; i < 7; i++)
+			palette[i + 1] = ((7 - i) * alpha0 + i * alpha1) / 7;
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			int alpha = pixels[i * 4 + 3];
+			uint64_t best = 0;
+			int bestDistance = 256;
+			for (uint32_t entry = 0; entry < 8; entry++)
+			{
+				int distance = glm::abs(alpha - palette[entry]);
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					best = entry;
+				}
+			}
+			indices |= best << (i * 3);
+		}
+	}
+
+	block[0] = alpha0;
+	block[1] = alpha1;
+	memcpy(block + 2, &indices, 6);
+}
+
+void CompressBlocks(BlockFormat format, const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t rowCount, uint8_t* blocks)
+{
+	uint32_t blocksX = (width + 3) / 4;
+	uint32_t blockSize = GetBlockSize(format);
+
+	uint8_t pixels[64];
+	for (uint32_t blockY = firstRow; blockY < firstRow + rowCount; blockY++)
+	{
+		for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+		{
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				uint32_t x = glm::min(blockX * 4 + i % 4, width - 1);
+				uint32_t y = glm::min(blockY * 4 + i / 4, height - 1);
+				memcpy(pixels + i * 4, rgba + ((uint64_t)y * width + x) * 4, 4);
+			}
+
+			uint8_t* block = blocks + ((uint64_t)blockY * blocksX + blockX) * blockSize;
+			if (format == BlockFormat::BC3)
+			{
+				EncodeAlphaBlock(pixels, block);
+				block += 8;
+			}
+			EncodeColorBlock(pixels, block);
+		}
+	}
+}
+
+void DecompressBlocks(BlockFormat format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* rgba)
+{
+	uint32_t blocksX = (width + 3) / 4;
+	uint32_t blocksY = (height + 3) / 4;
+	uint32_t blockSize = GetBlockSize(format);
+
+	for (uint32_t blockY = 0; blockY < blocksY; blockY++)
+	{
+		for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+		{
+			const uint8_t* block = blocks + ((uint64_t)blockY * blocksX + blockX) * blockSize;
+
+			int alphaPalette[8];
+			uint64_t alphaIndices = 0;
+			if (format == BlockFormat::BC3)
+			{
+				alphaPalette[0] = block[0];
+				alphaPalette[1] = block[1];
+				for (int i = 1; i < 7; i++)
+				{
+					if (block[0] > block[1])
+						alphaPalette[i + 1] = ((7 - i) * block[0] + i * block[1]) / 7;
+					else
+						alphaPalette[i + 1] = i < 5 ? ((5 - i) * block[0] + i * block[1]) / 5 : (i == 5 ? 0 : 255);
+				}
+				memcpy(&alphaIndices, block + 2, 6);
+				block += 8;
+			}
+
+			uint16_t color0, color1;
+			uint32_t indices;
+			memcpy(&color0, block + 0, 2);
+			memcpy(&color1, block + 2, 2);
+			memcpy(&indices, block + 4, 4);
+
+			glm::ivec4 palette[4];
+			ColorPalette(color0, color1, format == BlockFormat::BC1, palette);
+
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				uint32_t x = blockX * 4 + i % 4;
+				uint32_t y = blockY * 4 + i / 4;
+				if (x >= width || y >= height)
+					continue;
+
+				glm::ivec4 color = palette[(indices >> (i * 2)) & 3];
+				if (format == BlockFormat::BC3)
+					color.w = alphaPalette[(alphaIndices >> (i * 3)) & 7];
+
+				uint8_t* pixel = rgba + ((uint64_t)y * width + x) * 4;
+				pixel[0] = (uint8_t)color.x;
+				pixel[1] = (uint8_t)color.y;
+				pixel[2] = (uint8_t)color.z;
+				pixel[3] = (uint8_t)color.w;
+			}
+		}
+	}
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+
+enum class BlockFormat : uint32_t
+{
+	BC1 = 1, // RGB, 8 bytes per 4x4 block
+	BC3 = 2  // RGBA, 16 bytes per 4x4 block
+};
+
+uint32_t GetBlockSize(BlockFormat format);
+
+// Bytes of a width x height image, partial blocks at the right and bottom edges count as whole ones
+uint64_t GetCompressedSize(BlockFormat format, uint32_t width, uint32_t height);
+
+// Compresses the block rows [firstRow, firstRow + rowCount) of an RGBA8 image. Edge blocks repeat
+// the last row and column. Endpoints come from the principal axis of the block's colors, which is
+// close to what a full search finds for the smooth content of albedo and roughness maps.
+void CompressBlocks(BlockFormat format, const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t rowCount, uint8_t* blocks);
+
+// Inverse of CompressBlocks for the whole image
+void DecompressBlocks(BlockFormat format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* rgba);
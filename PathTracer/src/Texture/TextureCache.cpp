@@ -0,0 +1,317 @@
+#include "Texture/TextureCache.h"
+#include "CPU/ThreadPool.h"
+#include "Util/Hash.h"
+#include "Util/Json.h"
+#include "Core/Base.h"
+#include <stb_image.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+static constexpr char s_Magic[4] = { 'B', 'T', 'E', 'X' };
+static constexpr uint32_t s_Version = 1;
+
+// Block rows compressed per job
+static constexpr uint32_t s_RowsPerJob = 16;
+
+struct TextureCacheHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint64_t Key;
+	uint32_t Width;
+	uint32_t Height;
+	BlockFormat Format;
+	uint32_t MipCount;
+	uint64_t DataOffset;
+	uint64_t MipOffsets[CachedTexture::MaxMipCount]; // From the start of the file
+};
+
+// Keep the blocks aligned so the mapped pointers can be handed straight to an upload
+static constexpr uint64_t s_DataOffset = 256;
+static_assert(sizeof(TextureCacheHeader) <= s_DataOffset, "Header overlaps texture data");
+
+static uint32_t GetMipDimension(uint32_t size, uint32_t level)
+{
+	return std::max(size >> level, 1u);
+}
+
+// 2x2 box filter, odd sizes repeat the last row or column
+static void Downsample(const std::vector<uint8_t>& source, uint32_t width, uint32_t height, std::vector<uint8_t>& destination)
+{
+	uint32_t mipWidth = std::max(width / 2, 1u);
+	uint32_t mipHeight = std::max(height / 2, 1u);
+	destination.resize((size_t)mipWidth * mipHeight * 4);
+
+	for (uint32_t y = 0; y < mipHeight; y++)
+	{
+		uint32_t y0 = std::min(y * 2, height - 1);
+		uint32_t y1 = std::min(y * 2 + 1, height - 1);
+		for (uint32_t x = 0; x < mipWidth; x++)
+		{
+			uint32_t x0 = std::min(x * 2, width - 1);
+			uint32_t x1 = std::min(x * 2 + 1, width - 1);
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				uint32_t sum = source[((size_t)y0 * width + x0) * 4 + c] + source[((size_t)y0 * width + x1) * 4 + c]
+					+ source[((size_t)y1 * width + x0) * 4 + c] + source[((size_t)y1 * width + x1) * 4 + c];
+				destination[((size_t)y * mipWidth + x) * 4 + c] = (uint8_t)((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+CachedTexture::CachedTexture(const std::string& sourcePath, const std::string& cacheDirectory)
+	: m_SourcePath(sourcePath)
+{
+	MappedFile source;
+	if (!source.Open(sourcePath))
+	{
+		LOG_ERROR("Texture {} not found", sourcePath);
+		return;
+	}
+
+	// Keyed by content, so the same image referenced from several models shares one cache file
+	Hasher hasher;
+	hasher.Add(s_Version);
+	hasher.Add(source.GetData(), source.GetSize());
+	m_Key = hasher.Get();
+
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.btex", (unsigned long long)m_Key);
+	m_CachePath = (std::filesystem::path(cacheDirectory) / name).string();
+
+	if (Load())
+	{
+		m_LoadedFromCache = true;
+		return;
+	}
+
+	if (!Generate(source))
+	{
+		LOG_ERROR("Failed to generate texture cache {} for {}", m_CachePath, sourcePath);
+		return;
+	}
+
+	// Reopen read-only so the generated file is used exactly like a cache hit
+	if (!Load())
+		LOG_ERROR("Failed to load generated texture cache {}", m_CachePath);
+}
+
+BlockFormat CachedTexture::GetFormat() const
+{
+	return m_File.As<TextureCacheHeader>()->Format;
+}
+
+uint32_t CachedTexture::GetWidth() const
+{
+	return m_File.As<TextureCacheHeader>()->Width;
+}
+
+uint32_t CachedTexture::GetHeight() const
+{
+	return m_File.As<TextureCacheHeader>()->Height;
+}
+
+uint32_t CachedTexture::GetMipCount() const
+{
+	return m_File.As<TextureCacheHeader>()->MipCount;
+}
+
+uint32_t CachedTexture::GetMipWidth(uint32_t level) const
+{
+	return GetMipDimension(GetWidth(), level);
+}
+
+uint32_t CachedTexture::GetMipHeight(uint32_t level) const
+{
+	return GetMipDimension(GetHeight(), level);
+}
+
+const uint8_t* CachedTexture::GetMipData(uint32_t level) const
+{
+	return m_File.GetData() + m_File.As<TextureCacheHeader>()->MipOffsets[level];
+}
+
+uint64_t CachedTexture::GetMipSize(uint32_t level) const
+{
+	return GetCompressedSize(GetFormat(), GetMipWidth(level), GetMipHeight(level));
+}
+
+void CachedTexture::DecodeMip(uint32_t level, std::vector<uint8_t>& rgba) const
+{
+	rgba.resize((size_t)GetMipWidth(level) * GetMipHeight(level) * 4);
+	DecompressBlocks(GetFormat(), GetMipData(level), GetMipWidth(level), GetMipHeight(level), rgba.data());
+}
+
+bool CachedTexture::Load()
+{
+	if (!m_File.Open(m_CachePath))
+		return false;
+
+	bool valid = m_File.GetSize() >= s_DataOffset;
+	if (valid)
+	{
+		const TextureCacheHeader& header = *m_File.As<TextureCacheHeader>();
+		valid = memcmp(header.Magic, s_Magic, sizeof(s_Magic)) == 0
+			&& header.Version == s_Version
+			&& header.Key == m_Key
+			&& (header.Format == BlockFormat::BC1 || header.Format == BlockFormat::BC3)
+			&& header.Width > 0 && header.Height > 0
+			&& header.MipCount > 0 && header.MipCount <= MaxMipCount
+			&& header.DataOffset == s_DataOffset;
+
+		// Every level has to lie inside the file, the last one ends it
+		for (uint32_t level = 0; valid && level < header.MipCount; level++)
+		{
+			uint64_t end = header.MipOffsets[level] + GetCompressedSize(header.Format, GetMipDimension(header.Width, level), GetMipDimension(header.Height, level));
+			valid = header.MipOffsets[level] >= s_DataOffset && end <= m_File.GetSize() && (level + 1 < header.MipCount || end == m_File.GetSize());
+		}
+	}
+
+	if (!valid)
+	{
+		LOG_WARN("Texture cache {} is stale, regenerating", m_CachePath);
+		m_File.Close();
+	}
+
+	return valid;
+}
+
+bool CachedTexture::Generate(const MappedFile& source)
+{
+	int width, height, channels;
+	stbi_uc* pixels = stbi_load_from_memory(source.GetData(), (int)source.GetSize(), &width, &height, &channels, 4);
+	if (!pixels)
+		return false;
+
+	std::vector<uint8_t> level((size_t)width * height * 4);
+	memcpy(level.data(), pixels, level.size());
+	stbi_image_free(pixels);
+
+	bool hasAlpha = false;
+	for (size_t i = 3; i < level.size() && !hasAlpha; i += 4)
+		hasAlpha = level[i] < 255;
+
+	BlockFormat format = hasAlpha ? BlockFormat::BC3 : BlockFormat::BC1;
+
+	// Full chain down to 1x1, or as much of it as fits the header
+	uint32_t mipCount = 1;
+	while (mipCount < MaxMipCount && (GetMipDimension(width, mipCount - 1) > 1 || GetMipDimension(height, mipCount - 1) > 1))
+		mipCount++;
+
+	TextureCacheHeader header = {};
+	memcpy(header.Magic, s_Magic, sizeof(s_Magic));
+	header.Version = s_Version;
+	header.Key = m_Key;
+	header.Width = (uint32_t)width;
+	header.Height = (uint32_t)height;
+	header.Format = format;
+	header.MipCount = mipCount;
+	header.DataOffset = s_DataOffset;
+
+	uint64_t size = s_DataOffset;
+	for (uint32_t mip = 0; mip < mipCount; mip++)
+	{
+		header.MipOffsets[mip] = size;
+		size += GetCompressedSize(format, GetMipDimension(width, mip), GetMipDimension(height, mip));
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(m_CachePath).parent_path(), error);
+
+	// Write to a temporary file first so an interrupted run never leaves a valid looking cache behind
+	std::string tempPath = m_CachePath + ".tmp";
+	MappedFile file;
+	if (!file.Create(tempPath, size))
+		return false;
+
+	*file.As<TextureCacheHeader>() = header;
+
+	std::vector<uint8_t> next;
+	for (uint32_t mip = 0; mip < mipCount; mip++)
+	{
+		uint32_t mipWidth = GetMipDimension(width, mip);
+		uint32_t mipHeight = GetMipDimension(height, mip);
+		uint32_t blockRows = (mipHeight + 3) / 4;
+		uint8_t* blocks = file.As<uint8_t>(header.MipOffsets[mip]);
+
+		CPU::ThreadPool::Get().ParallelFor((blockRows + s_RowsPerJob - 1) / s_RowsPerJob, [&](uint32_t job)
+		{
+			uint32_t firstRow = job * s_RowsPerJob;
+			CompressBlocks(format, level.data(), mipWidth, mipHeight, firstRow, std::min(s_RowsPerJob, blockRows - firstRow), blocks);
+		});
+
+		if (mip + 1 < mipCount)
+		{
+			Downsample(level, mipWidth, mipHeight, next);
+			level.swap(next);
+		}
+	}
+
+	file.Close();
+
+	std::filesystem::rename(tempPath, m_CachePath, error);
+	if (error)
+	{
+		std::filesystem::remove(m_CachePath, error);
+		std::filesystem::rename(tempPath, m_CachePath, error);
+	}
+
+	return !error;
+}
+
+// glTF URIs are percent-encoded
+static std::string DecodeURI(const std::string& uri)
+{
+	std::string result;
+	for (size_t i = 0; i < uri.size(); i++)
+	{
+		if (uri[i] == '%' && i + 2 < uri.size())
+		{
+			result += (char)strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16);
+			i += 2;
+		}
+		else
+		{
+			result += uri[i];
+		}
+	}
+	return result;
+}
+
+std::vector<std::string> ReadGLTFTexturePaths(const std::string& gltfPath)
+{
+	std::vector<std::string> paths;
+
+	JsonValue document;
+	if (!ReadJsonFile(gltfPath, document))
+	{
+		LOG_ERROR("Failed to parse {}", gltfPath);
+		return paths;
+	}
+
+	std::filesystem::path directory = std::filesystem::path(gltfPath).parent_path();
+
+	const JsonValue& textures = document["textures"];
+	const JsonValue& images = document["images"];
+	for (size_t i = 0; i < textures.Size(); i++)
+	{
+		// Textures without a source come from an extension, MeshSource handles them
+		const JsonValue& source = textures[i]["source"];
+		if (source.IsNull())
+		{
+			paths.emplace_back();
+			continue;
+		}
+
+		const std::string& uri = images[(size_t)source.Number]["uri"].String;
+		if (uri.empty() || uri.rfind("data:", 0) == 0)
+			paths.emplace_back();
+		else
+			paths.push_back((directory / DecodeURI(uri)).string());
+	}
+
+	return paths;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "Texture/BlockCompression.h"
+#include "Util/MappedFile.h"
+#include <string>
+#include <vector>
+
+// Mip-mapped, block compressed copy of one source image (JPG, PNG, anything stb_image reads),
+// backed by a memory-mapped cache file named after the hash of the source file's contents. A
+// missing or mismatching cache file is regenerated: the image is decoded, mips are box filtered
+// on the CPU and every level is compressed in parallel block rows. Images with any alpha below
+// 255 use BC3, everything else BC1.
+class CachedTexture
+{
+public:
+	static constexpr uint32_t MaxMipCount = 16;
+
+	CachedTexture(const std::string& sourcePath, const std::string& cacheDirectory);
+
+	bool IsValid() const { return m_File.IsOpen(); }
+	bool WasLoadedFromCache() const { return m_LoadedFromCache; }
+
+	BlockFormat GetFormat() const;
+	uint32_t GetWidth() const;
+	uint32_t GetHeight() const;
+	uint32_t GetMipCount() const;
+
+	uint32_t GetMipWidth(uint32_t level) const;
+	uint32_t GetMipHeight(uint32_t level) const;
+	const uint8_t* GetMipData(uint32_t level) const;
+	uint64_t GetMipSize(uint32_t level) const;
+
+	// Expands a mip level to RGBA8
+	void DecodeMip(uint32_t level, std::vector<uint8_t>& rgba) const;
+
+	const std::string& GetSourcePath() const { return m_SourcePath; }
+	const std::string& GetCachePath() const { return m_CachePath; }
+
+private:
+	bool Load();
+	bool Generate(const MappedFile& source);
+
+private:
+	std::string m_SourcePath;
+	std::string m_CachePath;
+	uint64_t m_Key = 0;
+
+	MappedFile m_File;
+	bool m_LoadedFromCache = false;
+};
+
+// Image file of every glTF texture slot in slot order, resolved against the glTF directory.
+// Slots whose image is embedded (data URI or buffer view) are left empty.
+std::vector<std::string> ReadGLTFTexturePaths(const std::string& gltfPath);
@@ -0,0 +1,233 @@
+#include "TiledRender.h"
+#include "CPU/TiledRenderer.h"
+#include "CPU/CompiledScene.h"
+#include "CPU/ThreadPool.h"
+#include "Graphics/Camera.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace VkLibrary;
+
+struct TiledRenderOptions
+{
+	std::string ModelPath = "assets/models/CornellBox.gltf";
+	std::string OutputPath = "Tiled";
+	uint32_t Width = 15360;
+	uint32_t Height = 8640;
+	uint32_t TileSize = 256;
+	uint32_t Frames = 16;
+	uint32_t Seed = 0;
+	uint32_t Threads = 0;
+	float CheckpointInterval = 60.0f;
+	float Scale = 0.1f;
+	bool NextEventEstimation = true;
+	std::string EnvironmentPath;
+	bool CompiledScene = false;
+	std::vector<std::string> MergeInputs;
+};
+
+static void PrintUsage()
+{
+	printf("Usage: PathTracer --render-tiled [--model path] [--output name] [--width w] [--height h] [--tile-size n]\n");
+	printf("                                 [--frames n] [--seed n] [--checkpoint-interval seconds] [--threads n]\n");
+	printf("                                 [--scale s] [--no-nee] [--environment file.hdr] [--compiled]\n");
+	printf("       PathTracer --render-tiled --merge a.checkpoint b.checkpoint ... [--output name]\n");
+}
+
+static bool ParseOptions(int argc, char** argv, TiledRenderOptions& options)
+{
+	for (int i = 2; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (strcmp(arg, "--no-nee") == 0)
+		{
+			options.NextEventEstimation = false;
+			continue;
+		}
+
+		if (strcmp(arg, "--compiled") == 0)
+		{
+			options.CompiledScene = true;
+			continue;
+		}
+
+		// Every following argument up to the next option is an input
+		if (strcmp(arg, "--merge") == 0)
+		{
+			while (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0)
+				options.MergeInputs.push_back(argv[++i]);
+			if (options.MergeInputs.size() < 2)
+				return false;
+			continue;
+		}
+
+		if (!value)
+			return false;
+
+		if (strcmp(arg, "--model") == 0)
+			options.ModelPath = value;
+		else if (strcmp(arg, "--output") == 0)
+			options.OutputPath = value;
+		else if (strcmp(arg, "--width") == 0)
+			options.Width = (uint32_t)atoi(value);
+		else if (strcmp(arg, "--height") == 0)
+			options.Height = (uint32_t)atoi(value);
+		else if (strcmp(arg, "--tile-size") == 0)
+			options.TileSize = (uint32_t)atoi(value);
+		else if (strcmp(arg, "--frames") == 0)
+			options.Frames = (uint32_t)atoi(value);
+		else if (strcmp(arg, "--seed") == 0)
+			options.Seed = (uint32_t)strtoul(value, nullptr, 10);
+		else if (strcmp(arg, "--checkpoint-interval") == 0)
+			options.CheckpointInterval = (float)atof(value);
+		else if (strcmp(arg, "--threads") == 0)
+			options.Threads = (uint32_t)atoi(value);
+		else if (strcmp(arg, "--scale") == 0)
+			options.Scale = (float)atof(value);
+		else if (strcmp(arg, "--environment") == 0)
+			options.EnvironmentPath = value;
+		else
+			return false;
+
+		i++;
+	}
+
+	return options.Width > 0 && options.Height > 0 && options.TileSize > 0 && options.Frames > 0;
+}
+
+static int Merge(const TiledRenderOptions& options)
+{
+	std::string checkpointPath = options.OutputPath + ".checkpoint";
+	if (!CPU::RenderCheckpoint::Merge(options.MergeInputs, checkpointPath))
+	{
+		printf("Failed to merge, the checkpoints need the same frame and tile size and different seeds\n");
+		return 1;
+	}
+
+	CPU::RenderCheckpoint merged;
+	if (!merged.Open(checkpointPath) || !CPU::WriteEXR(merged, options.OutputPath + ".exr"))
+	{
+		printf("Failed to write %s.exr\n", options.OutputPath.c_str());
+		return 1;
+	}
+
+	printf("Merged %zu checkpoints into %s.checkpoint and %s.exr\n", options.MergeInputs.size(), options.OutputPath.c_str(), options.OutputPath.c_str());
+	return 0;
+}
+
+int RunTiledRender(int argc, char** argv)
+{
+	TiledRenderOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	if (!options.MergeInputs.empty())
+		return Merge(options);
+
+	CPU::ThreadPool::SetDefaultThreadCount(options.Threads);
+
+	glm::mat4 transform = glm::scale(glm::mat4(1.0f), glm::vec3(options.Scale));
+
+	Ref<CPU::Scene> scene;
+	if (options.CompiledScene)
+	{
+		CPU::CompiledSceneSpecification compiledSpec;
+		compiledSpec.SourcePath = options.ModelPath;
+		CPU::CompiledScene compiledScene(compiledSpec);
+		if (!compiledScene.IsValid())
+		{
+			printf("Failed to load compiled scene for %s\n", options.ModelPath.c_str());
+			return 1;
+		}
+		scene = CreateRef<CPU::Scene>(compiledScene, transform);
+	}
+	else
+	{
+		Ref<MeshSource> meshSource = CreateRef<MeshSource>(options.ModelPath);
+		scene = CreateRef<CPU::Scene>(meshSource, transform);
+	}
+
+	// Same default camera as the headless renderer, at the full frame's aspect ratio
+	CameraSpecification cameraSpec;
+	Camera camera(cameraSpec);
+	camera.Resize((float)options.Width, (float)options.Height);
+
+	CameraBuffer cameraBuffer;
+	cameraBuffer.ViewProjection = camera.GetViewProjection();
+	cameraBuffer.InverseViewProjection = camera.GetInverseViewProjection();
+	cameraBuffer.View = camera.GetView();
+	cameraBuffer.InverseView = camera.GetInverseView();
+	cameraBuffer.InverseProjection = camera.GetInverseProjection();
+
+	CPU::TiledRenderSpecification spec;
+	spec.PathTracerSpec.Width = options.Width;
+	spec.PathTracerSpec.Height = options.Height;
+	spec.PathTracerSpec.Seed = options.Seed;
+	spec.PathTracerSpec.NextEventEstimation = options.NextEventEstimation;
+	spec.TileSize = options.TileSize;
+	spec.FramesPerTile = options.Frames;
+	spec.CheckpointInterval = options.CheckpointInterval;
+	if (!options.EnvironmentPath.empty())
+	{
+		CPU::EnvironmentMapSpecification environmentSpec;
+		environmentSpec.Path = options.EnvironmentPath;
+		spec.PathTracerSpec.Environment = CreateRef<CPU::EnvironmentMap>(environmentSpec);
+		if (!spec.PathTracerSpec.Environment->IsValid())
+		{
+			printf("Failed to load environment %s\n", options.EnvironmentPath.c_str());
+			return 1;
+		}
+	}
+
+	CPU::TiledRenderer renderer(spec, scene);
+	if (!renderer.Open(options.OutputPath))
+	{
+		printf("Failed to open %s.checkpoint and %s.exr, an existing checkpoint has to match the size, tile size and seed\n",
+			options.OutputPath.c_str(), options.OutputPath.c_str());
+		return 1;
+	}
+
+	uint32_t tileCount = renderer.GetTileCount();
+	printf("Rendering %s at %ux%u in %u tiles of %u on %u threads, %u already done\n", options.ModelPath.c_str(), options.Width, options.Height,
+		tileCount, options.TileSize, CPU::ThreadPool::Get().GetThreadCount(), renderer.GetResumedTileCount());
+
+	double totalSeconds = 0.0;
+	double totalSamples = 0.0;
+	for (uint32_t tile = 0; tile < tileCount; tile++)
+	{
+		if (renderer.IsTileComplete(tile))
+			continue;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		if (!renderer.RenderTile(cameraBuffer, tile))
+		{
+			printf("Failed to write tile %u\n", tile);
+			return 1;
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		totalSeconds += seconds;
+		totalSamples += (double)renderer.GetLastSampleCount();
+
+		printf("Tile %u/%u: %.2f s, %.2f Msamples/s\n", tile + 1, tileCount, seconds, renderer.GetLastSampleCount() / seconds * 1e-6);
+	}
+
+	if (!renderer.Close())
+	{
+		printf("Failed to write %s.exr\n", options.OutputPath.c_str());
+		return 1;
+	}
+
+	if (totalSeconds > 0.0)
+		printf("Total: %.2f s, %.2f Msamples/s\n", totalSeconds, totalSamples / totalSeconds * 1e-6);
+	return 0;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+// Entry point for `PathTracer --render-tiled ...`, renders a frame of any size tile by tile on the
+// CPU backend with bounded memory, see CPU/TiledRenderer.h. Running the same command again after
+// the process was killed resumes from name.checkpoint, and `--merge a.checkpoint b.checkpoint ...`
+// adds up renders made with different --seed values. Returns the process exit code.
+int RunTiledRender(int argc, char** argv);
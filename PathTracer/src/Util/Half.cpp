@@ -0,0 +1,69 @@
+#include "Util/Half.h"
+#include <cmath>
+#include <cstring>
+
+uint32_t FloatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(float));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t biasedExponent = (bits >> 23) & 0xFF;
+	uint32_t mantissa = bits & 0x7FFFFF;
+
+	if (biasedExponent == 0xFF)
+		return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+
+	int32_t exponent = (int32_t)biasedExponent - 127 + 15;
+	if (exponent >= 31)
+		return sign | 0x7C00;
+
+	// Denormal half, the implicit one becomes part of the shifted mantissa
+	if (exponent <= 0)
+	{
+		if (exponent < -10)
+			return sign;
+
+		mantissa |= 0x800000;
+		uint32_t shift = (uint32_t)(14 - exponent);
+		uint32_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1)))
+			half++;
+		return sign | half;
+	}
+
+	// A carry out of the mantissa correctly bumps the exponent
+	uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+	uint32_t remainder = mantissa & 0x1FFF;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+		half++;
+	return sign | half;
+}
+
+float HalfToFloat(uint32_t half)
+{
+	uint32_t sign = (half & 0x8000) << 16;
+	uint32_t exponent = (half >> 10) & 0x1F;
+	uint32_t mantissa = half & 0x3FF;
+
+	uint32_t bits;
+	if (exponent == 0x1F)
+	{
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else if (exponent == 0)
+	{
+		float value = std::ldexp((float)mantissa, -24);
+		return sign ? -value : value;
+	}
+	else
+	{
+		bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+	}
+
+	float value;
+	memcpy(&value, &bits, sizeof(float));
+	return value;
+}
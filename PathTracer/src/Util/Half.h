@@ -0,0 +1,7 @@
+#pragma once
+#include <cstdint>
+
+// IEEE half precision conversions. FloatToHalf rounds to nearest even, the same result as
+// packHalf2x16 and the conversion on stores to 16-bit float images.
+uint32_t FloatToHalf(float value);
+float HalfToFloat(uint32_t half);
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+
+// Incremental 64-bit FNV-1a, used to key on-disk caches
+class Hasher
+{
+public:
+	Hasher& Add(const void* data, size_t size)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; i++)
+		{
+			m_Hash ^= bytes[i];
+			m_Hash *= 1099511628211ull;
+		}
+		return *this;
+	}
+
+	Hasher& Add(const std::string& string)
+	{
+		uint64_t size = string.size();
+		Add(&size, sizeof(uint64_t));
+		return Add(string.data(), string.size());
+	}
+
+	template<typename T>
+	Hasher& Add(const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be hashed by value");
+		return Add(&value, sizeof(T));
+	}
+
+	uint64_t Get() const { return m_Hash; }
+
+private:
+	uint64_t m_Hash = 14695981039346656037ull;
+};
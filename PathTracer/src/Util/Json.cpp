@@ -0,0 +1,203 @@
+#include "Util/Json.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+static const JsonValue s_Null;
+
+const JsonValue& JsonValue::operator[](const std::string& key) const
+{
+	if (ValueType != Type::Object)
+		return s_Null;
+
+	auto it = Object.find(key);
+	return it != Object.end() ? it->second : s_Null;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const
+{
+	return ValueType == Type::Array && index < Array.size() ? Array[index] : s_Null;
+}
+
+class JsonParser
+{
+public:
+	JsonParser(const std::string& text)
+		: m_Text(text) {}
+
+	bool ParseDocument(JsonValue& value)
+	{
+		if (!ParseValue(value))
+			return false;
+
+		SkipWhitespace();
+		return m_Position == m_Text.size();
+	}
+
+private:
+	void SkipWhitespace()
+	{
+		while (m_Position < m_Text.size() && (m_Text[m_Position] == ' ' || m_Text[m_Position] == '\t' || m_Text[m_Position] == '\n' || m_Text[m_Position] == '\r'))
+			m_Position++;
+	}
+
+	bool Consume(char c)
+	{
+		SkipWhitespace();
+		if (m_Position < m_Text.size() && m_Text[m_Position] == c)
+		{
+			m_Position++;
+			return true;
+		}
+		return false;
+	}
+
+	bool ConsumeLiteral(const char* literal)
+	{
+		size_t length = strlen(literal);
+		if (m_Text.compare(m_Position, length, literal) != 0)
+			return false;
+
+		m_Position += length;
+		return true;
+	}
+
+	bool ParseString(std::string& string)
+	{
+		if (!Consume('"'))
+			return false;
+
+		while (m_Position < m_Text.size())
+		{
+			char c = m_Text[m_Position++];
+			if (c == '"')
+				return true;
+
+			if (c != '\\')
+			{
+				string += c;
+				continue;
+			}
+
+			if (m_Position >= m_Text.size())
+				return false;
+
+			char escape = m_Text[m_Position++];
+			switch (escape)
+			{
+				case 'b': string += '\b'; break;
+				case 'f': string += '\f'; break;
+				case 'n': string += '\n'; break;
+				case 'r': string += '\r'; break;
+				case 't': string += '\t'; break;
+				case 'u':
+				{
+					if (m_Position + 4 > m_Text.size())
+						return false;
+
+					long code = strtol(m_Text.substr(m_Position, 4).c_str(), nullptr, 16);
+					string += code < 0x80 ? (char)code : '?';
+					m_Position += 4;
+					break;
+				}
+				default: string += escape; break;
+			}
+		}
+
+		return false;
+	}
+
+	bool ParseValue(JsonValue& value)
+	{
+		SkipWhitespace();
+		if (m_Position >= m_Text.size())
+			return false;
+
+		char c = m_Text[m_Position];
+		if (c == '{')
+		{
+			m_Position++;
+			value.ValueType = JsonValue::Type::Object;
+			if (Consume('}'))
+				return true;
+
+			do
+			{
+				std::string key;
+				if (!ParseString(key) || !Consume(':') || !ParseValue(value.Object[key]))
+					return false;
+			} while (Consume(','));
+
+			return Consume('}');
+		}
+
+		if (c == '[')
+		{
+			m_Position++;
+			value.ValueType = JsonValue::Type::Array;
+			if (Consume(']'))
+				return true;
+
+			do
+			{
+				value.Array.emplace_back();
+				if (!ParseValue(value.Array.back()))
+					return false;
+			} while (Consume(','));
+
+			return Consume(']');
+		}
+
+		if (c == '"')
+		{
+			value.ValueType = JsonValue::Type::String;
+			return ParseString(value.String);
+		}
+
+		if (ConsumeLiteral("true") || ConsumeLiteral("false"))
+		{
+			value.ValueType = JsonValue::Type::Bool;
+			value.Bool = c == 't';
+			return true;
+		}
+
+		if (ConsumeLiteral("null"))
+			return true;
+
+		char* end = nullptr;
+		value.Number = strtod(m_Text.c_str() + m_Position, &end);
+		if (end == m_Text.c_str() + m_Position)
+			return false;
+
+		value.ValueType = JsonValue::Type::Number;
+		m_Position = end - m_Text.c_str();
+		return true;
+	}
+
+private:
+	const std::string& m_Text;
+	size_t m_Position = 0;
+};
+
+bool ParseJson(const std::string& text, JsonValue& value)
+{
+	value = JsonValue();
+	JsonParser parser(text);
+	if (parser.ParseDocument(value))
+		return true;
+
+	value = JsonValue();
+	return false;
+}
+
+bool ReadJsonFile(const std::string& filepath, JsonValue& value)
+{
+	std::ifstream stream(filepath, std::ios::binary);
+	if (!stream)
+		return false;
+
+	std::stringstream text;
+	text << stream.rdbuf();
+	return ParseJson(text.str(), value);
+}
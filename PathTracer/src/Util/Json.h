@@ -0,0 +1,33 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+
+// Minimal JSON document model, enough to read the glTF fields the loaders need without going
+// through MeshSource. Numbers are kept as doubles, \u escapes outside ASCII become '?'.
+struct JsonValue
+{
+	enum class Type
+	{
+		Null, Bool, Number, String, Array, Object
+	};
+
+	Type ValueType = Type::Null;
+	bool Bool = false;
+	double Number = 0.0;
+	std::string String;
+	std::vector<JsonValue> Array;
+	std::map<std::string, JsonValue> Object;
+
+	bool IsNull() const { return ValueType == Type::Null; }
+
+	// Null value for missing members and out of range indices
+	const JsonValue& operator[](const std::string& key) const;
+	const JsonValue& operator[](size_t index) const;
+
+	size_t Size() const { return ValueType == Type::Array ? Array.size() : Object.size(); }
+};
+
+// Returns false and leaves value null on malformed input
+bool ParseJson(const std::string& text, JsonValue& value);
+bool ReadJsonFile(const std::string& filepath, JsonValue& value);
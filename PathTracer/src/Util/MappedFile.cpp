@@ -0,0 +1,160 @@
+#include "Util/MappedFile.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string& filepath)
+{
+	return Map(filepath, 0, false);
+}
+
+bool MappedFile::Create(const std::string& filepath, uint64_t size)
+{
+	if (size == 0)
+		return false;
+
+	return Map(filepath, size, true);
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Map(const std::string& filepath, uint64_t size, bool writable)
+{
+	Close();
+
+	HANDLE file = CreateFileA(filepath.c_str(), writable ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ, FILE_SHARE_READ, nullptr,
+		writable ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	if (!writable)
+	{
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+		size = (uint64_t)fileSize.QuadPart;
+	}
+
+	// Creating a writable mapping larger than the file extends it
+	HANDLE mapping = CreateFileMappingA(file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, (DWORD)(size >> 32), (DWORD)(size & 0xFFFFFFFF), nullptr);
+	if (!mapping)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	void* data = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, (SIZE_T)size);
+	if (!data)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	m_FileHandle = file;
+	m_MappingHandle = mapping;
+	m_Data = (uint8_t*)data;
+	m_Size = size;
+	m_Writable = writable;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_Data)
+	{
+		if (m_Writable)
+			FlushViewOfFile(m_Data, 0);
+		UnmapViewOfFile(m_Data);
+	}
+
+	if (m_MappingHandle)
+		CloseHandle(m_MappingHandle);
+	if (m_FileHandle)
+		CloseHandle(m_FileHandle);
+
+	m_Data = nullptr;
+	m_Size = 0;
+	m_Writable = false;
+	m_FileHandle = nullptr;
+	m_MappingHandle = nullptr;
+}
+
+#else
+
+bool MappedFile::Map(const std::string& filepath, uint64_t size, bool writable)
+{
+	Close();
+
+	int file = writable ? open(filepath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644) : open(filepath.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	if (writable)
+	{
+		if (ftruncate(file, (off_t)size) != 0)
+		{
+			close(file);
+			return false;
+		}
+	}
+	else
+	{
+		struct stat fileStat;
+		if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+		{
+			close(file);
+			return false;
+		}
+		size = (uint64_t)fileStat.st_size;
+	}
+
+	void* data = mmap(nullptr, (size_t)size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, file, 0);
+	if (data == MAP_FAILED)
+	{
+		close(file);
+		return false;
+	}
+
+	m_FileDescriptor = file;
+	m_Data = (uint8_t*)data;
+	m_Size = size;
+	m_Writable = writable;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_Data)
+	{
+		if (m_Writable)
+			msync(m_Data, (size_t)m_Size, MS_SYNC);
+		munmap(m_Data, (size_t)m_Size);
+	}
+
+	if (m_FileDescriptor >= 0)
+		close(m_FileDescriptor);
+
+	m_Data = nullptr;
+	m_Size = 0;
+	m_Writable = false;
+	m_FileDescriptor = -1;
+}
+
+#endif
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Memory-mapped file. Open() maps an existing file read-only, Create() creates (or truncates)
+// a file of the given size and maps it writable.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& filepath);
+	bool Create(const std::string& filepath, uint64_t size);
+
+	// Flushes writes (for Create) and unmaps the file
+	void Close();
+
+	bool IsOpen() const { return m_Data != nullptr; }
+	uint8_t* GetData() const { return m_Data; }
+	uint64_t GetSize() const { return m_Size; }
+
+	template<typename T>
+	T* As(uint64_t offset = 0) const { return (T*)(m_Data + offset); }
+
+private:
+	bool Map(const std::string& filepath, uint64_t size, bool writable);
+
+private:
+	uint8_t* m_Data = nullptr;
+	uint64_t m_Size = 0;
+	bool m_Writable = false;
+
+#ifdef _WIN32
+	void* m_FileHandle = nullptr;
+	void* m_MappingHandle = nullptr;
+#else
+	int m_FileDescriptor = -1;
+#endif
+};
@@ -0,0 +1,39 @@
+#include "Util/Memory.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <Windows.h>
+	#include <Psapi.h>
+#else
+	#include <sys/resource.h>
+#endif
+
+#ifdef _WIN32
+
+uint64_t GetPeakMemoryUsage()
+{
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+
+	return (uint64_t)counters.PeakWorkingSetSize;
+}
+
+#else
+
+uint64_t GetPeakMemoryUsage()
+{
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+
+	// Linux reports kilobytes, macOS bytes
+#ifdef __APPLE__
+	return (uint64_t)usage.ru_maxrss;
+#else
+	return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+}
+
+#endif
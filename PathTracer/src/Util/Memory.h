@@ -0,0 +1,5 @@
+#pragma once
+#include <cstdint>
+
+// Peak resident set size of the process in bytes, 0 if the platform doesn't report it
+uint64_t GetPeakMemoryUsage();
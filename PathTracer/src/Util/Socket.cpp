@@ -0,0 +1,247 @@
+#include "Util/Socket.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <WinSock2.h>
+	#include <WS2tcpip.h>
+	#pragma comment(lib, "Ws2_32.lib")
+
+	using SocketHandle = SOCKET;
+	static const SocketHandle s_InvalidHandle = INVALID_SOCKET;
+	static void CloseSocketHandle(SocketHandle handle) { closesocket(handle); }
+#else
+	#include <arpa/inet.h>
+	#include <netdb.h>
+	#include <netinet/in.h>
+	#include <netinet/tcp.h>
+	#include <sys/select.h>
+	#include <sys/socket.h>
+	#include <unistd.h>
+
+	using SocketHandle = int;
+	static const SocketHandle s_InvalidHandle = -1;
+	static void CloseSocketHandle(SocketHandle handle) { close(handle); }
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+// Writing to a socket the peer closed fails instead of raising SIGPIPE
+#ifdef MSG_NOSIGNAL
+	static constexpr int s_SendFlags = MSG_NOSIGNAL;
+#else
+	static constexpr int s_SendFlags = 0;
+#endif
+
+static bool InitializeSockets()
+{
+#ifdef _WIN32
+	static bool s_Initialized = []()
+	{
+		WSADATA data;
+		return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+	}();
+	return s_Initialized;
+#else
+	return true;
+#endif
+}
+
+// Small messages go out immediately instead of waiting for more data
+static void DisableNagle(SocketHandle handle)
+{
+	int enable = 1;
+	setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, (const char*)&enable, sizeof(enable));
+}
+
+Socket::~Socket()
+{
+	Close();
+}
+
+Socket::Socket(Socket&& other) noexcept
+	: m_Handle(other.m_Handle)
+{
+	other.m_Handle = s_InvalidHandle;
+}
+
+Socket& Socket::operator=(Socket&& other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+		m_Handle = other.m_Handle;
+		other.m_Handle = s_InvalidHandle;
+	}
+	return *this;
+}
+
+bool Socket::Listen(uint16_t port)
+{
+	Close();
+	if (!InitializeSockets())
+		return false;
+
+	SocketHandle handle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (handle == s_InvalidHandle)
+		return false;
+
+	// Restarting the coordinator shouldn't wait for the last run's connections to time out
+	int reuse = 1;
+	setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+	if (bind(handle, (const sockaddr*)&address, sizeof(address)) != 0 || listen(handle, SOMAXCONN) != 0)
+	{
+		CloseSocketHandle(handle);
+		return false;
+	}
+
+	m_Handle = handle;
+	return true;
+}
+
+bool Socket::Accept(Socket& client)
+{
+	SocketHandle handle = accept(m_Handle, nullptr, nullptr);
+	if (handle == s_InvalidHandle)
+		return false;
+
+	DisableNagle(handle);
+	client.Close();
+	client.m_Handle = handle;
+	return true;
+}
+
+bool Socket::Connect(const std::string& host, uint16_t port)
+{
+	Close();
+	if (!InitializeSockets())
+		return false;
+
+	addrinfo hints = {};
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+
+	addrinfo* addresses = nullptr;
+	std::string service = std::to_string(port);
+	if (getaddrinfo(host.c_str(), service.c_str(), &hints, &addresses) != 0)
+		return false;
+
+	for (addrinfo* address = addresses; address; address = address->ai_next)
+	{
+		SocketHandle handle = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+		if (handle == s_InvalidHandle)
+			continue;
+
+		if (connect(handle, address->ai_addr, (int)address->ai_addrlen) == 0)
+		{
+			DisableNagle(handle);
+			m_Handle = handle;
+			break;
+		}
+
+		CloseSocketHandle(handle);
+	}
+
+	freeaddrinfo(addresses);
+	return IsOpen();
+}
+
+bool Socket::Send(const void* data, size_t size)
+{
+	const char* bytes = (const char*)data;
+	while (size > 0)
+	{
+		int chunk = (int)std::min<size_t>(size, 1 << 30);
+		int sent = (int)send(m_Handle, bytes, chunk, s_SendFlags);
+		if (sent <= 0)
+			return false;
+
+		bytes += sent;
+		size -= (size_t)sent;
+	}
+	return true;
+}
+
+bool Socket::Receive(void* data, size_t size)
+{
+	char* bytes = (char*)data;
+	while (size > 0)
+	{
+		int chunk = (int)std::min<size_t>(size, 1 << 30);
+		int received = (int)recv(m_Handle, bytes, chunk, 0);
+		if (received <= 0)
+			return false;
+
+		bytes += received;
+		size -= (size_t)received;
+	}
+	return true;
+}
+
+bool Socket::SetReceiveTimeout(float seconds)
+{
+#ifdef _WIN32
+	DWORD timeout = (DWORD)(seconds * 1000.0f);
+#else
+	timeval timeout;
+	timeout.tv_sec = (time_t)seconds;
+	timeout.tv_usec = (suseconds_t)((seconds - (float)timeout.tv_sec) * 1e6f);
+#endif
+	return setsockopt(m_Handle, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout)) == 0;
+}
+
+void Socket::Close()
+{
+	if (m_Handle != s_InvalidHandle)
+		CloseSocketHandle(m_Handle);
+	m_Handle = s_InvalidHandle;
+}
+
+bool Socket::IsOpen() const
+{
+	return m_Handle != s_InvalidHandle;
+}
+
+uint16_t Socket::GetPort() const
+{
+	sockaddr_in address = {};
+	socklen_t size = sizeof(address);
+	if (getsockname(m_Handle, (sockaddr*)&address, &size) != 0)
+		return 0;
+
+	return ntohs(address.sin_port);
+}
+
+bool Socket::Poll(const std::vector<Socket*>& sockets, float timeout, std::vector<bool>& readable)
+{
+	readable.assign(sockets.size(), false);
+
+	fd_set set;
+	FD_ZERO(&set);
+	SocketHandle maxHandle = 0;
+	for (const Socket* socket : sockets)
+	{
+		if (!socket->IsOpen())
+			continue;
+
+		FD_SET(socket->m_Handle, &set);
+		maxHandle = std::max(maxHandle, socket->m_Handle);
+	}
+
+	timeval time;
+	time.tv_sec = (long)timeout;
+	time.tv_usec = (long)((timeout - (float)time.tv_sec) * 1e6f);
+	if (select((int)maxHandle + 1, &set, nullptr, nullptr, &time) <= 0)
+		return false;
+
+	for (size_t i = 0; i < sockets.size(); i++)
+		readable[i] = sockets[i]->IsOpen() && FD_ISSET(sockets[i]->m_Handle, &set);
+	return true;
+}
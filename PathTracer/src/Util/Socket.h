@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Blocking TCP socket. Listen() binds a server socket on every interface, Accept() and Connect()
+// give connected sockets whose Send() and Receive() transfer the whole buffer or fail.
+class Socket
+{
+public:
+	Socket() = default;
+	~Socket();
+
+	Socket(const Socket&) = delete;
+	Socket& operator=(const Socket&) = delete;
+	Socket(Socket&& other) noexcept;
+	Socket& operator=(Socket&& other) noexcept;
+
+	// Port 0 picks a free port, see GetPort()
+	bool Listen(uint16_t port);
+	bool Accept(Socket& client);
+	bool Connect(const std::string& host, uint16_t port);
+
+	bool Send(const void* data, size_t size);
+	bool Receive(void* data, size_t size);
+
+	// Receive() fails when no data arrives for this long, 0 waits forever
+	bool SetReceiveTimeout(float seconds);
+
+	void Close();
+
+	bool IsOpen() const;
+
+	// Local port of the socket
+	uint16_t GetPort() const;
+
+	// Waits until any of the sockets can be read (or accepted) from. Returns false on timeout or error.
+	static bool Poll(const std::vector<Socket*>& sockets, float timeout, std::vector<bool>& readable);
+
+private:
+#ifdef _WIN32
+	uintptr_t m_Handle = ~(uintptr_t)0;
+#else
+	int m_Handle = -1;
+#endif
+};
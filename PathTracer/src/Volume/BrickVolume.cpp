@@ -0,0 +1,169 @@
+#include "Volume/BrickVolume.h"
+#include "CPU/ThreadPool.h"
+#include "Core/Base.h"
+#include <algorithm>
+
+static constexpr uint32_t s_MaxAtlasSlotsPerAxis = 64;
+
+static inline uint32_t Wrap(int value, uint32_t size)
+{
+	int wrapped = value % (int)size;
+	return (uint32_t)(wrapped < 0 ? wrapped + (int)size : wrapped);
+}
+
+BrickVolume::BrickVolume(const uint8_t* voxels, const glm::uvec3& size, const BrickVolumeSpecification& specification)
+	: m_Specification(specification), m_Size(size)
+{
+	uint32_t brickSize = m_Specification.BrickSize;
+	uint32_t cellSize = GetMajorantCellSize();
+	if (size.x % cellSize != 0 || size.y % cellSize != 0 || size.z % cellSize != 0)
+	{
+		LOG_ERROR("Volume size must be a multiple of the majorant cell size ({})", cellSize);
+		return;
+	}
+
+	m_BrickGridSize = size / brickSize;
+	m_MajorantGridSize = m_BrickGridSize / m_Specification.BricksPerMajorantCell;
+	uint32_t brickCount = m_BrickGridSize.x * m_BrickGridSize.y * m_BrickGridSize.z;
+	uint32_t paddedSize = GetPaddedBrickSize();
+
+	// Anything at or below the cutoff reads back as exactly zero, so empty bricks can be dropped
+	uint8_t cutoff = (uint8_t)glm::clamp(m_Specification.Cutoff * 255.0f, 0.0f, 255.0f);
+	auto fetch = [&](int x, int y, int z)
+	{
+		uint8_t value = voxels[Wrap(x, size.x) + (uint64_t)size.x * (Wrap(y, size.y) + (uint64_t)size.y * Wrap(z, size.z))];
+		return value <= cutoff ? (uint8_t)0 : value;
+	};
+
+	auto brickOrigin = [&](uint32_t brick)
+	{
+		return glm::ivec3(
+			brick % m_BrickGridSize.x,
+			(brick / m_BrickGridSize.x) % m_BrickGridSize.y,
+			brick / (m_BrickGridSize.x * m_BrickGridSize.y)) * (int)brickSize;
+	};
+
+	// Range of every brick including its apron, the apron is what trilinear lookups inside the brick touch
+	std::vector<uint8_t> brickMax(brickCount);
+	std::vector<uint8_t> brickMin(brickCount);
+	CPU::ThreadPool::Get().ParallelFor(brickCount, [&](uint32_t brick)
+	{
+		glm::ivec3 origin = brickOrigin(brick);
+		uint8_t maxValue = 0;
+		uint8_t minValue = 255;
+		for (uint32_t z = 0; z < paddedSize; z++)
+		{
+			for (uint32_t y = 0; y < paddedSize; y++)
+			{
+				for (uint32_t x = 0; x < paddedSize; x++)
+				{
+					uint8_t value = fetch(origin.x + x, origin.y + y, origin.z + z);
+					maxValue = std::max(maxValue, value);
+					minValue = std::min(minValue, value);
+				}
+			}
+		}
+		brickMax[brick] = maxValue;
+		brickMin[brick] = minValue;
+	});
+
+	m_BrickIndices.resize(brickCount);
+	for (uint32_t brick = 0; brick < brickCount; brick++)
+		m_BrickIndices[brick] = brickMax[brick] > 0 ? m_OccupiedBrickCount++ : EmptyBrick;
+
+	// Keep at least one slot so the atlas image is never empty
+	uint32_t slotCount = std::max(m_OccupiedBrickCount, 1u);
+	m_AtlasSlots.x = std::min(slotCount, s_MaxAtlasSlotsPerAxis);
+	m_AtlasSlots.y = std::min((slotCount + m_AtlasSlots.x - 1) / m_AtlasSlots.x, s_MaxAtlasSlotsPerAxis);
+	m_AtlasSlots.z = (slotCount + m_AtlasSlots.x * m_AtlasSlots.y - 1) / (m_AtlasSlots.x * m_AtlasSlots.y);
+
+	glm::uvec3 atlasSize = GetAtlasSize();
+	m_Atlas.resize((uint64_t)atlasSize.x * atlasSize.y * atlasSize.z);
+
+	CPU::ThreadPool::Get().ParallelFor(brickCount, [&](uint32_t brick)
+	{
+		uint32_t slot = m_BrickIndices[brick];
+		if (slot == EmptyBrick)
+			return;
+
+		glm::ivec3 origin = brickOrigin(brick);
+		glm::uvec3 slotOrigin = glm::uvec3(slot % m_AtlasSlots.x, (slot / m_AtlasSlots.x) % m_AtlasSlots.y, slot / (m_AtlasSlots.x * m_AtlasSlots.y)) * paddedSize;
+		for (uint32_t z = 0; z < paddedSize; z++)
+		{
+			for (uint32_t y = 0; y < paddedSize; y++)
+			{
+				uint8_t* row = m_Atlas.data() + slotOrigin.x + (uint64_t)atlasSize.x * ((slotOrigin.y + y) + (uint64_t)atlasSize.y * (slotOrigin.z + z));
+				for (uint32_t x = 0; x < paddedSize; x++)
+					row[x] = fetch(origin.x + x, origin.y + y, origin.z + z);
+			}
+		}
+	});
+
+	uint32_t bricksPerCell = m_Specification.BricksPerMajorantCell;
+	m_Majorants.resize(m_MajorantGridSize.x * m_MajorantGridSize.y * m_MajorantGridSize.z);
+	for (uint32_t z = 0; z < m_MajorantGridSize.z; z++)
+	{
+		for (uint32_t y = 0; y < m_MajorantGridSize.y; y++)
+		{
+			for (uint32_t x = 0; x < m_MajorantGridSize.x; x++)
+			{
+				uint8_t maxValue = 0;
+				uint8_t minValue = 255;
+				for (uint32_t bz = z * bricksPerCell; bz < (z + 1) * bricksPerCell; bz++)
+				{
+					for (uint32_t by = y * bricksPerCell; by < (y + 1) * bricksPerCell; by++)
+					{
+						for (uint32_t bx = x * bricksPerCell; bx < (x + 1) * bricksPerCell; bx++)
+						{
+							uint32_t brick = bx + m_BrickGridSize.x * (by + m_BrickGridSize.y * bz);
+							maxValue = std::max(maxValue, brickMax[brick]);
+							minValue = std::min(minValue, brickMin[brick]);
+						}
+					}
+				}
+
+				m_Majorants[x + m_MajorantGridSize.x * (y + m_MajorantGridSize.y * z)] = glm::vec2(maxValue, minValue) / 255.0f;
+			}
+		}
+	}
+}
+
+float BrickVolume::Density(const glm::vec3& voxelPosition) const
+{
+	glm::vec3 floorPosition = glm::floor(voxelPosition);
+	glm::vec3 f = voxelPosition - floorPosition;
+
+	glm::uvec3 voxel = glm::uvec3(
+		Wrap((int)floorPosition.x, m_Size.x),
+		Wrap((int)floorPosition.y, m_Size.y),
+		Wrap((int)floorPosition.z, m_Size.z));
+
+	uint32_t brickSize = m_Specification.BrickSize;
+	glm::uvec3 brick = voxel / brickSize;
+	uint32_t slot = m_BrickIndices[brick.x + m_BrickGridSize.x * (brick.y + m_BrickGridSize.y * brick.z)];
+	if (slot == EmptyBrick)
+		return 0.0f;
+
+	uint32_t paddedSize = GetPaddedBrickSize();
+	glm::uvec3 atlasSize = GetAtlasSize();
+	glm::uvec3 texel = glm::uvec3(slot % m_AtlasSlots.x, (slot / m_AtlasSlots.x) % m_AtlasSlots.y, slot / (m_AtlasSlots.x * m_AtlasSlots.y)) * paddedSize + (voxel - brick * brickSize);
+
+	const uint8_t* base = m_Atlas.data() + texel.x + (uint64_t)atlasSize.x * (texel.y + (uint64_t)atlasSize.y * texel.z);
+	uint64_t strideY = atlasSize.x;
+	uint64_t strideZ = (uint64_t)atlasSize.x * atlasSize.y;
+
+	float c00 = glm::mix((float)base[0], (float)base[1], f.x);
+	float c10 = glm::mix((float)base[strideY], (float)base[strideY + 1], f.x);
+	float c01 = glm::mix((float)base[strideZ], (float)base[strideZ + 1], f.x);
+	float c11 = glm::mix((float)base[strideZ + strideY], (float)base[strideZ + strideY + 1], f.x);
+
+	float c0 = glm::mix(c00, c10, f.y);
+	float c1 = glm::mix(c01, c11, f.y);
+	return glm::mix(c0, c1, f.z) * (1.0f / 255.0f);
+}
+
+const glm::vec2& BrickVolume::GetMajorant(const glm::ivec3& cell) const
+{
+	glm::uvec3 wrapped = glm::uvec3(Wrap(cell.x, m_MajorantGridSize.x), Wrap(cell.y, m_MajorantGridSize.y), Wrap(cell.z, m_MajorantGridSize.z));
+	return m_Majorants[wrapped.x + m_MajorantGridSize.x * (wrapped.y + m_MajorantGridSize.y * wrapped.z)];
+}
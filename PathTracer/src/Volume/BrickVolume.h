@@ -0,0 +1,66 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+struct BrickVolumeSpecification
+{
+	uint32_t BrickSize = 8;
+	uint32_t BricksPerMajorantCell = 4;
+
+	// Normalized densities at or below this are treated as empty space
+	float Cutoff = 0.025f;
+};
+
+// Sparse version of a dense 8-bit density volume. The volume is split into bricks, bricks with
+// no density above the cutoff are not stored at all and the rest are packed into a 3D atlas with
+// a one voxel apron on the positive side, so trilinear lookups never need a neighbouring brick.
+// A coarse grid of min/max densities (the majorants) drives delta and ratio tracking.
+//
+// Lookups use voxel coordinates, voxel i is centered on i and the volume repeats like the
+// REPEAT sampler it replaces: voxel = uvw * size - 0.5.
+class BrickVolume
+{
+public:
+	static constexpr uint32_t EmptyBrick = 0xFFFFFFFF;
+
+public:
+	BrickVolume() = default;
+	BrickVolume(const uint8_t* voxels, const glm::uvec3& size, const BrickVolumeSpecification& specification = BrickVolumeSpecification());
+
+	bool IsValid() const { return !m_BrickIndices.empty(); }
+
+	// Trilinear density in [0, 1], the same filtering the GPU atlas sampler does
+	float Density(const glm::vec3& voxelPosition) const;
+
+	// Max/min density within a majorant cell, cell coordinates wrap
+	const glm::vec2& GetMajorant(const glm::ivec3& cell) const;
+
+	const BrickVolumeSpecification& GetSpecification() const { return m_Specification; }
+	const glm::uvec3& GetSize() const { return m_Size; }
+	const glm::uvec3& GetBrickGridSize() const { return m_BrickGridSize; }
+	const glm::uvec3& GetMajorantGridSize() const { return m_MajorantGridSize; }
+	const glm::uvec3& GetAtlasSlots() const { return m_AtlasSlots; }
+	glm::uvec3 GetAtlasSize() const { return m_AtlasSlots * GetPaddedBrickSize(); }
+	uint32_t GetPaddedBrickSize() const { return m_Specification.BrickSize + 1; }
+	uint32_t GetMajorantCellSize() const { return m_Specification.BrickSize * m_Specification.BricksPerMajorantCell; }
+
+	uint32_t GetBrickCount() const { return (uint32_t)m_BrickIndices.size(); }
+	uint32_t GetOccupiedBrickCount() const { return m_OccupiedBrickCount; }
+
+	const std::vector<uint32_t>& GetBrickIndices() const { return m_BrickIndices; }
+	const std::vector<glm::vec2>& GetMajorants() const { return m_Majorants; }
+	const std::vector<uint8_t>& GetAtlas() const { return m_Atlas; }
+
+private:
+	BrickVolumeSpecification m_Specification;
+	glm::uvec3 m_Size = glm::uvec3(0);
+	glm::uvec3 m_BrickGridSize = glm::uvec3(0);
+	glm::uvec3 m_MajorantGridSize = glm::uvec3(0);
+	glm::uvec3 m_AtlasSlots = glm::uvec3(0);
+	uint32_t m_OccupiedBrickCount = 0;
+
+	std::vector<uint32_t> m_BrickIndices; // Atlas slot per brick or EmptyBrick
+	std::vector<glm::vec2> m_Majorants;   // x = max, y = min
+	std::vector<uint8_t> m_Atlas;
+};
@@ -0,0 +1,187 @@
+#include "Volume/CloudNoise.h"
+#include "CPU/ThreadPool.h"
+#include "Util/Hash.h"
+#include "Core/Base.h"
+#include <FastNoise/FastNoise.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+static constexpr char s_Magic[4] = { 'C', 'N', 'S', 'E' };
+static constexpr uint32_t s_Version = 1;
+static constexpr uint32_t s_SlabDepth = 8;
+
+enum class CloudNoiseFormat : uint32_t
+{
+	R8_UNORM = 1
+};
+
+struct CloudNoiseHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint64_t Key;
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t Depth;
+	CloudNoiseFormat Format;
+	float Min;
+	float Max;
+	uint64_t DataOffset;
+};
+
+// Keep the voxel data aligned so the mapped pointer can be handed straight to the upload
+static constexpr uint64_t s_DataOffset = 64;
+static_assert(sizeof(CloudNoiseHeader) <= s_DataOffset, "Header overlaps voxel data");
+
+CloudNoiseSpecification GetCloudNoiseSpecification()
+{
+	CloudNoiseSpecification spec;
+	spec.EncodedNodeTree = "FwDsUTg+rkdhPwAAAAAAAIA/GQAbABkAGQAbABcAAAAAAAAAgD8AAIA/KVyPvxMACtcjPQsAAQAAAAAAAAABAAAAAAAAAAAAAIA/AAAAAD4BGwAXAAAAAAAAAIA/AACAPylcj78TAI/CdbwLAAEAAAAAAAAAAQAAAAAAAAAAAACAPwAAAIA+ARsAFwAAAAAAAACAPwAAgD97FK6+FQBxPapAj8K1QDMzc0ATAI/CdTwLAAEAAAAAAAAAAQAAAAAAAAAAAACAPwAAACA/AJqZGT8BGwAZAA0ABAAAAAAAAEATAArXozwHAAAAAAA/AI/C9T0AzczMPgDNzMw+";
+	spec.Seed = 1337;
+	spec.Frequency = 1.0f;
+	spec.Width = 512;
+	spec.Height = 512;
+	spec.Depth = 512;
+	return spec;
+}
+
+CloudNoise::CloudNoise(const CloudNoiseSpecification& specification, const std::string& cachePath)
+	: m_Specification(specification), m_CachePath(cachePath)
+{
+	Hasher hasher;
+	hasher.Add(s_Version);
+	hasher.Add(m_Specification.EncodedNodeTree);
+	hasher.Add(m_Specification.Seed);
+	hasher.Add(m_Specification.Frequency);
+	hasher.Add(m_Specification.Width);
+	hasher.Add(m_Specification.Height);
+	hasher.Add(m_Specification.Depth);
+	hasher.Add(CloudNoiseFormat::R8_UNORM);
+	m_Key = hasher.Get();
+
+	if (Load())
+	{
+		m_LoadedFromCache = true;
+		return;
+	}
+
+	if (!Generate())
+	{
+		LOG_ERROR("Failed to generate cloud noise cache {}", m_CachePath);
+		return;
+	}
+
+	// Reopen read-only so the generated file is used exactly like a cache hit
+	if (!Load())
+		LOG_ERROR("Failed to load generated cloud noise cache {}", m_CachePath);
+}
+
+const uint8_t* CloudNoise::GetData() const
+{
+	return m_File.GetData() + s_DataOffset;
+}
+
+uint64_t CloudNoise::GetSize() const
+{
+	return (uint64_t)m_Specification.Width * m_Specification.Height * m_Specification.Depth;
+}
+
+bool CloudNoise::Load()
+{
+	if (!m_File.Open(m_CachePath))
+		return false;
+
+	bool valid = m_File.GetSize() >= s_DataOffset;
+	if (valid)
+	{
+		const CloudNoiseHeader& header = *m_File.As<CloudNoiseHeader>();
+		valid = memcmp(header.Magic, s_Magic, sizeof(s_Magic)) == 0
+			&& header.Version == s_Version
+			&& header.Key == m_Key
+			&& header.Width == m_Specification.Width
+			&& header.Height == m_Specification.Height
+			&& header.Depth == m_Specification.Depth
+			&& header.Format == CloudNoiseFormat::R8_UNORM
+			&& header.DataOffset == s_DataOffset
+			&& m_File.GetSize() == s_DataOffset + GetSize();
+	}
+
+	if (!valid)
+	{
+		LOG_WARN("Cloud noise cache {} is stale, regenerating", m_CachePath);
+		m_File.Close();
+	}
+
+	return valid;
+}
+
+bool CloudNoise::Generate()
+{
+	FastNoise::SmartNode<> generator = FastNoise::NewFromEncodedNodeTree(m_Specification.EncodedNodeTree.c_str());
+	if (!generator)
+		return false;
+
+	uint32_t width = m_Specification.Width;
+	uint32_t height = m_Specification.Height;
+	uint32_t depth = m_Specification.Depth;
+	uint64_t sliceSize = (uint64_t)width * height;
+	uint32_t slabCount = (depth + s_SlabDepth - 1) / s_SlabDepth;
+
+	// Generation is deterministic per position, so independent z slabs give the same result as one large grid
+	std::vector<float> noise(GetSize());
+	std::vector<FastNoise::OutputMinMax> slabBounds(slabCount);
+
+	CPU::ThreadPool::Get().ParallelFor(slabCount, [&](uint32_t slab)
+	{
+		uint32_t zStart = slab * s_SlabDepth;
+		uint32_t slabDepth = std::min(s_SlabDepth, depth - zStart);
+		slabBounds[slab] = generator->GenUniformGrid3D(noise.data() + zStart * sliceSize, 0, 0, (int)zStart, (int)width, (int)height, (int)slabDepth, m_Specification.Frequency, m_Specification.Seed);
+	});
+
+	FastNoise::OutputMinMax bounds;
+	for (const FastNoise::OutputMinMax& slab : slabBounds)
+		bounds << slab;
+
+	// Write to a temporary file first so an interrupted run never leaves a valid looking cache behind
+	std::string tempPath = m_CachePath + ".tmp";
+	MappedFile file;
+	if (!file.Create(tempPath, s_DataOffset + GetSize()))
+		return false;
+
+	CloudNoiseHeader& header = *file.As<CloudNoiseHeader>();
+	memcpy(header.Magic, s_Magic, sizeof(s_Magic));
+	header.Version = s_Version;
+	header.Key = m_Key;
+	header.Width = width;
+	header.Height = height;
+	header.Depth = depth;
+	header.Format = CloudNoiseFormat::R8_UNORM;
+	header.Min = bounds.min;
+	header.Max = bounds.max;
+	header.DataOffset = s_DataOffset;
+
+	float scale = bounds.max > bounds.min ? 255.0f / (bounds.max - bounds.min) : 0.0f;
+	uint8_t* voxels = file.As<uint8_t>(s_DataOffset);
+
+	CPU::ThreadPool::Get().ParallelFor(slabCount, [&](uint32_t slab)
+	{
+		uint64_t begin = slab * s_SlabDepth * sliceSize;
+		uint64_t end = std::min<uint64_t>(begin + s_SlabDepth * sliceSize, GetSize());
+		for (uint64_t i = begin; i < end; i++)
+			voxels[i] = (uint8_t)((noise[i] - bounds.min) * scale);
+	});
+
+	file.Close();
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, m_CachePath, error);
+	if (error)
+	{
+		std::filesystem::remove(m_CachePath, error);
+		std::filesystem::rename(tempPath, m_CachePath, error);
+	}
+
+	return !error;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "Util/MappedFile.h"
+#include <string>
+
+struct CloudNoiseSpecification
+{
+	std::string EncodedNodeTree;
+	int Seed = 1337;
+	float Frequency = 1.0f;
+
+	uint32_t Width = 512;
+	uint32_t Height = 512;
+	uint32_t Depth = 512;
+};
+
+// The node tree and resolution the cloud scene is rendered with
+CloudNoiseSpecification GetCloudNoiseSpecification();
+
+// Single channel 8-bit noise volume backed by a memory-mapped cache file. The cache header is
+// keyed by a hash of everything that affects the voxels, a mismatching or stale file is
+// regenerated (in parallel z slabs) and replaced.
+class CloudNoise
+{
+public:
+	CloudNoise(const CloudNoiseSpecification& specification, const std::string& cachePath);
+
+	bool IsValid() const { return m_File.IsOpen(); }
+	bool WasLoadedFromCache() const { return m_LoadedFromCache; }
+
+	// Voxels are laid out x fastest, then y, then z
+	const uint8_t* GetData() const;
+	uint64_t GetSize() const;
+
+	const CloudNoiseSpecification& GetSpecification() const { return m_Specification; }
+
+private:
+	bool Load();
+	bool Generate();
+
+private:
+	CloudNoiseSpecification m_Specification;
+	std::string m_CachePath;
+	uint64_t m_Key = 0;
+
+	MappedFile m_File;
+	bool m_LoadedFromCache = false;
+};
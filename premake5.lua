@@ -33,8 +33,68 @@ project "PathTracer"
 		"%{prj.name}/src/**.h",
 	}
 
+	removefiles
+	{
+		"%{prj.name}/src/Benchmark/BenchmarkMain.cpp",
+	}
+
+	includedirs
+	{
+		"%{prj.name}/src",
+		"PathTracer/vendor/FastNoise2/include",
+	}
+
+	links
+	{
+		"VulkanLibrary",
+		"PathTracer/vendor/FastNoise2/lib/FastNoise.lib",
+	}
+
+	VulkanLibraryIncludeDirectories("VulkanLibrary")
+
+	filter "system:windows"
+		cppdialect "C++17"
+		systemversion "latest"
+
+	filter "configurations:Debug"
+		runtime "Debug"
+		symbols "On"
+		
+		defines 
+		{
+			"ENABLE_ASSERTS"
+		}
+
+	filter "configurations:Release"
+		runtime "Release"
+		optimize "On"
+
+project "PathTracerBenchmark"
+	location "PathTracer"
+	kind "ConsoleApp"
+	language "C++"
+	staticruntime "on"
+
+	targetdir ("bin/" .. outputdir .. "/PathTracerBenchmark")
+	objdir ("bin/intermediates/" .. outputdir .. "/%{prj.name}")
+
+	-- Same sources as PathTracer with its own entry point, assets are loaded relative to PathTracer/
+	debugdir "PathTracer"
+
+	files
+	{
+		"PathTracer/src/**.cpp",
+		"PathTracer/src/**.h",
+	}
+
+	removefiles
+	{
+		"PathTracer/src/Main.cpp",
+	}
+
 	includedirs
 	{
+		"PathTracer/src",
 		"PathTracer/vendor/FastNoise2/include",
 	}
 
@@ -61,4 +121,4 @@ project "PathTracer"
 
 	filter "configurations:Release"
 		runtime "Release"
-		optimize "On"
\ No newline at end of file
+		optimize "On"